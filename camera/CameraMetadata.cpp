@@ -17,6 +17,8 @@
 // #define LOG_NDEBUG 0
 
 #define LOG_TAG "Camera2-Metadata"
+#include <string.h>
+
 #include <utils/Log.h>
 #include <utils/Errors.h>
 
@@ -481,6 +483,89 @@ status_t CameraMetadata::removePermissionEntries(metadata_vendor_id_t vendorId,
     return NO_ERROR;
 }
 
+status_t CameraMetadata::getDelta(const CameraMetadata &base, CameraMetadata *delta) const {
+    if (delta == NULL) {
+        return BAD_VALUE;
+    }
+    if (mLocked || base.mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    delta->clear();
+
+    // the changed entries need no more data than this metadata has, the removals none.
+    size_t entryCapacity = entryCount() + base.entryCount();
+    size_t dataCapacity = (mBuffer == NULL) ? 0 : get_camera_metadata_data_count(mBuffer);
+    camera_metadata_t *buffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    if (buffer == NULL) {
+        ALOGE("%s: Can't allocate the metadata delta", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    const camera_metadata_t *vendorSource = (mBuffer != NULL) ? mBuffer : base.mBuffer;
+    if (vendorSource != NULL) {
+        set_camera_metadata_vendor_id(buffer, get_camera_metadata_vendor_id(vendorSource));
+    }
+
+    status_t res = OK;
+    camera_metadata_ro_entry_t entry;
+    for (size_t i = 0; i < entryCount() && res == OK; i++) {
+        get_camera_metadata_ro_entry(mBuffer, i, &entry);
+        camera_metadata_ro_entry_t old = base.find(entry.tag);
+        if (entry.count == 0) {
+            if (old.count == 0) {
+                continue;
+            }
+        } else if (old.count == entry.count && memcmp(old.data.u8, entry.data.u8,
+                camera_metadata_type_size[entry.type] * entry.count) == 0) {
+            continue;
+        }
+        res = add_camera_metadata_entry(buffer, entry.tag, entry.data.u8, entry.count);
+    }
+    for (size_t i = 0; i < base.entryCount() && res == OK; i++) {
+        get_camera_metadata_ro_entry(base.mBuffer, i, &entry);
+        if (entry.count > 0 && !exists(entry.tag)) {
+            res = add_camera_metadata_entry(buffer, entry.tag, entry.data.u8, 0);
+        }
+    }
+    if (res != OK) {
+        ALOGE("%s: Can't add entry to the metadata delta: %d", __FUNCTION__, res);
+        free_camera_metadata(buffer);
+        return res;
+    }
+    sort_camera_metadata(buffer);
+    delta->acquire(buffer);
+    return OK;
+}
+
+status_t CameraMetadata::applyDelta(const CameraMetadata &delta) {
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    if (delta.mBuffer == NULL) {
+        return OK;
+    }
+    if (mBuffer == NULL) {
+        // vendor tags are only known to a buffer with the vendor id
+        status_t res = resizeIfNeeded(delta.entryCount(),
+                get_camera_metadata_data_count(delta.mBuffer));
+        if (res != OK) {
+            return res;
+        }
+        set_camera_metadata_vendor_id(mBuffer, get_camera_metadata_vendor_id(delta.mBuffer));
+    }
+
+    camera_metadata_ro_entry_t entry;
+    for (size_t i = 0; i < delta.entryCount(); i++) {
+        get_camera_metadata_ro_entry(delta.mBuffer, i, &entry);
+        status_t res = (entry.count == 0) ? erase(entry.tag) : update(entry);
+        if (res != OK) {
+            return res;
+        }
+    }
+    return OK;
+}
+
 void CameraMetadata::dump(int fd, int verbosity, int indentation) const {
     dump_indented_camera_metadata(mBuffer, fd, verbosity, indentation);
 }
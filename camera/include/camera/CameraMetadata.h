@@ -176,6 +176,19 @@ class CameraMetadata: public Parcelable {
     status_t removePermissionEntries(metadata_vendor_id_t vendorId,
             std::vector<int32_t> *tagsRemoved /*out*/);
 
+    /**
+     * Compute what changed from |base| to this metadata: the entries that |base| does
+     * not have with the same data, and an entry without data for each tag of |base|
+     * that is gone. Entries without data are treated as missing ones.
+     */
+    status_t getDelta(const CameraMetadata &base, CameraMetadata *delta /*out*/) const;
+
+    /**
+     * Apply a delta computed by getDelta(): entries without data are removed, the
+     * others are added or replaced.
+     */
+    status_t applyDelta(const CameraMetadata &delta);
+
     /**
      * Swap the underlying camera metadata between this and the other
      * metadata object.
@@ -737,8 +737,16 @@ CameraDevice::configureStreamsLocked(const ACaptureSessionOutputContainer* outpu
 
 void
 CameraDevice::setRemoteDevice(sp<hardware::camera2::ICameraDeviceUser> remote) {
+    // Per frame results mostly repeat the previous ones, so have the service send only what
+    // changed. This has to be set up before the first request.
+    binder::Status remoteRet = remote->setResultDeltaEnabled(true);
+    if (!remoteRet.isOk()) {
+        ALOGW("%s: Camera %s does not send result deltas: %s", __FUNCTION__, getId(),
+                remoteRet.toString8().string());
+    }
     Mutex::Autolock _l(mDeviceLock);
     mRemote = remote;
+    mResultDeltaEnabled = remoteRet.isOk();
 }
 
 camera_status_t
@@ -1577,6 +1585,24 @@ CameraDevice::ServiceCallback::onResultReceived(
         return ret; // device has been disconnected
     }
 
+    // Reconstruct complete results before anything is skipped, the next ones build on them.
+    CameraMetadata metadataCopy;
+    std::vector<PhysicalCaptureResultInfo> physicalResultCopies;
+    const std::vector<PhysicalCaptureResultInfo>* physicalResults = &physicalResultInfos;
+    if (dev->mResultDeltaEnabled && !isPartialResult) {
+        dev->mLastResult.applyDelta(metadata);
+        metadataCopy = dev->mLastResult;
+        physicalResultCopies = physicalResultInfos;
+        for (auto& physicalResult : physicalResultCopies) {
+            CameraMetadata& last = dev->mLastPhysicalResults[physicalResult.mPhysicalCameraId];
+            last.applyDelta(physicalResult.mPhysicalCameraMetadata);
+            physicalResult.mPhysicalCameraMetadata = last;
+        }
+        physicalResults = &physicalResultCopies;
+    } else {
+        metadataCopy = metadata;
+    }
+
     if (dev->isClosed()) {
         if (!isPartialResult) {
             dev->mFrameNumberTracker.updateTracker(frameNumber, /*isError*/false);
@@ -1585,13 +1611,14 @@ CameraDevice::ServiceCallback::onResultReceived(
         return ret;
     }
 
-    CameraMetadata metadataCopy = metadata;
     metadataCopy.update(ANDROID_LENS_INFO_SHADING_MAP_SIZE, dev->mShadingMapSize, /*data_count*/2);
     metadataCopy.update(ANDROID_SYNC_FRAME_NUMBER, &frameNumber, /*data_count*/1);
 
     auto it = dev->mSequenceCallbackMap.find(sequenceId);
     if (it != dev->mSequenceCallbackMap.end()) {
-        CallbackHolder cbh = (*it).second;
+        // Referenced rather than copied: this runs for every result, and mDeviceLock keeps
+        // the map entry alive while the message is built.
+        const CallbackHolder& cbh = (*it).second;
         sp<ACameraCaptureSession> session = cbh.mSession;
         if ((size_t) burstId >= cbh.mRequests.size()) {
             ALOGE("%s: Error: request index %d out of bound (size %zu)",
@@ -1601,8 +1628,6 @@ CameraDevice::ServiceCallback::onResultReceived(
         sp<CaptureRequest> request = cbh.mRequests[burstId];
         sp<ACameraMetadata> result(new ACameraMetadata(
                 metadataCopy.release(), ACameraMetadata::ACM_RESULT));
-        sp<ACameraPhysicalCaptureResultInfo> physicalResult(
-                new ACameraPhysicalCaptureResultInfo(physicalResultInfos, frameNumber));
 
         sp<AMessage> msg = new AMessage(
                 cbh.mIsLogicalCameraCallback ? kWhatLogicalCaptureResult : kWhatCaptureResult,
@@ -1615,6 +1640,9 @@ CameraDevice::ServiceCallback::onResultReceived(
             msg->setPointer(kCallbackFpKey,
                     (void *)cbh.mOnCaptureProgressed);
         } else if (cbh.mIsLogicalCameraCallback) {
+            // Only copy the physical camera results for callbacks that receive them
+            sp<ACameraPhysicalCaptureResultInfo> physicalResult(
+                    new ACameraPhysicalCaptureResultInfo(*physicalResults, frameNumber));
             msg->setPointer(kCallbackFpKey,
                     (void *)cbh.mOnLogicalCameraCaptureCompleted);
             msg->setObject(kPhysicalCaptureResultKey, physicalResult);
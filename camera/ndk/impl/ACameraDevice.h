@@ -343,6 +343,12 @@ class CameraDevice final : public RefBase {
     int32_t mPartialResultCount;  // const after constructor
     std::vector<std::string> mPhysicalIds; // const after constructor
 
+    // Complete results arrive as deltas from the previous ones, which are kept here to
+    // reconstruct them. Protected by mDeviceLock.
+    bool mResultDeltaEnabled = false;
+    CameraMetadata mLastResult;
+    std::map<String16, CameraMetadata> mLastPhysicalResults;
+
 };
 
 } // namespace acam;
@@ -42,6 +42,13 @@ ACameraMetadata::ACameraMetadata(camera_metadata_t* buffer, ACAMERA_METADATA_TYP
         filterDurations(ANDROID_DEPTH_AVAILABLE_DYNAMIC_DEPTH_STALL_DURATIONS);
     }
     // TODO: filter request/result keys
+
+    // Characteristics and results are read only from here on. Entries appended by the
+    // framework (or the filters above) leave the buffer unsorted, which turns every
+    // getConstEntry into a linear scan; sort once so that lookups are binary searches.
+    if (mType != ACM_REQUEST) {
+        mData.sort();
+    }
 }
 
 bool
@@ -345,7 +352,8 @@ ACameraMetadata::getConstEntry(uint32_t tag, ACameraMetadata_const_entry* entry)
 
     camera_metadata_ro_entry rawEntry = mData.find(tag);
     if (rawEntry.count == 0) {
-        ALOGE("%s: cannot find metadata tag %d", __FUNCTION__, tag);
+        // Apps commonly probe for optional tags, don't spam the log for each one
+        ALOGV("%s: cannot find metadata tag %d", __FUNCTION__, tag);
         return ACAMERA_ERROR_METADATA_NOT_FOUND;
     }
     entry->tag = tag;
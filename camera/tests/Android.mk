@@ -18,6 +18,7 @@ LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
 
 LOCAL_SRC_FILES:= \
 	VendorTagDescriptorTests.cpp \
+	CameraMetadataDeltaTests.cpp \
 	CameraBinderTests.cpp \
 	CameraZSLTests.cpp \
 	CameraCharacteristicsPermission.cpp
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "CameraMetadataDeltaTests"
+
+#include <camera/CameraMetadata.h>
+#include <system/camera_metadata.h>
+#include <utils/Errors.h>
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace android;
+
+static CameraMetadata makeResult(int64_t timestamp, int32_t afState, bool withFaces) {
+    CameraMetadata result;
+    result.update(ANDROID_SENSOR_TIMESTAMP, &timestamp, 1);
+    const int64_t exposureTime = 33000000;
+    result.update(ANDROID_SENSOR_EXPOSURE_TIME, &exposureTime, 1);
+    const uint8_t state = afState;
+    result.update(ANDROID_CONTROL_AF_STATE, &state, 1);
+    if (withFaces) {
+        const int32_t faceRect[] = { 10, 20, 110, 220 };
+        result.update(ANDROID_STATISTICS_FACE_RECTANGLES, faceRect, 4);
+    }
+    result.sort();
+    return result;
+}
+
+TEST(CameraMetadataDeltaTest, OnlyChangedTags) {
+    CameraMetadata first = makeResult(1000, ANDROID_CONTROL_AF_STATE_INACTIVE, false);
+    CameraMetadata second = makeResult(2000, ANDROID_CONTROL_AF_STATE_INACTIVE, false);
+
+    CameraMetadata delta;
+    ASSERT_EQ(OK, second.getDelta(first, &delta));
+    EXPECT_EQ(1u, delta.entryCount());
+    camera_metadata_ro_entry entry = delta.find(ANDROID_SENSOR_TIMESTAMP);
+    ASSERT_EQ(1u, entry.count);
+    EXPECT_EQ(2000, entry.data.i64[0]);
+
+    // against nothing, the delta is the whole result
+    ASSERT_EQ(OK, first.getDelta(CameraMetadata(), &delta));
+    EXPECT_EQ(first.entryCount(), delta.entryCount());
+}
+
+TEST(CameraMetadataDeltaTest, Reconstruct) {
+    const CameraMetadata results[] = {
+        makeResult(1000, ANDROID_CONTROL_AF_STATE_INACTIVE, false),
+        makeResult(2000, ANDROID_CONTROL_AF_STATE_PASSIVE_SCAN, true),
+        makeResult(3000, ANDROID_CONTROL_AF_STATE_PASSIVE_SCAN, true),
+        makeResult(4000, ANDROID_CONTROL_AF_STATE_PASSIVE_FOCUSED, false),
+    };
+
+    CameraMetadata sent;
+    CameraMetadata received;
+    for (const CameraMetadata& result : results) {
+        CameraMetadata delta;
+        ASSERT_EQ(OK, result.getDelta(sent, &delta));
+        sent = result;
+        ASSERT_EQ(OK, received.applyDelta(delta));
+
+        ASSERT_EQ(result.entryCount(), received.entryCount());
+        const camera_metadata_t* buffer = result.getAndLock();
+        for (size_t i = 0; i < result.entryCount(); i++) {
+            camera_metadata_ro_entry expected;
+            ASSERT_EQ(OK, get_camera_metadata_ro_entry(buffer, i, &expected));
+            camera_metadata_ro_entry entry = received.find(expected.tag);
+            ASSERT_EQ(expected.count, entry.count) << "tag " << expected.tag;
+            EXPECT_EQ(0, memcmp(expected.data.u8, entry.data.u8,
+                    camera_metadata_type_size[expected.type] * expected.count))
+                    << "tag " << expected.tag;
+        }
+        result.unlock(buffer);
+    }
+    // the faces went away with the last result
+    EXPECT_FALSE(received.exists(ANDROID_STATISTICS_FACE_RECTANGLES));
+}
@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput and latency of the media framework building blocks: extractor
+// open, seek and read, decoding through MediaCodec, the audio mixer and resamplers, color
+// conversion and MPEG4 writing. Each result is printed as one JSON object per line, so
+// that the output of two builds on the same device can be compared line by line.
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "mediabench"
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/AudioBufferProvider.h>
+#include <media/AudioMixer.h>
+#include <media/AudioResampler.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaMuxer.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+using namespace android;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+constexpr size_t kNumSeeks = 32;
+constexpr int64_t kCodecTimeoutUs = 10000ll;
+
+constexpr uint32_t kMixerSampleRate = 48000;
+constexpr size_t kMixerFrameCount = 960;        // 20 ms, as a normal mixer period
+constexpr size_t kMixerCycles = 2000;
+constexpr size_t kResamplerFrames = 48000 * 10;
+constexpr size_t kColorConvertFrames = 60;
+constexpr size_t kWriterSamples = 900;          // 30 s at 30 fps
+constexpr size_t kWriterSampleSize = 64 * 1024;
+
+struct Options {
+    size_t runs = 3;
+    std::string tmpDir = "/data/local/tmp";
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string fileName(const std::string &path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Prints a result as a JSON object on one line. Of the results of several runs, the best
+// one is reported, as it is the least disturbed by the rest of the system.
+void report(const char *benchmark, const std::string &config,
+            std::vector<double> values, const char *unit, bool lowerIsBetter) {
+    if (values.empty()) {
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    const double best = lowerIsBetter ? values.front() : values.back();
+    const double median = values[values.size() / 2];
+    printf("{\"benchmark\":\"%s\",\"config\":\"%s\",\"runs\":%zu,"
+           "\"value\":%.3f,\"median\":%.3f,\"unit\":\"%s\"}\n",
+           benchmark, config.c_str(), values.size(), best, median, unit);
+    fflush(stdout);
+}
+
+void reportError(const char *benchmark, const std::string &config, status_t err) {
+    printf("{\"benchmark\":\"%s\",\"config\":\"%s\",\"error\":%d}\n",
+           benchmark, config.c_str(), err);
+    fflush(stdout);
+}
+
+status_t openExtractor(const std::string &path, sp<NuMediaExtractor> *extractor) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    status_t err = fstat(fd, &st) == 0 ? OK : -errno;
+    if (err == OK) {
+        *extractor = new NuMediaExtractor;
+        // the extractor duplicates the descriptor
+        err = (*extractor)->setDataSource(fd, 0, st.st_size);
+    }
+    close(fd);
+    return err;
+}
+
+std::string containerOf(const sp<NuMediaExtractor> &extractor) {
+    sp<AMessage> format;
+    AString mime;
+    if (extractor->getFileFormat(&format) == OK && format->findString("mime", &mime)) {
+        return mime.c_str();
+    }
+    return "unknown";
+}
+
+// Returns the first video track, or the first track if there is no video.
+ssize_t mainTrack(const sp<NuMediaExtractor> &extractor, sp<AMessage> *format) {
+    ssize_t found = -1;
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<AMessage> trackFormat;
+        AString mime;
+        if (extractor->getTrackFormat(i, &trackFormat) != OK
+                || !trackFormat->findString("mime", &mime)) {
+            continue;
+        }
+        if (found < 0 || !strncasecmp(mime.c_str(), "video/", 6)) {
+            found = i;
+            *format = trackFormat;
+            if (!strncasecmp(mime.c_str(), "video/", 6)) {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+void benchExtractor(const Options &options, const std::string &path) {
+    std::string config = fileName(path);
+    std::vector<double> openUs, seekUs, readRate;
+    for (size_t run = 0; run < options.runs; ++run) {
+        const Clock::time_point start = Clock::now();
+        sp<NuMediaExtractor> extractor;
+        status_t err = openExtractor(path, &extractor);
+        sp<AMessage> format;
+        const ssize_t track = err == OK ? mainTrack(extractor, &format) : -1;
+        if (track < 0) {
+            reportError("extractor.open", config, err == OK ? ERROR_UNSUPPORTED : err);
+            return;
+        }
+        openUs.push_back(secondsSince(start) * 1E6);
+        if (run == 0) {
+            config += " " + containerOf(extractor);
+        }
+        if ((err = extractor->selectTrack(track)) != OK) {
+            reportError("extractor.seek", config, err);
+            return;
+        }
+
+        // read the whole track
+        sp<ABuffer> buffer = new ABuffer(8 * 1024 * 1024);
+        size_t samples = 0;
+        const Clock::time_point readStart = Clock::now();
+        while (extractor->readSampleData(buffer) == OK) {
+            ++samples;
+            extractor->advance();
+        }
+        const double readSeconds = secondsSince(readStart);
+        if (samples > 0 && readSeconds > 0) {
+            readRate.push_back(samples / readSeconds);
+        }
+
+        // seek to spread out positions in an order that defeats read ahead
+        int64_t durationUs;
+        if (!format->findInt64("durationUs", &durationUs) || durationUs <= 0) {
+            continue;
+        }
+        const Clock::time_point seekStart = Clock::now();
+        size_t seeks = 0;
+        for (size_t i = 0; i < kNumSeeks; ++i) {
+            const size_t position = (i * 13) % kNumSeeks;  // 13 is coprime with kNumSeeks
+            if (extractor->seekTo(durationUs * (int64_t)position / (int64_t)kNumSeeks) == OK
+                    && extractor->readSampleData(buffer) == OK) {
+                ++seeks;
+            }
+        }
+        if (seeks > 0) {
+            seekUs.push_back(secondsSince(seekStart) * 1E6 / seeks);
+        }
+    }
+    report("extractor.open", config, openUs, "us", true);
+    report("extractor.seek", config, seekUs, "us", true);
+    report("extractor.read", config, readRate, "samples/s", false);
+}
+
+// Decodes the main track of |path| to memory and returns the decoded frames per second.
+status_t decodeOnce(const std::string &path, const sp<ALooper> &looper, double *rate,
+                    std::string *mimeOut) {
+    sp<NuMediaExtractor> extractor;
+    status_t err = openExtractor(path, &extractor);
+    if (err != OK) {
+        return err;
+    }
+    sp<AMessage> format;
+    const ssize_t track = mainTrack(extractor, &format);
+    AString mime;
+    if (track < 0 || !format->findString("mime", &mime)) {
+        return ERROR_UNSUPPORTED;
+    }
+    *mimeOut = mime.c_str();
+    if ((err = extractor->selectTrack(track)) != OK) {
+        return err;
+    }
+
+    sp<MediaCodec> codec = MediaCodec::CreateByType(looper, mime.c_str(), false /* encoder */);
+    if (codec == NULL) {
+        return NAME_NOT_FOUND;
+    }
+    Vector<sp<MediaCodecBuffer>> inBuffers;
+    if ((err = codec->configure(format, NULL /* surface */, NULL /* crypto */, 0)) != OK
+            || (err = codec->start()) != OK
+            || (err = codec->getInputBuffers(&inBuffers)) != OK) {
+        codec->release();
+        return err;
+    }
+
+    const Clock::time_point start = Clock::now();
+    bool sawInputEOS = false;
+    bool sawOutputEOS = false;
+    size_t frames = 0;
+    while (!sawOutputEOS && err == OK) {
+        size_t index;
+        if (!sawInputEOS && codec->dequeueInputBuffer(&index, kCodecTimeoutUs) == OK) {
+            const sp<MediaCodecBuffer> &buffer = inBuffers.itemAt(index);
+            sp<ABuffer> abuffer = new ABuffer(buffer->base(), buffer->capacity());
+            int64_t timeUs = 0;
+            if (extractor->readSampleData(abuffer) == OK
+                    && extractor->getSampleTime(&timeUs) == OK) {
+                buffer->setRange(abuffer->offset(), abuffer->size());
+                err = codec->queueInputBuffer(index, 0, buffer->size(), timeUs, 0);
+                extractor->advance();
+            } else {
+                err = codec->queueInputBuffer(index, 0, 0, 0ll, MediaCodec::BUFFER_FLAG_EOS);
+                sawInputEOS = true;
+            }
+        }
+
+        size_t offset, size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        status_t outErr = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags, kCodecTimeoutUs);
+        if (outErr == OK) {
+            if (size > 0) {
+                ++frames;
+            }
+            sawOutputEOS = (flags & MediaCodec::BUFFER_FLAG_EOS) != 0;
+            err = codec->releaseOutputBuffer(index);
+        } else if (outErr != -EAGAIN && outErr != INFO_FORMAT_CHANGED
+                && outErr != INFO_OUTPUT_BUFFERS_CHANGED) {
+            err = outErr;
+        }
+    }
+    const double seconds = secondsSince(start);
+    codec->release();
+    if (err == OK) {
+        *rate = seconds > 0 ? frames / seconds : 0;
+    }
+    return err;
+}
+
+void benchDecode(const Options &options, const std::string &path) {
+    sp<ALooper> looper = new ALooper;
+    looper->setName("mediabench");
+    looper->start();
+
+    std::string config = fileName(path);
+    std::vector<double> rates;
+    for (size_t run = 0; run < options.runs; ++run) {
+        double rate;
+        std::string mime;
+        status_t err = decodeOnce(path, looper, &rate, &mime);
+        if (run == 0) {
+            config += " " + mime;
+        }
+        if (err != OK) {
+            reportError("decode", config, err);
+            break;
+        }
+        rates.push_back(rate);
+    }
+    looper->stop();
+    report("decode", config, rates, "frames/s", false);
+}
+
+// Provides a sine tone from a buffer it loops over, so that it never runs dry.
+class LoopProvider : public AudioBufferProvider {
+public:
+    LoopProvider(uint32_t channels, uint32_t sampleRate)
+        : mChannels(channels), mOffset(0) {
+        mFrames = sampleRate / 10;
+        mData.resize(mFrames * mChannels);
+        for (size_t i = 0; i < mFrames; ++i) {
+            const int16_t value = (int16_t)(16384 * sin(2 * M_PI * 1000 * i / sampleRate));
+            for (uint32_t c = 0; c < mChannels; ++c) {
+                mData[i * mChannels + c] = value;
+            }
+        }
+    }
+
+    status_t getNextBuffer(Buffer *buffer) override {
+        buffer->frameCount = std::min(buffer->frameCount, mFrames - mOffset);
+        buffer->raw = &mData[mOffset * mChannels];
+        return OK;
+    }
+
+    void releaseBuffer(Buffer *buffer) override {
+        mOffset = (mOffset + buffer->frameCount) % mFrames;
+        buffer->frameCount = 0;
+        buffer->raw = NULL;
+    }
+
+private:
+    const uint32_t mChannels;
+    size_t mFrames;
+    size_t mOffset;
+    std::vector<int16_t> mData;
+};
+
+void benchMixer(const Options &options) {
+    static const size_t kTrackCounts[] = { 1, 4, 8, 16 };
+    static const uint32_t kTrackRates[] = { 48000, 44100 };
+    std::vector<float> output(kMixerFrameCount * 2);
+    for (uint32_t trackRate : kTrackRates) {
+        for (size_t numTracks : kTrackCounts) {
+            const std::string config = "tracks=" + std::to_string(numTracks)
+                    + " rate=" + std::to_string(trackRate);
+            std::vector<double> cycleUs;
+            for (size_t run = 0; run < options.runs; ++run) {
+                std::unique_ptr<AudioMixer> mixer(
+                        new AudioMixer(kMixerFrameCount, kMixerSampleRate));
+                std::vector<std::unique_ptr<LoopProvider>> providers;
+                for (size_t i = 0; i < numTracks; ++i) {
+                    const int name = i;
+                    if (mixer->create(name, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_16_BIT,
+                            AUDIO_SESSION_OUTPUT_MIX) != OK) {
+                        reportError("mixer.cycle", config, BAD_VALUE);
+                        return;
+                    }
+                    providers.emplace_back(new LoopProvider(2, trackRate));
+                    mixer->setBufferProvider(name, providers.back().get());
+                    mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                            output.data());
+                    mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
+                            (void *)(uintptr_t)AUDIO_FORMAT_PCM_FLOAT);
+                    mixer->setParameter(name, AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                            (void *)(uintptr_t)trackRate);
+                    float volume = 1.0f / numTracks;
+                    mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &volume);
+                    mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &volume);
+                    mixer->enable(name);
+                }
+                const Clock::time_point start = Clock::now();
+                for (size_t cycle = 0; cycle < kMixerCycles; ++cycle) {
+                    mixer->process();
+                }
+                cycleUs.push_back(secondsSince(start) * 1E6 / kMixerCycles);
+            }
+            report("mixer.cycle", config, cycleUs, "us", true);
+        }
+    }
+}
+
+void benchResampler(const Options &options) {
+    static const struct {
+        AudioResampler::src_quality quality;
+        const char *name;
+    } kQualities[] = {
+        { AudioResampler::LOW_QUALITY, "low" },
+        { AudioResampler::MED_QUALITY, "med" },
+        { AudioResampler::HIGH_QUALITY, "high" },
+        { AudioResampler::VERY_HIGH_QUALITY, "very_high" },
+        { AudioResampler::DYN_LOW_QUALITY, "dyn_low" },
+        { AudioResampler::DYN_MED_QUALITY, "dyn_med" },
+        { AudioResampler::DYN_HIGH_QUALITY, "dyn_high" },
+    };
+    std::vector<int32_t> output(kMixerFrameCount * 2);
+    for (const auto &entry : kQualities) {
+        const std::string config = std::string("quality=") + entry.name + " 44100->48000";
+        std::vector<double> rates;
+        for (size_t run = 0; run < options.runs; ++run) {
+            std::unique_ptr<AudioResampler> resampler(AudioResampler::create(
+                    AUDIO_FORMAT_PCM_16_BIT, 2, kMixerSampleRate, entry.quality));
+            if (resampler == NULL) {
+                reportError("resampler", config, NO_INIT);
+                break;
+            }
+            resampler->setSampleRate(44100);
+            resampler->setVolume(AudioResampler::UNITY_GAIN_FLOAT,
+                                 AudioResampler::UNITY_GAIN_FLOAT);
+            LoopProvider provider(2, 44100);
+            const Clock::time_point start = Clock::now();
+            for (size_t frames = 0; frames < kResamplerFrames; frames += kMixerFrameCount) {
+                // resample() accumulates
+                memset(output.data(), 0, output.size() * sizeof(output[0]));
+                resampler->resample(output.data(), kMixerFrameCount, &provider);
+            }
+            rates.push_back(kResamplerFrames / secondsSince(start));
+        }
+        report("resampler", config, rates, "frames/s", false);
+    }
+}
+
+void benchColorConvert(const Options &options) {
+    static const struct {
+        OMX_COLOR_FORMATTYPE from;
+        OMX_COLOR_FORMATTYPE to;
+        const char *name;
+        size_t dstBpp;
+    } kConversions[] = {
+        { OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format16bitRGB565, "I420->RGB565", 2 },
+        { OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format32BitRGBA8888, "I420->RGBA8888", 4 },
+        { OMX_COLOR_FormatYUV420SemiPlanar, OMX_COLOR_Format16bitRGB565, "NV12->RGB565", 2 },
+    };
+    static const struct { size_t width, height; } kSizes[] = {
+        { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 },
+    };
+    const size_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (const auto &conversion : kConversions) {
+        for (const auto &size : kSizes) {
+            std::vector<uint8_t> src(size.width * size.height * 3 / 2, 0x80);
+            std::vector<uint8_t> dst(size.width * size.height * conversion.dstBpp);
+            for (size_t threads : { (size_t)1, numThreads }) {
+                const std::string config = std::string(conversion.name) + " "
+                        + std::to_string(size.width) + "x" + std::to_string(size.height)
+                        + " threads=" + std::to_string(threads);
+                ColorConverter converter(conversion.from, conversion.to);
+                if (!converter.isValid()) {
+                    reportError("colorconvert", config, ERROR_UNSUPPORTED);
+                    break;
+                }
+                converter.setNumThreads(threads);
+                std::vector<double> rates;
+                for (size_t run = 0; run < options.runs; ++run) {
+                    const Clock::time_point start = Clock::now();
+                    status_t err = OK;
+                    for (size_t i = 0; i < kColorConvertFrames && err == OK; ++i) {
+                        err = converter.convert(
+                                src.data(), size.width, size.height, size.width,
+                                0, 0, size.width - 1, size.height - 1,
+                                dst.data(), size.width, size.height, size.width,
+                                0, 0, size.width - 1, size.height - 1);
+                    }
+                    if (err != OK) {
+                        reportError("colorconvert", config, err);
+                        rates.clear();
+                        break;
+                    }
+                    rates.push_back(kColorConvertFrames / secondsSince(start));
+                }
+                report("colorconvert", config, rates, "frames/s", false);
+                if (numThreads == 1) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Writes a 30 fps video track of large samples through MediaMuxer, which uses MPEG4Writer.
+status_t writeOnce(const std::string &path, double *rate) {
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -errno;
+    }
+    sp<MediaMuxer> muxer = new MediaMuxer(fd, MediaMuxer::OUTPUT_FORMAT_MPEG_4);
+    close(fd);  // the muxer keeps its own descriptor
+
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", "video/mp4v-es");
+    format->setInt32("width", 1920);
+    format->setInt32("height", 1080);
+    static const uint8_t kVisualObjectSequence[] = { 0x00, 0x00, 0x01, 0xB0, 0x01 };
+    sp<ABuffer> csd = ABuffer::CreateAsCopy(
+            kVisualObjectSequence, sizeof(kVisualObjectSequence));
+    format->setBuffer("csd-0", csd);
+    const ssize_t track = muxer->addTrack(format);
+    if (track < 0) {
+        return track;
+    }
+    status_t err = muxer->start();
+    if (err != OK) {
+        return err;
+    }
+
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < kWriterSamples && err == OK; ++i) {
+        sp<ABuffer> sample = new ABuffer(kWriterSampleSize);
+        memset(sample->data(), i & 0xff, sample->size());
+        err = muxer->writeSampleData(sample, track, i * 1000000ll / 30,
+                i % 30 == 0 ? MediaCodec::BUFFER_FLAG_SYNCFRAME : 0);
+    }
+    status_t stopErr = muxer->stop();
+    const double seconds = secondsSince(start);
+    if (err == OK) {
+        err = stopErr;
+    }
+    if (err == OK) {
+        *rate = kWriterSamples * kWriterSampleSize / seconds / (1024 * 1024);
+    }
+    return err;
+}
+
+void benchWriter(const Options &options) {
+    const std::string path = options.tmpDir + "/mediabench.mp4";
+    const std::string config = "mp4 " + std::to_string(kWriterSampleSize / 1024) + "KB samples";
+    std::vector<double> rates;
+    for (size_t run = 0; run < options.runs; ++run) {
+        double rate;
+        status_t err = writeOnce(path, &rate);
+        if (err != OK) {
+            reportError("writer.mpeg4", config, err);
+            break;
+        }
+        rates.push_back(rate);
+    }
+    unlink(path.c_str());
+    report("writer.mpeg4", config, rates, "MB/s", false);
+}
+
+bool hasBenchmark(const std::string &list, const char *name) {
+    if (list.empty()) {
+        return true;
+    }
+    const std::string item = std::string(",") + name + ",";
+    return ("," + list + ",").find(item) != std::string::npos;
+}
+
+}  // namespace
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [options] [media file ...]\n", me);
+    fprintf(stderr, "       -b comma separated benchmarks to run (default all):\n");
+    fprintf(stderr, "          extractor,decode,mixer,resampler,colorconvert,writer\n");
+    fprintf(stderr, "          extractor and decode run on each media file\n");
+    fprintf(stderr, "       -r runs per benchmark, the best is reported (default 3)\n");
+    fprintf(stderr, "       -d directory for temporary files (default /data/local/tmp)\n");
+    fprintf(stderr, "       -h(elp)\n");
+    fprintf(stderr, "Results are printed one JSON object per line.\n");
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    std::string benchmarks;
+
+    int res;
+    while ((res = getopt(argc, argv, "b:r:d:h")) >= 0) {
+        switch (res) {
+            case 'b':
+                benchmarks = optarg;
+                break;
+            case 'r':
+                options.runs = strtoul(optarg, nullptr, 10);
+                break;
+            case 'd':
+                options.tmpDir = optarg;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.runs == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    for (int i = optind; i < argc; ++i) {
+        if (hasBenchmark(benchmarks, "extractor")) {
+            benchExtractor(options, argv[i]);
+        }
+        if (hasBenchmark(benchmarks, "decode")) {
+            benchDecode(options, argv[i]);
+        }
+    }
+    if (hasBenchmark(benchmarks, "mixer")) {
+        benchMixer(options);
+    }
+    if (hasBenchmark(benchmarks, "resampler")) {
+        benchResampler(options);
+    }
+    if (hasBenchmark(benchmarks, "colorconvert")) {
+        benchColorConvert(options);
+    }
+    if (hasBenchmark(benchmarks, "writer")) {
+        benchWriter(options);
+    }
+    return 0;
+}
@@ -126,31 +126,47 @@ status_t EglWindow::eglSetupContext(bool forPbuffer) {
     };
     EGLint pbufferConfigAttribs[] = {
             EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
-            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
             EGL_RED_SIZE, 8,
             EGL_GREEN_SIZE, 8,
             EGL_BLUE_SIZE, 8,
             EGL_ALPHA_SIZE, 8,
             EGL_NONE
     };
-    result = eglChooseConfig(mEglDisplay,
-            forPbuffer ? pbufferConfigAttribs : windowConfigAttribs,
-            &mEglConfig, 1, &numConfigs);
-    if (result != EGL_TRUE) {
-        ALOGE("eglChooseConfig error: %#x", eglGetError());
-        return UNKNOWN_ERROR;
-    }
 
-    EGLint contextAttribs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
-        EGL_NONE
-    };
-    mEglContext = eglCreateContext(mEglDisplay, mEglConfig, EGL_NO_CONTEXT,
-            contextAttribs);
-    if (mEglContext == EGL_NO_CONTEXT) {
-        ALOGE("eglCreateContext error: %#x", eglGetError());
-        return UNKNOWN_ERROR;
+    // A pbuffer is only used for reading frames back, where GLES 3 allows
+    // doing that without stalling on the GPU, so try for that first.
+    mGlesVersion = forPbuffer ? 3 : 2;
+    for (;;) {
+        if (mGlesVersion == 2) {
+            pbufferConfigAttribs[3] = EGL_OPENGL_ES2_BIT;
+        }
+        result = eglChooseConfig(mEglDisplay,
+                forPbuffer ? pbufferConfigAttribs : windowConfigAttribs,
+                &mEglConfig, 1, &numConfigs);
+        if (result != EGL_TRUE) {
+            ALOGE("eglChooseConfig error: %#x", eglGetError());
+            return UNKNOWN_ERROR;
+        }
+
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_CLIENT_VERSION, mGlesVersion,
+            EGL_NONE
+        };
+        mEglContext = numConfigs > 0
+                ? eglCreateContext(mEglDisplay, mEglConfig, EGL_NO_CONTEXT, contextAttribs)
+                : EGL_NO_CONTEXT;
+        if (mEglContext != EGL_NO_CONTEXT) {
+            break;
+        }
+        if (mGlesVersion == 2) {
+            ALOGE("eglCreateContext error: %#x", eglGetError());
+            return UNKNOWN_ERROR;
+        }
+        ALOGV("no GLES 3 context for pbuffer, falling back to GLES 2");
+        mGlesVersion = 2;
     }
+    ALOGV("Created GLES %d context", mGlesVersion);
 
     return NO_ERROR;
 }
@@ -174,6 +190,7 @@ void EglWindow::eglRelease() {
     mEglContext = EGL_NO_CONTEXT;
     mEglSurface = EGL_NO_SURFACE;
     mEglConfig = NULL;
+    mGlesVersion = 0;
 
     eglReleaseThread();
 }
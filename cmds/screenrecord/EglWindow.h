@@ -37,7 +37,8 @@ public:
         mEglSurface(EGL_NO_SURFACE),
         mEglConfig(NULL),
         mWidth(0),
-        mHeight(0)
+        mHeight(0),
+        mGlesVersion(0)
         {}
     ~EglWindow() { eglRelease(); }
 
@@ -51,6 +52,10 @@ public:
     int getWidth() const { return mWidth; }
     int getHeight() const { return mHeight; }
 
+    // Return the GLES version of the context, 3 if pbuffer readback can be
+    // done through pixel buffer objects.
+    int getGlesVersion() const { return mGlesVersion; }
+
     // Release anything we created.
     void release() { eglRelease(); }
 
@@ -80,6 +85,9 @@ private:
     // Surface dimensions.
     int mWidth;
     int mHeight;
+
+    // Client version of mEglContext.
+    EGLint mGlesVersion;
 };
 
 }; // namespace android
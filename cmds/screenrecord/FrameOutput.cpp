@@ -18,7 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include <GLES2/gl2ext.h>
 
 #include "FrameOutput.h"
@@ -81,6 +81,26 @@ status_t FrameOutput::createInputSurface(int width, int height,
 
     mPixelBuf = new uint8_t[width * height * kGlBytesPerPixel];
 
+    if (mEglWindow.getGlesVersion() >= 3) {
+        // Read back into buffer objects, so that glReadPixels() returns
+        // right away and the GPU copies while we write the previous frame.
+        // They go away with the EGL context.
+        glGenBuffers(kNumPackBuffers, mPackBuffers);
+        for (int i = 0; i < kNumPackBuffers; i++) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, mPackBuffers[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, width * height * kGlBytesPerPixel,
+                    NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        GLenum glErr;
+        if ((glErr = glGetError()) != GL_NO_ERROR) {
+            ALOGW("pixel pack buffers not available (%#x), reading synchronously",
+                    glErr);
+            glDeleteBuffers(kNumPackBuffers, mPackBuffers);
+            memset(mPackBuffers, 0, sizeof(mPackBuffers));
+        }
+    }
+
     *pBufferProducer = producer;
 
     ALOGD("FrameOutput::createInputSurface OK");
@@ -128,6 +148,25 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
         return err;
     }
 
+    if (mPackBuffers[0] != 0) {
+        // Start the copy of this frame, and write out the oldest one still
+        // in flight, which has had a frame time to arrive.
+        glBindBuffer(GL_PIXEL_PACK_BUFFER,
+                mPackBuffers[mPackedFrames % kNumPackBuffers]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        GLenum glErr;
+        if ((glErr = glGetError()) != GL_NO_ERROR) {
+            ALOGE("glReadPixels failed: %#x", glErr);
+            return UNKNOWN_ERROR;
+        }
+        mPackedFrames++;
+        if (mPackedFrames < kNumPackBuffers) {
+            return NO_ERROR;
+        }
+        return writePackBuffer(fp, mPackedFrames % kNumPackBuffers, rawFrames);
+    }
+
     // GLES only guarantees that glReadPixels() will work with GL_RGBA, so we
     // need to get 4 bytes/pixel and reduce it.  Depending on the size of the
     // screen and the device capabilities, this can take a while.
@@ -144,7 +183,7 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
     if (kShowTiming) {
         pixWhenNsec = systemTime(CLOCK_MONOTONIC);
     }
-    reduceRgbaToRgb(mPixelBuf, width * height);
+    reduceRgbaToRgb(mPixelBuf, mPixelBuf, width * height);
     if (kShowTiming) {
         endWhenNsec = systemTime(CLOCK_MONOTONIC);
         ALOGD("got pixels (get=%.3f ms, reduce=%.3fms)",
@@ -152,6 +191,61 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
                 (endWhenNsec - pixWhenNsec) / 1000000.0);
     }
 
+    return writeFrame(fp, rawFrames);
+}
+
+status_t FrameOutput::flushFrames(FILE* fp, bool rawFrames) {
+    if (mPackBuffers[0] == 0) {
+        return NO_ERROR;
+    }
+    uint32_t frame = mPackedFrames < kNumPackBuffers - 1 ?
+            0 : mPackedFrames - (kNumPackBuffers - 1);
+    for (; frame < mPackedFrames; frame++) {
+        status_t err = writePackBuffer(fp, frame % kNumPackBuffers, rawFrames);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    mPackedFrames = 0;
+    return NO_ERROR;
+}
+
+status_t FrameOutput::writePackBuffer(FILE* fp, int index, bool rawFrames) {
+    int width = mEglWindow.getWidth();
+    int height = mEglWindow.getHeight();
+
+    int64_t startWhenNsec, pixWhenNsec, endWhenNsec;
+    if (kShowTiming) {
+        startWhenNsec = systemTime(CLOCK_MONOTONIC);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mPackBuffers[index]);
+    const uint8_t* pixels = (const uint8_t*) glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+            0, width * height * kGlBytesPerPixel, GL_MAP_READ_BIT);
+    if (pixels == NULL) {
+        ALOGE("glMapBufferRange failed: %#x", glGetError());
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return UNKNOWN_ERROR;
+    }
+    if (kShowTiming) {
+        pixWhenNsec = systemTime(CLOCK_MONOTONIC);
+    }
+    // Reduce out of the mapping, which is the only pass over the pixels.
+    reduceRgbaToRgb(mPixelBuf, pixels, width * height);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (kShowTiming) {
+        endWhenNsec = systemTime(CLOCK_MONOTONIC);
+        ALOGD("got pixels (map=%.3f ms, reduce=%.3fms)",
+                (pixWhenNsec - startWhenNsec) / 1000000.0,
+                (endWhenNsec - pixWhenNsec) / 1000000.0);
+    }
+
+    return writeFrame(fp, rawFrames);
+}
+
+status_t FrameOutput::writeFrame(FILE* fp, bool rawFrames) {
+    int width = mEglWindow.getWidth();
+    int height = mEglWindow.getHeight();
     size_t rgbDataLen = width * height * kOutBytesPerPixel;
 
     if (!rawFrames) {
@@ -170,6 +264,7 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
     // Currently using buffered I/O rather than writev().  Not expecting it
     // to make much of a difference, but it might be worth a test for larger
     // frame sizes.
+    int64_t startWhenNsec, endWhenNsec;
     if (kShowTiming) {
         startWhenNsec = systemTime(CLOCK_MONOTONIC);
     }
@@ -190,18 +285,18 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
     return NO_ERROR;
 }
 
-void FrameOutput::reduceRgbaToRgb(uint8_t* buf, unsigned int pixelCount) {
+void FrameOutput::reduceRgbaToRgb(uint8_t* dst, const uint8_t* src,
+        unsigned int pixelCount) {
     // Convert RGBA to RGB.
     //
     // Unaligned 32-bit accesses are allowed on ARM, so we could do this
     // with 32-bit copies advancing at different rates (taking care at the
     // end to not go one byte over).
-    const uint8_t* readPtr = buf;
     for (unsigned int i = 0; i < pixelCount; i++) {
-        *buf++ = *readPtr++;
-        *buf++ = *readPtr++;
-        *buf++ = *readPtr++;
-        readPtr++;
+        *dst++ = *src++;
+        *dst++ = *src++;
+        *dst++ = *src++;
+        src++;
     }
 }
 
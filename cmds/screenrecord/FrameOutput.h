@@ -23,6 +23,8 @@
 #include <gui/BufferQueue.h>
 #include <gui/GLConsumer.h>
 
+#include <string.h>
+
 namespace android {
 
 /*
@@ -32,8 +34,11 @@ class FrameOutput : public GLConsumer::FrameAvailableListener {
 public:
     FrameOutput() : mFrameAvailable(false),
         mExtTextureName(0),
-        mPixelBuf(NULL)
-        {}
+        mPixelBuf(NULL),
+        mPackedFrames(0)
+        {
+            memset(mPackBuffers, 0, sizeof(mPackBuffers));
+        }
 
     // Create an "input surface", similar in purpose to a MediaCodec input
     // surface, that the virtual display can send buffers to.  Also configures
@@ -45,8 +50,14 @@ public:
     // specified number of microseconds.
     //
     // Returns ETIMEDOUT if the timeout expired before we found a frame.
+    //
+    // With GLES 3 the pixels are read back asynchronously, and a frame is
+    // written out a frame later; call flushFrames() after the last one.
     status_t copyFrame(FILE* fp, long timeoutUsec, bool rawFrames);
 
+    // Write out the frames still being read back.
+    status_t flushFrames(FILE* fp, bool rawFrames);
+
     // Prepare to copy frames.  Makes the EGL context used by this object current.
     void prepareToCopy() {
         mEglWindow.makeCurrent();
@@ -64,8 +75,15 @@ private:
     // (overrides GLConsumer::FrameAvailableListener method)
     virtual void onFrameAvailable(const BufferItem& item);
 
-    // Reduces RGBA to RGB, in place.
-    static void reduceRgbaToRgb(uint8_t* buf, unsigned int pixelCount);
+    // Reduces RGBA to RGB.  |dst| may be the same as |src|.
+    static void reduceRgbaToRgb(uint8_t* dst, const uint8_t* src,
+            unsigned int pixelCount);
+
+    // Reduces the frame in pack buffer |index| to RGB and writes it out.
+    status_t writePackBuffer(FILE* fp, int index, bool rawFrames);
+
+    // Writes one frame of RGB data in mPixelBuf, with a header unless raw.
+    status_t writeFrame(FILE* fp, bool rawFrames);
 
     // Put a 32-bit value into a buffer, in little-endian byte order.
     static void setValueLE(uint8_t* buf, uint32_t value);
@@ -92,6 +110,15 @@ private:
 
     // Pixel data buffer.
     uint8_t* mPixelBuf;
+
+    // Pixel buffer objects the frames are read back into, each one reduced
+    // and written out while the next ones are in flight.  Not used (0) if
+    // the context does not support GLES 3.
+    static const int kNumPackBuffers = 2;
+    GLuint mPackBuffers[kNumPackBuffers];
+
+    // Frames read back into the pack buffers so far.
+    uint32_t mPackedFrames;
 };
 
 }; // namespace android
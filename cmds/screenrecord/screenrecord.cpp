@@ -749,6 +749,7 @@ static status_t recordScreen(const char* fileName) {
         // TODO: figure out if we can eliminate this
         frameOutput->prepareToCopy();
 
+        bool rawFrames = gOutputFormat == FORMAT_RAW_FRAMES;
         while (!gStopRequested) {
             // Poll for frames, the same way we do for MediaCodec.  We do
             // all of the work on the main thread.
@@ -757,7 +758,6 @@ static status_t recordScreen(const char* fileName) {
             // stop was requested, but this will do for now.  (It almost
             // works because wait() wakes when a signal hits, but we
             // need to handle the edge cases.)
-            bool rawFrames = gOutputFormat == FORMAT_RAW_FRAMES;
             err = frameOutput->copyFrame(rawFp, 250000, rawFrames);
             if (err == ETIMEDOUT) {
                 err = NO_ERROR;
@@ -766,6 +766,10 @@ static status_t recordScreen(const char* fileName) {
                 break;
             }
         }
+        if (err == NO_ERROR) {
+            // Frames read back asynchronously are written a frame late.
+            err = frameOutput->flushFrames(rawFp, rawFrames);
+        }
     } else {
         // Main encoder loop.
         err = runEncoder(encoder, muxer, rawFp, mainDpy, dpy,
@@ -18,6 +18,8 @@
 #define LOG_TAG "CryptoHal"
 #include <utils/Log.h>
 
+#include <inttypes.h>
+
 #include <android/hardware/drm/1.0/types.h>
 #include <android/hidl/manager/1.0/IServiceManager.h>
 
@@ -29,6 +31,7 @@
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/MediaErrors.h>
 #include <mediadrm/CryptoHal.h>
+#include <utils/Timers.h>
 
 using drm::V1_0::BufferType;
 using drm::V1_0::DestinationBuffer;
@@ -269,10 +272,13 @@ int32_t CryptoHal::setHeapBase(const sp<IMemoryHeap>& heap) {
     Mutex::Autolock autoLock(mLock);
 
     int32_t seqNum = mHeapSeqNum++;
+    nsecs_t startTime = systemTime();
     sp<HidlMemory> hidlMemory = fromHeap(heap);
     mHeapBases.add(seqNum, HeapBase(mNextBufferId, heap->getSize()));
     Return<void> hResult = mPlugin->setSharedBufferBase(*hidlMemory, mNextBufferId++);
     ALOGE_IF(!hResult.isOk(), "setSharedBufferBase(): remote call failed");
+    ALOGV("setHeapBase(): heap %d (%zu bytes) registered in %" PRId64 " us, %zu heaps set",
+            seqNum, heap->getSize(), ns2us(systemTime() - startTime), mHeapBases.size());
     return seqNum;
 }
 
@@ -311,12 +317,14 @@ status_t CryptoHal::toSharedBuffer(const sp<IMemory>& memory, int32_t seqNum, ::
     }
 
     // memory must be in one of the heaps that have been set
-    if (mHeapBases.indexOfKey(seqNum) < 0) {
+    ssize_t heapIndex = mHeapBases.indexOfKey(seqNum);
+    if (heapIndex < 0) {
         return UNKNOWN_ERROR;
     }
+    const HeapBase& heapBase = mHeapBases.valueAt(heapIndex);
 
     // heap must be the same size as the one that was set in setHeapBase
-    if (mHeapBases.valueFor(seqNum).getSize() != heap->getSize()) {
+    if (heapBase.getSize() != heap->getSize()) {
         android_errorWriteLog(0x534e4554, "76221123");
         return UNKNOWN_ERROR;
      }
@@ -329,7 +337,7 @@ status_t CryptoHal::toSharedBuffer(const sp<IMemory>& memory, int32_t seqNum, ::
         return UNKNOWN_ERROR;
     }
 
-    buffer->bufferId = mHeapBases.valueFor(seqNum).getBufferId();
+    buffer->bufferId = heapBase.getBufferId();
     buffer->offset = offset >= 0 ? offset : 0;
     buffer->size = size;
     return OK;
@@ -368,14 +376,13 @@ ssize_t CryptoHal::decrypt(const uint8_t keyId[16], const uint8_t iv[16],
     hPattern.encryptBlocks = pattern.mEncryptBlocks;
     hPattern.skipBlocks = pattern.mSkipBlocks;
 
-    std::vector<SubSample> stdSubSamples;
+    // Fill the HIDL vector in place, a sample can have hundreds of subsamples
+    hidl_vec<SubSample> hSubSamples;
+    hSubSamples.resize(numSubSamples);
     for (size_t i = 0; i < numSubSamples; i++) {
-        SubSample subSample;
-        subSample.numBytesOfClearData = subSamples[i].mNumBytesOfClearData;
-        subSample.numBytesOfEncryptedData = subSamples[i].mNumBytesOfEncryptedData;
-        stdSubSamples.push_back(subSample);
+        hSubSamples[i].numBytesOfClearData = subSamples[i].mNumBytesOfClearData;
+        hSubSamples[i].numBytesOfEncryptedData = subSamples[i].mNumBytesOfEncryptedData;
     }
-    auto hSubSamples = hidl_vec<SubSample>(stdSubSamples);
 
     int32_t heapSeqNum = source.mHeapSeqNum;
     bool secure;
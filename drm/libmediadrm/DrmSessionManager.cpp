@@ -141,23 +141,32 @@ void DrmSessionManager::removeDrm(const sp<DrmSessionClientInterface>& drm) {
 bool DrmSessionManager::reclaimSession(int callingPid) {
     ALOGV("reclaimSession(%d)", callingPid);
 
-    sp<DrmSessionClientInterface> drm;
-    Vector<uint8_t> sessionId;
+    // Process priorities come from a binder call per pid, so they are queried
+    // without holding mLock, which every decrypt takes through useSession().
+    Vector<int> pids;
+    {
+        Mutex::Autolock lock(mLock);
+        getSessionPids_l(&pids);
+    }
+
+    int callingPriority;
+    if (!mProcessInfo->getPriority(callingPid, &callingPriority)) {
+        return false;
+    }
     int lowestPriorityPid;
     int lowestPriority;
+    if (!getLowestPriority(pids, &lowestPriorityPid, &lowestPriority)) {
+        return false;
+    }
+    if (lowestPriority <= callingPriority) {
+        return false;
+    }
+
+    sp<DrmSessionClientInterface> drm;
+    Vector<uint8_t> sessionId;
     {
         Mutex::Autolock lock(mLock);
-        int callingPriority;
-        if (!mProcessInfo->getPriority(callingPid, &callingPriority)) {
-            return false;
-        }
-        if (!getLowestPriority_l(&lowestPriorityPid, &lowestPriority)) {
-            return false;
-        }
-        if (lowestPriority <= callingPriority) {
-            return false;
-        }
-
+        // the sessions of that pid may have been closed in the meantime.
         if (!getLeastUsedSession_l(lowestPriorityPid, &drm, &sessionId)) {
             return false;
         }
@@ -177,15 +186,29 @@ int64_t DrmSessionManager::getTime_l() {
     return mTime++;
 }
 
-bool DrmSessionManager::getLowestPriority_l(int* lowestPriorityPid, int* lowestPriority) {
-    int pid = -1;
-    int priority = -1;
+void DrmSessionManager::getSessionPids_l(Vector<int>* pids) const {
+    pids->clear();
     for (size_t i = 0; i < mSessionMap.size(); ++i) {
         if (mSessionMap.valueAt(i).size() == 0) {
             // no opened session by this process.
             continue;
         }
-        int tempPid = mSessionMap.keyAt(i);
+        pids->push_back(mSessionMap.keyAt(i));
+    }
+}
+
+bool DrmSessionManager::getLowestPriority_l(int* lowestPriorityPid, int* lowestPriority) {
+    Vector<int> pids;
+    getSessionPids_l(&pids);
+    return getLowestPriority(pids, lowestPriorityPid, lowestPriority);
+}
+
+bool DrmSessionManager::getLowestPriority(
+        const Vector<int>& pids, int* lowestPriorityPid, int* lowestPriority) {
+    int pid = -1;
+    int priority = -1;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        int tempPid = pids[i];
         int tempPriority;
         if (!mProcessInfo->getPriority(tempPid, &tempPriority)) {
             // shouldn't happen.
@@ -28,6 +28,10 @@
 #include <media/stagefright/MediaErrors.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 android::CasFactory* createCasFactory() {
     return new android::clearkeycas::ClearKeyCasFactory();
 }
@@ -42,6 +46,12 @@ namespace clearkeycas {
 
 static const int32_t sClearKeySystemId = 0xF6D8;
 
+// Descramble calls carrying at least this many bytes are split across threads.
+// TS packets are descrambled independently, so the subsamples of a large access
+// unit can be processed in parallel; below this a thread costs more than it saves.
+static const size_t kMinParallelDecryptBytes = 512 * 1024;
+static const size_t kMaxDecryptThreads = 4;
+
 bool ClearKeyCasFactory::isSystemIdSupported(int32_t CA_system_id) const {
     return CA_system_id == sClearKeySystemId;
 }
@@ -339,7 +349,10 @@ status_t ClearKeyCasSession::updateECM(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock _lock(mKeyLock);
+    // ECMs are serialized by mEcmLock. mKeyLock is held only to publish the new
+    // keys, so that descrambling with the current keys does not wait for the ECM
+    // to be parsed and the key schedules to be expanded.
+    Mutex::Autolock _lock(mEcmLock);
 
     if (mEcmBuffer != NULL && mEcmBuffer->capacity() == size
             && !memcmp(mEcmBuffer->base(), ecm, size)) {
@@ -358,21 +371,30 @@ status_t ClearKeyCasSession::updateECM(
     }
 
     ALOGV("updateECM: %zu key(s) found", keys.size());
-    for (size_t keyIndex = 0; keyIndex < keys.size(); keyIndex++) {
-        String8 str;
-
+    KeyInfo nextKeyInfo[kNumKeys];
+    const size_t numKeys = keys.size();
+    if (numKeys > kNumKeys) {
+        ALOGE("updateECM: too many keys (%zu)", numKeys);
+        return BAD_VALUE;
+    }
+    for (size_t keyIndex = 0; keyIndex < numKeys; keyIndex++) {
         const sp<ABuffer>& keyBytes = keys[keyIndex].key_bytes;
         CHECK(keyBytes->size() == kUserKeyLength);
 
         int result = AES_set_decrypt_key(
                 reinterpret_cast<const uint8_t*>(keyBytes->data()),
-                AES_BLOCK_SIZE * 8, &mKeyInfo[keyIndex].contentKey);
-        mKeyInfo[keyIndex].valid = (result == 0);
-        if (!mKeyInfo[keyIndex].valid) {
+                AES_BLOCK_SIZE * 8, &nextKeyInfo[keyIndex].contentKey);
+        nextKeyInfo[keyIndex].valid = (result == 0);
+        if (!nextKeyInfo[keyIndex].valid) {
             ALOGE("updateECM: failed to set key %zu, key_id=%d",
                     keyIndex, keys[keyIndex].key_id);
         }
     }
+
+    Mutex::Autolock _keyLock(mKeyLock);
+    for (size_t keyIndex = 0; keyIndex < numKeys; keyIndex++) {
+        mKeyInfo[keyIndex] = nextKeyInfo[keyIndex];
+    }
     return OK;
 }
 
@@ -402,22 +424,75 @@ ssize_t ClearKeyCasSession::decrypt(
         contentKey = mKeyInfo[keyIndex].contentKey;
     }
 
-    uint8_t *src = (uint8_t*)srcPtr;
+    const bool scrambled =
+            scramblingControl != DescramblerPlugin::kScrambling_Unscrambled;
+    const uint8_t *src = (const uint8_t*)srcPtr;
     uint8_t *dst = (uint8_t*)dstPtr;
 
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < numSubSamples; i++) {
+        totalBytes += subSamples[i].mNumBytesOfClearData
+                + subSamples[i].mNumBytesOfEncryptedData;
+    }
+
+    size_t numThreads = 1;
+    if (scrambled && totalBytes >= kMinParallelDecryptBytes) {
+        numThreads = std::min({ kMaxDecryptThreads,
+                (size_t)std::max(std::thread::hardware_concurrency(), 1u),
+                numSubSamples });
+    }
+
+    if (numThreads <= 1) {
+        decryptSubSamples(contentKey, scrambled, numSubSamples, subSamples, src, dst);
+        return totalBytes;
+    }
+
+    // Hand each thread a contiguous run of subsamples of about the same size.
+    std::vector<std::thread> threads;
+    const size_t bytesPerThread = (totalBytes + numThreads - 1) / numThreads;
+    size_t first = 0;
+    size_t offset = 0;
+    while (first < numSubSamples) {
+        size_t last = first;
+        size_t bytes = 0;
+        while (last < numSubSamples && (bytes < bytesPerThread || last == first)) {
+            bytes += subSamples[last].mNumBytesOfClearData
+                    + subSamples[last].mNumBytesOfEncryptedData;
+            ++last;
+        }
+        if (last == numSubSamples) {
+            // run the final range on the calling thread
+            decryptSubSamples(contentKey, scrambled, last - first, subSamples + first,
+                    src + offset, dst + offset);
+        } else {
+            threads.emplace_back(&ClearKeyCasSession::decryptSubSamples, this,
+                    std::cref(contentKey), scrambled, last - first, subSamples + first,
+                    src + offset, dst + offset);
+        }
+        offset += bytes;
+        first = last;
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return totalBytes;
+}
+
+void ClearKeyCasSession::decryptSubSamples(
+        const AES_KEY& key, bool scrambled, size_t numSubSamples,
+        const DescramblerPlugin::SubSample *subSamples,
+        const uint8_t *src, uint8_t *dst) const {
     for (size_t i = 0; i < numSubSamples; i++) {
         size_t numBytesinSubSample = subSamples[i].mNumBytesOfClearData
                 + subSamples[i].mNumBytesOfEncryptedData;
         if (src != dst) {
             memcpy(dst, src, numBytesinSubSample);
         }
-        status_t err = OK;
         // Don't decrypt if len < AES_BLOCK_SIZE.
         // The last chunk shorter than AES_BLOCK_SIZE is not encrypted.
-        if (scramblingControl != DescramblerPlugin::kScrambling_Unscrambled
-                && subSamples[i].mNumBytesOfEncryptedData >= AES_BLOCK_SIZE) {
-            err = decryptPayload(
-                    contentKey,
+        if (scrambled && subSamples[i].mNumBytesOfEncryptedData >= AES_BLOCK_SIZE) {
+            (void)decryptPayload(
+                    key,
                     numBytesinSubSample,
                     subSamples[i].mNumBytesOfClearData,
                     (char *)dst);
@@ -426,7 +501,6 @@ ssize_t ClearKeyCasSession::decrypt(
         dst += numBytesinSubSample;
         src += numBytesinSubSample;
     }
-    return dst - (uint8_t *)dstPtr;
 }
 
 // Decryption of a TS payload
@@ -55,7 +55,8 @@ private:
         bool valid;
         AES_KEY contentKey;
     };
-    sp<ABuffer> mEcmBuffer;
+    Mutex mEcmLock;
+    sp<ABuffer> mEcmBuffer;     // guarded by mEcmLock
     Mutex mKeyLock;
     CasPlugin* mPlugin;
     KeyInfo mKeyInfo[kNumKeys];
@@ -65,6 +66,10 @@ private:
     CasPlugin* getPlugin() const { return mPlugin; }
     status_t decryptPayload(
             const AES_KEY& key, size_t length, size_t offset, char* buffer) const;
+    void decryptSubSamples(
+            const AES_KEY& key, bool scrambled, size_t numSubSamples,
+            const DescramblerPlugin::SubSample *subSamples,
+            const uint8_t *src, uint8_t *dst) const;
 
     DISALLOW_EVIL_CONSTRUCTORS(ClearKeyCasSession);
 };
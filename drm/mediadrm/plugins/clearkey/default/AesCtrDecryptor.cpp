@@ -18,52 +18,59 @@
 #define LOG_TAG "ClearKeyCryptoPlugin"
 #include <utils/Log.h>
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 
 #include "AesCtrDecryptor.h"
 
 namespace clearkeydrm {
 
-static const size_t kBlockBitCount = kBlockSize * 8;
-
 android::status_t AesCtrDecryptor::decrypt(const android::Vector<uint8_t>& key,
         const Iv iv, const uint8_t* source,
         uint8_t* destination,
         const SubSample* subSamples,
         size_t numSubSamples,
         size_t* bytesDecryptedOut) {
-    uint32_t blockOffset = 0;
-    uint8_t previousEncryptedCounter[kBlockSize];
-    memset(previousEncryptedCounter, 0, kBlockSize);
-
     if (key.size() != kBlockSize || (sizeof(Iv) / sizeof(uint8_t)) != kBlockSize) {
         android_errorWriteLog(0x534e4554, "63982768");
         return android::ERROR_DRM_DECRYPT;
     }
 
-    size_t offset = 0;
-    AES_KEY opensslKey;
-    AES_set_encrypt_key(key.array(), kBlockBitCount, &opensslKey);
-    Iv opensslIv;
-    memcpy(opensslIv, iv, sizeof(opensslIv));
+    // The EVP interface uses the pipelined hardware AES-CTR routines (ARMv8 crypto
+    // extensions, AES-NI) where available, unlike AES_ctr128_encrypt which encrypts
+    // one counter block per call. The keystream carries over between subsamples.
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx == nullptr ||
+            EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), nullptr, key.array(), iv) != 1) {
+        ALOGE("Failed to set up AES-CTR decryption");
+        EVP_CIPHER_CTX_free(ctx);
+        return android::ERROR_DRM_DECRYPT;
+    }
 
+    size_t offset = 0;
     for (size_t i = 0; i < numSubSamples; ++i) {
         const SubSample& subSample = subSamples[i];
 
         if (subSample.mNumBytesOfClearData > 0) {
-            memcpy(destination + offset, source + offset,
-                    subSample.mNumBytesOfClearData);
+            if (destination != source) {
+                memcpy(destination + offset, source + offset,
+                        subSample.mNumBytesOfClearData);
+            }
             offset += subSample.mNumBytesOfClearData;
         }
 
         if (subSample.mNumBytesOfEncryptedData > 0) {
-            AES_ctr128_encrypt(source + offset, destination + offset,
-                    subSample.mNumBytesOfEncryptedData, &opensslKey,
-                    opensslIv, previousEncryptedCounter,
-                    &blockOffset);
+            int bytesOut = 0;
+            if (EVP_EncryptUpdate(ctx, destination + offset, &bytesOut, source + offset,
+                    subSample.mNumBytesOfEncryptedData) != 1 ||
+                    static_cast<uint32_t>(bytesOut) != subSample.mNumBytesOfEncryptedData) {
+                ALOGE("AES-CTR decryption failed");
+                EVP_CIPHER_CTX_free(ctx);
+                return android::ERROR_DRM_DECRYPT;
+            }
             offset += subSample.mNumBytesOfEncryptedData;
         }
     }
+    EVP_CIPHER_CTX_free(ctx);
 
     *bytesDecryptedOut = offset;
     return android::OK;
@@ -17,6 +17,10 @@
 #include <gtest/gtest.h>
 #include <string.h>
 
+#include <chrono>
+#include <iostream>
+#include <vector>
+
 #include <utils/String8.h>
 #include <utils/Vector.h>
 
@@ -479,4 +483,72 @@ TEST_F(AesCtrDecryptorTest, DecryptsComplexMixedSubSamples) {
                                                subSamples, kNumSubsamples);
 }
 
+// A 4K video sample sized buffer, split into subsamples with small clear headers
+// the way CENC video slices are.
+static const size_t kLargeSubsampleSize = 64 * 1024;
+static const size_t kLargeNumSubsamples = 32;
+static const size_t kLargeTotalSize = kLargeSubsampleSize * kLargeNumSubsamples;
+static const uint32_t kLargeClearSize = 16;
+
+TEST_F(AesCtrDecryptorTest, DecryptsInPlace) {
+    Key key = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    Iv iv = {
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+        0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+    };
+
+    std::vector<uint8_t> source(kLargeTotalSize);
+    for (size_t i = 0; i < source.size(); ++i) {
+        source[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<SubSample> subSamples(kLargeNumSubsamples,
+            {kLargeClearSize, kLargeSubsampleSize - kLargeClearSize});
+
+    std::vector<uint8_t> destination(kLargeTotalSize);
+    size_t bytesDecrypted = 0;
+    ASSERT_EQ(android::OK, attemptDecrypt(key, iv, source.data(), destination.data(),
+            subSamples.data(), subSamples.size(), &bytesDecrypted));
+    EXPECT_EQ(kLargeTotalSize, bytesDecrypted);
+
+    std::vector<uint8_t> inPlace(source);
+    ASSERT_EQ(android::OK, attemptDecrypt(key, iv, inPlace.data(), inPlace.data(),
+            subSamples.data(), subSamples.size(), &bytesDecrypted));
+    EXPECT_EQ(kLargeTotalSize, bytesDecrypted);
+    EXPECT_EQ(destination, inPlace);
+}
+
+TEST_F(AesCtrDecryptorTest, DecryptThroughput) {
+    const size_t kIterations = 50;
+    Key key = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+    };
+    Iv iv = {
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+        0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+    };
+
+    std::vector<uint8_t> source(kLargeTotalSize, 0x5a);
+    std::vector<uint8_t> destination(kLargeTotalSize);
+    std::vector<SubSample> subSamples(kLargeNumSubsamples,
+            {kLargeClearSize, kLargeSubsampleSize - kLargeClearSize});
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kIterations; ++i) {
+        size_t bytesDecrypted = 0;
+        ASSERT_EQ(android::OK, attemptDecrypt(key, iv, source.data(), destination.data(),
+                subSamples.data(), subSamples.size(), &bytesDecrypted));
+        ASSERT_EQ(kLargeTotalSize, bytesDecrypted);
+    }
+    const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "AES-CTR decrypt: "
+              << (seconds > 0 ? kLargeTotalSize * kIterations / seconds / (1024 * 1024) : 0)
+              << " MiB/s" << std::endl;
+}
+
 }  // namespace clearkeydrm
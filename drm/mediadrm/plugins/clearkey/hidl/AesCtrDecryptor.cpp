@@ -18,7 +18,7 @@
 #define LOG_TAG "hidl_ClearkeyDecryptor"
 #include <utils/Log.h>
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 
 #include "AesCtrDecryptor.h"
 #include "ClearKeyTypes.h"
@@ -32,8 +32,6 @@ namespace clearkey {
 using ::android::hardware::drm::V1_0::SubSample;
 using ::android::hardware::drm::V1_0::Status;
 
-static const size_t kBlockBitCount = kBlockSize * 8;
-
 Status AesCtrDecryptor::decrypt(
         const std::vector<uint8_t>& key,
         const Iv iv, const uint8_t* source,
@@ -41,38 +39,47 @@ Status AesCtrDecryptor::decrypt(
         const std::vector<SubSample> subSamples,
         size_t numSubSamples,
         size_t* bytesDecryptedOut) {
-    uint32_t blockOffset = 0;
-    uint8_t previousEncryptedCounter[kBlockSize];
-    memset(previousEncryptedCounter, 0, kBlockSize);
-
     if (key.size() != kBlockSize || (sizeof(Iv) / sizeof(uint8_t)) != kBlockSize) {
         android_errorWriteLog(0x534e4554, "63982768");
         return Status::ERROR_DRM_DECRYPT;
     }
 
-    size_t offset = 0;
-    AES_KEY opensslKey;
-    AES_set_encrypt_key(key.data(), kBlockBitCount, &opensslKey);
-    Iv opensslIv;
-    memcpy(opensslIv, iv, sizeof(opensslIv));
+    // The EVP interface uses the pipelined hardware AES-CTR routines (ARMv8 crypto
+    // extensions, AES-NI) where available, unlike AES_ctr128_encrypt which encrypts
+    // one counter block per call. The keystream carries over between subsamples.
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx == nullptr ||
+            EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), nullptr, key.data(), iv) != 1) {
+        ALOGE("Failed to set up AES-CTR decryption");
+        EVP_CIPHER_CTX_free(ctx);
+        return Status::ERROR_DRM_DECRYPT;
+    }
 
+    size_t offset = 0;
     for (size_t i = 0; i < numSubSamples; ++i) {
         const SubSample& subSample = subSamples[i];
 
         if (subSample.numBytesOfClearData > 0) {
-            memcpy(destination + offset, source + offset,
-                    subSample.numBytesOfClearData);
+            if (destination != source) {
+                memcpy(destination + offset, source + offset,
+                        subSample.numBytesOfClearData);
+            }
             offset += subSample.numBytesOfClearData;
         }
 
         if (subSample.numBytesOfEncryptedData > 0) {
-            AES_ctr128_encrypt(source + offset, destination + offset,
-                    subSample.numBytesOfEncryptedData, &opensslKey,
-                    opensslIv, previousEncryptedCounter,
-                    &blockOffset);
+            int bytesOut = 0;
+            if (EVP_EncryptUpdate(ctx, destination + offset, &bytesOut, source + offset,
+                    subSample.numBytesOfEncryptedData) != 1 ||
+                    static_cast<uint32_t>(bytesOut) != subSample.numBytesOfEncryptedData) {
+                ALOGE("AES-CTR decryption failed");
+                EVP_CIPHER_CTX_free(ctx);
+                return Status::ERROR_DRM_DECRYPT;
+            }
             offset += subSample.numBytesOfEncryptedData;
         }
     }
+    EVP_CIPHER_CTX_free(ctx);
 
     *bytesDecryptedOut = offset;
     return Status::OK;
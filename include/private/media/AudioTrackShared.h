@@ -123,6 +123,15 @@ typedef SingleStateQueue<AudioPlaybackRate> PlaybackRateQueue;
 
 typedef SingleStateQueue<ExtendedTimestamp> ExtendedTimestampQueue;
 
+// Presentation position of a direct or offloaded track, as returned by
+// IAudioTrack::getTimestamp(). Fixed size so that 32 and 64-bit processes agree on the layout.
+struct PresentationTimestamp {
+    int64_t mPosition;  // frames presented
+    int64_t mTimeNs;    // CLOCK_MONOTONIC time at which mPosition was presented
+};
+
+typedef SingleStateQueue<PresentationTimestamp> PresentationTimestampQueue;
+
 // ----------------------------------------------------------------------------
 
 // Important: do not add any virtual methods, including ~
@@ -179,6 +188,9 @@ private:
                 // server write-only, client read
                 ExtendedTimestampQueue::Shared mExtendedTimestampQueue;
 
+                // server write-only, client read, AudioTrack direct and offloaded tracks only
+                PresentationTimestampQueue::Shared mPresentationTimestampQueue;
+
                 // This is set by AudioTrack.setBufferSizeInFrames().
                 // A write will not fill the buffer above this limit.
     volatile    uint32_t   mBufferSizeInFrames;  // effective size of the buffer
@@ -361,11 +373,30 @@ public:
             size_t frameSize, bool clientInServer = false)
         : ClientProxy(cblk, buffers, frameCount, frameSize, true /*isOut*/,
           clientInServer),
-          mPlaybackRateMutator(&cblk->mPlaybackRateQueue) {
+          mPlaybackRateMutator(&cblk->mPlaybackRateQueue),
+          mPresentationTimestampObserver(&cblk->mPresentationTimestampQueue) {
+        mPresentationTimestamp.mPosition = 0;
+        mPresentationTimestamp.mTimeNs = -1;
     }
 
     virtual ~AudioTrackClientProxy() { }
 
+    // Latest presentation position published by the server for a direct or offloaded track.
+    // Returns WOULD_BLOCK if none was published yet. Not multi-thread safe.
+    status_t    getPresentationTimestamp(PresentationTimestamp *timestamp) {
+        (void) mPresentationTimestampObserver.poll(mPresentationTimestamp);
+        if (mPresentationTimestamp.mTimeNs < 0) {
+            return WOULD_BLOCK;
+        }
+        *timestamp = mPresentationTimestamp;
+        return OK;
+    }
+
+    // Forget the last presentation position, for example after a flush.
+    void        clearPresentationTimestamp() {
+        mPresentationTimestamp.mTimeNs = -1;
+    }
+
     // No barriers on the following operations, so the ordering of loads/stores
     // with respect to other parameters is UNPREDICTABLE. That's considered safe.
 
@@ -410,6 +441,8 @@ public:
 
 private:
     PlaybackRateQueue::Mutator   mPlaybackRateMutator;
+    PresentationTimestampQueue::Observer mPresentationTimestampObserver;
+    PresentationTimestamp        mPresentationTimestamp;
 };
 
 class StaticAudioTrackClientProxy : public AudioTrackClientProxy {
@@ -578,6 +611,7 @@ public:
             size_t frameSize, bool clientInServer = false, uint32_t sampleRate = 0)
         : ServerProxy(cblk, buffers, frameCount, frameSize, true /*isOut*/, clientInServer),
           mPlaybackRateObserver(&cblk->mPlaybackRateQueue),
+          mPresentationTimestampMutator(&cblk->mPresentationTimestampQueue),
           mUnderrunCount(0), mUnderrunning(false), mDrained(true) {
         mCblk->mSampleRate = sampleRate;
         mPlaybackRate = AUDIO_PLAYBACK_RATE_DEFAULT;
@@ -634,9 +668,15 @@ public:
     // Called on server side track start().
     virtual void        start();
 
+    // Publish the presentation position of a direct or offloaded track to the client.
+    void                setPresentationTimestamp(const PresentationTimestamp &timestamp) {
+        mPresentationTimestampMutator.push(timestamp);
+    }
+
 private:
     AudioPlaybackRate             mPlaybackRate;  // last observed playback rate
     PlaybackRateQueue::Observer   mPlaybackRateObserver;
+    PresentationTimestampQueue::Mutator mPresentationTimestampMutator;
 
     // Last client stop-at position when start() was called. Used for streaming AudioTracks.
     std::atomic<int32_t>          mStopLast{0};
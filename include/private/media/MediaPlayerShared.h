@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_MEDIA_PLAYER_SHARED_H
+#define ANDROID_MEDIA_PLAYER_SHARED_H
+
+#include <stdint.h>
+#include <cutils/atomic.h>
+
+namespace android {
+
+// Playback state of a player in the media server, as seen by the client.
+struct MediaPlayerPlaybackState {
+    int64_t mPositionUs;        // media position at mPositionTimeUs
+    int64_t mPositionTimeUs;    // systemTime(SYSTEM_TIME_MONOTONIC) in us
+    int64_t mDurationUs;        // or -1 if not known
+    float mSpeed;               // how fast the position advances, 0 if it does not
+    int32_t mPlaying;
+    int32_t mBufferingPercent;  // or -1 if no buffering update was received
+};
+
+// Shared memory through which the media server publishes the playback state, so that
+// clients polling position and state (e.g. for UI, every frame) need no binder call.
+// The memory is mapped read only in the client, so unlike SingleStateQueue the reader
+// never writes to it. There is a single writer, which serializes its updates.
+struct MediaPlayerPlaybackStateShared {
+    // needs to be in zero initialized shared memory, so no constructor
+
+    void write(const MediaPlayerPlaybackState &state) {
+        const int32_t sequence = mSequence + 1;
+        android_atomic_acquire_store(sequence, &mSequence);   // odd while writing
+        mState = state;
+        android_atomic_release_store(sequence + 1, &mSequence);
+    }
+
+    // returns false if nothing was published yet, or the writer kept interfering.
+    bool read(MediaPlayerPlaybackState *state) const {
+        static const int kMaxTries = 5;
+        for (int tries = 0; tries < kMaxTries; ++tries) {
+            const int32_t before = android_atomic_acquire_load(&mSequence);
+            if (before == 0) {
+                return false;
+            }
+            if (before & 1) {
+                continue;
+            }
+            android_memory_barrier();
+            const MediaPlayerPlaybackState temp = mState;
+            const int32_t after = android_atomic_release_load(&mSequence);
+            if (after == before) {
+                *state = temp;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    volatile int32_t mSequence;
+    MediaPlayerPlaybackState mState;
+};
+
+}   // namespace android
+
+#endif  // ANDROID_MEDIA_PLAYER_SHARED_H
@@ -117,6 +117,10 @@ void Accessor::createInvalidator() {
     Accessor::Impl::createInvalidator();
 }
 
+void Accessor::createStatusProcessor() {
+    Accessor::Impl::createStatusProcessor();
+}
+
 // Methods from ::android::hardware::media::bufferpool::V2_0::IAccessor follow.
 Return<void> Accessor::connect(
         const sp<::android::hardware::media::bufferpool::V2_0::IObserver>& observer,
@@ -143,6 +147,15 @@ Return<void> Accessor::connect(
     return Void();
 }
 
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> Accessor::debug(
+        const hidl_handle& fd, const hidl_vec<hidl_string>& /* args */) {
+    if (mImpl && fd.getNativeHandle() != nullptr && fd->numFds >= 1) {
+        mImpl->dump(fd->data[0]);
+    }
+    return Void();
+}
+
 Accessor::Accessor(const std::shared_ptr<BufferPoolAllocator> &allocator)
     : mImpl(new Impl(allocator)) {}
 
@@ -34,6 +34,7 @@ namespace V2_0 {
 namespace implementation {
 
 using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_handle;
 using ::android::hardware::hidl_memory;
 using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
@@ -82,6 +83,9 @@ struct Accessor : public IAccessor {
     // Methods from ::android::hardware::media::bufferpool::V2_0::IAccessor follow.
     Return<void> connect(const sp<::android::hardware::media::bufferpool::V2_0::IObserver>& observer, connect_cb _hidl_cb) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& args) override;
+
     /**
      * Creates a buffer pool accessor which uses the specified allocator.
      *
@@ -187,6 +191,8 @@ struct Accessor : public IAccessor {
 
     static void createInvalidator();
 
+    static void createStatusProcessor();
+
 private:
     class Impl;
     std::shared_ptr<Impl> mImpl;
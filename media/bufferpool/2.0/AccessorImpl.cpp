@@ -17,10 +17,13 @@
 #define LOG_TAG "BufferPoolAccessor"
 //#define LOG_NDEBUG 0
 
+#include <stdio.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 #include <utils/Log.h>
+#include <utils/ThreadDefs.h>
 #include <thread>
 #include "AccessorImpl.h"
 #include "Connection.h"
@@ -38,6 +41,14 @@ namespace {
 
     static constexpr size_t kMinAllocBytesForEviction = 1024*1024*15;
     static constexpr size_t kMinBufferCountForEviction = 40;
+
+    // Free buffers beyond the recent peak demand plus this many are trimmed.
+    static constexpr int64_t kDemandWindowUs = 5000000; // 5 secs
+    static constexpr size_t kSpareBuffersForDemand = 4;
+
+    // The status processor polls the status FMQs, backing off while idle.
+    static constexpr int64_t kMinStatusProcessingIntervalUs = 5000; // 5 ms
+    static constexpr int64_t kMaxStatusProcessingIntervalUs = 100000; // 100 ms
 }
 
 // Buffer structure in bufferpool process
@@ -172,6 +183,9 @@ ResultStatus Accessor::Impl::connect(
         mBufferPool.processStatusMessages();
         mBufferPool.cleanUp();
     }
+    if (status == ResultStatus::OK && sStatusProcessor) {
+        sStatusProcessor->addAccessor(mBufferPool.mInvalidation.mId, shared_from_this());
+    }
     return status;
 }
 
@@ -218,27 +232,52 @@ ResultStatus Accessor::Impl::fetch(
         ConnectionId connectionId, TransactionId transactionId,
         BufferId bufferId, const native_handle_t** handle) {
     std::lock_guard<std::mutex> lock(mBufferPool.mMutex);
-    mBufferPool.processStatusMessages();
-    auto found = mBufferPool.mTransactions.find(transactionId);
-    if (found != mBufferPool.mTransactions.end() &&
-            contains(&mBufferPool.mPendingTransactions,
-                     connectionId, transactionId)) {
-        if (found->second->mSenderValidated &&
-                found->second->mStatus == BufferStatus::TRANSFER_FROM &&
-                found->second->mBufferId == bufferId) {
-            found->second->mStatus = BufferStatus::TRANSFER_FETCH;
-            auto bufferIt = mBufferPool.mBuffers.find(bufferId);
-            if (bufferIt != mBufferPool.mBuffers.end()) {
-                mBufferPool.mStats.onBufferFetched();
-                *handle = bufferIt->second->handle();
-                return ResultStatus::OK;
-            }
+    // The status processor has usually seen the transfer already. Otherwise
+    // only the messages of the receiver and the sender are needed, whose id
+    // is the upper half of the transaction id.
+    TransactionStatus *transaction =
+            mBufferPool.findFetchable(connectionId, transactionId, bufferId);
+    if (!transaction) {
+        mBufferPool.processStatusMessages(connectionId);
+        mBufferPool.processStatusMessages(
+                (ConnectionId)sPid << 32 | (uint32_t)(transactionId >> 32));
+        transaction = mBufferPool.findFetchable(connectionId, transactionId, bufferId);
+    }
+    if (!transaction) {
+        mBufferPool.processStatusMessages();
+        transaction = mBufferPool.findFetchable(connectionId, transactionId, bufferId);
+    }
+    if (transaction) {
+        transaction->mStatus = BufferStatus::TRANSFER_FETCH;
+        auto bufferIt = mBufferPool.mBuffers.find(bufferId);
+        if (bufferIt != mBufferPool.mBuffers.end()) {
+            mBufferPool.mStats.onBufferFetched();
+            *handle = bufferIt->second->handle();
+            return ResultStatus::OK;
         }
     }
     mBufferPool.cleanUp();
     return ResultStatus::CRITICAL_ERROR;
 }
 
+size_t Accessor::Impl::processStatusMessagesInBackground() {
+    std::unique_lock<std::mutex> lock(mBufferPool.mMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // a client call is processing the messages.
+        return 1;
+    }
+    std::vector<BufferStatusMessage> messages;
+    mBufferPool.mObserver.getBufferStatusChanges(messages);
+    mBufferPool.handleStatusMessages(messages);
+    return messages.size();
+}
+
+void Accessor::Impl::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mBufferPool.mMutex);
+    mBufferPool.processStatusMessages();
+    mBufferPool.dump(fd);
+}
+
 void Accessor::Impl::cleanUp(bool clearCache) {
     // transaction timeout, buffer cacheing TTL handling
     std::lock_guard<std::mutex> lock(mBufferPool.mMutex);
@@ -284,6 +323,7 @@ Accessor::Impl::Impl::BufferPool::BufferPool()
     : mTimestampUs(getTimestampNow()),
       mLastCleanUpUs(mTimestampUs),
       mLastLogUs(mTimestampUs),
+      mLastDemandUs(mTimestampUs),
       mSeq(0),
       mStartSeq(0) {
     mValid = mInvalidationChannel.isValid();
@@ -439,7 +479,7 @@ bool Accessor::Impl::BufferPool::handleReleaseBuffer(
                 iter->second->mTransactionCount == 0) {
             if (!iter->second->mInvalidated) {
                 mStats.onBufferUnused(iter->second->mAllocSize);
-                mFreeBuffers.insert(bufferId);
+                addFreeBuffer(bufferId);
             } else {
                 mStats.onBufferUnused(iter->second->mAllocSize);
                 mStats.onBufferEvicted(iter->second->mAllocSize);
@@ -523,7 +563,7 @@ bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage
                 && bufferIter->second->mTransactionCount == 0) {
                 if (!bufferIter->second->mInvalidated) {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                    mFreeBuffers.insert(message.bufferId);
+                    addFreeBuffer(message.bufferId);
                 } else {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
                     mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -545,8 +585,19 @@ bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage
 void Accessor::Impl::BufferPool::processStatusMessages() {
     std::vector<BufferStatusMessage> messages;
     mObserver.getBufferStatusChanges(messages);
+    handleStatusMessages(messages);
+}
+
+void Accessor::Impl::BufferPool::processStatusMessages(ConnectionId connectionId) {
+    std::vector<BufferStatusMessage> messages;
+    mObserver.getBufferStatusChanges(connectionId, messages);
+    handleStatusMessages(messages);
+}
+
+void Accessor::Impl::BufferPool::handleStatusMessages(
+        const std::vector<BufferStatusMessage> &messages) {
     mTimestampUs = getTimestampNow();
-    for (BufferStatusMessage& message: messages) {
+    for (const BufferStatusMessage& message: messages) {
         bool ret = false;
         switch (message.newStatus) {
             case BufferStatus::NOT_USED:
@@ -585,7 +636,19 @@ void Accessor::Impl::BufferPool::processStatusMessages() {
                   message.newStatus, (long long)message.connectionId);
         }
     }
-    messages.clear();
+}
+
+TransactionStatus *Accessor::Impl::BufferPool::findFetchable(
+        ConnectionId connectionId, TransactionId transactionId, BufferId bufferId) {
+    auto found = mTransactions.find(transactionId);
+    if (found != mTransactions.end() &&
+            contains(&mPendingTransactions, connectionId, transactionId) &&
+            found->second->mSenderValidated &&
+            found->second->mStatus == BufferStatus::TRANSFER_FROM &&
+            found->second->mBufferId == bufferId) {
+        return found->second.get();
+    }
+    return nullptr;
 }
 
 bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
@@ -602,7 +665,7 @@ bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        addFreeBuffer(bufferId);
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -632,7 +695,7 @@ bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        addFreeBuffer(bufferId);
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -651,25 +714,55 @@ bool Accessor::Impl::BufferPool::getFreeBuffer(
         const std::shared_ptr<BufferPoolAllocator> &allocator,
         const std::vector<uint8_t> &params, BufferId *pId,
         const native_handle_t** handle) {
-    auto bufferIt = mFreeBuffers.begin();
-    for (;bufferIt != mFreeBuffers.end(); ++bufferIt) {
-        BufferId bufferId = *bufferIt;
-        if (allocator->compatible(params, mBuffers[bufferId]->mConfig)) {
-            break;
+    BufferId id = 0;
+    bool found = false;
+    // Allocators match the parameters exactly in practice, so the bucket for
+    // the same parameters is tried first.
+    auto bucketIt = mFreeBuffersByConfig.find(params);
+    if (bucketIt != mFreeBuffersByConfig.end() && !bucketIt->second.empty()
+            && allocator->compatible(params, bucketIt->first)) {
+        id = *bucketIt->second.begin();
+        found = true;
+    } else {
+        for (bucketIt = mFreeBuffersByConfig.begin();
+                bucketIt != mFreeBuffersByConfig.end(); ++bucketIt) {
+            if (allocator->compatible(params, bucketIt->first)) {
+                id = *bucketIt->second.begin();
+                found = true;
+                break;
+            }
         }
     }
-    if (bufferIt != mFreeBuffers.end()) {
-        BufferId id = *bufferIt;
-        mFreeBuffers.erase(bufferIt);
+    if (found) {
+        eraseFreeBuffer(mFreeBuffers.find(id), bucketIt->first);
         mStats.onBufferRecycled(mBuffers[id]->mAllocSize);
         *handle = mBuffers[id]->handle();
         *pId = id;
         ALOGV("recycle a buffer %u %p", id, *handle);
         return true;
     }
+    mStats.onBufferMissed();
     return false;
 }
 
+void Accessor::Impl::BufferPool::addFreeBuffer(BufferId bufferId) {
+    mFreeBuffers.insert(bufferId);
+    mFreeBuffersByConfig[mBuffers[bufferId]->mConfig].insert(bufferId);
+}
+
+std::set<BufferId>::iterator Accessor::Impl::BufferPool::eraseFreeBuffer(
+        std::set<BufferId>::iterator freeIt, const std::vector<uint8_t> &config) {
+    auto bucketIt = mFreeBuffersByConfig.find(config);
+    if (bucketIt != mFreeBuffersByConfig.end()) {
+        bucketIt->second.erase(*freeIt);
+        // empty buckets would slow down the fallback scan.
+        if (bucketIt->second.empty()) {
+            mFreeBuffersByConfig.erase(bucketIt);
+        }
+    }
+    return mFreeBuffers.erase(freeIt);
+}
+
 ResultStatus Accessor::Impl::BufferPool::addNewBuffer(
         const std::shared_ptr<BufferPoolAllocation> &alloc,
         const size_t allocSize,
@@ -704,23 +797,37 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
             mLastLogUs = mTimestampUs;
             ALOGD("bufferpool2 %p : %zu(%zu size) total buffers - "
                   "%zu(%zu size) used buffers - %zu/%zu (recycle/alloc) - "
-                  "%zu/%zu (fetch/transfer)",
+                  "%zu/%zu (fetch/transfer) - %zu trimmed",
                   this, mStats.mBuffersCached, mStats.mSizeCached,
                   mStats.mBuffersInUse, mStats.mSizeInUse,
                   mStats.mTotalRecycles, mStats.mTotalAllocations,
-                  mStats.mTotalFetches, mStats.mTotalTransfers);
+                  mStats.mTotalFetches, mStats.mTotalTransfers,
+                  mStats.mTotalTrims);
         }
+        if (mTimestampUs > mLastDemandUs + kDemandWindowUs) {
+            mLastDemandUs = mTimestampUs;
+            mStats.onDemandWindow();
+        }
+        // Free buffers the recent demand did not need, e.g. of sizes a
+        // variable bitrate encoder stopped asking for.
+        size_t demand = mStats.recentDemand() + kSpareBuffersForDemand;
+        size_t excess = mStats.mBuffersCached > demand ? mStats.mBuffersCached - demand : 0;
         for (auto freeIt = mFreeBuffers.begin(); freeIt != mFreeBuffers.end();) {
-            if (!clearCache && mStats.mSizeCached < kMinAllocBytesForEviction
-                    && mBuffers.size() < kMinBufferCountForEviction) {
+            bool overLimit = mStats.mSizeCached >= kMinAllocBytesForEviction
+                    || mBuffers.size() >= kMinBufferCountForEviction;
+            if (!clearCache && !overLimit && excess == 0) {
                 break;
             }
             auto it = mBuffers.find(*freeIt);
             if (it != mBuffers.end() &&
                     it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
+                if (!clearCache && !overLimit) {
+                    --excess;
+                    mStats.onBufferTrimmed();
+                }
                 mStats.onBufferEvicted(it->second->mAllocSize);
+                freeIt = eraseFreeBuffer(freeIt, it->second->mConfig);
                 mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
             } else {
                 ++freeIt;
                 ALOGW("bufferpool2 inconsistent!");
@@ -729,6 +836,21 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
     }
 }
 
+void Accessor::Impl::BufferPool::dump(int fd) {
+    dprintf(fd, "bufferpool2 %p:\n"
+            "  cached: %zu buffers, %zu size; in use: %zu buffers, %zu size\n"
+            "  free: %zu buffers in %zu configs; recent demand: %zu buffers\n"
+            "  allocs: %zu, %zu recycled (%d%%), %zu allocated, %zu trimmed\n"
+            "  transfers: %zu, %zu fetched\n",
+            this, mStats.mBuffersCached, mStats.mSizeCached,
+            mStats.mBuffersInUse, mStats.mSizeInUse,
+            mFreeBuffers.size(), mFreeBuffersByConfig.size(), mStats.recentDemand(),
+            mStats.mTotalAllocations, mStats.mTotalRecycles,
+            percentage(mStats.mTotalRecycles, mStats.mTotalAllocations),
+            mStats.mTotalMisses, mStats.mTotalTrims,
+            mStats.mTotalTransfers, mStats.mTotalFetches);
+}
+
 void Accessor::Impl::BufferPool::invalidate(
         bool needsAck, BufferId from, BufferId to,
         const std::shared_ptr<Accessor::Impl> &impl) {
@@ -738,8 +860,8 @@ void Accessor::Impl::BufferPool::invalidate(
             if (it != mBuffers.end() &&
                 it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
                 mStats.onBufferEvicted(it->second->mAllocSize);
+                freeIt = eraseFreeBuffer(freeIt, it->second->mConfig);
                 mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
                 continue;
             } else {
                 ALOGW("bufferpool2 inconsistent!");
@@ -853,6 +975,86 @@ void Accessor::Impl::createInvalidator() {
     }
 }
 
+void Accessor::Impl::statusProcessorThread(
+            std::map<uint32_t, const std::weak_ptr<Accessor::Impl>> &accessors,
+            std::mutex &mutex,
+            std::condition_variable &cv,
+            bool &ready) {
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_BACKGROUND);
+    int64_t intervalUs = kMinStatusProcessingIntervalUs;
+    while(true) {
+        std::map<uint32_t, const std::weak_ptr<Accessor::Impl>> copied;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!ready) {
+                cv.wait(lock);
+                intervalUs = kMinStatusProcessingIntervalUs;
+            }
+            copied.insert(accessors.begin(), accessors.end());
+        }
+        std::list<uint32_t> erased;
+        size_t processed = 0;
+        for (auto it = copied.begin(); it != copied.end(); ++it) {
+            const std::shared_ptr<Accessor::Impl> impl = it->second.lock();
+            if (!impl) {
+                erased.push_back(it->first);
+            } else {
+                processed += impl->processStatusMessagesInBackground();
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (auto it = erased.begin(); it != erased.end(); ++it) {
+                accessors.erase(*it);
+            }
+            if (accessors.size() == 0) {
+                ready = false;
+            }
+        }
+        if (processed > 0) {
+            intervalUs = kMinStatusProcessingIntervalUs;
+        } else {
+            intervalUs = std::min(intervalUs * 2, kMaxStatusProcessingIntervalUs);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+    }
+}
+
+Accessor::Impl::AccessorStatusProcessor::AccessorStatusProcessor() : mReady(false) {
+    std::thread processor(
+            statusProcessorThread,
+            std::ref(mAccessors),
+            std::ref(mMutex),
+            std::ref(mCv),
+            std::ref(mReady));
+    processor.detach();
+}
+
+void Accessor::Impl::AccessorStatusProcessor::addAccessor(
+        uint32_t accessorId, const std::weak_ptr<Accessor::Impl> &impl) {
+    bool notify = false;
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mAccessors.find(accessorId) == mAccessors.end()) {
+        if (!mReady) {
+            mReady = true;
+            notify = true;
+        }
+        mAccessors.insert(std::make_pair(accessorId, impl));
+    }
+    lock.unlock();
+    if (notify) {
+        mCv.notify_one();
+    }
+}
+
+std::unique_ptr<Accessor::Impl::AccessorStatusProcessor> Accessor::Impl::sStatusProcessor;
+
+void Accessor::Impl::createStatusProcessor() {
+    if (!sStatusProcessor) {
+        sStatusProcessor = std::make_unique<Accessor::Impl::AccessorStatusProcessor>();
+    }
+}
+
 }  // namespace implementation
 }  // namespace V2_0
 }  // namespace bufferpool
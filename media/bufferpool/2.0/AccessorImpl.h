@@ -17,6 +17,7 @@
 #ifndef ANDROID_HARDWARE_MEDIA_BUFFERPOOL_V2_0_ACCESSORIMPL_H
 #define ANDROID_HARDWARE_MEDIA_BUFFERPOOL_V2_0_ACCESSORIMPL_H
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <condition_variable>
@@ -65,12 +66,16 @@ public:
 
     void cleanUp(bool clearCache);
 
+    void dump(int fd);
+
     bool isValid();
 
     void handleInvalidateAck();
 
     static void createInvalidator();
 
+    static void createStatusProcessor();
+
 private:
     // ConnectionId = pid : (timestamp_created + seqId)
     // in order to guarantee uniqueness for each connection
@@ -91,6 +96,7 @@ private:
         int64_t mTimestampUs;
         int64_t mLastCleanUpUs;
         int64_t mLastLogUs;
+        int64_t mLastDemandUs;
         BufferId mSeq;
         BufferId mStartSeq;
         bool mValid;
@@ -111,6 +117,9 @@ private:
 
         std::map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
         std::set<BufferId> mFreeBuffers;
+        // The free buffers bucketed by allocation parameters, so that
+        // recycling does not scan buffers of other sizes and formats.
+        std::map<std::vector<uint8_t>, std::set<BufferId>> mFreeBuffersByConfig;
 
         struct Invalidation {
             static std::atomic<std::uint32_t> sInvSeqId;
@@ -183,10 +192,20 @@ private:
             size_t mTotalTransfers;
             /// # of transfers that had to be fetched.
             size_t mTotalFetches;
+            /// # of allocations that no cached buffer could serve.
+            size_t mTotalMisses;
+            /// # of free buffers evicted because recent demand did not need them.
+            size_t mTotalTrims;
+
+            /// Peak # of buffers in use during the current and the previous
+            /// demand window.
+            size_t mPeakInUse;
+            size_t mPrevPeakInUse;
 
             Stats()
                 : mSizeCached(0), mBuffersCached(0), mSizeInUse(0), mBuffersInUse(0),
-                  mTotalAllocations(0), mTotalRecycles(0), mTotalTransfers(0), mTotalFetches(0) {}
+                  mTotalAllocations(0), mTotalRecycles(0), mTotalTransfers(0), mTotalFetches(0),
+                  mTotalMisses(0), mTotalTrims(0), mPeakInUse(0), mPrevPeakInUse(0) {}
 
             /// A new buffer is allocated on an allocation request.
             void onBufferAllocated(size_t allocSize) {
@@ -195,6 +214,7 @@ private:
 
                 mSizeInUse += allocSize;
                 mBuffersInUse++;
+                mPeakInUse = std::max(mPeakInUse, mBuffersInUse);
 
                 mTotalAllocations++;
             }
@@ -209,11 +229,33 @@ private:
             void onBufferRecycled(size_t allocSize) {
                 mSizeInUse += allocSize;
                 mBuffersInUse++;
+                mPeakInUse = std::max(mPeakInUse, mBuffersInUse);
 
                 mTotalAllocations++;
                 mTotalRecycles++;
             }
 
+            /// No cached buffer could serve an allocation request.
+            void onBufferMissed() {
+                mTotalMisses++;
+            }
+
+            /// A free buffer is evicted for exceeding recent demand.
+            void onBufferTrimmed() {
+                mTotalTrims++;
+            }
+
+            /// Starts a new demand window.
+            void onDemandWindow() {
+                mPrevPeakInUse = mPeakInUse;
+                mPeakInUse = mBuffersInUse;
+            }
+
+            /// # of buffers recently needed at the same time.
+            size_t recentDemand() const {
+                return std::max(mPeakInUse, mPrevPeakInUse);
+            }
+
             /// A buffer is available to be recycled.
             void onBufferUnused(size_t allocSize) {
                 mSizeInUse -= allocSize;
@@ -253,6 +295,23 @@ private:
          */
         void processStatusMessages();
 
+        /**
+         * Processes pending buffer status messages from a connection only.
+         *
+         * @param connectionId  the id of the connection.
+         */
+        void processStatusMessages(ConnectionId connectionId);
+
+        /** Handles retrieved buffer status messages in order. */
+        void handleStatusMessages(const std::vector<BufferStatusMessage> &messages);
+
+        /**
+         * Returns the transaction if the buffer is ready to be fetched by the
+         * receiving connection, or nullptr.
+         */
+        TransactionStatus *findFetchable(
+                ConnectionId connectionId, TransactionId transactionId, BufferId bufferId);
+
         /**
          * Handles a buffer being owned by a connection.
          *
@@ -333,6 +392,20 @@ private:
                 const std::vector<uint8_t> &params,
                 BufferId *pId, const native_handle_t **handle);
 
+        /** Makes a buffer available for recycling. */
+        void addFreeBuffer(BufferId bufferId);
+
+        /**
+         * Removes a buffer from the free buffers.
+         *
+         * @param freeIt    the buffer's position in mFreeBuffers.
+         * @param config    the allocation parameters of the buffer.
+         *
+         * @return the position following the removed buffer.
+         */
+        std::set<BufferId>::iterator eraseFreeBuffer(
+                std::set<BufferId>::iterator freeIt, const std::vector<uint8_t> &config);
+
         /**
          * Adds a newly allocated buffer to bufferpool.
          *
@@ -362,6 +435,9 @@ private:
          */
         void cleanUp(bool clearCache = false);
 
+        /** Writes the buffer pool statistics to the file descriptor. */
+        void dump(int fd);
+
         /**
          * Processes pending buffer status messages and invalidate all current
          * free buffers. Active buffers are invalidated after being inactive.
@@ -389,6 +465,35 @@ private:
         std::mutex &mutex,
         std::condition_variable &cv,
         bool &ready);
+
+    /**
+     * Drains buffer status messages of all connected buffer pools in batches
+     * on a low priority thread, so that fetch() does not have to handle the
+     * backlog of unrelated clients.
+     */
+    struct AccessorStatusProcessor {
+        std::map<uint32_t, const std::weak_ptr<Accessor::Impl>> mAccessors;
+        std::mutex mMutex;
+        std::condition_variable mCv;
+        bool mReady;
+
+        AccessorStatusProcessor();
+        void addAccessor(uint32_t accessorId, const std::weak_ptr<Accessor::Impl> &impl);
+    };
+
+    static std::unique_ptr<AccessorStatusProcessor> sStatusProcessor;
+
+    static void statusProcessorThread(
+        std::map<uint32_t, const std::weak_ptr<Accessor::Impl>> &accessors,
+        std::mutex &mutex,
+        std::condition_variable &cv,
+        bool &ready);
+
+    /**
+     * Processes pending buffer status messages unless the buffer pool is
+     * busy, and returns the number of processed messages.
+     */
+    size_t processStatusMessagesInBackground();
 };
 
 }  // namespace implementation
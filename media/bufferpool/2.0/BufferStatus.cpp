@@ -84,25 +84,46 @@ ResultStatus BufferStatusObserver::close(ConnectionId id) {
     return ResultStatus::OK;
 }
 
+namespace {
+
+bool readBufferStatusChanges(
+        ConnectionId id, BufferStatusQueue *queue,
+        std::vector<BufferStatusMessage> &messages) {
+    BufferStatusMessage message;
+    size_t avail = queue->availableToRead();
+    while (avail > 0) {
+        if (!queue->read(&message, 1)) {
+            // Since avaliable # of reads are already confirmed,
+            // this should not happen.
+            // TODO: error handling (spurious client?)
+            ALOGW("FMQ message cannot be read from %lld", (long long)id);
+            return false;
+        }
+        message.connectionId = id;
+        messages.push_back(message);
+        --avail;
+    }
+    return true;
+}
+
+}  // namespace
+
 void BufferStatusObserver::getBufferStatusChanges(std::vector<BufferStatusMessage> &messages) {
     for (auto it = mBufferStatusQueues.begin(); it != mBufferStatusQueues.end(); ++it) {
-        BufferStatusMessage message;
-        size_t avail = it->second->availableToRead();
-        while (avail > 0) {
-            if (!it->second->read(&message, 1)) {
-                // Since avaliable # of reads are already confirmed,
-                // this should not happen.
-                // TODO: error handling (spurious client?)
-                ALOGW("FMQ message cannot be read from %lld", (long long)it->first);
-                return;
-            }
-            message.connectionId = it->first;
-            messages.push_back(message);
-            --avail;
+        if (!readBufferStatusChanges(it->first, it->second.get(), messages)) {
+            return;
         }
     }
 }
 
+void BufferStatusObserver::getBufferStatusChanges(
+        ConnectionId id, std::vector<BufferStatusMessage> &messages) {
+    auto it = mBufferStatusQueues.find(id);
+    if (it != mBufferStatusQueues.end()) {
+        (void)readBufferStatusChanges(it->first, it->second.get(), messages);
+    }
+}
+
 BufferStatusChannel::BufferStatusChannel(
         const StatusDescriptor &fmqDesc) {
     std::unique_ptr<BufferStatusQueue> queue =
@@ -78,6 +78,14 @@ public:
      * @param messages  retrieved pending messages.
      */
     void getBufferStatusChanges(std::vector<BufferStatusMessage> &messages);
+
+    /** Retrieves pending FMQ buffer status messages from a client.
+     *
+     * @param connectionId  connection Id of the client.
+     * @param messages      retrieved pending messages.
+     */
+    void getBufferStatusChanges(
+            ConnectionId id, std::vector<BufferStatusMessage> &messages);
 };
 
 /**
@@ -455,6 +455,7 @@ sp<ClientManager> ClientManager::getInstance() {
         sInstance = new ClientManager();
     }
     Accessor::createInvalidator();
+    Accessor::createStatusProcessor();
     return sInstance;
 }
 
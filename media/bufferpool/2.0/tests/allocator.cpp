@@ -203,7 +203,11 @@ bool TestBufferPoolAllocator::Verify(const native_handle_t *handle, const unsign
 
 void getTestAllocatorParams(std::vector<uint8_t> *params) {
   constexpr static int kAllocationSize = 1024 * 10;
-  Params ashmemParams(kAllocationSize);
+  getTestAllocatorParams(params, kAllocationSize);
+}
+
+void getTestAllocatorParams(std::vector<uint8_t> *params, uint32_t capacity) {
+  Params ashmemParams(capacity);
 
   params->assign(ashmemParams.array, ashmemParams.array + sizeof(ashmemParams));
 }
@@ -48,4 +48,7 @@ class TestBufferPoolAllocator : public BufferPoolAllocator {
 // retrieve buffer allocator paramters
 void getTestAllocatorParams(std::vector<uint8_t> *params);
 
+// retrieve buffer allocator paramters for the specified capacity
+void getTestAllocatorParams(std::vector<uint8_t> *params, uint32_t capacity);
+
 #endif  // VNDK_HIDL_BUFFERPOOL_V2_0_ALLOCATOR_H
@@ -132,6 +132,31 @@ TEST_F(BufferpoolSingleTest, RecycleBuffer) {
   EXPECT_TRUE(kNumRecycleTest > 1);
 }
 
+// Buffer recycle test with interleaved allocation sizes.
+// Check whether de-allocated buffers are recycled for the same size only.
+TEST_F(BufferpoolSingleTest, RecycleBufferBySize) {
+  ResultStatus status;
+  std::vector<uint8_t> vecParams[2];
+  getTestAllocatorParams(&vecParams[0], 1024 * 10);
+  getTestAllocatorParams(&vecParams[1], 1024 * 20);
+
+  BufferId bid[kNumRecycleTest][2];
+  for (int i = 0; i < kNumRecycleTest; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      std::shared_ptr<BufferPoolData> buffer;
+      native_handle_t *allocHandle = nullptr;
+      status = mManager->allocate(mConnectionId, vecParams[j], &allocHandle, &buffer);
+      ASSERT_TRUE(status == ResultStatus::OK);
+      bid[i][j] = buffer->mId;
+    }
+  }
+  ASSERT_TRUE(bid[0][0] != bid[0][1]);
+  for (int i = 1; i < kNumRecycleTest; ++i) {
+    ASSERT_TRUE(bid[i - 1][0] == bid[i][0]);
+    ASSERT_TRUE(bid[i - 1][1] == bid[i][1]);
+  }
+}
+
 // Buffer transfer test.
 // Check whether buffer is transferred to another client successfully.
 TEST_F(BufferpoolSingleTest, TransferBuffer) {
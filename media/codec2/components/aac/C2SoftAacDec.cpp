@@ -71,7 +71,8 @@ public:
 
         addParameter(
                 DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
-                .withConstValue(new C2PortActualDelayTuning::output(2u))
+                .withConstValue(new C2PortActualDelayTuning::output(
+                        2u + AudioOutputBatch::GetMaxWorks() - 1))
                 .build());
 
         addParameter(
@@ -229,7 +230,8 @@ C2SoftAacDec::C2SoftAacDec(
       mAACDecoder(nullptr),
       mStreamInfo(nullptr),
       mSignalledError(false),
-      mOutputDelayRingBuffer(nullptr) {
+      mOutputDelayRingBuffer(nullptr),
+      mOutputBatch(this, AudioOutputBatch::GetMaxWorks()) {
 }
 
 C2SoftAacDec::~C2SoftAacDec() {
@@ -249,6 +251,7 @@ c2_status_t C2SoftAacDec::onStop() {
     mOutputDelayRingBufferReadPos = 0;
     mOutputDelayRingBufferFilled = 0;
     mBuffersInfo.clear();
+    mOutputBatch.clear();
 
     // To make the codec behave the same before and after a reset, we need to invalidate the
     // streaminfo struct. This does that:
@@ -447,62 +450,55 @@ void C2SoftAacDec::drainRingBuffer(
                 numSamples, available, numFrames);
         ALOGV("getting %d from ringbuffer", numSamples);
 
-        std::shared_ptr<C2LinearBlock> block;
-        std::function<void(const std::unique_ptr<C2Work>&)> fillWork =
-            [&block, numSamples, pool, this]()
-                    -> std::function<void(const std::unique_ptr<C2Work>&)> {
-                auto fillEmptyWork = [](
-                        const std::unique_ptr<C2Work> &work, c2_status_t err) {
-                    work->result = err;
-                    C2FrameData &output = work->worklets.front()->output;
-                    output.flags = work->input.flags;
-                    output.buffers.clear();
-                    output.ordinal = work->input.ordinal;
-
-                    work->workletsProcessed = 1u;
-                };
+        auto failWork = [&outInfo, &work, this](c2_status_t err) {
+            mOutputBatch.flush(work);
+            auto fillEmptyWork = [err](const std::unique_ptr<C2Work> &work) {
+                work->result = err;
+                C2FrameData &output = work->worklets.front()->output;
+                output.flags = work->input.flags;
+                output.buffers.clear();
+                output.ordinal = work->input.ordinal;
+
+                work->workletsProcessed = 1u;
+            };
+            if (work && work->input.ordinal.frameIndex == c2_cntr64_t(outInfo.frameIndex)) {
+                fillEmptyWork(work);
+            } else {
+                finish(outInfo.frameIndex, fillEmptyWork);
+            }
+        };
 
-                using namespace std::placeholders;
-                if (numSamples == 0) {
-                    return std::bind(fillEmptyWork, _1, C2_OK);
-                }
+        if (outInfo.formatChanged) {
+            // keep samples of the old and the new format in separate blocks
+            mOutputBatch.flush(work);
+        }
 
-                // TODO: error handling, proper usage, etc.
-                C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
-                c2_status_t err = pool->fetchLinearBlock(
-                        numSamples * sizeof(int16_t), usage, &block);
-                if (err != C2_OK) {
-                    ALOGD("failed to fetch a linear block (%d)", err);
-                    return std::bind(fillEmptyWork, _1, C2_NO_MEMORY);
-                }
-                C2WriteView wView = block->map().get();
-                // TODO
-                INT_PCM *outBuffer = reinterpret_cast<INT_PCM *>(wView.data());
-                int32_t ns = outputDelayRingBufferGetSamples(outBuffer, numSamples);
-                if (ns != numSamples) {
-                    ALOGE("not a complete frame of samples available");
-                    mSignalledError = true;
-                    return std::bind(fillEmptyWork, _1, C2_CORRUPTED);
-                }
-                return [buffer = createLinearBuffer(block)](
-                        const std::unique_ptr<C2Work> &work) {
-                    work->result = C2_OK;
-                    C2FrameData &output = work->worklets.front()->output;
-                    output.flags = work->input.flags;
-                    output.buffers.clear();
-                    output.buffers.push_back(buffer);
-                    output.ordinal = work->input.ordinal;
-                    work->workletsProcessed = 1u;
-                };
-            }();
-
-        if (work && work->input.ordinal.frameIndex == c2_cntr64_t(outInfo.frameIndex)) {
-            fillWork(work);
-        } else {
-            finish(outInfo.frameIndex, fillWork);
+        size_t outSize = 0;
+        if (numSamples > 0) {
+            uint8_t *outData = nullptr;
+            c2_status_t err = mOutputBatch.dequeue(
+                    numSamples * sizeof(int16_t), pool, work, &outData);
+            if (err != C2_OK) {
+                ALOGD("failed to fetch a linear block (%d)", err);
+                failWork(C2_NO_MEMORY);
+                mBuffersInfo.pop_front();
+                continue;
+            }
+            INT_PCM *outBuffer = reinterpret_cast<INT_PCM *>(outData);
+            int32_t ns = outputDelayRingBufferGetSamples(outBuffer, numSamples);
+            if (ns != numSamples) {
+                ALOGE("not a complete frame of samples available");
+                mSignalledError = true;
+                failWork(C2_CORRUPTED);
+                mBuffersInfo.pop_front();
+                continue;
+            }
+            outSize = numSamples * sizeof(int16_t);
         }
+        // the output of several works goes out in one block, see drainInternal()
+        mOutputBatch.queue(outInfo.frameIndex, outSize, work, false /* last */);
 
-        ALOGV("out timestamp %" PRIu64 " / %u", outInfo.timestamp, block ? block->capacity() : 0);
+        ALOGV("out timestamp %" PRIu64 " / %zu", outInfo.timestamp, outSize);
         mBuffersInfo.pop_front();
     }
 }
@@ -570,6 +566,7 @@ void C2SoftAacDec::process(
     inInfo.timestamp = work->input.ordinal.timestamp.peeku();
     inInfo.bufferSize = size;
     inInfo.decodedSizes.clear();
+    inInfo.formatChanged = false;
     while (size > 0u) {
         ALOGV("size = %zu", size);
         if (mIntf->isAdts()) {
@@ -754,6 +751,7 @@ void C2SoftAacDec::process(
                     C2FrameData &output = work->worklets.front()->output;
                     output.configUpdate.push_back(C2Param::Copy(sampleRateInfo));
                     output.configUpdate.push_back(C2Param::Copy(channelCountInfo));
+                    inInfo.formatChanged = true;
                 } else {
                     ALOGE("Config Update failed");
                     mSignalledError = true;
@@ -805,6 +803,7 @@ c2_status_t C2SoftAacDec::drainInternal(
 
     drainDecoder();
     drainRingBuffer(work, pool, eos);
+    mOutputBatch.flush(work);
 
     if (eos) {
         auto fillEmptyWork = [](const std::unique_ptr<C2Work> &work) {
@@ -835,6 +834,7 @@ c2_status_t C2SoftAacDec::drain(
 c2_status_t C2SoftAacDec::onFlush_sm() {
     drainDecoder();
     mBuffersInfo.clear();
+    mOutputBatch.clear();
 
     int avail;
     while ((avail = outputDelayRingBufferSamplesAvailable()) > 0) {
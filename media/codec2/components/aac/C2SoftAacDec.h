@@ -62,6 +62,7 @@ private:
         size_t bufferSize;
         uint64_t timestamp;
         std::vector<int32_t> decodedSizes;
+        bool formatChanged;
     };
     std::list<Info> mBuffersInfo;
 
@@ -101,6 +102,8 @@ private:
     int32_t outputDelayRingBufferSamplesAvailable();
     int32_t outputDelayRingBufferSpaceLeft();
 
+    AudioOutputBatch mOutputBatch;
+
     C2_DO_NOT_COPY(C2SoftAacDec);
 };
 
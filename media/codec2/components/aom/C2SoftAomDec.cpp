@@ -501,32 +501,35 @@ void C2SoftAomDec::process(const std::unique_ptr<C2Work>& work,
     }
 }
 
+// Copies |height| rows of a plane, in one go when both sides use the same stride.
+static void copyPlane(
+        uint8_t *dst, const uint8_t *src, size_t dstStride, size_t srcStride,
+        size_t width, size_t height) {
+    if (height == 0) {
+        return;
+    }
+    if (dstStride == srcStride) {
+        memcpy(dst, src, dstStride * (height - 1) + width);
+        return;
+    }
+    for (size_t i = 0; i < height; ++i) {
+        memcpy(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 static void copyOutputBufferToYuvPlanarFrame(
         uint8_t *dst, const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV,
         size_t srcYStride, size_t srcUStride, size_t srcVStride,
         size_t dstYStride, size_t dstUVStride,
         uint32_t width, uint32_t height) {
-    uint8_t* dstStart = dst;
+    uint8_t *dstV = dst + dstYStride * height;
+    uint8_t *dstU = dstV + dstUVStride * height / 2;
 
-    for (size_t i = 0; i < height; ++i) {
-        memcpy(dst, srcY, width);
-        srcY += srcYStride;
-        dst += dstYStride;
-    }
-
-    dst = dstStart + dstYStride * height;
-    for (size_t i = 0; i < height / 2; ++i) {
-         memcpy(dst, srcV, width / 2);
-        srcV += srcVStride;
-        dst += dstUVStride;
-    }
-
-    dst = dstStart + (dstYStride * height) + (dstUVStride * height / 2);
-    for (size_t i = 0; i < height / 2; ++i) {
-         memcpy(dst, srcU, width / 2);
-        srcU += srcUStride;
-        dst += dstUVStride;
-    }
+    copyPlane(dst, srcY, dstYStride, srcYStride, width, height);
+    copyPlane(dstV, srcV, dstUVStride, srcVStride, width / 2, height / 2);
+    copyPlane(dstU, srcU, dstUVStride, srcUStride, width / 2, height / 2);
 }
 
 static void convertYUV420Planar16ToY410(uint32_t *dst,
@@ -64,6 +64,13 @@ public:
                 .withConstValue(new C2ComponentAttributesSetting(C2Component::ATTRIB_IS_TEMPORAL))
                 .build());
 
+        addParameter(
+                DefineParam(mThreadCount, C2_PARAMKEY_THREAD_COUNT)
+                .withDefault(new C2ThreadCountTuning(0u))
+                .withFields({C2F(mThreadCount, value).inRange(0, MAX_NUM_CORES)})
+                .withSetter(Setter<decltype(*mThreadCount)>::StrictValueWithNoDeps)
+                .build());
+
         // coded and output picture size is the same for this codec
         addParameter(
                 DefineParam(mSize, C2_PARAMKEY_PICTURE_SIZE)
@@ -289,6 +296,8 @@ public:
         return mColorAspects;
     }
 
+    uint32_t getThreadCount_l() const { return mThreadCount->value; }
+
 private:
     std::shared_ptr<C2StreamProfileLevelInfo::input> mProfileLevel;
     std::shared_ptr<C2StreamPictureSizeInfo::output> mSize;
@@ -299,21 +308,9 @@ private:
     std::shared_ptr<C2StreamColorAspectsTuning::output> mDefaultColorAspects;
     std::shared_ptr<C2StreamColorAspectsInfo::output> mColorAspects;
     std::shared_ptr<C2StreamPixelFormatInfo::output> mPixelFormat;
+    std::shared_ptr<C2ThreadCountTuning> mThreadCount;
 };
 
-static size_t getCpuCoreCount() {
-    long cpuCoreCount = 1;
-#if defined(_SC_NPROCESSORS_ONLN)
-    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
-#else
-    // _SC_NPROC_ONLN must be defined...
-    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
-#endif
-    CHECK(cpuCoreCount >= 1);
-    ALOGV("Number of CPU cores: %ld", cpuCoreCount);
-    return (size_t)cpuCoreCount;
-}
-
 static void *ivd_aligned_malloc(void *ctxt, WORD32 alignment, WORD32 size) {
     (void) ctxt;
     return memalign(alignment, size);
@@ -496,7 +493,10 @@ void C2SoftAvcDec::getVersion() {
 
 status_t C2SoftAvcDec::initDecoder() {
     if (OK != createDecoder()) return UNKNOWN_ERROR;
-    mNumCores = MIN(getCpuCoreCount(), MAX_NUM_CORES);
+    {
+        IntfImpl::Lock lock = mIntf->lock();
+        mNumCores = reserveThreads(mIntf->getThreadCount_l(), MAX_NUM_CORES);
+    }
     mStride = ALIGN64(mWidth);
     mSignalledError = false;
     resetPlugin();
@@ -651,6 +651,7 @@ void C2SoftAvcDec::resetPlugin() {
 }
 
 status_t C2SoftAvcDec::deleteDecoder() {
+    releaseThreads();
     if (mDecHandle) {
         ivdext_delete_ip_t s_delete_ip;
         ivdext_delete_op_t s_delete_op;
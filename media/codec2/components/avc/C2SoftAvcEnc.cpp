@@ -101,6 +101,13 @@ public:
                     C2Component::ATTRIB_IS_TEMPORAL))
                 .build());
 
+        addParameter(
+                DefineParam(mThreadCount, C2_PARAMKEY_THREAD_COUNT)
+                .withDefault(new C2ThreadCountTuning(0u))
+                .withFields({C2F(mThreadCount, value).inRange(0, CODEC_MAX_CORES)})
+                .withSetter(Setter<decltype(*mThreadCount)>::StrictValueWithNoDeps)
+                .build());
+
         addParameter(
                 DefineParam(mSize, C2_PARAMKEY_PICTURE_SIZE)
                 .withDefault(new C2StreamPictureSizeInfo::input(0u, 320, 240))
@@ -393,6 +400,7 @@ public:
     std::shared_ptr<C2StreamBitrateInfo::output> getBitrate_l() const { return mBitrate; }
     std::shared_ptr<C2StreamRequestSyncFrameTuning::output> getRequestSync_l() const { return mRequestSync; }
     std::shared_ptr<C2StreamGopTuning::output> getGop_l() const { return mGop; }
+    uint32_t getThreadCount_l() const { return mThreadCount->value; }
 
 private:
     std::shared_ptr<C2StreamUsageTuning::input> mUsage;
@@ -404,6 +412,7 @@ private:
     std::shared_ptr<C2StreamProfileLevelInfo::output> mProfileLevel;
     std::shared_ptr<C2StreamSyncFrameIntervalTuning::output> mSyncFramePeriod;
     std::shared_ptr<C2StreamGopTuning::output> mGop;
+    std::shared_ptr<C2ThreadCountTuning> mThreadCount;
 };
 
 #define ive_api_function  ih264e_api_function
@@ -413,19 +422,6 @@ namespace {
 // From external/libavc/encoder/ih264e_bitstream.h
 constexpr uint32_t MIN_STREAM_SIZE = 0x800;
 
-static size_t GetCPUCoreCount() {
-    long cpuCoreCount = 1;
-#if defined(_SC_NPROCESSORS_ONLN)
-    cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
-#else
-    // _SC_NPROC_ONLN must be defined...
-    cpuCoreCount = sysconf(_SC_NPROC_ONLN);
-#endif
-    CHECK(cpuCoreCount >= 1);
-    ALOGV("Number of CPU cores: %ld", cpuCoreCount);
-    return (size_t)cpuCoreCount;
-}
-
 }  // namespace
 
 C2SoftAvcEnc::C2SoftAvcEnc(
@@ -489,7 +485,7 @@ void  C2SoftAvcEnc::initEncParams() {
     mMemRecords = nullptr;
     mNumMemRecords = DEFAULT_MEM_REC_CNT;
     mHeaderGenerated = 0;
-    mNumCores = GetCPUCoreCount();
+    mNumCores = 1;
     mArch = DEFAULT_ARCH;
     mSliceMode = DEFAULT_SLICE_MODE;
     mSliceParam = DEFAULT_SLICE_PARAM;
@@ -927,6 +923,7 @@ c2_status_t C2SoftAvcEnc::initEncoder() {
         mIInterval = mIntf->getSyncFramePeriod_l();
         mIDRInterval = mIntf->getSyncFramePeriod_l();
         gop = mIntf->getGop_l();
+        mNumCores = reserveThreads(mIntf->getThreadCount_l(), CODEC_MAX_CORES);
     }
     if (gop && gop->flexCount() > 0) {
         uint32_t syncInterval = 1;
@@ -1160,6 +1157,7 @@ c2_status_t C2SoftAvcEnc::releaseEncoder() {
     iv_retrieve_mem_rec_op_t s_retrieve_mem_op;
     iv_mem_rec_t *ps_mem_rec;
 
+    releaseThreads();
     if (!mStarted) {
         return C2_OK;
     }
@@ -22,6 +22,10 @@
 #include <media/stagefright/foundation/AMessage.h>
 
 #include <inttypes.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 
 #include <C2Config.h>
 #include <C2Debug.h>
@@ -52,6 +56,13 @@ uint32_t SimpleC2Component::WorkQueue::drainMode() const {
     return mQueue.front().drainMode;
 }
 
+bool SimpleC2Component::WorkQueue::needsSerialProcessing() const {
+    const Entry &entry = mQueue.front();
+    return mFlush || entry.drainMode != NO_DRAIN || !entry.work
+            || !entry.work->input.configUpdate.empty()
+            || (entry.work->input.flags & C2FrameData::FLAG_END_OF_STREAM);
+}
+
 void SimpleC2Component::WorkQueue::markDrain(uint32_t drainMode) {
     mQueue.push_back({ nullptr, drainMode });
 }
@@ -99,6 +110,13 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
             }
             break;
         }
+        case kWhatParallelDone: {
+            // works in flight free up and may unblock the queue.
+            if (thiz->deliverParallelWorks() && mRunning) {
+                (new AMessage(kWhatProcess, this))->post();
+            }
+            break;
+        }
         case kWhatInit: {
             int32_t err = thiz->onInit();
             Reply(msg, &err);
@@ -109,17 +127,20 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
             break;
         }
         case kWhatStop: {
+            thiz->waitForParallelWorks();
             int32_t err = thiz->onStop();
             Reply(msg, &err);
             break;
         }
         case kWhatReset: {
+            thiz->waitForParallelWorks();
             thiz->onReset();
             mRunning = false;
             Reply(msg);
             break;
         }
         case kWhatRelease: {
+            thiz->waitForParallelWorks();
             thiz->onRelease();
             mRunning = false;
             Reply(msg);
@@ -184,6 +205,31 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+SimpleC2Component::ParallelHandler::ParallelHandler(
+        const std::shared_ptr<SimpleC2Component> &thiz) : mThiz(thiz) {}
+
+void SimpleC2Component::ParallelHandler::onMessageReceived(const sp<AMessage> &msg) {
+    std::shared_ptr<SimpleC2Component> thiz = mThiz.lock();
+    if (!thiz) {
+        ALOGD("component not yet set; msg = %s", msg->debugString().c_str());
+        return;
+    }
+    switch (msg->what()) {
+        case kWhatProcess: {
+            int64_t seq;
+            CHECK(msg->findInt64("seq", &seq));
+            thiz->processParallel((uint64_t)seq);
+            break;
+        }
+        default: {
+            ALOGD("Unrecognized msg: %d", msg->what());
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 namespace {
 
 struct DummyReadView : public C2ReadView {
@@ -197,7 +243,8 @@ SimpleC2Component::SimpleC2Component(
     : mDummyReadView(DummyReadView()),
       mIntf(intf),
       mLooper(new ALooper),
-      mHandler(new WorkHandler) {
+      mHandler(new WorkHandler),
+      mThreadsReserved(false) {
     mLooper->setName(intf->getName().c_str());
     (void)mLooper->registerHandler(mHandler);
     mLooper->start(false, false, ANDROID_PRIORITY_VIDEO);
@@ -206,6 +253,11 @@ SimpleC2Component::SimpleC2Component(
 SimpleC2Component::~SimpleC2Component() {
     mLooper->unregisterHandler(mHandler->id());
     (void)mLooper->stop();
+    for (size_t i = 0; i < mParallelLoopers.size(); ++i) {
+        mParallelLoopers[i]->unregisterHandler(mParallelHandlers[i]->id());
+        (void)mParallelLoopers[i]->stop();
+    }
+    releaseThreads();
 }
 
 c2_status_t SimpleC2Component::setListener_vb(
@@ -440,11 +492,24 @@ bool SimpleC2Component::processQueue() {
     int32_t drainMode;
     bool isFlushPending = false;
     bool hasQueuedWork = false;
+    const size_t maxParallelWorks = getMaxParallelWorks();
+    size_t worksInFlight = 0;
+    if (maxParallelWorks > 1) {
+        worksInFlight = mParallelState.lock()->mWorks.size();
+        if (worksInFlight >= maxParallelWorks) {
+            // deliverParallelWorks() resumes the queue.
+            return false;
+        }
+    }
     {
         Mutexed<WorkQueue>::Locked queue(mWorkQueue);
         if (queue->empty()) {
             return false;
         }
+        if (worksInFlight > 0 && queue->needsSerialProcessing()) {
+            ALOGV("waiting for %zu works in flight", worksInFlight);
+            return false;
+        }
 
         generation = queue->generation();
         drainMode = queue->drainMode();
@@ -541,8 +606,40 @@ bool SimpleC2Component::processQueue() {
         ALOGD("Encountered null input buffer. Clearing the input buffer");
         work->input.buffers.clear();
     }
+    if (maxParallelWorks > 1) {
+        if (mParallelLoopers.empty()) {
+            for (size_t i = 0; i < maxParallelWorks; ++i) {
+                sp<ALooper> looper = new ALooper;
+                looper->setName((intf()->getName() + "." + std::to_string(i)).c_str());
+                sp<ParallelHandler> handler = new ParallelHandler(shared_from_this());
+                (void)looper->registerHandler(handler);
+                looper->start(false, false, ANDROID_PRIORITY_VIDEO);
+                mParallelLoopers.push_back(looper);
+                mParallelHandlers.push_back(handler);
+            }
+        }
+        uint64_t seq;
+        {
+            Mutexed<ParallelState>::Locked state(mParallelState);
+            seq = state->mNextSeq++;
+            state->mWorks.emplace(seq, ParallelWork{ std::move(work), generation, false });
+        }
+        // at most maxParallelWorks consecutive works are in flight, so each
+        // one finds its handler idle.
+        sp<AMessage> msg = new AMessage(
+                ParallelHandler::kWhatProcess,
+                mParallelHandlers[seq % mParallelHandlers.size()]);
+        msg->setInt64("seq", (int64_t)seq);
+        msg->post();
+        return hasQueuedWork;
+    }
     process(work, mOutputBlockPool);
     ALOGV("processed frame #%" PRIu64, work->input.ordinal.frameIndex.peeku());
+    onWorkProcessed(std::move(work), generation);
+    return hasQueuedWork;
+}
+
+void SimpleC2Component::onWorkProcessed(std::unique_ptr<C2Work> work, uint64_t generation) {
     Mutexed<WorkQueue>::Locked queue(mWorkQueue);
     if (queue->generation() != generation) {
         ALOGD("work form old generation: was %" PRIu64 " now %" PRIu64,
@@ -554,7 +651,7 @@ bool SimpleC2Component::processQueue() {
         std::shared_ptr<C2Component::Listener> listener = state->mListener;
         state.unlock();
         listener->onWorkDone_nb(shared_from_this(), vec(work));
-        return hasQueuedWork;
+        return;
     }
     if (work->workletsProcessed != 0u) {
         queue.unlock();
@@ -585,7 +682,109 @@ bool SimpleC2Component::processQueue() {
             listener->onWorkDone_nb(shared_from_this(), vec(unexpected));
         }
     }
-    return hasQueuedWork;
+}
+
+void SimpleC2Component::processParallel(uint64_t seq) {
+    const std::unique_ptr<C2Work> *work;
+    {
+        Mutexed<ParallelState>::Locked state(mParallelState);
+        auto it = state->mWorks.find(seq);
+        if (it == state->mWorks.end()) {
+            // dropped by stop, reset or release.
+            return;
+        }
+        work = &it->second.work;
+        ++state->mRunning;
+    }
+    process(*work, mOutputBlockPool);
+    ALOGV("processed frame #%" PRIu64, (*work)->input.ordinal.frameIndex.peeku());
+    std::unique_ptr<C2Work> pendingWork;
+    uint64_t generation = 0;
+    {
+        Mutexed<ParallelState>::Locked state(mParallelState);
+        --state->mRunning;
+        ParallelWork &entry = state->mWorks.at(seq);
+        entry.processed = true;
+        if (entry.work->workletsProcessed == 0u) {
+            pendingWork = std::move(entry.work);
+            generation = entry.generation;
+        }
+        state->mCondition.broadcast();
+    }
+    if (pendingWork) {
+        // make it pending right away, so that finish() from the processing
+        // of a later work finds it.
+        onWorkProcessed(std::move(pendingWork), generation);
+    }
+    (new AMessage(WorkHandler::kWhatParallelDone, mHandler))->post();
+}
+
+bool SimpleC2Component::deliverParallelWorks() {
+    bool delivered = false;
+    for (;;) {
+        std::unique_ptr<C2Work> work;
+        uint64_t generation;
+        {
+            Mutexed<ParallelState>::Locked state(mParallelState);
+            auto it = state->mWorks.begin();
+            if (it == state->mWorks.end() || !it->second.processed) {
+                break;
+            }
+            work = std::move(it->second.work);
+            generation = it->second.generation;
+            state->mWorks.erase(it);
+        }
+        if (work) {
+            onWorkProcessed(std::move(work), generation);
+        }
+        delivered = true;
+    }
+    return delivered;
+}
+
+void SimpleC2Component::waitForParallelWorks() {
+    Mutexed<ParallelState>::Locked state(mParallelState);
+    while (state->mRunning > 0) {
+        state.waitForCondition(state->mCondition);
+    }
+    // the queue has been cleared, drop the works in flight as well.
+    state->mWorks.clear();
+}
+
+namespace {
+
+// software components of this process holding a thread reservation
+std::atomic<size_t> sNumThreadedComponents(0);
+
+size_t getCpuCoreCount() {
+    long cpuCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpuCoreCount >= 1 ? (size_t)cpuCoreCount : 1;
+}
+
+}  // namespace
+
+size_t SimpleC2Component::reserveThreads(uint32_t requested, size_t maxThreads) {
+    if (!mThreadsReserved) {
+        ++sNumThreadedComponents;
+        mThreadsReserved = true;
+    }
+    size_t numThreads = requested;
+    if (numThreads == 0) {
+        // instances started earlier keep their threads, so this only
+        // approximates an even split.
+        numThreads = getCpuCoreCount() / std::max(sNumThreadedComponents.load(), (size_t)1);
+    }
+    numThreads = std::max(std::min(numThreads, maxThreads), (size_t)1);
+    ALOGV("%s: %zu threads (requested %u, %zu components)", mIntf->getName().c_str(),
+            numThreads, requested, sNumThreadedComponents.load());
+    return numThreads;
+}
+
+void SimpleC2Component::releaseThreads() {
+    if (mThreadsReserved) {
+        --sNumThreadedComponents;
+        mThreadsReserved = false;
+    }
 }
 
 std::shared_ptr<C2Buffer> SimpleC2Component::createLinearBuffer(
@@ -608,4 +807,136 @@ std::shared_ptr<C2Buffer> SimpleC2Component::createGraphicBuffer(
     return C2Buffer::CreateGraphicBuffer(block->share(crop, ::C2Fence()));
 }
 
+namespace {
+
+constexpr size_t kMaxAudioBatchWorks = 16;
+
+void fillBatchWork(
+        const std::unique_ptr<C2Work> &work, const std::shared_ptr<C2Buffer> &buffer) {
+    C2FrameData &output = work->worklets.front()->output;
+    output.flags = work->input.flags;
+    output.buffers.clear();
+    if (buffer) {
+        output.buffers.push_back(buffer);
+    }
+    output.ordinal = work->input.ordinal;
+    work->workletsProcessed = 1u;
+}
+
+bool isCurrentWork(const std::unique_ptr<C2Work> &currentWork, uint64_t frameIndex) {
+    return currentWork && currentWork->input.ordinal.frameIndex == c2_cntr64_t(frameIndex);
+}
+
+}  // namespace
+
+SimpleC2Component::AudioOutputBatch::AudioOutputBatch(
+        SimpleC2Component *component, size_t maxWorks)
+    : mComponent(component),
+      mMaxWorks(std::min(std::max(maxWorks, (size_t)1), kMaxAudioBatchWorks)),
+      mSize(0) {
+}
+
+// static
+size_t SimpleC2Component::AudioOutputBatch::GetMaxWorks() {
+    int32_t maxWorks = property_get_int32("debug.stagefright.c2_audio_batch_works", 4);
+    return std::min((size_t)std::max(maxWorks, 1), kMaxAudioBatchWorks);
+}
+
+c2_status_t SimpleC2Component::AudioOutputBatch::dequeue(
+        size_t maxBytes,
+        const std::shared_ptr<C2BlockPool> &pool,
+        const std::unique_ptr<C2Work> &currentWork,
+        uint8_t **data) {
+    if (mBlock && mSize + maxBytes > mBlock->capacity()) {
+        flush(currentWork);
+        if (mBlock && maxBytes > mBlock->capacity()) {
+            // an unused block for a smaller output, e.g. before a channel count change
+            mView.reset();
+            mBlock.reset();
+        }
+    }
+    if (!mBlock) {
+        C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
+        c2_status_t err = pool->fetchLinearBlock(maxBytes * mMaxWorks, usage, &mBlock);
+        if (err != C2_OK) {
+            ALOGE("fetchLinearBlock for Output failed with status %d", err);
+            mBlock.reset();
+            return err;
+        }
+        mView.reset(new C2WriteView(mBlock->map().get()));
+        if (mView->error()) {
+            err = mView->error();
+            ALOGE("write view map failed %d", err);
+            mView.reset();
+            mBlock.reset();
+            return err;
+        }
+        mSize = 0;
+    }
+    *data = mView->data() + mSize;
+    return C2_OK;
+}
+
+void SimpleC2Component::AudioOutputBatch::queue(
+        uint64_t frameIndex,
+        size_t size,
+        const std::unique_ptr<C2Work> &currentWork,
+        bool last) {
+    if (mFrameIndices.empty() && size == 0) {
+        // nothing to return the work with later, and no reason to hold it
+        if (isCurrentWork(currentWork, frameIndex)) {
+            fillBatchWork(currentWork, nullptr);
+        } else {
+            mComponent->finish(frameIndex, [](const std::unique_ptr<C2Work> &work) {
+                fillBatchWork(work, nullptr);
+            });
+        }
+        return;
+    }
+    mSize += size;
+    mFrameIndices.push_back(frameIndex);
+    if (isCurrentWork(currentWork, frameIndex)) {
+        // hold the work until the batch is returned
+        currentWork->workletsProcessed = 0u;
+    }
+    if (last || mFrameIndices.size() >= mMaxWorks) {
+        flush(currentWork);
+    }
+}
+
+void SimpleC2Component::AudioOutputBatch::flush(const std::unique_ptr<C2Work> &currentWork) {
+    if (mFrameIndices.empty()) {
+        return;
+    }
+    std::shared_ptr<C2Buffer> buffer;
+    if (mSize > 0) {
+        buffer = mComponent->createLinearBuffer(mBlock, 0, mSize);
+    }
+    mView.reset();
+    mBlock.reset();
+    mSize = 0;
+
+    std::list<uint64_t> frameIndices;
+    frameIndices.swap(mFrameIndices);
+    for (uint64_t frameIndex : frameIndices) {
+        auto fillWork = [buffer](const std::unique_ptr<C2Work> &work) {
+            fillBatchWork(work, buffer);
+        };
+        if (isCurrentWork(currentWork, frameIndex)) {
+            fillWork(currentWork);
+        } else {
+            mComponent->finish(frameIndex, fillWork);
+        }
+        // the other works of the batch return empty
+        buffer.reset();
+    }
+}
+
+void SimpleC2Component::AudioOutputBatch::clear() {
+    mView.reset();
+    mBlock.reset();
+    mSize = 0;
+    mFrameIndices.clear();
+}
+
 } // namespace android
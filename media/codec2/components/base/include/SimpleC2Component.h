@@ -18,7 +18,9 @@
 #define SIMPLE_C2_COMPONENT_H_
 
 #include <list>
+#include <map>
 #include <unordered_map>
+#include <vector>
 
 #include <C2Component.h>
 
@@ -52,6 +54,9 @@ public:
 
     // for handler
     bool processQueue();
+    bool deliverParallelWorks();
+    void processParallel(uint64_t seq);
+    void waitForParallelWorks();
 
 protected:
     /**
@@ -107,6 +112,20 @@ protected:
             uint32_t drainMode,
             const std::shared_ptr<C2BlockPool> &pool) = 0;
 
+    /**
+     * Returns the maximum number of works process() may run for at the same
+     * time, each on its own thread. The default of 1 processes the works one
+     * at a time on the component thread.
+     *
+     * A component returning more must keep process() safe to call
+     * concurrently, e.g. by keeping a codec context per thread, and its
+     * finish() and cloneAndSend() calls may come from those threads.
+     * Processed works are still returned in queue order, and drain(),
+     * onFlush_sm(), onStop(), onReset(), onRelease(), config updates and end
+     * of stream all wait for the works in flight.
+     */
+    virtual size_t getMaxParallelWorks() { return 1; }
+
     // for derived classes
     /**
      * Finish pending work.
@@ -139,6 +158,24 @@ protected:
             std::function<void(const std::unique_ptr<C2Work> &)> fillWork);
 
 
+    /**
+     * Reserve codec threads for this component among the software codecs
+     * of the process. Releases an earlier reservation of this component.
+     *
+     * \param[in]   requested     the thread count configured by the client,
+     *                            or 0 for a share of the CPU cores among
+     *                            the components holding a reservation.
+     * \param[in]   maxThreads    the most threads the codec can use.
+     *
+     * \return the number of threads to configure the codec with.
+     */
+    size_t reserveThreads(uint32_t requested, size_t maxThreads);
+
+    /**
+     * Release the thread reservation of this component, if any.
+     */
+    void releaseThreads();
+
     std::shared_ptr<C2Buffer> createLinearBuffer(
             const std::shared_ptr<C2LinearBlock> &block);
 
@@ -152,6 +189,76 @@ protected:
             const std::shared_ptr<C2GraphicBlock> &block,
             const C2Rect &crop);
 
+    /**
+     * Gathers the output of consecutive works of an audio decoder into one
+     * linear block, so that a stream of small frames does not cost a pool
+     * allocation and an output buffer per frame.
+     *
+     * The works of a batch are held until the batch is returned; the first
+     * one then carries the block and the others return empty, in order. A
+     * component using this must count the held works, up to the batch size
+     * minus one, in its output delay. With a batch size of 1 every work
+     * returns its own block right away.
+     */
+    class AudioOutputBatch {
+    public:
+        AudioOutputBatch(SimpleC2Component *component, size_t maxWorks);
+
+        /**
+         * Returns at least |maxBytes| of space in the batch block to write the
+         * output of the next work to. If the current batch has less space
+         * left it is returned first.
+         *
+         * \param[in]   maxBytes      the most bytes the next work may output.
+         * \param[in]   pool          the pool to fetch the block from.
+         * \param[in]   currentWork   the work under processing, or null.
+         * \param[out]  data          where to write the output.
+         */
+        c2_status_t dequeue(
+                size_t maxBytes,
+                const std::shared_ptr<C2BlockPool> &pool,
+                const std::unique_ptr<C2Work> &currentWork,
+                uint8_t **data);
+
+        /**
+         * Adds |size| bytes written at the space returned by dequeue() as the
+         * output of the work |frameIndex|. The work is either |currentWork| or
+         * a pending one. The batch is returned once it is full or if |last|
+         * is set, e.g. at end of stream.
+         */
+        void queue(
+                uint64_t frameIndex,
+                size_t size,
+                const std::unique_ptr<C2Work> &currentWork,
+                bool last);
+
+        /**
+         * Returns the works of the current batch. |currentWork| is filled
+         * directly if it is part of the batch.
+         */
+        void flush(const std::unique_ptr<C2Work> &currentWork);
+
+        /**
+         * Drops the current batch, e.g. when its works are flushed.
+         */
+        void clear();
+
+        size_t maxWorks() const { return mMaxWorks; }
+
+        /**
+         * Returns the batch size set by debug.stagefright.c2_audio_batch_works.
+         */
+        static size_t GetMaxWorks();
+
+    private:
+        SimpleC2Component *const mComponent;
+        const size_t mMaxWorks;
+        std::shared_ptr<C2LinearBlock> mBlock;
+        std::unique_ptr<C2WriteView> mView;
+        size_t mSize;
+        std::list<uint64_t> mFrameIndices;
+    };
+
     static constexpr uint32_t NO_DRAIN = ~0u;
 
     C2ReadView mDummyReadView;
@@ -163,6 +270,7 @@ private:
     public:
         enum {
             kWhatProcess,
+            kWhatParallelDone,
             kWhatInit,
             kWhatStart,
             kWhatStop,
@@ -213,6 +321,7 @@ private:
         void push_back(std::unique_ptr<C2Work> work);
         bool empty() const;
         uint32_t drainMode() const;
+        bool needsSerialProcessing() const;
         void markDrain(uint32_t drainMode);
         inline bool popPendingFlush() {
             bool flush = mFlush;
@@ -238,6 +347,48 @@ private:
     class BlockingBlockPool;
     std::shared_ptr<BlockingBlockPool> mOutputBlockPool;
 
+    class ParallelHandler : public AHandler {
+    public:
+        enum {
+            kWhatProcess,
+        };
+
+        explicit ParallelHandler(const std::shared_ptr<SimpleC2Component> &thiz);
+        ~ParallelHandler() override = default;
+
+    protected:
+        void onMessageReceived(const sp<AMessage> &msg) override;
+
+    private:
+        std::weak_ptr<SimpleC2Component> mThiz;
+    };
+
+    struct ParallelWork {
+        std::unique_ptr<C2Work> work;
+        uint64_t generation;
+        bool processed;
+    };
+
+    struct ParallelState {
+        ParallelState() : mNextSeq(0), mRunning(0) {}
+
+        uint64_t mNextSeq;
+        // works in flight by queue order
+        std::map<uint64_t, ParallelWork> mWorks;
+        // number of process() calls in progress
+        size_t mRunning;
+        Condition mCondition;
+    };
+    Mutexed<ParallelState> mParallelState;
+
+    // only accessed on the component thread
+    std::vector<sp<ALooper>> mParallelLoopers;
+    std::vector<sp<ParallelHandler>> mParallelHandlers;
+
+    void onWorkProcessed(std::unique_ptr<C2Work> work, uint64_t generation);
+
+    bool mThreadsReserved;
+
     SimpleC2Component() = delete;
 };
 
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Encodes synthetic frames on several instances of a software video encoder at once
+// and reports the frame rate of each instance and of all of them together, to compare
+// thread count settings (algo.thread-count) under concurrent load.
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "codec2bench"
+#include <log/log.h>
+
+#include <system/graphics.h>
+
+#include <C2AllocatorGralloc.h>
+#include <C2Buffer.h>
+#include <C2BufferPriv.h>
+#include <C2Component.h>
+#include <C2Config.h>
+#include <C2Debug.h>
+#include <C2PlatformSupport.h>
+#include <C2Work.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr size_t kMaxFramesInFlight = 4;
+
+class Instance : public C2Component::Listener,
+                 public std::enable_shared_from_this<Instance> {
+public:
+    Instance(size_t index, uint32_t width, uint32_t height, uint32_t threadCount)
+        : mIndex(index), mWidth(width), mHeight(height), mThreadCount(threadCount),
+          mDone(0), mError(false) {}
+    virtual ~Instance() = default;
+
+    virtual void onWorkDone_nb(std::weak_ptr<C2Component>,
+                               std::list<std::unique_ptr<C2Work>> workItems) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const std::unique_ptr<C2Work> &work : workItems) {
+            if (work->result != C2_OK) {
+                mError = true;
+            }
+            ++mDone;
+        }
+        mCondition.notify_all();
+    }
+
+    virtual void onTripped_nb(std::weak_ptr<C2Component>,
+                              std::vector<std::shared_ptr<C2SettingResult>>) override {}
+
+    virtual void onError_nb(std::weak_ptr<C2Component>, uint32_t errorCode) override {
+        ALOGE("instance %zu: error %u", mIndex, errorCode);
+        std::lock_guard<std::mutex> lock(mLock);
+        mError = true;
+        mCondition.notify_all();
+    }
+
+    bool setUp(const std::shared_ptr<C2ComponentStore> &store, const char *name) {
+        if (store->createComponent(name, &mComponent) != C2_OK) {
+            fprintf(stderr, "could not create %s\n", name);
+            return false;
+        }
+        (void)mComponent->setListener_vb(shared_from_this(), C2_DONT_BLOCK);
+
+        C2StreamPictureSizeInfo::input size(0u, mWidth, mHeight);
+        C2StreamFrameRateInfo::output frameRate(0u, 30.);
+        C2StreamBitrateInfo::output bitrate(0u, mWidth * mHeight * 4);
+        C2ThreadCountTuning threadCount(mThreadCount);
+        std::vector<std::unique_ptr<C2SettingResult>> failures;
+        c2_status_t err = mComponent->intf()->config_vb(
+                { &size, &frameRate, &bitrate, &threadCount }, C2_MAY_BLOCK, &failures);
+        if (err != C2_OK) {
+            fprintf(stderr, "instance %zu: config failed: %d\n", mIndex, err);
+            return false;
+        }
+
+        std::shared_ptr<C2AllocatorStore> allocatorStore = GetCodec2PlatformAllocatorStore();
+        std::shared_ptr<C2Allocator> allocator;
+        if (allocatorStore->fetchAllocator(C2AllocatorStore::DEFAULT_GRAPHIC, &allocator)
+                != C2_OK) {
+            fprintf(stderr, "no graphic allocator\n");
+            return false;
+        }
+        mPool = std::make_shared<C2BasicGraphicBlockPool>(allocator);
+        return mComponent->start() == C2_OK;
+    }
+
+    // Queues |numFrames| frames, keeping at most kMaxFramesInFlight in the component.
+    bool run(size_t numFrames) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            {
+                std::unique_lock<std::mutex> lock(mLock);
+                mCondition.wait(lock, [&] {
+                    return mError || frame - mDone < kMaxFramesInFlight;
+                });
+                if (mError) {
+                    break;
+                }
+            }
+            std::unique_ptr<C2Work> work = createWork(frame, frame + 1 == numFrames);
+            if (!work) {
+                return false;
+            }
+            std::list<std::unique_ptr<C2Work>> items;
+            items.push_back(std::move(work));
+            if (mComponent->queue_nb(&items) != C2_OK) {
+                return false;
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mCondition.wait(lock, [&] { return mError || mDone >= numFrames; });
+        }
+        mElapsed = std::chrono::steady_clock::now() - start;
+        (void)mComponent->stop();
+        (void)mComponent->release();
+        mComponent.reset();
+        return !mError;
+    }
+
+    double fps() const {
+        const double seconds = std::chrono::duration<double>(mElapsed).count();
+        return seconds > 0 ? mDone / seconds : 0;
+    }
+
+    size_t framesDone() const { return mDone; }
+
+private:
+    std::unique_ptr<C2Work> createWork(size_t frame, bool last) {
+        std::shared_ptr<C2GraphicBlock> block;
+        c2_status_t err = mPool->fetchGraphicBlock(
+                mWidth, mHeight, HAL_PIXEL_FORMAT_YV12,
+                { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE }, &block);
+        if (err != C2_OK) {
+            fprintf(stderr, "instance %zu: fetchGraphicBlock failed: %d\n", mIndex, err);
+            return nullptr;
+        }
+        {
+            C2GraphicView view = block->map().get();
+            if (view.error() != C2_OK) {
+                fprintf(stderr, "instance %zu: map failed: %d\n", mIndex, view.error());
+                return nullptr;
+            }
+            // a moving gradient, so that frames differ and motion search has work to do
+            const C2PlanarLayout &layout = view.layout();
+            for (uint32_t p = 0; p < layout.numPlanes; ++p) {
+                const C2PlaneInfo &plane = layout.planes[p];
+                uint8_t *data = view.data()[p];
+                const uint32_t width = mWidth / plane.colSampling;
+                const uint32_t height = mHeight / plane.rowSampling;
+                for (uint32_t y = 0; y < height; ++y) {
+                    uint8_t *row = data + (int32_t)y * plane.rowInc;
+                    for (uint32_t x = 0; x < width; ++x) {
+                        row[(int32_t)x * plane.colInc] = (uint8_t)(x + y + frame * 2);
+                    }
+                }
+            }
+        }
+
+        std::unique_ptr<C2Work> work(new C2Work);
+        work->input.flags = last ? C2FrameData::FLAG_END_OF_STREAM : (C2FrameData::flags_t)0;
+        work->input.ordinal.timestamp = frame * 33333;
+        work->input.ordinal.frameIndex = frame;
+        work->input.buffers.push_back(C2Buffer::CreateGraphicBuffer(
+                block->share(C2Rect(mWidth, mHeight), C2Fence())));
+        work->worklets.emplace_back(new C2Worklet);
+        return work;
+    }
+
+    const size_t mIndex;
+    const uint32_t mWidth;
+    const uint32_t mHeight;
+    const uint32_t mThreadCount;
+
+    std::shared_ptr<C2Component> mComponent;
+    std::shared_ptr<C2BlockPool> mPool;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    size_t mDone;
+    bool mError;
+    std::chrono::steady_clock::duration mElapsed;
+};
+
+}  // namespace
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [options]\n", me);
+    fprintf(stderr, "       -c component name (default c2.android.avc.encoder)\n");
+    fprintf(stderr, "       -n number of concurrent instances (default 1)\n");
+    fprintf(stderr, "       -t threads per instance, 0 to share the cores (default 0)\n");
+    fprintf(stderr, "       -f frames per instance (default 300)\n");
+    fprintf(stderr, "       -s WxH frame size (default 1280x720)\n");
+    fprintf(stderr, "       -h(elp)\n");
+}
+
+int main(int argc, char **argv) {
+    const char *name = "c2.android.avc.encoder";
+    size_t numInstances = 1;
+    uint32_t threadCount = 0;
+    size_t numFrames = 300;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+
+    int res;
+    while ((res = getopt(argc, argv, "c:n:t:f:s:h")) >= 0) {
+        switch (res) {
+            case 'c':
+                name = optarg;
+                break;
+            case 'n':
+                numInstances = strtoul(optarg, nullptr, 10);
+                break;
+            case 't':
+                threadCount = strtoul(optarg, nullptr, 10);
+                break;
+            case 'f':
+                numFrames = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                if (sscanf(optarg, "%ux%u", &width, &height) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (numInstances == 0 || numFrames == 0 || width == 0 || height == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::shared_ptr<C2ComponentStore> store = GetCodec2PlatformComponentStore();
+    std::vector<std::shared_ptr<Instance>> instances;
+    for (size_t i = 0; i < numInstances; ++i) {
+        instances.push_back(std::make_shared<Instance>(i, width, height, threadCount));
+        if (!instances.back()->setUp(store, name)) {
+            return 1;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    std::vector<char> ok(numInstances, false);
+    for (size_t i = 0; i < numInstances; ++i) {
+        threads.emplace_back([&instances, &ok, i, numFrames] {
+            ok[i] = instances[i]->run(numFrames);
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t totalFrames = 0;
+    for (size_t i = 0; i < numInstances; ++i) {
+        printf("instance %zu: %zu frames, %.1f fps%s\n", i, instances[i]->framesDone(),
+               instances[i]->fps(), ok[i] ? "" : " (failed)");
+        totalFrames += instances[i]->framesDone();
+    }
+    printf("%s %ux%u, %zu instances, thread count %u: %.1f fps aggregate\n",
+           name, width, height, numInstances, threadCount,
+           seconds > 0 ? totalFrames / seconds : 0);
+    return 0;
+}
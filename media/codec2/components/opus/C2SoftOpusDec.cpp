@@ -53,6 +53,13 @@ public:
         noTimeStretch();
         setDerivedInstance(this);
 
+        // works held by the output batch
+        addParameter(
+                DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
+                .withConstValue(new C2PortActualDelayTuning::output(
+                        AudioOutputBatch::GetMaxWorks() - 1))
+                .build());
+
         addParameter(
                 DefineParam(mAttrib, C2_PARAMKEY_COMPONENT_ATTRIBUTES)
                 .withConstValue(new C2ComponentAttributesSetting(
@@ -98,7 +105,8 @@ C2SoftOpusDec::C2SoftOpusDec(const char *name, c2_node_id_t id,
     : SimpleC2Component(
         std::make_shared<SimpleInterface<IntfImpl>>(name, id, intfImpl)),
       mIntf(intfImpl),
-      mDecoder(nullptr) {
+      mDecoder(nullptr),
+      mOutputBatch(this, AudioOutputBatch::GetMaxWorks()) {
 }
 
 C2SoftOpusDec::~C2SoftOpusDec() {
@@ -122,6 +130,7 @@ c2_status_t C2SoftOpusDec::onStop() {
     mInputBufferCount = 0;
     mSignalledError = false;
     mSignalledOutputEos = false;
+    mOutputBatch.clear();
 
     return C2_OK;
 }
@@ -150,6 +159,7 @@ status_t C2SoftOpusDec::initDecoder() {
 }
 
 c2_status_t C2SoftOpusDec::onFlush_sm() {
+    mOutputBatch.clear();
     if (mDecoder) {
         opus_multistream_decoder_ctl(mDecoder, OPUS_RESET_STATE);
         mSamplesToDiscard = mSeekPreRoll;
@@ -171,6 +181,7 @@ c2_status_t C2SoftOpusDec::drain(
         return C2_OMITTED;
     }
 
+    mOutputBatch.flush(nullptr);
     return C2_OK;
 }
 
@@ -233,7 +244,7 @@ void C2SoftOpusDec::process(
         }
     }
     if (inSize == 0) {
-        fillEmptyWork(work);
+        mOutputBatch.queue(work->input.ordinal.frameIndex.peeku(), 0u, work, eos);
         if (eos) {
             mSignalledOutputEos = true;
             ALOGV("signalled EOS");
@@ -355,6 +366,7 @@ void C2SoftOpusDec::process(
                 return;
             }
         }
+        mOutputBatch.flush(work);
         fillEmptyWork(work);
         if (eos) {
             mSignalledOutputEos = true;
@@ -365,6 +377,7 @@ void C2SoftOpusDec::process(
 
     // Ignore CSD re-submissions.
     if ((work->input.flags & C2FrameData::FLAG_CODEC_CONFIG)) {
+        mOutputBatch.flush(work);
         fillEmptyWork(work);
         return;
     }
@@ -374,62 +387,48 @@ void C2SoftOpusDec::process(
     // other timestamp).
     if (work->input.ordinal.timestamp.peeku() == 0) mSamplesToDiscard = mCodecDelay;
 
-    std::shared_ptr<C2LinearBlock> block;
-    C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
-    c2_status_t err = pool->fetchLinearBlock(
-                          kMaxNumSamplesPerBuffer * kMaxChannels * sizeof(int16_t),
-                          usage, &block);
+    // decode into the batch block, which takes the output of several packets
+    uint8_t *outData = nullptr;
+    c2_status_t err = mOutputBatch.dequeue(
+            kMaxNumSamplesPerBuffer * mHeader.channels * sizeof(int16_t),
+            pool, work, &outData);
     if (err != C2_OK) {
-        ALOGE("fetchLinearBlock for Output failed with status %d", err);
-        work->result = C2_NO_MEMORY;
-        return;
-    }
-    C2WriteView wView = block->map().get();
-    if (wView.error()) {
-        ALOGE("write view map failed %d", wView.error());
-        work->result = C2_CORRUPTED;
+        work->result = err;
         return;
     }
 
     int numSamples = opus_multistream_decode(mDecoder,
                                              data,
                                              inSize,
-                                             reinterpret_cast<int16_t *> (wView.data()),
+                                             reinterpret_cast<int16_t *> (outData),
                                              kMaxOpusOutputPacketSizeSamples,
                                              0);
     if (numSamples < 0) {
         ALOGE("opus_multistream_decode returned numSamples %d", numSamples);
         numSamples = 0;
         mSignalledError = true;
+        mOutputBatch.flush(work);
         work->result = C2_CORRUPTED;
         return;
     }
 
-    int outOffset = 0;
     if (mSamplesToDiscard > 0) {
         if (mSamplesToDiscard > numSamples) {
             mSamplesToDiscard -= numSamples;
             numSamples = 0;
         } else {
             numSamples -= mSamplesToDiscard;
-            outOffset = mSamplesToDiscard * sizeof(int16_t) * mHeader.channels;
+            // keep the output of the batch contiguous
+            memmove(outData,
+                    outData + mSamplesToDiscard * sizeof(int16_t) * mHeader.channels,
+                    numSamples * sizeof(int16_t) * mHeader.channels);
             mSamplesToDiscard = 0;
         }
     }
 
-    if (numSamples) {
-        int outSize = numSamples * sizeof(int16_t) * mHeader.channels;
-        ALOGV("out buffer attr. offset %d size %d ", outOffset, outSize);
-
-        work->worklets.front()->output.flags = work->input.flags;
-        work->worklets.front()->output.buffers.clear();
-        work->worklets.front()->output.buffers.push_back(createLinearBuffer(block, outOffset, outSize));
-        work->worklets.front()->output.ordinal = work->input.ordinal;
-        work->workletsProcessed = 1u;
-    } else {
-        fillEmptyWork(work);
-        block.reset();
-    }
+    size_t outSize = numSamples * sizeof(int16_t) * mHeader.channels;
+    ALOGV("out buffer attr. size %zu", outSize);
+    mOutputBatch.queue(work->input.ordinal.frameIndex.peeku(), outSize, work, eos);
     if (eos) {
         mSignalledOutputEos = true;
         ALOGV("signalled EOS");
@@ -58,6 +58,7 @@ private:
     size_t mInputBufferCount;
     bool mSignalledError;
     bool mSignalledOutputEos;
+    AudioOutputBatch mOutputBatch;
 
     status_t initDecoder();
 
@@ -57,6 +57,13 @@ public:
         noTimeStretch();
         setDerivedInstance(this);
 
+        // works held by the output batch
+        addParameter(
+                DefineParam(mActualOutputDelay, C2_PARAMKEY_OUTPUT_DELAY)
+                .withConstValue(new C2PortActualDelayTuning::output(
+                        AudioOutputBatch::GetMaxWorks() - 1))
+                .build());
+
         addParameter(
                 DefineParam(mAttrib, C2_PARAMKEY_COMPONENT_ATTRIBUTES)
                 .withConstValue(new C2ComponentAttributesSetting(
@@ -104,7 +111,8 @@ C2SoftVorbisDec::C2SoftVorbisDec(
     : SimpleC2Component(std::make_shared<SimpleInterface<IntfImpl>>(name, id, intfImpl)),
       mIntf(intfImpl),
       mState(nullptr),
-      mVi(nullptr) {
+      mVi(nullptr),
+      mOutputBatch(this, AudioOutputBatch::GetMaxWorks()) {
 }
 
 C2SoftVorbisDec::~C2SoftVorbisDec() {
@@ -131,6 +139,7 @@ c2_status_t C2SoftVorbisDec::onStop() {
     mNumFramesLeftOnPage = -1;
     mSignalledOutputEos = false;
     mSignalledError = false;
+    mOutputBatch.clear();
 
     return (initDecoder() == OK ? C2_OK : C2_CORRUPTED);
 }
@@ -171,6 +180,7 @@ status_t C2SoftVorbisDec::initDecoder() {
 }
 
 c2_status_t C2SoftVorbisDec::onFlush_sm() {
+    mOutputBatch.clear();
     mNumFramesLeftOnPage = -1;
     mSignalledOutputEos = false;
     if (mState) vorbis_dsp_restart(mState);
@@ -191,6 +201,7 @@ c2_status_t C2SoftVorbisDec::drain(
         return C2_OMITTED;
     }
 
+    mOutputBatch.flush(nullptr);
     return C2_OK;
 }
 
@@ -250,7 +261,7 @@ void C2SoftVorbisDec::process(
     }
 
     if (inSize == 0) {
-        fillEmptyWork(work);
+        mOutputBatch.queue(work->input.ordinal.frameIndex.peeku(), 0u, work, eos);
         if (eos) {
             mSignalledOutputEos = true;
             ALOGV("signalled EOS");
@@ -331,6 +342,7 @@ void C2SoftVorbisDec::process(
             }
             mBooksUnpacked = true;
         }
+        mOutputBatch.flush(work);
         fillEmptyWork(work);
         if (eos) {
             mSignalledOutputEos = true;
@@ -379,20 +391,12 @@ void C2SoftVorbisDec::process(
     pack.granulepos = 0;
     pack.packetno = 0;
 
-    size_t maxSamplesInBuffer = kMaxNumSamplesPerChannel * mVi->channels;
-    size_t outCapacity =  maxSamplesInBuffer * sizeof(int16_t);
-    std::shared_ptr<C2LinearBlock> block;
-    C2MemoryUsage usage = { C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE };
-    c2_status_t err = pool->fetchLinearBlock(outCapacity, usage, &block);
+    // decode into the batch block, which takes the output of several packets
+    uint8_t *outData = nullptr;
+    c2_status_t err = mOutputBatch.dequeue(
+            kMaxNumSamplesPerChannel * mVi->channels * sizeof(int16_t), pool, work, &outData);
     if (err != C2_OK) {
-        ALOGE("fetchLinearBlock for Output failed with status %d", err);
-        work->result = C2_NO_MEMORY;
-        return;
-    }
-    C2WriteView wView = block->map().get();
-    if (wView.error()) {
-        ALOGE("write view map failed %d", wView.error());
-        work->result = wView.error();
+        work->result = err;
         return;
     }
 
@@ -402,7 +406,7 @@ void C2SoftVorbisDec::process(
         ALOGD("vorbis_dsp_synthesis returned %d; ignored", ret);
     } else {
         numFrames = vorbis_dsp_pcmout(
-                mState,  reinterpret_cast<int16_t *> (wView.data()),
+                mState,  reinterpret_cast<int16_t *> (outData),
                 kMaxNumSamplesPerChannel);
         if (numFrames < 0) {
             ALOGD("vorbis_dsp_pcmout returned %d", numFrames);
@@ -418,18 +422,8 @@ void C2SoftVorbisDec::process(
         mNumFramesLeftOnPage -= numFrames;
     }
 
-    if (numFrames) {
-        int outSize = numFrames * sizeof(int16_t) * mVi->channels;
-
-        work->worklets.front()->output.flags = work->input.flags;
-        work->worklets.front()->output.buffers.clear();
-        work->worklets.front()->output.buffers.push_back(createLinearBuffer(block, 0, outSize));
-        work->worklets.front()->output.ordinal = work->input.ordinal;
-        work->workletsProcessed = 1u;
-    } else {
-        fillEmptyWork(work);
-        block.reset();
-    }
+    size_t outSize = numFrames * sizeof(int16_t) * mVi->channels;
+    mOutputBatch.queue(work->input.ordinal.frameIndex.peeku(), outSize, work, eos);
     if (eos) {
         mSignalledOutputEos = true;
         ALOGV("signalled EOS");
@@ -59,6 +59,7 @@ struct C2SoftVorbisDec : public SimpleC2Component {
     bool mSignalledOutputEos;
     bool mInfoUnpacked;
     bool mBooksUnpacked;
+    AudioOutputBatch mOutputBatch;
     status_t initDecoder();
 
     C2_DO_NOT_COPY(C2SoftVorbisDec);
@@ -618,32 +618,35 @@ void C2SoftVpxDec::process(
     }
 }
 
+// Copies |height| rows of a plane, in one go when both sides use the same stride.
+static void copyPlane(
+        uint8_t *dst, const uint8_t *src, size_t dstStride, size_t srcStride,
+        size_t width, size_t height) {
+    if (height == 0) {
+        return;
+    }
+    if (dstStride == srcStride) {
+        memcpy(dst, src, dstStride * (height - 1) + width);
+        return;
+    }
+    for (size_t i = 0; i < height; ++i) {
+        memcpy(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 static void copyOutputBufferToYuvPlanarFrame(
         uint8_t *dst, const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV,
         size_t srcYStride, size_t srcUStride, size_t srcVStride,
         size_t dstYStride, size_t dstUVStride,
         uint32_t width, uint32_t height) {
-    uint8_t *dstStart = dst;
-
-    for (size_t i = 0; i < height; ++i) {
-         memcpy(dst, srcY, width);
-         srcY += srcYStride;
-         dst += dstYStride;
-    }
+    uint8_t *dstV = dst + dstYStride * height;
+    uint8_t *dstU = dstV + dstUVStride * height / 2;
 
-    dst = dstStart + dstYStride * height;
-    for (size_t i = 0; i < height / 2; ++i) {
-         memcpy(dst, srcV, width / 2);
-         srcV += srcVStride;
-         dst += dstUVStride;
-    }
-
-    dst = dstStart + (dstYStride * height) + (dstUVStride * height / 2);
-    for (size_t i = 0; i < height / 2; ++i) {
-         memcpy(dst, srcU, width / 2);
-         srcU += srcUStride;
-         dst += dstUVStride;
-    }
+    copyPlane(dst, srcY, dstYStride, srcYStride, width, height);
+    copyPlane(dstV, srcV, dstUVStride, srcVStride, width / 2, height / 2);
+    copyPlane(dstU, srcU, dstUVStride, srcUStride, width / 2, height / 2);
 }
 
 static void convertYUV420Planar16ToY410(uint32_t *dst,
@@ -742,6 +745,15 @@ static void convertYUV420Planar16ToYUV420Planar(uint8_t *dst,
     }
     return;
 }
+void C2SoftVpxDec::runConversions_l(Mutexed<ConversionQueue>::Locked &queue) {
+    CHECK_EQ(0u, queue->numPending);
+    queue->numPending = queue->entries.size();
+    while (queue->numPending > 0) {
+        queue->cond.signal();
+        queue.waitForCondition(queue->cond);
+    }
+}
+
 bool C2SoftVpxDec::outputBuffer(
         const std::shared_ptr<C2BlockPool> &pool,
         const std::unique_ptr<C2Work> &work)
@@ -836,12 +848,7 @@ bool C2SoftVpxDec::outputBuffer(
                 srcV += srcVStride / 2 * (kHeight / 2);
                 dst += dstYStride * kHeight;
             }
-            CHECK_EQ(0u, queue->numPending);
-            queue->numPending = queue->entries.size();
-            while (queue->numPending > 0) {
-                queue->cond.signal();
-                queue.waitForCondition(queue->cond);
-            }
+            runConversions_l(queue);
         } else {
             convertYUV420Planar16ToYUV420Planar(dst, srcY, srcU, srcV, srcYStride / 2,
                                                 srcUStride / 2, srcVStride / 2,
@@ -852,11 +859,40 @@ bool C2SoftVpxDec::outputBuffer(
         const uint8_t *srcY = (const uint8_t *)img->planes[VPX_PLANE_Y];
         const uint8_t *srcU = (const uint8_t *)img->planes[VPX_PLANE_U];
         const uint8_t *srcV = (const uint8_t *)img->planes[VPX_PLANE_V];
-        copyOutputBufferToYuvPlanarFrame(
-                dst, srcY, srcU, srcV,
-                srcYStride, srcUStride, srcVStride,
-                dstYStride, dstUVStride,
-                mWidth, mHeight);
+        if (mConverterThreads.empty()) {
+            copyOutputBufferToYuvPlanarFrame(
+                    dst, srcY, srcU, srcV,
+                    srcYStride, srcUStride, srcVStride,
+                    dstYStride, dstUVStride,
+                    mWidth, mHeight);
+        } else {
+            // A 4K frame is too much to copy on one core at high frame rates, so split
+            // it in bands of rows like the 10-bit conversion.
+            uint8_t *dstV = dst + dstYStride * mHeight;
+            uint8_t *dstU = dstV + dstUVStride * mHeight / 2;
+            Mutexed<ConversionQueue>::Locked queue(*mQueue);
+            constexpr size_t kHeight = 128;
+            for (size_t i = 0; i < mHeight; i += kHeight) {
+                const size_t height = std::min(mHeight - i, kHeight);
+                queue->entries.push_back(
+                        [dst, dstU, dstV, srcY, srcU, srcV,
+                         srcYStride, srcUStride, srcVStride, dstYStride, dstUVStride,
+                         width = mWidth, height] {
+                            copyPlane(dst, srcY, dstYStride, srcYStride, width, height);
+                            copyPlane(dstV, srcV, dstUVStride, srcVStride,
+                                      width / 2, height / 2);
+                            copyPlane(dstU, srcU, dstUVStride, srcUStride,
+                                      width / 2, height / 2);
+                        });
+                srcY += srcYStride * kHeight;
+                srcU += srcUStride * (kHeight / 2);
+                srcV += srcVStride * (kHeight / 2);
+                dst += dstYStride * kHeight;
+                dstU += dstUVStride * (kHeight / 2);
+                dstV += dstUVStride * (kHeight / 2);
+            }
+            runConversions_l(queue);
+        }
     }
     finishWork(*(int64_t *)img->user_priv, work, std::move(block));
     return true;
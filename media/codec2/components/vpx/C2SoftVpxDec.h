@@ -85,6 +85,8 @@ struct C2SoftVpxDec : public SimpleC2Component {
     status_t destroyDecoder();
     void finishWork(uint64_t index, const std::unique_ptr<C2Work> &work,
                     const std::shared_ptr<C2GraphicBlock> &block);
+    // runs the queued entries on the converter threads and waits for them
+    void runConversions_l(Mutexed<ConversionQueue>::Locked &queue);
     bool outputBuffer(
             const std::shared_ptr<C2BlockPool> &pool,
             const std::unique_ptr<C2Work> &work);
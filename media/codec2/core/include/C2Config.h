@@ -151,6 +151,9 @@ enum C2ParamIndexKind : C2Param::type_index_t {
     /* protected content */
     kParamIndexSecureMode,
 
+    /* resources */
+    kParamIndexThreadCount,
+
     // deprecated
     kParamIndexDelayRequest = kParamIndexDelay | C2Param::CoreIndex::IS_REQUEST_FLAG,
 
@@ -1109,6 +1112,16 @@ typedef C2GlobalParam<C2Tuning, C2Int32Value, kParamIndexRealTimePriority>
         C2RealTimePriorityTuning;
 constexpr char C2_PARAMKEY_PRIORITY[] = "algo.priority";
 
+/**
+ * Thread count.
+ *
+ * Number of threads a software component may run its codec on. A value of 0 lets the component
+ * choose, e.g. a share of the CPU cores among the codec instances in the process. Clients running
+ * several sessions at once (e.g. a video call while recording) can use this to split the cores.
+ */
+typedef C2GlobalParam<C2Tuning, C2Uint32Value, kParamIndexThreadCount> C2ThreadCountTuning;
+constexpr char C2_PARAMKEY_THREAD_COUNT[] = "algo.thread-count";
+
 /* ------------------------------------- protected content ------------------------------------- */
 
 /**
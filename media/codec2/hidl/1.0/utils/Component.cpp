@@ -30,6 +30,8 @@
 #include <C2PlatformSupport.h>
 
 #include <chrono>
+#include <list>
+#include <mutex>
 #include <thread>
 
 namespace android {
@@ -103,32 +105,60 @@ struct Component::Listener : public C2Component::Listener {
         }
 
         sp<IComponentListener> listener = mListener.promote();
-        if (listener) {
-            WorkBundle workBundle;
-
-            sp<Component> strongComponent = mComponent.promote();
-            beginTransferBufferQueueBlocks(c2workItems, true);
-            if (!objcpy(&workBundle, c2workItems, strongComponent ?
-                    &strongComponent->mBufferPoolSender : nullptr)) {
-                LOG(ERROR) << "Component::Listener::onWorkDone_nb -- "
-                           << "received corrupted work items.";
-                endTransferBufferQueueBlocks(c2workItems, false, true);
-                return;
-            }
-            Return<void> transStatus = listener->onWorkDone(workBundle);
-            if (!transStatus.isOk()) {
-                LOG(ERROR) << "Component::Listener::onWorkDone_nb -- "
-                           << "transaction failed.";
-                endTransferBufferQueueBlocks(c2workItems, false, true);
-                return;
-            }
-            endTransferBufferQueueBlocks(c2workItems, true, true);
+        if (!listener) {
+            return;
+        }
+        // Works finished on other threads while a bundle is being sent are
+        // sent together by that thread right after, instead of each caller
+        // making its own transaction.
+        std::unique_lock<std::mutex> lock(mDoneLock);
+        mDoneWorks.splice(mDoneWorks.end(), c2workItems);
+        if (mSendingDone) {
+            return;
         }
+        mSendingDone = true;
+        while (!mDoneWorks.empty()) {
+            std::list<std::unique_ptr<C2Work>> workItems;
+            workItems.swap(mDoneWorks);
+            lock.unlock();
+            sendWorkDone(listener, workItems);
+            workItems.clear();
+            lock.lock();
+        }
+        mSendingDone = false;
     }
 
 protected:
     wp<Component> mComponent;
     wp<IComponentListener> mListener;
+
+    std::mutex mDoneLock;
+    std::list<std::unique_ptr<C2Work>> mDoneWorks;
+    bool mSendingDone{false};
+
+    void sendWorkDone(
+            const sp<IComponentListener>& listener,
+            std::list<std::unique_ptr<C2Work>>& c2workItems) {
+        WorkBundle workBundle;
+
+        sp<Component> strongComponent = mComponent.promote();
+        beginTransferBufferQueueBlocks(c2workItems, true);
+        if (!objcpy(&workBundle, c2workItems, strongComponent ?
+                &strongComponent->mBufferPoolSender : nullptr)) {
+            LOG(ERROR) << "Component::Listener::onWorkDone_nb -- "
+                       << "received corrupted work items.";
+            endTransferBufferQueueBlocks(c2workItems, false, true);
+            return;
+        }
+        Return<void> transStatus = listener->onWorkDone(workBundle);
+        if (!transStatus.isOk()) {
+            LOG(ERROR) << "Component::Listener::onWorkDone_nb -- "
+                       << "transaction failed.";
+            endTransferBufferQueueBlocks(c2workItems, false, true);
+            return;
+        }
+        endTransferBufferQueueBlocks(c2workItems, true, true);
+    }
 };
 
 // Component::Sink
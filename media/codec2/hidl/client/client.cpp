@@ -20,6 +20,7 @@
 
 #include <codec2/hidl/client.h>
 
+#include <chrono>
 #include <deque>
 #include <iterator>
 #include <limits>
@@ -36,6 +37,7 @@
 #include <gui/bufferqueue/2.0/B2HGraphicBufferProducer.h>
 #include <gui/bufferqueue/2.0/H2BGraphicBufferProducer.h>
 #include <hidl/HidlSupport.h>
+#include <utils/Timers.h>
 
 #include <android/hardware/media/bufferpool/2.0/IClientManager.h>
 #include <android/hardware/media/c2/1.0/IComponent.h>
@@ -75,6 +77,9 @@ namespace /* unnamed */ {
 // c2_status_t value that corresponds to hwbinder transaction failure.
 constexpr c2_status_t C2_TRANSACTION_FAILED = C2_CORRUPTED;
 
+// Upper bound of the works a batching window collects for one transaction.
+constexpr size_t kMaxQueueBatchSize = 16;
+
 // Searches for a name in GetServiceNames() and returns the index found. If the
 // name is not found, the returned index will be equal to
 // GetServiceNames().size().
@@ -1032,10 +1037,28 @@ Codec2Client::Component::Component(const sp<Base>& base)
             }()
         },
         mBase{base},
-        mBufferPoolSender{nullptr} {
+        mBufferPoolSender{nullptr},
+        mQueueBatchWindowUs{std::max(int64_t(0), ::android::base::GetIntProperty(
+                "debug.stagefright.c2-queue-batch-us", int64_t(0)))} {
 }
 
 Codec2Client::Component::~Component() {
+    std::unique_lock<std::mutex> lock(mQueueBatchMutex);
+    QueueBatch &batch = mQueueBatch;
+    if (mQueueBatchThread.joinable()) {
+        batch.stopping = true;
+        mQueueBatchCondition.notify_all();
+        lock.unlock();
+        mQueueBatchThread.join();
+        lock.lock();
+    }
+    if (batch.numTransactions > 0) {
+        LOG(DEBUG) << "queue -- " << batch.numWorks << " works in "
+                   << batch.numTransactions << " transactions"
+                   << " (max " << batch.maxBatchSize << " per transaction),"
+                   << " latency avg " << batch.totalLatencyUs / batch.numCalls
+                   << " us, max " << batch.maxLatencyUs << " us.";
+    }
 }
 
 c2_status_t Codec2Client::Component::createBlockPool(
@@ -1083,30 +1106,143 @@ void Codec2Client::Component::handleOnWorkDone(
     mOutputBufferQueue.holdBufferQueueBlocks(workItems);
 }
 
+struct Codec2Client::Component::QueueTicket {
+    int64_t queuedUs;
+    size_t numWorks;
+    bool done{false};
+    c2_status_t status{C2_OK};
+};
+
 c2_status_t Codec2Client::Component::queue(
         std::list<std::unique_ptr<C2Work>>* const items) {
+    std::shared_ptr<QueueTicket> ticket = std::make_shared<QueueTicket>();
+    ticket->queuedUs = systemTime() / 1000;
+    ticket->numWorks = items->size();
+
+    std::unique_lock<std::mutex> lock(mQueueBatchMutex);
+    QueueBatch &batch = mQueueBatch;
+    if (batch.lastArrivalUs != 0) {
+        int64_t intervalUs = ticket->queuedUs - batch.lastArrivalUs;
+        batch.avgIntervalUs = batch.avgIntervalUs == 0 ? intervalUs :
+                (batch.avgIntervalUs * 7 + intervalUs) / 8;
+    }
+    batch.lastArrivalUs = ticket->queuedUs;
+    batch.works.splice(batch.works.end(), *items);
+    batch.tickets.push_back(ticket);
+    mQueueBatchCondition.notify_all();
+
+    if (mQueueBatchWindowUs > 0) {
+        if (!mQueueBatchThread.joinable()) {
+            mQueueBatchThread = std::thread(
+                    &Codec2Client::Component::queueBatchThreadLoop, this);
+        }
+        return batch.asyncStatus;
+    }
+    while (!ticket->done) {
+        if (batch.sending) {
+            // our works go out with the transaction after the one in flight
+            mQueueBatchCondition.wait(lock);
+            continue;
+        }
+        (void)sendQueueBatch(&lock);
+    }
+    return ticket->status;
+}
+
+c2_status_t Codec2Client::Component::sendQueueBatch(
+        std::unique_lock<std::mutex> *lock) {
+    QueueBatch &batch = mQueueBatch;
+    batch.sending = true;
+    if (mQueueBatchWindowUs > 0 && batch.avgIntervalUs < mQueueBatchWindowUs) {
+        // works are arriving faster than the window; give the next ones a
+        // chance to join this transaction.
+        const int64_t deadlineUs = batch.tickets.front()->queuedUs + mQueueBatchWindowUs;
+        size_t numTickets = batch.tickets.size();
+        for (int64_t nowUs = systemTime() / 1000;
+                nowUs < deadlineUs && batch.works.size() < kMaxQueueBatchSize;
+                nowUs = systemTime() / 1000) {
+            mQueueBatchCondition.wait_for(
+                    *lock, std::chrono::microseconds(deadlineUs - nowUs));
+            if (batch.tickets.size() == numTickets) {
+                break; // nothing new, most likely a timeout
+            }
+            numTickets = batch.tickets.size();
+        }
+    }
+    std::list<std::unique_ptr<C2Work>> works;
+    works.swap(batch.works);
+    std::vector<std::shared_ptr<QueueTicket>> tickets;
+    tickets.swap(batch.tickets);
+    lock->unlock();
+
+    c2_status_t status = C2_OK;
     WorkBundle workBundle;
-    if (!objcpy(&workBundle, *items, &mBufferPoolSender)) {
+    if (!objcpy(&workBundle, works, &mBufferPoolSender)) {
         LOG(ERROR) << "queue -- bad input.";
-        return C2_TRANSACTION_FAILED;
+        status = C2_TRANSACTION_FAILED;
+    } else {
+        Return<Status> transStatus = mBase->queue(workBundle);
+        if (!transStatus.isOk()) {
+            LOG(ERROR) << "queue -- transaction failed.";
+            status = C2_TRANSACTION_FAILED;
+        } else {
+            status = static_cast<c2_status_t>(static_cast<Status>(transStatus));
+            if (status != C2_OK) {
+                LOG(DEBUG) << "queue -- call failed: " << status << ".";
+            }
+        }
     }
-    Return<Status> transStatus = mBase->queue(workBundle);
-    if (!transStatus.isOk()) {
-        LOG(ERROR) << "queue -- transaction failed.";
-        return C2_TRANSACTION_FAILED;
+    const int64_t nowUs = systemTime() / 1000;
+    // the works, and the buffers they hold, are released outside of the lock
+    works.clear();
+
+    lock->lock();
+    ++batch.numTransactions;
+    batch.numCalls += tickets.size();
+    uint64_t batchSize = 0;
+    for (const std::shared_ptr<QueueTicket> &ticket : tickets) {
+        const int64_t latencyUs = nowUs - ticket->queuedUs;
+        batch.totalLatencyUs += latencyUs;
+        batch.maxLatencyUs = std::max(batch.maxLatencyUs, latencyUs);
+        batchSize += ticket->numWorks;
+        ticket->status = status;
+        ticket->done = true;
     }
-    c2_status_t status =
-            static_cast<c2_status_t>(static_cast<Status>(transStatus));
+    batch.numWorks += batchSize;
+    batch.maxBatchSize = std::max(batch.maxBatchSize, batchSize);
     if (status != C2_OK) {
-        LOG(DEBUG) << "queue -- call failed: " << status << ".";
+        batch.asyncStatus = status;
     }
+    batch.sending = false;
+    mQueueBatchCondition.notify_all();
     return status;
 }
 
+void Codec2Client::Component::queueBatchThreadLoop() {
+    std::unique_lock<std::mutex> lock(mQueueBatchMutex);
+    QueueBatch &batch = mQueueBatch;
+    while (!batch.stopping || !batch.tickets.empty()) {
+        if (batch.tickets.empty()) {
+            mQueueBatchCondition.wait(lock);
+            continue;
+        }
+        (void)sendQueueBatch(&lock);
+    }
+}
+
+void Codec2Client::Component::waitForQueueBatch() {
+    std::unique_lock<std::mutex> lock(mQueueBatchMutex);
+    QueueBatch &batch = mQueueBatch;
+    mQueueBatchCondition.wait(lock, [&batch] {
+        return batch.tickets.empty() && !batch.sending;
+    });
+}
+
 c2_status_t Codec2Client::Component::flush(
         C2Component::flush_mode_t mode,
         std::list<std::unique_ptr<C2Work>>* const flushedWork) {
     (void)mode; // Flush mode isn't supported in HIDL yet.
+    waitForQueueBatch();
     c2_status_t status;
     Return<void> transStatus = mBase->flush(
             [&status, flushedWork](
@@ -1149,6 +1285,7 @@ c2_status_t Codec2Client::Component::flush(
 }
 
 c2_status_t Codec2Client::Component::drain(C2Component::drain_mode_t mode) {
+    waitForQueueBatch();
     Return<Status> transStatus = mBase->drain(
             mode == C2Component::DRAIN_COMPONENT_WITH_EOS);
     if (!transStatus.isOk()) {
@@ -1164,6 +1301,10 @@ c2_status_t Codec2Client::Component::drain(C2Component::drain_mode_t mode) {
 }
 
 c2_status_t Codec2Client::Component::start() {
+    {
+        std::lock_guard<std::mutex> lock(mQueueBatchMutex);
+        mQueueBatch.asyncStatus = C2_OK;
+    }
     Return<Status> transStatus = mBase->start();
     if (!transStatus.isOk()) {
         LOG(ERROR) << "start -- transaction failed.";
@@ -1178,6 +1319,7 @@ c2_status_t Codec2Client::Component::start() {
 }
 
 c2_status_t Codec2Client::Component::stop() {
+    waitForQueueBatch();
     Return<Status> transStatus = mBase->stop();
     if (!transStatus.isOk()) {
         LOG(ERROR) << "stop -- transaction failed.";
@@ -1192,6 +1334,7 @@ c2_status_t Codec2Client::Component::stop() {
 }
 
 c2_status_t Codec2Client::Component::reset() {
+    waitForQueueBatch();
     Return<Status> transStatus = mBase->reset();
     if (!transStatus.isOk()) {
         LOG(ERROR) << "reset -- transaction failed.";
@@ -1206,6 +1349,7 @@ c2_status_t Codec2Client::Component::reset() {
 }
 
 c2_status_t Codec2Client::Component::release() {
+    waitForQueueBatch();
     Return<Status> transStatus = mBase->release();
     if (!transStatus.isOk()) {
         LOG(ERROR) << "release -- transaction failed.";
@@ -28,10 +28,14 @@
 #include <hidl/HidlSupport.h>
 #include <utils/StrongPointer.h>
 
+#include <condition_variable>
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 /**
  * This file contains minimal interfaces for the framework to access Codec2.0.
@@ -382,6 +386,40 @@ protected:
     struct HidlListener;
     void handleOnWorkDone(const std::list<std::unique_ptr<C2Work>> &workItems);
 
+    // Works from concurrent queue() calls are sent together in one
+    // transaction. With a nonzero batching window
+    // (debug.stagefright.c2-queue-batch-us), queue() returns once the works
+    // are accepted, and a sender thread waits for up to the window for more
+    // works when they have recently been arriving faster than that. Errors
+    // are then reported by the following calls.
+    struct QueueTicket;
+    struct QueueBatch {
+        std::list<std::unique_ptr<C2Work>> works;
+        std::vector<std::shared_ptr<QueueTicket>> tickets;
+        bool sending{false};
+        bool stopping{false};
+        c2_status_t asyncStatus{C2_OK};
+        int64_t lastArrivalUs{0};
+        int64_t avgIntervalUs{0};     // moving average time between queue() calls
+        // statistics
+        uint64_t numTransactions{0};
+        uint64_t numCalls{0};
+        uint64_t numWorks{0};
+        uint64_t maxBatchSize{0};
+        int64_t totalLatencyUs{0};    // of the queue() calls, to the end of their transaction
+        int64_t maxLatencyUs{0};
+    };
+    const int64_t mQueueBatchWindowUs;
+    std::mutex mQueueBatchMutex;
+    std::condition_variable mQueueBatchCondition;
+    QueueBatch mQueueBatch;
+    std::thread mQueueBatchThread;
+
+    c2_status_t sendQueueBatch(std::unique_lock<std::mutex> *lock);
+    void queueBatchThreadLoop();
+    // waits until the works accepted by queue() have been sent
+    void waitForQueueBatch();
+
 };
 
 struct Codec2Client::InputSurface : public Codec2Client::Configurable {
@@ -304,6 +304,17 @@ public:
             mConfig.mMaxFps = config.mMaxFps;
         }
 
+        // max latency
+        if (config.mMaxLatencyUs > 0 && config.mMaxLatencyUs != mConfig.mMaxLatencyUs) {
+            status_t res = GetStatus(mSource->setMaxLatencyUs(config.mMaxLatencyUs));
+            status << " maxLatency=" << config.mMaxLatencyUs << "us";
+            if (res != OK) {
+                // not fatal, the frames are all encoded then
+                status << " (=> " << asString(res) << ")";
+            }
+            mConfig.mMaxLatencyUs = config.mMaxLatencyUs;
+        }
+
         if (config.mTimeOffsetUs != mConfig.mTimeOffsetUs) {
             status_t res = GetStatus(mSource->setTimeOffsetUs(config.mTimeOffsetUs));
             status << " timeOffset " << config.mTimeOffsetUs << "us";
@@ -797,6 +808,10 @@ void CCodec::configure(const sp<AMessage> &msg) {
                         KEY_MAX_FPS_TO_ENCODER, &config->mISConfig->mMaxFps)) {
                     config->mISConfig->mMaxFps = -1;
                 }
+                if (!msg->findInt64(
+                        "max-input-latency-us", &config->mISConfig->mMaxLatencyUs)) {
+                    config->mISConfig->mMaxLatencyUs = -1;
+                }
                 config->mISConfig->mMinAdjustedFps = 0;
                 config->mISConfig->mFixedAdjustedFps = 0;
                 if (msg->findInt64(KEY_MAX_PTS_GAP_TO_ENCODER, &value)) {
@@ -212,7 +212,10 @@ bool CCodecBufferChannel::ReorderStash::less(
 
 // Input
 
-CCodecBufferChannel::Input::Input() : extraBuffers("extra") {}
+CCodecBufferChannel::Input::Input()
+    : extraBuffers("extra"),
+      queuedBytes(0u),
+      copiedBytes(0u) {}
 
 // CCodecBufferChannel
 
@@ -308,17 +311,21 @@ status_t CCodecBufferChannel::queueInputBufferInternal(sp<MediaCodecBuffer> buff
         if (!input->buffers->releaseBuffer(buffer, &c2buffer, false)) {
             return -ENOENT;
         }
-        // TODO: we want to delay copying buffers.
+        input->queuedBytes += buffer->size();
         if (input->extraBuffers.numComponentBuffers() < input->numExtraSlots) {
-            copy = input->buffers->cloneAndReleaseBuffer(buffer);
+            copy = input->buffers->transferAndReleaseBuffer(buffer);
             if (copy != nullptr) {
+                const bool copied = (copy.get() != buffer.get());
+                if (copied) {
+                    input->copiedBytes += buffer->size();
+                }
                 (void)input->extraBuffers.assignSlot(copy);
                 if (!input->extraBuffers.releaseSlot(copy, &c2buffer, false)) {
                     return UNKNOWN_ERROR;
                 }
                 bool released = input->buffers->releaseBuffer(buffer, nullptr, true);
-                ALOGV("[%s] queueInputBuffer: buffer copied; %sreleased",
-                      mName, released ? "" : "not ");
+                ALOGV("[%s] queueInputBuffer: buffer %s; %sreleased",
+                      mName, copied ? "copied" : "transferred", released ? "" : "not ");
                 buffer.clear();
             } else {
                 ALOGW("[%s] queueInputBuffer: failed to copy a buffer; this may cause input "
@@ -917,10 +924,12 @@ status_t CCodecBufferChannel::start(
                             "EncryptedLinearInputBuffers");
                     mDecryptDestination = mDealer->allocate((size_t)capacity);
                 }
-                if (mCrypto != nullptr && mHeapSeqNum < 0) {
-                    mHeapSeqNum = mCrypto->setHeap(mDealer->getMemoryHeap());
-                } else {
+                if (mCrypto == nullptr) {
                     mHeapSeqNum = -1;
+                } else if (mHeapSeqNum < 0) {
+                    // The dealer lives as long as the channel, so keep its heap registered
+                    // across stop/start instead of mapping it into the plugin again.
+                    mHeapSeqNum = mCrypto->setHeap(mDealer->getMemoryHeap());
                 }
                 input->buffers.reset(new EncryptedLinearInputBuffers(
                         secure, mDealer, mCrypto, mHeapSeqNum, (size_t)capacity,
@@ -1198,6 +1207,16 @@ status_t CCodecBufferChannel::requestInitialInputBuffers() {
 
 void CCodecBufferChannel::stop() {
     mSync.stop();
+    {
+        Mutexed<Input>::Locked input(mInput);
+        if (input->queuedBytes > 0u) {
+            ALOGD("[%s] input: %llu bytes queued, %llu bytes copied",
+                  mName, (unsigned long long)input->queuedBytes,
+                  (unsigned long long)input->copiedBytes);
+        }
+        input->queuedBytes = 0u;
+        input->copiedBytes = 0u;
+    }
     mFirstValidFrameIndex = mFrameIndex.load(std::memory_order_relaxed);
     if (mInputSurface != nullptr) {
         mInputSurface.reset();
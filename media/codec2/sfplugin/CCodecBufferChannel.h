@@ -237,6 +237,11 @@ private:
         size_t numExtraSlots;
         uint32_t inputDelay;
         uint32_t pipelineDelay;
+
+        // bytes queued to the component since start, and how many of them
+        // had to be copied on the way
+        uint64_t queuedBytes;
+        uint64_t copiedBytes;
     };
     Mutexed<Input> mInput;
     struct Output {
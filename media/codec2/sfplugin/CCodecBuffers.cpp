@@ -262,6 +262,19 @@ bool FlexBuffersImpl::releaseSlot(
     return true;
 }
 
+sp<Codec2Buffer> FlexBuffersImpl::detachSlot(const sp<MediaCodecBuffer> &buffer) {
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        if (mBuffers[i].clientBuffer == buffer) {
+            sp<Codec2Buffer> clientBuffer = mBuffers[i].clientBuffer;
+            mBuffers[i].clientBuffer.clear();
+            mBuffers[i].compBuffer.reset();
+            return clientBuffer;
+        }
+    }
+    ALOGV("[%s] %s: No matching buffer found", mName, __func__);
+    return nullptr;
+}
+
 bool FlexBuffersImpl::expireComponentBuffer(const std::shared_ptr<C2Buffer> &c2buffer) {
     for (size_t i = 0; i < mBuffers.size(); ++i) {
         std::shared_ptr<C2Buffer> compBuffer =
@@ -541,6 +554,13 @@ size_t LinearInputBuffers::numClientBuffers() const {
     return mImpl.numClientBuffers();
 }
 
+sp<Codec2Buffer> LinearInputBuffers::transferAndReleaseBuffer(
+        const sp<MediaCodecBuffer> &buffer) {
+    // Each request allocates a new block, so the client wrote straight into
+    // the block the component receives; just move it out of our slots.
+    return mImpl.detachSlot(buffer);
+}
+
 // static
 sp<Codec2Buffer> LinearInputBuffers::Alloc(
         const std::shared_ptr<C2BlockPool> &pool, const sp<AMessage> &format) {
@@ -143,6 +143,18 @@ public:
      */
     sp<Codec2Buffer> cloneAndReleaseBuffer(const sp<MediaCodecBuffer> &buffer);
 
+    /**
+     * Release the buffer obtained from requestNewBuffer() so that it can be
+     * tracked in another set of slots. By default this is a deep copy clone
+     * of the buffer, see cloneAndReleaseBuffer(); buffers that allocate a new
+     * block for each request hand over the buffer itself instead.
+     *
+     * \return  the buffer to hand over; nullptr if not possible.
+     */
+    virtual sp<Codec2Buffer> transferAndReleaseBuffer(const sp<MediaCodecBuffer> &buffer) {
+        return cloneAndReleaseBuffer(buffer);
+    }
+
 protected:
     virtual sp<Codec2Buffer> createNewBuffer() = 0;
 
@@ -346,6 +358,15 @@ public:
      */
     bool expireComponentBuffer(const std::shared_ptr<C2Buffer> &c2buffer);
 
+    /**
+     * Free the slot of a buffer, both from the client and from the component,
+     * and return the buffer so that it can be assigned a slot elsewhere.
+     *
+     * \param   buffer[in]  the buffer previously assigned a slot.
+     * \return  the buffer; nullptr if it is not found in the slots.
+     */
+    sp<Codec2Buffer> detachSlot(const sp<MediaCodecBuffer> &buffer);
+
     /**
      * The client abandoned all known buffers, so reclaim the ownership.
      */
@@ -569,6 +590,8 @@ public:
 
     size_t numClientBuffers() const final;
 
+    sp<Codec2Buffer> transferAndReleaseBuffer(const sp<MediaCodecBuffer> &buffer) override;
+
 protected:
     sp<Codec2Buffer> createNewBuffer() override;
 
@@ -594,6 +617,11 @@ public:
 
     std::unique_ptr<InputBuffers> toArrayMode(size_t size) override;
 
+    // encrypted buffers are tied to their shared memory; always copy.
+    sp<Codec2Buffer> transferAndReleaseBuffer(const sp<MediaCodecBuffer> &buffer) override {
+        return cloneAndReleaseBuffer(buffer);
+    }
+
 protected:
     sp<Codec2Buffer> createNewBuffer() override;
 
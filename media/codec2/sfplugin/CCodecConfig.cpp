@@ -553,6 +553,8 @@ void CCodecConfig::initializeStandardParams() {
     // C2 priorities are inverted
     add(ConfigMapper(KEY_PRIORITY,         C2_PARAMKEY_PRIORITY,           "value")
         .withMappers(negate, negate));
+    add(ConfigMapper("thread-count",     C2_PARAMKEY_THREAD_COUNT,       "value")
+        .limitTo(D::VIDEO & D::CONFIG));
     // remove when codecs switch to PARAMKEY
     deprecated(ConfigMapper(KEY_OPERATING_RATE,   "ctrl.operating-rate",     "value")
                .withMapper(makeFloat));
@@ -1518,7 +1520,15 @@ status_t CCodecConfig::getConfigUpdateFromSdkParams(
     std::vector<C2Param::Index> supportedIndices;
     for (C2Param::Index ix : indices) {
         if (mSupportedIndices.count(ix)) {
-            supportedIndices.push_back(ix);
+            // Subscribed parameters are kept current from the config updates
+            // in finished work and from the query after each config, so they
+            // need not be queried again.
+            auto it = mCurrentConfig.find(ix);
+            if (mSubscribedIndices.count(ix) && it != mCurrentConfig.end() && it->second) {
+                configUpdate->emplace_back(C2Param::Copy(*it->second));
+            } else {
+                supportedIndices.push_back(ix);
+            }
         } else if (mLocalParams.count(ix)) {
             // query local parameter here
             auto it = mCurrentConfig.find(ix);
@@ -1528,9 +1538,14 @@ status_t CCodecConfig::getConfigUpdateFromSdkParams(
         }
     }
 
-    c2_status_t err = component->query({ }, supportedIndices, blocking, configUpdate);
-    if (err != C2_OK) {
-        ALOGD("query failed after returning %zu params => %s", configUpdate->size(), asString(err));
+    ALOGV("%zu of %zu params from the current configuration",
+          indices.size() - supportedIndices.size(), indices.size());
+    if (!supportedIndices.empty()) {
+        c2_status_t err = component->query({ }, supportedIndices, blocking, configUpdate);
+        if (err != C2_OK) {
+            ALOGD("query failed after returning %zu params => %s",
+                  configUpdate->size(), asString(err));
+        }
     }
 
     if (configUpdate->size()) {
@@ -1552,7 +1567,16 @@ status_t CCodecConfig::setParameters(
     std::vector<C2Param *> paramVector;
     for (const std::unique_ptr<C2Param> &param : configUpdate) {
         if (mSupportedIndices.count(param->index())) {
-            // component parameter
+            // component parameter; skip it if the component already has the
+            // value. Tunings may be triggers (such as a sync frame request)
+            // that the component resets by itself, so they are always sent.
+            auto it = mCurrentConfig.find(param->index());
+            if (param->kind() != C2Param::TUNING
+                    && it != mCurrentConfig.end() && it->second && *it->second == *param) {
+                ALOGV("skipping unchanged parameter %s",
+                        mParamUpdater->getParamName(param->index()).c_str());
+                continue;
+            }
             paramVector.push_back(param.get());
             indices.push_back(param->index());
         } else if (mLocalParams.count(param->index())) {
@@ -1575,6 +1599,11 @@ status_t CCodecConfig::setParameters(
             }
         }
     }
+    if (paramVector.empty()) {
+        // only local parameters, or nothing changed
+        return result;
+    }
+
     // update subscribed param indices
     subscribeToConfigUpdate(component, indices, blocking);
 
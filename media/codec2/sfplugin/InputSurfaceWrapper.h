@@ -63,6 +63,7 @@ public:
         // IN PARAMS (GBS)
         float mMinFps; // minimum fps (repeat frame to achieve this)
         float mMaxFps; // max fps (via frame drop)
+        int64_t mMaxLatencyUs; // max wait for a codec buffer (via frame drop)
         float mCaptureFps; // capture fps
         float mCodedFps;   // coded fps
         bool mSuspended; // suspended
@@ -139,6 +139,11 @@ BnStatus Omx2IGraphicBufferSource::signalEndOfInputStream() {
     return BnStatus::fromStatusT(mBase->signalEndOfInputStream());
 }
 
+BnStatus Omx2IGraphicBufferSource::setMaxLatencyUs(
+        int64_t maxLatencyUs) {
+    return BnStatus::fromStatusT(mBase->setMaxLatencyUs(maxLatencyUs));
+}
+
 BnStatus Omx2IGraphicBufferSource::configure(
         const sp<IOMXNode>& omxNode, int32_t dataSpace) {
     if (omxNode == NULL) {
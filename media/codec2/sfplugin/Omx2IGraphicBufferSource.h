@@ -39,6 +39,7 @@ struct Omx2IGraphicBufferSource : public BnGraphicBufferSource {
     BnStatus setColorAspects(int32_t aspects) override;
     BnStatus setTimeOffsetUs(int64_t timeOffsetsUs) override;
     BnStatus signalEndOfInputStream() override;
+    BnStatus setMaxLatencyUs(int64_t maxLatencyUs) override;
 };
 
 } // namespace android
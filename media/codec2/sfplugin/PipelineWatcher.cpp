@@ -17,6 +17,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "PipelineWatcher"
 
+#include <algorithm>
 #include <numeric>
 
 #include <log/log.h>
@@ -83,7 +84,7 @@ std::shared_ptr<C2Buffer> PipelineWatcher::onInputBufferReleased(
     return buffer;
 }
 
-void PipelineWatcher::onWorkDone(uint64_t frameIndex) {
+void PipelineWatcher::onWorkDone(uint64_t frameIndex, const Clock::time_point &doneAt) {
     ALOGV("onWorkDone(frameIndex=%llu)", (unsigned long long)frameIndex);
     auto it = mFramesInPipeline.find(frameIndex);
     if (it == mFramesInPipeline.end()) {
@@ -91,16 +92,46 @@ void PipelineWatcher::onWorkDone(uint64_t frameIndex) {
               (unsigned long long)frameIndex);
         return;
     }
+    mLatencies[mNumLatencies++ % kLatencyWindow] = doneAt - it->second.queuedAt;
+    if (mBusy) {
+        // only intervals during which the component had work count towards
+        // its throughput; the client running dry is not the component's.
+        Clock::duration interval = doneAt - mLastDoneAt;
+        mAvgDoneInterval = mAvgDoneInterval == Clock::duration::zero()
+                ? interval : (mAvgDoneInterval * 7 + interval) / 8;
+    }
     (void)mFramesInPipeline.erase(it);
+    mLastDoneAt = doneAt;
+    mBusy = !mFramesInPipeline.empty();
 }
 
 void PipelineWatcher::flush() {
     mFramesInPipeline.clear();
+    mNumLatencies = 0;
+    mAvgDoneInterval = Clock::duration::zero();
+    mBusy = false;
+}
+
+uint32_t PipelineWatcher::tunedSmoothnessFactor() const {
+    if (mNumLatencies < kLatencyWindow || mAvgDoneInterval <= Clock::duration::zero()) {
+        return mSmoothnessFactor;
+    }
+    // The shortest recent latency is the closest to the time the component
+    // itself takes, without waiting behind other work items. By Little's law,
+    // keeping latency / interval items in flight keeps the component busy;
+    // more only make items wait longer.
+    Clock::duration latency = *std::min_element(mLatencies, mLatencies + kLatencyWindow);
+    uint64_t needed = (latency + mAvgDoneInterval - Clock::duration(1)) / mAvgDoneInterval;
+    uint64_t delays = mInputDelay + mPipelineDelay + mOutputDelay;
+    // one more, so that the next item is already there when one finishes
+    uint64_t extra = needed + 1 > delays ? needed + 1 - delays : 1;
+    return std::clamp(extra, (uint64_t)1, (uint64_t)std::max(mSmoothnessFactor, 1u));
 }
 
 bool PipelineWatcher::pipelineFull() const {
+    const uint32_t smoothnessFactor = tunedSmoothnessFactor();
     if (mFramesInPipeline.size() >=
-            mInputDelay + mPipelineDelay + mOutputDelay + mSmoothnessFactor) {
+            mInputDelay + mPipelineDelay + mOutputDelay + smoothnessFactor) {
         ALOGV("pipelineFull: too many frames in pipeline (%zu)", mFramesInPipeline.size());
         return true;
     }
@@ -116,14 +147,14 @@ bool PipelineWatcher::pipelineFull() const {
                 return true;
             });
     if (sizeWithInputReleased >=
-            mPipelineDelay + mOutputDelay + mSmoothnessFactor) {
+            mPipelineDelay + mOutputDelay + smoothnessFactor) {
         ALOGV("pipelineFull: too many frames in pipeline, with input released (%zu)",
               sizeWithInputReleased);
         return true;
     }
 
     size_t sizeWithInputsPending = mFramesInPipeline.size() - sizeWithInputReleased;
-    if (sizeWithInputsPending > mPipelineDelay + mInputDelay + mSmoothnessFactor) {
+    if (sizeWithInputsPending > mPipelineDelay + mInputDelay + smoothnessFactor) {
         ALOGV("pipelineFull: too many inputs pending (%zu) in pipeline, with inputs released (%zu)",
               sizeWithInputsPending, sizeWithInputReleased);
         return true;
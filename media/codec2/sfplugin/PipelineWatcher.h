@@ -37,7 +37,10 @@ public:
         : mInputDelay(0),
           mPipelineDelay(0),
           mOutputDelay(0),
-          mSmoothnessFactor(0) {}
+          mSmoothnessFactor(0),
+          mNumLatencies(0),
+          mAvgDoneInterval(Clock::duration::zero()),
+          mBusy(false) {}
     ~PipelineWatcher() = default;
 
     /**
@@ -91,8 +94,9 @@ public:
      * The component finished processing a work item.
      *
      * \param frameIndex  input frame index
+     * \param doneAt      time when the client received the work item
      */
-    void onWorkDone(uint64_t frameIndex);
+    void onWorkDone(uint64_t frameIndex, const Clock::time_point &doneAt = Clock::now());
 
     /**
      * Flush the pipeline.
@@ -117,7 +121,20 @@ public:
      */
     Clock::duration elapsed(const Clock::time_point &now, size_t n) const;
 
+    /**
+     * Return the number of work items kept in the pipeline on top of the
+     * delays reported by the component. This is the smoothness factor, or,
+     * once enough work items went through the pipeline, as many as are
+     * needed to keep the component busy at the measured latency and
+     * throughput, up to the smoothness factor.
+     */
+    uint32_t tunedSmoothnessFactor() const;
+
 private:
+    // number of recent latencies kept to estimate the component latency
+    static constexpr size_t kLatencyWindow = 16;
+
+
     uint32_t mInputDelay;
     uint32_t mPipelineDelay;
     uint32_t mOutputDelay;
@@ -132,6 +149,14 @@ private:
         const Clock::time_point queuedAt;
     };
     std::map<uint64_t, Frame> mFramesInPipeline;
+
+    // latency from queueing to completion of recent work items
+    Clock::duration mLatencies[kLatencyWindow];
+    size_t mNumLatencies;
+    // moving average time between completions while the component is busy
+    Clock::duration mAvgDoneInterval;
+    Clock::time_point mLastDoneAt;
+    bool mBusy;     // work items were left in the pipeline at mLastDoneAt
 };
 
 }  // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <PipelineWatcher.h>
+
+namespace android {
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Runs |numFrames| through a component that keeps |inFlight| frames and
+// finishes one every |interval|, each after |latency|.
+void runFrames(PipelineWatcher *watcher, size_t numFrames, size_t inFlight,
+               PipelineWatcher::Clock::duration latency,
+               PipelineWatcher::Clock::duration interval) {
+    PipelineWatcher::Clock::time_point start = PipelineWatcher::Clock::now();
+    for (size_t i = 0; i < numFrames + inFlight; ++i) {
+        if (i < numFrames) {
+            watcher->onWorkQueued(i, {}, start + i * interval);
+        }
+        if (i >= inFlight) {
+            size_t done = i - inFlight;
+            watcher->onWorkDone(done, start + done * interval + latency);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(PipelineWatcherTest, SmoothnessFactorUntilMeasured) {
+    PipelineWatcher watcher;
+    watcher.inputDelay(1).pipelineDelay(0).outputDelay(2).smoothnessFactor(4);
+    EXPECT_EQ(4u, watcher.tunedSmoothnessFactor());
+
+    runFrames(&watcher, 4, 1, 5ms, 10ms);
+    EXPECT_EQ(4u, watcher.tunedSmoothnessFactor());
+}
+
+TEST(PipelineWatcherTest, ShrinksForFastComponent) {
+    PipelineWatcher watcher;
+    watcher.inputDelay(0).pipelineDelay(0).outputDelay(0).smoothnessFactor(4);
+
+    // each frame is done before the next one is done: one in flight, plus one
+    runFrames(&watcher, 64, 2, 5ms, 5ms);
+    EXPECT_EQ(2u, watcher.tunedSmoothnessFactor());
+    for (uint64_t i = 64; i < 66; ++i) {
+        watcher.onWorkQueued(i, {}, PipelineWatcher::Clock::now());
+    }
+    EXPECT_TRUE(watcher.pipelineFull());
+
+    // a flush forgets the measurements
+    watcher.flush();
+    EXPECT_EQ(4u, watcher.tunedSmoothnessFactor());
+    EXPECT_FALSE(watcher.pipelineFull());
+}
+
+TEST(PipelineWatcherTest, KeepsDeepComponentBusy) {
+    PipelineWatcher watcher;
+    watcher.inputDelay(0).pipelineDelay(1).outputDelay(0).smoothnessFactor(4);
+
+    // 30 ms latency at a frame every 10 ms takes 3 frames in flight
+    runFrames(&watcher, 64, 3, 30ms, 10ms);
+    EXPECT_EQ(3u, watcher.tunedSmoothnessFactor());
+
+    // never more than the smoothness factor
+    watcher.flush();
+    runFrames(&watcher, 64, 3, 100ms, 10ms);
+    EXPECT_EQ(4u, watcher.tunedSmoothnessFactor());
+}
+
+}  // namespace android
@@ -31,9 +31,12 @@
 #include <dlfcn.h>
 #include <unistd.h> // getpagesize
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
 
 namespace android {
 
@@ -475,6 +478,13 @@ public:
 
     virtual ~C2PlatformComponentStore() override = default;
 
+    /**
+     * Loads the modules of the named components and keeps them loaded, and keeps one component
+     * of each created ahead of time for createComponent() to hand out. A handed out component
+     * is replaced in the background.
+     */
+    void preload(const std::vector<C2String> &names);
+
 private:
 
     /**
@@ -646,6 +656,17 @@ private:
      */
     void visitComponents();
 
+    /**
+     * Components created ahead of time, and the modules they come from. Shared with the threads
+     * that create the replacements.
+     */
+    struct WarmPool {
+        std::mutex mMutex;
+        std::map<C2String, std::shared_ptr<ComponentModule>> mModules; ///< name -> module
+        std::map<C2String, std::shared_ptr<C2Component>> mComponents; ///< name -> component
+    };
+    std::shared_ptr<WarmPool> mWarmPool;
+
     std::mutex mMutex; ///< mutex guarding the component lists during construction
     bool mVisited; ///< component modules visited
     std::map<C2String, ComponentLoader> mComponents; ///< path -> component module
@@ -833,7 +854,8 @@ std::shared_ptr<const C2Component::Traits> C2PlatformComponentStore::ComponentMo
 }
 
 C2PlatformComponentStore::C2PlatformComponentStore()
-    : mVisited(false),
+    : mWarmPool(std::make_shared<WarmPool>()),
+      mVisited(false),
       mReflector(std::make_shared<C2ReflectorHelper>()),
       mInterface(mReflector) {
 
@@ -899,11 +921,36 @@ void C2PlatformComponentStore::visitComponents() {
     if (mVisited) {
         return;
     }
+    // Loading a module is mostly dynamic linking and relocation, which is independent between
+    // modules, so load them on several threads.
+    std::vector<std::pair<const C2String *, ComponentLoader *>> loaders;
     for (auto &pathAndLoader : mComponents) {
-        const C2String &path = pathAndLoader.first;
-        ComponentLoader &loader = pathAndLoader.second;
-        std::shared_ptr<ComponentModule> module;
-        if (loader.fetchModule(&module) == C2_OK) {
+        loaders.emplace_back(&pathAndLoader.first, &pathAndLoader.second);
+    }
+    std::vector<std::shared_ptr<ComponentModule>> modules(loaders.size());
+    std::atomic<size_t> next(0);
+    auto load = [&loaders, &modules, &next]() {
+        for (size_t i = next++; i < loaders.size(); i = next++) {
+            if (loaders[i].second->fetchModule(&modules[i]) != C2_OK) {
+                modules[i].reset();
+            }
+        }
+    };
+    size_t numThreads = std::min(
+            loaders.size(), (size_t)std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back(load);
+    }
+    load();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < loaders.size(); ++i) {
+        const C2String &path = *loaders[i].first;
+        const std::shared_ptr<ComponentModule> &module = modules[i];
+        if (module) {
             std::shared_ptr<const C2Component::Traits> traits = module->getTraits();
             if (traits) {
                 mComponentList.push_back(traits);
@@ -935,11 +982,54 @@ c2_status_t C2PlatformComponentStore::findComponent(
     return C2_NOT_FOUND;
 }
 
+void C2PlatformComponentStore::preload(const std::vector<C2String> &names) {
+    std::vector<std::thread> threads;
+    for (const C2String &name : names) {
+        threads.emplace_back([this, name]() {
+            std::shared_ptr<ComponentModule> module;
+            std::shared_ptr<C2Component> component;
+            c2_status_t res = findComponent(name, &module);
+            if (res == C2_OK) {
+                res = module->createComponent(0, &component);
+            }
+            if (res != C2_OK) {
+                ALOGW("could not preload %s: %d", name.c_str(), res);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mWarmPool->mMutex);
+            mWarmPool->mModules[name] = module;
+            mWarmPool->mComponents[name] = component;
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
 c2_status_t C2PlatformComponentStore::createComponent(
         C2String name, std::shared_ptr<C2Component> *const component) {
     // This method SHALL return within 100ms.
     component->reset();
     std::shared_ptr<ComponentModule> module;
+    {
+        std::lock_guard<std::mutex> lock(mWarmPool->mMutex);
+        auto it = mWarmPool->mComponents.find(name);
+        if (it != mWarmPool->mComponents.end() && it->second) {
+            *component = std::move(it->second);
+            it->second.reset();
+            module = mWarmPool->mModules[name];
+        }
+    }
+    if (*component) {
+        std::thread([pool = mWarmPool, module, name]() {
+            std::shared_ptr<C2Component> replacement;
+            if (module->createComponent(0, &replacement) == C2_OK) {
+                std::lock_guard<std::mutex> lock(pool->mMutex);
+                pool->mComponents[name] = replacement;
+            }
+        }).detach();
+        return C2_OK;
+    }
     c2_status_t res = findComponent(name, &module);
     if (res == C2_OK) {
         // TODO: get a unique node ID
@@ -991,4 +1081,16 @@ std::shared_ptr<C2ComponentStore> GetCodec2PlatformComponentStore() {
     return store;
 }
 
+void PreloadCodec2PlatformComponents(const std::vector<C2String> &names) {
+    static std::mutex mutex;
+    static std::shared_ptr<C2ComponentStore> preloadedStore; // keeps the warm pool alive
+    std::shared_ptr<C2ComponentStore> store = GetCodec2PlatformComponentStore();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        preloadedStore = store;
+    }
+    // GetCodec2PlatformComponentStore() only ever creates a C2PlatformComponentStore.
+    std::static_pointer_cast<C2PlatformComponentStore>(store)->preload(names);
+}
+
 } // namespace android
@@ -21,6 +21,7 @@
 #include <C2ComponentFactory.h>
 
 #include <memory>
+#include <vector>
 
 namespace android {
 
@@ -123,6 +124,14 @@ c2_status_t CreateCodec2BlockPool(
  */
 std::shared_ptr<C2ComponentStore> GetCodec2PlatformComponentStore();
 
+/**
+ * Loads the libraries of the named platform components ahead of time and keeps them loaded,
+ * along with one component of each created in advance, so that creating those components later
+ * does not wait for library loading and interface setup. This also keeps the platform component
+ * store alive for the rest of the process.
+ */
+void PreloadCodec2PlatformComponents(const std::vector<C2String> &names);
+
 /**
  * Sets the preferred component store in this process for the sole purpose of accessing its
  * interface. If this is not called, the default IComponentStore HAL (if exists) is the preferred
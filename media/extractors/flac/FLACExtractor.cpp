@@ -38,6 +38,7 @@
 #include <media/stagefright/MetaDataUtils.h>
 #include <private/android_filesystem_config.h> // for AID_MEDIA
 #include <system/audio.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -165,8 +166,24 @@ private:
     // most recent error reported by libFLAC parser
     FLAC__StreamDecoderErrorStatus mErrorStatus;
 
+    // Frame boundaries seen while decoding, about one per kSeekPointIntervalSec,
+    // in increasing sample order. A seek close after one of them decodes forward
+    // from it instead of letting libFLAC binary search the file.
+    struct SeekPoint {
+        FLAC__uint64 mSample;
+        FLAC__uint64 mOffset;
+    };
+    static const unsigned kSeekPointIntervalSec = 1;
+    static const unsigned kMaxDecodeAheadSec = 2;
+    Vector<SeekPoint> mSeekPoints;
+
+    // samples to drop from the start of the next frame, after a seek into it
+    unsigned mSkipSamples;
+
     status_t init();
     MediaBufferHelper *readBuffer(bool doSeek, FLAC__uint64 sample);
+    bool seekFromSeekPoints(FLAC__uint64 sample);
+    void addSeekPoint();
 
     // no copy constructor or assignment
     FLACParser(const FLACParser &);
@@ -401,27 +418,59 @@ void FLACParser::errorCallback(FLAC__StreamDecoderErrorStatus status)
 // Copy samples from FLAC native 32-bit non-interleaved to 16-bit signed
 // or 32-bit float interleaved.
 // TODO: Consider moving to audio_utils.
-// These are candidates for optimization if needed.
-static void copyTo16Signed(
+// Mono and stereo have loops of their own, which the compiler vectorizes.
+template <bool kLeftShift>
+static inline short shiftTo16(int sample, int shift) {
+    return kLeftShift ? sample << shift : sample >> shift;
+}
+
+template <bool kLeftShift>
+static void copyTo16SignedShifted(
         short *dst,
         const int *const *src,
         unsigned nSamples,
         unsigned nChannels,
-        unsigned bitsPerSample) {
-    const int leftShift = 16 - (int)bitsPerSample; // cast to int to prevent unsigned overflow.
-    if (leftShift >= 0) {
+        int shift) {
+    switch (nChannels) {
+    case 1:
+        {
+        const int *src0 = src[0];
         for (unsigned i = 0; i < nSamples; ++i) {
-            for (unsigned c = 0; c < nChannels; ++c) {
-                *dst++ = src[c][i] << leftShift;
-            }
+            dst[i] = shiftTo16<kLeftShift>(src0[i], shift);
         }
-    } else {
-        const int rightShift = -leftShift;
+        }
+        break;
+    case 2:
+        {
+        const int *src0 = src[0];
+        const int *src1 = src[1];
+        for (unsigned i = 0; i < nSamples; ++i) {
+            dst[2 * i] = shiftTo16<kLeftShift>(src0[i], shift);
+            dst[2 * i + 1] = shiftTo16<kLeftShift>(src1[i], shift);
+        }
+        }
+        break;
+    default:
         for (unsigned i = 0; i < nSamples; ++i) {
             for (unsigned c = 0; c < nChannels; ++c) {
-                *dst++ = src[c][i] >> rightShift;
+                *dst++ = shiftTo16<kLeftShift>(src[c][i], shift);
             }
         }
+        break;
+    }
+}
+
+static void copyTo16Signed(
+        short *dst,
+        const int *const *src,
+        unsigned nSamples,
+        unsigned nChannels,
+        unsigned bitsPerSample) {
+    const int leftShift = 16 - (int)bitsPerSample; // cast to int to prevent unsigned overflow.
+    if (leftShift >= 0) {
+        copyTo16SignedShifted<true>(dst, src, nSamples, nChannels, leftShift);
+    } else {
+        copyTo16SignedShifted<false>(dst, src, nSamples, nChannels, -leftShift);
     }
 }
 
@@ -459,7 +508,8 @@ FLACParser::FLACParser(
       mStreamInfoValid(false),
       mWriteRequested(false),
       mWriteCompleted(false),
-      mErrorStatus((FLAC__StreamDecoderErrorStatus) -1)
+      mErrorStatus((FLAC__StreamDecoderErrorStatus) -1),
+      mSkipSamples(0)
 {
     ALOGV("FLACParser::FLACParser");
     memset(&mStreamInfo, 0, sizeof(mStreamInfo));
@@ -575,11 +625,89 @@ void FLACParser::releaseBuffers()
 {
 }
 
+// Records where the frame after the one just decoded starts.
+void FLACParser::addSeekPoint()
+{
+    FLAC__uint64 offset;
+    if (!FLAC__stream_decoder_get_decode_position(mDecoder, &offset)) {
+        return;
+    }
+    SeekPoint point;
+    point.mSample = mWriteHeader.number.sample_number + mWriteHeader.blocksize;
+    point.mOffset = offset;
+
+    const FLAC__uint64 interval = (FLAC__uint64)getSampleRate() * kSeekPointIntervalSec;
+    size_t lo = 0;
+    size_t hi = mSeekPoints.size();
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (mSeekPoints[mid].mSample < point.mSample) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if ((lo > 0 && point.mSample - mSeekPoints[lo - 1].mSample < interval)
+            || (lo < mSeekPoints.size() && mSeekPoints[lo].mSample - point.mSample < interval)) {
+        return;
+    }
+    mSeekPoints.insertAt(point, lo);
+}
+
+bool FLACParser::seekFromSeekPoints(FLAC__uint64 sample)
+{
+    if (mSeekPoints.empty() || sample < mSeekPoints[0].mSample) {
+        return false;
+    }
+    size_t lo = 0;
+    size_t hi = mSeekPoints.size();
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (mSeekPoints[mid].mSample <= sample) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    const SeekPoint point = mSeekPoints[lo];
+    if (sample - point.mSample > (FLAC__uint64)getSampleRate() * kMaxDecodeAheadSec) {
+        return false;
+    }
+
+    if (!FLAC__stream_decoder_flush(mDecoder)) {
+        return false;
+    }
+    mCurrentPos = point.mOffset;
+    mEOF = false;
+    for (;;) {
+        mWriteRequested = true;
+        mWriteCompleted = false;
+        if (!FLAC__stream_decoder_process_single(mDecoder) || !mWriteCompleted
+                || mWriteHeader.number_type != FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER) {
+            return false;
+        }
+        const FLAC__uint64 frameSample = mWriteHeader.number.sample_number;
+        if (sample < frameSample + mWriteHeader.blocksize) {
+            mSkipSamples = sample > frameSample ? sample - frameSample : 0;
+            return true;
+        }
+        addSeekPoint();
+    }
+}
+
 MediaBufferHelper *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
 {
     mWriteRequested = true;
     mWriteCompleted = false;
-    if (doSeek) {
+    mSkipSamples = 0;
+    if (doSeek && seekFromSeekPoints(sample)) {
+        ALOGV("FLACParser::readBuffer seek to sample %lld from seek points",
+                (long long)sample);
+    } else if (doSeek) {
+        // seekFromSeekPoints() may have given up half way
+        mWriteRequested = true;
+        mWriteCompleted = false;
+        mSkipSamples = 0;
         // We implement the seek callback, so this works without explicit flush
         if (!FLAC__stream_decoder_seek_absolute(mDecoder, sample)) {
             ALOGE("FLACParser::readBuffer seek to sample %lld failed", (long long)sample);
@@ -610,6 +738,15 @@ MediaBufferHelper *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
                 mWriteHeader.sample_rate, mWriteHeader.channels, mWriteHeader.bits_per_sample);
         return NULL;
     }
+    CHECK(mWriteHeader.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
+    addSeekPoint();
+    // drop the samples before the seek target
+    CHECK(mSkipSamples < blocksize);
+    const FLAC__int32 *writeBuffer[kMaxChannels];
+    for (unsigned c = 0; c < getChannels(); ++c) {
+        writeBuffer[c] = mWriteBuffer[c] + mSkipSamples;
+    }
+    blocksize -= mSkipSamples;
     // acquire a media buffer
     CHECK(mGroup != NULL);
     MediaBufferHelper *buffer;
@@ -624,20 +761,20 @@ MediaBufferHelper *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
     const unsigned bitsPerSample = getBitsPerSample();
     if (mOutputFloat) {
         copyToFloat(reinterpret_cast<float*>(buffer->data()),
-                    mWriteBuffer,
+                    writeBuffer,
                     blocksize,
                     getChannels(),
                     bitsPerSample);
     } else {
         copyTo16Signed(reinterpret_cast<short*>(buffer->data()),
-                       mWriteBuffer,
+                       writeBuffer,
                        blocksize,
                        getChannels(),
                        bitsPerSample);
     }
     // fill in buffer metadata
-    CHECK(mWriteHeader.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
-    FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number;
+    FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number + mSkipSamples;
+    mSkipSamples = 0;
     int64_t timeUs = (1000000LL * sampleNumber) / getSampleRate();
     AMediaFormat *meta = buffer->meta_data();
     AMediaFormat_setInt64(meta, AMEDIAFORMAT_KEY_TIME_US, timeUs);
@@ -44,7 +44,30 @@ namespace android {
 
 struct DataSourceBaseReader : public mkvparser::IMkvReader {
     explicit DataSourceBaseReader(DataSourceHelper *source)
-        : mSource(source) {
+        : mSource(source),
+          mReadAhead(false),
+          mUseCount(0) {
+        for (size_t i = 0; i < kNumWindows; ++i) {
+            mWindows[i].mPosition = -1;
+            mWindows[i].mSize = 0;
+            mWindows[i].mLastUse = 0;
+            mWindows[i].mData = NULL;
+        }
+    }
+
+    virtual ~DataSourceBaseReader() {
+        for (size_t i = 0; i < kNumWindows; ++i) {
+            free(mWindows[i].mData);
+        }
+    }
+
+    // mkvparser reads element headers and frames a few bytes at a time. With
+    // read-ahead, small reads are served from windows of kWindowSize bytes, so
+    // loading a cluster takes a few large reads. Not for live streams, where
+    // reading past the available data would block.
+    void enableReadAhead() {
+        Mutex::Autolock autoLock(mLock);
+        mReadAhead = true;
     }
 
     virtual int Read(long long position, long length, unsigned char* buffer) {
@@ -55,6 +78,19 @@ struct DataSourceBaseReader : public mkvparser::IMkvReader {
             return 0;
         }
 
+        Mutex::Autolock autoLock(mLock);
+
+        if (mReadAhead && (size_t)length < kWindowSize) {
+            const Window *window = findWindow_l(position, length);
+            if (window == NULL) {
+                window = loadWindow_l(position, length);
+            }
+            if (window != NULL) {
+                memcpy(buffer, &window->mData[position - window->mPosition], length);
+                return 0;
+            }
+        }
+
         ssize_t n = mSource->readAt(position, buffer, length);
 
         if (n <= 0) {
@@ -89,7 +125,60 @@ struct DataSourceBaseReader : public mkvparser::IMkvReader {
     }
 
 private:
+    // two windows, as the tracks of a file are read at slightly different positions.
+    static const size_t kWindowSize = 256 * 1024;
+    static const size_t kNumWindows = 2;
+
+    struct Window {
+        long long mPosition;    // -1 if unused
+        size_t mSize;
+        uint32_t mLastUse;
+        unsigned char *mData;
+    };
+
+    Mutex mLock;
     DataSourceHelper *mSource;
+    bool mReadAhead;
+    Window mWindows[kNumWindows];
+    uint32_t mUseCount;
+
+    const Window *findWindow_l(long long position, long length) {
+        for (size_t i = 0; i < kNumWindows; ++i) {
+            Window &window = mWindows[i];
+            if (window.mPosition >= 0 && position >= window.mPosition
+                    && position + length <= window.mPosition + (long long)window.mSize) {
+                window.mLastUse = ++mUseCount;
+                return &window;
+            }
+        }
+        return NULL;
+    }
+
+    const Window *loadWindow_l(long long position, long length) {
+        Window *window = &mWindows[0];
+        for (size_t i = 1; i < kNumWindows; ++i) {
+            if (mWindows[i].mLastUse < window->mLastUse) {
+                window = &mWindows[i];
+            }
+        }
+        if (window->mData == NULL) {
+            window->mData = (unsigned char *)malloc(kWindowSize);
+            if (window->mData == NULL) {
+                return NULL;
+            }
+        }
+
+        window->mPosition = -1;
+        ssize_t n = mSource->readAt(position, window->mData, kWindowSize);
+        if (n < length) {
+            // error or short read, let the caller read directly
+            return NULL;
+        }
+        window->mPosition = position;
+        window->mSize = n;
+        window->mLastUse = ++mUseCount;
+        return window;
+    }
 
     DataSourceBaseReader(const DataSourceBaseReader &);
     DataSourceBaseReader &operator=(const DataSourceBaseReader &);
@@ -97,6 +186,29 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Returns the Cues of the segment, parsing them through the SeekHead if needed.
+static const mkvparser::Cues *findCues(mkvparser::Segment *segment) {
+    const mkvparser::Cues *cues = segment->GetCues();
+    const mkvparser::SeekHead *seekHead = segment->GetSeekHead();
+    if (cues == NULL && seekHead != NULL) {
+        const size_t count = seekHead->GetCount();
+        for (size_t index = 0; index < count; index++) {
+            const mkvparser::SeekHead::Entry *entry = seekHead->GetEntry(index);
+            if (entry->id == libwebm::kMkvCues) { // Cues ID
+                long len;
+                long long pos;
+                segment->ParseCues(entry->pos, pos, len);
+                cues = segment->GetCues();
+                ALOGV("find cue data by seekhead");
+                break;
+            }
+        }
+    }
+    return cues;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct BlockIterator {
     BlockIterator(MatroskaExtractor *extractor, unsigned long trackNum, unsigned long index);
 
@@ -188,30 +300,25 @@ const mkvparser::Track* MatroskaExtractor::TrackInfo::getTrack() const {
 }
 
 // This function does exactly the same as mkvparser::Cues::Find, except that it
-// searches in our own track based vectors. We should not need this once mkvparser
-// adds the same functionality.
-const mkvparser::CuePoint::TrackPosition *MatroskaExtractor::TrackInfo::find(
+// searches in our own track based cue index.
+const MatroskaExtractor::CueIndexEntry *MatroskaExtractor::TrackInfo::find(
         long long timeNs) const {
-    ALOGV("mCuePoints.size %zu", mCuePoints.size());
-    if (mCuePoints.empty()) {
+    ALOGV("mCueIndex.size %zu", mCueIndex.size());
+    if (mCueIndex.empty()) {
         return NULL;
     }
 
-    const mkvparser::CuePoint* cp = mCuePoints.itemAt(0);
-    const mkvparser::Track* track = getTrack();
-    if (timeNs <= cp->GetTime(mExtractor->mSegment)) {
-        return cp->Find(track);
+    if (timeNs <= mCueIndex[0].mTimeNs) {
+        return &mCueIndex[0];
     }
 
     // Binary searches through relevant cues; assumes cues are ordered by timecode.
     // If we do detect out-of-order cues, return NULL.
     size_t lo = 0;
-    size_t hi = mCuePoints.size();
+    size_t hi = mCueIndex.size();
     while (lo < hi) {
         const size_t mid = lo + (hi - lo) / 2;
-        const mkvparser::CuePoint* const midCp = mCuePoints.itemAt(mid);
-        const long long cueTimeNs = midCp->GetTime(mExtractor->mSegment);
-        if (cueTimeNs <= timeNs) {
+        if (mCueIndex[mid].mTimeNs <= timeNs) {
             lo = mid + 1;
         } else {
             hi = mid;
@@ -222,12 +329,12 @@ const mkvparser::CuePoint::TrackPosition *MatroskaExtractor::TrackInfo::find(
         return NULL;
     }
 
-    cp = mCuePoints.itemAt(lo - 1);
-    if (cp->GetTime(mExtractor->mSegment) > timeNs) {
+    const CueIndexEntry *cue = &mCueIndex[lo - 1];
+    if (cue->mTimeNs > timeNs) {
         return NULL;
     }
 
-    return cp->Find(track);
+    return cue;
 }
 
 MatroskaSource::MatroskaSource(
@@ -457,95 +564,30 @@ void BlockIterator::seek(
 
     ALOGV("Seeking to: %" PRId64, seekTimeUs);
 
-    // If the Cues have not been located then find them.
-    const mkvparser::Cues* pCues = pSegment->GetCues();
-    const mkvparser::SeekHead* pSH = pSegment->GetSeekHead();
-    if (!pCues && pSH) {
-        const size_t count = pSH->GetCount();
-        const mkvparser::SeekHead::Entry* pEntry;
-        ALOGV("No Cues yet");
-
-        for (size_t index = 0; index < count; index++) {
-            pEntry = pSH->GetEntry(index);
-
-            if (pEntry->id == libwebm::kMkvCues) { // Cues ID
-                long len; long long pos;
-                pSegment->ParseCues(pEntry->pos, pos, len);
-                pCues = pSegment->GetCues();
-                ALOGV("Cues found");
-                break;
-            }
-        }
-
-        if (!pCues) {
-            ALOGV("No Cues in file,seek without cue data");
-            seekwithoutcue_l(seekTimeUs, actualFrameTimeUs);
-            return;
-        }
-    }
-    else if (!pSH) {
-        ALOGV("No SeekHead, seek without cue data");
-        seekwithoutcue_l(seekTimeUs, actualFrameTimeUs);
-        return;
-    }
-
-    const mkvparser::CuePoint* pCP;
-    mkvparser::Tracks const *pTracks = pSegment->GetTracks();
-    while (!pCues->DoneParsing()) {
-        pCues->LoadCuePoint();
-        pCP = pCues->GetLast();
-        ALOGV("pCP = %s", pCP == NULL ? "NULL" : "not NULL");
-        if (pCP == NULL)
-            continue;
-
-        size_t trackCount = mExtractor->mTracks.size();
-        for (size_t index = 0; index < trackCount; ++index) {
-            MatroskaExtractor::TrackInfo& track = mExtractor->mTracks.editItemAt(index);
-            const mkvparser::Track *pTrack = pTracks->GetTrackByNumber(track.mTrackNum);
-            if (pTrack && pTrack->GetType() == 1 && pCP->Find(pTrack)) { // VIDEO_TRACK
-                track.mCuePoints.push_back(pCP);
-            }
-        }
+    mExtractor->buildCueIndex_l();
 
-        if (pCP->GetTime(pSegment) >= seekTimeNs) {
-            ALOGV("Parsed past relevant Cue");
-            break;
-        }
+    // The Cue index is built around video keyframes
+    const MatroskaExtractor::CueIndexEntry *cue = NULL;
+    if (mTrackType == 1) { // video
+        cue = mExtractor->mTracks.itemAt(mIndex).find(seekTimeNs);
+    } else if (mExtractor->mCueTrackIndex >= 0) {
+        cue = mExtractor->mTracks.itemAt(mExtractor->mCueTrackIndex).find(seekTimeNs);
     }
 
-    const mkvparser::CuePoint::TrackPosition *pTP = NULL;
-    const mkvparser::Track *thisTrack = pTracks->GetTrackByNumber(mTrackNum);
-    if (thisTrack->GetType() == 1) { // video
-        MatroskaExtractor::TrackInfo& track = mExtractor->mTracks.editItemAt(mIndex);
-        pTP = track.find(seekTimeNs);
-    } else {
-        // The Cue index is built around video keyframes
-        unsigned long int trackCount = pTracks->GetTracksCount();
-        for (size_t index = 0; index < trackCount; ++index) {
-            const mkvparser::Track *pTrack = pTracks->GetTrackByIndex(index);
-            if (pTrack && pTrack->GetType() == 1 && pCues->Find(seekTimeNs, pTrack, pCP, pTP)) {
-                ALOGV("Video track located at %zu", index);
-                break;
-            }
-        }
-    }
-
-
     // Always *search* based on the video track, but finalize based on mTrackNum
-    if (!pTP) {
-        ALOGE("Did not locate the video track for seeking");
+    if (cue == NULL) {
+        ALOGV("No cue data for the seek, seek without cue data");
         seekwithoutcue_l(seekTimeUs, actualFrameTimeUs);
         return;
     }
 
-    mCluster = pSegment->FindOrPreloadCluster(pTP->m_pos);
+    mCluster = pSegment->FindOrPreloadCluster(cue->mClusterPos);
 
     CHECK(mCluster);
     CHECK(!mCluster->EOS());
 
-    // mBlockEntryIndex starts at 0 but m_block starts at 1
-    CHECK_GT(pTP->m_block, 0);
-    mBlockEntryIndex = pTP->m_block - 1;
+    // mBlockEntryIndex starts at 0 but mBlock starts at 1
+    mBlockEntryIndex = cue->mBlock - 1;
 
     for (;;) {
         advance_l();
@@ -555,7 +597,7 @@ void BlockIterator::seek(
         if (isAudio || block()->IsKey()) {
             // Accept the first key frame
             int64_t frameTimeUs = (block()->GetTime(mCluster) + 500LL) / 1000LL;
-            if (thisTrack->GetType() == 1 || frameTimeUs >= seekTimeUs) {
+            if (mTrackType == 1 || frameTimeUs >= seekTimeUs) {
                 *actualFrameTimeUs = frameTimeUs;
                 ALOGV("Requested seek point: %" PRId64 " actual: %" PRId64,
                       seekTimeUs, *actualFrameTimeUs);
@@ -1321,13 +1363,18 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
       mSegment(NULL),
       mExtractedThumbnails(false),
       mIsWebm(false),
-      mSeekPreRollNs(0) {
+      mSeekPreRollNs(0),
+      mCueIndexBuilt(false),
+      mCueTrackIndex(-1) {
     off64_t size;
     mIsLiveStreaming =
         (mDataSource->flags()
             & (DataSourceBase::kWantsPrefetching
                 | DataSourceBase::kIsCachingDataSource))
         && mDataSource->getSize(&size) != OK;
+    if (!mIsLiveStreaming) {
+        mReader->enableReadAhead();
+    }
 
     mkvparser::EBMLHeader ebmlHeader;
     long long pos;
@@ -1368,24 +1415,7 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
             mSegment = NULL;
             return;
         } else if (ret == 0) {
-            const mkvparser::Cues* mCues = mSegment->GetCues();
-            const mkvparser::SeekHead* mSH = mSegment->GetSeekHead();
-            if ((mCues == NULL) && (mSH != NULL)) {
-                size_t count = mSH->GetCount();
-                const mkvparser::SeekHead::Entry* mEntry;
-                for (size_t index = 0; index < count; index++) {
-                    mEntry = mSH->GetEntry(index);
-                    if (mEntry->id == libwebm::kMkvCues) { // Cues ID
-                        long len;
-                        long long pos;
-                        mSegment->ParseCues(mEntry->pos, pos, len);
-                        mCues = mSegment->GetCues();
-                        ALOGV("find cue data by seekhead");
-                        break;
-                    }
-                }
-            }
-
+            const mkvparser::Cues* mCues = findCues(mSegment);
             if (mCues) {
                 long len;
                 ret = mSegment->LoadCluster(pos, len);
@@ -1419,6 +1449,55 @@ MatroskaExtractor::MatroskaExtractor(DataSourceHelper *source)
 #endif
 
     addTracks();
+
+    if (!mIsLiveStreaming) {
+        // Cues are small compared to the clusters, index them before the first seek.
+        buildCueIndex_l();
+    }
+}
+
+void MatroskaExtractor::buildCueIndex_l() {
+    if (mCueIndexBuilt || mSegment == NULL) {
+        return;
+    }
+    mCueIndexBuilt = true;
+
+    const mkvparser::Cues *cues = findCues(mSegment);
+    if (cues == NULL) {
+        ALOGV("No Cues in file");
+        return;
+    }
+
+    while (!cues->DoneParsing()) {
+        if (!cues->LoadCuePoint()) {
+            break;
+        }
+    }
+
+    const mkvparser::Tracks *tracks = mSegment->GetTracks();
+    for (const mkvparser::CuePoint *cp = cues->GetFirst(); cp != NULL; cp = cues->GetNext(cp)) {
+        const long long timeNs = cp->GetTime(mSegment);
+        for (size_t index = 0; index < mTracks.size(); ++index) {
+            TrackInfo &track = mTracks.editItemAt(index);
+            const mkvparser::Track *pTrack = tracks->GetTrackByNumber(track.mTrackNum);
+            if (pTrack == NULL || pTrack->GetType() != 1) { // VIDEO_TRACK
+                continue;
+            }
+            const mkvparser::CuePoint::TrackPosition *tp = cp->Find(pTrack);
+            if (tp == NULL || tp->m_block <= 0) {
+                continue;
+            }
+            CueIndexEntry entry;
+            entry.mTimeNs = timeNs;
+            entry.mClusterPos = tp->m_pos;
+            entry.mBlock = tp->m_block;
+            track.mCueIndex.push_back(entry);
+            if (mCueTrackIndex < 0) {
+                mCueTrackIndex = index;
+            }
+        }
+    }
+    ALOGV("indexed %ld cue points", cues->GetCount());
 }
 
 MatroskaExtractor::~MatroskaExtractor() {
@@ -57,6 +57,14 @@ private:
     friend struct MatroskaSource;
     friend struct BlockIterator;
 
+    // A cue point of a video track, copied out of mkvparser so that seeks
+    // binary search a flat array instead of walking the Cues element.
+    struct CueIndexEntry {
+        long long mTimeNs;
+        long long mClusterPos;
+        long long mBlock;       // 1-based block number in the cluster
+    };
+
     struct TrackInfo {
         TrackInfo() {
             mMeta = NULL;
@@ -68,7 +76,7 @@ private:
         bool mEncrypted;
         AMediaFormat *mMeta;
         const MatroskaExtractor *mExtractor;
-        Vector<const mkvparser::CuePoint*> mCuePoints;
+        Vector<CueIndexEntry> mCueIndex;
 
         // mHeader points to memory managed by mkvparser;
         // mHeader would be deleted when mSegment is deleted
@@ -78,7 +86,7 @@ private:
         int32_t mNalLengthSize;
 
         const mkvparser::Track* getTrack() const;
-        const mkvparser::CuePoint::TrackPosition *find(long long timeNs) const;
+        const CueIndexEntry *find(long long timeNs) const;
     };
 
     Mutex mLock;
@@ -91,6 +99,8 @@ private:
     bool mIsLiveStreaming;
     bool mIsWebm;
     int64_t mSeekPreRollNs;
+    bool mCueIndexBuilt;
+    ssize_t mCueTrackIndex;     // video track whose cues locate clusters for the others, or -1
 
     status_t synthesizeAVCC(TrackInfo *trackInfo, size_t index);
     status_t synthesizeMPEG2(TrackInfo *trackInfo, size_t index);
@@ -100,6 +110,7 @@ private:
             AMediaFormat *meta,
             TrackInfo *trackInfo);
     void addTracks();
+    void buildCueIndex_l();
     void findThumbnails();
     void getColorInformation(
             const mkvparser::VideoTrack *vtrack,
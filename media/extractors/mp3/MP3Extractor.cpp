@@ -34,6 +34,7 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MetaData.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -226,6 +227,15 @@ protected:
     virtual ~MP3Source();
 
 private:
+    // A frame position every kFrameIndexIntervalUs, recorded while the frames
+    // are read in order from the first one, so that seeks into the part
+    // already played are exact, even without a TOC or for VBR streams.
+    struct FrameIndexEntry {
+        int64_t mTimeUs;
+        off64_t mPos;
+    };
+    static const int64_t kFrameIndexIntervalUs = 1000000ll;
+
     static const size_t kMaxFrameSize;
     AMediaFormat *mMeta;
     DataSourceHelper *mDataSource;
@@ -239,6 +249,14 @@ private:
     int64_t mBasisTimeUs;
     int64_t mSamplesRead;
 
+    Vector<FrameIndexEntry> mFrameIndex;
+    off64_t mFrameIndexEndPos;      // end of the last frame indexed
+    int64_t mFrameIndexEndUs;
+    bool mTimeExact;                // false after seeking to an estimated position
+
+    bool seekInFrameIndex(int64_t seekTimeUs);
+    void addToFrameIndex(off64_t pos, int64_t timeUs, size_t frameSize);
+
     MP3Source(const MP3Source &);
     MP3Source &operator=(const MP3Source &);
 };
@@ -372,7 +390,7 @@ MP3Extractor::MP3Extractor(
     // When getting the id3 tag, skip the V1 tags to prevent the source cache
     // from being iterated to the end of the file.
     DataSourceHelper helper(mDataSource);
-    ID3 id3(&helper, true);
+    ID3 id3(&helper, true, 0 /* offset */, true /* lazy */);
     if (id3.isValid()) {
         ID3::Iterator *com = new ID3::Iterator(id3, "COM");
         if (com->done()) {
@@ -455,7 +473,10 @@ MP3Source::MP3Source(
       mStarted(false),
       mSeeker(seeker),
       mBasisTimeUs(0),
-      mSamplesRead(0) {
+      mSamplesRead(0),
+      mFrameIndexEndPos(0),
+      mFrameIndexEndUs(0),
+      mTimeExact(true) {
 }
 
 MP3Source::~MP3Source() {
@@ -474,6 +495,7 @@ media_status_t MP3Source::start() {
 
     mBasisTimeUs = mCurrentTimeUs;
     mSamplesRead = 0;
+    mTimeExact = true;
 
     mStarted = true;
 
@@ -492,6 +514,75 @@ media_status_t MP3Source::getFormat(AMediaFormat *meta) {
     return AMediaFormat_copy(meta, mMeta);
 }
 
+bool MP3Source::seekInFrameIndex(int64_t seekTimeUs) {
+    if (mFrameIndex.empty() || seekTimeUs >= mFrameIndexEndUs) {
+        return false;
+    }
+
+    size_t lo = 0;
+    size_t hi = mFrameIndex.size();
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (mFrameIndex[mid].mTimeUs <= seekTimeUs) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    off64_t pos = mFrameIndex[lo].mPos;
+    int64_t samples = 0;
+    int64_t timeUs = mFrameIndex[lo].mTimeUs;
+
+    // walk the frame headers up to the frame containing seekTimeUs
+    for (;;) {
+        uint8_t headerData[4];
+        size_t frameSize;
+        int sampleRate;
+        int numSamples;
+        if (mDataSource->readAt(pos, headerData, 4) < 4) {
+            break;
+        }
+        const uint32_t header = U32_AT(headerData);
+        if ((header & kMask) != (mFixedHeader & kMask)
+                || !GetMPEGAudioFrameSize(
+                        header, &frameSize, &sampleRate, NULL, NULL, &numSamples)) {
+            break; // read() resyncs from here
+        }
+        const int64_t nextTimeUs = mFrameIndex[lo].mTimeUs
+                + ((samples + numSamples) * 1000000) / sampleRate;
+        if (nextTimeUs > seekTimeUs) {
+            break;
+        }
+        pos += frameSize;
+        samples += numSamples;
+        timeUs = nextTimeUs;
+    }
+
+    mCurrentPos = pos;
+    mCurrentTimeUs = timeUs;
+    mBasisTimeUs = mFrameIndex[lo].mTimeUs;
+    mSamplesRead = samples;
+    mTimeExact = true;
+    return true;
+}
+
+void MP3Source::addToFrameIndex(off64_t pos, int64_t timeUs, size_t frameSize) {
+    // reading continues from an indexed position, so timeUs is exact.
+    if (!mTimeExact || pos < mFrameIndexEndPos) {
+        return;
+    }
+    if (mFrameIndex.empty()
+            || timeUs >= mFrameIndex[mFrameIndex.size() - 1].mTimeUs + kFrameIndexIntervalUs) {
+        FrameIndexEntry entry;
+        entry.mTimeUs = timeUs;
+        entry.mPos = pos;
+        mFrameIndex.push_back(entry);
+    }
+    mFrameIndexEndPos = pos + frameSize;
+    mFrameIndexEndUs = mCurrentTimeUs;
+}
+
 media_status_t MP3Source::read(
         MediaBufferHelper **out, const ReadOptions *options) {
     *out = NULL;
@@ -502,7 +593,9 @@ media_status_t MP3Source::read(
 
     if (options != NULL && options->getSeekTo(&seekTimeUs, &mode)) {
         int64_t actualSeekTimeUs = seekTimeUs;
-        if (mSeeker == NULL
+        if (seekInFrameIndex(seekTimeUs)) {
+            ALOGV("seek to %lld us from the frame index", (long long)mCurrentTimeUs);
+        } else if (mSeeker == NULL
                 || !mSeeker->getOffsetForTime(&actualSeekTimeUs, &mCurrentPos)) {
             int32_t bitrate;
             if (!AMediaFormat_getInt32(mMeta, AMEDIAFORMAT_KEY_BIT_RATE, &bitrate)) {
@@ -515,12 +608,15 @@ media_status_t MP3Source::read(
             mCurrentTimeUs = seekTimeUs;
             mCurrentPos = mFirstFramePos + seekTimeUs * bitrate / 8000000;
             seekCBR = true;
+            mBasisTimeUs = mCurrentTimeUs;
+            mSamplesRead = 0;
+            mTimeExact = false;
         } else {
             mCurrentTimeUs = actualSeekTimeUs;
+            mBasisTimeUs = mCurrentTimeUs;
+            mSamplesRead = 0;
+            mTimeExact = false;
         }
-
-        mBasisTimeUs = mCurrentTimeUs;
-        mSamplesRead = 0;
     }
 
     MediaBufferHelper *buffer;
@@ -594,11 +690,15 @@ media_status_t MP3Source::read(
     AMediaFormat_setInt64(meta, AMEDIAFORMAT_KEY_TIME_US, mCurrentTimeUs);
     AMediaFormat_setInt32(meta, AMEDIAFORMAT_KEY_IS_SYNC_FRAME, 1);
 
+    const off64_t framePos = mCurrentPos;
+    const int64_t frameTimeUs = mCurrentTimeUs;
     mCurrentPos += frame_size;
 
     mSamplesRead += num_samples;
     mCurrentTimeUs = mBasisTimeUs + ((mSamplesRead * 1000000) / sample_rate);
 
+    addToFrameIndex(framePos, frameTimeUs, frame_size);
+
     *out = buffer;
 
     return AMEDIA_OK;
@@ -612,7 +712,7 @@ media_status_t MP3Extractor::getMetaData(AMediaFormat *meta) {
     AMediaFormat_setString(meta, AMEDIAFORMAT_KEY_MIME, MEDIA_MIMETYPE_AUDIO_MPEG);
 
     DataSourceHelper helper(mDataSource);
-    ID3 id3(&helper);
+    ID3 id3(&helper, false /* ignoreV1 */, 0 /* offset */, true /* lazy */);
 
     if (!id3.isValid()) {
         return AMEDIA_OK;
@@ -69,6 +69,10 @@ enum {
     // maximum size of an atom. Some atoms can be bigger according to the spec,
     // but we only allow up to this size.
     kMaxAtomSize = 64 * 1024 * 1024,
+
+    // sample tables of local files up to this size are read into memory at once,
+    // instead of with a small read for every sample size and chunk offset lookup.
+    kMaxLocalSampleTableCacheSize = 16 * 1024 * 1024,
 };
 
 class MPEG4Source : public MediaTrackHelper {
@@ -80,6 +84,7 @@ public:
                 int32_t timeScale,
                 const sp<SampleTable> &sampleTable,
                 Vector<SidxEntry> &sidx,
+                const Vector<FragmentIndexEntry> &fragmentIndex,
                 const Trex *trex,
                 off64_t firstMoofOffset,
                 const sp<ItemTable> &itemTable,
@@ -108,6 +113,7 @@ private:
     uint32_t mCurrentSampleIndex;
     uint32_t mCurrentFragmentIndex;
     Vector<SidxEntry> &mSegments;
+    const Vector<FragmentIndexEntry> &mFragmentIndex;
     const Trex *mTrex;
     off64_t mFirstMoofOffset;
     off64_t mCurrentMoofOffset;
@@ -233,6 +239,44 @@ private:
     CachedRangedDataSource &operator=(const CachedRangedDataSource &);
 };
 
+// This data source is shared by all tracks of an extractor. Small reads, e.g. the
+// audio samples and fragment headers interleaved with video, are served from a few
+// recently read aligned blocks, so that neighboring chunks of different tracks are
+// fetched with one large read. Reads of at least a block go to the wrapped source
+// directly, after using whatever leading part is already cached.
+class ReadAheadDataSource : public DataSourceHelper {
+public:
+    explicit ReadAheadDataSource(DataSourceHelper *source);
+    virtual ~ReadAheadDataSource();
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override;
+    status_t getSize(off64_t *size) override;
+    uint32_t flags() override;
+
+private:
+    static const size_t kBlockSize = 64 * 1024;
+    static const size_t kNumBlocks = 4;
+
+    struct Block {
+        off64_t mOffset;        // -1 if unused
+        size_t mSize;           // less than kBlockSize at the end of the source
+        uint32_t mLastUse;
+        uint8_t *mData;
+    };
+
+    Mutex mLock;
+
+    DataSourceHelper *mSource;
+    Block mBlocks[kNumBlocks];
+    uint32_t mUseCount;
+
+    const Block *findBlock_l(off64_t offset);
+    const Block *loadBlock_l(off64_t offset);
+
+    ReadAheadDataSource(const ReadAheadDataSource &);
+    ReadAheadDataSource &operator=(const ReadAheadDataSource &);
+};
+
 CachedRangedDataSource::CachedRangedDataSource(DataSourceHelper *source)
     : DataSourceHelper(source),
       mSource(source),
@@ -307,6 +351,115 @@ status_t CachedRangedDataSource::setCachedRange(off64_t offset,
 
 ////////////////////////////////////////////////////////////////////////////////
 
+ReadAheadDataSource::ReadAheadDataSource(DataSourceHelper *source)
+    : DataSourceHelper(source),
+      mSource(source),
+      mUseCount(0) {
+    for (size_t i = 0; i < kNumBlocks; ++i) {
+        mBlocks[i].mOffset = -1;
+        mBlocks[i].mSize = 0;
+        mBlocks[i].mLastUse = 0;
+        mBlocks[i].mData = NULL;
+    }
+}
+
+ReadAheadDataSource::~ReadAheadDataSource() {
+    for (size_t i = 0; i < kNumBlocks; ++i) {
+        free(mBlocks[i].mData);
+    }
+}
+
+const ReadAheadDataSource::Block *ReadAheadDataSource::findBlock_l(off64_t offset) {
+    for (size_t i = 0; i < kNumBlocks; ++i) {
+        Block &block = mBlocks[i];
+        if (block.mOffset >= 0 && offset >= block.mOffset
+                && offset < block.mOffset + (off64_t)block.mSize) {
+            block.mLastUse = ++mUseCount;
+            return &block;
+        }
+    }
+    return NULL;
+}
+
+const ReadAheadDataSource::Block *ReadAheadDataSource::loadBlock_l(off64_t offset) {
+    Block *lru = &mBlocks[0];
+    for (size_t i = 1; i < kNumBlocks; ++i) {
+        if (mBlocks[i].mLastUse < lru->mLastUse) {
+            lru = &mBlocks[i];
+        }
+    }
+
+    if (lru->mData == NULL) {
+        lru->mData = (uint8_t *)malloc(kBlockSize);
+        if (lru->mData == NULL) {
+            return NULL;
+        }
+    }
+
+    lru->mOffset = -1;
+    off64_t blockOffset = offset - offset % kBlockSize;
+    ssize_t n = mSource->readAt(blockOffset, lru->mData, kBlockSize);
+    if (n <= offset - blockOffset) {
+        return NULL;
+    }
+    lru->mOffset = blockOffset;
+    lru->mSize = n;
+    lru->mLastUse = ++mUseCount;
+    return lru;
+}
+
+ssize_t ReadAheadDataSource::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (offset < 0) {
+        return mSource->readAt(offset, data, size);
+    }
+
+    uint8_t *dst = (uint8_t *)data;
+    size_t copied = 0;
+    while (copied < size) {
+        const Block *block = findBlock_l(offset);
+        if (block == NULL) {
+            if (size - copied >= kBlockSize) {
+                ssize_t n = mSource->readAt(offset, dst, size - copied);
+                if (n < 0) {
+                    return copied > 0 ? (ssize_t)copied : n;
+                }
+                return copied + n;
+            }
+            block = loadBlock_l(offset);
+            if (block == NULL) {
+                // error or end of stream, let the source report it
+                if (copied > 0) {
+                    return copied;
+                }
+                return mSource->readAt(offset, dst, size);
+            }
+        }
+
+        size_t start = offset - block->mOffset;
+        size_t n = std::min(size - copied, block->mSize - start);
+        memcpy(dst, &block->mData[start], n);
+        dst += n;
+        offset += n;
+        copied += n;
+        if (block->mSize < kBlockSize && start + n == block->mSize) {
+            break; // end of the source
+        }
+    }
+    return copied;
+}
+
+status_t ReadAheadDataSource::getSize(off64_t *size) {
+    return mSource->getSize(size);
+}
+
+uint32_t ReadAheadDataSource::flags() {
+    return mSource->flags();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 static const bool kUseHexDump = false;
 
 static const char *FourCC2MIME(uint32_t fourcc) {
@@ -385,6 +538,7 @@ MPEG4Extractor::MPEG4Extractor(DataSourceHelper *source, const char *mime)
       mMoofFound(false),
       mMdatFound(false),
       mDataSource(source),
+      mSampleDataSource(NULL),
       mInitCheck(NO_INIT),
       mHeaderTimescale(0),
       mIsQT(false),
@@ -412,13 +566,18 @@ MPEG4Extractor::~MPEG4Extractor() {
     }
     mPssh.clear();
 
+    delete mSampleDataSource;
     delete mDataSource;
     AMediaFormat_delete(mFileMetaData);
 }
 
 uint32_t MPEG4Extractor::flags() const {
+    bool hasFragmentIndex = false;
+    for (Track *track = mFirstTrack; track != NULL; track = track->next) {
+        hasFragmentIndex |= !track->fragmentIndex.empty();
+    }
     return CAN_PAUSE |
-            ((mMoofOffset == 0 || mSidxEntries.size() != 0) ?
+            ((mMoofOffset == 0 || mSidxEntries.size() != 0 || hasFragmentIndex) ?
                     (CAN_SEEK_BACKWARD | CAN_SEEK_FORWARD | CAN_SEEK) : 0);
 }
 
@@ -648,6 +807,11 @@ status_t MPEG4Extractor::readMetaData() {
         }
     }
 
+    if (mMoofFound && mSidxEntries.empty()) {
+        // optional, fragmented files without it can only seek to the start.
+        (void)parseMovieFragmentRandomAccess();
+    }
+
     if (mIsHeif && (mItemTable != NULL) && (mItemTable->countImages() > 0)) {
         off64_t exifOffset;
         size_t exifSize;
@@ -935,9 +1099,11 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             if (chunk_type == FOURCC("stbl")) {
                 ALOGV("sampleTable chunk is %" PRIu64 " bytes long.", chunk_size);
 
-                if (mDataSource->flags()
-                        & (DataSourceBase::kWantsPrefetching
-                            | DataSourceBase::kIsCachingDataSource)) {
+                uint32_t flags = mDataSource->flags();
+                if ((flags & (DataSourceBase::kWantsPrefetching
+                            | DataSourceBase::kIsCachingDataSource))
+                        || ((flags & DataSourceBase::kIsLocalFileSource)
+                            && chunk_size <= kMaxLocalSampleTableCacheSize)) {
                     CachedRangedDataSource *cachedSource =
                         new CachedRangedDataSource(mDataSource);
 
@@ -3392,6 +3558,13 @@ status_t MPEG4Extractor::parseSegmentIndex(off64_t offset, size_t size) {
         SidxEntry se;
         se.mSize = d1 & 0x7fffffff;
         se.mDurationUs = 1000000LL * d2 / timeScale;
+        se.mStartOffset = 0;
+        se.mStartTimeUs = 0;
+        if (!mSidxEntries.empty()) {
+            const SidxEntry &prev = mSidxEntries[mSidxEntries.size() - 1];
+            se.mStartOffset = prev.mStartOffset + prev.mSize;
+            se.mStartTimeUs = prev.mStartTimeUs + prev.mDurationUs;
+        }
         mSidxEntries.add(se);
     }
 
@@ -3408,6 +3581,134 @@ status_t MPEG4Extractor::parseSegmentIndex(off64_t offset, size_t size) {
     return OK;
 }
 
+status_t MPEG4Extractor::parseMovieFragmentRandomAccess() {
+    // the mfro box at the end of the file gives the size of the mfra box.
+    off64_t fileSize;
+    if (mDataSource->getSize(&fileSize) != OK || fileSize < 16) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    uint8_t mfro[16];
+    if (mDataSource->readAt(fileSize - 16, mfro, sizeof(mfro)) < (ssize_t)sizeof(mfro)
+            || U32_AT(mfro) != 16 || U32_AT(&mfro[4]) != FOURCC("mfro")) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    uint32_t mfraSize = U32_AT(&mfro[12]);
+    if (mfraSize < 8 + sizeof(mfro) || mfraSize > fileSize || mfraSize > kMaxAtomSize) {
+        return ERROR_MALFORMED;
+    }
+
+    off64_t offset = fileSize - mfraSize;
+    uint8_t header[8];
+    if (mDataSource->readAt(offset, header, sizeof(header)) < (ssize_t)sizeof(header)
+            || U32_AT(header) != mfraSize || U32_AT(&header[4]) != FOURCC("mfra")) {
+        return ERROR_MALFORMED;
+    }
+    offset += sizeof(header);
+
+    const off64_t end = fileSize - sizeof(mfro);
+    while (offset + (off64_t)sizeof(header) <= end) {
+        if (mDataSource->readAt(offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+            return ERROR_IO;
+        }
+        uint32_t size = U32_AT(header);
+        if (size < sizeof(header) || size > end - offset) {
+            return ERROR_MALFORMED;
+        }
+        if (U32_AT(&header[4]) == FOURCC("tfra")) {
+            status_t err = parseTrackFragmentRandomAccess(
+                    offset + sizeof(header), size - sizeof(header));
+            if (err != OK) {
+                return err;
+            }
+        }
+        offset += size;
+    }
+    return OK;
+}
+
+status_t MPEG4Extractor::parseTrackFragmentRandomAccess(off64_t offset, size_t size) {
+    if (size < 16) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t *buffer = (uint8_t *)malloc(size);
+    if (buffer == NULL) {
+        return NO_MEMORY;
+    }
+    if (mDataSource->readAt(offset, buffer, size) < (ssize_t)size) {
+        free(buffer);
+        return ERROR_IO;
+    }
+
+    uint32_t version = buffer[0];
+    uint32_t trackId = U32_AT(&buffer[4]);
+    uint32_t lengths = U32_AT(&buffer[8]);
+    uint32_t numEntries = U32_AT(&buffer[12]);
+    size_t trafNumberSize = ((lengths >> 4) & 3) + 1;
+    size_t trunNumberSize = ((lengths >> 2) & 3) + 1;
+    size_t sampleNumberSize = (lengths & 3) + 1;
+    size_t entrySize = (version == 1 ? 16 : 8)
+            + trafNumberSize + trunNumberSize + sampleNumberSize;
+
+    Track *track = mFirstTrack;
+    while (track != NULL) {
+        int32_t id;
+        if (AMediaFormat_getInt32(track->meta, AMEDIAFORMAT_KEY_TRACK_ID, &id)
+                && (uint32_t)id == trackId) {
+            break;
+        }
+        track = track->next;
+    }
+
+    if (track == NULL || numEntries > (size - 16) / entrySize) {
+        free(buffer);
+        return track == NULL ? OK : ERROR_MALFORMED;
+    }
+
+    auto readNumber = [](const uint8_t *ptr, size_t numBytes) {
+        uint32_t x = 0;
+        for (size_t i = 0; i < numBytes; ++i) {
+            x = (x << 8) | ptr[i];
+        }
+        return x;
+    };
+
+    track->fragmentIndex.clear();
+    const uint8_t *ptr = &buffer[16];
+    for (uint32_t i = 0; i < numEntries; ++i, ptr += entrySize) {
+        FragmentIndexEntry entry;
+        const uint8_t *numbers;
+        if (version == 1) {
+            entry.mTime = U64_AT(ptr);
+            entry.mMoofOffset = U64_AT(&ptr[8]);
+            numbers = &ptr[16];
+        } else {
+            entry.mTime = U32_AT(ptr);
+            entry.mMoofOffset = U32_AT(&ptr[4]);
+            numbers = &ptr[8];
+        }
+        uint32_t trunNumber = readNumber(&numbers[trafNumberSize], trunNumberSize);
+        uint32_t sampleNumber = readNumber(
+                &numbers[trafNumberSize + trunNumberSize], sampleNumberSize);
+
+        // fragmentedRead() can only start at the beginning of a fragment, and needs
+        // the entries in increasing time order.
+        if (trunNumber != 1 || sampleNumber != 1 || entry.mMoofOffset < mMoofOffset
+                || (!track->fragmentIndex.empty() && entry.mTime
+                        <= track->fragmentIndex[track->fragmentIndex.size() - 1].mTime)) {
+            continue;
+        }
+        track->fragmentIndex.add(entry);
+    }
+    free(buffer);
+
+    ALOGV("track %u: %zu of %u tfra entries usable for seeking",
+            trackId, track->fragmentIndex.size(), numEntries);
+    return OK;
+}
+
 status_t MPEG4Extractor::parseQTMetaKey(off64_t offset, size_t size) {
     if (size < 8) {
         return ERROR_MALFORMED;
@@ -4000,7 +4301,7 @@ status_t MPEG4Extractor::parse3GPPMetaData(off64_t offset, size_t size, int dept
 }
 
 void MPEG4Extractor::parseID3v2MetaData(off64_t offset) {
-    ID3 id3(mDataSource, true /* ignorev1 */, offset);
+    ID3 id3(mDataSource, true /* ignorev1 */, offset, true /* lazy */);
 
     if (id3.isValid()) {
         struct Map {
@@ -4146,9 +4447,13 @@ MediaTrackHelper *MPEG4Extractor::getTrack(size_t index) {
         ALOGV("video track->elstShiftStartTicks :%" PRIu64, track->elstShiftStartTicks);
     }
 
+    if (mSampleDataSource == NULL) {
+        mSampleDataSource = new ReadAheadDataSource(mDataSource);
+    }
+
     MPEG4Source *source =  new MPEG4Source(
-            track->meta, mDataSource, track->timescale, track->sampleTable,
-            mSidxEntries, trex, mMoofOffset, itemTable,
+            track->meta, mSampleDataSource, track->timescale, track->sampleTable,
+            mSidxEntries, track->fragmentIndex, trex, mMoofOffset, itemTable,
             track->elstShiftStartTicks);
     if (source->init() != OK) {
         delete source;
@@ -4635,6 +4940,7 @@ MPEG4Source::MPEG4Source(
         int32_t timeScale,
         const sp<SampleTable> &sampleTable,
         Vector<SidxEntry> &sidx,
+        const Vector<FragmentIndexEntry> &fragmentIndex,
         const Trex *trex,
         off64_t firstMoofOffset,
         const sp<ItemTable> &itemTable,
@@ -4646,6 +4952,7 @@ MPEG4Source::MPEG4Source(
       mCurrentSampleIndex(0),
       mCurrentFragmentIndex(0),
       mSegments(sidx),
+      mFragmentIndex(fragmentIndex),
       mTrex(trex),
       mFirstMoofOffset(firstMoofOffset),
       mCurrentMoofOffset(firstMoofOffset),
@@ -5997,26 +6304,40 @@ media_status_t MPEG4Source::fragmentedRead(
         ALOGV("shifted seekTimeUs :%" PRId64 ", mElstShiftStartTicks:%" PRIu64, seekTimeUs,
               mElstShiftStartTicks);
 
-        int numSidxEntries = mSegments.size();
+        size_t numSidxEntries = mSegments.size();
         if (numSidxEntries != 0) {
-            int64_t totalTime = 0;
-            off64_t totalOffset = mFirstMoofOffset;
-            for (int i = 0; i < numSidxEntries; i++) {
-                const SidxEntry *se = &mSegments[i];
-                if (totalTime + se->mDurationUs > seekTimeUs) {
-                    // The requested time is somewhere in this segment
-                    if ((mode == ReadOptions::SEEK_NEXT_SYNC && seekTimeUs > totalTime) ||
-                        (mode == ReadOptions::SEEK_CLOSEST_SYNC &&
-                        (seekTimeUs - totalTime) > (totalTime + se->mDurationUs - seekTimeUs))) {
-                        // requested next sync, or closest sync and it was closer to the end of
-                        // this segment
-                        totalTime += se->mDurationUs;
-                        totalOffset += se->mSize;
-                    }
-                    break;
+            // first segment ending after the requested time
+            size_t left = 0;
+            size_t right_plus_one = numSidxEntries;
+            while (left < right_plus_one) {
+                size_t center = left + (right_plus_one - left) / 2;
+                const SidxEntry &se = mSegments[center];
+                if (se.mStartTimeUs + se.mDurationUs > seekTimeUs) {
+                    right_plus_one = center;
+                } else {
+                    left = center + 1;
+                }
+            }
+
+            int64_t totalTime;
+            off64_t totalOffset;
+            if (left == numSidxEntries) {
+                const SidxEntry &last = mSegments[numSidxEntries - 1];
+                totalTime = last.mStartTimeUs + last.mDurationUs;
+                totalOffset = mFirstMoofOffset + last.mStartOffset + last.mSize;
+            } else {
+                // The requested time is somewhere in this segment
+                const SidxEntry *se = &mSegments[left];
+                totalTime = se->mStartTimeUs;
+                totalOffset = mFirstMoofOffset + se->mStartOffset;
+                if ((mode == ReadOptions::SEEK_NEXT_SYNC && seekTimeUs > totalTime) ||
+                    (mode == ReadOptions::SEEK_CLOSEST_SYNC &&
+                    (seekTimeUs - totalTime) > (totalTime + se->mDurationUs - seekTimeUs))) {
+                    // requested next sync, or closest sync and it was closer to the end of
+                    // this segment
+                    totalTime += se->mDurationUs;
+                    totalOffset += se->mSize;
                 }
-                totalTime += se->mDurationUs;
-                totalOffset += se->mSize;
             }
             mCurrentMoofOffset = totalOffset;
             mNextMoofOffset = -1;
@@ -6027,8 +6348,47 @@ media_status_t MPEG4Source::fragmentedRead(
                 return AMEDIA_ERROR_UNKNOWN;
             }
             mCurrentTime = totalTime * mTimescale / 1000000ll;
+        } else if (!mFragmentIndex.empty()) {
+            // last fragment starting at or before the requested time
+            uint64_t seekTime = seekTimeUs < 0 ? 0 : (uint64_t)seekTimeUs * mTimescale / 1000000ll;
+            size_t left = 0;
+            size_t right_plus_one = mFragmentIndex.size();
+            while (left < right_plus_one) {
+                size_t center = left + (right_plus_one - left) / 2;
+                if (mFragmentIndex[center].mTime <= seekTime) {
+                    left = center + 1;
+                } else {
+                    right_plus_one = center;
+                }
+            }
+            size_t index = left > 0 ? left - 1 : 0;
+            if (left < mFragmentIndex.size() && mFragmentIndex[left].mTime > seekTime
+                    && (left == 0 || mode == ReadOptions::SEEK_NEXT_SYNC
+                        || (mode == ReadOptions::SEEK_CLOSEST_SYNC
+                            && mFragmentIndex[left].mTime - seekTime
+                                    < seekTime - mFragmentIndex[left - 1].mTime))) {
+                index = left;
+            }
+            const FragmentIndexEntry &entry = mFragmentIndex[index];
+
+            mCurrentMoofOffset = entry.mMoofOffset;
+            mNextMoofOffset = -1;
+            mCurrentSamples.clear();
+            mCurrentSampleIndex = 0;
+            off64_t tmp = mCurrentMoofOffset;
+            status_t err = parseChunk(&tmp);
+            if (err != OK) {
+                return AMEDIA_ERROR_UNKNOWN;
+            }
+            // tfra has the presentation time of the fragment's first sample.
+            uint64_t decodeTime = entry.mTime;
+            if (!mCurrentSamples.empty() && mCurrentSamples[0].compositionOffset > 0) {
+                decodeTime -= std::min(decodeTime,
+                        (uint64_t)mCurrentSamples[0].compositionOffset);
+            }
+            mCurrentTime = decodeTime;
         } else {
-            // without sidx boxes, we can only seek to 0
+            // without sidx boxes or mfra, we can only seek to 0
             mCurrentMoofOffset = mFirstMoofOffset;
             mNextMoofOffset = -1;
             mCurrentSamples.clear();
@@ -43,6 +43,15 @@ using heif::ItemTable;
 struct SidxEntry {
     size_t mSize;
     uint32_t mDurationUs;
+    // sums of the sizes and durations of the preceding entries, for binary search
+    off64_t mStartOffset;
+    int64_t mStartTimeUs;
+};
+
+// A fragment from the tfra box of a track, whose first sample is a sync sample.
+struct FragmentIndexEntry {
+    uint64_t mTime;         // in media timescale ticks
+    off64_t mMoofOffset;
 };
 
 struct Trex {
@@ -95,6 +104,9 @@ private:
         uint8_t *mTx3gBuffer;
         size_t mTx3gSize, mTx3gFilled;
 
+        // from mfra, for seeking fragmented files without sidx
+        Vector<FragmentIndexEntry> fragmentIndex;
+
 
         Track() {
             next = NULL;
@@ -134,6 +146,7 @@ private:
     Vector<Trex> mTrex;
 
     DataSourceHelper *mDataSource;
+    DataSourceHelper *mSampleDataSource;    // shared by the tracks, created on demand
     status_t mInitCheck;
     uint32_t mHeaderTimescale;
     bool mIsQT;
@@ -171,6 +184,8 @@ private:
     status_t parseTrackHeader(off64_t data_offset, off64_t data_size);
 
     status_t parseSegmentIndex(off64_t data_offset, size_t data_size);
+    status_t parseMovieFragmentRandomAccess();
+    status_t parseTrackFragmentRandomAccess(off64_t data_offset, size_t data_size);
 
     Track *findTrackByMimePrefix(const char *mimePrefix);
 
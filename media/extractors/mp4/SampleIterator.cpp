@@ -307,6 +307,12 @@ status_t SampleIterator::getSampleSizeDirect(
     return OK;
 }
 
+status_t SampleIterator::getSampleTimeDirect(
+        uint32_t sampleIndex, uint64_t *time) {
+    uint64_t duration;
+    return findSampleTimeAndDuration(sampleIndex, time, &duration);
+}
+
 status_t SampleIterator::findSampleTimeAndDuration(
         uint32_t sampleIndex, uint64_t *time, uint64_t *duration) {
     if (sampleIndex >= mTable->mNumSampleSizes) {
@@ -44,6 +44,11 @@ struct SampleIterator {
     status_t getSampleSizeDirect(
             uint32_t sampleIndex, size_t *size);
 
+    // Composition time from stts and ctts only. The time to sample state only moves
+    // forward, so call it in increasing sample order.
+    status_t getSampleTimeDirect(
+            uint32_t sampleIndex, uint64_t *time);
+
 private:
     SampleTable *mTable;
 
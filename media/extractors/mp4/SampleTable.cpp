@@ -129,6 +129,9 @@ SampleTable::SampleTable(DataSourceHelper *source)
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
       mSampleTimeEntries(NULL),
+      mTimeToSampleRuns(NULL),
+      mNumTimeToSampleRuns(0),
+      mCompositionOffset(0),
       mCompositionTimeDeltaEntries(NULL),
       mNumCompositionTimeDeltaEntries(0),
       mCompositionDeltaLookup(new CompositionDeltaLookup),
@@ -136,6 +139,7 @@ SampleTable::SampleTable(DataSourceHelper *source)
       mNumSyncSamples(0),
       mSyncSamples(NULL),
       mLastSyncSampleIndex(0),
+      mSyncSampleTimes(NULL),
       mSampleToChunkEntries(NULL),
       mTotalSize(0) {
     mSampleIterator = new SampleIterator(this);
@@ -148,6 +152,9 @@ SampleTable::~SampleTable() {
     delete[] mSyncSamples;
     mSyncSamples = NULL;
 
+    delete[] mSyncSampleTimes;
+    mSyncSampleTimes = NULL;
+
     delete[] mTimeToSample;
     mTimeToSample = NULL;
 
@@ -160,6 +167,9 @@ SampleTable::~SampleTable() {
     delete[] mSampleTimeEntries;
     mSampleTimeEntries = NULL;
 
+    delete[] mTimeToSampleRuns;
+    mTimeToSampleRuns = NULL;
+
     delete mSampleIterator;
     mSampleIterator = NULL;
 }
@@ -632,16 +642,125 @@ int SampleTable::CompareIncreasingTime(const void *_a, const void *_b) {
     return 0;
 }
 
+uint64_t SampleTable::getSampleTime(
+        size_t position, uint64_t scale_num, uint64_t scale_den) const {
+    if (position >= (size_t)mNumSampleSizes || scale_den == 0) {
+        return 0;
+    }
+
+    if (mSampleTimeEntries != NULL) {
+        return (mSampleTimeEntries[position].mCompositionTime * scale_num) / scale_den;
+    }
+
+    if (mTimeToSampleRuns == NULL) {
+        return 0;
+    }
+
+    // last run starting at or before the sample
+    uint32_t left = 0;
+    uint32_t right = mNumTimeToSampleRuns - 1;
+    while (left < right) {
+        uint32_t center = left + (right - left + 1) / 2;
+        if (mTimeToSampleRuns[center].mFirstSample <= position) {
+            left = center;
+        } else {
+            right = center - 1;
+        }
+    }
+
+    // saturate like buildSampleEntriesTable() does
+    const TimeToSampleRun &run = mTimeToSampleRuns[left];
+    uint64_t n = position - run.mFirstSample;
+    uint64_t time = UINT64_MAX;
+    if (run.mDelta == 0 || n <= (UINT64_MAX - run.mFirstTime) / run.mDelta) {
+        time = run.mFirstTime + n * run.mDelta;
+    }
+    time = time > UINT64_MAX - mCompositionOffset ? UINT64_MAX : time + mCompositionOffset;
+
+    return (time * scale_num) / scale_den;
+}
+
+bool SampleTable::buildTimeToSampleRuns_l() {
+    // composition order is decode order if all samples have the same, non-negative,
+    // composition offset. samples past the end of ctts have an offset of 0.
+    bool haveOffset = false;
+    int32_t offset = 0;
+    uint64_t numCovered = 0;
+    for (size_t i = 0; i < mNumCompositionTimeDeltaEntries; ++i) {
+        uint32_t n = mCompositionTimeDeltaEntries[2 * i];
+        if (n == 0) {
+            continue;
+        }
+        if (haveOffset && mCompositionTimeDeltaEntries[2 * i + 1] != offset) {
+            return false;
+        }
+        offset = mCompositionTimeDeltaEntries[2 * i + 1];
+        haveOffset = true;
+        numCovered += n;
+    }
+    if (offset < 0 || (offset > 0 && numCovered < mNumSampleSizes)) {
+        return false;
+    }
+
+    uint64_t allocSize = (uint64_t)mTimeToSampleCount * sizeof(TimeToSampleRun);
+    if (mTotalSize + allocSize > kMaxTotalSize) {
+        return false;
+    }
+    mTimeToSampleRuns = new (std::nothrow) TimeToSampleRun[mTimeToSampleCount];
+    if (mTimeToSampleRuns == NULL) {
+        return false;
+    }
+    mTotalSize += allocSize;
+
+    uint64_t firstSample = 0;
+    uint64_t time = 0;
+    for (uint32_t i = 0; i < mTimeToSampleCount && firstSample < mNumSampleSizes; ++i) {
+        uint32_t n = mTimeToSample[2 * i];
+        uint32_t delta = mTimeToSample[2 * i + 1];
+        if (n == 0) {
+            continue;
+        }
+
+        TimeToSampleRun &run = mTimeToSampleRuns[mNumTimeToSampleRuns++];
+        run.mFirstSample = firstSample;
+        run.mDelta = delta;
+        run.mFirstTime = time;
+
+        firstSample += n;
+        if (delta != 0 && n > (UINT64_MAX - time) / delta) {
+            time = UINT64_MAX;
+        } else {
+            time += (uint64_t)n * delta;
+        }
+    }
+
+    if (mNumTimeToSampleRuns == 0) {
+        delete[] mTimeToSampleRuns;
+        mTimeToSampleRuns = NULL;
+        mTotalSize -= allocSize;
+        return false;
+    }
+
+    mCompositionOffset = offset;
+    return true;
+}
+
 void SampleTable::buildSampleEntriesTable() {
     Mutex::Autolock autoLock(mLock);
 
-    if (mSampleTimeEntries != NULL || mNumSampleSizes == 0) {
+    if (mSampleTimeEntries != NULL || mTimeToSampleRuns != NULL || mNumSampleSizes == 0) {
         if (mNumSampleSizes == 0) {
             ALOGE("b/23247055, mNumSampleSizes(%u)", mNumSampleSizes);
         }
         return;
     }
 
+    if (buildTimeToSampleRuns_l()) {
+        ALOGV("composition order is decode order, %u time to sample runs",
+                mNumTimeToSampleRuns);
+        return;
+    }
+
     mTotalSize += (uint64_t)mNumSampleSizes * sizeof(SampleTimeEntry);
     if (mTotalSize > kMaxTotalSize) {
         ALOGE("Sample entry table size would make sample table too large.\n"
@@ -720,7 +839,7 @@ status_t SampleTable::findSampleAtTime(
         uint32_t *sample_index, uint32_t flags) {
     buildSampleEntriesTable();
 
-    if (mSampleTimeEntries == NULL) {
+    if (mSampleTimeEntries == NULL && mTimeToSampleRuns == NULL) {
         return ERROR_OUT_OF_RANGE;
     }
 
@@ -728,7 +847,7 @@ status_t SampleTable::findSampleAtTime(
         if (req_time >= mNumSampleSizes) {
             return ERROR_OUT_OF_RANGE;
         }
-        *sample_index = mSampleTimeEntries[req_time].mSampleIndex;
+        *sample_index = getSampleIndexAt(req_time);
         return OK;
     }
 
@@ -744,7 +863,7 @@ status_t SampleTable::findSampleAtTime(
         } else if (req_time > centerTime) {
             left = center + 1;
         } else {
-            *sample_index = mSampleTimeEntries[center].mSampleIndex;
+            *sample_index = getSampleIndexAt(center);
             return OK;
         }
     }
@@ -793,7 +912,7 @@ status_t SampleTable::findSampleAtTime(
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    *sample_index = getSampleIndexAt(closestIndex);
     return OK;
 }
 
@@ -897,6 +1016,131 @@ status_t SampleTable::findSyncSampleNear(
     return OK;
 }
 
+// static
+int SampleTable::CompareIncreasingSyncSampleTime(const void *_a, const void *_b) {
+    const SyncSampleTimeEntry *a = (const SyncSampleTimeEntry *)_a;
+    const SyncSampleTimeEntry *b = (const SyncSampleTimeEntry *)_b;
+
+    if (a->mCompositionTime < b->mCompositionTime) {
+        return -1;
+    } else if (a->mCompositionTime > b->mCompositionTime) {
+        return 1;
+    }
+
+    return 0;
+}
+
+status_t SampleTable::buildSyncSampleTimes_l() {
+    if (mSyncSampleTimes != NULL) {
+        return OK;
+    }
+
+    uint64_t allocSize = (uint64_t)mNumSyncSamples * sizeof(SyncSampleTimeEntry);
+    if (mTotalSize + allocSize > kMaxTotalSize) {
+        ALOGE("Sync sample time table would make sample table too large.");
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    SyncSampleTimeEntry *entries = new (std::nothrow) SyncSampleTimeEntry[mNumSyncSamples];
+    if (entries == NULL) {
+        return NO_MEMORY;
+    }
+
+    // mSyncSamples is in increasing order, so a separate iterator can walk stts and
+    // ctts once, without reading sample sizes and chunk offsets like seekTo() does.
+    SampleIterator iterator(this);
+    for (uint32_t i = 0; i < mNumSyncSamples; ++i) {
+        entries[i].mSampleIndex = mSyncSamples[i];
+        status_t err = iterator.getSampleTimeDirect(
+                mSyncSamples[i], &entries[i].mCompositionTime);
+        if (err != OK) {
+            delete[] entries;
+            return err;
+        }
+    }
+
+    // composition order of sync samples can differ from decode order.
+    qsort(entries, mNumSyncSamples, sizeof(SyncSampleTimeEntry),
+          CompareIncreasingSyncSampleTime);
+
+    mSyncSampleTimes = entries;
+    mTotalSize += allocSize;
+    return OK;
+}
+
+status_t SampleTable::findSyncSamplesNearTime(
+        uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+        size_t count, Vector<uint32_t> *sample_indices) {
+    sample_indices->clear();
+
+    if (scale_den == 0) {
+        return BAD_VALUE;
+    }
+
+    const bool allSync = mSyncSampleOffset < 0;
+    if (allSync) {
+        // every sample is a sync sample, so use the composition order of all samples.
+        buildSampleEntriesTable();
+        if (mSampleTimeEntries == NULL && mTimeToSampleRuns == NULL) {
+            return ERROR_OUT_OF_RANGE;
+        }
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    size_t numEntries;
+    if (allSync) {
+        numEntries = mNumSampleSizes;
+    } else {
+        status_t err = buildSyncSampleTimes_l();
+        if (err != OK) {
+            return err;
+        }
+        numEntries = mNumSyncSamples;
+    }
+
+    auto timeAt = [&](size_t i) -> uint64_t {
+        if (allSync) {
+            return getSampleTime(i, scale_num, scale_den);
+        }
+        return (mSyncSampleTimes[i].mCompositionTime * scale_num) / scale_den;
+    };
+
+    // first entry at or after req_time
+    size_t left = 0;
+    size_t right_plus_one = numEntries;
+    while (left < right_plus_one) {
+        size_t center = left + (right_plus_one - left) / 2;
+        if (timeAt(center) < req_time) {
+            left = center + 1;
+        } else {
+            right_plus_one = center;
+        }
+    }
+
+    // grow [first, last) towards the closer neighbor. entries before |left| are earlier
+    // than req_time, the others are not.
+    size_t first = left;
+    size_t last = left;
+    while (last - first < count && (first > 0 || last < numEntries)) {
+        if (first == 0) {
+            ++last;
+        } else if (last == numEntries) {
+            --first;
+        } else if (timeAt(last) - req_time < req_time - timeAt(first - 1)) {
+            ++last;
+        } else {
+            --first;
+        }
+    }
+
+    for (size_t i = first; i < last; ++i) {
+        sample_indices->push_back(
+                allSync ? getSampleIndexAt(i) : mSyncSampleTimes[i].mSampleIndex);
+    }
+    return OK;
+}
+
 status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
     Mutex::Autolock autoLock(mLock);
 
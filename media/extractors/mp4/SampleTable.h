@@ -25,6 +25,7 @@
 #include <media/stagefright/MediaErrors.h>
 #include <utils/RefBase.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -89,6 +90,12 @@ public:
 
     status_t findThumbnailSample(uint32_t *sample_index);
 
+    // Returns up to |count| sync samples with composition times nearest to |req_time|,
+    // in increasing time order, e.g. for scrubbing thumbnails.
+    status_t findSyncSamplesNearTime(
+            uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+            size_t count, Vector<uint32_t> *sample_indices);
+
     void setPredictSampleSize(uint32_t sampleSize) {
         mDefaultSampleSize = sampleSize;
     }
@@ -132,6 +139,18 @@ private:
     };
     SampleTimeEntry *mSampleTimeEntries;
 
+    // When composition order is decode order, i.e. there is no ctts or it has a single
+    // non-negative offset, composition times are computed from the stts runs instead
+    // of sorting a table of all samples.
+    struct TimeToSampleRun {
+        uint32_t mFirstSample;
+        uint32_t mDelta;
+        uint64_t mFirstTime;
+    };
+    TimeToSampleRun *mTimeToSampleRuns;
+    uint32_t mNumTimeToSampleRuns;
+    uint32_t mCompositionOffset;
+
     int32_t *mCompositionTimeDeltaEntries;
     size_t mNumCompositionTimeDeltaEntries;
     CompositionDeltaLookup *mCompositionDeltaLookup;
@@ -141,6 +160,13 @@ private:
     uint32_t *mSyncSamples;
     size_t mLastSyncSampleIndex;
 
+    // sync samples sorted by composition time, built on the first time based query.
+    struct SyncSampleTimeEntry {
+        uint64_t mCompositionTime;
+        uint32_t mSampleIndex;
+    };
+    SyncSampleTimeEntry *mSyncSampleTimes;
+
     SampleIterator *mSampleIterator;
 
     struct SampleToChunkEntry {
@@ -155,20 +181,23 @@ private:
 
     friend struct SampleIterator;
 
-    // normally we don't round
-    inline uint64_t getSampleTime(
-            size_t sample_index, uint64_t scale_num, uint64_t scale_den) const {
-        return (sample_index < (size_t)mNumSampleSizes && mSampleTimeEntries != NULL
-                && scale_den != 0)
-                ? (mSampleTimeEntries[sample_index].mCompositionTime * scale_num) / scale_den : 0;
+    // |position| is in composition order. normally we don't round
+    uint64_t getSampleTime(
+            size_t position, uint64_t scale_num, uint64_t scale_den) const;
+
+    inline uint32_t getSampleIndexAt(size_t position) const {
+        return mSampleTimeEntries != NULL ? mSampleTimeEntries[position].mSampleIndex : position;
     }
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
     static int CompareIncreasingTime(const void *, const void *);
+    static int CompareIncreasingSyncSampleTime(const void *, const void *);
 
     void buildSampleEntriesTable();
+    bool buildTimeToSampleRuns_l();
+    status_t buildSyncSampleTimes_l();
 
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
@@ -132,33 +132,24 @@ template<typename T>
 inline status_t EndianOutput::writeHelper(const T* buf, size_t offset, size_t count) {
     assert(offset <= count);
     status_t res = OK;
+    // Convert into a small buffer and write it in one call, rather than calling the
+    // output once per element.
+    const size_t kChunkCount = 256;
+    T tmp[kChunkCount];
     size_t size = sizeof(T);
-    switch(mEndian) {
-        case BIG: {
-            for (size_t i = offset; i < count; ++i) {
-                T tmp = convertToBigEndian<T>(buf[offset + i]);
-                if ((res = mOutput->write(reinterpret_cast<uint8_t*>(&tmp), 0, size))
-                        != OK) {
-                    return res;
-                }
-                mOffset += size;
-            }
-            break;
-        }
-        case LITTLE: {
-            for (size_t i = offset; i < count; ++i) {
-                T tmp = convertToLittleEndian<T>(buf[offset + i]);
-                if ((res = mOutput->write(reinterpret_cast<uint8_t*>(&tmp), 0, size))
-                        != OK) {
-                    return res;
-                }
-                mOffset += size;
-            }
-            break;
+    if (mEndian != BIG && mEndian != LITTLE) {
+        return BAD_VALUE;
+    }
+    for (size_t i = offset; i < count; i += kChunkCount) {
+        size_t chunk = (count - i < kChunkCount) ? count - i : kChunkCount;
+        for (size_t j = 0; j < chunk; ++j) {
+            tmp[j] = (mEndian == BIG) ? convertToBigEndian<T>(buf[offset + i + j]) :
+                    convertToLittleEndian<T>(buf[offset + i + j]);
         }
-        default: {
-            return BAD_VALUE;
+        if ((res = mOutput->write(reinterpret_cast<uint8_t*>(tmp), 0, chunk * size)) != OK) {
+            return res;
         }
+        mOffset += chunk * size;
     }
     return res;
 }
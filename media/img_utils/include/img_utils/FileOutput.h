@@ -35,6 +35,7 @@ class ANDROID_API FileOutput : public Output {
         virtual status_t write(const uint8_t* buf, size_t offset, size_t count);
         virtual status_t close();
     private:
+        static const size_t kBufferSize = 1 << 20; // in bytes
         FILE *mFp;
         String8 mPath;
         bool mOpen;
@@ -40,6 +40,10 @@ status_t FileOutput::open() {
         ALOGE("%s: Could not open file %s", __FUNCTION__, mPath.string());
         return BAD_VALUE;
     }
+    // Large strips are written in many small pieces; batch them into fewer write calls.
+    if (::setvbuf(mFp, NULL, _IOFBF, kBufferSize) != 0) {
+        ALOGW("%s: Could not set buffer size for file %s", __FUNCTION__, mPath.string());
+    }
     mOpen = true;
     return OK;
 }
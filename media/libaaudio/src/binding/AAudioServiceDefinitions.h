@@ -62,6 +62,7 @@ enum RingbufferFlags : uint32_t {
     COHERENCY_DMA = 0x0004,
     COHERENCY_ACQUIRE_RELEASE = 0x0008,
     COHERENCY_AUTO = 0x0010,
+    COUNTERS_PADDED = 0x0020, // read and write counters are in separate cache lines
 };
 
 // This is not passed through Binder.
@@ -76,6 +76,14 @@ void RingBufferParcelable::setCapacityInFrames(int32_t capacityInFrames) {
     mCapacityInFrames = capacityInFrames;
 }
 
+RingbufferFlags RingBufferParcelable::getFlags() {
+    return mFlags;
+}
+
+void RingBufferParcelable::setFlags(RingbufferFlags flags) {
+    mFlags = flags;
+}
+
 /**
  * The read and write must be symmetric.
  */
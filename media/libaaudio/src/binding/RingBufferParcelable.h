@@ -55,6 +55,10 @@ public:
 
     void setCapacityInFrames(int32_t capacityInFrames);
 
+    RingbufferFlags getFlags();
+
+    void setFlags(RingbufferFlags flags);
+
     bool isFileDescriptorSafe(SharedMemoryParcelable *memoryParcels);
 
     /**
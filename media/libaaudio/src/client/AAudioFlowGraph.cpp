@@ -20,6 +20,9 @@
 
 #include "AAudioFlowGraph.h"
 
+#include <algorithm>
+
+#include <audio_utils/primitives.h>
 #include <flowgraph/ClipToRange.h>
 #include <flowgraph/MonoToMultiConverter.h>
 #include <flowgraph/RampLinear.h>
@@ -30,8 +33,185 @@
 #include <flowgraph/SourceI16.h>
 #include <flowgraph/SourceI24.h>
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#ifndef USE_NEON
+#define USE_NEON (false)
+#endif
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__)
+#ifndef USE_SSE
+#define USE_SSE (true)
+#endif
+#include <emmintrin.h>
+#else
+#ifndef USE_SSE
+#define USE_SSE (false)
+#endif
+#endif
+
 using namespace flowgraph;
 
+// The fused path does in one pass what SourceXxx, RampLinear, ClipToRange,
+// MonoToMultiConverter and SinkXxx do in five, with the same arithmetic in the same order,
+// so the output is identical for any input that is not a NaN.
+namespace {
+
+inline float toFloat(int16_t sample) { return float_from_i16(sample); }
+inline float toFloat(float sample) { return sample; }
+
+inline void fromFloat(float sample, float *out) { *out = sample; }
+inline void fromFloat(float sample, int16_t *out) { *out = clamp16_from_float(sample); }
+
+template <typename TI, typename TO, bool EXPAND, bool CLIP>
+inline void processFrame(const TI *&in, TO *&out, int32_t channelCount, float level) {
+    for (int32_t ch = 0; ch < channelCount; ch++) {
+        float sample = toFloat(*in++) * level;
+        if (CLIP) {
+            sample = std::min(kDefaultMaxHeadroom, std::max(kDefaultMinHeadroom, sample));
+        }
+        fromFloat(sample, out++);
+        if (EXPAND) {
+            fromFloat(sample, out++);
+        }
+    }
+}
+
+#if USE_NEON || USE_SSE
+// Same offset trick as clamp16_from_float(), see audio_utils/primitives.h.
+constexpr float   kI16FromFloatOffset = 384.f;
+constexpr int32_t kI16FromFloatZero = 0x43c00000;  // kI16FromFloatOffset as int32_t
+constexpr int32_t kI16FromFloatLimNeg = kI16FromFloatZero - 32768;
+constexpr int32_t kI16FromFloatLimPos = kI16FromFloatZero + 32767;
+#endif
+
+#if USE_NEON
+inline float32x4_t load4(const int16_t *in) {
+    return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(in))), 1.0f / (1 << 15));
+}
+inline float32x4_t load4(const float *in) { return vld1q_f32(in); }
+
+template <bool EXPAND>
+inline void store4(float32x4_t samples, float *out) {
+    if (EXPAND) {
+        vst2q_f32(out, (float32x4x2_t){{ samples, samples }});
+    } else {
+        vst1q_f32(out, samples);
+    }
+}
+template <bool EXPAND>
+inline void store4(float32x4_t samples, int16_t *out) {
+    int32x4_t bits = vreinterpretq_s32_f32(vaddq_f32(samples, vdupq_n_f32(kI16FromFloatOffset)));
+    bits = vminq_s32(vmaxq_s32(bits, vdupq_n_s32(kI16FromFloatLimNeg)),
+            vdupq_n_s32(kI16FromFloatLimPos));
+    int16x4_t shorts = vmovn_s32(bits); // the lower 16 bits are the result
+    if (EXPAND) {
+        vst2_s16(out, (int16x4x2_t){{ shorts, shorts }});
+    } else {
+        vst1_s16(out, shorts);
+    }
+}
+#elif USE_SSE
+inline __m128 load4(const int16_t *in) {
+    __m128i shorts = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in));
+    __m128i ints = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+    return _mm_mul_ps(_mm_cvtepi32_ps(ints), _mm_set1_ps(1.0f / (1 << 15)));
+}
+inline __m128 load4(const float *in) { return _mm_loadu_ps(in); }
+
+template <bool EXPAND>
+inline void store4(__m128 samples, float *out) {
+    if (EXPAND) {
+        _mm_storeu_ps(out, _mm_unpacklo_ps(samples, samples));
+        _mm_storeu_ps(out + 4, _mm_unpackhi_ps(samples, samples));
+    } else {
+        _mm_storeu_ps(out, samples);
+    }
+}
+template <bool EXPAND>
+inline void store4(__m128 samples, int16_t *out) {
+    __m128i bits = _mm_castps_si128(_mm_add_ps(samples, _mm_set1_ps(kI16FromFloatOffset)));
+    const __m128i limNeg = _mm_set1_epi32(kI16FromFloatLimNeg);
+    const __m128i limPos = _mm_set1_epi32(kI16FromFloatLimPos);
+    __m128i lt = _mm_cmplt_epi32(bits, limNeg);
+    bits = _mm_or_si128(_mm_and_si128(lt, limNeg), _mm_andnot_si128(lt, bits));
+    __m128i gt = _mm_cmpgt_epi32(bits, limPos);
+    bits = _mm_or_si128(_mm_and_si128(gt, limPos), _mm_andnot_si128(gt, bits));
+    bits = _mm_sub_epi32(bits, _mm_set1_epi32(kI16FromFloatZero)); // within int16_t range
+    __m128i shorts = _mm_packs_epi32(bits, bits);
+    if (EXPAND) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(shorts, shorts));
+    } else {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out), shorts);
+    }
+}
+#endif
+
+template <typename TI, typename TO, bool EXPAND, bool CLIP>
+void processFused(const void *source, void *destination, int32_t numFrames,
+                  int32_t channelCount, RampLinear *ramp) {
+    const TI *in = static_cast<const TI *>(source);
+    TO *out = static_cast<TO *>(destination);
+
+    // Ramping does not happen very often, so do it one frame at a time.
+    int32_t framesToRamp = std::min(numFrames, ramp->updateRamp());
+    for (int32_t i = 0; i < framesToRamp; i++) {
+        processFrame<TI, TO, EXPAND, CLIP>(in, out, channelCount, ramp->nextRampLevel());
+    }
+
+    const float level = ramp->getLevel();
+    int32_t samplesLeft = (numFrames - framesToRamp) * channelCount;
+#if USE_NEON
+    const float32x4_t levels = vdupq_n_f32(level);
+    for (; samplesLeft >= 4; samplesLeft -= 4) {
+        float32x4_t samples = vmulq_f32(load4(in), levels);
+        if (CLIP) {
+            samples = vminq_f32(vmaxq_f32(samples, vdupq_n_f32(kDefaultMinHeadroom)),
+                    vdupq_n_f32(kDefaultMaxHeadroom));
+        }
+        store4<EXPAND>(samples, out);
+        in += 4;
+        out += EXPAND ? 8 : 4;
+    }
+#elif USE_SSE
+    const __m128 levels = _mm_set1_ps(level);
+    for (; samplesLeft >= 4; samplesLeft -= 4) {
+        __m128 samples = _mm_mul_ps(load4(in), levels);
+        if (CLIP) {
+            samples = _mm_min_ps(_mm_max_ps(samples, _mm_set1_ps(kDefaultMinHeadroom)),
+                    _mm_set1_ps(kDefaultMaxHeadroom));
+        }
+        store4<EXPAND>(samples, out);
+        in += 4;
+        out += EXPAND ? 8 : 4;
+    }
+#endif
+    // The remaining samples are processed as mono frames, which gives the same result.
+    for (; samplesLeft > 0; samplesLeft--) {
+        processFrame<TI, TO, EXPAND, CLIP>(in, out, 1 /* channelCount */, level);
+    }
+}
+
+template <typename TI, typename TO, bool CLIP>
+AAudioFlowGraph::fused_process_t selectFused(int32_t sourceChannelCount,
+                                             int32_t sinkChannelCount) {
+    if (sourceChannelCount == sinkChannelCount) {
+        return processFused<TI, TO, false, CLIP>;
+    } else if (sourceChannelCount == 1 && sinkChannelCount == 2) {
+        return processFused<TI, TO, true, CLIP>;
+    }
+    return nullptr;
+}
+
+} // namespace
+
 aaudio_result_t AAudioFlowGraph::configure(audio_format_t sourceFormat,
                           int32_t sourceChannelCount,
                           audio_format_t sinkFormat,
@@ -96,10 +276,36 @@ aaudio_result_t AAudioFlowGraph::configure(audio_format_t sourceFormat,
     }
     lastOutput->connect(&mSink->input);
 
+    // The common mono and stereo cases skip the graph, which is still used for the others.
+    mFusedChannelCount = sourceChannelCount;
+    if (sourceChannelCount <= 2) {
+        if (sourceFormat == AUDIO_FORMAT_PCM_16_BIT && sinkFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            mFusedProcess = selectFused<int16_t, float, false>(
+                    sourceChannelCount, sinkChannelCount);
+        } else if (sourceFormat == AUDIO_FORMAT_PCM_16_BIT
+                && sinkFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            mFusedProcess = selectFused<int16_t, int16_t, false>(
+                    sourceChannelCount, sinkChannelCount);
+        } else if (sourceFormat == AUDIO_FORMAT_PCM_FLOAT
+                && sinkFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            mFusedProcess = selectFused<float, float, true>(
+                    sourceChannelCount, sinkChannelCount);
+        } else if (sourceFormat == AUDIO_FORMAT_PCM_FLOAT
+                && sinkFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            mFusedProcess = selectFused<float, int16_t, false>(
+                    sourceChannelCount, sinkChannelCount);
+        }
+    }
+    ALOGV("%s() fused = %d", __func__, isFused());
+
     return AAUDIO_OK;
 }
 
 void AAudioFlowGraph::process(const void *source, void *destination, int32_t numFrames) {
+    if (mFusedProcess != nullptr) {
+        mFusedProcess(source, destination, numFrames, mFusedChannelCount, mVolumeRamp.get());
+        return;
+    }
     mSource->setData(source, numFrames);
     mSink->read(destination, numFrames);
 }
@@ -52,12 +52,25 @@ public:
 
     void setRampLengthInFrames(int32_t numFrames);
 
+    /**
+     * @return true if process() uses a single fused pass instead of the graph
+     */
+    bool isFused() const {
+        return mFusedProcess != nullptr;
+    }
+
+    typedef void (*fused_process_t)(const void *source, void *destination, int32_t numFrames,
+                                    int32_t channelCount, flowgraph::RampLinear *ramp);
+
 private:
     std::unique_ptr<flowgraph::AudioSource>          mSource;
     std::unique_ptr<flowgraph::RampLinear>           mVolumeRamp;
     std::unique_ptr<flowgraph::ClipToRange>          mClipper;
     std::unique_ptr<flowgraph::MonoToMultiConverter> mChannelConverter;
     std::unique_ptr<flowgraph::AudioSink>            mSink;
+
+    fused_process_t                                  mFusedProcess = nullptr;
+    int32_t                                          mFusedChannelCount = 0;
 };
 
 
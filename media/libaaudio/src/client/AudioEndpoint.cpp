@@ -79,6 +79,18 @@ static aaudio_result_t AudioEndpoint_validateQueueDescriptor(const char *type,
           descriptor->readCounterAddress,
           descriptor->writeCounterAddress);
 
+    // The service promised a layout without false sharing between the two counters.
+    if ((descriptor->flags & RingbufferFlags::COUNTERS_PADDED) != 0
+            && descriptor->readCounterAddress != nullptr
+            && descriptor->writeCounterAddress != nullptr) {
+        uintptr_t readCounter = (uintptr_t) descriptor->readCounterAddress;
+        uintptr_t writeCounter = (uintptr_t) descriptor->writeCounterAddress;
+        if (readCounter / kFifoCacheLineSize == writeCounter / kFifoCacheLineSize) {
+            ALOGE("AudioEndpoint_validateQueueDescriptor() padded counters share a cache line");
+            return AAUDIO_ERROR_INTERNAL;
+        }
+    }
+
     // Try to READ from the data area.
     // This code will crash if the mmap failed.
     uint8_t value = descriptor->dataAddress[0];
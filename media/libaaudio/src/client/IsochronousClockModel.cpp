@@ -18,6 +18,8 @@
 //#define LOG_NDEBUG 0
 #include <log/log.h>
 
+#include <algorithm>
+#include <cmath>
 #include <stdint.h>
 
 #include "utility/AudioClock.h"
@@ -25,8 +27,31 @@
 
 #define MIN_LATENESS_NANOS (10 * AAUDIO_NANOS_PER_MICROSECOND)
 
+#define MILLIHERTZ_PER_HERTZ    1000
+// Each interval contributes its earliest timestamp to the drift history.
+#define DRIFT_INTERVAL_NANOS    (250 * AAUDIO_NANOS_PER_MILLISECOND)
+// Do not trust a fit over less than about a second.
+#define DRIFT_MIN_POINTS        4
+// Real clocks are much closer than this, so anything beyond is a bad fit.
+#define DRIFT_MAX_PPM           5000.0
+
 using namespace aaudio;
 
+// Calculate (a * b) / c, rounding towards zero, or up when roundUp is set and the
+// result is positive. Falls back to floating point if a * b would overflow.
+static int64_t multiplyDivide(int64_t a, int64_t b, int64_t c, bool roundUp = false) {
+    int64_t product;
+    if (__builtin_mul_overflow(a, b, &product)) {
+        long double quotient = (long double) a * b / c;
+        return (int64_t) (roundUp ? ceill(quotient) : truncl(quotient));
+    }
+    int64_t quotient = product / c;
+    if (roundUp && (product % c) > 0) {
+        quotient++;
+    }
+    return quotient;
+}
+
 IsochronousClockModel::IsochronousClockModel()
         : mMarkerFramePosition(0)
         , mMarkerNanoTime(0)
@@ -34,7 +59,9 @@ IsochronousClockModel::IsochronousClockModel()
         , mFramesPerBurst(64)
         , mMaxLatenessInNanos(0)
         , mState(STATE_STOPPED)
+        , mRateMilliHertz(48000 * MILLIHERTZ_PER_HERTZ)
 {
+    resetDrift();
 }
 
 IsochronousClockModel::~IsochronousClockModel() {
@@ -51,6 +78,8 @@ void IsochronousClockModel::start(int64_t nanoTime) {
     ALOGV("start(nanos = %lld)\n", (long long) nanoTime);
     mMarkerNanoTime = nanoTime;
     mState = STATE_STARTING;
+    // Keep the rate, the DSP clock has not changed, but collect a new history.
+    resetDrift();
 }
 
 void IsochronousClockModel::stop(int64_t nanoTime) {
@@ -82,7 +111,14 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
 //         (long long)mMarkerFramePosition,
 //         (long long)mMarkerNanoTime);
 
-    int64_t expectedNanosDelta = convertDeltaPositionToTime(framesDelta);
+    if (mState == STATE_RUNNING) {
+        // This may update the rate, so calculate the expected time afterwards.
+        trackDrift(framePosition, nanoTime,
+                   nanosDelta - convertDeltaPositionToTimeRoundUp(framesDelta));
+    }
+
+    // Round up so that a timestamp that is not early predicts its own position exactly.
+    int64_t expectedNanosDelta = convertDeltaPositionToTimeRoundUp(framesDelta);
 //    ALOGD("processTimestamp() - expectedNanosDelta = %lld, nanosDelta = %llu",
 //         (long long)expectedNanosDelta,
 //         (long long)nanosDelta);
@@ -113,12 +149,13 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
 //            ALOGD("processTimestamp() - STATE_RUNNING - %d < %d micros - EARLY",
 //                 (int) (nanosDelta / 1000), (int)(expectedNanosDelta / 1000));
             setPositionAndTime(framePosition, nanoTime);
-        } else if (nanosDelta > (expectedNanosDelta + mMaxLatenessInNanos)) {
+        } else if (nanosDelta >= (expectedNanosDelta + mMaxLatenessInNanos)) {
             // Later than expected timestamp.
 //            ALOGD("processTimestamp() - STATE_RUNNING - %d > %d + %d micros - LATE",
 //                 (int) (nanosDelta / 1000), (int)(expectedNanosDelta / 1000),
 //                 (int) (mMaxLatenessInNanos / 1000));
-            setPositionAndTime(framePosition - mFramesPerBurst,  nanoTime - mMaxLatenessInNanos);
+            setPositionAndTime(framePosition - mFramesPerBurst,
+                               nanoTime - convertDeltaPositionToTimeRoundUp(mFramesPerBurst));
         }
         break;
     default:
@@ -130,6 +167,8 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
 
 void IsochronousClockModel::setSampleRate(int32_t sampleRate) {
     mSampleRate = sampleRate;
+    mRateMilliHertz = (int64_t) sampleRate * MILLIHERTZ_PER_HERTZ;
+    resetDrift();
     update();
 }
 
@@ -139,16 +178,87 @@ void IsochronousClockModel::setFramesPerBurst(int32_t framesPerBurst) {
 }
 
 void IsochronousClockModel::update() {
-    int64_t nanosLate = convertDeltaPositionToTime(mFramesPerBurst); // uses mSampleRate
+    int64_t nanosLate = convertDeltaPositionToTime(mFramesPerBurst); // uses mRateMilliHertz
     mMaxLatenessInNanos = (nanosLate > MIN_LATENESS_NANOS) ? nanosLate : MIN_LATENESS_NANOS;
 }
 
+void IsochronousClockModel::resetDrift() {
+    mHasDriftCandidate = false;
+    mDriftCandidateLateness = 0;
+    mDriftIntervalStartNanos = -1;
+    mDriftHistoryCount = 0;
+}
+
+void IsochronousClockModel::trackDrift(int64_t framePosition, int64_t nanoTime,
+                                       int64_t lateness) {
+    // The earliest timestamps are the ones least delayed by scheduling.
+    if (!mHasDriftCandidate || lateness < mDriftCandidateLateness) {
+        mDriftCandidate = { framePosition, nanoTime };
+        mDriftCandidateLateness = lateness;
+        mHasDriftCandidate = true;
+    }
+    if (mDriftIntervalStartNanos < 0) {
+        mDriftIntervalStartNanos = nanoTime;
+    } else if (nanoTime - mDriftIntervalStartNanos >= DRIFT_INTERVAL_NANOS) {
+        mDriftHistory[mDriftHistoryCount % kDriftHistorySize] = mDriftCandidate;
+        mDriftHistoryCount++;
+        mHasDriftCandidate = false;
+        mDriftIntervalStartNanos = nanoTime;
+        estimateDrift();
+    }
+}
+
+void IsochronousClockModel::estimateDrift() {
+    const int32_t numPoints = std::min(mDriftHistoryCount, (int32_t) kDriftHistorySize);
+    if (numPoints < DRIFT_MIN_POINTS) {
+        return;
+    }
+    // Least squares fit of time against position, relative to one of the points
+    // to keep the precision.
+    const DriftPoint &reference = mDriftHistory[0];
+    double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    for (int32_t i = 0; i < numPoints; i++) {
+        double x = (double) (mDriftHistory[i].framePosition - reference.framePosition);
+        double y = (double) (mDriftHistory[i].nanoTime - reference.nanoTime);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+    double denominator = (numPoints * sumXX) - (sumX * sumX);
+    double numerator = (numPoints * sumXY) - (sumX * sumY);
+    if (denominator <= 0.0 || numerator <= 0.0) {
+        return; // the stream did not advance
+    }
+    double nanosPerFrame = numerator / denominator;
+    double rateHertz = AAUDIO_NANOS_PER_SECOND / nanosPerFrame;
+    double driftPpm = ((rateHertz / mSampleRate) - 1.0) * 1000000.0;
+    if (std::fabs(driftPpm) > DRIFT_MAX_PPM) {
+        ALOGV("estimateDrift() ignore drift of %f ppm", driftPpm);
+        return;
+    }
+    mRateMilliHertz = llround(rateHertz * MILLIHERTZ_PER_HERTZ);
+    update();
+}
+
+double IsochronousClockModel::getDriftPpm() const {
+    double nominalMilliHertz = (double) mSampleRate * MILLIHERTZ_PER_HERTZ;
+    return ((mRateMilliHertz / nominalMilliHertz) - 1.0) * 1000000.0;
+}
+
 int64_t IsochronousClockModel::convertDeltaPositionToTime(int64_t framesDelta) const {
-    return (AAUDIO_NANOS_PER_SECOND * framesDelta) / mSampleRate;
+    return multiplyDivide(framesDelta, AAUDIO_NANOS_PER_SECOND * MILLIHERTZ_PER_HERTZ,
+                          mRateMilliHertz);
+}
+
+int64_t IsochronousClockModel::convertDeltaPositionToTimeRoundUp(int64_t framesDelta) const {
+    return multiplyDivide(framesDelta, AAUDIO_NANOS_PER_SECOND * MILLIHERTZ_PER_HERTZ,
+                          mRateMilliHertz, true /* roundUp */);
 }
 
 int64_t IsochronousClockModel::convertDeltaTimeToPosition(int64_t nanosDelta) const {
-    return (mSampleRate * nanosDelta) / AAUDIO_NANOS_PER_SECOND;
+    return multiplyDivide(mRateMilliHertz, nanosDelta,
+                          AAUDIO_NANOS_PER_SECOND * MILLIHERTZ_PER_HERTZ);
 }
 
 int64_t IsochronousClockModel::convertPositionToTime(int64_t framePosition) const {
@@ -189,5 +299,6 @@ void IsochronousClockModel::dump() const {
     ALOGD("mSampleRate          = %6d", mSampleRate);
     ALOGD("mFramesPerBurst      = %6d", mFramesPerBurst);
     ALOGD("mMaxLatenessInNanos  = %6d", mMaxLatenessInNanos);
+    ALOGD("drift ppm            = %6.1f", getDriftPpm());
     ALOGD("mState               = %6d", mState);
 }
@@ -25,6 +25,11 @@ namespace aaudio {
  * Model an isochronous data stream using occasional timestamps as input.
  * This can be used to predict the position of the stream at a given time.
  *
+ * The DSP clock usually differs from the CPU clock by some ppm. While running, the model
+ * fits a line through the earliest timestamp of each interval of recent history and uses
+ * that rate instead of the nominal sample rate, so that predictions stay close to the
+ * DSP position rather than being pulled back by a late timestamp once per drifted burst.
+ *
  * This class is not thread safe and should only be called from one thread.
  */
 class IsochronousClockModel {
@@ -59,6 +64,11 @@ public:
         return mSampleRate;
     }
 
+    /**
+     * @return estimated difference between the DSP and CPU clocks, in parts per million
+     */
+    double getDriftPpm() const;
+
     /**
      * This must be set accurately in order to track the isochronous stream.
      *
@@ -108,6 +118,13 @@ private:
         STATE_RUNNING
     };
 
+    // One point of the lower envelope of the timestamps.
+    struct DriftPoint {
+        int64_t framePosition;
+        int64_t nanoTime;
+    };
+    static constexpr int kDriftHistorySize = 16;
+
     int64_t             mMarkerFramePosition;
     int64_t             mMarkerNanoTime;
     int32_t             mSampleRate;
@@ -115,7 +132,22 @@ private:
     int32_t             mMaxLatenessInNanos;
     clock_model_state_t mState;
 
+    // Estimated rate of the stream in thousandths of a frame per second.
+    int64_t             mRateMilliHertz;
+
+    // Earliest timestamp, relative to the model, seen in the current interval.
+    DriftPoint          mDriftCandidate;
+    int64_t             mDriftCandidateLateness;
+    int64_t             mDriftIntervalStartNanos;
+    bool                mHasDriftCandidate;
+    DriftPoint          mDriftHistory[kDriftHistorySize];
+    int32_t             mDriftHistoryCount; // total points, the array keeps the latest ones
+
     void update();
+    void resetDrift();
+    void trackDrift(int64_t framePosition, int64_t nanoTime, int64_t lateness);
+    void estimateDrift();
+    int64_t convertDeltaPositionToTimeRoundUp(int64_t framesDelta) const;
 };
 
 } /* namespace aaudio */
@@ -26,6 +26,7 @@ namespace android {
 
 /**
  * A FIFO with counters contained in the class.
+ * Each counter is in its own cache line, see kFifoCacheLineSize.
  */
 class FifoController : public FifoControllerBase
 {
@@ -38,7 +39,8 @@ public:
 
     virtual ~FifoController() {}
 
-    // TODO review use of memory barriers, probably incorrect
+    // A counter is only written by its owner. The release store publishes the frames
+    // written, or the room freed, before it to the acquire load on the other side.
     virtual fifo_counter_t getReadCounter() override {
         return mReadCounter.load(std::memory_order_acquire);
     }
@@ -53,8 +55,8 @@ public:
     }
 
 private:
-    std::atomic<fifo_counter_t> mReadCounter;
-    std::atomic<fifo_counter_t> mWriteCounter;
+    alignas(kFifoCacheLineSize) std::atomic<fifo_counter_t> mReadCounter;
+    alignas(kFifoCacheLineSize) std::atomic<fifo_counter_t> mWriteCounter;
 };
 
 }  // android
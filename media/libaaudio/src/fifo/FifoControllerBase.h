@@ -17,6 +17,7 @@
 #ifndef FIFO_FIFO_CONTROLLER_BASE_H
 #define FIFO_FIFO_CONTROLLER_BASE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace android {
@@ -24,6 +25,10 @@ namespace android {
 typedef int64_t fifo_counter_t;
 typedef int32_t fifo_frames_t;
 
+// The read and write counters are written by different threads, often on different cores.
+// Keeping each one in its own cache line avoids false sharing between the two sides.
+constexpr size_t kFifoCacheLineSize = 64;
+
 /**
  * Manage the read/write indices of a circular buffer.
  *
@@ -46,7 +46,10 @@ public:
     }
     virtual ~FifoControllerIndirect() {};
 
-    // TODO review use of memory barriers, probably incorrect
+    // A counter is only written by its owner. The release store publishes the frames
+    // written, or the room freed, before it to the acquire load on the other side.
+    // The counters are in memory provided by the caller, so it decides whether they
+    // share a cache line, see RingbufferFlags::COUNTERS_PADDED.
     virtual fifo_counter_t getReadCounter() override {
         return mReadCounterAddress->load(std::memory_order_acquire);
     }
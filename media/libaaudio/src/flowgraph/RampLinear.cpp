@@ -43,12 +43,7 @@ float RampLinear::interpolateCurrent() {
     return mLevelTo - (mRemaining * mScaler);
 }
 
-int32_t RampLinear::onProcess(int64_t framePosition, int32_t numFrames) {
-    int32_t framesToProcess = input.pullData(framePosition, numFrames);
-    const float *inputBuffer = input.getBlock();
-    float *outputBuffer = output.getBlock();
-    int32_t channelCount = output.getSamplesPerFrame();
-
+int32_t RampLinear::updateRamp() {
     float target = getTarget();
     if (target != mLevelTo) {
         // Start new ramp. Continue from previous level.
@@ -59,6 +54,16 @@ int32_t RampLinear::onProcess(int64_t framePosition, int32_t numFrames) {
               __func__, mLevelFrom, mLevelTo, mRemaining, mScaler);
         mScaler = (mLevelTo - mLevelFrom) / mLengthInFrames; // for interpolation
     }
+    return mRemaining;
+}
+
+int32_t RampLinear::onProcess(int64_t framePosition, int32_t numFrames) {
+    int32_t framesToProcess = input.pullData(framePosition, numFrames);
+    const float *inputBuffer = input.getBlock();
+    float *outputBuffer = output.getBlock();
+    int32_t channelCount = output.getSamplesPerFrame();
+
+    updateRamp();
 
     int32_t framesLeft = framesToProcess;
 
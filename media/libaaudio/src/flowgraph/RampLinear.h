@@ -66,6 +66,33 @@ public:
         mLevelTo = level;
     }
 
+    // The following are for a caller that applies the ramp itself, see AAudioFlowGraph.
+
+    /**
+     * Start a new ramp from the current level if the target has changed.
+     *
+     * @return number of frames left in the ramp
+     */
+    int32_t updateRamp();
+
+    /**
+     * Only call this while updateRamp() reports frames left in the ramp.
+     *
+     * @return level for the next frame, then advance the ramp by one frame
+     */
+    float nextRampLevel() {
+        float level = interpolateCurrent();
+        mRemaining--;
+        return level;
+    }
+
+    /**
+     * @return level applied once the ramp is finished
+     */
+    float getLevel() const {
+        return mLevelTo;
+    }
+
     AudioFloatInputPort input;
     AudioFloatOutputPort output;
 
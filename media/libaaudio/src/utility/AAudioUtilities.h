@@ -114,7 +114,8 @@ int32_t AAudioProperty_getMMapExclusivePolicy();
 
 /**
  * Read system property.
- * @return number of bursts per AAudio service mixer cycle
+ * @return number of bursts per AAudio service mixer cycle,
+ *         or zero to size it from the buffer capacity of the running clients
  */
 int32_t AAudioProperty_getMixerBursts();
 
@@ -84,6 +84,29 @@ public:
         }
     }
 
+    // Feed jittery timestamps from a hardware clock running at the specified rate
+    // and check that the model learns the rate.
+    void checkDriftEstimate(double hardwareFramesPerSecond, double seconds) {
+        const int64_t startTimeNanos = 500000000; // arbitrary
+        model.start(startTimeNanos);
+        model.processTimestamp(0, startTimeNanos);
+
+        double elapsedTimeSeconds = 0.0;
+        while (elapsedTimeSeconds < seconds) {
+            elapsedTimeSeconds += (0.5 + drand48()) * NANOS_PER_BURST / NANOS_PER_SECOND;
+            const int64_t numBursts = (int64_t)(hardwareFramesPerSecond * elapsedTimeSeconds)
+                    / HW_FRAMES_PER_BURST;
+            // Timestamps arrive up to half a burst late.
+            const double latenessSeconds = 0.5 * drand48() * NANOS_PER_BURST / NANOS_PER_SECOND;
+            const int64_t burstTimeNanos = startTimeNanos + (int64_t)(NANOS_PER_SECOND
+                    * (numBursts * HW_FRAMES_PER_BURST / hardwareFramesPerSecond
+                    + latenessSeconds));
+            model.processTimestamp(numBursts * HW_FRAMES_PER_BURST, burstTimeNanos);
+        }
+        const double expectedPpm = ((hardwareFramesPerSecond / SAMPLE_RATE) - 1.0) * 1000000.0;
+        EXPECT_NEAR(expectedPpm, model.getDriftPpm(), 50.0);
+    }
+
     IsochronousClockModel model;
 };
 
@@ -163,4 +186,16 @@ TEST_F(ClockModelTestFixture, clock_slow_drift) {
 
 TEST_F(ClockModelTestFixture, clock_fast_drift) {
     checkDriftingClock(1.002 * SAMPLE_RATE, NUM_LOOPS_DRIFT);
-}
\ No newline at end of file
+}
+
+TEST_F(ClockModelTestFixture, clock_drift_estimate_none) {
+    checkDriftEstimate(SAMPLE_RATE, 5.0);
+}
+
+TEST_F(ClockModelTestFixture, clock_drift_estimate_slow) {
+    checkDriftEstimate(0.9997 * SAMPLE_RATE, 5.0);
+}
+
+TEST_F(ClockModelTestFixture, clock_drift_estimate_fast) {
+    checkDriftEstimate(1.0004 * SAMPLE_RATE, 5.0);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark for the placement of the FIFO counters.
+// A writer and a reader thread stream small bursts through a FifoBuffer whose
+// counters are either adjacent, as in the old shared memory layout, or padded
+// into separate cache lines. With adjacent counters every counter update by one
+// side invalidates the line the other side keeps polling for its own counter.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "fifo/FifoBuffer.h"
+
+using android::fifo_frames_t;
+using android::fifo_counter_t;
+using android::FifoBuffer;
+using android::kFifoCacheLineSize;
+
+static constexpr fifo_frames_t kCapacity = 256;
+static constexpr int32_t kTotalFrames = 1 << 21;
+
+// Counters at offset 0 and counterSpacing in a cache line aligned block.
+struct alignas(kFifoCacheLineSize) CounterBlock {
+    uint8_t bytes[2 * kFifoCacheLineSize];
+};
+
+// Returns nanoseconds per burst, or a negative value if the data got corrupted.
+static double streamBursts(size_t counterSpacing, fifo_frames_t framesPerBurst) {
+    CounterBlock counters{};
+    int32_t storage[kCapacity];
+    fifo_counter_t *readCounter = reinterpret_cast<fifo_counter_t *>(&counters.bytes[0]);
+    fifo_counter_t *writeCounter =
+            reinterpret_cast<fifo_counter_t *>(&counters.bytes[counterSpacing]);
+    FifoBuffer fifo(sizeof(int32_t), kCapacity, readCounter, writeCounter, storage);
+
+    bool corrupted = false;
+    auto start = std::chrono::steady_clock::now();
+    std::thread reader([&]() {
+        int32_t buffer[kCapacity];
+        int32_t expected = 0;
+        while (expected < kTotalFrames) {
+            fifo_frames_t framesRead = fifo.read(buffer, framesPerBurst);
+            for (fifo_frames_t i = 0; i < framesRead; i++) {
+                if (buffer[i] != expected++) {
+                    corrupted = true;
+                }
+            }
+        }
+    });
+
+    int32_t buffer[kCapacity];
+    int32_t next = 0;
+    while (next < kTotalFrames) {
+        fifo_frames_t framesToWrite = std::min(framesPerBurst, kTotalFrames - next);
+        for (fifo_frames_t i = 0; i < framesToWrite; i++) {
+            buffer[i] = next + i;
+        }
+        next += fifo.write(buffer, framesToWrite);
+    }
+    reader.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    if (corrupted) {
+        return -1.0;
+    }
+    double nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return nanos / (kTotalFrames / framesPerBurst);
+}
+
+TEST(test_fifo_false_sharing, adjacent_vs_padded_counters) {
+    if (std::thread::hardware_concurrency() < 2) {
+        std::cout << "single core, skipping" << std::endl;
+        return;
+    }
+    for (fifo_frames_t framesPerBurst : {1, 4, 16, 64}) {
+        double adjacent = streamBursts(sizeof(fifo_counter_t), framesPerBurst);
+        double padded = streamBursts(kFifoCacheLineSize, framesPerBurst);
+        ASSERT_GE(adjacent, 0.0);
+        ASSERT_GE(padded, 0.0);
+        // Timing depends on the device and load, so only report it.
+        std::cout << "burst " << framesPerBurst
+                  << ": adjacent " << adjacent << " ns, padded " << padded
+                  << " ns per burst, speedup " << (adjacent / padded) << std::endl;
+    }
+}
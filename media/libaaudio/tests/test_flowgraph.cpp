@@ -19,9 +19,11 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "client/AAudioFlowGraph.h"
 #include "flowgraph/ClipToRange.h"
 #include "flowgraph/MonoToMultiConverter.h"
 #include "flowgraph/SourceFloat.h"
@@ -155,3 +157,89 @@ TEST(test_flowgraph, module_clip_to_range) {
         EXPECT_NEAR(expected[i], output[i], tolerance);
     }
 }
+
+// Run the same data through the fused AAudioFlowGraph and through the nodes it replaces.
+template <typename TI, typename TO>
+static void checkFusedGraph(audio_format_t sourceFormat, int32_t sourceChannelCount,
+                            audio_format_t sinkFormat, int32_t sinkChannelCount) {
+    constexpr int32_t kRampFrames = 37;
+    constexpr float kVolume = 0.7f;
+    constexpr int32_t kBursts[] = {1, 3, 64, 17, 96}; // arbitrary, some odd sizes
+    AAudioFlowGraph flowGraph;
+    ASSERT_EQ(AAUDIO_OK, flowGraph.configure(sourceFormat, sourceChannelCount,
+                                             sinkFormat, sinkChannelCount));
+    ASSERT_TRUE(flowGraph.isFused());
+    flowGraph.setRampLengthInFrames(kRampFrames);
+    flowGraph.setTargetVolume(kVolume);
+
+    std::unique_ptr<AudioSource> source;
+    if (sourceFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        source = std::make_unique<SourceI16>(sourceChannelCount);
+    } else {
+        source = std::make_unique<SourceFloat>(sourceChannelCount);
+    }
+    RampLinear ramp{sourceChannelCount};
+    ramp.setLengthInFrames(kRampFrames);
+    ramp.setTarget(kVolume);
+    ClipToRange clipper{sourceChannelCount};
+    MonoToMultiConverter expander{sinkChannelCount};
+    std::unique_ptr<AudioSink> sink;
+    if (sinkFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        sink = std::make_unique<SinkI16>(sinkChannelCount);
+    } else {
+        sink = std::make_unique<SinkFloat>(sinkChannelCount);
+    }
+    AudioFloatOutputPort *lastOutput = &source->output;
+    lastOutput->connect(&ramp.input);
+    lastOutput = &ramp.output;
+    if (sourceFormat == AUDIO_FORMAT_PCM_FLOAT && sinkFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        lastOutput->connect(&clipper.input);
+        lastOutput = &clipper.output;
+    }
+    if (sourceChannelCount != sinkChannelCount) {
+        lastOutput->connect(&expander.input);
+        lastOutput = &expander.output;
+    }
+    lastOutput->connect(&sink->input);
+
+    for (int32_t numFrames : kBursts) {
+        std::vector<TI> input(numFrames * sourceChannelCount);
+        for (auto &sample : input) {
+            // Exceed the range so that clipping is exercised.
+            sample = (TI) (sizeof(TI) == sizeof(int16_t)
+                    ? (int16_t) rand() : 3.0f * (drand48() - 0.5));
+        }
+        std::vector<TO> expected(numFrames * sinkChannelCount);
+        std::vector<TO> output(numFrames * sinkChannelCount);
+        // The graph checks for a new target every block, so feed it one burst at a time.
+        source->setData(input.data(), numFrames);
+        ASSERT_EQ(numFrames, sink->read(expected.data(), numFrames));
+        flowGraph.process(input.data(), output.data(), numFrames);
+        EXPECT_EQ(0, memcmp(expected.data(), output.data(), expected.size() * sizeof(TO)))
+                << "burst of " << numFrames << " frames";
+    }
+}
+
+TEST(test_flowgraph, fused_i16_to_float) {
+    checkFusedGraph<int16_t, float>(AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_FLOAT, 1);
+    checkFusedGraph<int16_t, float>(AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_FLOAT, 2);
+    checkFusedGraph<int16_t, float>(AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_FLOAT, 2);
+}
+
+TEST(test_flowgraph, fused_i16_to_i16) {
+    checkFusedGraph<int16_t, int16_t>(AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_16_BIT, 1);
+    checkFusedGraph<int16_t, int16_t>(AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_16_BIT, 2);
+    checkFusedGraph<int16_t, int16_t>(AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_16_BIT, 2);
+}
+
+TEST(test_flowgraph, fused_float_to_float) {
+    checkFusedGraph<float, float>(AUDIO_FORMAT_PCM_FLOAT, 1, AUDIO_FORMAT_PCM_FLOAT, 1);
+    checkFusedGraph<float, float>(AUDIO_FORMAT_PCM_FLOAT, 2, AUDIO_FORMAT_PCM_FLOAT, 2);
+    checkFusedGraph<float, float>(AUDIO_FORMAT_PCM_FLOAT, 1, AUDIO_FORMAT_PCM_FLOAT, 2);
+}
+
+TEST(test_flowgraph, fused_float_to_i16) {
+    checkFusedGraph<float, int16_t>(AUDIO_FORMAT_PCM_FLOAT, 1, AUDIO_FORMAT_PCM_16_BIT, 1);
+    checkFusedGraph<float, int16_t>(AUDIO_FORMAT_PCM_FLOAT, 2, AUDIO_FORMAT_PCM_16_BIT, 2);
+    checkFusedGraph<float, int16_t>(AUDIO_FORMAT_PCM_FLOAT, 1, AUDIO_FORMAT_PCM_16_BIT, 2);
+}
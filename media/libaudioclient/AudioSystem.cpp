@@ -750,6 +750,12 @@ status_t AudioSystem::AudioFlingerClient::removeAudioDeviceCallback(
 // client singleton for AudioPolicyService binder interface
 // protected by gLockAPS
 sp<IAudioPolicyService> AudioSystem::gAudioPolicyService;
+
+Mutex AudioSystem::gLockPolicyConfig;
+bool AudioSystem::gAudioProductStrategiesValid = false;
+AudioProductStrategyVector AudioSystem::gAudioProductStrategies;
+bool AudioSystem::gAudioVolumeGroupsValid = false;
+AudioVolumeGroupVector AudioSystem::gAudioVolumeGroups;
 sp<AudioSystem::AudioPolicyServiceClient> AudioSystem::gAudioPolicyServiceClient;
 
 
@@ -1455,9 +1461,22 @@ status_t AudioSystem::getHwOffloadEncodingFormatsSupportedForA2DP(
 
 status_t AudioSystem::listAudioProductStrategies(AudioProductStrategyVector &strategies)
 {
+    {
+        Mutex::Autolock _l(gLockPolicyConfig);
+        if (gAudioProductStrategiesValid) {
+            strategies = gAudioProductStrategies;
+            return NO_ERROR;
+        }
+    }
     const sp<IAudioPolicyService>& aps = AudioSystem::get_audio_policy_service();
     if (aps == 0) return PERMISSION_DENIED;
-    return aps->listAudioProductStrategies(strategies);
+    status_t status = aps->listAudioProductStrategies(strategies);
+    if (status == NO_ERROR) {
+        Mutex::Autolock _l(gLockPolicyConfig);
+        gAudioProductStrategies = strategies;
+        gAudioProductStrategiesValid = true;
+    }
+    return status;
 }
 
 audio_attributes_t AudioSystem::streamTypeToAttributes(audio_stream_type_t stream)
@@ -1511,9 +1530,31 @@ status_t AudioSystem::getProductStrategyFromAudioAttributes(const AudioAttribute
 
 status_t AudioSystem::listAudioVolumeGroups(AudioVolumeGroupVector &groups)
 {
+    {
+        Mutex::Autolock _l(gLockPolicyConfig);
+        if (gAudioVolumeGroupsValid) {
+            groups = gAudioVolumeGroups;
+            return NO_ERROR;
+        }
+    }
     const sp<IAudioPolicyService>& aps = AudioSystem::get_audio_policy_service();
     if (aps == 0) return PERMISSION_DENIED;
-    return aps->listAudioVolumeGroups(groups);
+    status_t status = aps->listAudioVolumeGroups(groups);
+    if (status == NO_ERROR) {
+        Mutex::Autolock _l(gLockPolicyConfig);
+        gAudioVolumeGroups = groups;
+        gAudioVolumeGroupsValid = true;
+    }
+    return status;
+}
+
+void AudioSystem::clearPolicyConfigCache()
+{
+    Mutex::Autolock _l(gLockPolicyConfig);
+    gAudioProductStrategiesValid = false;
+    gAudioProductStrategies.clear();
+    gAudioVolumeGroupsValid = false;
+    gAudioVolumeGroups.clear();
 }
 
 status_t AudioSystem::getVolumeGroupFromAudioAttributes(const AudioAttributes &aa,
@@ -1698,6 +1739,7 @@ void AudioSystem::AudioPolicyServiceClient::binderDied(const wp<IBinder>& who __
         Mutex::Autolock _l(gLockAPS);
         AudioSystem::gAudioPolicyService.clear();
     }
+    AudioSystem::clearPolicyConfigCache();
 
     ALOGW("AudioPolicyService server died!");
 }
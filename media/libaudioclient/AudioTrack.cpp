@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "AudioTrack"
 
+#include <algorithm>
 #include <inttypes.h>
 #include <math.h>
 #include <sys/resource.h>
@@ -42,6 +43,9 @@
 #define WAIT_STREAM_END_TIMEOUT_SEC     120
 static const int kMaxLoopCountNotifications = 32;
 
+// Older presentation timestamps in shared memory are ignored, see getTimestamp_l().
+static const nsecs_t kMaxPresentationTimestampAgeNs = 100 * 1000000LL;
+
 namespace android {
 // ---------------------------------------------------------------------------
 
@@ -633,9 +637,22 @@ status_t AudioTrack::start()
         return INVALID_OPERATION;
     }
 
+    State previousState;
+    int32_t flags = startPrepare_l(&previousState);
+
+    status_t status = NO_ERROR;
+    if (!(flags & CBLK_INVALID)) {
+        status = mAudioTrack->start();
+    }
+    return startComplete_l(status, flags, previousState);
+}
+
+int32_t AudioTrack::startPrepare_l(State *previousStatePtr)
+{
     mInUnderrun = true;
 
     State previousState = mState;
+    *previousStatePtr = previousState;
     if (previousState == STATE_PAUSED_STOPPING) {
         mState = STATE_STOPPING;
     } else {
@@ -701,14 +718,13 @@ status_t AudioTrack::start()
         }
     }
     mNewPosition = mPosition + mUpdatePeriod;
-    int32_t flags = android_atomic_and(~(CBLK_STREAM_END_DONE | CBLK_DISABLED), &mCblk->mFlags);
+    return android_atomic_and(~(CBLK_STREAM_END_DONE | CBLK_DISABLED), &mCblk->mFlags);
+}
 
-    status_t status = NO_ERROR;
-    if (!(flags & CBLK_INVALID)) {
-        status = mAudioTrack->start();
-        if (status == DEAD_OBJECT) {
-            flags |= CBLK_INVALID;
-        }
+status_t AudioTrack::startComplete_l(status_t status, int32_t flags, State previousState)
+{
+    if (status == DEAD_OBJECT) {
+        flags |= CBLK_INVALID;
     }
     if (flags & CBLK_INVALID) {
         status = restoreTrack_l("start");
@@ -752,9 +768,18 @@ void AudioTrack::stop()
     AutoMutex lock(mLock);
     ALOGV("%s(%d): prior state:%s", __func__, mPortId, stateToString(mState));
 
-    if (mState != STATE_ACTIVE && mState != STATE_PAUSED) {
+    if (!stopPrepare_l()) {
         return;
     }
+    mAudioTrack->stop();
+    stopComplete_l();
+}
+
+bool AudioTrack::stopPrepare_l()
+{
+    if (mState != STATE_ACTIVE && mState != STATE_PAUSED) {
+        return false;
+    }
 
     if (isOffloaded_l()) {
         mState = STATE_STOPPING;
@@ -767,8 +792,11 @@ void AudioTrack::stop()
 
     mProxy->stop(); // notify server not to read beyond current client position until start().
     mProxy->interrupt();
-    mAudioTrack->stop();
+    return true;
+}
 
+void AudioTrack::stopComplete_l()
+{
     // Note: legacy handling - stop does not clear playback marker
     // and periodic update counter, but flush does for streaming tracks.
 
@@ -829,6 +857,7 @@ void AudioTrack::flush_l()
         mProxy->interrupt();
     }
     mProxy->flush();
+    mProxy->clearPresentationTimestamp();
     mAudioTrack->flush();
 }
 
@@ -837,16 +866,30 @@ void AudioTrack::pause()
     AutoMutex lock(mLock);
     ALOGV("%s(%d): prior state:%s", __func__, mPortId, stateToString(mState));
 
+    if (!pausePrepare_l()) {
+        return;
+    }
+    mAudioTrack->pause();
+    pauseComplete_l();
+}
+
+bool AudioTrack::pausePrepare_l()
+{
     if (mState == STATE_ACTIVE) {
         mState = STATE_PAUSED;
     } else if (mState == STATE_STOPPING) {
         mState = STATE_PAUSED_STOPPING;
     } else {
-        return;
+        return false;
     }
     mProxy->interrupt();
-    mAudioTrack->pause();
+    // the presentation timestamp is not updated while paused.
+    mProxy->clearPresentationTimestamp();
+    return true;
+}
 
+void AudioTrack::pauseComplete_l()
+{
     if (isOffloaded_l()) {
         if (mOutput != AUDIO_IO_HANDLE_NONE) {
             // An offload output can be re-used between two audio tracks having
@@ -868,6 +911,140 @@ void AudioTrack::pause()
     }
 }
 
+// static
+status_t AudioTrack::startTracks(const std::vector<sp<AudioTrack>>& tracks,
+                                 std::vector<status_t> *statuses)
+{
+    return controlTracks(tracks, IAudioFlinger::TRACK_CONTROL_START, statuses);
+}
+
+// static
+status_t AudioTrack::stopTracks(const std::vector<sp<AudioTrack>>& tracks)
+{
+    return controlTracks(tracks, IAudioFlinger::TRACK_CONTROL_STOP, nullptr);
+}
+
+// static
+status_t AudioTrack::pauseTracks(const std::vector<sp<AudioTrack>>& tracks)
+{
+    return controlTracks(tracks, IAudioFlinger::TRACK_CONTROL_PAUSE, nullptr);
+}
+
+// static
+status_t AudioTrack::controlTracks(const std::vector<sp<AudioTrack>>& tracks,
+                                   int32_t control,
+                                   std::vector<status_t> *statuses)
+{
+    const auto trackControl = static_cast<IAudioFlinger::track_control_t>(control);
+    // Lock the tracks in address order so that concurrent batches cannot deadlock.
+    std::vector<AudioTrack *> sorted;
+    for (const auto& track : tracks) {
+        if (track == 0) {
+            return BAD_VALUE;
+        }
+        sorted.push_back(track.get());
+    }
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        return BAD_VALUE;
+    }
+    for (AudioTrack *track : sorted) {
+        track->mLock.lock();
+    }
+
+    // Do the client side of each operation, and collect the tracks that need the server.
+    const size_t count = tracks.size();
+    std::vector<status_t> results(count, NO_ERROR);
+    std::vector<bool> prepared(count, false);
+    std::vector<State> previousStates(count, STATE_STOPPED);
+    std::vector<int32_t> flags(count, 0);
+    std::vector<size_t> remoteIndices;
+    std::vector<sp<IAudioTrack>> remoteTracks;
+    for (size_t i = 0; i < count; i++) {
+        AudioTrack *track = tracks[i].get();
+        bool callServer = false;
+        switch (trackControl) {
+        case IAudioFlinger::TRACK_CONTROL_START:
+            if (track->mState == STATE_ACTIVE) {
+                results[i] = INVALID_OPERATION;
+                break;
+            }
+            prepared[i] = true;
+            flags[i] = track->startPrepare_l(&previousStates[i]);
+            // An invalid track is restored by startComplete_l().
+            callServer = !(flags[i] & CBLK_INVALID);
+            break;
+        case IAudioFlinger::TRACK_CONTROL_STOP:
+            prepared[i] = callServer = track->stopPrepare_l();
+            break;
+        case IAudioFlinger::TRACK_CONTROL_PAUSE:
+            prepared[i] = callServer = track->pausePrepare_l();
+            break;
+        }
+        if (callServer) {
+            remoteIndices.push_back(i);
+            remoteTracks.push_back(track->mAudioTrack);
+        }
+    }
+
+    if (!remoteTracks.empty()) {
+        std::vector<status_t> remoteStatuses;
+        const sp<IAudioFlinger>& audioFlinger = AudioSystem::get_audio_flinger();
+        status_t status = audioFlinger == 0 ? NO_INIT
+                : audioFlinger->controlTracks(remoteTracks, trackControl, &remoteStatuses);
+        if (status != NO_ERROR || remoteStatuses.size() != remoteTracks.size()) {
+            // Fall back to one call per track, which also reports DEAD_OBJECT per track.
+            ALOGW("%s(): batch of %zu failed with status %d, controlling tracks one by one",
+                    __func__, remoteTracks.size(), status);
+            remoteStatuses.clear();
+            for (const auto& remoteTrack : remoteTracks) {
+                status_t trackStatus = NO_ERROR;
+                switch (trackControl) {
+                case IAudioFlinger::TRACK_CONTROL_START:
+                    trackStatus = remoteTrack->start();
+                    break;
+                case IAudioFlinger::TRACK_CONTROL_STOP:
+                    remoteTrack->stop();
+                    break;
+                case IAudioFlinger::TRACK_CONTROL_PAUSE:
+                    remoteTrack->pause();
+                    break;
+                }
+                remoteStatuses.push_back(trackStatus);
+            }
+        }
+        for (size_t j = 0; j < remoteIndices.size(); j++) {
+            results[remoteIndices[j]] = remoteStatuses[j];
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!prepared[i]) {
+            continue;
+        }
+        AudioTrack *track = tracks[i].get();
+        switch (trackControl) {
+        case IAudioFlinger::TRACK_CONTROL_START:
+            results[i] = track->startComplete_l(results[i], flags[i], previousStates[i]);
+            break;
+        case IAudioFlinger::TRACK_CONTROL_STOP:
+            track->stopComplete_l();
+            break;
+        case IAudioFlinger::TRACK_CONTROL_PAUSE:
+            track->pauseComplete_l();
+            break;
+        }
+    }
+
+    for (AudioTrack *track : sorted) {
+        track->mLock.unlock();
+    }
+    if (statuses != nullptr) {
+        *statuses = std::move(results);
+    }
+    return NO_ERROR;
+}
+
 status_t AudioTrack::setVolume(float left, float right)
 {
     // This duplicates a test by AudioTrack JNI, but that is not the only caller
@@ -2578,8 +2755,20 @@ status_t AudioTrack::getTimestamp_l(AudioTimestamp& timestamp)
 
     status_t status;
     if (isOffloadedOrDirect_l()) {
-        // use Binder to get timestamp
-        status = mAudioTrack->getTimestamp(timestamp);
+        // While active, the playback thread publishes the presentation position to shared
+        // memory every loop. Use Binder only if that copy is missing or stale.
+        PresentationTimestamp presentation;
+        if (mState == STATE_ACTIVE
+                && mProxy->getPresentationTimestamp(&presentation) == OK
+                && systemTime(SYSTEM_TIME_MONOTONIC) - presentation.mTimeNs
+                        < kMaxPresentationTimestampAgeNs) {
+            timestamp.mPosition = (uint32_t)presentation.mPosition;
+            timestamp.mTime = convertNsToTimespec(presentation.mTimeNs);
+            status = OK;
+        } else {
+            // use Binder to get timestamp
+            status = mAudioTrack->getTimestamp(timestamp);
+        }
     } else {
         // read timestamp from shared memory
         ExtendedTimestamp ets;
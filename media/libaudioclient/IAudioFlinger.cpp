@@ -90,6 +90,7 @@ enum {
     SET_MASTER_BALANCE,
     GET_MASTER_BALANCE,
     SET_EFFECT_SUSPENDED,
+    CONTROL_TRACKS,
 };
 
 #define MAX_ITEMS_PER_LIST 1024
@@ -903,6 +904,31 @@ public:
         status = reply.readParcelableVector(microphones);
         return status;
     }
+    virtual status_t controlTracks(const std::vector<sp<IAudioTrack>>& tracks,
+                                   track_control_t control,
+                                   std::vector<status_t> *statuses)
+    {
+        if (statuses == nullptr || tracks.size() > MAX_ITEMS_PER_LIST) {
+            return BAD_VALUE;
+        }
+        Parcel data, reply;
+        data.writeInterfaceToken(IAudioFlinger::getInterfaceDescriptor());
+        data.writeInt32((int32_t) control);
+        data.writeInt32((int32_t) tracks.size());
+        for (const auto& track : tracks) {
+            data.writeStrongBinder(IInterface::asBinder(track));
+        }
+        status_t status = remote()->transact(CONTROL_TRACKS, data, &reply);
+        if (status != NO_ERROR ||
+                (status = (status_t)reply.readInt32()) != NO_ERROR) {
+            return status;
+        }
+        statuses->clear();
+        for (size_t i = 0; i < tracks.size(); i++) {
+            statuses->push_back((status_t) reply.readInt32());
+        }
+        return NO_ERROR;
+    }
 };
 
 IMPLEMENT_META_INTERFACE(AudioFlinger, "android.media.IAudioFlinger");
@@ -1543,6 +1569,34 @@ status_t BnAudioFlinger::onTransact(
             }
             return NO_ERROR;
         }
+        case CONTROL_TRACKS: {
+            CHECK_INTERFACE(IAudioFlinger, data, reply);
+            track_control_t control = (track_control_t) data.readInt32();
+            int32_t count = data.readInt32();
+            if (count < 0 || count > MAX_ITEMS_PER_LIST) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+            std::vector<sp<IAudioTrack>> tracks;
+            for (int32_t i = 0; i < count; i++) {
+                // Only accept tracks created by this process, anything else is left null.
+                sp<IBinder> binder = data.readStrongBinder();
+                sp<IAudioTrack> track;
+                if (binder != 0 && binder->queryLocalInterface(IAudioTrack::descriptor) != 0) {
+                    track = interface_cast<IAudioTrack>(binder);
+                }
+                tracks.push_back(track);
+            }
+            std::vector<status_t> statuses;
+            status_t status = controlTracks(tracks, control, &statuses);
+            reply->writeInt32(status);
+            if (status == NO_ERROR) {
+                for (size_t i = 0; i < tracks.size(); i++) {
+                    reply->writeInt32(i < statuses.size() ? statuses[i] : (status_t) BAD_VALUE);
+                }
+            }
+            return NO_ERROR;
+        }
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -130,11 +130,8 @@ public:
         }
     }
 
-    AudioMixer(size_t frameCount, uint32_t sampleRate)
-        : mSampleRate(sampleRate)
-        , mFrameCount(frameCount) {
-        pthread_once(&sOnceControl, &sInitRoutine);
-    }
+    AudioMixer(size_t frameCount, uint32_t sampleRate);
+    ~AudioMixer();
 
     // Create a new track in the mixer.
     //
@@ -192,6 +189,32 @@ public:
         mNBLogWriter = logWriter;
     }
 
+    // Resample tracks in parallel on workerCount helper threads when more than one
+    // enabled track needs resampling. Mixing into the output buffers remains serialized
+    // on the thread calling process(), so the output is the same as without workers.
+    // workerCount 0 (the default) resamples all tracks on the thread calling process().
+    // Not thread safe with respect to process().
+    void        setResamplerWorkerCount(size_t workerCount);
+
+    // Thread ids of the resampler workers, e.g. for the caller to adjust their priority.
+    std::vector<pid_t> getResamplerWorkerTids() const;
+
+    // Time spent by process() on behalf of one track, see consumeTrackTiming().
+    struct TrackTiming {
+        int64_t mInputNs;       // getNextBuffer(), including any format conversion upstream
+        int64_t mResampleNs;    // resampling, including the input pulled by the resampler
+        int64_t mMixNs;         // volume, ramp and accumulation into the output buffer
+    };
+
+    // Enables per-track timing in process(), disabled by default since it reads
+    // the clock a few times per track and block. Not thread safe with respect to process().
+    void        setTrackTimingEnabled(bool enabled);
+    bool        isTrackTimingEnabled() const { return mTrackTimingEnabled; }
+
+    // Returns the time accumulated for track name since the previous call, and resets it.
+    // Not thread safe with respect to process().
+    TrackTiming consumeTrackTiming(int name);
+
     static inline bool isValidFormat(audio_format_t format) {
         switch (format) {
         case AUDIO_FORMAT_PCM_8_BIT:
@@ -296,6 +319,7 @@ private:
         void        clearContractedBuffer();
         bool        setPlaybackRate(const AudioPlaybackRate &playbackRate);
         void        reconfigureBufferProviders();
+        void        resampleAhead(size_t outFrameCount);
 
         static hook_t getTrackHook(int trackType, uint32_t channelCount,
                 audio_format_t mixerInFormat, audio_format_t mixerOutFormat);
@@ -334,9 +358,14 @@ private:
         mutable AudioBufferProvider::Buffer buffer; // 8 bytes
 
         hook_t      hook;
+        bool        mUseSimdMix;      // volumeMix may use AudioMixerOpsSimd.h, set on validate
+        bool        mResampledAhead;  // mResampleOut holds this mix period's resampled data
+        bool        mTimingEnabled;   // accumulate into mTiming, see setTrackTimingEnabled()
+        TrackTiming mTiming;
         const void  *mIn;             // current location in buffer
 
         std::unique_ptr<AudioResampler> mResampler;
+        std::unique_ptr<int32_t[]> mResampleOut;  // resampleAhead() output, float or int32_t
         uint32_t            sampleRate;
         int32_t*           mainBuffer;
         int32_t*           auxBuffer;
@@ -487,6 +516,8 @@ private:
 
     static void sInitRoutine();
 
+    class ResamplerWorkers;
+
     // initialization constants
     const uint32_t mSampleRate;
     const size_t mFrameCount;
@@ -500,6 +531,13 @@ private:
     std::unique_ptr<int32_t[]> mOutputTemp;
     std::unique_ptr<int32_t[]> mResampleTemp;
 
+    // optional helper threads for process__genericResampling(), see setResamplerWorkerCount().
+    std::unique_ptr<ResamplerWorkers> mResamplerWorkers;
+    // tracks resampled ahead by mResamplerWorkers during the current process().
+    std::vector<Track *> mResampleAhead;
+
+    bool mTrackTimingEnabled = false;
+
     // track names grouped by main buffer, in no particular order of main buffer.
     // however names for a particular main buffer are in order (by construction).
     std::unordered_map<void * /* mainBuffer */, std::vector<int /* name */>> mGroups;
@@ -567,6 +567,15 @@ private:
     static audio_channel_mask_t gPrevInChannelMask;
 
     static sp<IAudioPolicyService> gAudioPolicyService;
+
+    // Product strategies and volume groups are fixed by the policy engine configuration,
+    // so they are only fetched again from a restarted audio policy service.
+    static void clearPolicyConfigCache();
+    static Mutex gLockPolicyConfig; // protects the following cached policy configuration
+    static bool gAudioProductStrategiesValid;
+    static AudioProductStrategyVector gAudioProductStrategies;
+    static bool gAudioVolumeGroupsValid;
+    static AudioVolumeGroupVector gAudioVolumeGroups;
 };
 
 };  // namespace android
@@ -433,6 +433,22 @@ public:
      */
             void        pause();
 
+    /* Start, stop or pause several tracks with a single call to AudioFlinger, instead of
+     * one call per track. This is intended for applications that control many tracks
+     * at the same time, for example a sound pool.
+     * Each track behaves as if start(), stop() or pause() had been called on it.
+     * The tracks must be distinct and not null, otherwise BAD_VALUE is returned and no
+     * track is changed.
+     * For startTracks(), statuses, if not null, receives the result of start() for each
+     * track, in the same order.
+     * Volume does not need a batch call: setVolume() only writes to shared memory,
+     * except for offloaded tracks.
+     */
+    static  status_t    startTracks(const std::vector<sp<AudioTrack>>& tracks,
+                                    std::vector<status_t> *statuses = nullptr);
+    static  status_t    stopTracks(const std::vector<sp<AudioTrack>>& tracks);
+    static  status_t    pauseTracks(const std::vector<sp<AudioTrack>>& tracks);
+
     /* Set volume for this track, mostly used for games' sound effects
      * left and right volumes. Levels must be >= 0.0 and <= 1.0.
      * This is the older API.  New applications should use setVolume(float) when possible.
@@ -1089,6 +1105,24 @@ public:
         }
     }
 
+    // start(), stop() and pause() are split around their IAudioTrack call so that
+    // controlTracks() can make one call for several tracks.
+    // startPrepare_l() returns the control block flags, startComplete_l() the status of start().
+            int32_t     startPrepare_l(State *previousState);
+            status_t    startComplete_l(status_t status, int32_t flags, State previousState);
+    // stopPrepare_l() and pausePrepare_l() return false if the track is not in a state
+    // where the operation applies, then neither the IAudioTrack call nor the matching
+    // complete method is needed.
+            bool        stopPrepare_l();
+            void        stopComplete_l();
+            bool        pausePrepare_l();
+            void        pauseComplete_l();
+
+    // control is an IAudioFlinger::track_control_t.
+    static  status_t    controlTracks(const std::vector<sp<AudioTrack>>& tracks,
+                                      int32_t control,
+                                      std::vector<status_t> *statuses);
+
     // for client callback handler
     callback_t              mCbf;                   // callback handler for events, or NULL
     void*                   mUserData;
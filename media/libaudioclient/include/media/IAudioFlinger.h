@@ -511,6 +511,21 @@ public:
 
     /* List available microphones and their characteristics */
     virtual status_t getMicrophones(std::vector<media::MicrophoneInfo> *microphones) = 0;
+
+    enum track_control_t {
+        TRACK_CONTROL_START,
+        TRACK_CONTROL_STOP,
+        TRACK_CONTROL_PAUSE,
+    };
+
+    /* Apply the same IAudioTrack control to several tracks in one transaction.
+     * statuses receives one status per track, in the same order; it is the status of
+     * IAudioTrack::start() for TRACK_CONTROL_START, and NO_ERROR or BAD_VALUE otherwise.
+     * Returns NO_ERROR unless the transaction itself failed.
+     */
+    virtual status_t controlTracks(const std::vector<sp<IAudioTrack>>& tracks,
+                                   track_control_t control,
+                                   std::vector<status_t> *statuses) = 0;
 };
 
 
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 
 #include PATH(android/hardware/audio/FILE_VERSION/IStreamOutCallback.h)
+#include <cutils/properties.h>
 #include <hwbinder/IPCThreadState.h>
 #include <media/AudioParameter.h>
 #include <mediautils/SchedulingPolicyService.h>
@@ -291,11 +292,13 @@ struct StreamOutCallback : public IStreamOutCallback {
 }  // namespace
 
 StreamOutHalHidl::StreamOutHalHidl(const sp<IStreamOut>& stream)
-        : StreamHalHidl(stream.get()), mStream(stream), mWriterClient(0), mEfGroup(nullptr) {
+        : StreamHalHidl(stream.get()), mStream(stream), mWriterClient(0), mEfGroup(nullptr),
+          mPipelinedWrites(false), mWritePending(false), mPendingWriteBytes(0) {
 }
 
 StreamOutHalHidl::~StreamOutHalHidl() {
     if (mStream != 0) {
+        completePendingWrite();
         if (mCallback.unsafe_get()) {
             processReturn("clearCallback", mStream->clearCallback());
         }
@@ -316,7 +319,8 @@ status_t StreamOutHalHidl::getFrameSize(size_t *size) {
 
 status_t StreamOutHalHidl::getLatency(uint32_t *latency) {
     if (mStream == 0) return NO_INIT;
-    if (mWriterClient == gettid() && mCommandMQ) {
+    // Don't wait for a pipelined write to finish, the HAL can answer on a binder thread.
+    if (mWriterClient == gettid() && mCommandMQ && !mWritePending) {
         return callWriterThread(
                 WriteCommand::GET_LATENCY, "getLatency", nullptr, 0,
                 [&](const WriteStatus& writeStatus) {
@@ -332,6 +336,12 @@ status_t StreamOutHalHidl::setVolume(float left, float right) {
     return processReturn("setVolume", mStream->setVolume(left, right));
 }
 
+status_t StreamOutHalHidl::standby() {
+    // the HAL must not go to standby while it is still writing our data
+    completePendingWrite();
+    return StreamHalHidl::standby();
+}
+
 #if MAJOR_VERSION == 2
 status_t StreamOutHalHidl::selectPresentation(int presentationId, int programId) {
     if (mStream == 0) return NO_INIT;
@@ -376,6 +386,23 @@ status_t StreamOutHalHidl::write(const void *buffer, size_t bytes, size_t *writt
         }
     }
 
+    if (mPipelinedWrites) {
+        // Report the previous write's failure now, the data of this one is not queued.
+        if ((status = completePendingWrite()) != OK) {
+            return status;
+        }
+        size_t queued = bytes;
+        status = postWriterCommand(
+                WriteCommand::WRITE, "write", static_cast<const uint8_t*>(buffer), &queued);
+        if (status == OK) {
+            mWritePending = true;
+            mPendingWriteBytes = queued;
+            *written = queued;
+        }
+        mStreamPowerLog.log(buffer, *written);
+        return status;
+    }
+
     status = callWriterThread(
             WriteCommand::WRITE, "write", static_cast<const uint8_t*>(buffer), bytes,
             [&] (const WriteStatus& writeStatus) {
@@ -392,23 +419,38 @@ status_t StreamOutHalHidl::write(const void *buffer, size_t bytes, size_t *writt
 status_t StreamOutHalHidl::callWriterThread(
         WriteCommand cmd, const char* cmdName,
         const uint8_t* data, size_t dataSize, StreamOutHalHidl::WriterCallback callback) {
+    // A failure of a pending write has been logged already, and the command can proceed.
+    (void)completePendingWrite();
+    status_t ret = postWriterCommand(cmd, cmdName, data, &dataSize);
+    if (ret != OK) {
+        return ret;
+    }
+    return waitWriterStatus(cmdName, callback);
+}
+
+status_t StreamOutHalHidl::postWriterCommand(
+        WriteCommand cmd, const char* cmdName, const uint8_t* data, size_t *dataSize) {
     if (!mCommandMQ->write(&cmd)) {
         ALOGE("command message queue write failed for \"%s\"", cmdName);
         return -EAGAIN;
     }
     if (data != nullptr) {
         size_t availableToWrite = mDataMQ->availableToWrite();
-        if (dataSize > availableToWrite) {
+        if (*dataSize > availableToWrite) {
             ALOGW("truncating write data from %lld to %lld due to insufficient data queue space",
-                    (long long)dataSize, (long long)availableToWrite);
-            dataSize = availableToWrite;
+                    (long long)*dataSize, (long long)availableToWrite);
+            *dataSize = availableToWrite;
         }
-        if (!mDataMQ->write(data, dataSize)) {
+        if (!mDataMQ->write(data, *dataSize)) {
             ALOGE("data message queue write failed for \"%s\"", cmdName);
         }
     }
     mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::NOT_EMPTY));
+    return OK;
+}
 
+status_t StreamOutHalHidl::waitWriterStatus(
+        const char* cmdName, StreamOutHalHidl::WriterCallback callback) {
     // TODO: Remove manual event flag handling once blocking MQ is implemented. b/33815422
     uint32_t efState = 0;
 retry:
@@ -434,6 +476,21 @@ retry:
     return ret;
 }
 
+status_t StreamOutHalHidl::completePendingWrite() {
+    // The status queue can only be read by the writer thread.
+    if (!mWritePending || mWriterClient != gettid()) return OK;
+    mWritePending = false;
+    return waitWriterStatus("write", [&](const WriteStatus& writeStatus) {
+        if (writeStatus.reply.written < mPendingWriteBytes) {
+            // Blocking HALs are not expected to do this, and the caller was told that
+            // all data was written; go back to synchronous writes.
+            ALOGW("pipelined write was short: %lld < %lld, disabling pipelined writes",
+                    (long long)writeStatus.reply.written, (long long)mPendingWriteBytes);
+            mPipelinedWrites = false;
+        }
+    });
+}
+
 status_t StreamOutHalHidl::prepareForWriting(size_t bufferSize) {
     std::unique_ptr<CommandMQ> tempCommandMQ;
     std::unique_ptr<DataMQ> tempDataMQ;
@@ -483,6 +540,11 @@ status_t StreamOutHalHidl::prepareForWriting(size_t bufferSize) {
     mDataMQ = std::move(tempDataMQ);
     mStatusMQ = std::move(tempStatusMQ);
     mWriterClient = gettid();
+    // Non-blocking streams report completion through the callback, and can return
+    // short writes which must be known before the next write.
+    mPipelinedWrites = mCallback.unsafe_get() == nullptr
+            && property_get_bool("audio.hal.pipelined_writes", false /* default_value */);
+    ALOGV_IF(mPipelinedWrites, "%s: using pipelined writes", __func__);
     return OK;
 }
 
@@ -534,6 +596,7 @@ status_t StreamOutHalHidl::supportsPauseAndResume(bool *supportsPause, bool *sup
 
 status_t StreamOutHalHidl::pause() {
     if (mStream == 0) return NO_INIT;
+    completePendingWrite();
     return processReturn("pause", mStream->pause());
 }
 
@@ -549,18 +612,21 @@ status_t StreamOutHalHidl::supportsDrain(bool *supportsDrain) {
 
 status_t StreamOutHalHidl::drain(bool earlyNotify) {
     if (mStream == 0) return NO_INIT;
+    completePendingWrite();
     return processReturn(
             "drain", mStream->drain(earlyNotify ? AudioDrain::EARLY_NOTIFY : AudioDrain::ALL));
 }
 
 status_t StreamOutHalHidl::flush() {
     if (mStream == 0) return NO_INIT;
+    completePendingWrite();
     return processReturn("pause", mStream->flush());
 }
 
 status_t StreamOutHalHidl::getPresentationPosition(uint64_t *frames, struct timespec *timestamp) {
     if (mStream == 0) return NO_INIT;
-    if (mWriterClient == gettid() && mCommandMQ) {
+    // Don't wait for a pipelined write to finish, the HAL can answer on a binder thread.
+    if (mWriterClient == gettid() && mCommandMQ && !mWritePending) {
         return callWriterThread(
                 WriteCommand::GET_PRESENTATION_POSITION, "getPresentationPosition", nullptr, 0,
                 [&](const WriteStatus& writeStatus) {
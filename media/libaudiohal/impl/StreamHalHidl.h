@@ -128,6 +128,9 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     // Use this method in situations where audio mixing is done in the hardware.
     virtual status_t setVolume(float left, float right);
 
+    // Put the audio hardware output into standby mode.
+    virtual status_t standby();
+
     // Selects the audio presentation (if available).
     virtual status_t selectPresentation(int presentationId, int programId);
 
@@ -186,6 +189,12 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     std::unique_ptr<StatusMQ> mStatusMQ;
     std::atomic<pid_t> mWriterClient;
     EventFlag* mEfGroup;
+    // Pipelined writes return as soon as the data is queued to the HAL writer thread,
+    // and the status of the write is collected by the next call on the writer thread.
+    // Only used for blocking streams, see prepareForWriting().
+    bool mPipelinedWrites;
+    bool mWritePending;         // a pipelined write has been queued, its status not yet read
+    size_t mPendingWriteBytes;
 
     // Can not be constructed directly by clients.
     StreamOutHalHidl(const sp<IStreamOut>& stream);
@@ -196,6 +205,14 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     status_t callWriterThread(
             WriteCommand cmd, const char* cmdName,
             const uint8_t* data, size_t dataSize, WriterCallback callback);
+    // Queues a command and its data (truncated to the data queue space, see *dataSize),
+    // and wakes up the HAL writer thread.
+    status_t postWriterCommand(
+            WriteCommand cmd, const char* cmdName, const uint8_t* data, size_t *dataSize);
+    // Waits for and reads the status of the last posted command.
+    status_t waitWriterStatus(const char* cmdName, WriterCallback callback);
+    // Reads the status of a pipelined write, if any.  Must be called on the writer thread.
+    status_t completePendingWrite();
     status_t prepareForWriting(size_t bufferSize);
 };
 
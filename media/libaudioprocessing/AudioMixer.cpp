@@ -24,8 +24,14 @@
 #include <math.h>
 #include <sys/types.h>
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+
 #include <utils/Errors.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include <cutils/compiler.h>
 #include <utils/Debug.h>
@@ -37,6 +43,7 @@
 #include <media/AudioMixer.h>
 
 #include "AudioMixerOps.h"
+#include "AudioMixerOpsSimd.h"
 
 // The FCC_2 macro refers to the Fixed Channel Count of 2 for the legacy integer mixer.
 #ifndef FCC_2
@@ -71,6 +78,11 @@ static constexpr bool kUseNewMixer = true;
 // because of downmix/upmix support.
 static constexpr bool kUseFloat = true;
 
+// Set kUseSimdMixer to true to use the NEON or SSE accumulate kernels in
+// AudioMixerOpsSimd.h for tracks that qualify. The kernels are bit-exact with the
+// scalar mixer, so this only affects CPU usage.
+static constexpr bool kUseSimdMixer = USE_MIXER_SIMD;
+
 #ifdef FLOAT_AUX
 using TYPE_AUX = float;
 static_assert(kUseNewMixer && kUseFloat,
@@ -86,10 +98,176 @@ namespace android {
 
 // ----------------------------------------------------------------------------
 
+// Adds the time spent in its scope to *ns, if enabled, see AudioMixer::setTrackTimingEnabled().
+class ScopedTrackTimer {
+public:
+    ScopedTrackTimer(bool enabled, int64_t *ns)
+        : mNs(enabled ? ns : nullptr)
+        , mStartNs(enabled ? systemTime() : 0) {
+    }
+    ~ScopedTrackTimer() {
+        if (mNs != nullptr) {
+            *mNs += systemTime() - mStartNs;
+        }
+    }
+private:
+    int64_t * const mNs;
+    const nsecs_t mStartNs;
+};
+
+// ----------------------------------------------------------------------------
+
 static inline audio_format_t selectMixerInFormat(audio_format_t inputFormat __unused) {
     return kUseFloat && kUseNewMixer ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
 }
 
+/* A small pool of helper threads that run the jobs of run() together with the caller.
+ * Jobs are claimed under the lock, which is cheap since there are only a few per mix.
+ */
+class AudioMixer::ResamplerWorkers {
+public:
+    explicit ResamplerWorkers(size_t workerCount) {
+        for (size_t i = 0; i < workerCount; ++i) {
+            sp<Worker> worker = new Worker(this);
+            const std::string name = "AudioMixerRs" + std::to_string(i);
+            if (worker->run(name.c_str(), ANDROID_PRIORITY_URGENT_AUDIO) != NO_ERROR) {
+                ALOGE("%s: cannot start %s", __func__, name.c_str());
+                break;
+            }
+            mWorkers.push_back(worker);
+        }
+    }
+
+    ~ResamplerWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mExit = true;
+        }
+        mCondition.notify_all();
+        for (const auto &worker : mWorkers) {
+            worker->join();
+        }
+    }
+
+    // Runs job(0) ... job(jobCount - 1) and returns when all have completed.
+    void run(size_t jobCount, const std::function<void(size_t)> &job) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mJob = &job;
+        mJobCount = jobCount;
+        mNextJob = 0;
+        mJobsDone = 0;
+        mCondition.notify_all();
+        runJobs_l(lock);
+        mDoneCondition.wait(lock, [this] { return mJobsDone == mJobCount; });
+        mJob = nullptr;
+        mJobCount = 0;
+        mNextJob = 0;
+    }
+
+    std::vector<pid_t> getTids() const {
+        std::vector<pid_t> tids;
+        for (const auto &worker : mWorkers) {
+            tids.push_back(worker->getTid());
+        }
+        return tids;
+    }
+
+private:
+    class Worker : public Thread {
+    public:
+        explicit Worker(ResamplerWorkers *workers) : Thread(false /*canCallJava*/),
+                mWorkers(workers) { }
+    private:
+        bool threadLoop() override {
+            mWorkers->workerLoop();
+            return false;
+        }
+        ResamplerWorkers * const mWorkers;
+    };
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mLock);
+        for (;;) {
+            mCondition.wait(lock, [this] { return mExit || mNextJob < mJobCount; });
+            if (mExit) {
+                return;
+            }
+            runJobs_l(lock);
+        }
+    }
+
+    void runJobs_l(std::unique_lock<std::mutex> &lock) {
+        while (mNextJob < mJobCount) {
+            const size_t index = mNextJob++;
+            const std::function<void(size_t)> &job = *mJob;
+            lock.unlock();
+            job(index);
+            lock.lock();
+            if (++mJobsDone == mJobCount) {
+                mDoneCondition.notify_all();
+            }
+        }
+    }
+
+    std::vector<sp<Worker>> mWorkers;
+    std::mutex mLock;
+    std::condition_variable mCondition;      // workers wait for jobs or exit
+    std::condition_variable mDoneCondition;  // run() waits for all jobs to complete
+    const std::function<void(size_t)> *mJob = nullptr;
+    size_t mJobCount = 0;
+    size_t mNextJob = 0;
+    size_t mJobsDone = 0;
+    bool mExit = false;
+};
+
+AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate)
+    : mSampleRate(sampleRate)
+    , mFrameCount(frameCount)
+{
+    pthread_once(&sOnceControl, &sInitRoutine);
+}
+
+// out of line for the destruction of mResamplerWorkers.
+AudioMixer::~AudioMixer()
+{
+}
+
+void AudioMixer::setResamplerWorkerCount(size_t workerCount)
+{
+    // the legacy integer mixer hooks resample inline only.
+    if (!kUseNewMixer || workerCount == 0) {
+        mResamplerWorkers.reset();
+    } else {
+        mResamplerWorkers.reset(new ResamplerWorkers(workerCount));
+    }
+    invalidate(); // allocate the per track resampler output buffers as needed.
+}
+
+std::vector<pid_t> AudioMixer::getResamplerWorkerTids() const
+{
+    return mResamplerWorkers.get() != nullptr
+            ? mResamplerWorkers->getTids() : std::vector<pid_t>{};
+}
+
+void AudioMixer::setTrackTimingEnabled(bool enabled)
+{
+    mTrackTimingEnabled = enabled;
+    for (const auto &pair : mTracks) {
+        pair.second->mTimingEnabled = enabled;
+    }
+}
+
+AudioMixer::TrackTiming AudioMixer::consumeTrackTiming(int name)
+{
+    const auto it = mTracks.find(name);
+    if (it == mTracks.end()) {
+        return TrackTiming{};
+    }
+    const TrackTiming timing = it->second->mTiming;
+    it->second->mTiming = TrackTiming{};
+    return timing;
+}
+
 status_t AudioMixer::create(
         int name, audio_channel_mask_t channelMask, audio_format_t format, int sessionId)
 {
@@ -151,6 +329,10 @@ status_t AudioMixer::create(
         // no initialization needed
         // t->buffer.frameCount
         t->hook = NULL;
+        t->mUseSimdMix = false;
+        t->mResampledAhead = false;
+        t->mTimingEnabled = mTrackTimingEnabled;
+        t->mTiming = TrackTiming{};
         t->mIn = NULL;
         t->sampleRate = mSampleRate;
         // setParameter(name, TRACK, MAIN_BUFFER, mixBuffer) is required before enable(name)
@@ -1012,6 +1194,10 @@ void AudioMixer::process__validate()
         }
         t->needs = n;
 
+        // The SIMD kernels need no aux send and a sample aligned main buffer.
+        t->mUseSimdMix = kUseSimdMixer && (n & NEEDS_AUX) == 0
+                && ((uintptr_t)t->mainBuffer & (sizeof(int32_t) - 1)) == 0;
+
         if (n & NEEDS_MUTE) {
             t->hook = &Track::track__nop;
         } else {
@@ -1021,6 +1207,10 @@ void AudioMixer::process__validate()
             if (n & NEEDS_RESAMPLE) {
                 all16BitsStereoNoResample = false;
                 resampling = true;
+                if (mResamplerWorkers.get() != nullptr && t->mResampleOut.get() == nullptr) {
+                    t->mResampleOut.reset(new int32_t[MAX_NUM_CHANNELS * mFrameCount]);
+                    mResampleAhead.reserve(mEnabled.size());
+                }
                 t->hook = Track::getTrackHook(TRACKTYPE_RESAMPLE, t->mMixerChannelCount,
                         t->mMixerInFormat, t->mMixerFormat);
                 ALOGV_IF((n & NEEDS_CHANNEL_COUNT__MASK) > NEEDS_CHANNEL_2,
@@ -1446,7 +1636,10 @@ void AudioMixer::process__genericNoResampling()
         for (const int name : group) {
             const std::shared_ptr<Track> &t = mTracks[name];
             t->buffer.frameCount = mFrameCount;
-            t->bufferProvider->getNextBuffer(&t->buffer);
+            {
+                ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mInputNs);
+                t->bufferProvider->getNextBuffer(&t->buffer);
+            }
             t->frameCount = t->buffer.frameCount;
             t->mIn = t->buffer.raw;
         }
@@ -1470,6 +1663,7 @@ void AudioMixer::process__genericNoResampling()
                     }
                     size_t inFrames = (t->frameCount > outFrames)?outFrames:t->frameCount;
                     if (inFrames > 0) {
+                        ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mMixNs);
                         (t.get()->*t->hook)(
                                 outTemp + (frameCount - outFrames) * t->mMixerChannelCount,
                                 inFrames, mResampleTemp.get() /* naked ptr */, aux);
@@ -1483,7 +1677,10 @@ void AudioMixer::process__genericNoResampling()
                         t->bufferProvider->releaseBuffer(&t->buffer);
                         t->buffer.frameCount = (mFrameCount - numFrames) -
                                 (frameCount - outFrames);
-                        t->bufferProvider->getNextBuffer(&t->buffer);
+                        {
+                            ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mInputNs);
+                            t->bufferProvider->getNextBuffer(&t->buffer);
+                        }
                         t->mIn = t->buffer.raw;
                         if (t->mIn == nullptr) {
                             break;
@@ -1518,6 +1715,25 @@ void AudioMixer::process__genericResampling()
     int32_t * const outTemp = mOutputTemp.get(); // naked ptr
     size_t numFrames = mFrameCount;
 
+    // With resampler workers, first resample all tracks in parallel, then mix serially below.
+    // Tracks are independent, and each track's buffer provider is used by only one thread.
+    mResampleAhead.clear();
+    if (mResamplerWorkers.get() != nullptr) {
+        for (const int name : mEnabled) {
+            const std::shared_ptr<Track> &t = mTracks[name];
+            if (t->needs & NEEDS_RESAMPLE) {
+                mResampleAhead.push_back(t.get());
+            }
+        }
+        if (mResampleAhead.size() > 1) {
+            mResamplerWorkers->run(mResampleAhead.size(), [this, numFrames](size_t i) {
+                mResampleAhead[i]->resampleAhead(numFrames);
+            });
+        } else {
+            mResampleAhead.clear(); // nothing to gain, resample inline
+        }
+    }
+
     for (const auto &pair : mGroups) {
         const auto &group = pair.second;
         const std::shared_ptr<Track> &t1 = mTracks[group[0]];
@@ -1533,7 +1749,7 @@ void AudioMixer::process__genericResampling()
 
             // this is a little goofy, on the resampling case we don't
             // acquire/release the buffers because it's done by
-            // the resampler.
+            // the resampler. track__Resample() accounts its own time.
             if (t->needs & NEEDS_RESAMPLE) {
                 (t.get()->*t->hook)(outTemp, numFrames, mResampleTemp.get() /* naked ptr */, aux);
             } else {
@@ -1542,16 +1758,22 @@ void AudioMixer::process__genericResampling()
 
                 while (outFrames < numFrames) {
                     t->buffer.frameCount = numFrames - outFrames;
-                    t->bufferProvider->getNextBuffer(&t->buffer);
+                    {
+                        ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mInputNs);
+                        t->bufferProvider->getNextBuffer(&t->buffer);
+                    }
                     t->mIn = t->buffer.raw;
                     // t->mIn == nullptr can happen if the track was flushed just after having
                     // been enabled for mixing.
                     if (t->mIn == nullptr) break;
 
-                    (t.get()->*t->hook)(
-                            outTemp + outFrames * t->mMixerChannelCount, t->buffer.frameCount,
-                            mResampleTemp.get() /* naked ptr */,
-                            aux != nullptr ? aux + outFrames : nullptr);
+                    {
+                        ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mMixNs);
+                        (t.get()->*t->hook)(
+                                outTemp + outFrames * t->mMixerChannelCount, t->buffer.frameCount,
+                                mResampleTemp.get() /* naked ptr */,
+                                aux != nullptr ? aux + outFrames : nullptr);
+                    }
                     outFrames += t->buffer.frameCount;
 
                     t->bufferProvider->releaseBuffer(&t->buffer);
@@ -1561,6 +1783,9 @@ void AudioMixer::process__genericResampling()
         convertMixerFormat(t1->mainBuffer, t1->mMixerFormat,
                 outTemp, t1->mMixerInFormat, numFrames * t1->mMixerChannelCount);
     }
+    for (Track *t : mResampleAhead) {
+        t->mResampledAhead = false;
+    }
 }
 
 // one track, 16 bits stereo without resampling is the most common case
@@ -1759,39 +1984,52 @@ template <int MIXTYPE, bool USEFLOATVOL, bool ADJUSTVOL,
 void AudioMixer::Track::volumeMix(TO *out, size_t outFrames,
         const TI *in, TA *aux, bool ramp)
 {
+    const bool simd = mUseSimdMix && aux == NULL;
     if (USEFLOATVOL) {
         if (ramp) {
-            volumeRampMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
-                    mPrevVolume, mVolumeInc,
+            if (!(simd && volumeRampMultiSimd<MIXTYPE>(mMixerChannelCount, out, outFrames, in,
+                    mPrevVolume, mVolumeInc))) {
+                volumeRampMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
+                        mPrevVolume, mVolumeInc,
 #ifdef FLOAT_AUX
-                    &mPrevAuxLevel, mAuxInc
+                        &mPrevAuxLevel, mAuxInc
 #else
-                    &prevAuxLevel, auxInc
+                        &prevAuxLevel, auxInc
 #endif
-                );
+                    );
+            }
             if (ADJUSTVOL) {
                 adjustVolumeRamp(aux != NULL, true);
             }
         } else {
-            volumeMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
-                    mVolume,
+            if (!(simd && volumeMultiSimd<MIXTYPE>(mMixerChannelCount, out, outFrames, in,
+                    mVolume))) {
+                volumeMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
+                        mVolume,
 #ifdef FLOAT_AUX
-                    mAuxLevel
+                        mAuxLevel
 #else
-                    auxLevel
+                        auxLevel
 #endif
-            );
+                );
+            }
         }
     } else {
         if (ramp) {
-            volumeRampMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
-                    prevVolume, volumeInc, &prevAuxLevel, auxInc);
+            if (!(simd && volumeRampMultiSimd<MIXTYPE>(mMixerChannelCount, out, outFrames, in,
+                    prevVolume, volumeInc))) {
+                volumeRampMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
+                        prevVolume, volumeInc, &prevAuxLevel, auxInc);
+            }
             if (ADJUSTVOL) {
                 adjustVolumeRamp(aux != NULL);
             }
         } else {
-            volumeMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
-                    volume, auxLevel);
+            if (!(simd && volumeMultiSimd<MIXTYPE>(mMixerChannelCount, out, outFrames, in,
+                    volume))) {
+                volumeMulti<MIXTYPE>(mMixerChannelCount, out, outFrames, in, aux,
+                        volume, auxLevel);
+            }
         }
     }
 }
@@ -1821,7 +2059,10 @@ void AudioMixer::process__noResampleOneTrack()
         AudioBufferProvider::Buffer& b(t->buffer);
         // get input buffer
         b.frameCount = numFrames;
-        t->bufferProvider->getNextBuffer(&b);
+        {
+            ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mInputNs);
+            t->bufferProvider->getNextBuffer(&b);
+        }
         const TI *in = reinterpret_cast<TI*>(b.raw);
 
         // in == NULL can happen if the track was flushed just after having
@@ -1836,8 +2077,11 @@ void AudioMixer::process__noResampleOneTrack()
         }
 
         const size_t outFrames = b.frameCount;
-        t->volumeMix<MIXTYPE, is_same<TI, float>::value /* USEFLOATVOL */, false /* ADJUSTVOL */> (
-                out, outFrames, in, aux, ramp);
+        {
+            ScopedTrackTimer timer(t->mTimingEnabled, &t->mTiming.mMixNs);
+            t->volumeMix<MIXTYPE, is_same<TI, float>::value /* USEFLOATVOL */,
+                    false /* ADJUSTVOL */>(out, outFrames, in, aux, ramp);
+        }
 
         out += outFrames * channels;
         if (aux != NULL) {
@@ -1899,25 +2143,69 @@ template <int MIXTYPE, typename TO, typename TI, typename TA>
 void AudioMixer::Track::track__Resample(TO* out, size_t outFrameCount, TO* temp, TA* aux)
 {
     ALOGVV("track__Resample\n");
-    mResampler->setSampleRate(sampleRate);
     const bool ramp = needsRamp();
+    if (mResampledAhead) {
+        // resampleAhead() has already filled mResampleOut on a worker thread,
+        // with the same gain as below, so only the mix remains to be done.
+        TO *resampled = reinterpret_cast<TO*>(mResampleOut.get());
+        ScopedTrackTimer timer(mTimingEnabled, &mTiming.mMixNs);
+        if (ramp || aux != NULL) {
+            volumeMix<MIXTYPE, is_same<TI, float>::value /* USEFLOATVOL */, true /* ADJUSTVOL */>(
+                    out, outFrameCount, resampled, aux, ramp);
+        } else {
+            // the resampler accumulates, so adding its zero based output is bit-exact.
+            for (size_t i = 0; i < outFrameCount * mMixerChannelCount; ++i) {
+                out[i] += resampled[i];
+            }
+        }
+        return;
+    }
+    mResampler->setSampleRate(sampleRate);
     if (ramp || aux != NULL) {
         // if ramp:        resample with unity gain to temp buffer and scale/mix in 2nd step.
         // if aux != NULL: resample with unity gain to temp buffer then apply send level.
 
         mResampler->setVolume(UNITY_GAIN_FLOAT, UNITY_GAIN_FLOAT);
         memset(temp, 0, outFrameCount * mMixerChannelCount * sizeof(TO));
-        mResampler->resample((int32_t*)temp, outFrameCount, bufferProvider);
+        {
+            ScopedTrackTimer timer(mTimingEnabled, &mTiming.mResampleNs);
+            mResampler->resample((int32_t*)temp, outFrameCount, bufferProvider);
+        }
 
+        ScopedTrackTimer timer(mTimingEnabled, &mTiming.mMixNs);
         volumeMix<MIXTYPE, is_same<TI, float>::value /* USEFLOATVOL */, true /* ADJUSTVOL */>(
                 out, outFrameCount, temp, aux, ramp);
 
-    } else { // constant volume gain
+    } else { // constant volume gain, applied and accumulated by the resampler
         mResampler->setVolume(mVolume[0], mVolume[1]);
+        ScopedTrackTimer timer(mTimingEnabled, &mTiming.mResampleNs);
         mResampler->resample((int32_t*)out, outFrameCount, bufferProvider);
     }
 }
 
+/* Called on a resampler worker thread, see process__genericResampling().
+ * Resamples into mResampleOut with the gain that track__Resample() would use,
+ * so that track__Resample() only needs to mix on the mixer thread.
+ */
+void AudioMixer::Track::resampleAhead(size_t outFrameCount)
+{
+    ALOGVV("resampleAhead\n");
+    mResampler->setSampleRate(sampleRate);
+    if (needsRamp() || (needs & NEEDS_AUX) != 0) {
+        mResampler->setVolume(UNITY_GAIN_FLOAT, UNITY_GAIN_FLOAT);
+    } else {
+        mResampler->setVolume(mVolume[0], mVolume[1]);
+    }
+    // int32_t and float samples have the same size.
+    memset(mResampleOut.get(), 0, outFrameCount * mMixerChannelCount * sizeof(int32_t));
+    {
+        // written only by this worker until process__genericResampling() has rejoined.
+        ScopedTrackTimer timer(mTimingEnabled, &mTiming.mResampleNs);
+        mResampler->resample(mResampleOut.get(), outFrameCount, bufferProvider);
+    }
+    mResampledAhead = true;
+}
+
 /* This track hook is called to mix a track, when no resampling is required.
  * The input buffer should be present in in.
  *
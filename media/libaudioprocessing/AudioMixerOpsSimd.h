@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_OPS_SIMD_H
+#define ANDROID_AUDIO_MIXER_OPS_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioMixerOps.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#ifndef USE_NEON
+#define USE_NEON (false)
+#endif
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSSE3__)  // Should be supported in x86 ABI for both 32 & 64-bit.
+#ifndef USE_SSE
+#define USE_SSE (true)
+#endif
+#include <tmmintrin.h>
+#else
+#ifndef USE_SSE
+#define USE_SSE (false)
+#endif
+#endif
+
+#define USE_MIXER_SIMD (USE_NEON || USE_SSE)
+
+namespace android {
+
+/*
+ * Vectorized accumulate kernels for the MIXTYPE_MULTI case of the
+ * volumeRampMulti and volumeMulti functions in AudioMixerOps.h.
+ *
+ * volumeRampMultiSimd() and volumeMultiSimd() return true if the mix has been
+ * performed, or false if the caller must fall back to the scalar path.
+ * Only MIXTYPE_MULTI without an aux buffer is accelerated; as with the scalar
+ * version, a channel count above 2 uses only volume[0] (MIXTYPE_MULTI_MONOVOL).
+ *
+ * The results are bit-exact with the scalar functions: every sample is computed
+ * with the same multiply followed by the same add, and during a volume ramp the
+ * volume of each frame is obtained by the same sequence of increments.
+ *
+ * Loads and stores are unaligned, so only natural sample alignment is required.
+ */
+
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+inline bool volumeRampMultiSimd(uint32_t channels __unused, TO* out __unused,
+        size_t frameCount __unused, const TI* in __unused,
+        TV *vol __unused, const TV *volinc __unused)
+{
+    return false;
+}
+
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+inline bool volumeMultiSimd(uint32_t channels __unused, TO* out __unused,
+        size_t frameCount __unused, const TI* in __unused, const TV *vol __unused)
+{
+    return false;
+}
+
+#if USE_MIXER_SIMD
+
+// Minimal 4 lane vector layer, so that each kernel is written only once.
+#if USE_NEON
+
+typedef float32x4_t mixer_f32x4_t;
+typedef int32x4_t   mixer_i32x4_t;
+
+static inline mixer_f32x4_t mixer_ld_f32(const float *p) { return vld1q_f32(p); }
+static inline void mixer_st_f32(float *p, mixer_f32x4_t v) { vst1q_f32(p, v); }
+static inline mixer_f32x4_t mixer_dup_f32(float f) { return vdupq_n_f32(f); }
+static inline mixer_f32x4_t mixer_set_f32(float a, float b, float c, float d) {
+    const float f[4] = { a, b, c, d };
+    return vld1q_f32(f);
+}
+static inline mixer_f32x4_t mixer_add_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return vaddq_f32(a, b);
+}
+static inline mixer_f32x4_t mixer_mul_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return vmulq_f32(a, b);
+}
+// returns { v[2], v[3], v[2], v[3] }
+static inline mixer_f32x4_t mixer_duphi_f32(mixer_f32x4_t v) {
+    return vcombine_f32(vget_high_f32(v), vget_high_f32(v));
+}
+// returns { lo[0], lo[1], hi[2], hi[3] }
+static inline mixer_f32x4_t mixer_lohi_f32(mixer_f32x4_t lo, mixer_f32x4_t hi) {
+    return vcombine_f32(vget_low_f32(lo), vget_high_f32(hi));
+}
+
+static inline mixer_i32x4_t mixer_ld_i32(const int32_t *p) { return vld1q_s32(p); }
+static inline void mixer_st_i32(int32_t *p, mixer_i32x4_t v) { vst1q_s32(p, v); }
+static inline mixer_i32x4_t mixer_ld_i16(const int16_t *p) { return vmovl_s16(vld1_s16(p)); }
+static inline mixer_i32x4_t mixer_dup_i32(int32_t i) { return vdupq_n_s32(i); }
+static inline mixer_i32x4_t mixer_set_i32(int32_t a, int32_t b, int32_t c, int32_t d) {
+    const int32_t i[4] = { a, b, c, d };
+    return vld1q_s32(i);
+}
+static inline mixer_i32x4_t mixer_add_i32(mixer_i32x4_t a, mixer_i32x4_t b) {
+    return vaddq_s32(a, b);
+}
+static inline mixer_i32x4_t mixer_shr16_i32(mixer_i32x4_t v) { return vshrq_n_s32(v, 16); }
+// both a and b must hold values in int16_t range
+static inline mixer_i32x4_t mixer_mul16_i32(mixer_i32x4_t a, mixer_i32x4_t b) {
+    return vmulq_s32(a, b);
+}
+
+#else // USE_SSE
+
+typedef __m128  mixer_f32x4_t;
+typedef __m128i mixer_i32x4_t;
+
+static inline mixer_f32x4_t mixer_ld_f32(const float *p) { return _mm_loadu_ps(p); }
+static inline void mixer_st_f32(float *p, mixer_f32x4_t v) { _mm_storeu_ps(p, v); }
+static inline mixer_f32x4_t mixer_dup_f32(float f) { return _mm_set1_ps(f); }
+static inline mixer_f32x4_t mixer_set_f32(float a, float b, float c, float d) {
+    return _mm_setr_ps(a, b, c, d);
+}
+static inline mixer_f32x4_t mixer_add_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return _mm_add_ps(a, b);
+}
+static inline mixer_f32x4_t mixer_mul_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return _mm_mul_ps(a, b);
+}
+// returns { v[2], v[3], v[2], v[3] }
+static inline mixer_f32x4_t mixer_duphi_f32(mixer_f32x4_t v) { return _mm_movehl_ps(v, v); }
+// returns { lo[0], lo[1], hi[2], hi[3] }
+static inline mixer_f32x4_t mixer_lohi_f32(mixer_f32x4_t lo, mixer_f32x4_t hi) {
+    return _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 2, 1, 0));
+}
+
+static inline mixer_i32x4_t mixer_ld_i32(const int32_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+static inline void mixer_st_i32(int32_t *p, mixer_i32x4_t v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+static inline mixer_i32x4_t mixer_ld_i16(const int16_t *p) {
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+static inline mixer_i32x4_t mixer_dup_i32(int32_t i) { return _mm_set1_epi32(i); }
+static inline mixer_i32x4_t mixer_set_i32(int32_t a, int32_t b, int32_t c, int32_t d) {
+    return _mm_setr_epi32(a, b, c, d);
+}
+static inline mixer_i32x4_t mixer_add_i32(mixer_i32x4_t a, mixer_i32x4_t b) {
+    return _mm_add_epi32(a, b);
+}
+static inline mixer_i32x4_t mixer_shr16_i32(mixer_i32x4_t v) { return _mm_srai_epi32(v, 16); }
+// both a and b must hold values in int16_t range.
+// The lanes of a are sign extended, so masking the upper half of b makes
+// _mm_madd_epi16() return the 16x16 bit signed product in each 32 bit lane.
+static inline mixer_i32x4_t mixer_mul16_i32(mixer_i32x4_t a, mixer_i32x4_t b) {
+    return _mm_madd_epi16(a, _mm_and_si128(b, _mm_set1_epi32(0xffff)));
+}
+
+#endif // USE_NEON
+
+// float stereo, per channel volume ramp. Two frames per vector.
+static inline void mixerRampStereo(float *out, size_t frameCount, const float *in,
+        float *vol, const float *volinc)
+{
+    const mixer_f32x4_t inc = mixer_set_f32(volinc[0], volinc[1], volinc[0], volinc[1]);
+    mixer_f32x4_t v = mixer_set_f32(vol[0], vol[1], vol[0] + volinc[0], vol[1] + volinc[1]);
+    for (; frameCount >= 2; frameCount -= 2) {
+        mixer_st_f32(out, mixer_add_f32(mixer_ld_f32(out),
+                mixer_mul_f32(mixer_ld_f32(in), v)));
+        out += 4;
+        in += 4;
+        // advance one frame at a time to match the scalar rounding.
+        const mixer_f32x4_t next = mixer_add_f32(mixer_duphi_f32(v), inc);
+        v = mixer_lohi_f32(next, mixer_add_f32(next, inc));
+    }
+    float lanes[4];
+    mixer_st_f32(lanes, v);
+    vol[0] = lanes[0];
+    vol[1] = lanes[1];
+    if (frameCount != 0) {
+        for (int i = 0; i < 2; ++i) {
+            *out++ += MixMul<float, float, float>(*in++, vol[i]);
+            vol[i] += volinc[i];
+        }
+    }
+}
+
+// float stereo, constant per channel volume. Two frames per vector.
+static inline void mixerStereo(float *out, size_t frameCount, const float *in,
+        const float *vol)
+{
+    const mixer_f32x4_t v = mixer_set_f32(vol[0], vol[1], vol[0], vol[1]);
+    for (; frameCount >= 2; frameCount -= 2) {
+        mixer_st_f32(out, mixer_add_f32(mixer_ld_f32(out),
+                mixer_mul_f32(mixer_ld_f32(in), v)));
+        out += 4;
+        in += 4;
+    }
+    if (frameCount != 0) {
+        for (int i = 0; i < 2; ++i) {
+            *out++ += MixMul<float, float, float>(*in++, vol[i]);
+        }
+    }
+}
+
+// float multichannel, volume[0] ramp. One frame at a time, 4 channels per vector.
+static inline void mixerRampMonoVol(uint32_t channels, float *out, size_t frameCount,
+        const float *in, float *vol, const float *volinc)
+{
+    do {
+        const mixer_f32x4_t v = mixer_dup_f32(vol[0]);
+        uint32_t i = 0;
+        for (; i + 4 <= channels; i += 4) {
+            mixer_st_f32(out, mixer_add_f32(mixer_ld_f32(out),
+                    mixer_mul_f32(mixer_ld_f32(in), v)));
+            out += 4;
+            in += 4;
+        }
+        for (; i < channels; ++i) {
+            *out++ += MixMul<float, float, float>(*in++, vol[0]);
+        }
+        vol[0] += volinc[0];
+    } while (--frameCount);
+}
+
+// float mono or multichannel, constant volume[0]. Frames are contiguous.
+static inline void mixerMonoVol(uint32_t channels, float *out, size_t frameCount,
+        const float *in, const float *vol)
+{
+    const mixer_f32x4_t v = mixer_dup_f32(vol[0]);
+    size_t samples = frameCount * channels;
+    for (; samples >= 4; samples -= 4) {
+        mixer_st_f32(out, mixer_add_f32(mixer_ld_f32(out),
+                mixer_mul_f32(mixer_ld_f32(in), v)));
+        out += 4;
+        in += 4;
+    }
+    for (; samples > 0; --samples) {
+        *out++ += MixMul<float, float, float>(*in++, vol[0]);
+    }
+}
+
+// int16_t stereo, U4.28 per channel volume ramp. Two frames per vector.
+static inline void mixerRampStereo(int32_t *out, size_t frameCount, const int16_t *in,
+        int32_t *vol, const int32_t *volinc)
+{
+    // Integer addition is exact, so two frames of increment can be added at once.
+    const mixer_i32x4_t inc = mixer_set_i32(volinc[0] * 2, volinc[1] * 2,
+            volinc[0] * 2, volinc[1] * 2);
+    mixer_i32x4_t v = mixer_set_i32(vol[0], vol[1], vol[0] + volinc[0], vol[1] + volinc[1]);
+    for (; frameCount >= 2; frameCount -= 2) {
+        mixer_st_i32(out, mixer_add_i32(mixer_ld_i32(out),
+                mixer_mul16_i32(mixer_ld_i16(in), mixer_shr16_i32(v))));
+        out += 4;
+        in += 4;
+        v = mixer_add_i32(v, inc);
+    }
+    int32_t lanes[4];
+    mixer_st_i32(lanes, v);
+    vol[0] = lanes[0];
+    vol[1] = lanes[1];
+    if (frameCount != 0) {
+        for (int i = 0; i < 2; ++i) {
+            *out++ += MixMul<int32_t, int16_t, int32_t>(*in++, vol[i]);
+            vol[i] += volinc[i];
+        }
+    }
+}
+
+// int16_t stereo, constant U4.12 per channel volume. Two frames per vector.
+static inline void mixerStereo(int32_t *out, size_t frameCount, const int16_t *in,
+        const int16_t *vol)
+{
+    const mixer_i32x4_t v = mixer_set_i32(vol[0], vol[1], vol[0], vol[1]);
+    for (; frameCount >= 2; frameCount -= 2) {
+        mixer_st_i32(out, mixer_add_i32(mixer_ld_i32(out),
+                mixer_mul16_i32(mixer_ld_i16(in), v)));
+        out += 4;
+        in += 4;
+    }
+    if (frameCount != 0) {
+        for (int i = 0; i < 2; ++i) {
+            *out++ += MixMul<int32_t, int16_t, int16_t>(*in++, vol[i]);
+        }
+    }
+}
+
+// int16_t multichannel, U4.28 volume[0] ramp. One frame at a time, 4 channels per vector.
+static inline void mixerRampMonoVol(uint32_t channels, int32_t *out, size_t frameCount,
+        const int16_t *in, int32_t *vol, const int32_t *volinc)
+{
+    do {
+        const mixer_i32x4_t v = mixer_dup_i32(vol[0] >> 16);
+        uint32_t i = 0;
+        for (; i + 4 <= channels; i += 4) {
+            mixer_st_i32(out, mixer_add_i32(mixer_ld_i32(out),
+                    mixer_mul16_i32(mixer_ld_i16(in), v)));
+            out += 4;
+            in += 4;
+        }
+        for (; i < channels; ++i) {
+            *out++ += MixMul<int32_t, int16_t, int32_t>(*in++, vol[0]);
+        }
+        vol[0] += volinc[0];
+    } while (--frameCount);
+}
+
+// int16_t mono or multichannel, constant U4.12 volume[0]. Frames are contiguous.
+static inline void mixerMonoVol(uint32_t channels, int32_t *out, size_t frameCount,
+        const int16_t *in, const int16_t *vol)
+{
+    const mixer_i32x4_t v = mixer_dup_i32(vol[0]);
+    size_t samples = frameCount * channels;
+    for (; samples >= 4; samples -= 4) {
+        mixer_st_i32(out, mixer_add_i32(mixer_ld_i32(out),
+                mixer_mul16_i32(mixer_ld_i16(in), v)));
+        out += 4;
+        in += 4;
+    }
+    for (; samples > 0; --samples) {
+        *out++ += MixMul<int32_t, int16_t, int16_t>(*in++, vol[0]);
+    }
+}
+
+// A ramp on fewer than 4 channels per frame (other than stereo) is left to the scalar path.
+template <>
+inline bool volumeRampMultiSimd<MIXTYPE_MULTI, float, float, float>(uint32_t channels,
+        float* out, size_t frameCount, const float* in, float *vol, const float *volinc)
+{
+    if (channels == 2) {
+        mixerRampStereo(out, frameCount, in, vol, volinc);
+        return true;
+    } else if (channels >= 4) {
+        mixerRampMonoVol(channels, out, frameCount, in, vol, volinc);
+        return true;
+    }
+    return false;
+}
+
+template <>
+inline bool volumeRampMultiSimd<MIXTYPE_MULTI, int32_t, int16_t, int32_t>(uint32_t channels,
+        int32_t* out, size_t frameCount, const int16_t* in, int32_t *vol, const int32_t *volinc)
+{
+    if (channels == 2) {
+        mixerRampStereo(out, frameCount, in, vol, volinc);
+        return true;
+    } else if (channels >= 4) {
+        mixerRampMonoVol(channels, out, frameCount, in, vol, volinc);
+        return true;
+    }
+    return false;
+}
+
+template <>
+inline bool volumeMultiSimd<MIXTYPE_MULTI, float, float, float>(uint32_t channels,
+        float* out, size_t frameCount, const float* in, const float *vol)
+{
+    if (channels == 2) {
+        mixerStereo(out, frameCount, in, vol);
+    } else {
+        mixerMonoVol(channels, out, frameCount, in, vol);
+    }
+    return true;
+}
+
+template <>
+inline bool volumeMultiSimd<MIXTYPE_MULTI, int32_t, int16_t, int16_t>(uint32_t channels,
+        int32_t* out, size_t frameCount, const int16_t* in, const int16_t *vol)
+{
+    if (channels == 2) {
+        mixerStereo(out, frameCount, in, vol);
+    } else {
+        mixerMonoVol(channels, out, frameCount, in, vol);
+    }
+    return true;
+}
+
+#endif // USE_MIXER_SIMD
+
+} // namespace android
+
+#endif /* ANDROID_AUDIO_MIXER_OPS_SIMD_H */
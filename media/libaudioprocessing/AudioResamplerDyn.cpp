@@ -604,13 +604,50 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
             break;
         }
     }
+    // prefer a specialization for the common filter lengths, if there is one.
+    resample_ABP_t fixedLengthFunc = NULL;
+    if (mChannelCount == 1) {
+        fixedLengthFunc = locked
+                ? getFixedLengthResampleFunc<1, true>(c.mHalfNumCoefs)
+                : getFixedLengthResampleFunc<1, false>(c.mHalfNumCoefs);
+    } else if (mChannelCount == 2) {
+        fixedLengthFunc = locked
+                ? getFixedLengthResampleFunc<2, true>(c.mHalfNumCoefs)
+                : getFixedLengthResampleFunc<2, false>(c.mHalfNumCoefs);
+    }
+    if (fixedLengthFunc != NULL) {
+        mResampleFunc = fixedLengthFunc;
+    }
 #ifdef DEBUG_RESAMPLER
-    printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d\n",
+    printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d  %s\n",
             mChannelCount, locked ? "locked" : "interpolated",
-            stride, useS32 ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift);
+            stride, useS32 ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift,
+            fixedLengthFunc != NULL ? "fixed length" : "");
 #endif
 }
 
+// Filter half lengths resulting from the most common conversions, see setSampleRate():
+//    32: any rate to 48000 Hz and above (ro.audio.resampler.psd defaults).
+//    40: 48000 Hz to 16000 Hz, DYN_MED_QUALITY.
+//    56: 48000 Hz to 16000 Hz, DYN_HIGH_QUALITY.
+// Specializations are limited to mono and stereo to bound the code size.
+template<typename TC, typename TI, typename TO>
+template<int CHANNELS, bool LOCKED>
+typename AudioResamplerDyn<TC, TI, TO>::resample_ABP_t
+AudioResamplerDyn<TC, TI, TO>::getFixedLengthResampleFunc(int halfNumCoefs)
+{
+    switch (halfNumCoefs) {
+    case 32:
+        return &AudioResamplerDyn<TC, TI, TO>::resample<CHANNELS, LOCKED, 16, 32>;
+    case 40:
+        return &AudioResamplerDyn<TC, TI, TO>::resample<CHANNELS, LOCKED, 16, 40>;
+    case 56:
+        return &AudioResamplerDyn<TC, TI, TO>::resample<CHANNELS, LOCKED, 16, 56>;
+    default:
+        return NULL;
+    }
+}
+
 template<typename TC, typename TI, typename TO>
 size_t AudioResamplerDyn<TC, TI, TO>::resample(int32_t* out, size_t outFrameCount,
             AudioBufferProvider* provider)
@@ -619,13 +656,15 @@ size_t AudioResamplerDyn<TC, TI, TO>::resample(int32_t* out, size_t outFrameCoun
 }
 
 template<typename TC, typename TI, typename TO>
-template<int CHANNELS, bool LOCKED, int STRIDE>
+template<int CHANNELS, bool LOCKED, int STRIDE, int HALFNUMCOEFS>
 size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
         AudioBufferProvider* provider)
 {
     // TODO Mono -> Mono is not supported. OUTPUT_CHANNELS reflects minimum of stereo out.
     const int OUTPUT_CHANNELS = (CHANNELS < 2) ? 2 : CHANNELS;
     const Constants& c(mConstants);
+    const int halfNumCoefs = HALFNUMCOEFS != 0 ? HALFNUMCOEFS : c.mHalfNumCoefs;
+    ALOG_ASSERT(halfNumCoefs == c.mHalfNumCoefs);
     const TC* const coefs = mConstants.mFirCoefs;
     TI* impulse = mInBuffer.getImpulse();
     size_t inputIndex = 0;
@@ -672,7 +711,7 @@ size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
             inFrameCount -= mBuffer.frameCount;
             if (phaseFraction >= phaseWrapLimit) { // read in data
                 mInBuffer.template readAdvance<CHANNELS>(
-                        impulse, c.mHalfNumCoefs,
+                        impulse, halfNumCoefs,
                         reinterpret_cast<TI*>(mBuffer.raw), inputIndex);
                 inputIndex++;
                 phaseFraction -= phaseWrapLimit;
@@ -683,7 +722,7 @@ size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
                         break;
                     }
                     mInBuffer.template readAdvance<CHANNELS>(
-                            impulse, c.mHalfNumCoefs,
+                            impulse, halfNumCoefs,
                             reinterpret_cast<TI*>(mBuffer.raw), inputIndex);
                     inputIndex++;
                     phaseFraction -= phaseWrapLimit;
@@ -693,7 +732,6 @@ size_t AudioResamplerDyn<TC, TI, TO>::resample(TO* out, size_t outFrameCount,
         const TI* const in = reinterpret_cast<const TI*>(mBuffer.raw);
         const size_t frameCount = mBuffer.frameCount;
         const int coefShift = c.mShift;
-        const int halfNumCoefs = c.mHalfNumCoefs;
         const TO* const volumeSimd = mVolumeSimd;
 
         // main processing loop
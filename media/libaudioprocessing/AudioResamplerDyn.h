@@ -152,13 +152,20 @@ private:
 
     void createKaiserFir(Constants &c, double stopBandAtten, double fcr);
 
-    template<int CHANNELS, bool LOCKED, int STRIDE>
+    // HALFNUMCOEFS is the filter half length if fixed at compile time, or 0 to use
+    // mConstants.mHalfNumCoefs. A compile time half length gives the FIR dot product
+    // a constant trip count and constant polyphase offsets.
+    template<int CHANNELS, bool LOCKED, int STRIDE, int HALFNUMCOEFS = 0>
     size_t resample(TO* out, size_t outFrameCount, AudioBufferProvider* provider);
 
     // define a pointer to member function type for resample
     typedef size_t (AudioResamplerDyn<TC, TI, TO>::*resample_ABP_t)(TO* out,
             size_t outFrameCount, AudioBufferProvider* provider);
 
+    // Returns a resample function specialized for the filter half length, or NULL.
+    template<int CHANNELS, bool LOCKED>
+    static resample_ABP_t getFixedLengthResampleFunc(int halfNumCoefs);
+
     // data - the contiguous storage and layout of these is important.
            InBuffer mInBuffer;
           Constants mConstants;        // current set of coefficient parameters
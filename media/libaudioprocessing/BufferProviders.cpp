@@ -31,6 +31,8 @@
 #include <system/audio_effects/effect_downmix.h>
 #include <utils/Log.h>
 
+#include "FormatConvertSimd.h"
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
 #endif
@@ -380,6 +382,10 @@ ReformatBufferProvider::ReformatBufferProvider(int32_t channelCount,
 
 void ReformatBufferProvider::copyFrames(void *dst, const void *src, size_t frames)
 {
+    if (mInputFormat == AUDIO_FORMAT_PCM_FLOAT && mOutputFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        convertToI16FromFloat((int16_t *)dst, (const float *)src, frames * mChannelCount);
+        return;
+    }
     memcpy_by_audio_format(dst, mOutputFormat, src, mInputFormat, frames * mChannelCount);
 }
 
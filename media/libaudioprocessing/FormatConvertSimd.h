@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_FORMAT_CONVERT_SIMD_H
+#define ANDROID_AUDIO_FORMAT_CONVERT_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <audio_utils/primitives.h>
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#ifndef USE_NEON
+#define USE_NEON (false)
+#endif
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSSE3__)  // Should be supported in x86 ABI for both 32 & 64-bit.
+#ifndef USE_SSE
+#define USE_SSE (true)
+#endif
+#include <tmmintrin.h>
+#else
+#ifndef USE_SSE
+#define USE_SSE (false)
+#endif
+#endif
+
+namespace android {
+
+/*
+ * Vectorized sample format conversions for the capture path, see RecordBufferConverter.
+ *
+ * Each function converts the whole buffer, with a scalar tail, and is bit-exact with
+ * the audio_utils primitives named in its comment. dst may equal src where noted,
+ * otherwise the buffers must not overlap. Only natural sample alignment is required.
+ */
+
+// The float to int16 conversion uses the same method as clamp16_from_float(): adding
+// the offset moves the valid range into the 16 lsbs of the significand, and the float
+// representation as an integer is ordered, so it can be clamped with integer compares.
+constexpr float   kI16FromFloatOffset = 384.f;              // (float)(3 << (22 - 15))
+constexpr int32_t kI16FromFloatZero = 0x43c00000;           // kI16FromFloatOffset as int32_t
+constexpr int32_t kI16FromFloatLimNeg = kI16FromFloatZero - 32768;
+constexpr int32_t kI16FromFloatLimPos = kI16FromFloatZero + 32767;
+
+// Same as memcpy_to_i16_from_float(). dst may equal src.
+inline void convertToI16FromFloat(int16_t *dst, const float *src, size_t count)
+{
+#if USE_NEON
+    const float32x4_t offset = vdupq_n_f32(kI16FromFloatOffset);
+    const int32x4_t limneg = vdupq_n_s32(kI16FromFloatLimNeg);
+    const int32x4_t limpos = vdupq_n_s32(kI16FromFloatLimPos);
+    for (; count >= 8; count -= 8) {
+        int32x4_t lo = vreinterpretq_s32_f32(vaddq_f32(vld1q_f32(src), offset));
+        int32x4_t hi = vreinterpretq_s32_f32(vaddq_f32(vld1q_f32(src + 4), offset));
+        src += 8;
+        lo = vminq_s32(vmaxq_s32(lo, limneg), limpos);
+        hi = vminq_s32(vmaxq_s32(hi, limneg), limpos);
+        // the lower 16 bits are the result.
+        vst1q_s16(dst, vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+        dst += 8;
+    }
+#elif USE_SSE
+    const __m128 offset = _mm_set1_ps(kI16FromFloatOffset);
+    const __m128i zero = _mm_set1_epi32(kI16FromFloatZero);
+    const __m128i limneg = _mm_set1_epi32(kI16FromFloatLimNeg);
+    const __m128i limpos = _mm_set1_epi32(kI16FromFloatLimPos);
+    const auto clamp = [&](__m128i v) {
+        const __m128i lt = _mm_cmplt_epi32(v, limneg);
+        v = _mm_or_si128(_mm_and_si128(lt, limneg), _mm_andnot_si128(lt, v));
+        const __m128i gt = _mm_cmpgt_epi32(v, limpos);
+        v = _mm_or_si128(_mm_and_si128(gt, limpos), _mm_andnot_si128(gt, v));
+        return _mm_sub_epi32(v, zero); // now within the int16_t range.
+    };
+    for (; count >= 8; count -= 8) {
+        const __m128i lo = _mm_castps_si128(_mm_add_ps(_mm_loadu_ps(src), offset));
+        const __m128i hi = _mm_castps_si128(_mm_add_ps(_mm_loadu_ps(src + 4), offset));
+        src += 8;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                _mm_packs_epi32(clamp(lo), clamp(hi)));
+        dst += 8;
+    }
+#endif
+    for (; count > 0; --count) {
+        *dst++ = clamp16_from_float(*src++);
+    }
+}
+
+// Same as memcpy_to_float_from_i16() followed by downmix_to_mono_float_from_stereo_float().
+// The sum of two int16_t samples scaled by 2^-16 is exact, as is each step of the scalar path.
+inline void downmixToMonoFloatFromStereoI16(float *dst, const int16_t *src, size_t frames)
+{
+    constexpr float kScale = 1.f / (1 << 16);
+#if USE_NEON
+    const float32x4_t scale = vdupq_n_f32(kScale);
+    for (; frames >= 8; frames -= 8) {
+        const int16x8x2_t lr = vld2q_s16(src);
+        src += 16;
+        const int32x4_t lo = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+        const int32x4_t hi = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+        vst1q_f32(dst, vmulq_f32(vcvtq_f32_s32(lo), scale));
+        vst1q_f32(dst + 4, vmulq_f32(vcvtq_f32_s32(hi), scale));
+        dst += 8;
+    }
+#elif USE_SSE
+    const __m128 scale = _mm_set1_ps(kScale);
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; frames >= 4; frames -= 4) {
+        // multiply-add of adjacent samples by 1 sums each frame into int32_t.
+        const __m128i sum = _mm_madd_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), ones);
+        src += 8;
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(sum), scale));
+        dst += 4;
+    }
+#endif
+    for (; frames > 0; --frames) {
+        *dst++ = (int32_t{src[0]} + src[1]) * kScale;
+        src += 2;
+    }
+}
+
+// Same as downmixToMonoFloatFromStereoI16() followed by memcpy_to_i16_from_float().
+// The halved sum is rounded to nearest even, as clamp16_from_float() does, and cannot clip.
+inline void downmixToMonoI16FromStereoI16(int16_t *dst, const int16_t *src, size_t frames)
+{
+#if USE_NEON
+    const int32x4_t one = vdupq_n_s32(1);
+    const auto halve = [&](int32x4_t sum) {
+        const int32x4_t floor = vshrq_n_s32(sum, 1);
+        return vmovn_s32(vaddq_s32(floor, vandq_s32(vandq_s32(sum, floor), one)));
+    };
+    for (; frames >= 8; frames -= 8) {
+        const int16x8x2_t lr = vld2q_s16(src);
+        src += 16;
+        const int32x4_t lo = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+        const int32x4_t hi = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+        vst1q_s16(dst, vcombine_s16(halve(lo), halve(hi)));
+        dst += 8;
+    }
+#elif USE_SSE
+    const __m128i ones16 = _mm_set1_epi16(1);
+    const __m128i one = _mm_set1_epi32(1);
+    const auto halve = [&](__m128i sum) {
+        const __m128i floor = _mm_srai_epi32(sum, 1);
+        return _mm_add_epi32(floor, _mm_and_si128(_mm_and_si128(sum, floor), one));
+    };
+    for (; frames >= 8; frames -= 8) {
+        const __m128i lo = _mm_madd_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), ones16);
+        const __m128i hi = _mm_madd_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 8)), ones16);
+        src += 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packs_epi32(halve(lo), halve(hi)));
+        dst += 8;
+    }
+#endif
+    for (; frames > 0; --frames) {
+        const int32_t sum = int32_t{src[0]} + src[1];
+        const int32_t floor = sum >> 1;
+        *dst++ = floor + (sum & floor & 1);
+        src += 2;
+    }
+}
+
+} // namespace android
+
+#endif // ANDROID_AUDIO_FORMAT_CONVERT_SIMD_H
@@ -25,6 +25,8 @@
 #include <media/RecordBufferConverter.h>
 #include <utils/Log.h>
 
+#include "FormatConvertSimd.h"
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
 #endif
@@ -37,6 +39,17 @@ static inline T max(const T& a, const T& b)
 
 namespace android {
 
+// memcpy_by_audio_format() from float, with the common conversion to int16 vectorized.
+static void memcpy_by_audio_format_from_float(void *dst, audio_format_t dstFormat,
+        const void *src, size_t count)
+{
+    if (dstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+        convertToI16FromFloat((int16_t *)dst, (const float *)src, count);
+    } else {
+        memcpy_by_audio_format(dst, dstFormat, src, AUDIO_FORMAT_PCM_FLOAT, count);
+    }
+}
+
 RecordBufferConverter::RecordBufferConverter(
         audio_channel_mask_t srcChannelMask, audio_format_t srcFormat,
         uint32_t srcSampleRate,
@@ -55,6 +68,7 @@ RecordBufferConverter::RecordBufferConverter(
             mResampler(NULL),
             mIsLegacyDownmix(false),
             mIsLegacyUpmix(false),
+            mIsFusedDownmix(false),
             mRequiresFloat(false),
             mInputConverterProvider(NULL)
 {
@@ -185,14 +199,22 @@ status_t RecordBufferConverter::updateParameters(
                    && (mDstChannelMask == AUDIO_CHANNEL_IN_STEREO
                             || mDstChannelMask == AUDIO_CHANNEL_IN_FRONT_BACK);
 
+    // can we downmix int16 directly into the destination, without format converting first?
+    mIsFusedDownmix = mIsLegacyDownmix && mResampler == NULL
+            && mSrcFormat == AUDIO_FORMAT_PCM_16_BIT
+            && (mDstFormat == AUDIO_FORMAT_PCM_16_BIT || mDstFormat == AUDIO_FORMAT_PCM_FLOAT);
+
     // do we need to process in float?
-    mRequiresFloat = mResampler != NULL || mIsLegacyDownmix || mIsLegacyUpmix;
+    mRequiresFloat = mResampler != NULL
+            || (mIsLegacyDownmix && !mIsFusedDownmix) || mIsLegacyUpmix;
 
     // do we need a staging buffer to convert for destination (we can still optimize this)?
     // we use mBufFrameSize > 0 to indicate both frame size as well as buffer necessity
     if (mResampler != NULL) {
         mBufFrameSize = max(mSrcChannelCount, (uint32_t)FCC_2)
                 * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
+    } else if (mIsFusedDownmix) {
+        mBufFrameSize = 0;
     } else if (mIsLegacyUpmix || mIsLegacyDownmix) { // legacy modes always float
         mBufFrameSize = mDstChannelCount * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
     } else if (mSrcChannelMask != mDstChannelMask && mDstFormat != mSrcFormat) {
@@ -224,7 +246,16 @@ status_t RecordBufferConverter::updateParameters(
 void RecordBufferConverter::convertNoResampler(
         void *dst, const void *src, size_t frames)
 {
-    // src is native type unless there is legacy upmix or downmix, whereupon it is float.
+    // src is native type unless there is legacy upmix or downmix, whereupon it is float,
+    // except for the fused downmix which takes int16.
+    if (mIsFusedDownmix) {
+        if (mDstFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            downmixToMonoFloatFromStereoI16((float *)dst, (const int16_t *)src, frames);
+        } else {
+            downmixToMonoI16FromStereoI16((int16_t *)dst, (const int16_t *)src, frames);
+        }
+        return;
+    }
     if (mBufFrameSize != 0 && mBufFrames < frames) {
         free(mBuf);
         mBufFrames = frames;
@@ -241,8 +272,7 @@ void RecordBufferConverter::convertNoResampler(
                     (const float *)src, frames);
         }
         if (mBuf != NULL) {
-            memcpy_by_audio_format(dst, mDstFormat, mBuf, AUDIO_FORMAT_PCM_FLOAT,
-                    frames * mDstChannelCount);
+            memcpy_by_audio_format_from_float(dst, mDstFormat, mBuf, frames * mDstChannelCount);
         }
         return;
     }
@@ -257,8 +287,12 @@ void RecordBufferConverter::convertNoResampler(
     }
     // convert to destination buffer
     const void *convertBuf = mBuf != NULL ? mBuf : src;
-    memcpy_by_audio_format(dst, mDstFormat, convertBuf, mSrcFormat,
-            frames * mDstChannelCount);
+    if (mSrcFormat == AUDIO_FORMAT_PCM_FLOAT) {
+        memcpy_by_audio_format_from_float(dst, mDstFormat, convertBuf, frames * mDstChannelCount);
+    } else {
+        memcpy_by_audio_format(dst, mDstFormat, convertBuf, mSrcFormat,
+                frames * mDstChannelCount);
+    }
 }
 
 void RecordBufferConverter::convertResampler(
@@ -282,8 +316,7 @@ void RecordBufferConverter::convertResampler(
         }
         // convert to destination format (in place, OK as float is larger than other types)
         if (mDstFormat != AUDIO_FORMAT_PCM_FLOAT) {
-            memcpy_by_audio_format(src, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
-                    frames * mSrcChannelCount);
+            memcpy_by_audio_format_from_float(src, mDstFormat, src, frames * mSrcChannelCount);
         }
         // channel convert and save to dst
         memcpy_by_index_array(dst, mDstChannelCount,
@@ -291,8 +324,7 @@ void RecordBufferConverter::convertResampler(
         return;
     }
     // convert to destination format and save to dst
-    memcpy_by_audio_format(dst, mDstFormat, src, AUDIO_FORMAT_PCM_FLOAT,
-            frames * mDstChannelCount);
+    memcpy_by_audio_format_from_float(dst, mDstFormat, src, frames * mDstChannelCount);
 }
 
 // ----------------------------------------------------------------------------
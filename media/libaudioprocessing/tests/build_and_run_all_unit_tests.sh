@@ -18,6 +18,8 @@ adb push $OUT/system/lib/libaudioprocessing.so /system/lib
 adb push $OUT/system/lib64/libaudioprocessing.so /system/lib64
 adb push $OUT/data/nativetest/resampler_tests/resampler_tests /data/nativetest/resampler_tests/resampler_tests
 adb push $OUT/data/nativetest64/resampler_tests/resampler_tests /data/nativetest64/resampler_tests/resampler_tests
+adb push $OUT/data/nativetest/mixerops_tests/mixerops_tests /data/nativetest/mixerops_tests/mixerops_tests
+adb push $OUT/data/nativetest64/mixerops_tests/mixerops_tests /data/nativetest64/mixerops_tests/mixerops_tests
 
 sh $ANDROID_BUILD_TOP/frameworks/av/media/libaudioprocessing/tests/run_all_unit_tests.sh
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_formatconvert_tests"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <audio_utils/primitives.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include "../FormatConvertSimd.h"
+
+using namespace android;
+
+static const size_t kFrames[] = { 0, 1, 3, 7, 8, 9, 16, 17, 64, 257 };
+
+static void fill(std::vector<int16_t> &v) {
+    for (auto &i : v) i = (int16_t)rand();
+    if (v.size() >= 2) {
+        v[0] = v[1] = INT16_MIN; // largest magnitude sum
+    }
+}
+
+TEST(audioflinger_formatconvert, i16_from_float_bit_exact) {
+    for (size_t count : kFrames) {
+        std::vector<float> in(count);
+        for (size_t i = 0; i < count; ++i) {
+            // include out of range values, which must be clamped.
+            in[i] = (rand() - RAND_MAX / 2) * (3.f / RAND_MAX);
+        }
+        if (count > 2) {
+            in[1] = INFINITY;
+            in[2] = -INFINITY;
+        }
+        std::vector<int16_t> ref(count);
+        std::vector<int16_t> out(count);
+        memcpy_to_i16_from_float(ref.data(), in.data(), count);
+        convertToI16FromFloat(out.data(), in.data(), count);
+        EXPECT_EQ(0, memcmp(ref.data(), out.data(), count * sizeof(int16_t)))
+                << "count " << count;
+
+        // in place, as RecordBufferConverter::convertResampler() does.
+        convertToI16FromFloat(reinterpret_cast<int16_t *>(in.data()), in.data(), count);
+        EXPECT_EQ(0, memcmp(ref.data(), in.data(), count * sizeof(int16_t)))
+                << "in place count " << count;
+    }
+}
+
+TEST(audioflinger_formatconvert, mono_float_from_stereo_i16_bit_exact) {
+    for (size_t frames : kFrames) {
+        std::vector<int16_t> in(frames * 2);
+        fill(in);
+        std::vector<float> ref(frames * 2);
+        std::vector<float> out(frames);
+        memcpy_to_float_from_i16(ref.data(), in.data(), frames * 2);
+        downmix_to_mono_float_from_stereo_float(ref.data(), ref.data(), frames);
+        downmixToMonoFloatFromStereoI16(out.data(), in.data(), frames);
+        EXPECT_EQ(0, memcmp(ref.data(), out.data(), frames * sizeof(float)))
+                << "frames " << frames;
+    }
+}
+
+TEST(audioflinger_formatconvert, mono_i16_from_stereo_i16_bit_exact) {
+    for (size_t frames : kFrames) {
+        std::vector<int16_t> in(frames * 2);
+        fill(in);
+        std::vector<float> temp(frames * 2);
+        std::vector<int16_t> ref(frames);
+        std::vector<int16_t> out(frames);
+        memcpy_to_float_from_i16(temp.data(), in.data(), frames * 2);
+        downmix_to_mono_float_from_stereo_float(temp.data(), temp.data(), frames);
+        memcpy_to_i16_from_float(ref.data(), temp.data(), frames);
+        downmixToMonoI16FromStereoI16(out.data(), in.data(), frames);
+        EXPECT_EQ(0, memcmp(ref.data(), out.data(), frames * sizeof(int16_t)))
+                << "frames " << frames;
+    }
+}
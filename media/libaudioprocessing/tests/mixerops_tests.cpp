@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_mixerops_tests"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <audio_utils/primitives.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include "../AudioMixerOps.h"
+#include "../AudioMixerOpsSimd.h"
+
+using namespace android;
+
+// Same channel count to MIXTYPE mapping as AudioMixer.cpp.
+static constexpr int mixTypeForChannels(uint32_t channels) {
+    return channels <= 2 ? MIXTYPE_MULTI : MIXTYPE_MULTI_MONOVOL;
+}
+
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+static void scalarRamp(uint32_t channels, TO *out, size_t frameCount, const TI *in,
+        TV *vol, const TV *volinc) {
+    TV vola = 0;
+    switch (channels) {
+    case 1: volumeRampMulti<MIXTYPE, 1>(out, frameCount, in, (TO *)NULL, vol, volinc, &vola,
+            (TV)0); break;
+    case 2: volumeRampMulti<MIXTYPE, 2>(out, frameCount, in, (TO *)NULL, vol, volinc, &vola,
+            (TV)0); break;
+    case 4: volumeRampMulti<MIXTYPE, 4>(out, frameCount, in, (TO *)NULL, vol, volinc, &vola,
+            (TV)0); break;
+    case 6: volumeRampMulti<MIXTYPE, 6>(out, frameCount, in, (TO *)NULL, vol, volinc, &vola,
+            (TV)0); break;
+    case 8: volumeRampMulti<MIXTYPE, 8>(out, frameCount, in, (TO *)NULL, vol, volinc, &vola,
+            (TV)0); break;
+    default: FAIL() << "unexpected channel count " << channels;
+    }
+}
+
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+static void scalarConstant(uint32_t channels, TO *out, size_t frameCount, const TI *in,
+        const TV *vol) {
+    switch (channels) {
+    case 1: volumeMulti<MIXTYPE, 1>(out, frameCount, in, (TO *)NULL, vol, (TV)0); break;
+    case 2: volumeMulti<MIXTYPE, 2>(out, frameCount, in, (TO *)NULL, vol, (TV)0); break;
+    case 4: volumeMulti<MIXTYPE, 4>(out, frameCount, in, (TO *)NULL, vol, (TV)0); break;
+    case 6: volumeMulti<MIXTYPE, 6>(out, frameCount, in, (TO *)NULL, vol, (TV)0); break;
+    case 8: volumeMulti<MIXTYPE, 8>(out, frameCount, in, (TO *)NULL, vol, (TV)0); break;
+    default: FAIL() << "unexpected channel count " << channels;
+    }
+}
+
+static void fill(std::vector<float> &v) {
+    for (auto &f : v) f = (rand() - RAND_MAX / 2) / (float)RAND_MAX;
+}
+
+static void fill(std::vector<int16_t> &v) {
+    for (auto &i : v) i = (int16_t)rand();
+}
+
+static void fill(std::vector<int32_t> &v) {
+    for (auto &i : v) i = (rand() - RAND_MAX / 2) >> 4;
+}
+
+template <typename TO, typename TI, typename TV>
+static void testRamp(uint32_t channels, size_t frameCount, const TV *startVol,
+        const TV *volInc) {
+    std::vector<TI> in(frameCount * channels);
+    std::vector<TO> ref(frameCount * channels);
+    fill(in);
+    fill(ref);
+    std::vector<TO> out(ref);
+
+    TV refVol[2] = { startVol[0], startVol[1] };
+    TV vol[2] = { startVol[0], startVol[1] };
+    switch (mixTypeForChannels(channels)) {
+    case MIXTYPE_MULTI:
+        scalarRamp<MIXTYPE_MULTI>(channels, ref.data(), frameCount, in.data(), refVol, volInc);
+        break;
+    default:
+        scalarRamp<MIXTYPE_MULTI_MONOVOL>(channels, ref.data(), frameCount, in.data(),
+                refVol, volInc);
+        break;
+    }
+    if (!volumeRampMultiSimd<MIXTYPE_MULTI>(
+            channels, out.data(), frameCount, in.data(), vol, volInc)) {
+        ALOGV("no simd ramp for %u channels", channels);
+        return;
+    }
+    EXPECT_EQ(0, memcmp(ref.data(), out.data(), ref.size() * sizeof(TO)))
+            << "channels " << channels << " frames " << frameCount;
+    EXPECT_EQ(0, memcmp(refVol, vol, sizeof(vol)))
+            << "channels " << channels << " frames " << frameCount;
+}
+
+template <typename TO, typename TI, typename TV>
+static void testConstant(uint32_t channels, size_t frameCount, const TV *vol) {
+    std::vector<TI> in(frameCount * channels);
+    std::vector<TO> ref(frameCount * channels);
+    fill(in);
+    fill(ref);
+    std::vector<TO> out(ref);
+
+    switch (mixTypeForChannels(channels)) {
+    case MIXTYPE_MULTI:
+        scalarConstant<MIXTYPE_MULTI>(channels, ref.data(), frameCount, in.data(), vol);
+        break;
+    default:
+        scalarConstant<MIXTYPE_MULTI_MONOVOL>(channels, ref.data(), frameCount, in.data(), vol);
+        break;
+    }
+    if (!volumeMultiSimd<MIXTYPE_MULTI>(channels, out.data(), frameCount, in.data(), vol)) {
+        ALOGV("no simd mix for %u channels", channels);
+        return;
+    }
+    EXPECT_EQ(0, memcmp(ref.data(), out.data(), ref.size() * sizeof(TO)))
+            << "channels " << channels << " frames " << frameCount;
+}
+
+static const uint32_t kChannels[] = { 1, 2, 4, 6, 8 };
+static const size_t kFrames[] = { 1, 2, 3, 7, 64, 257 };
+
+TEST(audioflinger_mixerops, float_ramp_bit_exact) {
+    const float startVol[2] = { 0.1f, 0.9f };
+    const float volInc[2] = { 1.f / 3000, -1.f / 7000 };
+    for (uint32_t channels : kChannels) {
+        for (size_t frames : kFrames) {
+            testRamp<float, float, float>(channels, frames, startVol, volInc);
+        }
+    }
+}
+
+TEST(audioflinger_mixerops, float_constant_bit_exact) {
+    const float vol[2] = { 0.3f, 0.7f };
+    for (uint32_t channels : kChannels) {
+        for (size_t frames : kFrames) {
+            testConstant<float, float, float>(channels, frames, vol);
+        }
+    }
+}
+
+TEST(audioflinger_mixerops, int16_ramp_bit_exact) {
+    const int32_t startVol[2] = { 0x01000000, 0x10000000 };  // U4.28
+    const int32_t volInc[2] = { 0x1234, -0x4321 };
+    for (uint32_t channels : kChannels) {
+        for (size_t frames : kFrames) {
+            testRamp<int32_t, int16_t, int32_t>(channels, frames, startVol, volInc);
+        }
+    }
+}
+
+TEST(audioflinger_mixerops, int16_constant_bit_exact) {
+    const int16_t vol[2] = { 0x0123, 0x1000 };  // U4.12
+    for (uint32_t channels : kChannels) {
+        for (size_t frames : kFrames) {
+            testConstant<int32_t, int16_t, int16_t>(channels, frames, vol);
+        }
+    }
+}
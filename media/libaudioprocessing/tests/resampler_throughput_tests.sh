@@ -0,0 +1,58 @@
+#!/bin/bash
+#
+# This script uses test-resampler to measure the throughput of the
+# resamplers for the most common sample rate conversions, per quality
+# and channel count.
+#
+# The output is one line per configuration, e.g.
+# quality: 7  channels: 2  in: 44100  out: 48000  msec: 12  Mfrms/s: 13.45
+#
+# Mfrms/s is millions of output frames per second. Run with the device
+# at a fixed CPU frequency to compare builds, e.g. with and without
+# -DUSE_NEON=false in ../Android.bp.
+
+if [ -z "$ANDROID_BUILD_TOP" ]; then
+    echo "Android build environment not set"
+    exit -1
+fi
+
+# ensure we have mm
+. $ANDROID_BUILD_TOP/build/envsetup.sh
+
+pushd $ANDROID_BUILD_TOP/frameworks/av/media/libaudioprocessing
+
+# build
+pwd
+mm
+
+# send to device
+echo "waiting for device"
+adb root && adb wait-for-device remount
+adb push $OUT/system/lib/libaudioprocessing.so /system/lib
+adb push $OUT/system/lib64/libaudioprocessing.so /system/lib64
+adb push $OUT/system/bin/test-resampler /system/bin
+
+# input rate, output rate
+RATES="44100,48000 48000,44100 48000,16000 16000,48000 32000,48000 48000,96000"
+
+# $1 = additional flags
+function profile() {
+    for rates in $RATES; do
+        in=${rates%,*}
+        out=${rates#*,}
+        for quality in dlq dmq dhq; do
+            for channels in 1 2; do
+                adb shell test-resampler $1 -p -q $quality -c $channels \
+                    -i $in -o $out /sdcard/resampler_throughput.wav | grep Mfrms
+            done
+        done
+    done
+    adb shell rm /sdcard/resampler_throughput.wav
+}
+
+echo "int16 input"
+profile ""
+echo "float input"
+profile "-F"
+
+popd
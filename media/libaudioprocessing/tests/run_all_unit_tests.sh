@@ -10,3 +10,7 @@ adb root && adb wait-for-device remount
 
 adb shell /data/nativetest/resampler_tests/resampler_tests
 adb shell /data/nativetest64/resampler_tests/resampler_tests
+adb shell /data/nativetest/mixerops_tests/mixerops_tests
+adb shell /data/nativetest64/mixerops_tests/mixerops_tests
+adb shell /data/nativetest/formatconvert_tests/formatconvert_tests
+adb shell /data/nativetest64/formatconvert_tests/formatconvert_tests
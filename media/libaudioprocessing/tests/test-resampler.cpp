@@ -423,8 +423,9 @@ int main(int argc, char* argv[]) {
             }
         }
         // Mfrms/s is "Millions of output frames per second".
-        printf("quality: %d  channels: %d  msec: %" PRId64 "  Mfrms/s: %.2lf\n",
-                quality, channels, time/1000000, output_frames * looplimit / (time / 1e9) / 1e6);
+        printf("quality: %d  channels: %d  in: %d  out: %d  msec: %" PRId64 "  Mfrms/s: %.2lf\n",
+                quality, channels, input_freq, output_freq,
+                time/1000000, output_frames * looplimit / (time / 1e9) / 1e6);
         resampler->reset();
 
         // TODO fix legacy bug: reset does not clear buffers.
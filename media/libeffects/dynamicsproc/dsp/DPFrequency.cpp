@@ -152,6 +152,10 @@ void DPFrequency::configure(size_t blockSize, size_t overlapSize,
     mHalfFFTSize = 1 + mBlockSize / 2; //including Nyquist bin
     mOverlapSize = std::min(overlapSize, mBlockSize/2);
 
+    //the input is real, so only the half spectrum is computed and used by the inverse.
+    mFftServer.SetFlag(Eigen::FFT<float>::HalfSpectrum);
+    mWindowedInput.resize(mBlockSize);
+
     int channelcount = getChannelCount();
     mSamplingRate = samplingRate;
     mChannelBuffers.resize(channelcount);
@@ -480,37 +484,39 @@ size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
     Eigen::Map<Eigen::VectorXf> eWindow(&mVWindow[0], mVWindow.size());
     Eigen::Map<Eigen::VectorXf> eInput(&cb.input[0], cb.input.size());
 
-    Eigen::VectorXf eWin = eInput.cwiseProduct(eWindow); //apply window
+    mWindowedInput = eInput.cwiseProduct(eWindow); //apply window, no allocation
 
     //##fft
     //Note: we are using eigen with the default scaling, which ensures that
     //  IFFT( FFT(x) ) = x.
     // TODO: optimize by using the noscale option, and compensate with dB scale offsets
-    mFftServer.fwd(cb.complexTemp, eWin);
+    mFftServer.fwd(cb.complexTemp, mWindowedInput);
 
-    size_t cSize = cb.complexTemp.size();
-    size_t maxBin = std::min(cSize/2, mHalfFFTSize);
+    //complexTemp holds the half spectrum. The EQs leave the Nyquist bin untouched.
+    const size_t nyquistBin = mHalfFFTSize - 1;
+    const size_t maxBin = nyquistBin;
 
     //== EqPre (always runs)
-    for (size_t k = 0; k < maxBin; k++) {
-        cb.complexTemp[k] *= cb.mPreEqFactorVector[k];
-    }
+    cb.complexTemp.head(maxBin).array() *=
+            Eigen::Map<const Eigen::ArrayXf>(&cb.mPreEqFactorVector[0], maxBin);
 
     //== MBC
     if (cb.mMbcInUse && cb.mMbcEnabled) {
         for (size_t band = 0; band < cb.mMbcBands.size(); band++) {
             ChannelBuffer::MbcBandParams *pMbcBandParams = &cb.mMbcBands[band];
-            float fEnergySum = 0;
+            const size_t binStart = pMbcBandParams->binStart;
+            const size_t binStop = std::min(pMbcBandParams->binStop, nyquistBin);
+            const size_t binCount = binStart <= binStop ? binStop - binStart + 1 : 0;
 
             //apply pre gain.
             float preGainFactor = dBtoLinear(pMbcBandParams->gainPreDb);
             float preGainSquared = preGainFactor * preGainFactor;
 
-            for (size_t k = pMbcBandParams->binStart; k <= pMbcBandParams->binStop; k++) {
-                fEnergySum += std::norm(cb.complexTemp[k]) * preGainSquared; //mag squared
-            }
+            //mag squared
+            float fEnergySum = binCount > 0 ?
+                    cb.complexTemp.segment(binStart, binCount).squaredNorm() * preGainSquared : 0;
 
-            //Eigen FFT is full spectrum, even if the source was real data.
+            //Only the half spectrum is computed, as the source is real data.
             // Each half spectrum has half the energy. This is taken into account with the * 2
             // factor in the energy computations.
             // energy = sqrt(sum_components_squared) number_points
@@ -567,8 +573,8 @@ size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
             newFactor *= dBtoLinear(pMbcBandParams->gainPostDb);
 
             //apply to this band
-            for (size_t k = pMbcBandParams->binStart; k <= pMbcBandParams->binStop; k++) {
-                cb.complexTemp[k] *= newFactor;
+            if (binCount > 0) {
+                cb.complexTemp.segment(binStart, binCount) *= newFactor;
             }
 
         } //end per band process
@@ -577,17 +583,13 @@ size_t DPFrequency::processFirstStages(ChannelBuffer &cb) {
 
     //== EqPost
     if (cb.mPostEqInUse && cb.mPostEqEnabled) {
-        for (size_t k = 0; k < maxBin; k++) {
-            cb.complexTemp[k] *= cb.mPostEqFactorVector[k];
-        }
+        cb.complexTemp.head(maxBin).array() *=
+                Eigen::Map<const Eigen::ArrayXf>(&cb.mPostEqFactorVector[0], maxBin);
     }
 
     //== Limiter. First Pass
     if (cb.mLimiterInUse && cb.mLimiterEnabled) {
-        float fEnergySum = 0;
-        for (size_t k = 0; k < maxBin; k++) {
-            fEnergySum += std::norm(cb.complexTemp[k]);
-        }
+        float fEnergySum = cb.complexTemp.head(maxBin).squaredNorm();
 
         //see explanation above for energy computation logic
         fEnergySum = sqrt(fEnergySum * 2) / (mBlockSize * mWindowRms);
@@ -656,14 +658,10 @@ size_t DPFrequency::processLastStages(ChannelBuffer &cb) {
 
     //apply to all if != 1.0
     if (!compareEquality(outputGainFactor, 1.0f)) {
-        size_t cSize = cb.complexTemp.size();
-        size_t maxBin = std::min(cSize/2, mHalfFFTSize);
-        for (size_t k = 0; k < maxBin; k++) {
-            cb.complexTemp[k] *= outputGainFactor;
-        }
+        cb.complexTemp.head(mHalfFFTSize - 1) *= outputGainFactor;
     }
 
-    //##ifft directly to output.
+    //##ifft directly to output, from the half spectrum.
     Eigen::Map<Eigen::VectorXf> eOutput(&cb.output[0], cb.output.size());
     mFftServer.inv(eOutput, cb.complexTemp);
 
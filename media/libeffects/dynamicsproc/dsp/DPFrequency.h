@@ -151,6 +151,7 @@ private:
 
     //dsp
     FloatVec mVWindow;  //window class.
+    Eigen::VectorXf mWindowedInput; //windowed block, kept to avoid allocating per block
     float mWindowRms;
     Eigen::FFT<float> mFftServer;
 };
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the DynamicsProcessing engine with all stages in use on synthetic audio and
+// reports the processing time per second of audio for several channel counts.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "DPFrequency.h"
+
+static constexpr size_t kFrameCount = 256;    // frames per processSamples() call
+static constexpr float kPreferredFrameDurationMs = 10.0f;
+
+static void setUp(dp_fx::DPFrequency *dp, uint32_t channelCount, uint32_t bandCount,
+        uint32_t sampleRate) {
+    dp->init(channelCount, true, bandCount, true, bandCount, true, bandCount, true);
+    // as DP_configureVariant() does for VARIANT_FAVOR_FREQUENCY_RESOLUTION
+    size_t block = kPreferredFrameDurationMs * sampleRate / 1000.0f;
+    block = 1 << (32 - __builtin_clz(block - 1));
+    dp->configure(block, block / 2, sampleRate);
+
+    for (uint32_t ch = 0; ch < channelCount; ch++) {
+        dp_fx::DPChannel *channel = dp->getChannel(ch);
+        channel->setInputGain(-3.0f);
+        channel->setOutputGain(1.0f);
+        for (uint32_t b = 0; b < bandCount; b++) {
+            // bands spread logarithmically from 100 Hz to Nyquist
+            const float cutoff = 100.0f * powf(sampleRate / 200.0f, (b + 1.0f) / bandCount);
+            dp_fx::DPEqBand eqBand;
+            eqBand.init(true, cutoff, (b % 2) ? -6.0f : 3.0f);
+            channel->getPreEq()->setBand(b, eqBand);
+            channel->getPostEq()->setBand(b, eqBand);
+            dp_fx::DPMbcBand mbcBand;
+            mbcBand.init(true, cutoff, 3.0f /* attack */, 80.0f /* release */, 4.0f /* ratio */,
+                    -30.0f /* threshold */, 6.0f /* knee */, -90.0f /* noise gate */,
+                    2.0f /* expander */, 0.0f /* pre gain */, 3.0f /* post gain */);
+            channel->getMbc()->setBand(b, mbcBand);
+        }
+        dp_fx::DPLimiter limiter;
+        limiter.init(true, true, 0 /* link group */, 1.0f, 60.0f, 10.0f, -2.0f, 0.0f);
+        channel->setLimiter(limiter);
+    }
+}
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [options]\n", me);
+    fprintf(stderr, "       -b number of bands per stage (default 6)\n");
+    fprintf(stderr, "       -r sample rate (default 48000)\n");
+    fprintf(stderr, "       -s seconds of audio per run (default 20)\n");
+    fprintf(stderr, "       -h(elp)\n");
+}
+
+int main(int argc, char **argv) {
+    uint32_t bandCount = 6;
+    uint32_t sampleRate = 48000;
+    uint32_t seconds = 20;
+
+    int res;
+    while ((res = getopt(argc, argv, "b:r:s:h")) >= 0) {
+        switch (res) {
+            case 'b':
+                bandCount = strtoul(optarg, nullptr, 10);
+                break;
+            case 'r':
+                sampleRate = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                seconds = strtoul(optarg, nullptr, 10);
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (bandCount == 0 || sampleRate < 8000 || seconds == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (uint32_t channelCount : { 1, 2, 8 }) {
+        dp_fx::DPFrequency dp;
+        setUp(&dp, channelCount, bandCount, sampleRate);
+
+        // a chirp with a different phase per channel, so that every band works
+        std::vector<float> in(kFrameCount * channelCount);
+        std::vector<float> out(in.size());
+        const size_t totalFrames = (size_t)seconds * sampleRate;
+        double phase = 0;
+        double maxAbs = 0;
+
+        std::chrono::steady_clock::duration elapsed{};
+        for (size_t frame = 0; frame < totalFrames; frame += kFrameCount) {
+            for (size_t k = 0; k < kFrameCount; k++) {
+                const double t = (double)(frame + k) / totalFrames;
+                phase += 2 * M_PI * (50.0 + t * (sampleRate / 2 - 100.0)) / sampleRate;
+                for (uint32_t ch = 0; ch < channelCount; ch++) {
+                    in[k * channelCount + ch] = 0.5f * sin(phase + ch);
+                }
+            }
+            const auto start = std::chrono::steady_clock::now();
+            dp.processSamples(in.data(), out.data(), in.size());
+            elapsed += std::chrono::steady_clock::now() - start;
+            for (float sample : out) {
+                maxAbs = std::max(maxAbs, (double)fabsf(sample));
+            }
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        printf("%u channels, %u bands: %.2f ms per second of audio (peak %.3f)\n",
+                channelCount, bandCount, ms / seconds, maxAbs);
+    }
+    return 0;
+}
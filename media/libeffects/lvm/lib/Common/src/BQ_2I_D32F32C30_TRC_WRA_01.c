@@ -153,10 +153,24 @@ void BQ_MC_D32F32C30_TRC_WRA_01 (           Biquad_FLOAT_Instance_t      *pInsta
 
 
     {
-        LVM_FLOAT yn, temp;
+        LVM_FLOAT yn, temp, xn;
         LVM_INT16 ii, jj;
         PFilter_State_FLOAT pBiquadState = (PFilter_State_FLOAT) pInstance;
 
+        /*
+         * Coefficients and delay pointers are loaded once: the output may alias the
+         * state, so they would otherwise be reloaded for every sample of every channel.
+         */
+        const LVM_FLOAT A2 = pBiquadState->coefs[0];
+        const LVM_FLOAT A1 = pBiquadState->coefs[1];
+        const LVM_FLOAT A0 = pBiquadState->coefs[2];
+        const LVM_FLOAT B2 = pBiquadState->coefs[3];
+        const LVM_FLOAT B1 = pBiquadState->coefs[4];
+        LVM_FLOAT * const pXn1 = pBiquadState->pDelays;      /* x(n-1) for all channels */
+        LVM_FLOAT * const pXn2 = pXn1 + NrChannels;          /* x(n-2) for all channels */
+        LVM_FLOAT * const pYn1 = pXn2 + NrChannels;          /* y(n-1) for all channels */
+        LVM_FLOAT * const pYn2 = pYn1 + NrChannels;          /* y(n-2) for all channels */
+
          for (ii = NrFrames; ii != 0; ii--)
          {
             /**************************************************************************
@@ -164,40 +178,39 @@ void BQ_MC_D32F32C30_TRC_WRA_01 (           Biquad_FLOAT_Instance_t      *pInsta
             ***************************************************************************/
             for (jj = 0; jj < NrChannels; jj++)
             {
+                xn = *pDataIn++;
+
                 /* yn= (A2  * x(n-2)) */
-                yn = pBiquadState->coefs[0] * pBiquadState->pDelays[NrChannels + jj];
+                yn = A2 * pXn2[jj];
 
                 /* yn+= (A1  * x(n-1)) */
-                temp = pBiquadState->coefs[1] * pBiquadState->pDelays[jj];
+                temp = A1 * pXn1[jj];
                 yn += temp;
 
                 /* yn+= (A0  * x(n)) */
-                temp = pBiquadState->coefs[2] * (*pDataIn);
+                temp = A0 * xn;
                 yn += temp;
 
                  /* yn+= (-B2  * y(n-2)) */
-                temp = pBiquadState->coefs[3] * pBiquadState->pDelays[NrChannels*3 + jj];
+                temp = B2 * pYn2[jj];
                 yn += temp;
 
                 /* yn+= (-B1  * y(n-1)) */
-                temp = pBiquadState->coefs[4] * pBiquadState->pDelays[NrChannels*2 + jj];
+                temp = B1 * pYn1[jj];
                 yn += temp;
 
                 /**************************************************************************
                                 UPDATING THE DELAYS
                 ***************************************************************************/
-                pBiquadState->pDelays[NrChannels * 3 + jj] =
-                    pBiquadState->pDelays[NrChannels * 2 + jj]; /* y(n-2)=y(n-1)*/
-                pBiquadState->pDelays[NrChannels * 1 + jj] =
-                    pBiquadState->pDelays[jj]; /* x(n-2)=x(n-1)*/
-                pBiquadState->pDelays[NrChannels * 2 + jj] = (LVM_FLOAT)yn; /* Update y(n-1)*/
-                pBiquadState->pDelays[jj] = (*pDataIn); /* Update x(n-1)*/
-                pDataIn++;
+                pYn2[jj] = pYn1[jj]; /* y(n-2)=y(n-1)*/
+                pXn2[jj] = pXn1[jj]; /* x(n-2)=x(n-1)*/
+                pYn1[jj] = yn;       /* Update y(n-1)*/
+                pXn1[jj] = xn;       /* Update x(n-1)*/
+
                 /**************************************************************************
                                 WRITING THE OUTPUT
                 ***************************************************************************/
-                *pDataOut = (LVM_FLOAT)yn; /* Write jj Channel output */
-                pDataOut++;
+                *pDataOut++ = yn; /* Write jj Channel output */
             }
         }
 
@@ -142,10 +142,23 @@ void PK_Mc_D32F32C14G11_TRC_WRA_01 (Biquad_FLOAT_Instance_t       *pInstance,
                                     LVM_INT16               NrFrames,
                                     LVM_INT16               NrChannels)
     {
-        LVM_FLOAT yn, ynO, temp;
+        LVM_FLOAT yn, ynO, temp, xn;
         LVM_INT16 ii, jj;
         PFilter_State_Float pBiquadState = (PFilter_State_Float) pInstance;
 
+        /*
+         * Coefficients and delay pointers are loaded once: the output may alias the
+         * state, so they would otherwise be reloaded for every sample of every channel.
+         */
+        const LVM_FLOAT A0   = pBiquadState->coefs[0];
+        const LVM_FLOAT B2   = pBiquadState->coefs[1];
+        const LVM_FLOAT B1   = pBiquadState->coefs[2];
+        const LVM_FLOAT Gain = pBiquadState->coefs[3];
+        LVM_FLOAT * const pXn1 = pBiquadState->pDelays;      /* x(n-1) for all channels */
+        LVM_FLOAT * const pXn2 = pXn1 + NrChannels;          /* x(n-2) for all channels */
+        LVM_FLOAT * const pYn1 = pXn2 + NrChannels;          /* y(n-1) for all channels */
+        LVM_FLOAT * const pYn2 = pYn1 + NrChannels;          /* y(n-2) for all channels */
+
          for (ii = NrFrames; ii != 0; ii--)
          {
 
@@ -154,40 +167,38 @@ void PK_Mc_D32F32C14G11_TRC_WRA_01 (Biquad_FLOAT_Instance_t       *pInstance,
                 /**************************************************************************
                                 PROCESSING OF THE jj CHANNEL
                 ***************************************************************************/
+                xn = *pDataIn++;
+
                 /* yn= (A0  * (x(n) - x(n-2)))*/
-                temp = (*pDataIn) - pBiquadState->pDelays[NrChannels + jj];
-                yn = temp * pBiquadState->coefs[0];
+                temp = xn - pXn2[jj];
+                yn = temp * A0;
 
                 /* yn+= ((-B2  * y(n-2))) */
-                temp = pBiquadState->pDelays[NrChannels*3 + jj] * pBiquadState->coefs[1];
+                temp = pYn2[jj] * B2;
                 yn += temp;
 
                 /* yn+= ((-B1 * y(n-1))) */
-                temp = pBiquadState->pDelays[NrChannels*2 + jj] * pBiquadState->coefs[2];
+                temp = pYn1[jj] * B1;
                 yn += temp;
 
                 /* ynO= ((Gain * yn)) */
-                ynO = yn * pBiquadState->coefs[3];
+                ynO = yn * Gain;
 
                 /* ynO=(ynO + x(n))*/
-                ynO += (*pDataIn);
+                ynO += xn;
 
                 /**************************************************************************
                                 UPDATING THE DELAYS
                 ***************************************************************************/
-                pBiquadState->pDelays[NrChannels * 3 + jj] =
-                    pBiquadState->pDelays[NrChannels * 2 + jj]; /* y(n-2)=y(n-1)*/
-                pBiquadState->pDelays[NrChannels * 1 + jj] =
-                    pBiquadState->pDelays[jj]; /* x(n-2)=x(n-1)*/
-                pBiquadState->pDelays[NrChannels * 2 + jj] = yn; /* Update y(n-1) */
-                pBiquadState->pDelays[jj] = (*pDataIn); /* Update x(n-1)*/
-                pDataIn++;
+                pYn2[jj] = pYn1[jj]; /* y(n-2)=y(n-1)*/
+                pXn2[jj] = pXn1[jj]; /* x(n-2)=x(n-1)*/
+                pYn1[jj] = yn;       /* Update y(n-1) */
+                pXn1[jj] = xn;       /* Update x(n-1)*/
 
                 /**************************************************************************
                                 WRITING THE OUTPUT
                 ***************************************************************************/
-                *pDataOut = ynO; /* Write output*/
-                pDataOut++;
+                *pDataOut++ = ynO; /* Write output*/
             }
         }
 
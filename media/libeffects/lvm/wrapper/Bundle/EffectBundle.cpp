@@ -3383,7 +3383,7 @@ int Effect_process(effect_handle_t     self,
         } else if (outBuffer->raw != inBuffer->raw) {
             memcpy(outBuffer->raw,
                     inBuffer->raw,
-                    outBuffer->frameCount * sizeof(effect_buffer_t) * FCC_2);
+                    outBuffer->frameCount * sizeof(effect_buffer_t) * NrChannels);
         }
     }
 
@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #define LOG_TAG "PreProcessing"
 //#define LOG_NDEBUG 0
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/Timers.h>
 #include <hardware/audio_effect.h>
@@ -67,6 +69,7 @@ typedef void* preproc_fx_handle_t;
 typedef struct preproc_session_s preproc_session_t;
 typedef struct preproc_effect_s preproc_effect_t;
 typedef struct preproc_ops_s preproc_ops_t;
+typedef struct preproc_worker_s preproc_worker_t;
 
 // Effect operation table. Functions for all pre processors are declared in sPreProcOps[] table.
 // Function pointer can be null if no action required.
@@ -132,6 +135,26 @@ struct preproc_session_s {
     size_t revBufSize;                  // reverse channel input buffer size
     size_t framesRev;                   // number of frames in reverse channel input buffer
     SpeexResamplerState *revResampler;  // handle on reverse channel input speex resampler
+    preproc_worker_t *worker;           // worker running ProcessStream() off the capture
+                                        // thread, NULL to process in line
+    webrtc::AudioFrame *asyncFrame;     // frame queued to or processed by the worker
+    bool asyncPending;                  // asyncFrame is being processed (worker lock)
+    bool asyncReady;                    // asyncFrame holds processed audio
+};
+
+// Worker thread shared by the sessions on one input stream. A session queues each 10 ms
+// frame to the worker and collects it on the next frame, so the capture thread only copies
+// and resamples while the worker runs the webRTC processing.
+struct preproc_worker_s {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int io;                             // input stream served by the worker
+    int refCount;                       // number of sessions using the worker, 0 if unused
+    bool exit;                          // requests the thread to exit
+    preproc_session_t *queue[PREPROC_NUM_SESSIONS]; // sessions with a frame to process
+    size_t queueHead;
+    size_t queueSize;
 };
 
 #ifdef DUAL_MIC_TEST
@@ -794,6 +817,99 @@ int Effect_Release(preproc_effect_t *effect)
 }
 
 
+//------------------------------------------------------------------------------
+// Worker functions
+//------------------------------------------------------------------------------
+
+static pthread_mutex_t sWorkersLock = PTHREAD_MUTEX_INITIALIZER;
+static preproc_worker_t sWorkers[PREPROC_NUM_SESSIONS];
+
+// processing off the capture thread delays the output by 10 ms, so it is opt in.
+static bool PreProc_AsyncEnabled()
+{
+    static const bool enabled = property_get_bool("ro.vendor.audio.preproc.async", false);
+    return enabled;
+}
+
+void *Worker_ThreadLoop(void *cookie)
+{
+    preproc_worker_t *worker = (preproc_worker_t *)cookie;
+    pthread_mutex_lock(&worker->lock);
+    while (!worker->exit) {
+        if (worker->queueSize == 0) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+            continue;
+        }
+        preproc_session_t *session = worker->queue[worker->queueHead];
+        worker->queueHead = (worker->queueHead + 1) % PREPROC_NUM_SESSIONS;
+        worker->queueSize--;
+        pthread_mutex_unlock(&worker->lock);
+
+        session->apm->ProcessStream(session->asyncFrame);
+
+        pthread_mutex_lock(&worker->lock);
+        session->asyncPending = false;
+        pthread_cond_broadcast(&worker->cond);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return NULL;
+}
+
+preproc_worker_t *Worker_Acquire(int io)
+{
+    preproc_worker_t *worker = NULL;
+    pthread_mutex_lock(&sWorkersLock);
+    for (size_t i = 0; i < PREPROC_NUM_SESSIONS; i++) {
+        if (sWorkers[i].refCount > 0 && sWorkers[i].io == io) {
+            worker = &sWorkers[i];
+            worker->refCount++;
+            goto exit;
+        }
+    }
+    for (size_t i = 0; i < PREPROC_NUM_SESSIONS; i++) {
+        if (sWorkers[i].refCount == 0) {
+            worker = &sWorkers[i];
+            break;
+        }
+    }
+    if (worker != NULL) {
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->cond, NULL);
+        worker->io = io;
+        worker->exit = false;
+        worker->queueHead = 0;
+        worker->queueSize = 0;
+        if (pthread_create(&worker->thread, NULL, Worker_ThreadLoop, worker) != 0) {
+            ALOGW("Worker_Acquire could not start worker for io %d", io);
+            pthread_cond_destroy(&worker->cond);
+            pthread_mutex_destroy(&worker->lock);
+            worker = NULL;
+            goto exit;
+        }
+        pthread_setname_np(worker->thread, "preproc_worker");
+        worker->refCount = 1;
+    }
+exit:
+    pthread_mutex_unlock(&sWorkersLock);
+    return worker;
+}
+
+void Worker_Release(preproc_worker_t *worker)
+{
+    pthread_mutex_lock(&sWorkersLock);
+    if (--worker->refCount == 0) {
+        pthread_mutex_lock(&worker->lock);
+        worker->exit = true;
+        pthread_cond_broadcast(&worker->cond);
+        pthread_mutex_unlock(&worker->lock);
+        pthread_join(worker->thread, NULL);
+        pthread_cond_destroy(&worker->cond);
+        pthread_mutex_destroy(&worker->lock);
+        worker->io = 0;
+    }
+    pthread_mutex_unlock(&sWorkersLock);
+}
+
 //------------------------------------------------------------------------------
 // Session functions
 //------------------------------------------------------------------------------
@@ -813,6 +929,8 @@ int Session_Init(preproc_session_t *session)
     session->io = 0;
     session->createdMsk = 0;
     session->apm = NULL;
+    session->worker = NULL;
+    session->asyncFrame = NULL;
     for (i = 0; i < PREPROC_NUM_EFFECTS && status == 0; i++) {
         status = Effect_Init(&session->effects[i], i);
     }
@@ -850,6 +968,11 @@ extern "C" int Session_CreateEffect(preproc_session_t *session,
             ALOGW("Session_CreateEffect could not allocate reverse audio frame");
             goto error;
         }
+        session->asyncFrame = new webrtc::AudioFrame();
+        if (session->asyncFrame == NULL) {
+            ALOGW("Session_CreateEffect could not allocate async audio frame");
+            goto error;
+        }
         session->apmSamplingRate = kPreprocDefaultSr;
         session->apmFrameCount = (kPreprocDefaultSr) / 100;
         session->frameCount = session->apmFrameCount;
@@ -858,6 +981,10 @@ extern "C" int Session_CreateEffect(preproc_session_t *session,
         session->outChannelCount = kPreProcDefaultCnl;
         session->procFrame->sample_rate_hz_ = kPreprocDefaultSr;
         session->procFrame->num_channels_ = kPreProcDefaultCnl;
+        session->asyncFrame->sample_rate_hz_ = kPreprocDefaultSr;
+        session->asyncFrame->num_channels_ = kPreProcDefaultCnl;
+        session->asyncPending = false;
+        session->asyncReady = false;
         session->revChannelCount = kPreProcDefaultCnl;
         session->revFrame->sample_rate_hz_ = kPreprocDefaultSr;
         session->revFrame->num_channels_ = kPreProcDefaultCnl;
@@ -885,6 +1012,8 @@ extern "C" int Session_CreateEffect(preproc_session_t *session,
 
 error:
     if (session->createdMsk == 0) {
+        delete session->asyncFrame;
+        session->asyncFrame = NULL;
         delete session->revFrame;
         session->revFrame = NULL;
         delete session->procFrame;
@@ -895,12 +1024,61 @@ error:
     return status;
 }
 
+// Waits for the worker to be done with the frame of the session, and drops that frame.
+void Session_ResetAsync(preproc_session_t *session)
+{
+    preproc_worker_t *worker = session->worker;
+    if (worker == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&worker->lock);
+    while (session->asyncPending) {
+        pthread_cond_wait(&worker->cond, &worker->lock);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    session->asyncReady = false;
+}
+
+// Queues the frame in procFrame to the worker, and replaces it with the frame the worker
+// processed last, or with silence after a reset.
+void Session_ProcessAsync(preproc_session_t *session)
+{
+    preproc_worker_t *worker = session->worker;
+    pthread_mutex_lock(&worker->lock);
+    while (session->asyncPending) {
+        pthread_cond_wait(&worker->cond, &worker->lock);
+    }
+    webrtc::AudioFrame *frame = session->asyncFrame;
+    session->asyncFrame = session->procFrame;
+    session->procFrame = frame;
+    session->asyncPending = true;
+    worker->queue[(worker->queueHead + worker->queueSize) % PREPROC_NUM_SESSIONS] = session;
+    worker->queueSize++;
+    pthread_cond_broadcast(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+
+    if (!session->asyncReady) {
+        uint32_t channelCount = session->inChannelCount > session->outChannelCount ?
+                session->inChannelCount : session->outChannelCount;
+        memset(session->procFrame->data_, 0,
+               session->apmFrameCount * channelCount * sizeof(int16_t));
+        session->asyncReady = true;
+    }
+}
+
 int Session_ReleaseEffect(preproc_session_t *session,
                           preproc_effect_t *fx)
 {
     ALOGW_IF(Effect_Release(fx) != 0, " Effect_Release() failed for proc ID %d", fx->procId);
     session->createdMsk &= ~(1<<fx->procId);
     if (session->createdMsk == 0) {
+        if (session->worker != NULL) {
+            Session_ResetAsync(session);
+            Worker_Release(session->worker);
+            session->worker = NULL;
+        }
+        delete session->asyncFrame;
+        session->asyncFrame = NULL;
         delete session->apm;
         session->apm = NULL;
         delete session->procFrame;
@@ -948,6 +1126,8 @@ int Session_SetConfig(preproc_session_t *session, effect_config_t *config)
          config->inputCfg.samplingRate, config->inputCfg.channels);
     int status;
 
+    Session_ResetAsync(session);
+
     // AEC implementation is limited to 16kHz
     if (config->inputCfg.samplingRate >= 32000 && !(session->createdMsk & (1 << PREPROC_AEC))) {
         session->apmSamplingRate = 32000;
@@ -980,6 +1160,8 @@ int Session_SetConfig(preproc_session_t *session, effect_config_t *config)
     session->outChannelCount = outCnl;
     session->procFrame->num_channels_ = inCnl;
     session->procFrame->sample_rate_hz_ = session->apmSamplingRate;
+    session->asyncFrame->num_channels_ = inCnl;
+    session->asyncFrame->sample_rate_hz_ = session->apmSamplingRate;
 
     session->revChannelCount = inCnl;
     session->revFrame->num_channels_ = inCnl;
@@ -1044,6 +1226,10 @@ int Session_SetConfig(preproc_session_t *session, effect_config_t *config)
         }
     }
 
+    if (session->worker == NULL && PreProc_AsyncEnabled()) {
+        session->worker = Worker_Acquire(session->io);
+    }
+
     session->state = PREPROC_SESSION_STATE_CONFIG;
     return 0;
 }
@@ -1079,6 +1265,7 @@ int Session_SetReverseConfig(preproc_session_t *session, effect_config_t *config
         return -EINVAL;
     }
     uint32_t inCnl = audio_channel_count_from_out_mask(config->inputCfg.channels);
+    Session_ResetAsync(session);
     const webrtc::ProcessingConfig processing_config = {
        {{static_cast<int>(session->apmSamplingRate), session->inChannelCount},
         {static_cast<int>(session->apmSamplingRate), session->outChannelCount},
@@ -1113,6 +1300,7 @@ void Session_SetProcEnabled(preproc_session_t *session, uint32_t procId, bool en
 {
     if (enabled) {
         if(session->enabledMsk == 0) {
+            Session_ResetAsync(session);
             session->framesIn = 0;
             if (session->inResampler != NULL) {
                 speex_resampler_reset_mem(session->inResampler);
@@ -1334,7 +1522,11 @@ int PreProcessingFx_Process(effect_handle_t     self,
         }
         session->procFrame->samples_per_channel_ = session->apmFrameCount;
 
-        effect->session->apm->ProcessStream(session->procFrame);
+        if (session->worker != NULL) {
+            Session_ProcessAsync(session);
+        } else {
+            effect->session->apm->ProcessStream(session->procFrame);
+        }
 
         if (session->outBufSize < session->framesOut + session->frameCount) {
             int16_t *buf;
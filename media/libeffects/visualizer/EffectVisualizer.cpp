@@ -75,6 +75,10 @@ enum visualizer_state_e {
 
 #define MAX_LATENCY_MS 3000 // 3 seconds of latency for audio pipeline
 
+// minimum time without VISUALIZER_CMD_CAPTURE before the capture buffer stops being updated.
+// Clients that poll more slowly keep it updated for twice their polling interval.
+#define CAPTURE_IDLE_TIME_MS 10000
+
 // maximum number of buffers for which we keep track of the measurements
 #define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 // note: buffer index is stored in uint8_t
 
@@ -96,6 +100,10 @@ struct VisualizerContext {
     uint32_t mLatency;
     struct timespec mBufferUpdateTime;
     uint8_t mCaptureBuf[CAPTURE_BUF_SIZE];
+    // to skip the capture while no client asks for it, e.g. when only measuring
+    struct timespec mCaptureRequestTime; // last VISUALIZER_CMD_CAPTURE, enable or reset
+    uint32_t mCaptureRequestIntervalMs;  // between the last two VISUALIZER_CMD_CAPTURE
+    bool mCaptureIdle;                   // mCaptureBuf is not being updated
     // for measurements
     uint8_t mChannelCount; // to avoid recomputing it every time a buffer is processed
     uint32_t mMeasurementMode;
@@ -107,23 +115,44 @@ struct VisualizerContext {
 //
 //--- Local functions
 //
+static uint32_t Visualizer_getDeltaTimeMs(const struct timespec *from, const struct timespec *to) {
+    time_t secs = to->tv_sec - from->tv_sec;
+    long nsec = to->tv_nsec - from->tv_nsec;
+    if (nsec < 0) {
+        --secs;
+        nsec += 1000000000;
+    }
+    return secs < 0 ? 0 : secs * 1000 + nsec / 1000000;
+}
+
 uint32_t Visualizer_getDeltaTimeMsFromUpdatedTime(VisualizerContext* pContext) {
     uint32_t deltaMs = 0;
     if (pContext->mBufferUpdateTime.tv_sec != 0) {
         struct timespec ts;
         if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-            time_t secs = ts.tv_sec - pContext->mBufferUpdateTime.tv_sec;
-            long nsec = ts.tv_nsec - pContext->mBufferUpdateTime.tv_nsec;
-            if (nsec < 0) {
-                --secs;
-                nsec += 1000000000;
-            }
-            deltaMs = secs * 1000 + nsec / 1000000;
+            deltaMs = Visualizer_getDeltaTimeMs(&pContext->mBufferUpdateTime, &ts);
         }
     }
     return deltaMs;
 }
 
+// Called when capture is requested, or may soon be: holds off the capture idle state.
+static void Visualizer_updateCaptureRequestTime(VisualizerContext *pContext) {
+    if (clock_gettime(CLOCK_MONOTONIC, &pContext->mCaptureRequestTime) < 0) {
+        pContext->mCaptureRequestTime.tv_sec = 0;
+    }
+}
+
+// True if no capture was requested for a while, based on the time of the previous buffer.
+static bool Visualizer_isCaptureIdle(VisualizerContext *pContext) {
+    if (pContext->mBufferUpdateTime.tv_sec == 0 || pContext->mCaptureRequestTime.tv_sec == 0) {
+        return false;
+    }
+    const uint32_t idleMs = std::max((uint32_t)CAPTURE_IDLE_TIME_MS,
+            2 * pContext->mCaptureRequestIntervalMs);
+    return Visualizer_getDeltaTimeMs(&pContext->mCaptureRequestTime,
+            &pContext->mBufferUpdateTime) > idleMs;
+}
 
 void Visualizer_reset(VisualizerContext *pContext)
 {
@@ -132,6 +161,9 @@ void Visualizer_reset(VisualizerContext *pContext)
     pContext->mBufferUpdateTime.tv_sec = 0;
     pContext->mLatency = 0;
     memset(pContext->mCaptureBuf, 0x80, CAPTURE_BUF_SIZE);
+    Visualizer_updateCaptureRequestTime(pContext);
+    pContext->mCaptureRequestIntervalMs = 0;
+    pContext->mCaptureIdle = false;
 }
 
 //----------------------------------------------------------------------------
@@ -314,58 +346,23 @@ int VisualizerLib_GetDescriptor(const effect_uuid_t *uuid,
     return  -EINVAL;
 } /* end VisualizerLib_GetDescriptor */
 
+//----------------------------------------------------------------------------
+// Visualizer_capture()
+//----------------------------------------------------------------------------
+// Purpose: Mix a buffer down to 8 bit mono, scaled as configured, into the capture buffer.
 //
-//--- Effect Control Interface Implementation
+// Inputs:
+//  pContext:   effect engine context
+//  inBuffer:   buffer to capture
+//  sampleLen:  number of samples, for all channels, in inBuffer
 //
+// Outputs:
+//
+//----------------------------------------------------------------------------
 
-int Visualizer_process(
-        effect_handle_t self, audio_buffer_t *inBuffer, audio_buffer_t *outBuffer)
+static void Visualizer_capture(VisualizerContext *pContext, const audio_buffer_t *inBuffer,
+        size_t sampleLen)
 {
-    VisualizerContext * pContext = (VisualizerContext *)self;
-
-    if (pContext == NULL) {
-        return -EINVAL;
-    }
-
-    if (inBuffer == NULL || inBuffer->raw == NULL ||
-        outBuffer == NULL || outBuffer->raw == NULL ||
-        inBuffer->frameCount != outBuffer->frameCount ||
-        inBuffer->frameCount == 0) {
-        return -EINVAL;
-    }
-
-    const size_t sampleLen = inBuffer->frameCount * pContext->mChannelCount;
-
-    // perform measurements if needed
-    if (pContext->mMeasurementMode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        float rmsSqAcc = 0;
-
-#ifdef BUILD_FLOAT
-        float maxSample = 0.f;
-        for (size_t inIdx = 0; inIdx < sampleLen; ++inIdx) {
-            maxSample = fmax(maxSample, fabs(inBuffer->f32[inIdx]));
-            rmsSqAcc += inBuffer->f32[inIdx] * inBuffer->f32[inIdx];
-        }
-        maxSample *= 1 << 15; // scale to int16_t, with exactly 1 << 15 representing positive num.
-        rmsSqAcc *= 1 << 30; // scale to int16_t * 2
-#else
-        int maxSample = 0;
-        for (size_t inIdx = 0; inIdx < sampleLen; ++inIdx) {
-            maxSample = std::max(maxSample, std::abs(int32_t(inBuffer->s16[inIdx])));
-            rmsSqAcc += inBuffer->s16[inIdx] * inBuffer->s16[inIdx];
-        }
-#endif
-        // store the measurement
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mPeakU16 = (uint16_t)maxSample;
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mRmsSquared =
-                rmsSqAcc / sampleLen;
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mIsValid = true;
-        if (++pContext->mMeasurementBufferIdx >= pContext->mMeasurementWindowSizeInBuffers) {
-            pContext->mMeasurementBufferIdx = 0;
-        }
-    }
-
 #ifdef BUILD_FLOAT
     float fscale; // multiplicative scale
 #else
@@ -448,9 +445,70 @@ int Visualizer_process(
 #endif // BUILD_FLOAT
     }
 
-    // XXX the following two should really be atomic, though it probably doesn't
-    // matter much for visualization purposes
     pContext->mCaptureIdx = captIdx;
+}
+
+//
+//--- Effect Control Interface Implementation
+//
+
+int Visualizer_process(
+        effect_handle_t self, audio_buffer_t *inBuffer, audio_buffer_t *outBuffer)
+{
+    VisualizerContext * pContext = (VisualizerContext *)self;
+
+    if (pContext == NULL) {
+        return -EINVAL;
+    }
+
+    if (inBuffer == NULL || inBuffer->raw == NULL ||
+        outBuffer == NULL || outBuffer->raw == NULL ||
+        inBuffer->frameCount != outBuffer->frameCount ||
+        inBuffer->frameCount == 0) {
+        return -EINVAL;
+    }
+
+    const size_t sampleLen = inBuffer->frameCount * pContext->mChannelCount;
+
+    // perform measurements if needed
+    if (pContext->mMeasurementMode & MEASUREMENT_MODE_PEAK_RMS) {
+        // find the peak and RMS squared for the new buffer
+        float rmsSqAcc = 0;
+
+#ifdef BUILD_FLOAT
+        float maxSample = 0.f;
+        for (size_t inIdx = 0; inIdx < sampleLen; ++inIdx) {
+            maxSample = fmax(maxSample, fabs(inBuffer->f32[inIdx]));
+            rmsSqAcc += inBuffer->f32[inIdx] * inBuffer->f32[inIdx];
+        }
+        maxSample *= 1 << 15; // scale to int16_t, with exactly 1 << 15 representing positive num.
+        rmsSqAcc *= 1 << 30; // scale to int16_t * 2
+#else
+        int maxSample = 0;
+        for (size_t inIdx = 0; inIdx < sampleLen; ++inIdx) {
+            maxSample = std::max(maxSample, std::abs(int32_t(inBuffer->s16[inIdx])));
+            rmsSqAcc += inBuffer->s16[inIdx] * inBuffer->s16[inIdx];
+        }
+#endif
+        // store the measurement
+        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mPeakU16 = (uint16_t)maxSample;
+        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mRmsSquared =
+                rmsSqAcc / sampleLen;
+        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mIsValid = true;
+        if (++pContext->mMeasurementBufferIdx >= pContext->mMeasurementWindowSizeInBuffers) {
+            pContext->mMeasurementBufferIdx = 0;
+        }
+    }
+
+    // the capture buffer is only read through VISUALIZER_CMD_CAPTURE, so skip the work
+    // while nobody asks for it.
+    // XXX mCaptureIdx and mBufferUpdateTime should really be updated together atomically,
+    // though it probably doesn't matter much for visualization purposes
+    pContext->mCaptureIdle = Visualizer_isCaptureIdle(pContext);
+    if (!pContext->mCaptureIdle) {
+        Visualizer_capture(pContext, inBuffer, sampleLen);
+    }
+
     // update last buffer update time stamp
     if (clock_gettime(CLOCK_MONOTONIC, &pContext->mBufferUpdateTime) < 0) {
         pContext->mBufferUpdateTime.tv_sec = 0;
@@ -525,6 +583,7 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             return -ENOSYS;
         }
         pContext->mState = VISUALIZER_STATE_ACTIVE;
+        Visualizer_updateCaptureRequestTime(pContext);
         ALOGV("EFFECT_CMD_ENABLE() OK");
         *(int *)pReplyData = 0;
         break;
@@ -634,7 +693,19 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
                     *replySize, captureSize);
             return -EINVAL;
         }
-        if (pContext->mState == VISUALIZER_STATE_ACTIVE) {
+        const struct timespec lastRequestTime = pContext->mCaptureRequestTime;
+        Visualizer_updateCaptureRequestTime(pContext);
+        if (lastRequestTime.tv_sec != 0 && pContext->mCaptureRequestTime.tv_sec != 0) {
+            pContext->mCaptureRequestIntervalMs =
+                    Visualizer_getDeltaTimeMs(&lastRequestTime, &pContext->mCaptureRequestTime);
+        }
+        if (pContext->mState == VISUALIZER_STATE_ACTIVE && pContext->mCaptureIdle) {
+            // the capture buffer is stale, restart from silence.
+            ALOGV("capture leaving idle");
+            pContext->mCaptureIdle = false;
+            memset(pContext->mCaptureBuf, 0x80, CAPTURE_BUF_SIZE);
+            memset(pReplyData, 0x80, captureSize);
+        } else if (pContext->mState == VISUALIZER_STATE_ACTIVE) {
             const uint32_t deltaMs = Visualizer_getDeltaTimeMsFromUpdatedTime(pContext);
 
             // if audio framework has stopped playing audio although the effect is still
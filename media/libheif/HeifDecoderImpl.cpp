@@ -298,6 +298,14 @@ HeifDecoderImpl::HeifDecoderImpl() :
     mFrameDecoded(false),
     mHasImage(false),
     mHasVideo(false),
+    mRegionLeft(0),
+    mRegionTop(0),
+    mRegionRight(0),
+    mRegionBottom(0),
+    mDecodedLeft(0),
+    mDecodedTop(0),
+    mDecodedRight(0),
+    mDecodedBottom(0),
     mAvailableLines(0),
     mNumSlices(1),
     mSliceHeight(0),
@@ -373,6 +381,8 @@ bool HeifDecoderImpl::init(HeifStream* stream, HeifFrameInfo* frameInfo) {
     }
     mWidth = videoFrame->mWidth;
     mHeight = videoFrame->mHeight;
+    mRegionRight = mWidth;
+    mRegionBottom = mHeight;
     if (mHasImage && videoFrame->mTileHeight >= 512 && mWidth >= 3000 && mHeight >= 2000 ) {
         // Try decoding in slices only if the image has tiles and is big enough.
         mSliceHeight = videoFrame->mTileHeight;
@@ -412,15 +422,16 @@ bool HeifDecoderImpl::setOutputColor(HeifColorFormat heifColor) {
 }
 
 bool HeifDecoderImpl::decodeAsync() {
-    for (size_t i = 1; i < mNumSlices; i++) {
+    size_t lastSlice = (mDecodedBottom - 1) / mSliceHeight;
+    for (size_t i = mDecodedTop / mSliceHeight + 1; i <= lastSlice; i++) {
         ALOGV("decodeAsync(): decoding slice %zu", i);
         size_t top = i * mSliceHeight;
         size_t bottom = (i + 1) * mSliceHeight;
-        if (bottom > mHeight) {
-            bottom = mHeight;
+        if (bottom > mDecodedBottom) {
+            bottom = mDecodedBottom;
         }
         sp<IMemory> frameMemory = mRetriever->getImageRectAtIndex(
-                -1, mOutputColor, 0, top, mWidth, bottom);
+                -1, mOutputColor, mDecodedLeft, top, mDecodedRight, bottom);
         {
             Mutex::Autolock autolock(mLock);
 
@@ -442,10 +453,37 @@ bool HeifDecoderImpl::decodeAsync() {
 }
 
 bool HeifDecoderImpl::decode(HeifFrameInfo* frameInfo) {
+    mRegionLeft = 0;
+    mRegionTop = 0;
+    mRegionRight = mWidth;
+    mRegionBottom = mHeight;
+    return decodeInternal(frameInfo);
+}
+
+bool HeifDecoderImpl::decodeRegion(HeifFrameInfo* frameInfo,
+        uint32_t left, uint32_t top, uint32_t right, uint32_t bottom) {
+    if (left >= right || top >= bottom || right > mWidth || bottom > mHeight) {
+        ALOGE("decodeRegion: invalid region {%u, %u, %u, %u} for %ux%u image",
+                left, top, right, bottom, mWidth, mHeight);
+        return false;
+    }
+    mRegionLeft = left;
+    mRegionTop = top;
+    mRegionRight = right;
+    mRegionBottom = bottom;
+    return decodeInternal(frameInfo);
+}
+
+bool HeifDecoderImpl::decodeInternal(HeifFrameInfo* frameInfo) {
     // reset scanline pointer
-    mCurScanline = 0;
+    mCurScanline = mRegionTop;
 
     if (mFrameDecoded) {
+        if (mRegionLeft < mDecodedLeft || mRegionTop < mDecodedTop
+                || mRegionRight > mDecodedRight || mRegionBottom > mDecodedBottom) {
+            ALOGE("decode: region was not decoded");
+            return false;
+        }
         return true;
     }
 
@@ -453,9 +491,13 @@ bool HeifDecoderImpl::decode(HeifFrameInfo* frameInfo) {
     // scanline processing in parallel with decode. If this fails
     // we fallback to decoding the full frame.
     if (mHasImage && mNumSlices > 1) {
-        // get first slice and metadata
+        // get first slice and metadata, only tiles of the region are decoded
+        uint32_t sliceBottom = (mRegionTop / mSliceHeight + 1) * mSliceHeight;
+        if (sliceBottom > mRegionBottom) {
+            sliceBottom = mRegionBottom;
+        }
         sp<IMemory> frameMemory = mRetriever->getImageRectAtIndex(
-                -1, mOutputColor, 0, 0, mWidth, mSliceHeight);
+                -1, mOutputColor, mRegionLeft, mRegionTop, mRegionRight, sliceBottom);
 
         if (frameMemory == nullptr || frameMemory->pointer() == nullptr) {
             ALOGE("decode: metadata is a nullptr");
@@ -475,7 +517,11 @@ bool HeifDecoderImpl::decode(HeifFrameInfo* frameInfo) {
         }
 
         mFrameMemory = frameMemory;
-        mAvailableLines = mSliceHeight;
+        mAvailableLines = sliceBottom;
+        mDecodedLeft = mRegionLeft;
+        mDecodedTop = mRegionTop;
+        mDecodedRight = mRegionRight;
+        mDecodedBottom = mRegionBottom;
         mThread = new DecodeThread(this);
         if (mThread->run("HeifDecode", ANDROID_PRIORITY_FOREGROUND) == OK) {
             mFrameDecoded = true;
@@ -528,6 +574,10 @@ bool HeifDecoderImpl::decode(HeifFrameInfo* frameInfo) {
                 videoFrame->mIccSize,
                 videoFrame->getFlattenedIccData());
     }
+    mDecodedLeft = 0;
+    mDecodedTop = 0;
+    mDecodedRight = mWidth;
+    mDecodedBottom = mHeight;
     mFrameDecoded = true;
 
     // Aggressively clear to avoid holding on to resources
@@ -541,13 +591,14 @@ bool HeifDecoderImpl::getScanlineInner(uint8_t* dst) {
         return false;
     }
     VideoFrame* videoFrame = static_cast<VideoFrame*>(mFrameMemory->pointer());
-    uint8_t* src = videoFrame->getFlattenedData() + videoFrame->mRowBytes * mCurScanline++;
-    memcpy(dst, src, videoFrame->mBytesPerPixel * videoFrame->mWidth);
+    uint8_t* src = videoFrame->getFlattenedData() + videoFrame->mRowBytes * mCurScanline++
+            + videoFrame->mBytesPerPixel * mRegionLeft;
+    memcpy(dst, src, videoFrame->mBytesPerPixel * (mRegionRight - mRegionLeft));
     return true;
 }
 
 bool HeifDecoderImpl::getScanline(uint8_t* dst) {
-    if (mCurScanline >= mHeight) {
+    if (mCurScanline >= mRegionBottom) {
         ALOGE("no more scanline available");
         return false;
     }
@@ -567,8 +618,8 @@ bool HeifDecoderImpl::getScanline(uint8_t* dst) {
 size_t HeifDecoderImpl::skipScanlines(size_t count) {
     uint32_t oldScanline = mCurScanline;
     mCurScanline += count;
-    if (mCurScanline > mHeight) {
-        mCurScanline = mHeight;
+    if (mCurScanline > mRegionBottom) {
+        mCurScanline = mRegionBottom;
     }
     return (mCurScanline > oldScanline) ? (mCurScanline - oldScanline) : 0;
 }
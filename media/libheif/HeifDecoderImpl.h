@@ -46,6 +46,9 @@ public:
 
     bool decode(HeifFrameInfo* frameInfo) override;
 
+    bool decodeRegion(HeifFrameInfo* frameInfo,
+            uint32_t left, uint32_t top, uint32_t right, uint32_t bottom) override;
+
     bool getScanline(uint8_t* dst) override;
 
     size_t skipScanlines(size_t count) override;
@@ -64,6 +67,16 @@ private:
     bool mHasImage;
     bool mHasVideo;
 
+    // Rows and columns returned by getScanline(), and those already decoded
+    uint32_t mRegionLeft;
+    uint32_t mRegionTop;
+    uint32_t mRegionRight;
+    uint32_t mRegionBottom;
+    uint32_t mDecodedLeft;
+    uint32_t mDecodedTop;
+    uint32_t mDecodedRight;
+    uint32_t mDecodedBottom;
+
     // Slice decoding only
     Mutex mLock;
     Condition mScanlineReady;
@@ -73,6 +86,7 @@ private:
     uint32_t mSliceHeight;
     bool mAsyncDecodeDone;
 
+    bool decodeInternal(HeifFrameInfo* frameInfo);
     bool decodeAsync();
     bool getScanlineInner(uint8_t* dst);
 };
@@ -155,6 +155,21 @@ struct HeifDecoder {
      */
     virtual bool decode(HeifFrameInfo* frameInfo) = 0;
 
+    /*
+     * Decode only the rectangle [left, right) x [top, bottom) of the picture,
+     * returning whether it succeeded. Tiles of the picture that do not cover
+     * the rectangle are not decoded. |frameInfo| is filled as with decode().
+     *
+     * After this succeeded, getScanline returns the rows of the rectangle,
+     * starting with row |top|, each (right - left) pixels wide. Rows may be
+     * returned while the rest of the rectangle is still being decoded.
+     */
+    virtual bool decodeRegion(HeifFrameInfo* /*frameInfo*/,
+            uint32_t /*left*/, uint32_t /*top*/,
+            uint32_t /*right*/, uint32_t /*bottom*/) {
+        return false;
+    }
+
     /*
      * Read the next scanline (in top-down order), returns true upon success
      * and false otherwise.
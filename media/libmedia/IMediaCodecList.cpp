@@ -14,9 +14,16 @@
  * limitations under the License.
  */
 
+//#define LOG_NDEBUG 0
+#define LOG_TAG "IMediaCodecList"
+#include <utils/Log.h>
+
 #include <stdint.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 
+#include <binder/MemoryBase.h>
+#include <binder/MemoryHeapBase.h>
 #include <binder/Parcel.h>
 #include <media/stagefright/MediaCodecList.h>
 #include <media/IMediaCodecList.h>
@@ -33,18 +40,30 @@ enum {
     GET_GLOBAL_SETTINGS,
     FIND_CODEC_BY_TYPE,
     FIND_CODEC_BY_NAME,
+    GET_CODEC_LIST_IMAGE,
 };
 
+// The codec list image starts with an index of all codecs, holding what lookups need:
+//   int32 kImageMagic, int32 count, global settings,
+//   for each codec: name, attributes, aliases, media types, offset of its info,
+// followed by the MediaCodecInfo of each codec, decoded only when it is asked for.
+static const int32_t kImageMagic = 'mcl1';
+
 class BpMediaCodecList: public BpInterface<IMediaCodecList>
 {
 public:
     explicit BpMediaCodecList(const sp<IBinder>& impl)
-        : BpInterface<IMediaCodecList>(impl)
+        : BpInterface<IMediaCodecList>(impl),
+          mImageLoaded(false)
     {
     }
 
     virtual size_t countCodecs() const
     {
+        Mutex::Autolock autoLock(mImageLock);
+        if (loadImage_l()) {
+            return mEntries.size();
+        }
         Parcel data, reply;
         data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
         remote()->transact(COUNT_CODECS, data, &reply);
@@ -53,6 +72,10 @@ public:
 
     virtual sp<MediaCodecInfo> getCodecInfo(size_t index) const
     {
+        Mutex::Autolock autoLock(mImageLock);
+        if (loadImage_l()) {
+            return getCodecInfo_l(index);
+        }
         Parcel data, reply;
         data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
         data.writeInt32(index);
@@ -67,6 +90,10 @@ public:
 
     virtual const sp<AMessage> getGlobalSettings() const
     {
+        Mutex::Autolock autoLock(mImageLock);
+        if (loadImage_l()) {
+            return mGlobalSettings;
+        }
         Parcel data, reply;
         data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
         remote()->transact(GET_GLOBAL_SETTINGS, data, &reply);
@@ -85,6 +112,10 @@ public:
             return NAME_NOT_FOUND;
         }
 
+        Mutex::Autolock autoLock(mImageLock);
+        if (loadImage_l()) {
+            return findCodecByType_l(type, encoder, startIndex);
+        }
         Parcel data, reply;
         data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
         data.writeCString(type);
@@ -96,12 +127,153 @@ public:
 
     virtual ssize_t findCodecByName(const char *name) const
     {
+        Mutex::Autolock autoLock(mImageLock);
+        if (loadImage_l()) {
+            for (size_t i = 0; i < mEntries.size(); ++i) {
+                if (mEntries[i].mName == name) {
+                    return i;
+                }
+                for (const AString &alias : mEntries[i].mAliases) {
+                    if (alias == name) {
+                        return i;
+                    }
+                }
+            }
+            return NAME_NOT_FOUND;
+        }
         Parcel data, reply;
         data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
         data.writeCString(name);
         remote()->transact(FIND_CODEC_BY_NAME, data, &reply);
         return static_cast<ssize_t>(reply.readInt32());
     }
+
+private:
+    struct Entry {
+        AString mName;
+        bool mIsEncoder;
+        Vector<AString> mAliases;
+        Vector<AString> mMediaTypes;
+        size_t mInfoOffset;
+        sp<MediaCodecInfo> mInfo;   // decoded on first use
+    };
+
+    // Fetches the codec list image once, so that lookups need no transactions; returns
+    // false if the service does not provide it, and the list is then read per call.
+    bool loadImage_l() const {
+        if (mImageLoaded) {
+            return !mEntries.empty();
+        }
+        mImageLoaded = true;
+
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaCodecList::getInterfaceDescriptor());
+        if (remote()->transact(GET_CODEC_LIST_IMAGE, data, &reply) != NO_ERROR
+                || reply.readInt32() != OK) {
+            return false;
+        }
+        sp<IMemory> image = interface_cast<IMemory>(reply.readStrongBinder());
+        if (image == nullptr || image->pointer() == nullptr) {
+            return false;
+        }
+        mImage.setData((const uint8_t *)image->pointer(), image->size());
+
+        int32_t count;
+        if (mImage.readInt32() != kImageMagic || mImage.readInt32(&count) != OK || count < 0) {
+            ALOGW("invalid codec list image");
+            return false;
+        }
+        std::vector<Entry> entries(count);
+        for (Entry &entry : entries) {
+            entry.mName = AString::FromParcel(mImage);
+            entry.mIsEncoder = mImage.readInt32() & MediaCodecInfo::kFlagIsEncoder;
+            int32_t numAliases = mImage.readInt32();
+            for (int32_t i = 0; i < numAliases && mImage.dataAvail() > 0; ++i) {
+                entry.mAliases.push_back(AString::FromParcel(mImage));
+            }
+            int32_t numMediaTypes = mImage.readInt32();
+            for (int32_t i = 0; i < numMediaTypes && mImage.dataAvail() > 0; ++i) {
+                entry.mMediaTypes.push_back(AString::FromParcel(mImage));
+            }
+            entry.mInfoOffset = mImage.readUint32();
+        }
+        if (mImage.readInt32()) {
+            mGlobalSettings = AMessage::FromParcel(mImage);
+        }
+        if (mImage.dataAvail() == 0 && count > 0) {
+            ALOGW("truncated codec list image");
+            return false;
+        }
+        mInfoStart = mImage.dataPosition();
+        mEntries.swap(entries);
+        ALOGV("codec list image of %zu bytes, %zu codecs", mImage.dataSize(), mEntries.size());
+        return !mEntries.empty();
+    }
+
+    sp<MediaCodecInfo> getCodecInfo_l(size_t index) const {
+        if (index >= mEntries.size()) {
+            return nullptr;
+        }
+        Entry &entry = mEntries[index];
+        if (entry.mInfo == nullptr) {
+            mImage.setDataPosition(mInfoStart + entry.mInfoOffset);
+            entry.mInfo = MediaCodecInfo::FromParcel(mImage);
+        }
+        return entry.mInfo;
+    }
+
+    // as MediaCodecList::findCodecByType(), decoding only the infos of candidates.
+    ssize_t findCodecByType_l(const char *type, bool encoder, size_t startIndex) const {
+        static const char *advancedFeatures[] = {
+            "feature-secure-playback",
+            "feature-tunneled-playback",
+        };
+
+        for (; startIndex < mEntries.size(); ++startIndex) {
+            const Entry &entry = mEntries[startIndex];
+            if (entry.mIsEncoder != encoder) {
+                continue;
+            }
+            bool hasType = false;
+            for (const AString &mediaType : entry.mMediaTypes) {
+                if (mediaType.equalsIgnoreCase(type)) {
+                    hasType = true;
+                    break;
+                }
+            }
+            if (!hasType) {
+                continue;
+            }
+            const sp<MediaCodecInfo> info = getCodecInfo_l(startIndex);
+            sp<MediaCodecInfo::Capabilities> capabilities =
+                    info == nullptr ? nullptr : info->getCapabilitiesFor(type);
+            if (capabilities == nullptr) {
+                continue;
+            }
+            const sp<AMessage> &details = capabilities->getDetails();
+
+            int32_t required;
+            bool isAdvanced = false;
+            for (size_t ix = 0; ix < sizeof(advancedFeatures) / sizeof(advancedFeatures[0]);
+                    ix++) {
+                if (details->findInt32(advancedFeatures[ix], &required) && required != 0) {
+                    isAdvanced = true;
+                    break;
+                }
+            }
+            if (!isAdvanced) {
+                return startIndex;
+            }
+        }
+        return NAME_NOT_FOUND;
+    }
+
+    mutable Mutex mImageLock;
+    mutable bool mImageLoaded;
+    mutable Parcel mImage;
+    mutable size_t mInfoStart;
+    mutable std::vector<Entry> mEntries;
+    mutable sp<AMessage> mGlobalSettings;
 };
 
 IMPLEMENT_META_INTERFACE(MediaCodecList, "android.media.IMediaCodecList");
@@ -189,11 +361,82 @@ status_t BnMediaCodecList::onTransact(
         }
         break;
 
+        case GET_CODEC_LIST_IMAGE:
+        {
+            CHECK_INTERFACE(IMediaCodecList, data, reply);
+            const sp<IMemory> image = getImage();
+            if (image != nullptr) {
+                reply->writeInt32(OK);
+                reply->writeStrongBinder(IInterface::asBinder(image));
+            } else {
+                reply->writeInt32(NO_MEMORY);
+            }
+            return NO_ERROR;
+        }
+        break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
 }
 
+sp<IMemory> BnMediaCodecList::getImage() {
+    Mutex::Autolock autoLock(mImageLock);
+    if (mImage != nullptr) {
+        return mImage;
+    }
+
+    const size_t count = countCodecs();
+    if (count == 0 || count > INT32_MAX) {
+        return nullptr;
+    }
+    Parcel image, infos;
+    image.writeInt32(kImageMagic);
+    image.writeInt32(count);
+    for (size_t i = 0; i < count; ++i) {
+        const sp<MediaCodecInfo> info = getCodecInfo(i);
+        if (info == nullptr) {
+            return nullptr;
+        }
+        AString(info->getCodecName()).writeToParcel(&image);
+        image.writeInt32(info->getAttributes());
+        Vector<AString> strings;
+        info->getAliases(&strings);
+        image.writeInt32(strings.size());
+        for (const AString &alias : strings) {
+            alias.writeToParcel(&image);
+        }
+        info->getSupportedMediaTypes(&strings);
+        image.writeInt32(strings.size());
+        for (const AString &mediaType : strings) {
+            mediaType.writeToParcel(&image);
+        }
+        image.writeUint32(infos.dataSize());
+        info->writeToParcel(&infos);
+    }
+    const sp<AMessage> settings = getGlobalSettings();
+    image.writeInt32(settings != nullptr);
+    if (settings != nullptr) {
+        settings->writeToParcel(&image);
+    }
+    if (image.appendFrom(&infos, 0, infos.dataSize()) != OK) {
+        return nullptr;
+    }
+
+    // Clients share the image, so none of them may change it for the others. The heap
+    // stays writable only through the mapping made here.
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(
+            image.dataSize(), MemoryHeapBase::READ_ONLY, "MediaCodecList");
+    if (heap->getHeapID() < 0 || heap->getBase() == MAP_FAILED) {
+        ALOGE("cannot allocate %zu bytes for the codec list image", image.dataSize());
+        return nullptr;
+    }
+    memcpy(heap->getBase(), image.data(), image.dataSize());
+    mImage = new MemoryBase(heap, 0, image.dataSize());
+    ALOGV("codec list image of %zu bytes, %zu codecs", image.dataSize(), count);
+    return mImage;
+}
+
 // ----------------------------------------------------------------------------
 
 } // namespace android
@@ -74,8 +74,12 @@ enum {
     GET_FRAME_AT_INDEX,
     EXTRACT_ALBUM_ART,
     EXTRACT_METADATA,
+    GET_FRAMES_AT_TIMES,
 };
 
+// bounds the frames, and so the memory, of one getFramesAtTimes() call
+static const size_t kMaxFramesAtTimes = 256;
+
 class BpMediaMetadataRetriever: public BpInterface<IMediaMetadataRetriever>
 {
 public:
@@ -242,6 +246,37 @@ public:
         return OK;
     }
 
+    status_t getFramesAtTimes(std::vector<sp<IMemory> > *frames,
+            const std::vector<int64_t> &timesUs, int option, int colorFormat)
+    {
+        ALOGV("getFramesAtTimes: %zu times, option(%d), colorFormat(%d)",
+                timesUs.size(), option, colorFormat);
+        if (timesUs.empty() || timesUs.size() > kMaxFramesAtTimes) {
+            return BAD_VALUE;
+        }
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaMetadataRetriever::getInterfaceDescriptor());
+        data.writeInt64Vector(timesUs);
+        data.writeInt32(option);
+        data.writeInt32(colorFormat);
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+        sendSchedPolicy(data);
+#endif
+        remote()->transact(GET_FRAMES_AT_TIMES, data, &reply);
+        status_t ret = reply.readInt32();
+        if (ret != NO_ERROR) {
+            return ret;
+        }
+        size_t numFrames = reply.readInt32();
+        if (numFrames != timesUs.size()) {
+            return UNKNOWN_ERROR;
+        }
+        for (size_t i = 0; i < numFrames; i++) {
+            frames->push_back(interface_cast<IMemory>(reply.readStrongBinder()));
+        }
+        return OK;
+    }
+
     sp<IMemory> extractAlbumArt()
     {
         Parcel data, reply;
@@ -452,6 +487,35 @@ status_t BnMediaMetadataRetriever::onTransact(
             }
 #ifndef DISABLE_GROUP_SCHEDULE_HACK
             restoreSchedPolicy();
+#endif
+            return NO_ERROR;
+        } break;
+        case GET_FRAMES_AT_TIMES: {
+            CHECK_INTERFACE(IMediaMetadataRetriever, data, reply);
+            std::vector<int64_t> timesUs;
+            status_t err = data.readInt64Vector(&timesUs);
+            int option = data.readInt32();
+            int colorFormat = data.readInt32();
+            ALOGV("getFramesAtTimes: %zu times, option(%d), colorFormat(%d)",
+                    timesUs.size(), option, colorFormat);
+            if (err != OK || timesUs.empty() || timesUs.size() > kMaxFramesAtTimes) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+            setSchedPolicy(data);
+#endif
+            std::vector<sp<IMemory> > frames;
+            err = getFramesAtTimes(&frames, timesUs, option, colorFormat);
+            reply->writeInt32(err);
+            if (OK == err) {
+                reply->writeInt32(frames.size());
+                for (size_t i = 0; i < frames.size(); i++) {
+                    reply->writeStrongBinder(IInterface::asBinder(frames[i]));
+                }
+            }
+#ifndef DISABLE_GROUP_SCHEDULE_HACK
+            restoreSchedPolicy();
 #endif
             return NO_ERROR;
         } break;
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <binder/IMemory.h>
 #include <binder/Parcel.h>
 
 #include <media/AudioResamplerPublic.h>
@@ -82,6 +83,7 @@ enum {
     SET_OUTPUT_DEVICE,
     GET_ROUTED_DEVICE_ID,
     ENABLE_AUDIO_DEVICE_CALLBACK,
+    GET_PLAYBACK_STATE_MEMORY,
 };
 
 // ModDrm helpers
@@ -618,6 +620,20 @@ public:
 
         return reply.readInt32();
     }
+
+    sp<IMemory> getPlaybackStateMemory()
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaPlayer::getInterfaceDescriptor());
+
+        status_t status = remote()->transact(GET_PLAYBACK_STATE_MEMORY, data, &reply);
+        if (status != OK) {
+            ALOGE("getPlaybackStateMemory: binder call failed: %d", status);
+            return NULL;
+        }
+
+        return interface_cast<IMemory>(reply.readStrongBinder());
+    }
 };
 
 IMPLEMENT_META_INTERFACE(MediaPlayer, "android.media.IMediaPlayer");
@@ -1012,6 +1028,12 @@ status_t BnMediaPlayer::onTransact(
             return NO_ERROR;
         } break;
 
+        case GET_PLAYBACK_STATE_MEMORY: {
+            CHECK_INTERFACE(IMediaPlayer, data, reply);
+            reply->writeStrongBinder(IInterface::asBinder(getPlaybackStateMemory()));
+            return NO_ERROR;
+        } break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
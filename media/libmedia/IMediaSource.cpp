@@ -22,12 +22,16 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <list>
+
 #include <binder/Parcel.h>
 #include <media/IMediaSource.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
 #include <media/MediaSource.h>
 #include <media/stagefright/MetaData.h>
+#include <utils/Thread.h>
 
 namespace android {
 
@@ -49,6 +53,9 @@ enum {
     SHARED_BUFFER_INDEX,
 };
 
+// buffers requested per read-ahead transaction
+static const uint32_t kReadAheadBatch = 8;
+
 class RemoteMediaBufferWrapper : public MediaBuffer {
 public:
     RemoteMediaBufferWrapper(const sp<IMemory> &mem)
@@ -68,10 +75,25 @@ protected:
 class BpMediaSource : public BpInterface<IMediaSource> {
 public:
     explicit BpMediaSource(const sp<IBinder>& impl)
-        : BpInterface<IMediaSource>(impl), mBuffersSinceStop(0)
+        : BpInterface<IMediaSource>(impl), mBuffersSinceStop(0),
+          mReadAheadMaxBytes(0), mReadAheadMaxDurationUs(0), mReadAheadBytes(0),
+          mReadAheadStatus(OK), mReadAheadActive(false), mReadAheadBusy(false),
+          mReadAheadGeneration(0)
     {
     }
 
+    virtual ~BpMediaSource() {
+        if (mReadAheadThread != nullptr) {
+            mReadAheadThread->requestExit();
+            {
+                AutoMutex _l(mReadAheadLock);
+                mReadAheadCondition.broadcast();
+            }
+            mReadAheadThread->requestExitAndWait();
+        }
+        flushReadAhead_l();
+    }
+
     virtual status_t start(MetaData *params) {
         ALOGV("start");
         Parcel data, reply;
@@ -95,6 +117,13 @@ public:
         ALOGV("stop");
         Parcel data, reply;
         data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
+        {
+            // BnMediaSource does not expect STOP to overlap a read.
+            AutoMutex _l(mReadAheadLock);
+            mReadAheadActive = false;
+            waitForReadAhead_l();
+            flushReadAhead_l();
+        }
         status_t status = remote()->transact(STOP, data, &reply);
         mMemoryCache.reset();
         mBuffersSinceStop = 0;
@@ -131,6 +160,113 @@ public:
         if (buffers == NULL || !buffers->isEmpty()) {
             return BAD_VALUE;
         }
+        bool readAhead;
+        {
+            AutoMutex _l(mReadAheadLock);
+            readAhead = mReadAheadMaxBytes > 0;
+        }
+        if (!readAhead) {
+            return readMultipleRemote(buffers, maxNumBuffers, options);
+        }
+
+        AutoMutex _l(mReadAheadLock);
+        int64_t seekTimeUs;
+        MediaSource::ReadOptions::SeekMode mode;
+        if (options != nullptr && options->getSeekTo(&seekTimeUs, &mode)) {
+            // what was read ahead is from before the seek.
+            mReadAheadActive = false;
+            waitForReadAhead_l();
+            flushReadAhead_l();
+        }
+
+        if (!mReadAheadActive) {
+            // The first read after start, a seek or an error is synchronous;
+            // sequential reads after it are served from what the thread delivers.
+            waitForReadAhead_l();
+            mReadAheadBusy = true;
+            mReadAheadLock.unlock();
+            status_t ret = readMultipleRemote(buffers, maxNumBuffers, options);
+            mReadAheadLock.lock();
+            mReadAheadBusy = false;
+            mReadAheadActive = ret == OK || ret == INFO_FORMAT_CHANGED;
+            mReadAheadStatus = OK;
+            mReadAheadCondition.broadcast();
+            return ret;
+        }
+
+        while (mReadAheadQueue.empty() && mReadAheadStatus == OK && mReadAheadActive) {
+            mReadAheadCondition.wait(mReadAheadLock);
+        }
+        while (!mReadAheadQueue.empty() && buffers->size() < maxNumBuffers) {
+            MediaBufferBase *buf = *mReadAheadQueue.begin();
+            mReadAheadQueue.erase(mReadAheadQueue.begin());
+            mReadAheadBytes -= buf->range_length();
+            buffers->push_back(buf);
+        }
+        status_t ret = OK;
+        if (buffers->isEmpty()) {
+            ret = mReadAheadStatus;
+            if (ret == INFO_FORMAT_CHANGED) {
+                mReadAheadStatus = OK; // reported once, reading continues after it.
+            } else if (ret != OK) {
+                mReadAheadActive = false; // the next read retries synchronously.
+            }
+        }
+        mReadAheadCondition.broadcast();
+        ALOGV("readMultiple from read-ahead status %d, bufferCount %zu, queued %zu",
+                ret, buffers->size(), mReadAheadQueue.size());
+        return ret;
+    }
+
+    // Binder proxy adds readMultiple support.
+    virtual bool supportReadMultiple() {
+        return true;
+    }
+
+    virtual status_t setReadAhead(size_t maxBytes, int64_t maxDurationUs) {
+        AutoMutex _l(mReadAheadLock);
+        if (maxBytes == 0) {
+            mReadAheadActive = false;
+            waitForReadAhead_l();
+            flushReadAhead_l();
+        } else if (mReadAheadThread == nullptr) {
+            mReadAheadThread = new ReadAheadThread(this);
+            status_t err = mReadAheadThread->run("MediaSourceReadAhead");
+            if (err != OK) {
+                ALOGW("cannot start read-ahead thread: %d", err);
+                mReadAheadThread.clear();
+                return err;
+            }
+        }
+        mReadAheadMaxBytes = maxBytes;
+        mReadAheadMaxDurationUs = maxDurationUs;
+        mReadAheadCondition.broadcast();
+        return OK;
+    }
+
+    virtual bool supportNonblockingRead() {
+        ALOGV("supportNonblockingRead");
+        Parcel data, reply;
+        data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
+        status_t ret = remote()->transact(SUPPORT_NONBLOCKING_READ, data, &reply);
+        if (ret == NO_ERROR) {
+            return reply.readInt32() != 0;
+        }
+        return false;
+    }
+
+    virtual status_t pause() {
+        ALOGV("pause");
+        Parcel data, reply;
+        data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
+        return remote()->transact(PAUSE, data, &reply);
+    }
+
+private:
+    // Does not take mReadAheadLock; calls are serialized through mReadAheadBusy.
+    status_t readMultipleRemote(
+            Vector<MediaBufferBase *> *buffers, uint32_t maxNumBuffers,
+            const MediaSource::ReadOptions *options) {
         Parcel data, reply;
         data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
         data.writeUint32(maxNumBuffers);
@@ -193,33 +329,111 @@ public:
         return ret;
     }
 
-    // Binder proxy adds readMultiple support.
-    virtual bool supportReadMultiple() {
-        return true;
+    struct ReadAheadThread : public Thread {
+        explicit ReadAheadThread(BpMediaSource *source)
+            : Thread(false /* canCallJava */), mSource(source) {
+        }
+
+        virtual bool threadLoop() {
+            return mSource->readAheadLoop();
+        }
+
+    private:
+        BpMediaSource *mSource; // joined in ~BpMediaSource()
+    };
+
+    bool readAheadFull_l() const {
+        if (mReadAheadBytes >= mReadAheadMaxBytes
+                || mReadAheadQueue.size() >= kMaxNumReadMultiple) {
+            return true;
+        }
+        if (mReadAheadMaxDurationUs <= 0 || mReadAheadQueue.size() < 2) {
+            return false;
+        }
+        int64_t firstUs, lastUs;
+        return (*mReadAheadQueue.begin())->meta_data().findInt64(kKeyTime, &firstUs)
+                && (*--mReadAheadQueue.end())->meta_data().findInt64(kKeyTime, &lastUs)
+                && lastUs - firstUs >= mReadAheadMaxDurationUs;
     }
 
-    virtual bool supportNonblockingRead() {
-        ALOGV("supportNonblockingRead");
-        Parcel data, reply;
-        data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
-        status_t ret = remote()->transact(SUPPORT_NONBLOCKING_READ, data, &reply);
-        if (ret == NO_ERROR) {
-            return reply.readInt32() != 0;
+    bool readAheadLoop() {
+        AutoMutex _l(mReadAheadLock);
+        while (!mReadAheadThread->exitPending()
+                && (!mReadAheadActive || mReadAheadBusy || mReadAheadStatus != OK
+                    || readAheadFull_l())) {
+            mReadAheadCondition.wait(mReadAheadLock);
         }
-        return false;
+        if (mReadAheadThread->exitPending()) {
+            return false;
+        }
+        const int32_t generation = mReadAheadGeneration;
+        mReadAheadBusy = true;
+        mReadAheadLock.unlock();
+
+        Vector<MediaBufferBase *> buffers;
+        status_t ret = readMultipleRemote(&buffers, kReadAheadBatch, nullptr /* options */);
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            // Queued samples are not kept in the remote source's buffers, whose return
+            // it only notices on its next read and which it may need to make progress.
+            MediaBuffer *buf = static_cast<MediaBuffer *>(buffers[i]);
+            if (buf->mMemory != nullptr) {
+                MediaBuffer *copy = new MediaBuffer(new ABuffer(buf->range_length()));
+                memcpy(copy->data(),
+                        (const uint8_t *)buf->data() + buf->range_offset(), buf->range_length());
+                copy->meta_data() = buf->meta_data();
+                buf->release();
+                buffers.editItemAt(i) = copy;
+            }
+        }
+
+        mReadAheadLock.lock();
+        mReadAheadBusy = false;
+        if (generation != mReadAheadGeneration) {
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                buffers[i]->release();
+            }
+        } else {
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                mReadAheadQueue.push_back(buffers[i]);
+                mReadAheadBytes += buffers[i]->range_length();
+            }
+            mReadAheadStatus = ret;
+        }
+        mReadAheadCondition.broadcast();
+        return true;
     }
 
-    virtual status_t pause() {
-        ALOGV("pause");
-        Parcel data, reply;
-        data.writeInterfaceToken(BpMediaSource::getInterfaceDescriptor());
-        return remote()->transact(PAUSE, data, &reply);
+    void waitForReadAhead_l() {
+        ++mReadAheadGeneration; // a read in flight is discarded
+        while (mReadAheadBusy) {
+            mReadAheadCondition.wait(mReadAheadLock);
+        }
     }
 
-private:
+    void flushReadAhead_l() {
+        for (MediaBufferBase *buf : mReadAheadQueue) {
+            buf->release();
+        }
+        mReadAheadQueue.clear();
+        mReadAheadBytes = 0;
+        mReadAheadStatus = OK;
+    }
 
     uint32_t mBuffersSinceStop; // Buffer tracking variable
 
+    // Read-ahead, protected by mReadAheadLock. Enabled by setReadAhead().
+    Mutex mReadAheadLock;
+    Condition mReadAheadCondition;
+    sp<ReadAheadThread> mReadAheadThread;
+    size_t mReadAheadMaxBytes;          // 0 if disabled
+    int64_t mReadAheadMaxDurationUs;    // 0 if not limited by duration
+    std::list<MediaBufferBase *> mReadAheadQueue;
+    size_t mReadAheadBytes;
+    status_t mReadAheadStatus;          // of the last read ahead, OK if it can continue
+    bool mReadAheadActive;              // sequential reads, so the thread may read ahead
+    bool mReadAheadBusy;                // a readMultipleRemote() is in flight
+    int32_t mReadAheadGeneration;
+
     // NuPlayer passes pointers-to-metadata around, so we use this to keep the metadata alive
     // XXX: could we use this for caching, or does metadata change on the fly?
     sp<MetaData> mMetaData;
@@ -273,12 +487,31 @@ IMPLEMENT_META_INTERFACE(MediaSource, "android.media.IMediaSource");
 
 BnMediaSource::BnMediaSource()
     : mBuffersSinceStop(0)
-    , mGroup(new MediaBufferGroup(kBinderMediaBuffers /* growthLimit */)) {
+    , mGroup(new MediaBufferGroup(kBinderMediaBuffers /* growthLimit */))
+    , mTransferRingTried(false) {
 }
 
 BnMediaSource::~BnMediaSource() {
 }
 
+void BnMediaSource::createTransferRing(size_t length) {
+    mTransferRingTried = true;
+    size_t slotSize = length < SIZE_MAX / 3 * 2 ? length * 3 / 2 : length;
+    sp<MetaData> format = getFormat();
+    int32_t maxInputSize;
+    if (format != nullptr && format->findInt32(kKeyMaxInputSize, &maxInputSize)
+            && maxInputSize > 0 && (size_t)maxInputSize > slotSize) {
+        slotSize = maxInputSize;
+    }
+    if (slotSize > kTransferRingMaxSize / kBinderMediaBuffers) {
+        ALOGD("not using a transfer ring, slot size %zu too large", slotSize);
+        return;
+    }
+    ALOGV("transfer ring of %zu slots of size %zu", kBinderMediaBuffers, slotSize);
+    mGroup.reset(new MediaBufferGroup(
+            kBinderMediaBuffers, slotSize, kBinderMediaBuffers /* growthLimit */));
+}
+
 status_t BnMediaSource::onTransact(
     uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags)
 {
@@ -369,6 +602,10 @@ status_t BnMediaSource::onTransact(
                         transferBuf = buf;
                     } else {
                         ALOGV("Large buffer %zu without IMemory!", length);
+                        if (!mTransferRingTried) {
+                            // no buffer of mGroup was handed out yet.
+                            createTransferRing(length);
+                        }
                         ret = mGroup->acquire_buffer(
                                 (MediaBufferBase **)&transferBuf, false /* nonBlocking */, length);
                         if (ret != OK
@@ -60,7 +60,10 @@ private:
     friend class DrmSessionManagerTest;
 
     int64_t getTime_l();
+    void getSessionPids_l(Vector<int>* pids) const;
     bool getLowestPriority_l(int* lowestPriorityPid, int* lowestPriority);
+    bool getLowestPriority(
+            const Vector<int>& pids, int* lowestPriorityPid, int* lowestPriority);
     bool getLeastUsedSession_l(
             int pid, sp<DrmSessionClientInterface>* drm, Vector<uint8_t>* sessionId);
 
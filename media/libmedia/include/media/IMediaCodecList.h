@@ -19,7 +19,9 @@
 
 #include <utils/Errors.h>  // for status_t
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 #include <binder/Parcel.h>
+#include <utils/Mutex.h>
 
 #include <media/stagefright/foundation/AMessage.h>
 
@@ -52,6 +54,14 @@ public:
                                     const Parcel& data,
                                     Parcel* reply,
                                     uint32_t flags = 0);
+
+private:
+    // Returns the whole list serialized once into read only shared memory, which
+    // clients map to look codecs up without a transaction per query.
+    sp<IMemory> getImage();
+
+    Mutex mImageLock;
+    sp<IMemory> mImage;
 };
 
 }; // namespace android
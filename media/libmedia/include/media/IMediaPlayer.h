@@ -37,6 +37,7 @@ class Surface;
 class IDataSource;
 struct IStreamSource;
 class IGraphicBufferProducer;
+class IMemory;
 struct IMediaHTTPService;
 struct AudioPlaybackRate;
 struct AVSyncSettings;
@@ -136,6 +137,11 @@ public:
     virtual status_t        setOutputDevice(audio_port_handle_t deviceId) = 0;
     virtual status_t        getRoutedDeviceId(audio_port_handle_t *deviceId) = 0;
     virtual status_t        enableAudioDeviceCallback(bool enabled) = 0;
+
+    // Returns read only memory holding a MediaPlayerPlaybackStateShared (see
+    // private/media/MediaPlayerShared.h) kept up to date by the player, or NULL if the
+    // player does not publish its state.
+    virtual sp<IMemory>     getPlaybackStateMemory() = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -94,6 +94,14 @@ public:
     // until a subsequent read-with-seek. Currently only supported by
     // OMXCodec.
     virtual status_t pause()  = 0;
+
+    // Lets the proxy of a remote source read ahead on a thread of its own, up to
+    // |maxBytes| and, if positive, |maxDurationUs| of samples, so that sequential
+    // reads are served from buffers already delivered. Reads with a seek discard
+    // what was read ahead. A |maxBytes| of 0 disables read-ahead.
+    virtual status_t setReadAhead(size_t /* maxBytes */, int64_t /* maxDurationUs */) {
+        return ERROR_UNSUPPORTED;
+    }
 };
 
 class BnMediaSource: public BnInterface<IMediaSource>
@@ -129,6 +137,7 @@ public:
     static const size_t kTransferSharedAsSharedThreshold = 4 * 1024;  // if >= shared, else inline
     static const size_t kTransferInlineAsSharedThreshold = 8 * 1024; // if >= shared, else inline
     static const size_t kInlineMaxTransfer = 64 * 1024; // Binder size limited to BINDER_VM_SIZE.
+    static const size_t kTransferRingMaxSize = 32 * 1024 * 1024; // shared memory for all slots
 
 protected:
     virtual ~BnMediaSource();
@@ -137,6 +146,14 @@ private:
     uint32_t mBuffersSinceStop; // Buffer tracking variable
 
     std::unique_ptr<MediaBufferGroup> mGroup;
+    bool mTransferRingTried;
+
+    // Replaces the empty mGroup with kBinderMediaBuffers slots carved out of one
+    // shared memory region, sized for the largest sample of the track, so that large
+    // samples are copied into memory the client has already mapped instead of into
+    // newly allocated (and newly marshalled) IMemory whenever a sample outgrows its
+    // buffer. Only done once, before the group hands out any buffer.
+    void createTransferRing(size_t length);
 
     // To prevent marshalling IMemory with each read transaction, we cache the IMemory pointer
     // into a map.
@@ -52,6 +52,9 @@ public:
     virtual status_t getFrameAtIndex(
             std::vector<sp<IMemory> >* frames,
             int frameIndex, int numFrames, int colorFormat, bool metaOnly) = 0;
+    virtual status_t getFramesAtTimes(
+            std::vector<sp<IMemory> >* frames,
+            const std::vector<int64_t> &timesUs, int option, int colorFormat) = 0;
     virtual MediaAlbumArt* extractAlbumArt() = 0;
     virtual const char* extractMetadata(int keyCode) = 0;
 };
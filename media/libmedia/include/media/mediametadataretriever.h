@@ -101,6 +101,9 @@ public:
     status_t getFrameAtIndex(
             std::vector<sp<IMemory> > *frames, int frameIndex, int numFrames = 1,
             int colorFormat = HAL_PIXEL_FORMAT_RGB_565, bool metaOnly = false);
+    status_t getFramesAtTimes(
+            std::vector<sp<IMemory> > *frames, const std::vector<int64_t> &timesUs,
+            int option, int colorFormat = HAL_PIXEL_FORMAT_RGB_565);
     sp<IMemory> extractAlbumArt();
     const char* extractMetadata(int keyCode);
 
@@ -39,6 +39,8 @@ namespace android {
 
 struct AVSyncSettings;
 class IGraphicBufferProducer;
+struct MediaPlayerPlaybackState;
+struct MediaPlayerPlaybackStateShared;
 class Surface;
 
 enum media_event_type {
@@ -282,8 +284,13 @@ private:
             status_t        reset_l();
             status_t        doSetRetransmitEndpoint(const sp<IMediaPlayer>& player);
             status_t        checkStateForKeySet_l(int key);
+            bool            readPlaybackState_l(MediaPlayerPlaybackState *state) const;
 
     sp<IMediaPlayer>            mPlayer;
+    // state published by the player, to answer position and state queries without
+    // a binder call. NULL if the player does not publish it.
+    sp<IMemory>                 mPlaybackStateMemory;
+    const MediaPlayerPlaybackStateShared *mPlaybackState;
     thread_id_t                 mLockThreadId;
     Mutex                       mLock;
     Mutex                       mNotifyLock;
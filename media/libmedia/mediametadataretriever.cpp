@@ -193,6 +193,19 @@ status_t MediaMetadataRetriever::getFrameAtIndex(
             frames, frameIndex, numFrames, colorFormat, metaOnly);
 }
 
+status_t MediaMetadataRetriever::getFramesAtTimes(
+        std::vector<sp<IMemory> > *frames, const std::vector<int64_t> &timesUs,
+        int option, int colorFormat) {
+    ALOGV("getFramesAtTimes: %zu times, option(%d), colorFormat(%d)",
+            timesUs.size(), option, colorFormat);
+    Mutex::Autolock _l(mLock);
+    if (mRetriever == 0) {
+        ALOGE("retriever is not initialized");
+        return INVALID_OPERATION;
+    }
+    return mRetriever->getFramesAtTimes(frames, timesUs, option, colorFormat);
+}
+
 const char* MediaMetadataRetriever::extractMetadata(int keyCode)
 {
     ALOGV("extractMetadata(%d)", keyCode);
@@ -42,14 +42,21 @@
 
 #include <utils/KeyedVector.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 
 #include <system/audio.h>
 #include <system/window.h>
 
+#include <private/media/MediaPlayerShared.h>
+
 namespace android {
 
 using media::VolumeShaper;
 
+// How long a published position is extrapolated before asking the player again, which
+// also has it publish a fresh one. Bounds the drift from the audio clock.
+static const int64_t kMaxPlaybackStateAgeUs = 1000000ll;
+
 MediaPlayer::MediaPlayer()
 {
     ALOGV("constructor");
@@ -72,6 +79,7 @@ MediaPlayer::MediaPlayer()
     AudioSystem::acquireAudioSessionId(mAudioSessionId, -1);
     mSendLevel = 0;
     mRetransmitEndpointValid = false;
+    mPlaybackState = NULL;
 }
 
 MediaPlayer::~MediaPlayer()
@@ -94,6 +102,8 @@ void MediaPlayer::disconnect()
         Mutex::Autolock _l(mLock);
         p = mPlayer;
         mPlayer.clear();
+        mPlaybackState = NULL;
+        mPlaybackStateMemory.clear();
     }
 
     if (p != 0) {
@@ -125,6 +135,15 @@ status_t MediaPlayer::attachNewPlayer(const sp<IMediaPlayer>& player)
 {
     status_t err = UNKNOWN_ERROR;
     sp<IMediaPlayer> p;
+    sp<IMemory> stateMemory;
+    if (player != 0) {
+        stateMemory = player->getPlaybackStateMemory();
+        if (stateMemory != 0 && (stateMemory->pointer() == NULL
+                || stateMemory->size() < sizeof(MediaPlayerPlaybackStateShared))) {
+            ALOGW("ignoring invalid playback state memory");
+            stateMemory.clear();
+        }
+    }
     { // scope for the lock
         Mutex::Autolock _l(mLock);
 
@@ -137,6 +156,9 @@ status_t MediaPlayer::attachNewPlayer(const sp<IMediaPlayer>& player)
         clear_l();
         p = mPlayer;
         mPlayer = player;
+        mPlaybackStateMemory = stateMemory;
+        mPlaybackState = stateMemory == 0 ? NULL
+                : static_cast<const MediaPlayerPlaybackStateShared *>(stateMemory->pointer());
         if (player != 0) {
             mCurrentState = MEDIA_PLAYER_INITIALIZED;
             err = NO_ERROR;
@@ -399,7 +421,12 @@ bool MediaPlayer::isPlaying()
     Mutex::Autolock _l(mLock);
     if (mPlayer != 0) {
         bool temp = false;
-        mPlayer->isPlaying(&temp);
+        MediaPlayerPlaybackState state;
+        if (readPlaybackState_l(&state)) {
+            temp = state.mPlaying != 0;
+        } else {
+            mPlayer->isPlaying(&temp);
+        }
         ALOGV("isPlaying: %d", temp);
         if ((mCurrentState & MEDIA_PLAYER_STARTED) && ! temp) {
             ALOGE("internal/external state mismatch corrected");
@@ -501,11 +528,30 @@ status_t MediaPlayer::getCurrentPosition(int *msec)
             *msec = mCurrentPosition;
             return NO_ERROR;
         }
+        MediaPlayerPlaybackState state;
+        if (readPlaybackState_l(&state)) {
+            const int64_t ageUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000ll
+                    - state.mPositionTimeUs;
+            if (state.mSpeed == 0.f || ageUs <= kMaxPlaybackStateAgeUs) {
+                int64_t positionUs = state.mPositionUs + (int64_t)(ageUs * (double)state.mSpeed);
+                if (state.mDurationUs > 0 && positionUs > state.mDurationUs) {
+                    positionUs = state.mDurationUs;
+                }
+                *msec = (int)((positionUs < 0 ? 0 : positionUs + 500) / 1000);
+                return NO_ERROR;
+            }
+        }
         return mPlayer->getCurrentPosition(msec);
     }
     return INVALID_OPERATION;
 }
 
+// always call with lock held
+bool MediaPlayer::readPlaybackState_l(MediaPlayerPlaybackState *state) const
+{
+    return mPlaybackState != NULL && mPlaybackState->read(state);
+}
+
 status_t MediaPlayer::getDuration_l(int *msec)
 {
     ALOGV("getDuration_l");
@@ -90,6 +90,12 @@ BnStatus LWGraphicBufferSource::signalEndOfInputStream() {
     return toBinderStatus(mBase->signalEndOfInputStream());
 }
 
+BnStatus LWGraphicBufferSource::setMaxLatencyUs(
+        int64_t /* maxLatencyUs */) {
+    // not part of the HIDL interface
+    return BnStatus::fromStatusT(INVALID_OPERATION);
+}
+
 }  // namespace utils
 }  // namespace V1_0
 }  // namespace omx
@@ -41,6 +41,7 @@ namespace android {
 enum {
     GENERATE_UNIQUE_SESSIONID = IBinder::FIRST_CALL_TRANSACTION,
     SUBMIT_ITEM,
+    SUBMIT_ITEMS,
 };
 
 class BpMediaAnalyticsService: public BpInterface<IMediaAnalyticsService>
@@ -106,6 +107,28 @@ public:
         return sessionid;
     }
 
+    virtual status_t submitBatch(const std::vector<MediaAnalyticsItem *> &items)
+    {
+        Parcel data, reply;
+
+        if (items.empty()) {
+            return NO_ERROR;
+        }
+
+        data.writeInterfaceToken(IMediaAnalyticsService::getInterfaceDescriptor());
+        if (DEBUGGING_FLOW) {
+            ALOGD("client offers %zu records", items.size());
+        }
+        MediaAnalyticsItem::writeBatchToParcel(&data, items);
+
+        // nothing useful comes back, so don't wait for the service
+        status_t err = remote()->transact(SUBMIT_ITEMS, data, &reply, IBinder::FLAG_ONEWAY);
+        if (err != NO_ERROR) {
+            ALOGW("bad response from service for submitBatch, err=%d", err);
+        }
+        return err;
+    }
+
 };
 
 IMPLEMENT_META_INTERFACE(MediaAnalyticsService, "android.media.IMediaAnalyticsService");
@@ -156,11 +179,40 @@ status_t BnMediaAnalyticsService::onTransact(
             return NO_ERROR;
         } break;
 
+        case SUBMIT_ITEMS: {
+            CHECK_INTERFACE(IMediaAnalyticsService, data, reply);
+
+            std::vector<MediaAnalyticsItem *> items;
+            if (MediaAnalyticsItem::readBatchFromParcel(data, &items) != 0) {
+                ALOGW("dropping malformed batch from pid %d", clientPid);
+                for (MediaAnalyticsItem *item : items) {
+                    delete item;
+                }
+                return BAD_VALUE;
+            }
+            for (MediaAnalyticsItem *item : items) {
+                item->setPid(clientPid);
+                // submit() takes over ownership of 'item'
+                (void)submit(item, false);
+            }
+
+            return NO_ERROR;
+        } break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
 }
 
+status_t BnMediaAnalyticsService::submitBatch(const std::vector<MediaAnalyticsItem *> &items)
+{
+    for (MediaAnalyticsItem *item : items) {
+        // submit() takes over ownership of the copy
+        (void)submit(item->dup(), false);
+    }
+    return NO_ERROR;
+}
+
 // ----------------------------------------------------------------------------
 
 } // namespace android
@@ -21,6 +21,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+#include <map>
+#include <thread>
 
 #include <binder/Parcel.h>
 #include <utils/Errors.h>
@@ -776,6 +780,163 @@ int32_t MediaAnalyticsItem::writeToParcel0(Parcel *data) {
     return 0;
 }
 
+// batched records share one table of strings: the record keys, package names
+// and attribute names, which repeat across records of a batch.
+//static
+int32_t MediaAnalyticsItem::writeBatchToParcel(Parcel *data,
+                                               const std::vector<MediaAnalyticsItem *> &items) {
+    if (data == NULL) return -1;
+
+    std::map<std::string, int32_t> index;
+    std::vector<const char *> names;
+    auto lookup = [&](const char *name) {
+        auto it = index.find(name);
+        if (it != index.end()) {
+            return it->second;
+        }
+        const int32_t i = names.size();
+        index.emplace(name, i);
+        names.push_back(name);
+        return i;
+    };
+    for (MediaAnalyticsItem *item : items) {
+        lookup(item->mKey.c_str());
+        lookup(item->mPkgName.c_str());
+        for (size_t i = 0; i < item->mPropCount; i++) {
+            lookup(item->mProps[i].mName);
+        }
+    }
+
+    data->writeInt32(names.size());
+    for (const char *name : names) {
+        data->writeCString(name);
+    }
+
+    data->writeInt32(items.size());
+    for (MediaAnalyticsItem *item : items) {
+        data->writeInt32(lookup(item->mKey.c_str()));
+        data->writeInt32(item->mPid);
+        data->writeInt32(item->mUid);
+        data->writeInt32(lookup(item->mPkgName.c_str()));
+        data->writeInt64(item->mPkgVersionCode);
+        data->writeInt64(item->mSessionID);
+        data->writeInt64(item->mTimestamp);
+
+        data->writeInt32(item->mPropCount);
+        for (size_t i = 0; i < item->mPropCount; i++) {
+            Prop *prop = &item->mProps[i];
+            data->writeInt32(lookup(prop->mName));
+            data->writeInt32(prop->mType);
+            switch (prop->mType) {
+                case MediaAnalyticsItem::kTypeInt32:
+                        data->writeInt32(prop->u.int32Value);
+                        break;
+                case MediaAnalyticsItem::kTypeInt64:
+                        data->writeInt64(prop->u.int64Value);
+                        break;
+                case MediaAnalyticsItem::kTypeDouble:
+                        data->writeDouble(prop->u.doubleValue);
+                        break;
+                case MediaAnalyticsItem::kTypeRate:
+                        data->writeInt64(prop->u.rate.count);
+                        data->writeInt64(prop->u.rate.duration);
+                        break;
+                case MediaAnalyticsItem::kTypeCString:
+                        data->writeCString(prop->u.CStringValue);
+                        break;
+                default:
+                        // keep the reader in step
+                        ALOGE("found bad Prop type: %d, idx %zu, name %s",
+                              prop->mType, i, prop->mName);
+                        data->writeInt32(0);
+                        break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+//static
+int32_t MediaAnalyticsItem::readBatchFromParcel(const Parcel& data,
+                                                std::vector<MediaAnalyticsItem *> *items) {
+    const int32_t nameCount = data.readInt32();
+    if (nameCount < 0 || (size_t)nameCount > data.dataAvail()) {
+        ALOGE("bad batch name count: %d", nameCount);
+        return -1;
+    }
+    std::vector<const char *> names(nameCount);
+    for (int32_t i = 0; i < nameCount; i++) {
+        names[i] = data.readCString();
+        if (names[i] == NULL) {
+            return -1;
+        }
+    }
+    auto name = [&](int32_t i) -> const char * {
+        return i >= 0 && i < nameCount ? names[i] : NULL;
+    };
+
+    const int32_t count = data.readInt32();
+    if (count < 0 || (size_t)count > data.dataAvail()) {
+        ALOGE("bad batch item count: %d", count);
+        return -1;
+    }
+    for (int32_t n = 0; n < count; n++) {
+        const char *key = name(data.readInt32());
+        if (key == NULL) {
+            return -1;
+        }
+        MediaAnalyticsItem *item = MediaAnalyticsItem::create(key);
+        items->push_back(item);
+        item->mPid = data.readInt32();
+        item->mUid = data.readInt32();
+        const char *pkgName = name(data.readInt32());
+        if (pkgName == NULL) {
+            return -1;
+        }
+        item->mPkgName = pkgName;
+        item->mPkgVersionCode = data.readInt64();
+        item->mSessionID = data.readInt64();
+        item->mFinalized = 1;
+        item->mTimestamp = data.readInt64();
+
+        const int32_t propCount = data.readInt32();
+        for (int32_t i = 0; i < propCount; i++) {
+            MediaAnalyticsItem::Attr attr = name(data.readInt32());
+            int32_t ztype = data.readInt32();
+            if (attr == NULL) {
+                return -1;
+            }
+            switch (ztype) {
+                case MediaAnalyticsItem::kTypeInt32:
+                        item->setInt32(attr, data.readInt32());
+                        break;
+                case MediaAnalyticsItem::kTypeInt64:
+                        item->setInt64(attr, data.readInt64());
+                        break;
+                case MediaAnalyticsItem::kTypeDouble:
+                        item->setDouble(attr, data.readDouble());
+                        break;
+                case MediaAnalyticsItem::kTypeCString:
+                        item->setCString(attr, data.readCString());
+                        break;
+                case MediaAnalyticsItem::kTypeRate:
+                        {
+                            int64_t count = data.readInt64();
+                            int64_t duration = data.readInt64();
+                            item->setRate(attr, count, duration);
+                        }
+                        break;
+                default:
+                        ALOGE("reading bad item type: %d, idx %d", ztype, i);
+                        return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
 const char *MediaAnalyticsItem::toCString() {
    return toCString(PROTO_LAST);
 }
@@ -906,6 +1067,12 @@ bool MediaAnalyticsItem::selfrecord(bool forcenew) {
     sp<IMediaAnalyticsService> svc = getInstance();
 
     if (svc != NULL) {
+        if (!forcenew) {
+            queueRecord(dup());
+            return true;
+        }
+        // keep the order of this process' records
+        flushRecords();
         MediaAnalyticsItem::SessionID_t newid = svc->submit(this, forcenew);
         if (newid == SessionIDInvalid) {
             std::string p = this->toString();
@@ -918,6 +1085,69 @@ bool MediaAnalyticsItem::selfrecord(bool forcenew) {
     }
 }
 
+// Records waiting to be sent. Most clients record a handful of items at the end
+// of a playback or codec session, often several at once (codec, player, audio
+// track), so batching them saves binder transactions as well as parcel size.
+// Allocated once and never freed, as the flushing thread may outlive static
+// destructors at process exit.
+struct RecordBatch {
+    Mutex mLock;
+    std::vector<MediaAnalyticsItem *> mItems;
+    bool mFlushScheduled = false;
+};
+
+static RecordBatch *getRecordBatch() {
+    static RecordBatch *batch = new RecordBatch;
+    return batch;
+}
+
+const nsecs_t MediaAnalyticsItem::kBatchMaxDelayNs = 500000000LL;  // 500ms
+
+//static
+void MediaAnalyticsItem::queueRecord(MediaAnalyticsItem *item) {
+    RecordBatch *batch = getRecordBatch();
+    bool full = false;
+    {
+        Mutex::Autolock _l(batch->mLock);
+        batch->mItems.push_back(item);
+        full = batch->mItems.size() >= kBatchMaxItems;
+        if (!full && !batch->mFlushScheduled) {
+            batch->mFlushScheduled = true;
+            std::thread([]() {
+                usleep(kBatchMaxDelayNs / 1000);
+                flushRecords();
+            }).detach();
+        }
+    }
+    if (full) {
+        flushRecords();
+    }
+}
+
+//static
+void MediaAnalyticsItem::flushRecords() {
+    RecordBatch *batch = getRecordBatch();
+    std::vector<MediaAnalyticsItem *> items;
+    {
+        Mutex::Autolock _l(batch->mLock);
+        items.swap(batch->mItems);
+        batch->mFlushScheduled = false;
+    }
+    if (items.empty()) {
+        return;
+    }
+
+    sp<IMediaAnalyticsService> svc = getInstance();
+    if (svc == NULL) {
+        ALOGW("Failed to record %zu items: no service", items.size());
+    } else if (svc->submitBatch(items) != NO_ERROR) {
+        ALOGW("Failed to record %zu items", items.size());
+    }
+    for (MediaAnalyticsItem *item : items) {
+        delete item;
+    }
+}
+
 // get a connection we can reuse for most of our lifetime
 // static
 sp<IMediaAnalyticsService> MediaAnalyticsItem::sAnalyticsService;
@@ -27,6 +27,8 @@
 #include <utils/RefBase.h>
 #include <utils/List.h>
 
+#include <vector>
+
 #include <binder/IServiceManager.h>
 
 #include <media/MediaAnalyticsItem.h>
@@ -52,6 +54,11 @@ public:
     // caller continues to own the passed item
     virtual MediaAnalyticsItem::SessionID_t submit(MediaAnalyticsItem *item, bool forcenew) = 0;
 
+    // submit several records in one transaction, none of them closing
+    // an existing record.
+    // caller continues to own the passed items
+    virtual status_t submitBatch(const std::vector<MediaAnalyticsItem *> &items) = 0;
+
 };
 
 // ----------------------------------------------------------------------------
@@ -63,6 +70,9 @@ public:
                                     const Parcel& data,
                                     Parcel* reply,
                                     uint32_t flags = 0);
+
+    // for callers in the same process
+    virtual status_t submitBatch(const std::vector<MediaAnalyticsItem *> &items);
 };
 
 }; // namespace android
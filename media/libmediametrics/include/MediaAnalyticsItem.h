@@ -19,6 +19,7 @@
 
 #include <string>
 #include <sys/types.h>
+#include <vector>
 
 #include <cutils/properties.h>
 #include <utils/Errors.h>
@@ -147,8 +148,12 @@ class MediaAnalyticsItem {
         // parameter indicates whether to close any existing open
         // record with same key before establishing a new record
         // caller retains ownership of 'this'.
+        // records not closing an existing one are batched, and sent to the
+        // service together after a short delay.
         bool selfrecord(bool);
         bool selfrecord();
+        // send any batched records now
+        static void flushRecords();
 
         // remove indicated attributes and their values
         // filterNot() could also be called keepOnly()
@@ -182,6 +187,11 @@ class MediaAnalyticsItem {
         // our serialization code for binder calls
         int32_t writeToParcel(Parcel *);
         int32_t readFromParcel(const Parcel&);
+        // several records in one parcel; keys and attribute names are written
+        // once per batch, and records refer to them by index.
+        // caller continues to own the written items, and owns the read ones.
+        static int32_t writeBatchToParcel(Parcel *, const std::vector<MediaAnalyticsItem *> &);
+        static int32_t readBatchFromParcel(const Parcel&, std::vector<MediaAnalyticsItem *> *);
 
         // supports the stable interface
         bool dumpAttributes(char **pbuffer, size_t *plength);
@@ -225,6 +235,13 @@ class MediaAnalyticsItem {
         static sp<IMediaAnalyticsService> getInstance();
         static void dropInstance();
 
+        // client side batching for selfrecord()
+        enum {
+            kBatchMaxItems = 16,
+        };
+        static const nsecs_t kBatchMaxDelayNs;
+        static void queueRecord(MediaAnalyticsItem *item);
+
         // tracking information
         SessionID_t mSessionID;         // grouping similar records
         nsecs_t mTimestamp;             // ns, system_time_monotonic
@@ -237,6 +237,8 @@ NuPlayer2::NuPlayer2(
       mPrepared(false),
       mResetting(false),
       mSourceStarted(false),
+      mPrefetchNextSource(
+              property_get_bool("media.stagefright.nuplayer2.prefetch-next", true)),
       mAudioDecoderError(false),
       mVideoDecoderError(false),
       mPaused(false),
@@ -684,6 +686,10 @@ void NuPlayer2::onMessageReceived(const sp<AMessage> &msg) {
             CHECK(msg->findObject("source", &obj));
             if (obj != NULL) {
                 Mutex::Autolock autoLock(mSourceLock);
+                if (mNextSourceInfo.mSource != NULL) {
+                    // replaced before playback got to it; it may be reading ahead.
+                    mNextSourceInfo.mSource->stop();
+                }
                 CHECK(msg->findInt64("srcId", &mNextSourceInfo.mSrcId));
                 CHECK(msg->findInt64("startTimeUs", &mNextSourceInfo.mStartTimeUs));
                 CHECK(msg->findInt64("endTimeUs", &mNextSourceInfo.mEndTimeUs));
@@ -2731,10 +2737,18 @@ void NuPlayer2::onSourceNotify(const sp<AMessage> &msg) {
                     break;  // stale
                 }
 
+                int32_t err;
+                CHECK(msg->findInt32("err", &err));
+                // RTSP would start the session clock on the server, so it waits.
+                if (err == OK && mPrefetchNextSource
+                        && mNextSourceInfo.mDataSourceType != DATA_SOURCE_TYPE_RTSP) {
+                    // read ahead now; onStart() finds the first buffers queued.
+                    ALOGV("prefetching next source %lld", (long long)srcId);
+                    mNextSourceInfo.mSource->start();
+                }
+
                 sp<NuPlayer2Driver> driver = mDriver.promote();
                 if (driver != NULL) {
-                    int32_t err;
-                    CHECK(msg->findInt32("err", &err));
                     driver->notifyPrepareCompleted(srcId, err);
                 }
             }
@@ -2825,8 +2839,8 @@ void NuPlayer2::onSourceNotify(const sp<AMessage> &msg) {
 
         case Source::kWhatPauseOnBufferingStart:
         {
-            // ignore if not playing
-            if (mStarted) {
+            // ignore if not playing, or if it is the next source reading ahead
+            if (mStarted && srcId == mCurrentSourceInfo.mSrcId) {
                 ALOGI("buffer low, pausing...");
 
                 startRebufferingTimer();
@@ -2839,8 +2853,8 @@ void NuPlayer2::onSourceNotify(const sp<AMessage> &msg) {
 
         case Source::kWhatResumeOnBufferingEnd:
         {
-            // ignore if not playing
-            if (mStarted) {
+            // ignore if not playing, or if it is the next source reading ahead
+            if (mStarted && srcId == mCurrentSourceInfo.mSrcId) {
                 ALOGI("buffer ready, resuming...");
 
                 stopRebufferingTimer(false);
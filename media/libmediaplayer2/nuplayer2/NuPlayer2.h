@@ -261,6 +261,9 @@ private:
     bool mPrepared;
     bool mResetting;
     bool mSourceStarted;
+    // Start the next data source as soon as it is prepared, so that it has read its
+    // first buffers when playback switches to it.
+    const bool mPrefetchNextSource;
     bool mAudioDecoderError;
     bool mVideoDecoderError;
 
@@ -70,6 +70,7 @@
 #include <system/audio.h>
 
 #include <private/android_filesystem_config.h>
+#include <private/media/MediaPlayerShared.h>
 
 #include "ActivityManager.h"
 #include "MediaRecorderClient.h"
@@ -450,6 +451,9 @@ status_t MediaPlayerService::dump(int fd, const Vector<String16>& args)
                 }
             }
         }
+        write(fd, result.string(), result.size());
+        result = "\n";
+        MetadataRetrieverClient::dumpFrameCache(fd);
 
         result.append(" Files opened and/or mapped:\n");
         snprintf(buffer, SIZE, "/proc/%d/maps", getpid());
@@ -778,6 +782,9 @@ status_t MediaPlayerService::Client::setDataSource_post(
     if (status == OK) {
         Mutex::Autolock lock(mLock);
         mPlayer = p;
+        if (mPlaybackStateMemory != NULL) {
+            (void)p->setPlaybackStateMemory(mPlaybackStateMemory);
+        }
     }
     return status;
 }
@@ -1551,6 +1558,31 @@ status_t MediaPlayerService::Client::enableAudioDeviceCallback(bool enabled)
     return NO_INIT;
 }
 
+sp<IMemory> MediaPlayerService::Client::getPlaybackStateMemory()
+{
+    ALOGV("[%d] getPlaybackStateMemory", mConnId);
+    Mutex::Autolock l(mLock);
+    if (mPlayer == NULL) {
+        return NULL;
+    }
+    if (mPlaybackStateMemory == NULL) {
+        // mapped read only by the client, which only ever reads it. The player writes
+        // through the mapping of this process.
+        const size_t size = sizeof(MediaPlayerPlaybackStateShared);
+        sp<MemoryHeapBase> heap =
+                new MemoryHeapBase(size, MemoryHeapBase::READ_ONLY, "MediaPlayerState");
+        if (heap->getHeapID() < 0) {
+            ALOGE("[%d] could not allocate the playback state memory", mConnId);
+            return NULL;
+        }
+        mPlaybackStateMemory = new MemoryBase(heap, 0, size);
+    }
+    if (mPlayer->setPlaybackStateMemory(mPlaybackStateMemory) != OK) {
+        return NULL;
+    }
+    return mPlaybackStateMemory;
+}
+
 #if CALLBACK_ANTAGONIZER
 const int Antagonizer::interval = 10000; // 10 msecs
 
@@ -385,6 +385,7 @@ private:
         virtual status_t setOutputDevice(audio_port_handle_t deviceId);
         virtual status_t getRoutedDeviceId(audio_port_handle_t* deviceId);
         virtual status_t enableAudioDeviceCallback(bool enabled);
+        virtual sp<IMemory> getPlaybackStateMemory();
 
     private:
         class AudioDeviceUpdatedNotifier: public AudioSystem::AudioDeviceCallback
@@ -465,6 +466,7 @@ private:
                     bool                          mRetransmitEndpointValid;
                     sp<Client>                    mNextClient;
                     sp<MediaPlayerBase::Listener> mListener;
+                    sp<IMemory>                   mPlaybackStateMemory;
 
         // Metadata filters.
         media::Metadata::Filter mMetadataAllow;  // protected by mLock
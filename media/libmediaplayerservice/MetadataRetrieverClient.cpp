@@ -25,6 +25,8 @@
 #include <unistd.h>
 
 #include <string.h>
+#include <list>
+#include <map>
 #include <cutils/atomic.h>
 #include <cutils/properties.h>
 #include <binder/MemoryBase.h>
@@ -44,6 +46,90 @@
 
 namespace android {
 
+namespace {
+
+static const size_t kFrameCacheMaxBytes = 32 * 1024 * 1024;
+static const size_t kFrameCacheMaxEntries = 64;
+
+// Copies |frame| into new memory. Clients can write to the memory they receive,
+// so cached frames are never handed out themselves.
+static sp<IMemory> copyFrame(const sp<IMemory> &frame) {
+    size_t size = frame->size();
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(size, 0, "MetadataRetrieverClient");
+    if (heap->getHeapID() < 0) {
+        ALOGE("failed to allocate %zu bytes for a cached frame", size);
+        return NULL;
+    }
+    sp<IMemory> copy = new MemoryBase(heap, 0, size);
+    memcpy(copy->pointer(), frame->pointer(), size);
+    return copy;
+}
+
+// Decoded frames and images shared by all clients, so that apps asking for the
+// same thumbnail, e.g. while scrolling a gallery, don't each run a decoder.
+// Least recently used entries are evicted first.
+class FrameCache {
+public:
+    FrameCache() : mBytes(0), mHits(0), mMisses(0) {}
+
+    sp<IMemory> get(const String8 &key) {
+        Mutex::Autolock autoLock(mLock);
+        auto it = mIndex.find(key);
+        if (it == mIndex.end()) {
+            ++mMisses;
+            return NULL;
+        }
+        ++mHits;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return copyFrame(it->second->mFrame);
+    }
+
+    void put(const String8 &key, const sp<IMemory> &frame) {
+        sp<IMemory> copy;
+        if (frame->size() > kFrameCacheMaxBytes / 4 || (copy = copyFrame(frame)) == NULL) {
+            return;
+        }
+        Mutex::Autolock autoLock(mLock);
+        if (mIndex.find(key) != mIndex.end()) {
+            return;
+        }
+        mEntries.push_front({key, copy});
+        mIndex[key] = mEntries.begin();
+        mBytes += copy->size();
+        while (mBytes > kFrameCacheMaxBytes || mEntries.size() > kFrameCacheMaxEntries) {
+            mBytes -= mEntries.back().mFrame->size();
+            mIndex.erase(mEntries.back().mKey);
+            mEntries.pop_back();
+        }
+    }
+
+    void dump(String8 *result) {
+        Mutex::Autolock autoLock(mLock);
+        size_t requests = mHits + mMisses;
+        result->appendFormat(" Frame cache: %zu entries, %zu bytes, "
+                "%zu hits, %zu misses (%.1f%% hit rate)\n",
+                mEntries.size(), mBytes, mHits, mMisses,
+                requests > 0 ? mHits * 100. / requests : 0.);
+    }
+
+private:
+    struct Entry {
+        String8 mKey;
+        sp<IMemory> mFrame;
+    };
+
+    Mutex mLock;
+    std::list<Entry> mEntries;  // most recently used first
+    std::map<String8, std::list<Entry>::iterator> mIndex;
+    size_t mBytes;
+    size_t mHits;
+    size_t mMisses;
+};
+
+FrameCache gFrameCache;
+
+}  // namespace
+
 MetadataRetrieverClient::MetadataRetrieverClient(pid_t pid)
 {
     ALOGV("MetadataRetrieverClient constructor pid(%d)", pid);
@@ -71,12 +157,39 @@ status_t MetadataRetrieverClient::dump(int fd, const Vector<String16>& /*args*/)
     return NO_ERROR;
 }
 
+// static
+void MetadataRetrieverClient::dumpFrameCache(int fd)
+{
+    String8 result;
+    gFrameCache.dump(&result);
+    write(fd, result.string(), result.size());
+}
+
+sp<IMemory> MetadataRetrieverClient::getCachedFrame(const char *request)
+{
+    if (mContentKey.isEmpty()) {
+        return NULL;
+    }
+    sp<IMemory> frame = gFrameCache.get(mContentKey + request);
+    ALOGV("frame cache %s for %s%s", frame != NULL ? "hit" : "miss",
+            mContentKey.string(), request);
+    return frame;
+}
+
+void MetadataRetrieverClient::cacheFrame(const char *request, const sp<IMemory> &frame)
+{
+    if (!mContentKey.isEmpty()) {
+        gFrameCache.put(mContentKey + request, frame);
+    }
+}
+
 void MetadataRetrieverClient::disconnect()
 {
     ALOGV("disconnect from pid %d", mPid);
     Mutex::Autolock lock(mLock);
     mRetriever.clear();
     mAlbumArt.clear();
+    mContentKey.clear();
     IPCThreadState::self()->flushCommands();
 }
 
@@ -109,6 +222,7 @@ status_t MetadataRetrieverClient::setDataSource(
 {
     ALOGV("setDataSource(%s)", url);
     Mutex::Autolock lock(mLock);
+    mContentKey.clear();
     if (url == NULL) {
         return UNKNOWN_ERROR;
     }
@@ -127,7 +241,19 @@ status_t MetadataRetrieverClient::setDataSource(
     sp<MediaMetadataRetrieverBase> p = createRetriever(playerType);
     if (p == NULL) return NO_INIT;
     status_t ret = p->setDataSource(httpService, url, headers);
-    if (ret == NO_ERROR) mRetriever = p;
+    if (ret == NO_ERROR) {
+        mRetriever = p;
+        // only local files have a known content
+        const char *path = !strncasecmp(url, "file://", 7) ? url + 7 : url;
+        struct stat sb;
+        if (path[0] == '/' && (headers == NULL || headers->isEmpty())
+                && stat(path, &sb) == 0 && S_ISREG(sb.st_mode)) {
+            mContentKey = String8::format("%llu:%llu:%lld.%09ld:%lld:0:%lld",
+                    (unsigned long long)sb.st_dev, (unsigned long long)sb.st_ino,
+                    (long long)sb.st_mtim.tv_sec, (long)sb.st_mtim.tv_nsec,
+                    (long long)sb.st_size, (long long)sb.st_size);
+        }
+    }
     return ret;
 }
 
@@ -136,6 +262,7 @@ status_t MetadataRetrieverClient::setDataSource(int fd, int64_t offset, int64_t
     ALOGV("setDataSource fd=%d (%s), offset=%lld, length=%lld",
             fd, nameForFd(fd).c_str(), (long long) offset, (long long) length);
     Mutex::Autolock lock(mLock);
+    mContentKey.clear();
     struct stat sb;
     int ret = fstat(fd, &sb);
     if (ret != 0) {
@@ -169,7 +296,15 @@ status_t MetadataRetrieverClient::setDataSource(int fd, int64_t offset, int64_t
         return NO_INIT;
     }
     status_t status = p->setDataSource(fd, offset, length);
-    if (status == NO_ERROR) mRetriever = p;
+    if (status == NO_ERROR) {
+        mRetriever = p;
+        if (S_ISREG(sb.st_mode)) {
+            mContentKey = String8::format("%llu:%llu:%lld.%09ld:%lld:%lld:%lld",
+                    (unsigned long long)sb.st_dev, (unsigned long long)sb.st_ino,
+                    (long long)sb.st_mtim.tv_sec, (long)sb.st_mtim.tv_nsec,
+                    (long long)sb.st_size, (long long)offset, (long long)length);
+        }
+    }
     return status;
 }
 
@@ -178,6 +313,7 @@ status_t MetadataRetrieverClient::setDataSource(
 {
     ALOGV("setDataSource(IDataSource)");
     Mutex::Autolock lock(mLock);
+    mContentKey.clear();
 
     sp<DataSource> dataSource = CreateDataSourceFromIDataSource(source);
     player_type playerType =
@@ -203,11 +339,20 @@ sp<IMemory> MetadataRetrieverClient::getFrameAtTime(
         ALOGE("retriever is not initialized");
         return NULL;
     }
-    sp<IMemory> frame = mRetriever->getFrameAtTime(timeUs, option, colorFormat, metaOnly);
+    String8 request = String8::format("|frame:%lld:%d:%d",
+            (long long)timeUs, option, colorFormat);
+    sp<IMemory> frame;
+    if (!metaOnly && (frame = getCachedFrame(request.string())) != NULL) {
+        return frame;
+    }
+    frame = mRetriever->getFrameAtTime(timeUs, option, colorFormat, metaOnly);
     if (frame == NULL) {
         ALOGE("failed to capture a video frame");
         return NULL;
     }
+    if (!metaOnly) {
+        cacheFrame(request.string(), frame);
+    }
     return frame;
 }
 
@@ -221,11 +366,19 @@ sp<IMemory> MetadataRetrieverClient::getImageAtIndex(
         ALOGE("retriever is not initialized");
         return NULL;
     }
-    sp<IMemory> frame = mRetriever->getImageAtIndex(index, colorFormat, metaOnly, thumbnail);
+    String8 request = String8::format("|image:%d:%d:%d", index, colorFormat, thumbnail);
+    sp<IMemory> frame;
+    if (!metaOnly && (frame = getCachedFrame(request.string())) != NULL) {
+        return frame;
+    }
+    frame = mRetriever->getImageAtIndex(index, colorFormat, metaOnly, thumbnail);
     if (frame == NULL) {
         ALOGE("failed to extract image");
         return NULL;
     }
+    if (!metaOnly) {
+        cacheFrame(request.string(), frame);
+    }
     return frame;
 }
 
@@ -269,6 +422,26 @@ status_t MetadataRetrieverClient::getFrameAtIndex(
     return OK;
 }
 
+status_t MetadataRetrieverClient::getFramesAtTimes(
+            std::vector<sp<IMemory> > *frames,
+            const std::vector<int64_t> &timesUs, int option, int colorFormat) {
+    ALOGV("getFramesAtTimes: %zu times, option(%d), colorFormat(%d)",
+            timesUs.size(), option, colorFormat);
+    Mutex::Autolock lock(mLock);
+    Mutex::Autolock glock(sLock);
+    if (mRetriever == NULL) {
+        ALOGE("retriever is not initialized");
+        return INVALID_OPERATION;
+    }
+
+    status_t err = mRetriever->getFramesAtTimes(frames, timesUs, option, colorFormat);
+    if (err != OK) {
+        frames->clear();
+        return err;
+    }
+    return OK;
+}
+
 sp<IMemory> MetadataRetrieverClient::extractAlbumArt()
 {
     ALOGV("extractAlbumArt");
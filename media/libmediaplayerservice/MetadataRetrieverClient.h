@@ -59,11 +59,17 @@ public:
     virtual status_t getFrameAtIndex(
                 std::vector<sp<IMemory> > *frames,
                 int frameIndex, int numFrames, int colorFormat, bool metaOnly);
+    virtual status_t getFramesAtTimes(
+                std::vector<sp<IMemory> > *frames,
+                const std::vector<int64_t> &timesUs, int option, int colorFormat);
     virtual sp<IMemory>             extractAlbumArt();
     virtual const char*             extractMetadata(int keyCode);
 
     virtual status_t                dump(int fd, const Vector<String16>& args);
 
+    // Prints the state of the frame cache shared by all clients
+    static  void                    dumpFrameCache(int fd);
+
 private:
     friend class MediaPlayerService;
 
@@ -77,6 +83,13 @@ private:
 
     // Keep the shared memory copy of album art
     sp<IMemory>                            mAlbumArt;
+
+    // Identifies the content of the data source for the frame cache, empty
+    // if frames of this source are not cached
+    String8                                mContentKey;
+
+    sp<IMemory> getCachedFrame(const char *request);
+    void cacheFrame(const char *request, const sp<IMemory> &frame);
 };
 
 }; // namespace android
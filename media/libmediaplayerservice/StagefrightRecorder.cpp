@@ -23,6 +23,7 @@
 #include "StagefrightRecorder.h"
 
 #include <algorithm>
+#include <future>
 
 #include <android-base/properties.h>
 #include <android/hardware/ICamera.h>
@@ -97,6 +98,14 @@ static const char *kRecorderVideoMime = "android.media.mediarecorder.video.mime"
 static const char *kRecorderDurationMs = "android.media.mediarecorder.durationMs";
 static const char *kRecorderPaused = "android.media.mediarecorder.pausedMs";
 static const char *kRecorderNumPauses = "android.media.mediarecorder.NPauses";
+static const char *kRecorderVideoSourceSetupMs =
+        "android.media.mediarecorder.startup.video-source-ms";
+static const char *kRecorderVideoEncoderSetupMs =
+        "android.media.mediarecorder.startup.video-encoder-ms";
+static const char *kRecorderAudioEncoderSetupMs =
+        "android.media.mediarecorder.startup.audio-encoder-ms";
+static const char *kRecorderWriterStartMs = "android.media.mediarecorder.startup.writer-start-ms";
+static const char *kRecorderFirstFrameMs = "android.media.mediarecorder.startup.first-frame-ms";
 
 
 // To collect the encoder usage for the battery app
@@ -193,6 +202,46 @@ void StagefrightRecorder::updateMetrics() {
         mAnalyticsItem->setInt64(kRecorderPaused, (mDurationPausedUs+500)/1000 );
         mAnalyticsItem->setInt32(kRecorderNumPauses, mNPauses);
     }
+
+    // start-up latency, by step
+    if (mVideoSourceSetupUs >= 0) {
+        mAnalyticsItem->setInt64(kRecorderVideoSourceSetupMs, (mVideoSourceSetupUs+500)/1000);
+    }
+    if (mVideoEncoderSetupUs >= 0) {
+        mAnalyticsItem->setInt64(kRecorderVideoEncoderSetupMs, (mVideoEncoderSetupUs+500)/1000);
+    }
+    if (mAudioEncoderSetupUs >= 0) {
+        mAnalyticsItem->setInt64(kRecorderAudioEncoderSetupMs, (mAudioEncoderSetupUs+500)/1000);
+    }
+    if (mWriterStartUs >= 0) {
+        mAnalyticsItem->setInt64(kRecorderWriterStartMs, (mWriterStartUs+500)/1000);
+    }
+    int64_t firstFrameDelayUs = getFirstFrameDelayUs();
+    if (firstFrameDelayUs >= 0) {
+        mAnalyticsItem->setInt64(kRecorderFirstFrameMs, (firstFrameDelayUs+500)/1000);
+    }
+}
+
+void StagefrightRecorder::resetStartupTimes() {
+    mStartCalledUs = -1;
+    mVideoSourceSetupUs = -1;
+    mVideoEncoderSetupUs = -1;
+    mAudioEncoderSetupUs = -1;
+    mWriterStartUs = -1;
+}
+
+// Time from start() to the first encoded frame, of the video track if there is one.
+int64_t StagefrightRecorder::getFirstFrameDelayUs() const {
+    sp<MediaCodecSource> source =
+            mVideoEncoderSource != NULL ? mVideoEncoderSource : mAudioEncoderSource;
+    if (source == NULL || mStartCalledUs < 0) {
+        return -1;
+    }
+    int64_t firstOutputUs = source->getFirstOutputSystemTimeUs();
+    if (firstOutputUs < mStartCalledUs) {
+        return -1;
+    }
+    return firstOutputUs - mStartCalledUs;
 }
 
 void StagefrightRecorder::flushAndResetMetrics(bool reinitialize) {
@@ -630,6 +679,17 @@ status_t StagefrightRecorder::setParamVideoIFramesInterval(int32_t seconds) {
     return OK;
 }
 
+status_t StagefrightRecorder::setParamFragmentDuration(int64_t durationUs) {
+    ALOGV("setParamFragmentDuration: %" PRId64 " us", durationUs);
+    if (durationUs != 0 && (durationUs <= 500000 || durationUs >= 10000000)) {
+        // fragments are buffered like interleaved chunks, see setParamInterleaveDuration()
+        ALOGE("Fragment duration is out of range: %" PRId64 " us", durationUs);
+        return BAD_VALUE;
+    }
+    mFragmentDurationUs = durationUs;
+    return OK;
+}
+
 status_t StagefrightRecorder::setParam64BitFileOffset(bool use64Bit) {
     ALOGV("setParam64BitFileOffset: %s",
         use64Bit? "use 64 bit file offset": "use 32 bit file offset");
@@ -779,6 +839,11 @@ status_t StagefrightRecorder::setParameter(
         if (safe_strtoi32(value.string(), &timeScale)) {
             return setParamMovieTimeScale(timeScale);
         }
+    } else if (key == "param-fragment-duration-us") {
+        int64_t durationUs;
+        if (safe_strtoi64(value.string(), &durationUs)) {
+            return setParamFragmentDuration(durationUs);
+        }
     } else if (key == "param-use-64bit-offset") {
         int32_t use64BitOffset;
         if (safe_strtoi32(value.string(), &use64BitOffset)) {
@@ -990,6 +1055,7 @@ status_t StagefrightRecorder::start() {
     }
 
     status_t status = OK;
+    mStartCalledUs = systemTime() / 1000;
 
     if (mVideoSource != VIDEO_SOURCE_SURFACE) {
         status = prepareInternal();
@@ -1003,6 +1069,7 @@ status_t StagefrightRecorder::start() {
         return UNKNOWN_ERROR;
     }
 
+    int64_t writerStartUs = systemTime() / 1000;
     switch (mOutputFormat) {
         case OUTPUT_FORMAT_DEFAULT:
         case OUTPUT_FORMAT_THREE_GPP:
@@ -1045,6 +1112,8 @@ status_t StagefrightRecorder::start() {
     if (status != OK) {
         mWriter.clear();
         mWriter = NULL;
+    } else {
+        mWriterStartUs = systemTime() / 1000 - writerStartUs;
     }
 
     if ((status == OK) && (!mStarted)) {
@@ -1068,6 +1137,22 @@ status_t StagefrightRecorder::start() {
 }
 
 sp<MediaCodecSource> StagefrightRecorder::createAudioSource() {
+    AString mime;
+    sp<MediaCodecSource> audioEncoder = createAudioSourceWithoutMetrics(&mime);
+    if (!mime.empty()) {
+        logAudioMime(mime);
+    }
+    return audioEncoder;
+}
+
+void StagefrightRecorder::logAudioMime(const AString &mime) {
+    // log audio mime type for media metrics
+    if (mAnalyticsItem != NULL) {
+        mAnalyticsItem->setCString(kRecorderAudioMime, mime.c_str());
+    }
+}
+
+sp<MediaCodecSource> StagefrightRecorder::createAudioSourceWithoutMetrics(AString *mime) {
     int32_t sourceSampleRate = mSampleRate;
 
     if (mCaptureFpsEnable && mCaptureFps >= mFrameRate) {
@@ -1137,13 +1222,7 @@ sp<MediaCodecSource> StagefrightRecorder::createAudioSource() {
             return NULL;
     }
 
-    // log audio mime type for media metrics
-    if (mAnalyticsItem != NULL) {
-        AString audiomime;
-        if (format->findString("mime", &audiomime)) {
-            mAnalyticsItem->setCString(kRecorderAudioMime, audiomime.c_str());
-        }
-    }
+    CHECK(format->findString("mime", mime));
 
     int32_t maxInputSize;
     CHECK(audioSource->getFormat()->findInt32(
@@ -1839,7 +1918,7 @@ status_t StagefrightRecorder::setupVideoEncoder(
     return OK;
 }
 
-status_t StagefrightRecorder::setupAudioEncoder(const sp<MediaWriter>& writer) {
+status_t StagefrightRecorder::checkAudioEncoder() {
     status_t status = BAD_VALUE;
     if (OK != (status = checkAudioEncoderCapabilities())) {
         return status;
@@ -1858,6 +1937,14 @@ status_t StagefrightRecorder::setupAudioEncoder(const sp<MediaWriter>& writer) {
             ALOGE("Unsupported audio encoder: %d", mAudioEncoder);
             return UNKNOWN_ERROR;
     }
+    return OK;
+}
+
+status_t StagefrightRecorder::setupAudioEncoder(const sp<MediaWriter>& writer) {
+    status_t status = checkAudioEncoder();
+    if (status != OK) {
+        return status;
+    }
 
     sp<MediaCodecSource> audioEncoder = createAudioSource();
     if (audioEncoder == NULL) {
@@ -1882,22 +1969,53 @@ status_t StagefrightRecorder::setupMPEG4orWEBMRecording() {
         writer = mp4writer = new MPEG4Writer(mOutputFd);
     }
 
+    // disable audio for time lapse recording
+    const bool disableAudio = mCaptureFpsEnable && mCaptureFps < mFrameRate;
+    const bool hasAudio = !disableAudio && mAudioSource != AUDIO_SOURCE_CNT;
+
+    // Opening the audio input and allocating the audio codec does not depend on the video
+    // set-up, so do it while the camera and the video codec are being brought up. The audio
+    // track is still added last, see below. |audioMime| must outlive |audioEncoderFuture|,
+    // whose destructor waits for the set-up to finish on the early returns.
+    AString audioMime;
+    int64_t audioSetupUs = -1;
+    std::future<sp<MediaCodecSource>> audioEncoderFuture;
+    if (hasAudio) {
+        err = checkAudioEncoder();
+        if (err != OK) {
+            return err;
+        }
+        audioEncoderFuture = std::async(std::launch::async, [this, &audioMime, &audioSetupUs] {
+            int64_t setupStartUs = systemTime() / 1000;
+            sp<MediaCodecSource> audioEncoder = createAudioSourceWithoutMetrics(&audioMime);
+            audioSetupUs = systemTime() / 1000 - setupStartUs;
+            return audioEncoder;
+        });
+    }
+
     if (mVideoSource < VIDEO_SOURCE_LIST_END) {
         setDefaultVideoEncoderIfNecessary();
 
+        int64_t setupStartUs = systemTime() / 1000;
         sp<MediaSource> mediaSource;
         err = setupMediaSource(&mediaSource);
         if (err != OK) {
             return err;
         }
+        int64_t sourceReadyUs = systemTime() / 1000;
+        mVideoSourceSetupUs = sourceReadyUs - setupStartUs;
 
         sp<MediaCodecSource> encoder;
         err = setupVideoEncoder(mediaSource, &encoder);
         if (err != OK) {
             return err;
         }
+        mVideoEncoderSetupUs = systemTime() / 1000 - sourceReadyUs;
 
         writer->addSource(encoder);
+        if (mp4writer != NULL) {
+            mp4writer->setBackpressureNotify(encoder->getBackpressureNotify());
+        }
         mVideoEncoderSource = encoder;
         mTotalBitRate += mVideoBitRate;
     }
@@ -1905,11 +2023,17 @@ status_t StagefrightRecorder::setupMPEG4orWEBMRecording() {
     // Audio source is added at the end if it exists.
     // This help make sure that the "recoding" sound is suppressed for
     // camcorder applications in the recorded files.
-    // disable audio for time lapse recording
-    const bool disableAudio = mCaptureFpsEnable && mCaptureFps < mFrameRate;
-    if (!disableAudio && mAudioSource != AUDIO_SOURCE_CNT) {
-        err = setupAudioEncoder(writer);
-        if (err != OK) return err;
+    if (hasAudio) {
+        sp<MediaCodecSource> audioEncoder = audioEncoderFuture.get();
+        mAudioEncoderSetupUs = audioSetupUs;
+        if (!audioMime.empty()) {
+            logAudioMime(audioMime);
+        }
+        if (audioEncoder == NULL) {
+            return UNKNOWN_ERROR;
+        }
+        writer->addSource(audioEncoder);
+        mAudioEncoderSource = audioEncoder;
         mTotalBitRate += mAudioBitRate;
     }
 
@@ -1957,6 +2081,9 @@ void StagefrightRecorder::setupMPEG4orWEBMMetaData(sp<MetaData> *meta) {
     }
     if (mOutputFormat != OUTPUT_FORMAT_WEBM) {
         (*meta)->setInt32(kKey64BitFileOffset, mUse64BitFileOffset);
+        if (mFragmentDurationUs > 0) {
+            (*meta)->setInt64(kKeyFragmentDurationUs, mFragmentDurationUs);
+        }
         if (mTrackEveryTimeDurationUs > 0) {
             (*meta)->setInt64(kKeyTrackTimeStatus, mTrackEveryTimeDurationUs);
         }
@@ -2106,6 +2233,7 @@ status_t StagefrightRecorder::stop() {
     mTotalPausedDurationUs = 0;
     mPauseStartTimeUs = 0;
     mStartedRecordingUs = 0;
+    resetStartupTimes();
 
     mGraphicBufferProducer.clear();
     mPersistentSurface.clear();
@@ -2164,6 +2292,7 @@ status_t StagefrightRecorder::reset() {
     mIFramesIntervalSec = 1;
     mAudioSourceNode = 0;
     mUse64BitFileOffset = false;
+    mFragmentDurationUs = 0;
     mMovieTimeScale  = -1;
     mAudioTimeScale  = -1;
     mVideoTimeScale  = -1;
@@ -2189,6 +2318,7 @@ status_t StagefrightRecorder::reset() {
     mStartedRecordingUs = 0;
     mDurationPausedUs = 0;
     mNPauses = 0;
+    resetStartupTimes();
 
     mOutputFd = -1;
 
@@ -2328,6 +2458,8 @@ status_t StagefrightRecorder::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     Interleave duration (us): %d\n", mInterleaveDurationUs);
     result.append(buffer);
+    snprintf(buffer, SIZE, "     Fragment duration (us): %" PRId64 "\n", mFragmentDurationUs);
+    result.append(buffer);
     snprintf(buffer, SIZE, "     Progress notification: %" PRId64 " us\n", mTrackEveryTimeDurationUs);
     result.append(buffer);
     snprintf(buffer, SIZE, "   Audio\n");
@@ -2366,6 +2498,15 @@ status_t StagefrightRecorder::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     Bit rate (bps): %d\n", mVideoBitRate);
     result.append(buffer);
+    snprintf(buffer, SIZE, "   Start-up (us, -1 if not measured)\n");
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     Video source: %" PRId64 ", video encoder: %" PRId64
+            ", audio encoder: %" PRId64 "\n",
+            mVideoSourceSetupUs, mVideoEncoderSetupUs, mAudioEncoderSetupUs);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "     Writer start: %" PRId64 ", first frame after start: %" PRId64 "\n",
+            mWriterStartUs, getFirstFrameDelayUs());
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     return OK;
 }
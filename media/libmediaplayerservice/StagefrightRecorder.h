@@ -29,6 +29,7 @@
 
 namespace android {
 
+struct AString;
 class Camera;
 class ICameraRecordingProxy;
 class CameraSource;
@@ -98,6 +99,8 @@ private:
     MediaAnalyticsItem *mAnalyticsItem;
     bool mAnalyticsDirty;
     void flushAndResetMetrics(bool reinitialize);
+    void resetStartupTimes();
+    int64_t getFirstFrameDelayUs() const;
     void updateMetrics();
 
     audio_source_t mAudioSource;
@@ -113,6 +116,7 @@ private:
     int32_t mAudioChannels;
     int32_t mSampleRate;
     int32_t mInterleaveDurationUs;
+    int64_t mFragmentDurationUs;  // fragmented MP4 when > 0
     int32_t mIFramesIntervalSec;
     int32_t mCameraId;
     int32_t mVideoEncoderProfile;
@@ -134,6 +138,13 @@ private:
     int64_t mDurationPausedUs;
     int32_t mNPauses;
 
+    // how long the start-up steps took (us), -1 if not measured
+    int64_t mStartCalledUs;
+    int64_t mVideoSourceSetupUs;
+    int64_t mVideoEncoderSetupUs;
+    int64_t mAudioEncoderSetupUs;
+    int64_t mWriterStartUs;
+
     bool mCaptureFpsEnable;
     double mCaptureFps;
     int64_t mTimeBetweenCaptureUs;
@@ -176,6 +187,10 @@ private:
     status_t setupRTPRecording();
     status_t setupMPEG2TSRecording();
     sp<MediaCodecSource> createAudioSource();
+    // Same as createAudioSource(), without logging to mAnalyticsItem, so that it can run
+    // concurrently with the video encoder set-up. Returns the encoder mime in |mime|.
+    sp<MediaCodecSource> createAudioSourceWithoutMetrics(AString *mime);
+    void logAudioMime(const AString &mime);
     status_t checkVideoEncoderCapabilities();
     status_t checkAudioEncoderCapabilities();
     // Generic MediaSource set-up. Returns the appropriate
@@ -183,6 +198,7 @@ private:
     // depending on the videosource type
     status_t setupMediaSource(sp<MediaSource> *mediaSource);
     status_t setupCameraSource(sp<CameraSource> *cameraSource);
+    status_t checkAudioEncoder();
     status_t setupAudioEncoder(const sp<MediaWriter>& writer);
     status_t setupVideoEncoder(const sp<MediaSource>& cameraSource, sp<MediaCodecSource> *source);
 
@@ -204,6 +220,7 @@ private:
     status_t setParamTrackTimeStatus(int64_t timeDurationUs);
     status_t setParamInterleaveDuration(int32_t durationUs);
     status_t setParam64BitFileOffset(bool use64BitFileOffset);
+    status_t setParamFragmentDuration(int64_t durationUs);
     status_t setParamMaxFileDurationUs(int64_t timeUs);
     status_t setParamMaxFileSizeBytes(int64_t bytes);
     status_t setParamMovieTimeScale(int32_t timeScale);
@@ -43,6 +43,7 @@ class DataSource;
 class Parcel;
 class Surface;
 class IGraphicBufferProducer;
+class IMemory;
 
 template<typename T> class SortedVector;
 
@@ -252,6 +253,12 @@ public:
         return OK;
     }
 
+    // Memory holding a MediaPlayerPlaybackStateShared the player keeps up to date,
+    // so that the client can read position and state without a binder call.
+    virtual status_t setPlaybackStateMemory(const sp<IMemory>& /* memory */) {
+        return INVALID_OPERATION;
+    }
+
     // Invoke a generic method on the player by using opaque parcels
     // for the request and reply.
     //
@@ -17,6 +17,8 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "GenericSource"
 
+#include <algorithm>
+
 #include "GenericSource.h"
 #include "NuPlayerDrm.h"
 
@@ -51,6 +53,15 @@ static const int kInitialMarkMs        = 5000;  // 5secs
 //static const int kPausePlaybackMarkMs  = 2000;  // 2secs
 static const int kResumePlaybackMarkMs = 15000;  // 15secs
 
+// Local audio and video are read ahead in batches of about this much media time, which
+// go to the packet source at once, to save looper round trips and small reads.
+static const int64_t kReadBatchDurationUs = 500000ll;
+static const size_t kMaxReadBatchBuffers = 128;
+// read-ahead of remote extractor tracks, see IMediaSource::setReadAhead()
+static const size_t kAudioReadAheadMaxBytes = 512 * 1024;
+static const size_t kVideoReadAheadMaxBytes = 8 * 1024 * 1024;
+static const int64_t kReadAheadDurationUs = 1000000ll;
+
 NuPlayer::GenericSource::GenericSource(
         const sp<AMessage> &notify,
         bool uidValid,
@@ -235,6 +246,7 @@ status_t NuPlayer::GenericSource::initFromDataSource() {
                 mAudioTrack.mSource = track;
                 mAudioTrack.mPackets =
                     new AnotherPacketSource(mAudioTrack.mSource->getFormat());
+                (void)track->setReadAhead(kAudioReadAheadMaxBytes, kReadAheadDurationUs);
 
                 if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_VORBIS)) {
                     mAudioIsVorbis = true;
@@ -250,6 +262,7 @@ status_t NuPlayer::GenericSource::initFromDataSource() {
                 mVideoTrack.mSource = track;
                 mVideoTrack.mPackets =
                     new AnotherPacketSource(mVideoTrack.mSource->getFormat());
+                (void)track->setReadAhead(kVideoReadAheadMaxBytes, kReadAheadDurationUs);
 
                 // video always at the beginning
                 mMimes.insertAt(String8(mime), 0);
@@ -343,6 +356,26 @@ bool NuPlayer::GenericSource::isStreaming() const {
     return mIsStreaming;
 }
 
+sp<AMessage> NuPlayer::GenericSource::getStats() const {
+    Mutex::Autolock _l(mLock);
+    sp<AMessage> stats = new AMessage;
+    for (int i = 0; i < 2; ++i) {
+        const char *prefix = i == 0 ? "audio" : "video";
+        const ReadStats &readStats = i == 0 ? mAudioReadStats : mVideoReadStats;
+        if (readStats.mNumReads == 0) {
+            continue;
+        }
+        stats->setInt64(AStringPrintf("%s-reads", prefix).c_str(), readStats.mNumReads);
+        stats->setInt64(AStringPrintf("%s-read-buffers", prefix).c_str(),
+                readStats.mNumBuffers);
+        stats->setInt64(AStringPrintf("%s-read-avg-us", prefix).c_str(),
+                readStats.mTotalReadUs / readStats.mNumReads);
+        stats->setInt64(AStringPrintf("%s-read-max-us", prefix).c_str(),
+                readStats.mMaxReadUs);
+    }
+    return stats;
+}
+
 NuPlayer::GenericSource::~GenericSource() {
     ALOGV("~GenericSource");
     if (mLooper != NULL) {
@@ -1335,14 +1368,17 @@ void NuPlayer::GenericSource::readBuffer(
         media_track_type trackType, int64_t seekTimeUs, MediaPlayerSeekMode mode,
         int64_t *actualTimeUs, bool formatChange) {
     Track *track;
+    ReadStats *readStats = NULL;
     size_t maxBuffers = 1;
     switch (trackType) {
         case MEDIA_TRACK_TYPE_VIDEO:
             track = &mVideoTrack;
+            readStats = &mVideoReadStats;
             maxBuffers = 8;  // too large of a number may influence seeks
             break;
         case MEDIA_TRACK_TYPE_AUDIO:
             track = &mAudioTrack;
+            readStats = &mAudioReadStats;
             maxBuffers = 64;
             break;
         case MEDIA_TRACK_TYPE_SUBTITLE:
@@ -1377,16 +1413,24 @@ void NuPlayer::GenericSource::readBuffer(
         options.setNonBlocking();
     }
 
+    // Seeks and track changes read as little as before, so that they complete quickly.
+    const bool batched = !mIsStreaming && !seeking && !formatChange && readStats != NULL;
+    const size_t batchLimit = batched ? kMaxReadBatchBuffers : maxBuffers;
+    List<sp<ABuffer> > batch;
+    int64_t batchStartTimeUs = 0;
+    int64_t batchEndTimeUs = INT64_MIN;
+
     int32_t generation = getDataGeneration(trackType);
-    for (size_t numBuffers = 0; numBuffers < maxBuffers; ) {
+    for (size_t numBuffers = 0; numBuffers < batchLimit; ) {
         Vector<MediaBufferBase *> mediaBuffers;
         status_t err = NO_ERROR;
 
         sp<IMediaSource> source = track->mSource;
         mLock.unlock();
+        const int64_t readStartUs = ALooper::GetNowUs();
         if (couldReadMultiple) {
             err = source->readMultiple(
-                    &mediaBuffers, maxBuffers - numBuffers, &options);
+                    &mediaBuffers, std::min(maxBuffers, batchLimit - numBuffers), &options);
         } else {
             MediaBufferBase *mbuf = NULL;
             err = source->read(&mbuf, &options);
@@ -1394,8 +1438,16 @@ void NuPlayer::GenericSource::readBuffer(
                 mediaBuffers.push_back(mbuf);
             }
         }
+        const int64_t readUs = ALooper::GetNowUs() - readStartUs;
         mLock.lock();
 
+        if (readStats != NULL) {
+            ++readStats->mNumReads;
+            readStats->mNumBuffers += mediaBuffers.size();
+            readStats->mTotalReadUs += readUs;
+            readStats->mMaxReadUs = std::max(readStats->mMaxReadUs, readUs);
+        }
+
         options.clearNonPersistent();
 
         size_t id = 0;
@@ -1406,6 +1458,7 @@ void NuPlayer::GenericSource::readBuffer(
             for (; id < count; ++id) {
                 mediaBuffers[id]->release();
             }
+            batch.clear();
             break;
         }
 
@@ -1414,6 +1467,8 @@ void NuPlayer::GenericSource::readBuffer(
             MediaBufferBase *mbuf = mediaBuffers[id];
             if (!mbuf->meta_data().findInt64(kKeyTime, &timeUs)) {
                 mbuf->meta_data().dumpToLog();
+                track->mPackets->queueAccessUnits(batch);
+                batch.clear();
                 track->mPackets->signalEOS(ERROR_MALFORMED);
                 break;
             }
@@ -1439,7 +1494,15 @@ void NuPlayer::GenericSource::readBuffer(
                 }
             }
 
-            track->mPackets->queueAccessUnit(buffer);
+            if (batched) {
+                batch.push_back(buffer);
+                if (numBuffers == 0) {
+                    batchStartTimeUs = timeUs;
+                }
+                batchEndTimeUs = std::max(batchEndTimeUs, timeUs);
+            } else {
+                track->mPackets->queueAccessUnit(buffer);
+            }
             formatChange = false;
             seeking = false;
             ++numBuffers;
@@ -1462,10 +1525,20 @@ void NuPlayer::GenericSource::readBuffer(
                     false /* discard */);
 #endif
         } else if (err != OK) {
+            track->mPackets->queueAccessUnits(batch);
+            batch.clear();
             queueDiscontinuityIfNeeded(seeking, formatChange, trackType, track);
             track->mPackets->signalEOS(err);
             break;
         }
+
+        if (numBuffers >= maxBuffers
+                && (!batched || batchEndTimeUs - batchStartTimeUs >= kReadBatchDurationUs)) {
+            break;
+        }
+    }
+    if (!batch.empty()) {
+        track->mPackets->queueAccessUnits(batch);
     }
 
     if (mIsStreaming
@@ -85,6 +85,8 @@ struct NuPlayer::GenericSource : public NuPlayer::Source,
 
     virtual bool isStreaming() const;
 
+    virtual sp<AMessage> getStats() const;
+
     // Modular DRM
     virtual void signalBufferReturned(MediaBufferBase *buffer);
 
@@ -124,6 +126,21 @@ private:
         sp<AnotherPacketSource> mPackets;
     };
 
+    // time spent in IMediaSource reads, for dump()
+    struct ReadStats {
+        int64_t mNumReads;
+        int64_t mNumBuffers;
+        int64_t mTotalReadUs;
+        int64_t mMaxReadUs;
+
+        ReadStats()
+            : mNumReads(0),
+              mNumBuffers(0),
+              mTotalReadUs(0),
+              mMaxReadUs(0) {
+        }
+    };
+
     Vector<sp<IMediaSource> > mSources;
     Track mAudioTrack;
     int64_t mAudioTimeUs;
@@ -133,6 +150,8 @@ private:
     int64_t mVideoLastDequeueTimeUs;
     Track mSubtitleTrack;
     Track mTimedTextTrack;
+    ReadStats mAudioReadStats;
+    ReadStats mVideoReadStats;
 
     BufferingSettings mBufferingSettings;
     int32_t mPrevBufferPercentage;
@@ -184,6 +184,13 @@ sp<AMessage> NuPlayer::HTTPLiveSource::getTrackInfo(size_t trackIndex) const {
     return mLiveSession->getTrackInfo(trackIndex);
 }
 
+sp<AMessage> NuPlayer::HTTPLiveSource::getStats() const {
+    if (mLiveSession == NULL) {
+        return NULL;
+    }
+    return mLiveSession->getStats();
+}
+
 ssize_t NuPlayer::HTTPLiveSource::getSelectedTrack(media_track_type type) const {
     if (mLiveSession == NULL) {
         return -1;
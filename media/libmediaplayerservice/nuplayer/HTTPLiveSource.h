@@ -50,6 +50,7 @@ struct NuPlayer::HTTPLiveSource : public NuPlayer::Source {
     virtual size_t getTrackCount() const;
     virtual sp<AMessage> getTrackInfo(size_t trackIndex) const;
     virtual ssize_t getSelectedTrack(media_track_type /* type */) const;
+    virtual sp<AMessage> getStats() const;
     virtual status_t selectTrack(size_t trackIndex, bool select, int64_t timeUs);
     virtual status_t seekTo(
             int64_t seekTimeUs,
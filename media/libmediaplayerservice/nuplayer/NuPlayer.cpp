@@ -179,10 +179,12 @@ NuPlayer::NuPlayer(pid_t pid, const sp<MediaClock> &mediaClock)
       mMediaClock(mediaClock),
       mSourceFlags(0),
       mOffloadAudio(false),
+      mOffloadAudioFailed(false),
       mAudioDecoderGeneration(0),
       mVideoDecoderGeneration(0),
       mRendererGeneration(0),
       mLastStartedPlayingTimeNs(0),
+      mPlayingOffloaded(false),
       mLastStartedRebufferingTimeNs(0),
       mPreviousSeekTimeUs(0),
       mAudioEOS(false),
@@ -873,6 +875,7 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
                     if (!mPaused) {
                         mRenderer->pause();
                     }
+                    notifyOffloadFallback("playback-rate", false /* failed */);
                     restartAudio(
                             currentPositionUs, true /* forceNonOffload */,
                             true /* needsToCreateAudioDecoder */);
@@ -1310,6 +1313,9 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
                 if (!msg->findInt64("positionUs", &positionUs)) {
                     positionUs = mPreviousSeekTimeUs;
                 }
+                if (reason == Renderer::kForceNonOffload) {
+                    notifyOffloadFallback("sink-rejected", true /* failed */);
+                }
 
                 restartAudio(
                         positionUs, reason == Renderer::kForceNonOffload /* forceNonOffload */,
@@ -1520,6 +1526,20 @@ status_t NuPlayer::onInstantiateSecureDecoders() {
     return OK;
 }
 
+// With media.stagefright.nuplayer.preroll set, bring up the video decoder as soon as the
+// source is prepared, so that the codec is allocated and the first frames are decoded by
+// the time start() is called. As with secure decoders, there is no renderer yet, and the
+// decoder keeps its output until onStart() sets one.
+void NuPlayer::maybePrerollVideo() {
+    if (!property_get_bool("media.stagefright.nuplayer.preroll", false)
+            || mSurface == NULL || mVideoDecoder != NULL || mRenderer != NULL
+            || mSource->isRealTime() || (mSourceFlags & Source::FLAG_SECURE)) {
+        return;
+    }
+    status_t err = instantiateDecoder(false /* audio */, &mVideoDecoder);
+    ALOGV("pre-rolling video decoder: %d", err);
+}
+
 void NuPlayer::onStart(int64_t startPositionUs, MediaPlayerSeekMode mode) {
     ALOGV("onStart: mCrypto: %p (%d)", mCrypto.get(),
             (mCrypto != NULL ? mCrypto->getStrongCount() : 0));
@@ -1575,9 +1595,15 @@ void NuPlayer::onStart(int64_t startPositionUs, MediaPlayerSeekMode mode) {
         ALOGV("onStart: Disabling mOffloadAudio now that the source is protected.");
     }
 
+    if (mOffloadAudio && mOffloadAudioFailed) {
+        mOffloadAudio = false;
+        ALOGV("onStart: offload failed earlier, using PCM");
+    }
+
     if (mOffloadAudio) {
         flags |= Renderer::FLAG_OFFLOAD_AUDIO;
     }
+    updateOffloadPlaybackTimer("onStart");
 
     sp<AMessage> notify = new AMessage(kWhatRendererNotify, this);
     ++mRendererGeneration;
@@ -1635,7 +1661,7 @@ void NuPlayer::updatePlaybackTimer(bool stopping, const char *where) {
             ALOGV("updatePlaybackTimer()  log  %20" PRId64 "", played);
 
             if (played > 0) {
-                driver->notifyMorePlayingTimeUs((played+500)/1000);
+                driver->notifyMorePlayingTimeUs((played+500)/1000, mPlayingOffloaded);
             }
         }
 	if (stopping) {
@@ -1654,6 +1680,26 @@ void NuPlayer::startRebufferingTimer() {
     }
 }
 
+void NuPlayer::updateOffloadPlaybackTimer(const char *where) {
+    updatePlaybackTimer(false /* stopping */, where);
+    Mutex::Autolock autoLock(mPlayingTimeLock);
+    mPlayingOffloaded = mOffloadAudio;
+}
+
+void NuPlayer::notifyOffloadFallback(const char *reason, bool failed) {
+    if (!mOffloadAudio && !failed) {
+        return;
+    }
+    ALOGI("audio offload falls back to PCM: %s", reason);
+    if (failed) {
+        mOffloadAudioFailed = true;
+    }
+    sp<NuPlayerDriver> driver = mDriver.promote();
+    if (driver != NULL) {
+        driver->notifyOffloadFallback(reason);
+    }
+}
+
 void NuPlayer::updateRebufferingTimer(bool stopping, bool exitingPlayback) {
     Mutex::Autolock autoLock(mPlayingTimeLock);
 
@@ -1790,11 +1836,13 @@ void NuPlayer::tryOpenAudioSinkForOffload(
             format, true /* offloadOnly */, hasVideo,
             AUDIO_OUTPUT_FLAG_NONE, &mOffloadAudio, mSource->isStreaming());
     if (err != OK) {
+        notifyOffloadFallback("open-error", true /* failed */);
         // Any failure we turn off mOffloadAudio.
         mOffloadAudio = false;
     } else if (mOffloadAudio) {
         sendMetaDataToHal(mAudioSink, audioMeta);
     }
+    updateOffloadPlaybackTimer("tryOpenAudioSinkForOffload");
 }
 
 void NuPlayer::closeAudioSink() {
@@ -1847,6 +1895,7 @@ void NuPlayer::restartAudio(
     if (forceNonOffload) {
         mRenderer->signalDisableOffloadAudio();
         mOffloadAudio = false;
+        updateOffloadPlaybackTimer("restartAudio");
     }
     if (needsToCreateAudioDecoder) {
         instantiateDecoder(true /* audio */, &mAudioDecoder, !forceNonOffload);
@@ -1878,6 +1927,11 @@ void NuPlayer::determineAudioModeChange(const sp<AMessage> &audioFormat) {
         ALOGV("determineAudioModeChange: Disabling mOffloadAudio b/c the source is protected.");
     }
 
+    if (canOffload && mOffloadAudioFailed) {
+        canOffload = false;
+        ALOGV("determineAudioModeChange: offload failed earlier, staying on PCM");
+    }
+
     if (canOffload) {
         if (!mOffloadAudio) {
             mRenderer->signalEnableOffloadAudio();
@@ -1888,6 +1942,7 @@ void NuPlayer::determineAudioModeChange(const sp<AMessage> &audioFormat) {
         if (mOffloadAudio) {
             mRenderer->signalDisableOffloadAudio();
             mOffloadAudio = false;
+            updateOffloadPlaybackTimer("determineAudioModeChange");
         }
     }
 }
@@ -2243,13 +2298,27 @@ void NuPlayer::getStats(Vector<sp<AMessage> > *trackStats) {
 
     Mutex::Autolock autoLock(mDecoderLock);
     if (mVideoDecoder != NULL) {
-        trackStats->push_back(mVideoDecoder->getStats());
+        sp<AMessage> stats = mVideoDecoder->getStats();
+        sp<Renderer> renderer = mRenderer;
+        if (renderer != NULL) {
+            renderer->addVideoRenderStats(stats);
+        }
+        trackStats->push_back(stats);
     }
     if (mAudioDecoder != NULL) {
         trackStats->push_back(mAudioDecoder->getStats());
     }
 }
 
+sp<AMessage> NuPlayer::getSourceStats() {
+    sp<Source> source;
+    {
+        Mutex::Autolock autoLock(mSourceLock);
+        source = mSource;
+    }
+    return source != NULL ? source->getStats() : NULL;
+}
+
 sp<MetaData> NuPlayer::getFileMeta() {
     return mSource->getFileFormatMeta();
 }
@@ -2384,6 +2453,7 @@ void NuPlayer::performReset() {
     mPrepared = false;
     mResetting = false;
     mSourceStarted = false;
+    mOffloadAudioFailed = false;
 
     // Modular DRM
     if (mCrypto != NULL) {
@@ -2507,6 +2577,7 @@ void NuPlayer::onSourceNotify(const sp<AMessage> &msg) {
                 processDeferredActions();
             } else {
                 mPrepared = true;
+                maybePrerollVideo();
             }
 
             sp<NuPlayerDriver> driver = mDriver.promote();
@@ -89,6 +89,7 @@ struct NuPlayer : public AHandler {
     status_t selectTrack(size_t trackIndex, bool select, int64_t timeUs);
     status_t getCurrentPosition(int64_t *mediaUs);
     void getStats(Vector<sp<AMessage> > *trackStats);
+    sp<AMessage> getSourceStats();
 
     sp<MetaData> getFileMeta();
     float getFrameRate();
@@ -173,6 +174,9 @@ private:
     sp<MediaPlayerBase::AudioSink> mAudioSink;
     sp<DecoderBase> mVideoDecoder;
     bool mOffloadAudio;
+    // Offloading failed during this playback, so later format changes stay on PCM
+    // instead of reopening the sink in offload mode and failing over again.
+    bool mOffloadAudioFailed;
     sp<DecoderBase> mAudioDecoder;
     Mutex mDecoderLock;  // guard |mAudioDecoder| and |mVideoDecoder|.
     sp<CCDecoder> mCCDecoder;
@@ -184,8 +188,13 @@ private:
 
     Mutex mPlayingTimeLock;
     int64_t mLastStartedPlayingTimeNs;
+    bool mPlayingOffloaded;  // whether the current playing time has offloaded audio
     void updatePlaybackTimer(bool stopping, const char *where);
     void startPlaybackTimer(const char *where);
+    // Charges the playing time so far to the previous audio mode and starts
+    // accounting for the current one.
+    void updateOffloadPlaybackTimer(const char *where);
+    void notifyOffloadFallback(const char *reason, bool failed);
 
     int64_t mLastStartedRebufferingTimeNs;
     void startRebufferingTimer();
@@ -289,6 +298,7 @@ private:
             bool audio, sp<DecoderBase> *decoder, bool checkAudioModeChange = true);
 
     status_t onInstantiateSecureDecoders();
+    void maybePrerollVideo();
 
     void updateVideoSize(
             const sp<AMessage> &inputFormat,
@@ -79,6 +79,8 @@ NuPlayer::Decoder::Decoder(
       mVideoHeight(0),
       mIsAudio(true),
       mIsVideoAVC(false),
+      mIsVideoHEVC(false),
+      mHEVCMaxTemporalId(0),
       mIsSecure(false),
       mIsEncrypted(false),
       mIsEncryptedObservedEarlier(false),
@@ -295,6 +297,8 @@ void NuPlayer::Decoder::onConfigure(const sp<AMessage> &format) {
 
     mIsAudio = !strncasecmp("audio/", mime.c_str(), 6);
     mIsVideoAVC = !strcasecmp(MEDIA_MIMETYPE_VIDEO_AVC, mime.c_str());
+    mIsVideoHEVC = !strcasecmp(MEDIA_MIMETYPE_VIDEO_HEVC, mime.c_str());
+    mHEVCMaxTemporalId = 0;
 
     mComponentName = mime;
     mComponentName.append(" decoder");
@@ -459,6 +463,25 @@ void NuPlayer::Decoder::onSetParameters(const sp<AMessage> &params) {
 
 void NuPlayer::Decoder::onSetRenderer(const sp<Renderer> &renderer) {
     mRenderer = renderer;
+    if (mRenderer == NULL) {
+        return;
+    }
+
+    // hand over what was decoded while preparing
+    for (const sp<AMessage> &reply : mPrerolledOutput) {
+        if (isStaleReply(reply)) {
+            continue;
+        }
+        size_t bufferIx;
+        CHECK(reply->findSize("buffer-ix", &bufferIx));
+        const sp<MediaCodecBuffer> &buffer = mOutputBuffers[bufferIx];
+        mRenderer->queueBuffer(mIsAudio, buffer, reply);
+        int32_t eos;
+        if (buffer->meta()->findInt32("eos", &eos) && eos && !isDiscontinuityPending()) {
+            mRenderer->queueEOS(mIsAudio, ERROR_END_OF_STREAM);
+        }
+    }
+    mPrerolledOutput.clear();
 }
 
 void NuPlayer::Decoder::onResume(bool notifyComplete) {
@@ -485,6 +508,8 @@ void NuPlayer::Decoder::doFlush(bool notifyComplete) {
         mRenderer->flush(mIsAudio, notifyComplete);
         mRenderer->signalTimeDiscontinuity();
     }
+    // the codec gets those buffers back on flush
+    mPrerolledOutput.clear();
 
     status_t err = OK;
     if (mCodec != NULL) {
@@ -789,6 +814,9 @@ bool NuPlayer::Decoder::handleAnOutputBuffer(
         if (eos && !isDiscontinuityPending()) {
             mRenderer->queueEOS(mIsAudio, ERROR_END_OF_STREAM);
         }
+    } else if (!mIsAudio) {
+        // decoded ahead of start(), keep it for the renderer
+        mPrerolledOutput.push_back(reply);
     }
 
     return true;
@@ -939,9 +967,12 @@ status_t NuPlayer::Decoder::fetchInputData(sp<AMessage> &reply) {
 
             int32_t layerId = 0;
             bool haveLayerId = accessUnit->meta()->findInt32("temporal-layer-id", &layerId);
+            // track the temporal sub-layers even while on time
+            bool isHEVCReference =
+                    !mIsVideoHEVC || IsHEVCReferenceFrame(accessUnit, &mHEVCMaxTemporalId);
             if (mRenderer->getVideoLateByUs() > 100000LL
-                    && mIsVideoAVC
-                    && !IsAVCReferenceFrame(accessUnit)) {
+                    && ((mIsVideoAVC && !IsAVCReferenceFrame(accessUnit))
+                            || !isHEVCReference)) {
                 dropAccessUnit = true;
             } else if (haveLayerId && mNumVideoTemporalLayerTotal > 1) {
                 // Add only one layer each time.
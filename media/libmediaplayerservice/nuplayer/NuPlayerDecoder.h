@@ -79,6 +79,8 @@ private:
     sp<ALooper> mCodecLooper;
 
     List<sp<AMessage> > mPendingInputMessages;
+    // render replies for video output decoded before there was a renderer (pre-roll)
+    List<sp<AMessage> > mPrerolledOutput;
 
     Vector<sp<MediaCodecBuffer> > mInputBuffers;
     Vector<sp<MediaCodecBuffer> > mOutputBuffers;
@@ -98,6 +100,8 @@ private:
     int32_t mVideoHeight;
     bool mIsAudio;
     bool mIsVideoAVC;
+    bool mIsVideoHEVC;
+    uint32_t mHEVCMaxTemporalId;
     bool mIsSecure;
     bool mIsEncrypted;
     bool mIsEncryptedObservedEarlier;
@@ -19,6 +19,8 @@
 #include <inttypes.h>
 #include <android-base/macros.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
+#include <binder/IMemory.h>
 #include <cutils/properties.h>
 
 #include "NuPlayerDriver.h"
@@ -28,6 +30,7 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/ALooperGroup.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/foundation/ByteUtils.h>
 #include <media/stagefright/MediaClock.h>
@@ -68,7 +71,46 @@ static const char *kPlayerDataSourceType = "android.media.mediaplayer.dataSource
 static const char *kPlayerRebuffering = "android.media.mediaplayer.rebufferingMs";
 static const char *kPlayerRebufferingCount = "android.media.mediaplayer.rebuffers";
 static const char *kPlayerRebufferingAtExit = "android.media.mediaplayer.rebufferExit";
-
+static const char *kPlayerUpSwitches = "android.media.mediaplayer.hls.upSwitches";
+static const char *kPlayerDownSwitches = "android.media.mediaplayer.hls.downSwitches";
+static const char *kPlayerBandwidthEstimate = "android.media.mediaplayer.hls.bandwidthBps";
+static const char *kPlayerHTTPConnections = "android.media.mediaplayer.hls.connections";
+static const char *kPlayerHTTPReusedConnections = "android.media.mediaplayer.hls.reusedConnections";
+static const char *kPlayerHTTPTimeToFirstByte = "android.media.mediaplayer.hls.ttfbMs";
+static const char *kPlayerFramesLate = "android.media.mediaplayer.framesLate";
+static const char *kPlayerFramesJudder = "android.media.mediaplayer.framesJudder";
+static const char *kPlayerOffloadMs = "android.media.mediaplayer.audio.offloadMs";
+static const char *kPlayerOffloadPercent = "android.media.mediaplayer.audio.offloadPct";
+static const char *kPlayerOffloadFallbacks = "android.media.mediaplayer.audio.offloadFallbacks";
+static const char *kPlayerOffloadFallbackReason =
+        "android.media.mediaplayer.audio.offloadFallbackReason";
+
+
+// With media.stagefright.nuplayer.shared-threads set to N > 0, the driver loopers of all
+// players are run by one group of N threads, instead of starting a thread per player.
+// Only these loopers share it: the decoders, renderer and sources block on I/O or need
+// their own scheduling, and NuPlayer waits synchronously for some of them.
+static sp<ALooperGroup> getSharedDriverLooperGroup() {
+    static Mutex sLock;
+    static sp<ALooperGroup> sGroup;
+    static bool sInitialized = false;
+
+    Mutex::Autolock autoLock(sLock);
+    if (!sInitialized) {
+        sInitialized = true;
+        int32_t numThreads = property_get_int32("media.stagefright.nuplayer.shared-threads", 0);
+        if (numThreads > 0) {
+            sp<ALooperGroup> group =
+                    new ALooperGroup("NuPlayerDriver", numThreads, PRIORITY_AUDIO);
+            if (group->start() == OK) {
+                sGroup = group;
+            } else {
+                ALOGW("could not start the shared driver looper threads");
+            }
+        }
+    }
+    return sGroup;
+}
 
 NuPlayerDriver::NuPlayerDriver(pid_t pid)
     : mState(STATE_IDLE),
@@ -79,9 +121,15 @@ NuPlayerDriver::NuPlayerDriver(pid_t pid)
       mPositionUs(-1),
       mSeekInProgress(false),
       mPlayingTimeUs(0),
+      mOffloadPlayingTimeUs(0),
+      mOffloadFallbacks(0),
       mRebufferingTimeUs(0),
       mRebufferingEvents(0),
       mRebufferingAtExit(false),
+      mPlaybackSpeed(1.0f),
+      mBuffering(false),
+      mBufferingPercent(-1),
+      mPlaybackState(NULL),
       mLooper(new ALooper),
       mMediaClock(new MediaClock),
       mPlayer(new NuPlayer(pid, mMediaClock)),
@@ -99,14 +147,19 @@ NuPlayerDriver::NuPlayerDriver(pid_t pid)
     // set up an analytics record
     mAnalyticsItem = MediaAnalyticsItem::create(kKeyPlayer);
 
-    mLooper->start(
-            false, /* runOnCallingThread */
-            true,  /* canCallJava */
-            PRIORITY_AUDIO);
+    sp<ALooperGroup> group = getSharedDriverLooperGroup();
+    if (group == NULL || mLooper->start(group) != OK) {
+        mLooper->start(
+                false, /* runOnCallingThread */
+                true,  /* canCallJava */
+                PRIORITY_AUDIO);
+    }
 
     mLooper->registerHandler(mPlayer);
 
     mPlayer->init(this);
+
+    memset(&mPublishedState, 0, sizeof(mPublishedState));
 }
 
 NuPlayerDriver::~NuPlayerDriver() {
@@ -373,6 +426,7 @@ status_t NuPlayerDriver::start_l() {
     }
 
     mState = STATE_RUNNING;
+    publishPlaybackState_l(mPositionUs < 0 ? 0 : mPositionUs);
 
     return OK;
 }
@@ -401,6 +455,7 @@ status_t NuPlayerDriver::stop() {
         default:
             return INVALID_OPERATION;
     }
+    publishPlaybackState_l();
 
     return OK;
 }
@@ -445,6 +500,7 @@ status_t NuPlayerDriver::setPlaybackSettings(const AudioPlaybackRate &rate) {
         int unused;
         getCurrentPosition(&unused);
         Mutex::Autolock autoLock(mLock);
+        mPlaybackSpeed = rate.mSpeed;
         if (rate.mSpeed == 0.f && mState == STATE_RUNNING) {
             mState = STATE_PAUSED;
             notifyListener_l(MEDIA_PAUSED);
@@ -454,6 +510,7 @@ status_t NuPlayerDriver::setPlaybackSettings(const AudioPlaybackRate &rate) {
                     || mState == STATE_PREPARED)) {
             err = start_l();
         }
+        publishPlaybackState_l(mPositionUs);
     }
     return err;
 }
@@ -495,6 +552,7 @@ status_t NuPlayerDriver::seekTo(int msec, MediaPlayerSeekMode mode) {
     }
 
     mPositionUs = seekTimeUs;
+    publishPlaybackState_l(mPositionUs);
     return OK;
 }
 
@@ -519,6 +577,7 @@ status_t NuPlayerDriver::getCurrentPosition(int *msec) {
         tempUs = (mPositionUs <= 0) ? 0 : mPositionUs;
     } else {
         mPositionUs = tempUs;
+        publishPlaybackState_l(mPositionUs);
     }
     *msec = (int)divRound(tempUs, (int64_t)(1000));
     return OK;
@@ -578,6 +637,13 @@ void NuPlayerDriver::updateMetrics(const char *where) {
                 mAnalyticsItem->setInt64(kPlayerFrames, numFramesTotal);
                 mAnalyticsItem->setInt64(kPlayerFramesDropped, numFramesDropped);
 
+                int64_t numFramesLate, numFramesJudder;
+                if (stats->findInt64("frames-late", &numFramesLate)
+                        && stats->findInt64("frames-judder", &numFramesJudder)) {
+                    mAnalyticsItem->setInt64(kPlayerFramesLate, numFramesLate);
+                    mAnalyticsItem->setInt64(kPlayerFramesJudder, numFramesJudder);
+                }
+
                 float frameRate = 0;
                 if (stats->findFloat("frame-rate-total", &frameRate)) {
                     mAnalyticsItem->setDouble(kPlayerFrameRate, (double) frameRate);
@@ -603,6 +669,20 @@ void NuPlayerDriver::updateMetrics(const char *where) {
 
     mAnalyticsItem->setInt64(kPlayerPlaying, (mPlayingTimeUs+500)/1000 );
 
+    // only for playbacks that offloaded audio or tried to
+    if (mOffloadPlayingTimeUs > 0 || mOffloadFallbacks > 0) {
+        mAnalyticsItem->setInt64(kPlayerOffloadMs, (mOffloadPlayingTimeUs+500)/1000);
+        if (mPlayingTimeUs > 0) {
+            mAnalyticsItem->setInt32(kPlayerOffloadPercent,
+                    (int32_t)(mOffloadPlayingTimeUs * 100 / mPlayingTimeUs));
+        }
+        if (mOffloadFallbacks > 0) {
+            mAnalyticsItem->setInt32(kPlayerOffloadFallbacks, mOffloadFallbacks);
+            mAnalyticsItem->setCString(kPlayerOffloadFallbackReason,
+                    mOffloadFallbackReason.c_str());
+        }
+    }
+
     if (mRebufferingEvents != 0) {
         mAnalyticsItem->setInt64(kPlayerRebuffering, (mRebufferingTimeUs+500)/1000 );
         mAnalyticsItem->setInt32(kPlayerRebufferingCount, mRebufferingEvents);
@@ -610,6 +690,29 @@ void NuPlayerDriver::updateMetrics(const char *where) {
 
     }
 
+    sp<AMessage> sourceStats = mPlayer->getSourceStats();
+    if (sourceStats != NULL) {
+        int32_t upSwitches, downSwitches, bandwidthBps;
+        if (sourceStats->findInt32("bandwidth-up-switches", &upSwitches)
+                && sourceStats->findInt32("bandwidth-down-switches", &downSwitches)) {
+            mAnalyticsItem->setInt32(kPlayerUpSwitches, upSwitches);
+            mAnalyticsItem->setInt32(kPlayerDownSwitches, downSwitches);
+        }
+        if (sourceStats->findInt32("bandwidth-estimate-bps", &bandwidthBps)) {
+            mAnalyticsItem->setInt32(kPlayerBandwidthEstimate, bandwidthBps);
+        }
+        int32_t connections, reusedConnections;
+        if (sourceStats->findInt32("http-connections", &connections)
+                && sourceStats->findInt32("http-reused-connections", &reusedConnections)) {
+            mAnalyticsItem->setInt32(kPlayerHTTPConnections, connections);
+            mAnalyticsItem->setInt32(kPlayerHTTPReusedConnections, reusedConnections);
+        }
+        int64_t timeToFirstByteUs;
+        if (sourceStats->findInt64("http-time-to-first-byte-us", &timeToFirstByteUs)) {
+            mAnalyticsItem->setInt64(kPlayerHTTPTimeToFirstByte, timeToFirstByteUs / 1000);
+        }
+    }
+
     mAnalyticsItem->setCString(kPlayerDataSourceType, mPlayer->getDataSourceType());
 }
 
@@ -692,9 +795,15 @@ status_t NuPlayerDriver::reset() {
     mPositionUs = -1;
     mLooping = false;
     mPlayingTimeUs = 0;
+    mOffloadPlayingTimeUs = 0;
+    mOffloadFallbacks = 0;
+    mOffloadFallbackReason.clear();
     mRebufferingTimeUs = 0;
     mRebufferingEvents = 0;
     mRebufferingAtExit = false;
+    mBuffering = false;
+    mBufferingPercent = -1;
+    publishPlaybackState_l(0);
 
     return OK;
 }
@@ -838,11 +947,21 @@ void NuPlayerDriver::notifySetSurfaceComplete() {
 void NuPlayerDriver::notifyDuration(int64_t durationUs) {
     Mutex::Autolock autoLock(mLock);
     mDurationUs = durationUs;
+    publishPlaybackState_l();
 }
 
-void NuPlayerDriver::notifyMorePlayingTimeUs(int64_t playingUs) {
+void NuPlayerDriver::notifyMorePlayingTimeUs(int64_t playingUs, bool offloaded) {
     Mutex::Autolock autoLock(mLock);
     mPlayingTimeUs += playingUs;
+    if (offloaded) {
+        mOffloadPlayingTimeUs += playingUs;
+    }
+}
+
+void NuPlayerDriver::notifyOffloadFallback(const char *reason) {
+    Mutex::Autolock autoLock(mLock);
+    ++mOffloadFallbacks;
+    mOffloadFallbackReason = reason;
 }
 
 void NuPlayerDriver::notifyMoreRebufferingTimeUs(int64_t rebufferingUs) {
@@ -860,6 +979,7 @@ void NuPlayerDriver::notifySeekComplete() {
     ALOGV("notifySeekComplete(%p)", this);
     Mutex::Autolock autoLock(mLock);
     mSeekInProgress = false;
+    publishPlaybackState_l(mPositionUs);
     notifySeekComplete_l();
 }
 
@@ -901,6 +1021,12 @@ status_t NuPlayerDriver::dump(
     if (locked) {
         snprintf(buf, sizeof(buf), "  state(%d), atEOS(%d), looping(%d), autoLoop(%d)\n",
                 mState, mAtEOS, mLooping, mAutoLoop);
+        logString.append(buf);
+        snprintf(buf, sizeof(buf), "  offloadMs(%lld) of playingMs(%lld), "
+                "offloadFallbacks(%d) last(%s)\n",
+                (long long)(mOffloadPlayingTimeUs / 1000), (long long)(mPlayingTimeUs / 1000),
+                mOffloadFallbacks,
+                mOffloadFallbacks > 0 ? mOffloadFallbackReason.c_str() : "none");
         mLock.unlock();
     } else {
         snprintf(buf, sizeof(buf), "  NPD(%p) lock is taken\n", this);
@@ -942,6 +1068,34 @@ status_t NuPlayerDriver::dump(
                      numFramesTotal == 0
                             ? 0.0 : (double)(numFramesDropped * 100) / numFramesTotal);
             logString.append(buf);
+
+            int64_t numFramesLate, numFramesJudder;
+            if (stats->findInt64("frames-late", &numFramesLate)
+                    && stats->findInt64("frames-judder", &numFramesJudder)) {
+                snprintf(buf, sizeof(buf), "    numFramesLate(%lld), numFramesJudder(%lld)\n",
+                         (long long)numFramesLate, (long long)numFramesJudder);
+                logString.append(buf);
+            }
+        }
+    }
+
+    sp<AMessage> sourceStats = mPlayer->getSourceStats();
+    if (sourceStats != NULL) {
+        for (const char *track : { "audio", "video" }) {
+            int64_t numReads, numBuffers, avgReadUs, maxReadUs;
+            if (sourceStats->findInt64(AStringPrintf("%s-reads", track).c_str(), &numReads)
+                    && sourceStats->findInt64(
+                            AStringPrintf("%s-read-buffers", track).c_str(), &numBuffers)
+                    && sourceStats->findInt64(
+                            AStringPrintf("%s-read-avg-us", track).c_str(), &avgReadUs)
+                    && sourceStats->findInt64(
+                            AStringPrintf("%s-read-max-us", track).c_str(), &maxReadUs)) {
+                snprintf(buf, sizeof(buf), "  %s source reads(%lld), buffers(%lld), "
+                         "avgReadUs(%lld), maxReadUs(%lld)\n",
+                         track, (long long)numReads, (long long)numBuffers,
+                         (long long)avgReadUs, (long long)maxReadUs);
+                logString.append(buf);
+            }
         }
     }
 
@@ -957,6 +1111,44 @@ status_t NuPlayerDriver::dump(
     return OK;
 }
 
+status_t NuPlayerDriver::setPlaybackStateMemory(const sp<IMemory> &memory) {
+    if (memory == NULL || memory->pointer() == NULL
+            || memory->size() < sizeof(MediaPlayerPlaybackStateShared)) {
+        return BAD_VALUE;
+    }
+    Mutex::Autolock autoLock(mLock);
+    mPlaybackStateMemory = memory;
+    mPlaybackState = static_cast<MediaPlayerPlaybackStateShared *>(memory->pointer());
+    publishPlaybackState_l(mPositionUs);
+    return OK;
+}
+
+void NuPlayerDriver::publishPlaybackState_l(int64_t positionUs) {
+    if (mPlaybackState == NULL) {
+        return;
+    }
+    const int64_t nowUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000ll;
+    if (positionUs < 0) {
+        positionUs = mPublishedState.mPositionUs + (int64_t)(
+                (nowUs - mPublishedState.mPositionTimeUs) * (double)mPublishedState.mSpeed);
+    }
+    if (mDurationUs > 0 && positionUs > mDurationUs) {
+        positionUs = mDurationUs;
+    }
+
+    MediaPlayerPlaybackState state;
+    state.mPositionUs = positionUs;
+    state.mPositionTimeUs = nowUs;
+    state.mDurationUs = mDurationUs;
+    const bool advancing = isPlaying() && !mSeekInProgress && !mBuffering;
+    state.mSpeed = advancing ? mPlaybackSpeed : 0.f;
+    state.mPlaying = isPlaying();
+    state.mBufferingPercent = mBufferingPercent;
+
+    mPlaybackState->write(state);
+    mPublishedState = state;
+}
+
 void NuPlayerDriver::notifyListener(
         int msg, int ext1, int ext2, const Parcel *in) {
     Mutex::Autolock autoLock(mLock);
@@ -983,6 +1175,7 @@ void NuPlayerDriver::notifyListener_l(
                 }
                 if (mLooping || mAutoLoop) {
                     mPlayer->seekToAsync(0);
+                    publishPlaybackState_l(0);
                     if (mAudioSink != NULL) {
                         // The renderer has stopped the sink at the end in order to play out
                         // the last little bit of audio. If we're looping, we need to restart it.
@@ -1014,6 +1207,32 @@ void NuPlayerDriver::notifyListener_l(
                 mAnalyticsItem->setCString(kPlayerErrorState, stateString(mState).c_str());
             }
             mAtEOS = true;
+            // the renderer played out everything up to the end
+            publishPlaybackState_l(
+                    msg == MEDIA_PLAYBACK_COMPLETE && mDurationUs > 0 ? mDurationUs : -1);
+            break;
+        }
+
+        case MEDIA_BUFFERING_UPDATE:
+        {
+            mBufferingPercent = ext1;
+            publishPlaybackState_l();
+            break;
+        }
+
+        case MEDIA_INFO:
+        {
+            if (ext1 == MEDIA_INFO_BUFFERING_START || ext1 == MEDIA_INFO_BUFFERING_END) {
+                mBuffering = ext1 == MEDIA_INFO_BUFFERING_START;
+                publishPlaybackState_l();
+            }
+            break;
+        }
+
+        case MEDIA_PAUSED:
+        case MEDIA_STOPPED:
+        {
+            publishPlaybackState_l();
             break;
         }
 
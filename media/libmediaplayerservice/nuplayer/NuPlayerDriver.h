@@ -18,6 +18,7 @@
 
 #include <media/MediaAnalyticsItem.h>
 #include <media/stagefright/foundation/ABase.h>
+#include <private/media/MediaPlayerShared.h>
 
 namespace android {
 
@@ -78,12 +79,15 @@ struct NuPlayerDriver : public MediaPlayerInterface {
 
     virtual status_t dump(int fd, const Vector<String16> &args) const;
 
+    virtual status_t setPlaybackStateMemory(const sp<IMemory> &memory);
+
     void notifySetDataSourceCompleted(status_t err);
     void notifyPrepareCompleted(status_t err);
     void notifyResetComplete();
     void notifySetSurfaceComplete();
     void notifyDuration(int64_t durationUs);
-    void notifyMorePlayingTimeUs(int64_t timeUs);
+    void notifyMorePlayingTimeUs(int64_t timeUs, bool offloaded = false);
+    void notifyOffloadFallback(const char *reason);
     void notifyMoreRebufferingTimeUs(int64_t timeUs);
     void notifyRebufferingWhenExit(bool status);
     void notifySeekComplete();
@@ -130,9 +134,18 @@ private:
     int64_t mPositionUs;
     bool mSeekInProgress;
     int64_t mPlayingTimeUs;
+    int64_t mOffloadPlayingTimeUs;
+    int32_t mOffloadFallbacks;
+    AString mOffloadFallbackReason;
     int64_t mRebufferingTimeUs;
     int32_t mRebufferingEvents;
     bool mRebufferingAtExit;
+    float mPlaybackSpeed;
+    bool mBuffering;
+    int32_t mBufferingPercent;
+    sp<IMemory> mPlaybackStateMemory;
+    MediaPlayerPlaybackStateShared *mPlaybackState;
+    MediaPlayerPlaybackState mPublishedState;
     // <<<
 
     sp<ALooper> mLooper;
@@ -156,6 +169,10 @@ private:
     status_t start_l();
     void notifyListener_l(int msg, int ext1 = 0, int ext2 = 0, const Parcel *in = NULL);
 
+    // Publishes the current state to the client. Without a new |positionUs| the position
+    // is carried on from the last published one.
+    void publishPlaybackState_l(int64_t positionUs = -1);
+
     DISALLOW_EVIL_CONSTRUCTORS(NuPlayerDriver);
 };
 
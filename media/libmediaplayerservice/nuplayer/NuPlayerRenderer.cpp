@@ -76,6 +76,10 @@ static const int64_t kOffloadPauseMaxUs = 10000000LL;
 static const int64_t kMaxAllowedAudioSinkDelayUs = 1500000LL;
 
 static const int64_t kMinimumAudioClockUpdatePeriodUs = 20 /* msec */ * 1000;
+// While the played out position keeps agreeing with MediaClock to within
+// kAudioClockStableUs, the period doubles up to kMaximumAudioClockUpdatePeriodUs.
+static const int64_t kMaximumAudioClockUpdatePeriodUs = 320 /* msec */ * 1000;
+static const int64_t kAudioClockStableUs = 2000;
 
 // Default video frame display duration when only video exists.
 // Used to set max media time in MediaClock.
@@ -131,6 +135,13 @@ NuPlayer::Renderer::Renderer(
       mAnchorNumFramesWritten(-1),
       mVideoLateByUs(0LL),
       mNextVideoTimeMediaUs(-1),
+      mVideoDrainLatencyUs(-1),
+      mVideoDrainLeadUs(-1),
+      mVideoDrainTimerId(-1),
+      mLastVideoRenderTimeUs(-1),
+      mLastVideoRenderVsyncs(0),
+      mNumVideoFramesLate(0),
+      mNumVideoFramesJudder(0),
       mHasAudio(false),
       mHasVideo(false),
       mNotifyCompleteAudio(false),
@@ -144,6 +155,7 @@ NuPlayer::Renderer::Renderer(
       mAudioRenderingStartGeneration(0),
       mRenderingDataDelivered(false),
       mNextAudioClockUpdateTimeUs(-1),
+      mAudioClockUpdatePeriodUs(kMinimumAudioClockUpdatePeriodUs),
       mLastAudioMediaTimeUs(-1),
       mAudioOffloadPauseTimeoutGeneration(0),
       mAudioTornDown(false),
@@ -231,6 +243,7 @@ status_t NuPlayer::Renderer::onConfigPlayback(const AudioPlaybackRate &rate /* s
     mPlaybackSettings = rate;
     mPlaybackRate = rate.mSpeed;
     mMediaClock->setPlaybackRate(mPlaybackRate);
+    resetAudioClockUpdatePeriod();
     return OK;
 }
 
@@ -407,6 +420,15 @@ void NuPlayer::Renderer::clearAnchorTime() {
     mMediaClock->clearAnchor();
     mAnchorTimeMediaUs = -1;
     mAnchorNumFramesWritten = -1;
+    resetAudioClockUpdatePeriod();
+}
+
+// Re-anchors on the next audio buffer, e.g. once the clock was stopped or cleared.
+void NuPlayer::Renderer::resetAudioClockUpdatePeriod() {
+    mAudioClockUpdatePeriodUs = kMinimumAudioClockUpdatePeriodUs;
+    if (mNextAudioClockUpdateTimeUs > 0) {
+        mNextAudioClockUpdateTimeUs = 0;
+    }
 }
 
 void NuPlayer::Renderer::setVideoLateByUs(int64_t lateUs) {
@@ -419,6 +441,66 @@ int64_t NuPlayer::Renderer::getVideoLateByUs() {
     return mVideoLateByUs;
 }
 
+// Called on any threads.
+void NuPlayer::Renderer::addVideoRenderStats(const sp<AMessage> &stats) {
+    Mutex::Autolock autoLock(mLock);
+    stats->setInt64("frames-late", mNumVideoFramesLate);
+    stats->setInt64("frames-judder", mNumVideoFramesJudder);
+}
+
+// Called on renderer looper. The drain message of a cancelled timer would be dropped for
+// its generation anyway, this saves the clock from waking up for it.
+void NuPlayer::Renderer::cancelVideoDrainTimer() {
+    if (mVideoDrainTimerId >= 0) {
+        mMediaClock->cancelTimer(mVideoDrainTimerId);
+        mVideoDrainTimerId = -1;
+    }
+}
+
+// Called on renderer looper. One vsync to get the buffer to the display, plus how late
+// drain messages tend to arrive: two vsyncs until that is known, as before.
+int64_t NuPlayer::Renderer::getVideoDrainLeadUs() {
+    const int64_t vsyncUs = mVideoScheduler->getVsyncPeriod() / 1000;
+    if (mVideoDrainLatencyUs < 0) {
+        return 2 * vsyncUs;
+    }
+    return std::min(vsyncUs + mVideoDrainLatencyUs, 4 * vsyncUs);
+}
+
+// Called on renderer looper when a frame is released at realTimeUs.
+void NuPlayer::Renderer::updateVideoRenderStats(int64_t realTimeUs, int64_t nowUs, bool dropped) {
+    const int64_t vsyncUs = mVideoScheduler->getVsyncPeriod() / 1000;
+    if (mVideoDrainLeadUs >= 0 && vsyncUs > 0) {
+        // how much later than asked for the drain message came, the peak held for a while
+        int64_t latencyUs = std::min(std::max(mVideoDrainLeadUs - (realTimeUs - nowUs), (int64_t)0),
+                3 * vsyncUs);
+        if (latencyUs >= mVideoDrainLatencyUs) {
+            mVideoDrainLatencyUs = latencyUs;
+        } else {
+            mVideoDrainLatencyUs -= (mVideoDrainLatencyUs - latencyUs) / 16;
+        }
+    }
+    mVideoDrainLeadUs = -1;
+
+    if (dropped) {
+        mLastVideoRenderTimeUs = -1;
+        mLastVideoRenderVsyncs = 0;
+        return;
+    }
+    bool judder = false;
+    if (mLastVideoRenderTimeUs >= 0 && vsyncUs > 0) {
+        // e.g. 24fps on 60Hz alternates between 2 and 3 vsyncs, which is expected
+        int64_t vsyncs = (realTimeUs - mLastVideoRenderTimeUs + vsyncUs / 2) / vsyncUs;
+        judder = mLastVideoRenderVsyncs > 0 && llabs(vsyncs - mLastVideoRenderVsyncs) > 1;
+        mLastVideoRenderVsyncs = vsyncs;
+    }
+    mLastVideoRenderTimeUs = realTimeUs;
+
+    Mutex::Autolock autoLock(mLock);
+    mNumVideoFramesLate += (nowUs > realTimeUs);
+    mNumVideoFramesJudder += judder;
+}
+
 status_t NuPlayer::Renderer::openAudioSink(
         const sp<AMessage> &format,
         bool offloadOnly,
@@ -612,6 +694,7 @@ void NuPlayer::Renderer::onMessageReceived(const sp<AMessage> &msg) {
             }
 
             mDrainVideoQueuePending = false;
+            mVideoDrainTimerId = -1;
 
             onDrainVideoQueue();
 
@@ -1224,10 +1307,25 @@ void NuPlayer::Renderer::onNewAudioMediaTime(int64_t mediaTimeUs) {
     int64_t nowUs = ALooper::GetNowUs();
     if (mNextAudioClockUpdateTimeUs >= 0) {
         if (nowUs >= mNextAudioClockUpdateTimeUs) {
+            // Reading the played out position queries the AudioTrack timestamp, so do it
+            // less often while it only confirms the clock.
             int64_t nowMediaUs = mediaTimeUs - getPendingAudioPlayoutDurationUs(nowUs);
+            int64_t clockMediaUs;
+            if (!mUseVirtualAudioSink
+                    && mMediaClock->getMediaTime(
+                            nowUs, &clockMediaUs, true /* allowPastMaxTime */) == OK
+                    && llabs(clockMediaUs - nowMediaUs) < kAudioClockStableUs) {
+                mAudioClockUpdatePeriodUs = std::min(
+                        2 * mAudioClockUpdatePeriodUs, kMaximumAudioClockUpdatePeriodUs);
+            } else {
+                mAudioClockUpdatePeriodUs = kMinimumAudioClockUpdatePeriodUs;
+            }
             mMediaClock->updateAnchor(nowMediaUs, nowUs, mediaTimeUs);
             mUseVirtualAudioSink = false;
-            mNextAudioClockUpdateTimeUs = nowUs + kMinimumAudioClockUpdatePeriodUs;
+            mNextAudioClockUpdateTimeUs = nowUs + mAudioClockUpdatePeriodUs;
+        } else {
+            // the clock must not run past the audio written so far
+            mMediaClock->updateMaxTimeMedia(mediaTimeUs);
         }
     } else {
         int64_t unused;
@@ -1266,6 +1364,7 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
 
     sp<AMessage> msg = new AMessage(kWhatDrainVideoQueue, this);
     msg->setInt32("drainGeneration", getDrainGeneration(false /* audio */));
+    mVideoDrainLeadUs = -1;
 
     if (entry.mBuffer == NULL) {
         // EOS doesn't carry a timestamp.
@@ -1281,13 +1380,18 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
 
         realTimeUs = mVideoScheduler->schedule(realTimeUs * 1000) / 1000;
 
-        int64_t twoVsyncsUs = 2 * (mVideoScheduler->getVsyncPeriod() / 1000);
+        int64_t leadUs = getVideoDrainLeadUs();
 
         int64_t delayUs = realTimeUs - nowUs;
 
         ALOGW_IF(delayUs > 500000, "unusually high delayUs: %lld", (long long)delayUs);
-        // post 2 display refreshes before rendering is due
-        msg->post(delayUs > twoVsyncsUs ? delayUs - twoVsyncsUs : 0);
+        // post ahead of the display refresh the frame is due at
+        if (delayUs > leadUs) {
+            msg->post(delayUs - leadUs);
+            mVideoDrainLeadUs = leadUs;
+        } else {
+            msg->post();
+        }
 
         mDrainVideoQueuePending = true;
         return;
@@ -1312,10 +1416,11 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
     if (!mVideoSampleReceived || mediaTimeUs < mAudioFirstAnchorTimeMediaUs) {
         msg->post();
     } else {
-        int64_t twoVsyncsUs = 2 * (mVideoScheduler->getVsyncPeriod() / 1000);
+        int64_t leadUs = getVideoDrainLeadUs();
 
-        // post 2 display refreshes before rendering is due
-        mMediaClock->addTimer(msg, mediaTimeUs, -twoVsyncsUs);
+        // post ahead of the display refresh the frame is due at
+        mVideoDrainTimerId = mMediaClock->addTimer(msg, mediaTimeUs, -leadUs);
+        mVideoDrainLeadUs = leadUs;
     }
 
     mDrainVideoQueuePending = true;
@@ -1389,6 +1494,11 @@ void NuPlayer::Renderer::onDrainVideoQueue() {
     if (!mVideoSampleReceived) {
         realTimeUs = nowUs;
         tooLate = false;
+        mLastVideoRenderTimeUs = -1;
+        mLastVideoRenderVsyncs = 0;
+        mVideoDrainLeadUs = -1;
+    } else if (!mPaused) {
+        updateVideoRenderStats(realTimeUs, nowUs, tooLate);
     }
 
     entry->mNotifyConsumed->setInt64("timestampNs", realTimeUs * 1000LL);
@@ -1666,6 +1776,7 @@ void NuPlayer::Renderer::onFlush(const sp<AMessage> &msg) {
         flushQueue(&mVideoQueue);
 
         mDrainVideoQueuePending = false;
+        cancelVideoDrainTimer();
 
         if (mVideoScheduler != NULL) {
             mVideoScheduler->restart();
@@ -1768,10 +1879,12 @@ void NuPlayer::Renderer::onPause() {
         prepareForMediaRenderingStart_l();
         mPaused = true;
         mMediaClock->setPlaybackRate(0.0);
+        resetAudioClockUpdatePeriod();
     }
 
     mDrainAudioQueuePending = false;
     mDrainVideoQueuePending = false;
+    cancelVideoDrainTimer();
 
     // Note: audio data may not have been decoded, and the AudioSink may not be opened.
     mAudioSink->pause();
@@ -1809,6 +1922,7 @@ void NuPlayer::Renderer::onResume() {
         }
 
         mMediaClock->setPlaybackRate(mPlaybackRate);
+        resetAudioClockUpdatePeriod();
 
         if (!mAudioQueue.empty()) {
             postDrainAudioQueue_l();
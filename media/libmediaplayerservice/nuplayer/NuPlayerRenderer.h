@@ -71,6 +71,8 @@ struct NuPlayer::Renderer : public AHandler {
 
     status_t getCurrentPosition(int64_t *mediaUs);
     int64_t getVideoLateByUs();
+    // Adds the frame release statistics to the video track stats.
+    void addVideoRenderStats(const sp<AMessage> &stats);
 
     status_t openAudioSink(
             const sp<AMessage> &format,
@@ -178,6 +180,17 @@ private:
     int64_t mAnchorNumFramesWritten;
     int64_t mVideoLateByUs;
     int64_t mNextVideoTimeMediaUs;
+
+    // How far ahead of its vsync a frame is released, learned from how late the
+    // drain messages are delivered. Modified only on renderer's thread.
+    int64_t mVideoDrainLatencyUs;
+    int64_t mVideoDrainLeadUs;      // lead of the pending drain, or -1
+    int32_t mVideoDrainTimerId;     // MediaClock timer of the pending drain, or -1
+    int64_t mLastVideoRenderTimeUs;
+    int64_t mLastVideoRenderVsyncs;
+    // protected by mLock
+    int64_t mNumVideoFramesLate;    // released after their vsync
+    int64_t mNumVideoFramesJudder;  // off the frame rate cadence by more than a vsync
     bool mHasAudio;
     bool mHasVideo;
 
@@ -197,6 +210,7 @@ private:
     bool mRenderingDataDelivered;
 
     int64_t mNextAudioClockUpdateTimeUs;
+    int64_t mAudioClockUpdatePeriodUs;
     // the media timestamp of last audio sample right before EOS.
     int64_t mLastAudioMediaTimeUs;
 
@@ -236,6 +250,7 @@ private:
     void postDrainAudioQueue_l(int64_t delayUs = 0);
 
     void clearAnchorTime();
+    void resetAudioClockUpdatePeriod();
     void clearAudioFirstAnchorTime_l();
     void setAudioFirstAnchorTimeIfNeeded_l(int64_t mediaUs);
     void setVideoLateByUs(int64_t lateUs);
@@ -244,6 +259,9 @@ private:
     int64_t getRealTimeUs(int64_t mediaTimeUs, int64_t nowUs);
 
     void onDrainVideoQueue();
+    int64_t getVideoDrainLeadUs();
+    void cancelVideoDrainTimer();
+    void updateVideoRenderStats(int64_t realTimeUs, int64_t nowUs, bool dropped);
     void postDrainVideoQueue();
 
     void prepareForMediaRenderingStart_l();
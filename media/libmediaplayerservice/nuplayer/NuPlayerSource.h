@@ -131,6 +131,11 @@ struct NuPlayer::Source : public AHandler {
 
     virtual void setOffloadAudio(bool /* offload */) {}
 
+    // Source specific statistics for the player metrics, or NULL.
+    virtual sp<AMessage> getStats() const {
+        return NULL;
+    }
+
     // Modular DRM
     virtual status_t prepareDrm(
             const uint8_t /*uuid*/[16], const Vector<uint8_t> &/*drmSessionId*/,
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MultiReaderPipe"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <cutils/compiler.h>
+#include <utils/Log.h>
+#include <media/nbaio/MultiReaderPipe.h>
+#include <audio_utils/roundup.h>
+
+namespace android {
+
+void MultiReaderPipe::ReaderSlot::reset()
+{
+    mFramesRead.store(0, std::memory_order_relaxed);
+    mLag.store(0, std::memory_order_relaxed);
+    mOverruns.store(0, std::memory_order_relaxed);
+    mFramesOverrun.store(0, std::memory_order_relaxed);
+    for (auto &bucket : mLagHistogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+MultiReaderPipe::MultiReaderPipe(size_t maxFrames, const NBAIO_Format& format) :
+        NBAIO_Sink(format),
+        mMaxFrames(roundup(maxFrames)),
+        mFrameSize(Format_frameSize(format)),
+        mBuffer(malloc(mMaxFrames * mFrameSize)),
+        mRear(0),
+        mWriteEnd(0)
+{
+    for (auto &slot : mReaders) {
+        slot.reset();
+    }
+}
+
+MultiReaderPipe::~MultiReaderPipe()
+{
+    for (const auto &slot : mReaders) {
+        ALOG_ASSERT(!slot.mInUse.load());
+        (void)slot;
+    }
+    free(mBuffer);
+}
+
+ssize_t MultiReaderPipe::write(const void *buffer, size_t count)
+{
+    // count == 0 is unlikely and not worth checking for
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    if (count > mMaxFrames) {
+        buffer = (const char *) buffer + (count - mMaxFrames) * mFrameSize;
+        count = mMaxFrames;
+    }
+    const int64_t rear = mRear.load(std::memory_order_relaxed);
+    // announce the frames about to be overwritten before touching them
+    mWriteEnd.store(rear + count, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const size_t offset = (size_t) rear & (mMaxFrames - 1);
+    const size_t part1 = std::min(count, mMaxFrames - offset);
+    memcpy((char *) mBuffer + offset * mFrameSize, buffer, part1 * mFrameSize);
+    if (part1 < count) {
+        memcpy(mBuffer, (const char *) buffer + part1 * mFrameSize, (count - part1) * mFrameSize);
+    }
+    mRear.store(rear + count, std::memory_order_release);
+    mFramesWritten += count;
+    return count;
+}
+
+MultiReaderPipe::ReaderSlot *MultiReaderPipe::attachReader()
+{
+    for (auto &slot : mReaders) {
+        bool inUse = false;
+        if (slot.mInUse.compare_exchange_strong(inUse, true)) {
+            slot.reset();
+            return &slot;
+        }
+    }
+    ALOGW("%s: all %zu reader slots in use, reader statistics not available",
+            __func__, kMaxReaders);
+    return NULL;
+}
+
+void MultiReaderPipe::detachReader(ReaderSlot *slot)
+{
+    if (slot != NULL) {
+        slot->mInUse.store(false);
+    }
+}
+
+// Returns the inclusive upper bound in frames of a lag histogram bucket.
+static uint32_t lagBucketLimit(size_t bucket)
+{
+    return bucket == 0 ? 0 : (uint32_t) ((1ULL << bucket) - 1);
+}
+
+size_t MultiReaderPipe::getReaderStats(ReaderStats stats[], size_t maxStats) const
+{
+    size_t count = 0;
+    for (const auto &slot : mReaders) {
+        if (count >= maxStats) {
+            break;
+        }
+        if (!slot.mInUse.load()) {
+            continue;
+        }
+        ReaderStats *s = &stats[count++];
+        s->mFramesRead = slot.mFramesRead.load(std::memory_order_relaxed);
+        s->mLag = slot.mLag.load(std::memory_order_relaxed);
+        s->mOverruns = slot.mOverruns.load(std::memory_order_relaxed);
+        s->mFramesOverrun = slot.mFramesOverrun.load(std::memory_order_relaxed);
+
+        uint32_t histogram[kLagBuckets];
+        uint64_t total = 0;
+        for (size_t i = 0; i < kLagBuckets; ++i) {
+            histogram[i] = slot.mLagHistogram[i].load(std::memory_order_relaxed);
+            total += histogram[i];
+        }
+        // percentiles are reported as the upper limit of the bucket that contains them
+        const uint64_t p50 = (total * 50 + 99) / 100;
+        const uint64_t p90 = (total * 90 + 99) / 100;
+        const uint64_t p99 = (total * 99 + 99) / 100;
+        s->mLagP50 = s->mLagP90 = s->mLagP99 = 0;
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kLagBuckets && cumulative < p99; ++i) {
+            const uint64_t previous = cumulative;
+            cumulative += histogram[i];
+            if (previous < p50 && cumulative >= p50) s->mLagP50 = lagBucketLimit(i);
+            if (previous < p90 && cumulative >= p90) s->mLagP90 = lagBucketLimit(i);
+            if (previous < p99 && cumulative >= p99) s->mLagP99 = lagBucketLimit(i);
+        }
+    }
+    return count;
+}
+
+std::string MultiReaderPipe::dump() const
+{
+    ReaderStats stats[kMaxReaders];
+    const size_t count = getReaderStats(stats, kMaxReaders);
+    const unsigned sampleRate = Format_sampleRate(mFormat);
+    std::string result;
+    char line[256];
+    snprintf(line, sizeof(line), "MultiReaderPipe frames:%zu written:%lld readers:%zu\n",
+            mMaxFrames, (long long) mFramesWritten, count);
+    result.append(line);
+    for (size_t i = 0; i < count; ++i) {
+        const ReaderStats &s = stats[i];
+        const double msPerFrame = sampleRate != 0 ? 1000. / sampleRate : 0.;
+        snprintf(line, sizeof(line),
+                "  reader %zu: read:%lld lag:%lld overruns:%lld framesOverrun:%lld"
+                " lag p50:%.2f p90:%.2f p99:%.2f ms\n",
+                i, (long long) s.mFramesRead, (long long) s.mLag, (long long) s.mOverruns,
+                (long long) s.mFramesOverrun,
+                s.mLagP50 * msPerFrame, s.mLagP90 * msPerFrame, s.mLagP99 * msPerFrame);
+        result.append(line);
+    }
+    return result;
+}
+
+}   // namespace android
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MultiReaderPipeReader"
+//#define LOG_NDEBUG 0
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <cutils/compiler.h>
+#include <utils/Log.h>
+#include <media/nbaio/MultiReaderPipeReader.h>
+
+namespace android {
+
+MultiReaderPipeReader::MultiReaderPipeReader(MultiReaderPipe& pipe) :
+        NBAIO_Source(pipe.mFormat),
+        mPipe(pipe),
+        mSlot(pipe.attachReader()),
+        mFront(pipe.mRear.load(std::memory_order_acquire)),
+        mFramesOverrun(0),
+        mOverruns(0)
+{
+}
+
+MultiReaderPipeReader::~MultiReaderPipeReader()
+{
+    mPipe.detachReader(mSlot);
+}
+
+void MultiReaderPipeReader::overrun(int64_t rear, int64_t lost)
+{
+    // like audio_utils_fifo, drop everything and resynchronize to the writer
+    mFront = rear;
+    mFramesOverrun += lost;
+    ++mOverruns;
+    if (mSlot != NULL) {
+        mSlot->mFramesOverrun.store(mFramesOverrun, std::memory_order_relaxed);
+        mSlot->mOverruns.store(mOverruns, std::memory_order_relaxed);
+    }
+}
+
+ssize_t MultiReaderPipeReader::available(int64_t rear)
+{
+    const int64_t filled = rear - mFront;
+    if (filled > (int64_t) mPipe.mMaxFrames) {
+        overrun(rear, filled - mPipe.mMaxFrames);
+        return OVERRUN;
+    }
+    return (ssize_t) filled;
+}
+
+ssize_t MultiReaderPipeReader::availableToRead()
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    return available(mPipe.mRear.load(std::memory_order_acquire));
+}
+
+ssize_t MultiReaderPipeReader::read(void *buffer, size_t count)
+{
+    const int64_t rear = mPipe.mRear.load(std::memory_order_acquire);
+    const ssize_t avail = available(rear);
+    if (avail <= 0) {
+        return avail;
+    }
+    if (mSlot != NULL) {
+        // single writer per slot, so no need for a read-modify-write
+        const size_t bucket = std::min((size_t) (64 - __builtin_clzll((uint64_t) avail)),
+                MultiReaderPipe::kLagBuckets - 1);
+        std::atomic<uint32_t> &counter = mSlot->mLagHistogram[bucket];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        mSlot->mLag.store(avail, std::memory_order_relaxed);
+    }
+
+    const size_t maxFrames = mPipe.mMaxFrames;
+    const size_t frameSize = mPipe.mFrameSize;
+    const size_t actual = std::min(count, (size_t) avail);
+    const size_t offset = (size_t) mFront & (maxFrames - 1);
+    const size_t part1 = std::min(actual, maxFrames - offset);
+    memcpy(buffer, (const char *) mPipe.mBuffer + offset * frameSize, part1 * frameSize);
+    if (part1 < actual) {
+        memcpy((char *) buffer + part1 * frameSize, mPipe.mBuffer, (actual - part1) * frameSize);
+    }
+
+    // make sure the writer did not start overwriting the frames while we were copying them
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const int64_t writeEnd = mPipe.mWriteEnd.load(std::memory_order_relaxed);
+    if (writeEnd - (int64_t) maxFrames > mFront) {
+        overrun(mPipe.mRear.load(std::memory_order_acquire), writeEnd - maxFrames - mFront);
+        return OVERRUN;
+    }
+
+    mFront += actual;
+    mFramesRead += actual;
+    if (mSlot != NULL) {
+        mSlot->mFramesRead.store(mFramesRead, std::memory_order_relaxed);
+    }
+    return actual;
+}
+
+ssize_t MultiReaderPipeReader::flush()
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    const int64_t rear = mPipe.mRear.load(std::memory_order_acquire);
+    const ssize_t flushed = available(rear);
+    if (flushed <= 0) {
+        return flushed;
+    }
+    mFront = rear;
+    mFramesRead += flushed;  // we consider flushed frames as read, but not lost frames
+    if (mSlot != NULL) {
+        mSlot->mFramesRead.store(mFramesRead, std::memory_order_relaxed);
+    }
+    return flushed;
+}
+
+}   // namespace android
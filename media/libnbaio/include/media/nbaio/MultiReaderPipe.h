@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MULTI_READER_PIPE_H
+#define ANDROID_AUDIO_MULTI_READER_PIPE_H
+
+#include <atomic>
+#include <string>
+
+#include <media/nbaio/NBAIO.h>
+
+namespace android {
+
+// MultiReaderPipe is similar to Pipe, 1 writer and N readers (see MultiReaderPipeReader),
+// but each reader occupies its own cache-line aligned slot which publishes the reader's lag,
+// overrun counts, and a lag histogram.  These can be read at any time by a third thread,
+// typically for dumpsys, to see which reader is falling behind a shared capture stream.
+//
+// The ring is lock-free: the writer never waits for readers, and a reader that is lapped by
+// the writer detects it after the copy and reports OVERRUN, as PipeReader does.
+// It is not multi-thread safe for more than one writer, or for a given reader.
+class MultiReaderPipe : public NBAIO_Sink {
+
+    friend class MultiReaderPipeReader;
+
+public:
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr size_t kMaxReaders = 8;
+    static constexpr size_t kLagBuckets = 24;   // log2 buckets, last one is open ended
+
+    // maxFrames will be rounded up to a power of 2, and all slots are available. Must be >= 2.
+    MultiReaderPipe(size_t maxFrames, const NBAIO_Format& format);
+    virtual ~MultiReaderPipe();
+
+    // NBAIO_Sink interface
+
+    // The write side permits overruns; flow control is the caller's responsibility.
+    virtual ssize_t availableToWrite() { return mMaxFrames; }
+
+    // A write larger than the pipe keeps only the last mMaxFrames frames.
+    virtual ssize_t write(const void *buffer, size_t count);
+
+    // Snapshot of one attached reader, see getReaderStats().
+    struct ReaderStats {
+        int64_t  mFramesRead;
+        int64_t  mLag;              // frames available to the reader at its last read
+        int64_t  mOverruns;
+        int64_t  mFramesOverrun;
+        uint32_t mLagP50;           // lag percentiles over all reads, in frames
+        uint32_t mLagP90;
+        uint32_t mLagP99;
+    };
+
+    // Fills at most maxStats entries for the currently attached readers, returns the count.
+    // Safe to call from any thread; values of a reader may be mutually inconsistent.
+    size_t getReaderStats(ReaderStats stats[], size_t maxStats) const;
+
+    // Readable summary of getReaderStats(), one line per reader.
+    std::string dump() const;
+
+private:
+    // One per attached reader; written only by the reader, read by getReaderStats().
+    struct alignas(kCacheLineSize) ReaderSlot {
+        std::atomic<bool>     mInUse{false};
+        std::atomic<int64_t>  mFramesRead{0};
+        std::atomic<int64_t>  mLag{0};
+        std::atomic<int64_t>  mOverruns{0};
+        std::atomic<int64_t>  mFramesOverrun{0};
+        std::atomic<uint32_t> mLagHistogram[kLagBuckets];
+
+        void reset();
+    };
+
+    ReaderSlot *attachReader();
+    void detachReader(ReaderSlot *slot);
+
+    const size_t    mMaxFrames;     // always a power of 2
+    const size_t    mFrameSize;
+    void * const    mBuffer;
+
+    // Written only by the writer, and kept away from the reader slots.
+    // mWriteEnd is advanced before the frames are copied and mRear after, so a reader
+    // can tell whether frames it copied may have been overwritten in the meantime.
+    alignas(kCacheLineSize) std::atomic<int64_t> mRear;
+    std::atomic<int64_t> mWriteEnd;
+
+    ReaderSlot      mReaders[kMaxReaders];
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_MULTI_READER_PIPE_H
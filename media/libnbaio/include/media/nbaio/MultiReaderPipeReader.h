@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
+#define ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
+
+#include "MultiReaderPipe.h"
+
+namespace android {
+
+// MultiReaderPipeReader is safe for only a single thread.
+// A reader starts at the current write position of the pipe.
+class MultiReaderPipeReader : public NBAIO_Source {
+
+public:
+    explicit MultiReaderPipeReader(MultiReaderPipe& pipe);
+    virtual ~MultiReaderPipeReader();
+
+    // NBAIO_Source interface
+
+    virtual int64_t framesOverrun() { return mFramesOverrun; }
+    virtual int64_t overruns()  { return mOverruns; }
+
+    virtual ssize_t availableToRead();
+
+    virtual ssize_t read(void *buffer, size_t count);
+
+    virtual ssize_t flush();
+
+    // NBAIO_Source end
+
+private:
+    // Returns frames available at mFront, or OVERRUN after resynchronizing to rear.
+    ssize_t available(int64_t rear);
+    void    overrun(int64_t rear, int64_t lost);
+
+    MultiReaderPipe&   mPipe;
+    MultiReaderPipe::ReaderSlot * const mSlot;    // NULL if all slots were in use
+    int64_t     mFront;
+    int64_t     mFramesOverrun;
+    int64_t     mOverruns;
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
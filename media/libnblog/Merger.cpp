@@ -169,7 +169,7 @@ void MergeReader::processSnapshot(Snapshot &snapshot, int author)
         } break;
         case EVENT_UNDERRUN: {
             const int64_t ts = it.payload<int64_t>();
-            data.underruns++;
+            data.addUnderrun(ts);
             data.snapshots.emplace_front(EVENT_UNDERRUN, ts);
             // TODO have a data structure to automatically handle resizing
             if (data.snapshots.size() > ReportPerformance::PerformanceData::kMaxSnapshotsToStore) {
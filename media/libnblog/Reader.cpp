@@ -236,6 +236,9 @@ void DumpReader::dump(int fd, size_t indent)
         case EVENT_FMT_START:
             it = handleFormat(FormatEntry(it), &timestamp, &body);
             break;
+        case EVENT_FMT_PACKED:
+            handlePackedFormat(it, &timestamp, &body);
+            break;
         case EVENT_LATENCY: {
             const double latencyMs = it.payload<double>();
             body.appendFormat("EVENT_LATENCY,%.3f", latencyMs);
@@ -281,6 +284,106 @@ void DumpReader::dump(int fd, size_t indent)
     }
 }
 
+static void appendJsonString(String8 *out, const char *str, size_t length)
+{
+    out->append("\"");
+    for (size_t i = 0; i < length; ++i) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            out->appendFormat("\\%c", c);
+        } else if ((unsigned char) c < 0x20) {
+            out->appendFormat("\\u%04x", c);
+        } else {
+            out->append(&c, 1);
+        }
+    }
+    out->append("\"");
+}
+
+// Timestamped entries become instant events. Work times are not timestamped: they are
+// consecutive cycle durations, so they become complete "cycle" events placed back to back
+// after the latest timestamped entry.
+void DumpReader::dumpTraceEvents(int fd, int pid, int tid, bool *first)
+{
+    if (fd < 0) return;
+    std::unique_ptr<Snapshot> snapshot = getSnapshot(false /*flush*/);
+    if (snapshot == nullptr) {
+        return;
+    }
+    auto emit = [&](const String8 &event) {
+        dprintf(fd, "%s%s\n", *first ? "" : ",", event.string());
+        *first = false;
+    };
+
+    String8 event;
+    event.appendFormat("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":", pid, tid);
+    appendJsonString(&event, name().c_str(), name().size());
+    event.append("}}");
+    emit(event);
+
+    int64_t cycleStartNs = -1;  // end of the last cycle, if known
+    String8 timestamp, body;
+    for (EntryIterator it = snapshot->begin(); it != snapshot->end(); ++it) {
+        const char *eventName = nullptr;
+        int64_t ts = -1;
+        body.clear();
+        switch (it->type) {
+        case EVENT_FMT_START: {
+            const FormatEntry fmtEntry(it);
+            ts = fmtEntry.timestamp();
+            it = handleFormat(fmtEntry, &timestamp, &body);
+        } break;
+        case EVENT_FMT_PACKED:
+            ts = handlePackedFormat(it, &timestamp, &body);
+            break;
+        case EVENT_AUDIO_STATE:
+            ts = it.payload<HistTsEntry>().ts;
+            eventName = "audio state";
+            break;
+        case EVENT_HISTOGRAM_ENTRY_TS:
+            ts = it.payload<HistTsEntry>().ts;
+            eventName = "wakeup";
+            break;
+        case EVENT_UNDERRUN:
+            ts = it.payload<int64_t>();
+            eventName = "underrun";
+            break;
+        case EVENT_OVERRUN:
+            ts = it.payload<int64_t>();
+            eventName = "overrun";
+            break;
+        case EVENT_WORK_TIME: {
+            const int64_t monotonicNs = it.payload<int64_t>();
+            if (cycleStartNs >= 0) {
+                event.clear();
+                event.appendFormat("{\"ph\":\"X\",\"name\":\"cycle\",\"pid\":%d,\"tid\":%d,"
+                        "\"ts\":%.3f,\"dur\":%.3f}",
+                        pid, tid, cycleStartNs * 1e-3, monotonicNs * 1e-3);
+                emit(event);
+                cycleStartNs += monotonicNs;
+            }
+        } break;
+        default:
+            break;
+        }
+        if (ts < 0) {
+            continue;
+        }
+        cycleStartNs = ts;
+        event.clear();
+        event.appendFormat("{\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                "\"name\":", pid, tid, ts * 1e-3);
+        if (eventName != nullptr) {
+            appendJsonString(&event, eventName, strlen(eventName));
+        } else {
+            appendJsonString(&event, body.string(), body.size());
+        }
+        event.append("}");
+        emit(event);
+    }
+}
+
 EntryIterator DumpReader::handleFormat(const FormatEntry &fmtEntry,
         String8 *timestamp, String8 *body)
 {
@@ -380,6 +483,93 @@ EntryIterator DumpReader::handleFormat(const FormatEntry &fmtEntry,
     return arg;
 }
 
+// Decodes an entry written by Writer::logFormatPacked(), see PackedFormat for the layout.
+int64_t DumpReader::handlePackedFormat(const EntryIterator &it, String8 *timestamp,
+        String8 *body)
+{
+    const uint8_t *data = it->data;
+    const size_t length = it->length;
+    size_t offset = sizeof(log_hash_t) + sizeof(int64_t) + 1;
+    if (length < offset) {
+        body->appendFormat("warning: short packed format entry of %zu bytes", length);
+        return -1;
+    }
+
+    log_hash_t hash;
+    memcpy(&hash, data, sizeof(hash));
+    int64_t ts;
+    memcpy(&ts, data + sizeof(hash), sizeof(ts));
+    const size_t fmtLength = data[sizeof(hash) + sizeof(ts)];
+    if (offset + fmtLength > length) {
+        body->appendFormat("warning: bad packed format length %zu", fmtLength);
+        return -1;
+    }
+    const char *fmt = (const char *) data + offset;
+    offset += fmtLength;
+
+    timestamp->appendFormat("[%d.%03d]", (int) (ts / (1000 * 1000 * 1000)),
+                    (int) ((ts / (1000 * 1000)) % 1000));
+    body->appendFormat("%.4X-%d ", (int)(hash >> 16) & 0xFFFF, (int) hash & 0xFFFF);
+
+    for (size_t fmt_offset = 0; fmt_offset < fmtLength; ++fmt_offset) {
+        if (fmt[fmt_offset] != '%') {
+            body->append(&fmt[fmt_offset], 1);
+            continue;
+        }
+        if (++fmt_offset == fmtLength) {
+            break;
+        }
+        if (fmt[fmt_offset] == '%') {
+            body->append("%");
+            continue;
+        }
+        // the writer tagged each argument with its type, so no need to trust the specifier
+        if (offset >= length) {
+            body->append("<?>");
+            continue;
+        }
+        const Event type = (Event) data[offset++];
+        size_t size;
+        switch (type) {
+        case EVENT_FMT_INTEGER:
+            size = sizeof(int32_t);
+            break;
+        case EVENT_FMT_FLOAT:
+            size = sizeof(float);
+            break;
+        case EVENT_FMT_TIMESTAMP:
+            size = sizeof(int64_t);
+            break;
+        case EVENT_FMT_STRING:
+            size = offset < length ? data[offset++] : 0;
+            break;
+        default:
+            ALOGW("NBLog Reader encountered unknown packed argument type %d", type);
+            return ts;
+        }
+        if (offset + size > length) {
+            ALOGW("NBLog Reader encountered truncated packed argument");
+            return ts;
+        }
+        switch (type) {
+        case EVENT_FMT_INTEGER:
+            appendInt(body, data + offset);
+            break;
+        case EVENT_FMT_FLOAT:
+            appendFloat(body, data + offset);
+            break;
+        case EVENT_FMT_TIMESTAMP:
+            appendTimestamp(body, data + offset);
+            break;
+        default:
+            body->append((const char *) data + offset, size);
+            break;
+        }
+        offset += size;
+    }
+    return ts;
+}
+
 void DumpReader::appendInt(String8 *body, const void *data)
 {
     if (body == nullptr || data == nullptr) {
@@ -52,6 +52,8 @@ static std::unique_ptr<Json::Value> dumpToJson(const PerformanceData& data)
     root["latencyMsHist"] = data.latencyHist.toString();
     root["warmupMsHist"] = data.warmupHist.toString();
     root["underruns"] = (Json::Value::Int64)data.underruns;
+    root["underrunBursts"] = (Json::Value::Int64)data.underrunBursts;
+    root["maxUnderrunBurst"] = (Json::Value::Int64)data.maxUnderrunBurst;
     root["overruns"] = (Json::Value::Int64)data.overruns;
     root["activeMs"] = (Json::Value::Int64)ns2ms(data.active);
     root["durationMs"] = (Json::Value::Int64)ns2ms(systemTime() - data.start);
@@ -159,12 +161,16 @@ bool sendToMediaMetrics(const PerformanceData& data)
     static constexpr char kThreadLatencyHist[] = "android.media.audiothread.latencyMs.hist";
     static constexpr char kThreadWarmupHist[] = "android.media.audiothread.warmupMs.hist";
     static constexpr char kThreadUnderruns[] = "android.media.audiothread.underruns";
+    static constexpr char kThreadUnderrunBursts[] =
+            "android.media.audiothread.underrunBursts";
+    static constexpr char kThreadMaxUnderrunBurst[] =
+            "android.media.audiothread.maxUnderrunBurst";
     static constexpr char kThreadOverruns[] = "android.media.audiothread.overruns";
     static constexpr char kThreadActive[] = "android.media.audiothread.activeMs";
     static constexpr char kThreadDuration[] = "android.media.audiothread.durationMs";
 
-    // Currently, we only allow FastMixer thread data to be sent to Media Metrics.
-    if (data.threadInfo.type != NBLog::FASTMIXER) {
+    // Threads that never logged their info can't be told apart in Media Metrics.
+    if (data.threadInfo.type == NBLog::UNKNOWN) {
         return false;
     }
 
@@ -187,6 +193,8 @@ bool sendToMediaMetrics(const PerformanceData& data)
 
     if (data.underruns > 0) {
         item->setInt64(kThreadUnderruns, data.underruns);
+        item->setInt64(kThreadUnderrunBursts, data.underrunBursts);
+        item->setInt64(kThreadMaxUnderrunBurst, data.maxUnderrunBurst);
     }
 
     if (data.overruns > 0) {
@@ -294,6 +294,80 @@ void Writer::logVFormat(const char *fmt, log_hash_t hash, va_list argp)
 
 // ---------------------------------------------------------------------------
 
+static_assert(PackedFormat::kMaxLength == Entry::kMaxLength, "PackedFormat must fit an Entry");
+
+PackedFormat::PackedFormat(const char *fmt, log_hash_t hash)
+{
+    const int64_t ts = systemTime();
+    append(&hash, sizeof(hash));
+    append(&ts, sizeof(ts));
+    // leave room for at least a few arguments
+    const size_t maxFmtLength = kMaxLength - mLength - 1 - 32;
+    size_t length = strlen(fmt);
+    if (length > maxFmtLength) {
+        length = maxFmtLength;
+    }
+    const uint8_t fmtLength = length;
+    append(&fmtLength, sizeof(fmtLength));
+    append(fmt, length);
+}
+
+void PackedFormat::addInteger(int32_t value)
+{
+    if (mFull || mLength + 1 + sizeof(value) > kMaxLength) {
+        mFull = true;
+        return;
+    }
+    mData[mLength++] = EVENT_FMT_INTEGER;
+    append(&value, sizeof(value));
+}
+
+void PackedFormat::addTimestamp(int64_t value)
+{
+    if (mFull || mLength + 1 + sizeof(value) > kMaxLength) {
+        mFull = true;
+        return;
+    }
+    mData[mLength++] = EVENT_FMT_TIMESTAMP;
+    append(&value, sizeof(value));
+}
+
+void PackedFormat::add(double value)
+{
+    const float f = (float) value;
+    if (mFull || mLength + 1 + sizeof(f) > kMaxLength) {
+        mFull = true;
+        return;
+    }
+    mData[mLength++] = EVENT_FMT_FLOAT;
+    append(&f, sizeof(f));
+}
+
+void PackedFormat::add(const char *value)
+{
+    if (value == nullptr) {
+        value = "(null)";
+    }
+    if (mFull || mLength + 2 > kMaxLength) {
+        mFull = true;
+        return;
+    }
+    // strings are truncated to what is left, rather than dropped
+    size_t length = strlen(value);
+    if (length > kMaxLength - mLength - 2) {
+        length = kMaxLength - mLength - 2;
+    }
+    mData[mLength++] = EVENT_FMT_STRING;
+    mData[mLength++] = (uint8_t) length;
+    append(value, length);
+}
+
+void PackedFormat::append(const void *data, size_t length)
+{
+    memcpy(&mData[mLength], data, length);
+    mLength += length;
+}
+
 LockedWriter::LockedWriter(void *shared, size_t size)
     : Writer(shared, size)
 {
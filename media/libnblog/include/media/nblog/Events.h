@@ -68,6 +68,8 @@ enum Event : uint8_t {
     EVENT_WARMUP_TIME,          // thread warmup time
     EVENT_WORK_TIME,            // the time a thread takes to do work, e.g. read, write, etc.
     EVENT_THREAD_PARAMS,        // see thread_params_t below
+    EVENT_FMT_PACKED,           // logFormatPacked entry: hash, timestamp, format string and
+                                // all arguments in one entry, see PackedFormat in Writer.h
 
     EVENT_UPPER_BOUND,          // to check for invalid events
 };
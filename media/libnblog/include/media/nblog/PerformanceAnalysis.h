@@ -160,6 +160,12 @@ struct PerformanceData {
     Histogram latencyHist{kLatencyConfig};
     Histogram warmupHist{kWarmupConfig};
     int64_t underruns = 0;
+    // Underruns closer together than this are one burst, as users hear them as one glitch.
+    static constexpr nsecs_t kUnderrunBurstGapNs = 100 * 1000000LL; // 100 ms
+    int64_t underrunBursts = 0;
+    int64_t maxUnderrunBurst = 0;       // underruns in the longest burst
+    int64_t currentUnderrunBurst = 0;
+    int64_t lastUnderrunTs = 0;
     static constexpr size_t kMaxSnapshotsToStore = 256;
     std::deque<std::pair<NBLog::Event, int64_t /*timestamp*/>> snapshots;
     int64_t overruns = 0;
@@ -174,11 +180,28 @@ struct PerformanceData {
         latencyHist.clear();
         warmupHist.clear();
         underruns = 0;
+        underrunBursts = 0;
+        maxUnderrunBurst = 0;
+        currentUnderrunBurst = 0;
         overruns = 0;
         active = 0;
         start = systemTime();
     }
 
+    // Count the underrun at timestamp ts towards the bursts.
+    void addUnderrun(int64_t ts) {
+        underruns++;
+        if (currentUnderrunBurst == 0 || ts - lastUnderrunTs > kUnderrunBurstGapNs) {
+            underrunBursts++;
+            currentUnderrunBurst = 0;
+        }
+        currentUnderrunBurst++;
+        if (currentUnderrunBurst > maxUnderrunBurst) {
+            maxUnderrunBurst = currentUnderrunBurst;
+        }
+        lastUnderrunTs = ts;
+    }
+
     // Return true if performance data has not been recorded yet, false otherwise.
     bool empty() const {
         return workHist.totalCount() == 0 && latencyHist.totalCount() == 0
@@ -115,9 +115,17 @@ public:
     DumpReader(const sp<IMemory>& iMemory, size_t size, const std::string &name)
         : Reader(iMemory, size, name) {}
     void dump(int fd, size_t indent = 0);
+
+    // Writes the entries as Chrome JSON trace events (the "traceEvents" array elements,
+    // each preceded by a comma unless *first), which Perfetto and systrace can import.
+    // Events are on the track of the given pid and tid, which is named after this reader.
+    // Timestamps are CLOCK_MONOTONIC.
+    void dumpTraceEvents(int fd, int pid, int tid, bool *first);
 private:
     void handleAuthor(const AbstractEntry& fmtEntry __unused, String8* body __unused) {}
     EntryIterator handleFormat(const FormatEntry &fmtEntry, String8 *timestamp, String8 *body);
+    // returns the timestamp of the entry, or -1 if it is malformed
+    int64_t handlePackedFormat(const EntryIterator &it, String8 *timestamp, String8 *body);
 
     static void    appendInt(String8 *body, const void *data);
     static void    appendFloat(String8 *body, const void *data);
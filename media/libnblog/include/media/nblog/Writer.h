@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stddef.h>
+#include <type_traits>
 
 #include <binder/IMemory.h>
 #include <media/nblog/Events.h>
@@ -37,6 +38,42 @@ namespace NBLog {
 class Entry;
 struct Shared;
 
+// Builds the payload of an EVENT_FMT_PACKED entry:
+//     log_hash_t hash, int64_t timestamp, uint8_t format length, format string (not terminated),
+// then for each argument its type as an Event (EVENT_FMT_INTEGER, EVENT_FMT_FLOAT,
+// EVENT_FMT_TIMESTAMP or EVENT_FMT_STRING) followed by the value; strings are preceded by
+// a uint8_t length. Arguments that do not fit in the entry are dropped.
+class PackedFormat {
+public:
+    PackedFormat(const char *fmt, log_hash_t hash);
+
+    // %d, whatever the width of the argument; 64 bit integers are logged as %t
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type add(T value) {
+        if (sizeof(T) <= sizeof(int32_t)) {
+            addInteger(static_cast<int32_t>(value));
+        } else {
+            addTimestamp(static_cast<int64_t>(value));
+        }
+    }
+    void add(double value);             // %f, stored as float
+    void add(const char *value);        // %s
+
+    const uint8_t *data() const { return mData; }
+    size_t length() const { return mLength; }
+
+    static constexpr size_t kMaxLength = 255;   // Entry::kMaxLength
+
+private:
+    void addInteger(int32_t value);
+    void addTimestamp(int64_t value);
+    void append(const void *data, size_t length);
+
+    uint8_t mData[kMaxLength];
+    size_t  mLength = 0;
+    bool    mFull = false;                  // an argument was dropped, and all after it
+};
+
 // NBLog Writer Interface
 
 // Writer is thread-safe with respect to Reader, but not with respect to multiple threads
@@ -57,6 +94,21 @@ public:
     void    logf(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
     void    logTimestamp();
     void    logFormat(const char *fmt, log_hash_t hash, ...);
+
+    // Same as logFormat(), but cheap enough to call on every cycle of a fast thread:
+    // the argument types are known at compile time, so the format string is not parsed
+    // here, and the call writes a single entry instead of one per argument.
+    // The format is only interpreted when the log is dumped. %p is not supported.
+    template<typename... Ts>
+    void    logFormatPacked(const char *fmt, log_hash_t hash, Ts... args) {
+        if (!mEnabled) {
+            return;
+        }
+        PackedFormat packed(fmt, hash);
+        int dummy[] = { 0, (packed.add(args), 0)... };
+        (void) dummy;
+        log(EVENT_FMT_PACKED, packed.data(), packed.length());
+    }
     void    logEventHistTs(Event event, log_hash_t hash);
 
     // Log data related to Event E. See the event-to-type mapping for the type of data
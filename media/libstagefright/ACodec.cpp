@@ -563,9 +563,11 @@ ACodec::ACodec()
       mDequeueCounter(0),
       mMetadataBuffersToSubmit(0),
       mNumUndequeuedBuffers(0),
+      mKeepOutputMemory(false),
       mRepeatFrameDelayUs(-1LL),
       mMaxPtsGapUs(0LL),
       mMaxFps(-1),
+      mMaxInputLatencyUs(-1LL),
       mFps(-1.0),
       mCaptureFps(-1.0),
       mCreateInputBuffersSuspended(false),
@@ -957,24 +959,39 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                             : new SecureBuffer(format, native_handle, bufSize);
                     info.mCodecData = info.mData;
                 } else {
-                    bool success;
-                    auto transStatus = mAllocator[portIndex]->allocate(
-                            bufSize,
-                            [&success, &hidlMemToken](
-                                    bool s,
-                                    hidl_memory const& m) {
-                                success = s;
-                                hidlMemToken = m;
-                            });
-
-                    if (!transStatus.isOk()) {
-                        ALOGE("hidl's AshmemAllocator failed at the "
-                                "transport: %s",
-                                transStatus.description().c_str());
-                        return NO_MEMORY;
+                    bool reused = false;
+                    if (portIndex == kPortIndexOutput
+                            && mode == IOMX::kPortModePresetByteBuffer) {
+                        for (auto it = mReusableOutputMemory.begin();
+                                it != mReusableOutputMemory.end(); ++it) {
+                            if (it->size() >= bufSize) {
+                                hidlMemToken = *it;
+                                mReusableOutputMemory.erase(it);
+                                reused = true;
+                                break;
+                            }
+                        }
                     }
-                    if (!success) {
-                        return NO_MEMORY;
+                    if (!reused) {
+                        bool success;
+                        auto transStatus = mAllocator[portIndex]->allocate(
+                                bufSize,
+                                [&success, &hidlMemToken](
+                                        bool s,
+                                        hidl_memory const& m) {
+                                    success = s;
+                                    hidlMemToken = m;
+                                });
+
+                        if (!transStatus.isOk()) {
+                            ALOGE("hidl's AshmemAllocator failed at the "
+                                    "transport: %s",
+                                    transStatus.description().c_str());
+                            return NO_MEMORY;
+                        }
+                        if (!success) {
+                            return NO_MEMORY;
+                        }
                     }
                     hidlMem = mapMemory(hidlMemToken);
                     if (hidlMem == nullptr) {
@@ -992,6 +1009,7 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                     info.mCodecData = new SharedMemoryBuffer(
                             format, hidlMem);
                     info.mCodecRef = hidlMem;
+                    info.mCodecMemToken = hidlMemToken;
 
                     // if we require conversion, allocate conversion buffer for client use;
                     // otherwise, reuse codec buffer
@@ -1026,6 +1044,12 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
         }
     }
 
+    if (portIndex == kPortIndexOutput) {
+        // whatever was not reused is not needed anymore
+        mKeepOutputMemory = false;
+        mReusableOutputMemory.clear();
+    }
+
     if (err != OK) {
         return err;
     }
@@ -1567,6 +1591,8 @@ status_t ACodec::freeBuffersOnPort(OMX_U32 portIndex) {
         mBufferChannel->setInputBufferArray({});
     } else {
         mBufferChannel->setOutputBufferArray({});
+        mKeepOutputMemory = false;
+        mReusableOutputMemory.clear();
     }
 
     status_t err = OK;
@@ -1641,6 +1667,10 @@ status_t ACodec::freeBuffer(OMX_U32 portIndex, size_t i) {
     if (portIndex == kPortIndexOutput) {
         mRenderTracker.untrackFrame(info->mRenderInfo, i);
         info->mRenderInfo = NULL;
+
+        if (err == OK && mKeepOutputMemory && info->mCodecMemToken.handle() != nullptr) {
+            mReusableOutputMemory.push_back(info->mCodecMemToken);
+        }
     }
 
     // remove buffer even if mOMXNode->freeBuffer fails
@@ -1843,6 +1873,10 @@ status_t ACodec::configureCodec(
             mMaxFps = -1;
         }
 
+        if (!msg->findInt64("max-input-latency-us", &mMaxInputLatencyUs)) {
+            mMaxInputLatencyUs = -1LL;
+        }
+
         if (!msg->findDouble("time-lapse-fps", &mCaptureFps)) {
             mCaptureFps = -1.0;
         }
@@ -6899,6 +6933,16 @@ status_t ACodec::LoadedState::setupInputSurface() {
         }
     }
 
+    if (mCodec->mMaxInputLatencyUs > 0) {
+        err = statusFromBinderStatus(
+                mCodec->mGraphicBufferSource->setMaxLatencyUs(mCodec->mMaxInputLatencyUs));
+
+        // not fatal, the frames are all encoded then
+        ALOGW_IF(err != OK, "[%s] Unable to configure max input latency (err %d)",
+                mCodec->mComponentName.c_str(), err);
+        err = OK;
+    }
+
     if (mCodec->mCaptureFps > 0. && mCodec->mFps > 0.) {
         err = statusFromBinderStatus(
                 mCodec->mGraphicBufferSource->setTimeLapseConfig(
@@ -8023,6 +8067,10 @@ bool ACodec::ExecutingState::onOMXEvent(
                             OMX_CommandPortDisable, kPortIndexOutput),
                          (status_t)OK);
 
+                // the buffers are freed here and as they come back; keep their memory for
+                // the buffers allocated once the port is disabled.
+                mCodec->mKeepOutputMemory = true;
+
                 mCodec->freeOutputBuffersNotOwnedByComponent();
 
                 mCodec->changeState(mCodec->mOutputPortSettingsChangedState);
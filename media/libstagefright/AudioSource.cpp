@@ -69,7 +69,8 @@ AudioSource::AudioSource(
       mNumFramesSkipped(0),
       mNumFramesLost(0),
       mNumClientOwnedBuffers(0),
-      mNoMoreFramesToRead(false) {
+      mNoMoreFramesToRead(false),
+      mTimestampBaseUs(-1) {
     ALOGV("sampleRate: %u, outSampleRate: %u, channelCount: %u",
             sampleRate, outSampleRate, channelCount);
     CHECK(channelCount == 1 || channelCount == 2);
@@ -121,6 +122,8 @@ AudioSource::~AudioSource() {
     if (mStarted) {
         reset();
     }
+    Mutex::Autolock autoLock(mLock);
+    releaseFreeBuffers_l();
 }
 
 status_t AudioSource::initCheck() const {
@@ -141,6 +144,7 @@ status_t AudioSource::start(MetaData *params) {
     mMaxAmplitude = 0;
     mInitialReadTimeUs = 0;
     mStartTimeUs = 0;
+    mTimestampBaseUs = -1;
     int64_t startTimeUs;
     if (params && params->findInt64(kKeyTime, &startTimeUs)) {
         mStartTimeUs = startTimeUs;
@@ -166,6 +170,13 @@ void AudioSource::releaseQueuedFrames_l() {
     }
 }
 
+void AudioSource::releaseFreeBuffers_l() {
+    while (!mFreeBuffers.empty()) {
+        (*mFreeBuffers.begin())->release();
+        mFreeBuffers.erase(mFreeBuffers.begin());
+    }
+}
+
 void AudioSource::waitOutstandingEncodingFrames_l() {
     ALOGV("waitOutstandingEncodingFrames_l: %" PRId64, mNumClientOwnedBuffers);
     while (mNumClientOwnedBuffers > 0) {
@@ -191,6 +202,7 @@ status_t AudioSource::reset() {
     mRecord->stop();
     waitOutstandingEncodingFrames_l();
     releaseQueuedFrames_l();
+    releaseFreeBuffers_l();
 
     return OK;
 }
@@ -320,7 +332,13 @@ void AudioSource::signalBufferReturned(MediaBufferBase *buffer) {
     Mutex::Autolock autoLock(mLock);
     --mNumClientOwnedBuffers;
     buffer->setObserver(0);
-    buffer->release();
+    if (buffer->size() == kMaxBufferSize && mFreeBuffers.size() < kMaxFreeBuffers) {
+        // only MediaBuffers are queued, see obtainBuffer_l()
+        buffer->meta_data().clear();
+        mFreeBuffers.push_back(static_cast<MediaBuffer *>(buffer));
+    } else {
+        buffer->release();
+    }
     mFrameEncodingCompletionCondition.signal();
     return;
 }
@@ -334,10 +352,16 @@ status_t AudioSource::dataCallback(const AudioRecord::Buffer& audioBuffer) {
     if (mRecord->getTimestamp(&ts) == OK &&
             ts.getBestTimestamp(&position, &timeNs, ExtendedTimestamp::TIMEBASE_MONOTONIC,
             &location) == OK) {
-        // Use audio timestamp.
-        timeUs = timeNs / 1000 -
-                (position - mNumFramesSkipped -
-                mNumFramesReceived + mNumFramesLost) * usPerSec / mSampleRate;
+        // Use audio timestamp, smoothed: the time of the first frame only drifts slowly
+        // with the audio clock, but each reading of it jitters.
+        const int64_t baseUs = timeNs / 1000 - position * usPerSec / mSampleRate;
+        if (mTimestampBaseUs < 0 || llabs(baseUs - mTimestampBaseUs) > kMaxTimestampJumpUs) {
+            mTimestampBaseUs = baseUs;
+        } else {
+            mTimestampBaseUs += (baseUs - mTimestampBaseUs) / kTimestampSmoothing;
+        }
+        timeUs = mTimestampBaseUs +
+                (mNumFramesSkipped + mNumFramesReceived - mNumFramesLost) * usPerSec / mSampleRate;
     } else {
         // This should not happen in normal case.
         ALOGW("Failed to get audio timestamp, fallback to use systemclock");
@@ -408,7 +432,7 @@ status_t AudioSource::dataCallback(const AudioRecord::Buffer& audioBuffer) {
         } else {
             numLostBytes = 0;
         }
-        MediaBuffer *lostAudioBuffer = new MediaBuffer(bufferSize);
+        MediaBuffer *lostAudioBuffer = obtainBuffer_l(bufferSize);
         memset(lostAudioBuffer->data(), 0, bufferSize);
         lostAudioBuffer->set_range(0, bufferSize);
         mNumFramesLost += bufferSize / mRecord->frameSize();
@@ -420,7 +444,7 @@ status_t AudioSource::dataCallback(const AudioRecord::Buffer& audioBuffer) {
         return OK;
     }
 
-    MediaBuffer *buffer = new MediaBuffer(bufferSize);
+    MediaBuffer *buffer = obtainBuffer_l(bufferSize);
     memcpy((uint8_t *) buffer->data(),
             audioBuffer.i16, audioBuffer.size);
     buffer->set_range(0, bufferSize);
@@ -428,6 +452,18 @@ status_t AudioSource::dataCallback(const AudioRecord::Buffer& audioBuffer) {
     return OK;
 }
 
+MediaBuffer *AudioSource::obtainBuffer_l(size_t size) {
+    if (size > kMaxBufferSize) {
+        return new MediaBuffer(size);
+    }
+    if (mFreeBuffers.empty()) {
+        return new MediaBuffer(kMaxBufferSize);
+    }
+    MediaBuffer *buffer = *mFreeBuffers.begin();
+    mFreeBuffers.erase(mFreeBuffers.begin());
+    return buffer;
+}
+
 void AudioSource::queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs) {
     const size_t bufferSize = buffer->range_length();
     const size_t frameSize = mRecord->frameSize();
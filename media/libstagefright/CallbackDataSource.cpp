@@ -202,4 +202,63 @@ sp<IDataSource> TinyCacheSource::getIDataSource() const {
     return mSource->getIDataSource();
 }
 
+SniffCacheSource::SniffCacheSource(const sp<DataSource>& source)
+    : mSource(source), mHeader(NULL), mHeaderSize(-1) {
+    mName = String8::format("SniffCacheSource(%s)", mSource->toString().string());
+}
+
+SniffCacheSource::~SniffCacheSource() {
+    free(mHeader);
+}
+
+status_t SniffCacheSource::initCheck() const {
+    return mSource->initCheck();
+}
+
+ssize_t SniffCacheSource::readAt(off64_t offset, void* data, size_t size) {
+    if (mHeaderSize < 0 && offset >= 0 && offset < kHeaderSize) {
+        mHeader = (uint8_t *)malloc(kHeaderSize);
+        if (mHeader == NULL) {
+            return mSource->readAt(offset, data, size);
+        }
+        mHeaderSize = mSource->readAt(0, mHeader, kHeaderSize);
+        if (mHeaderSize < 0 || mHeaderSize > kHeaderSize) {
+            // do not cache errors, a later read may succeed
+            free(mHeader);
+            mHeader = NULL;
+            mHeaderSize = -1;
+            return mSource->readAt(offset, data, size);
+        }
+    }
+
+    if (mHeaderSize < 0 || offset < 0 || offset >= mHeaderSize) {
+        return mSource->readAt(offset, data, size);
+    }
+
+    const size_t cached = std::min(size, (size_t)(mHeaderSize - offset));
+    memcpy(data, &mHeader[offset], cached);
+    if (cached == size || mHeaderSize < kHeaderSize) {
+        // done, or the source ends within the header
+        return cached;
+    }
+    const ssize_t readMore = mSource->readAt(
+            offset + cached, (uint8_t*)data + cached, size - cached);
+    if (readMore < 0) {
+        return readMore;
+    }
+    return cached + readMore;
+}
+
+status_t SniffCacheSource::getSize(off64_t *size) {
+    return mSource->getSize(size);
+}
+
+uint32_t SniffCacheSource::flags() {
+    return mSource->flags();
+}
+
+sp<IDataSource> SniffCacheSource::getIDataSource() const {
+    return mSource->getIDataSource();
+}
+
 } // namespace android
@@ -921,6 +921,7 @@ status_t CameraSource::reset() {
 
         CHECK_EQ(mNumFramesReceived, mNumFramesEncoded + mNumFramesDropped);
     }
+    releasePendingBuffers();
 
     if (mBufferQueueListener != nullptr) {
         mBufferQueueListener->requestExit();
@@ -960,9 +961,10 @@ void CameraSource::releaseRecordingFrame(const sp<IMemory>& frame) {
             return;
         }
 
-        BufferItem buffer = mReceivedBufferItemMap.valueAt(index);
+        // Returning the buffer to the queue wakes up the camera's producer, which can take
+        // a while; don't hold mLock, and with it the next frame, meanwhile.
+        mBuffersToRelease.push_back(mReceivedBufferItemMap.valueAt(index));
         mReceivedBufferItemMap.removeItemsAt(index);
-        mVideoBufferConsumer->releaseBuffer(buffer);
         mMemoryBases.push_back(frame);
         mMemoryBaseAvailableCond.signal();
     } else {
@@ -1046,22 +1048,45 @@ void CameraSource::releaseOneRecordingFrame(const sp<IMemory>& frame) {
     releaseRecordingFrame(frame);
 }
 
+void CameraSource::releasePendingBuffers() {
+    std::vector<BufferItem> buffers;
+    sp<BufferItemConsumer> consumer;
+    {
+        Mutex::Autolock autoLock(mLock);
+        buffers.swap(mBuffersToRelease);
+        consumer = mVideoBufferConsumer;
+    }
+    if (consumer == nullptr) {
+        return;
+    }
+    for (const BufferItem &buffer : buffers) {
+        consumer->releaseBuffer(buffer);
+    }
+}
+
 void CameraSource::signalBufferReturned(MediaBufferBase *buffer) {
     ALOGV("signalBufferReturned: %p", buffer->data());
-    Mutex::Autolock autoLock(mLock);
-    for (List<sp<IMemory> >::iterator it = mFramesBeingEncoded.begin();
-         it != mFramesBeingEncoded.end(); ++it) {
-        if ((*it)->pointer() ==  buffer->data()) {
-            releaseOneRecordingFrame((*it));
-            mFramesBeingEncoded.erase(it);
-            ++mNumFramesEncoded;
-            buffer->setObserver(0);
-            buffer->release();
-            mFrameCompleteCondition.signal();
-            return;
+    bool found = false;
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (List<sp<IMemory> >::iterator it = mFramesBeingEncoded.begin();
+             it != mFramesBeingEncoded.end(); ++it) {
+            if ((*it)->pointer() ==  buffer->data()) {
+                releaseOneRecordingFrame((*it));
+                mFramesBeingEncoded.erase(it);
+                ++mNumFramesEncoded;
+                buffer->setObserver(0);
+                buffer->release();
+                mFrameCompleteCondition.signal();
+                found = true;
+                break;
+            }
         }
     }
-    CHECK(!"signalBufferReturned: bogus buffer");
+    if (!found) {
+        CHECK(!"signalBufferReturned: bogus buffer");
+    }
+    releasePendingBuffers();
 }
 
 status_t CameraSource::read(
@@ -1356,6 +1381,8 @@ bool CameraSource::BufferQueueListener::threadLoop() {
     while (mConsumer->acquireBuffer(&buffer, 0) == OK) {
         mCameraSource->processBufferQueueFrame(buffer);
     }
+    // frames that were skipped or dropped
+    mCameraSource->releasePendingBuffers();
 
     return true;
 }
@@ -1365,7 +1392,7 @@ void CameraSource::processBufferQueueFrame(BufferItem& buffer) {
 
     int64_t timestampUs = buffer.mTimestamp / 1000;
     if (shouldSkipFrameLocked(timestampUs)) {
-        mVideoBufferConsumer->releaseBuffer(buffer);
+        mBuffersToRelease.push_back(buffer);
         return;
     }
 
@@ -1373,7 +1400,7 @@ void CameraSource::processBufferQueueFrame(BufferItem& buffer) {
         if (mMemoryBaseAvailableCond.waitRelative(mLock, kMemoryBaseAvailableTimeoutNs) ==
                 TIMED_OUT) {
             ALOGW("Waiting on an available memory base timed out. Dropping a recording frame.");
-            mVideoBufferConsumer->releaseBuffer(buffer);
+            mBuffersToRelease.push_back(buffer);
             return;
         }
     }
@@ -81,7 +81,10 @@ sp<DataSource> DataSourceFactory::CreateFromURI(
         source = NuCachedSource2::Create(
                 httpSource,
                 cacheConfig.isEmpty() ? NULL : cacheConfig.string(),
-                disconnectAtHighwatermark);
+                disconnectAtHighwatermark,
+                httpService,
+                uri,
+                &nonCacheSpecificHeaders);
     } else if (!strncasecmp("data:", uri, 5)) {
         source = DataURISource::Create(uri);
     } else {
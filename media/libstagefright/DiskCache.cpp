@@ -0,0 +1,323 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DiskCache"
+#include <utils/Log.h>
+
+#include "include/DiskCache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+
+namespace android {
+
+static const uint32_t kMagic = 'dsk1';
+static const char *kSuffix = ".dc";
+static const size_t kDefaultSizeMB = 256;
+
+struct EntryHeader {
+    uint32_t mMagic;
+    uint32_t mKeySize;
+    uint64_t mDataSize;
+    uint64_t mChecksum;     // of the key and the data
+};
+
+static Mutex gInstanceLock;
+static sp<DiskCache> gInstance;
+static bool gInstanceChecked = false;
+
+// static
+sp<DiskCache> DiskCache::getInstance() {
+    Mutex::Autolock autoLock(gInstanceLock);
+    if (!gInstanceChecked) {
+        gInstanceChecked = true;
+
+        char dir[PROPERTY_VALUE_MAX];
+        if (property_get("media.stagefright.disk-cache-dir", dir, NULL) > 0) {
+            int32_t sizeMB = property_get_int32(
+                    "media.stagefright.disk-cache-mb", kDefaultSizeMB);
+            if (sizeMB > 0) {
+                sp<DiskCache> cache = new DiskCache(dir, (size_t)sizeMB * 1024 * 1024);
+                if (cache->initCheck() == OK) {
+                    gInstance = cache;
+                }
+            }
+        }
+    }
+    return gInstance;
+}
+
+DiskCache::DiskCache(const char *dir, size_t maxBytes)
+    : mDir(dir),
+      mMaxBytes(maxBytes),
+      mInitCheck(NO_INIT),
+      mTotalBytes(0) {
+    if (access(dir, R_OK | W_OK | X_OK) != 0) {
+        ALOGW("cannot use '%s' for the disk cache: %s", dir, strerror(errno));
+        return;
+    }
+    loadIndex();
+    mInitCheck = OK;
+}
+
+DiskCache::~DiskCache() {
+}
+
+status_t DiskCache::initCheck() const {
+    return mInitCheck;
+}
+
+size_t DiskCache::maxEntrySize() const {
+    // so that one resource does not take the whole cache.
+    return mMaxBytes / 8;
+}
+
+void DiskCache::loadIndex() {
+    DIR *dir = opendir(mDir.c_str());
+    if (dir == NULL) {
+        return;
+    }
+
+    struct IndexEntry {
+        Entry mEntry;
+        time_t mLastUse;
+    };
+    Vector<IndexEntry> entries;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        AString name(ent->d_name);
+        if (!name.endsWith(kSuffix)) {
+            continue;
+        }
+        struct stat st;
+        AString path = AStringPrintf("%s/%s", mDir.c_str(), name.c_str());
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        IndexEntry entry;
+        entry.mEntry.mName = name;
+        entry.mEntry.mSize = st.st_size;
+        entry.mLastUse = st.st_mtime;
+        entries.push_back(entry);
+    }
+    closedir(dir);
+
+    std::sort(entries.editArray(), entries.editArray() + entries.size(),
+            [](const IndexEntry &a, const IndexEntry &b) {
+                return a.mLastUse < b.mLastUse;
+            });
+
+    Vector<AString> paths;
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            mEntries.push_back(entries[i].mEntry);
+            mTotalBytes += entries[i].mEntry.mSize;
+        }
+        evict_l(&paths);
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+    ALOGV("%zu entries, %zu bytes in %s", mEntries.size(), mTotalBytes, mDir.c_str());
+}
+
+ssize_t DiskCache::findEntry_l(const AString &name) const {
+    for (size_t i = mEntries.size(); i-- > 0;) {
+        if (mEntries[i].mName == name) {
+            return i;
+        }
+    }
+    return -ENOENT;
+}
+
+void DiskCache::evict_l(Vector<AString> *paths) {
+    while (mTotalBytes > mMaxBytes && !mEntries.empty()) {
+        mTotalBytes -= mEntries[0].mSize;
+        paths->push_back(AStringPrintf("%s/%s", mDir.c_str(), mEntries[0].mName.c_str()));
+        mEntries.removeAt(0);
+    }
+}
+
+void DiskCache::removeFile(const AString &name) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        ssize_t index = findEntry_l(name);
+        if (index >= 0) {
+            mTotalBytes -= mEntries[index].mSize;
+            mEntries.removeAt(index);
+        }
+    }
+    unlink(AStringPrintf("%s/%s", mDir.c_str(), name.c_str()).c_str());
+}
+
+// static
+AString DiskCache::MakeKey(const AString &uri, int64_t offset, int64_t length) {
+    return AStringPrintf("%s#%lld-%lld", uri.c_str(), (long long)offset, (long long)length);
+}
+
+// static
+uint64_t DiskCache::Hash(const void *data, size_t size, uint64_t hash) {
+    // FNV-1a
+    const uint8_t *ptr = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ ptr[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+sp<ABuffer> DiskCache::lookup(const AString &uri, int64_t offset, int64_t length) {
+    if (mInitCheck != OK) {
+        return NULL;
+    }
+
+    AString key = MakeKey(uri, offset, length);
+    AString name = AStringPrintf(
+            "%016llx%s", (unsigned long long)Hash(key.c_str(), key.size()), kSuffix);
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (findEntry_l(name) < 0) {
+            return NULL;
+        }
+    }
+
+    AString path = AStringPrintf("%s/%s", mDir.c_str(), name.c_str());
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        removeFile(name);
+        return NULL;
+    }
+
+    sp<ABuffer> data;
+    EntryHeader header;
+    bool valid = read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+            && header.mMagic == kMagic
+            && header.mKeySize == key.size()
+            && header.mDataSize <= maxEntrySize();
+    if (valid) {
+        AString storedKey;
+        char buf[256];
+        size_t remaining = header.mKeySize;
+        while (valid && remaining > 0) {
+            ssize_t n = read(fd, buf, std::min(remaining, sizeof(buf)));
+            valid = n > 0;
+            if (valid) {
+                storedKey.append(buf, n);
+                remaining -= n;
+            }
+        }
+        // another key with the same hash
+        if (!valid || storedKey != key) {
+            close(fd);
+            return NULL;
+        }
+        data = new ABuffer(header.mDataSize);
+        valid = data->data() != NULL
+                && read(fd, data->data(), data->size()) == (ssize_t)data->size()
+                && Hash(data->data(), data->size(), Hash(key.c_str(), key.size()))
+                        == header.mChecksum;
+    }
+    close(fd);
+
+    if (!valid) {
+        ALOGW("dropping corrupt entry for %s", key.c_str());
+        removeFile(name);
+        return NULL;
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        ssize_t index = findEntry_l(name);
+        if (index >= 0) {
+            Entry entry = mEntries[index];
+            mEntries.removeAt(index);
+            mEntries.push_back(entry);
+        }
+    }
+    // keeps the order across processes, see loadIndex().
+    utimensat(AT_FDCWD, path.c_str(), NULL, 0);
+
+    ALOGV("hit for %s (%zu bytes)", key.c_str(), data->size());
+    return data;
+}
+
+void DiskCache::insert(
+        const AString &uri, int64_t offset, int64_t length, const sp<ABuffer> &data) {
+    if (mInitCheck != OK || data == NULL || data->size() > maxEntrySize()) {
+        return;
+    }
+
+    AString key = MakeKey(uri, offset, length);
+    AString name = AStringPrintf(
+            "%016llx%s", (unsigned long long)Hash(key.c_str(), key.size()), kSuffix);
+    AString path = AStringPrintf("%s/%s", mDir.c_str(), name.c_str());
+    AString tmpPath = AStringPrintf("%s.%d.tmp", path.c_str(), gettid());
+
+    EntryHeader header;
+    header.mMagic = kMagic;
+    header.mKeySize = key.size();
+    header.mDataSize = data->size();
+    header.mChecksum = Hash(data->data(), data->size(), Hash(key.c_str(), key.size()));
+
+    // written aside and renamed, so that a lookup never sees a partial entry.
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        ALOGW("cannot create %s: %s", tmpPath.c_str(), strerror(errno));
+        return;
+    }
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)
+            && write(fd, key.c_str(), key.size()) == (ssize_t)key.size()
+            && write(fd, data->data(), data->size()) == (ssize_t)data->size();
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("cannot write %s", path.c_str());
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    Vector<AString> paths;
+    {
+        Mutex::Autolock autoLock(mLock);
+        ssize_t index = findEntry_l(name);
+        if (index >= 0) {
+            mTotalBytes -= mEntries[index].mSize;
+            mEntries.removeAt(index);
+        }
+        Entry entry;
+        entry.mName = name;
+        entry.mSize = sizeof(header) + key.size() + data->size();
+        mEntries.push_back(entry);
+        mTotalBytes += entry.mSize;
+        evict_l(&paths);
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+    ALOGV("stored %s (%zu bytes)", key.c_str(), data->size());
+}
+
+}  // namespace android
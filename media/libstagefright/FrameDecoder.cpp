@@ -37,10 +37,20 @@
 #include <private/media/VideoFrame.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace android {
 
 static const int64_t kBufferTimeOutUs = 10000LL; // 10 msec
 static const size_t kRetryCount = 50; // must be >0
+static const size_t kMaxConversionThreads = 4; // for large frames, see ColorConverter
+static const size_t kMaxPendingTiles = 2; // output buffers held for tile conversion
+
+static size_t getConversionThreads() {
+    return std::max(1u, std::min((unsigned)kMaxConversionThreads,
+            std::thread::hardware_concurrency()));
+}
 
 sp<IMemory> allocVideoFrame(const sp<MetaData>& trackMeta,
         int32_t width, int32_t height, int32_t tileWidth, int32_t tileHeight,
@@ -248,6 +258,9 @@ sp<IMemory> FrameDecoder::extractFrame(FrameRect *rect) {
     status_t err = onExtractRect(rect);
     if (err == OK) {
         err = extractInternal();
+    } else if (err == ALREADY_EXISTS) {
+        // the rect was decoded by an earlier extraction
+        err = OK;
     }
     if (err != OK) {
         return NULL;
@@ -280,7 +293,7 @@ status_t FrameDecoder::extractInternal() {
         // Queue as many inputs as we possibly can, then block on dequeuing
         // outputs. After getting each output, come back and queue the inputs
         // again to keep the decoder busy.
-        while (mHaveMoreInputs) {
+        while (mHaveMoreInputs && needsInput()) {
             err = mDecoder->dequeueInputBuffer(&index, 0);
             if (err != OK) {
                 ALOGV("Timed out waiting for input");
@@ -300,6 +313,11 @@ status_t FrameDecoder::extractInternal() {
 
             err = mSource->read(&mediaBuffer, &mReadOptions);
             mReadOptions.clearSeekTo();
+            while (err == OK && onSkipInput(mediaBuffer->meta_data())) {
+                mediaBuffer->release();
+                mediaBuffer = NULL;
+                err = mSource->read(&mediaBuffer, &mReadOptions);
+            }
             if (err != OK) {
                 mHaveMoreInputs = false;
                 if (!mFirstSample && err == ERROR_END_OF_STREAM) {
@@ -368,7 +386,8 @@ status_t FrameDecoder::extractInternal() {
             } else {
                 if (err == -EAGAIN /* INFO_TRY_AGAIN_LATER */ && --retriesLeft > 0) {
                     ALOGV("Timed-out waiting for output.. retries left = %zu", retriesLeft);
-                    err = OK;
+                    // the decoder may be out of output buffers while we still hold some
+                    err = flushOutputs();
                 } else if (err == OK) {
                     // If we're seeking with CLOSEST option and obtained a valid targetTimeUs
                     // from the extractor, decode to the specified frame. Otherwise we're done.
@@ -380,7 +399,18 @@ status_t FrameDecoder::extractInternal() {
                         break;
                     }
                     err = onOutputReceived(videoFrameBuffer, mOutputFormat, ptsUs, &done);
-                    mDecoder->releaseOutputBuffer(index);
+                    if (keepsOutputBuffers()) {
+                        mHeldOutputBuffers.push_back(index);
+                    } else {
+                        mDecoder->releaseOutputBuffer(index);
+                    }
+                    if (err == OK && !done && (flags & MediaCodec::BUFFER_FLAG_EOS)) {
+                        // no more outputs will come
+                        done = onEndOfStream();
+                        if (!done) {
+                            err = ERROR_END_OF_STREAM;
+                        }
+                    }
                 } else {
                     ALOGW("Received error %d (%s) instead of output", err, asString(err));
                     done = true;
@@ -390,6 +420,12 @@ status_t FrameDecoder::extractInternal() {
         }
     } while (err == OK && !done);
 
+    // the frame is complete only once every held tile is converted
+    status_t flushErr = flushOutputs();
+    if (err == OK) {
+        err = flushErr;
+    }
+
     if (err != OK) {
         ALOGE("failed to get video frame (err %d)", err);
     }
@@ -397,6 +433,21 @@ status_t FrameDecoder::extractInternal() {
     return err;
 }
 
+void FrameDecoder::releaseHeldOutputBuffer() {
+    if (!mHeldOutputBuffers.empty()) {
+        mDecoder->releaseOutputBuffer(mHeldOutputBuffers.front());
+        mHeldOutputBuffers.pop_front();
+    }
+}
+
+status_t FrameDecoder::flushOutputs() {
+    status_t err = onFlushOutputs();
+    while (!mHeldOutputBuffers.empty()) {
+        releaseHeldOutputBuffer();
+    }
+    return err;
+}
+
 //////////////////////////////////////////////////////////////////////
 
 VideoFrameDecoder::VideoFrameDecoder(
@@ -408,7 +459,67 @@ VideoFrameDecoder::VideoFrameDecoder(
       mSeekMode(MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC),
       mTargetTimeUs(-1LL),
       mNumFrames(0),
-      mNumFramesDecoded(0) {
+      mNumFramesDecoded(0),
+      mSeeking(false),
+      mSeekIndex(0),
+      mSkipping(false),
+      mLastQueuedTimeUs(-1LL),
+      mMaxQueuedTimeUs(-1LL) {
+}
+
+status_t VideoFrameDecoder::extractFramesAtTimes(
+        const std::vector<int64_t> &timesUs, std::vector<sp<IMemory> > *frames) {
+    if (timesUs.empty() || timesUs.size() != mNumFrames
+            || mSeekMode != MediaSource::ReadOptions::SEEK_CLOSEST
+            || !std::is_sorted(timesUs.begin(), timesUs.end())) {
+        return BAD_VALUE;
+    }
+    mBatchTimesUs = timesUs;
+    return extractFrames(frames);
+}
+
+bool VideoFrameDecoder::onSkipInput(MetaDataBase &sampleMeta) {
+    if (mBatchTimesUs.empty()) {
+        return false;
+    }
+    int64_t timeUs;
+    CHECK(sampleMeta.findInt64(kKeyTime, &timeUs));
+
+    if (mSeeking) {
+        // the first sample after a seek is the sync sample before the time
+        mSeeking = false;
+        int64_t targetTimeUs;
+        if (mSeekIndex == mNumFramesDecoded
+                && sampleMeta.findInt64(kKeyTargetTime, &targetTimeUs)) {
+            mTargetTimeUs = targetTimeUs;
+        }
+        // The time is in the group of pictures being decoded, or in one before it.
+        // Don't decode that again, go on from the last sample queued instead.
+        mSkipping = (timeUs <= mMaxQueuedTimeUs);
+    }
+    if (mSkipping) {
+        if (timeUs <= mMaxQueuedTimeUs) {
+            mSkipping = (timeUs != mLastQueuedTimeUs);
+            return true;
+        }
+        // past every sample queued, in case the last one was not found
+        mSkipping = false;
+    }
+    mLastQueuedTimeUs = timeUs;
+    mMaxQueuedTimeUs = std::max(mMaxQueuedTimeUs, timeUs);
+    return false;
+}
+
+bool VideoFrameDecoder::onEndOfStream() {
+    if (mBatchTimesUs.empty() || mLastFrame == NULL) {
+        return false;
+    }
+    // times past the end of the track get the last frame
+    while (mNumFramesDecoded < mNumFrames) {
+        addFrame(mLastFrame);
+        ++mNumFramesDecoded;
+    }
+    return true;
 }
 
 sp<AMessage> VideoFrameDecoder::onGetFormatAndSeekOptions(
@@ -541,6 +652,7 @@ status_t VideoFrameDecoder::onOutputReceived(
         transfer = 0;
     }
     converter.setSrcColorSpace(standard, range, transfer);
+    converter.setNumThreads(getConversionThreads());
 
     if (converter.isValid()) {
         converter.convert(
@@ -550,6 +662,23 @@ status_t VideoFrameDecoder::onOutputReceived(
                 frame->getFlattenedData(),
                 frame->mWidth, frame->mHeight, frame->mRowBytes,
                 crop_left, crop_top, crop_right, crop_bottom);
+
+        if (!mBatchTimesUs.empty()) {
+            mLastFrame = frameMem;
+            // later times before this frame get it too
+            while (mNumFramesDecoded < mNumFrames
+                    && mBatchTimesUs[mNumFramesDecoded] <= timeUs) {
+                addFrame(frameMem);
+                ++mNumFramesDecoded;
+            }
+            *done = (mNumFramesDecoded >= mNumFrames);
+            if (!*done) {
+                mTargetTimeUs = mBatchTimesUs[mNumFramesDecoded];
+                seekTo(mTargetTimeUs, MediaSource::ReadOptions::SEEK_CLOSEST);
+                mSeeking = true;
+                mSeekIndex = mNumFramesDecoded;
+            }
+        }
         return OK;
     }
 
@@ -572,8 +701,13 @@ ImageDecoder::ImageDecoder(
       mGridCols(1),
       mTileWidth(0),
       mTileHeight(0),
-      mTilesDecoded(0),
-      mTargetTiles(0) {
+      mRegionLeft(0),
+      mRegionTop(0),
+      mRegionRight(1),
+      mRegionBottom(1),
+      mRegionTilesLeft(0),
+      mTilesRead(0),
+      mReadLimit(0) {
 }
 
 sp<AMessage> ImageDecoder::onGetFormatAndSeekOptions(
@@ -630,7 +764,7 @@ sp<AMessage> ImageDecoder::onGetFormatAndSeekOptions(
             overrideMeta = trackMeta();
         }
     }
-    mTargetTiles = mGridCols * mGridRows;
+    mTileDecoded.assign(mGridCols * mGridRows, false);
 
     sp<AMessage> videoFormat;
     if (convertMetaDataToMessage(overrideMeta, &videoFormat) != OK) {
@@ -650,50 +784,92 @@ sp<AMessage> ImageDecoder::onGetFormatAndSeekOptions(
 }
 
 status_t ImageDecoder::onExtractRect(FrameRect *rect) {
-    // TODO:
-    // This callback is for verifying whether we can decode the rect,
-    // and if so, set up the internal variables for decoding.
-    // Currently, rect decoding is restricted to sequentially decoding one
-    // row of tiles at a time. We can't decode arbitrary rects, as the image
-    // track doesn't yet support seeking by tiles. So all we do here is to
-    // verify the rect against what we expect.
-    // When seeking by tile is supported, this code should be updated to
-    // set the seek parameters.
+    // The image track doesn't support seeking by tiles, but tiles are coded
+    // independently, so a rect is decoded by skipping the tiles outside of it.
+    // Tiles that were skipped by an earlier rect can't be decoded anymore.
     if (rect == NULL) {
-        if (mTilesDecoded > 0) {
+        if (mTilesRead > 0) {
             return ERROR_UNSUPPORTED;
         }
-        mTargetTiles = mGridRows * mGridCols;
-        return OK;
+        mRegionLeft = mRegionTop = 0;
+        mRegionRight = mGridCols;
+        mRegionBottom = mGridRows;
+    } else {
+        if (mTileWidth <= 0 || mTileHeight <=0) {
+            return ERROR_UNSUPPORTED;
+        }
+        if (rect->left < 0 || rect->top < 0
+                || rect->right > mWidth || rect->bottom > mHeight
+                || rect->left >= rect->right || rect->top >= rect->bottom) {
+            ALOGE("invalid rect {%d, %d, %d, %d} for %dx%d image",
+                    rect->left, rect->top, rect->right, rect->bottom, mWidth, mHeight);
+            return ERROR_UNSUPPORTED;
+        }
+        mRegionLeft = rect->left / mTileWidth;
+        mRegionTop = rect->top / mTileHeight;
+        mRegionRight = (rect->right + mTileWidth - 1) / mTileWidth;
+        mRegionBottom = (rect->bottom + mTileHeight - 1) / mTileHeight;
+    }
+
+    mRegionTilesLeft = 0;
+    for (int32_t row = mRegionTop; row < mRegionBottom; ++row) {
+        for (int32_t col = mRegionLeft; col < mRegionRight; ++col) {
+            int32_t tile = row * mGridCols + col;
+            if (mTileDecoded[tile]) {
+                continue;
+            }
+            if (tile < mTilesRead && std::find(mQueuedTiles.begin(),
+                    mQueuedTiles.end(), tile) == mQueuedTiles.end()) {
+                ALOGE("tile %d was skipped, can't decode it anymore", tile);
+                return ERROR_UNSUPPORTED;
+            }
+            ++mRegionTilesLeft;
+        }
     }
-
-    if (mTileWidth <= 0 || mTileHeight <=0) {
-        return ERROR_UNSUPPORTED;
+    if (mRegionTilesLeft == 0) {
+        return ALREADY_EXISTS;
     }
 
-    int32_t row = mTilesDecoded / mGridCols;
-    int32_t expectedTop = row * mTileHeight;
-    int32_t expectedBot = (row + 1) * mTileHeight;
-    if (expectedBot > mHeight) {
-        expectedBot = mHeight;
-    }
-    if (rect->left != 0 || rect->top != expectedTop
-            || rect->right != mWidth || rect->bottom != expectedBot) {
-        ALOGE("currently only support sequential decoding of slices");
-        return ERROR_UNSUPPORTED;
+    // Stop reading after the last tile of the rect. For rows of full width, as
+    // decoded slice by slice, read ahead one row to keep the decoder busy.
+    mReadLimit = (mRegionBottom - 1) * mGridCols + mRegionRight;
+    if (mRegionLeft == 0 && mRegionRight == mGridCols) {
+        mReadLimit = std::min(mReadLimit + mGridCols, mGridRows * mGridCols);
     }
-
-    // advance one row
-    mTargetTiles = mTilesDecoded + mGridCols;
     return OK;
 }
 
+bool ImageDecoder::isTileInRegion(int32_t tile) const {
+    int32_t row = tile / mGridCols;
+    int32_t col = tile % mGridCols;
+    return row >= mRegionTop && row < mRegionBottom
+            && col >= mRegionLeft && col < mRegionRight;
+}
+
+bool ImageDecoder::needsInput() const {
+    // past the last tile only the end of stream is left to queue
+    return mTilesRead < mReadLimit || mReadLimit >= mGridRows * mGridCols;
+}
+
+bool ImageDecoder::onSkipInput(MetaDataBase &/*sampleMeta*/) {
+    int32_t tile = mTilesRead++;
+    // everything past the rect is read ahead for the next one
+    if (!isTileInRegion(tile) && tile < (mRegionBottom - 1) * mGridCols + mRegionRight) {
+        ALOGV("skipping tile %d", tile);
+        return true;
+    }
+    mQueuedTiles.push_back(tile);
+    return false;
+}
+
 status_t ImageDecoder::onOutputReceived(
         const sp<MediaCodecBuffer> &videoFrameBuffer,
         const sp<AMessage> &outputFormat, int64_t /*timeUs*/, bool *done) {
-    if (outputFormat == NULL) {
+    if (outputFormat == NULL || mQueuedTiles.empty()) {
         return ERROR_MALFORMED;
     }
+    int32_t tile = mQueuedTiles.front();
+    mQueuedTiles.pop_front();
 
     int32_t width, height, stride;
     CHECK(outputFormat->findInt32("width", &width));
@@ -711,7 +887,8 @@ status_t ImageDecoder::onOutputReceived(
     int32_t srcFormat;
     CHECK(outputFormat->findInt32("color-format", &srcFormat));
 
-    ColorConverter converter((OMX_COLOR_FORMATTYPE)srcFormat, dstFormat());
+    std::shared_ptr<ColorConverter> converter = std::make_shared<ColorConverter>(
+            (OMX_COLOR_FORMATTYPE)srcFormat, dstFormat());
 
     uint32_t standard, range, transfer;
     if (!outputFormat->findInt32("color-standard", (int32_t*)&standard)) {
@@ -723,11 +900,12 @@ status_t ImageDecoder::onOutputReceived(
     if (!outputFormat->findInt32("color-transfer", (int32_t*)&transfer)) {
         transfer = 0;
     }
-    converter.setSrcColorSpace(standard, range, transfer);
+    converter->setSrcColorSpace(standard, range, transfer);
+    converter->setNumThreads(getConversionThreads());
 
     int32_t dstLeft, dstTop, dstRight, dstBottom;
-    dstLeft = mTilesDecoded % mGridCols * width;
-    dstTop = mTilesDecoded / mGridCols * height;
+    dstLeft = tile % mGridCols * width;
+    dstTop = tile / mGridCols * height;
     dstRight = dstLeft + width - 1;
     dstBottom = dstTop + height - 1;
 
@@ -749,10 +927,20 @@ status_t ImageDecoder::onOutputReceived(
         dstBottom = dstTop + crop_bottom;
     }
 
-    *done = (++mTilesDecoded >= mTargetTiles);
+    mTileDecoded[tile] = true;
+    if (isTileInRegion(tile)) {
+        --mRegionTilesLeft;
+    }
+    *done = (mRegionTilesLeft <= 0);
 
-    if (converter.isValid()) {
-        converter.convert(
+    if (!converter->isValid()) {
+        ALOGE("Unable to convert from format 0x%08x to 0x%08x",
+                    srcFormat, dstFormat());
+        return ERROR_UNSUPPORTED;
+    }
+
+    if (!keepsOutputBuffers()) {
+        converter->convert(
                 (const uint8_t *)videoFrameBuffer->data(),
                 width, height, stride,
                 crop_left, crop_top, crop_right, crop_bottom,
@@ -762,9 +950,43 @@ status_t ImageDecoder::onOutputReceived(
         return OK;
     }
 
-    ALOGE("Unable to convert from format 0x%08x to 0x%08x",
-                srcFormat, dstFormat());
-    return ERROR_UNSUPPORTED;
+    // Convert the tile while the decoder works on the next ones. Tiles cover
+    // disjoint parts of the frame, so conversions may also overlap each other.
+    if (mPendingTiles.size() >= kMaxPendingTiles) {
+        status_t err = finishOldestTile();
+        if (err != OK) {
+            return err;
+        }
+    }
+    VideoFrame *frame = mFrame;
+    mPendingTiles.push_back(std::async(std::launch::async, [=] {
+        return converter->convert(
+                (const uint8_t *)videoFrameBuffer->data(),
+                width, height, stride,
+                crop_left, crop_top, crop_right, crop_bottom,
+                frame->getFlattenedData(),
+                frame->mWidth, frame->mHeight, frame->mRowBytes,
+                dstLeft, dstTop, dstRight, dstBottom);
+    }));
+    return OK;
+}
+
+status_t ImageDecoder::finishOldestTile() {
+    status_t err = mPendingTiles.front().get();
+    mPendingTiles.pop_front();
+    releaseHeldOutputBuffer();
+    return err;
+}
+
+status_t ImageDecoder::onFlushOutputs() {
+    status_t err = OK;
+    while (!mPendingTiles.empty()) {
+        status_t tileErr = finishOldestTile();
+        if (err == OK) {
+            err = tileErr;
+        }
+    }
+    return err;
 }
 
 }  // namespace android
@@ -826,7 +826,17 @@ void MPEG2TSWriter::writeAccessUnit(
     // reserved = b1
     // the first fragment of "buffer" follows
 
-    sp<ABuffer> buffer = new ABuffer(188);
+    // All packets of the access unit are built in one buffer and written at once.
+    // The first one has room for 188 - 18 bytes of payload, the others for 184.
+    size_t numPackets = 1;
+    if (accessUnit->size() > 188 - 18) {
+        numPackets += (accessUnit->size() - (188 - 18) + 183) / 184;
+    }
+    if (mPacketBuffer == NULL || mPacketBuffer->capacity() < numPackets * 188) {
+        mPacketBuffer = new ABuffer(numPackets * 188);
+    }
+    mPacketBuffer->setRange(0, numPackets * 188);
+    sp<ABuffer> buffer = mPacketBuffer;
     memset(buffer->data(), 0xff, buffer->size());
 
     const unsigned PID = 0x1e0 + sourceIndex + 1;
@@ -883,7 +893,8 @@ void MPEG2TSWriter::writeAccessUnit(
     *ptr++ = (PTS >> 7) & 0xff;
     *ptr++ = ((PTS & 0x7f) << 1) | 1;
 
-    size_t sizeLeft = buffer->data() + buffer->size() - ptr;
+    uint8_t *packet = buffer->data();
+    size_t sizeLeft = packet + 188 - ptr;
     size_t copy = accessUnit->size();
     if (copy > sizeLeft) {
         copy = sizeLeft;
@@ -891,8 +902,6 @@ void MPEG2TSWriter::writeAccessUnit(
 
     memcpy(ptr, accessUnit->data(), copy);
 
-    CHECK_EQ(internalWrite(buffer->data(), buffer->size()), (ssize_t)buffer->size());
-
     size_t offset = copy;
     while (offset < accessUnit->size()) {
         bool lastAccessUnit = ((accessUnit->size() - offset) < 184);
@@ -907,12 +916,11 @@ void MPEG2TSWriter::writeAccessUnit(
         // continuity_counter = b????
         // the fragment of "buffer" follows.
 
-        memset(buffer->data(), 0xff, buffer->size());
-
         const unsigned continuity_counter =
             mSources.editItemAt(sourceIndex)->incrementContinuityCounter();
 
-        ptr = buffer->data();
+        packet += 188;
+        ptr = packet;
         *ptr++ = 0x47;
         *ptr++ = 0x00 | (PID >> 8);
         *ptr++ = PID & 0xff;
@@ -929,18 +937,19 @@ void MPEG2TSWriter::writeAccessUnit(
             }
         }
 
-        size_t sizeLeft = buffer->data() + buffer->size() - ptr;
+        size_t sizeLeft = packet + 188 - ptr;
         size_t copy = accessUnit->size() - offset;
         if (copy > sizeLeft) {
             copy = sizeLeft;
         }
 
         memcpy(ptr, accessUnit->data() + offset, copy);
-        CHECK_EQ(internalWrite(buffer->data(), buffer->size()),
-                 (ssize_t)buffer->size());
 
         offset += copy;
     }
+    CHECK(packet + 188 == buffer->data() + buffer->size());
+
+    CHECK_EQ(internalWrite(buffer->data(), buffer->size()), (ssize_t)buffer->size());
 }
 
 void MPEG2TSWriter::writeTS() {
@@ -980,6 +989,9 @@ uint32_t MPEG2TSWriter::crc32(const uint8_t *p_start, size_t length) {
 }
 
 ssize_t MPEG2TSWriter::internalWrite(const void *data, size_t size) {
+    // for repeating the PAT and PMT
+    mNumTSPacketsWritten += size / 188;
+
     if (mFile != NULL) {
         return fwrite(data, 1, size, mFile);
     }
@@ -20,12 +20,16 @@
 #include <algorithm>
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <linux/falloc.h>
 #include <pthread.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <utils/Log.h>
@@ -73,6 +77,14 @@ static const int64_t kInitialDelayTimeUs     = 700000LL;
 static const int64_t kMaxMetadataSize = 0x4000000LL;   // 64MB max per-frame metadata size
 static const int64_t kMaxCttsOffsetTimeUs = 30 * 60 * 1000000LL;  // 30 minutes
 static const size_t kESDSScratchBufferSize = 10;  // kMaxAtomSize in Mpeg4Extractor 64MB
+static const size_t kSampleWriteAlignment = 4096;   // sample data is written in blocks
+static const size_t kDefaultWriteQueueBytes = 16 * 1024 * 1024;
+static const int64_t kMinPreallocateBytes = 4 * 1024 * 1024;
+static const int64_t kMaxPreallocateBytes = 256 * 1024 * 1024;
+
+// Kept on the samples of a fragmented file for their trun entry
+static const uint32_t kKeyFragmentDurationTicks = 'fsdt';   // int64_t, track time scale
+static const uint32_t kKeyFragmentCtsOffsetTicks = 'fcto';  // int64_t, may be negative
 
 static const char kMetaKey_Version[]    = "com.android.version";
 static const char kMetaKey_Manufacturer[]      = "com.android.manufacturer";
@@ -119,6 +131,11 @@ public:
     int64_t getEstimatedTrackSizeBytes() const;
     int32_t getMetaSizeIncrease(int32_t angle, int32_t trackCount) const;
     void writeTrackHeader(bool use32BitOffset = true);
+    void writeTrexBox();
+    // Write the traf box of a fragment holding |samples|, whose data starts
+    // |dataOffset| bytes after the moof box.
+    void writeTrafBox(const List<MediaBuffer *> &samples,
+            const std::vector<uint32_t> &sampleSizes, int32_t dataOffset);
     int64_t getMinCttsOffsetTimeUs();
     void bufferChunk(int64_t timestampUs);
     bool isAvc() const { return mIsAvc; }
@@ -147,7 +164,8 @@ private:
             : mElementCapacity(elementCapacity),
             mTotalNumTableEntries(0),
             mNumValuesInCurrEntry(0),
-            mCurrTableEntriesElement(NULL) {
+            mCurrTableEntriesElement(NULL),
+            mKeepValues(true) {
             CHECK_GT(mElementCapacity, 0u);
             // Ensure no integer overflow on allocation in add().
             CHECK_LT(ENTRY_SIZE, UINT32_MAX / mElementCapacity);
@@ -218,9 +236,19 @@ private:
             }
         }
 
+        // Only count the values added from now on, for a table that is not written.
+        void keepCountOnly() { mKeepValues = false; }
+
         // Store a single value.
         // @arg value must be in network byte order.
         void add(const TYPE& value) {
+            if (!mKeepValues) {
+                if ((++mNumValuesInCurrEntry % ENTRY_SIZE) == 0) {
+                    ++mTotalNumTableEntries;
+                    mNumValuesInCurrEntry = 0;
+                }
+                return;
+            }
             CHECK_LT(mNumValuesInCurrEntry, mElementCapacity);
             uint32_t nEntries = mTotalNumTableEntries % mElementCapacity;
             uint32_t nValues  = mNumValuesInCurrEntry % ENTRY_SIZE;
@@ -270,6 +298,7 @@ private:
         uint32_t         mNumValuesInCurrEntry;  // up to ENTRY_SIZE
         TYPE             *mCurrTableEntriesElement;
         mutable List<TYPE *>     mTableEntryList;
+        bool             mKeepValues;
 
         DISALLOW_EVIL_CONSTRUCTORS(ListTableEntries);
     };
@@ -293,6 +322,7 @@ private:
     bool mIsMalformed;
     int32_t mTrackId;
     int64_t mTrackDurationUs;
+    int64_t mFragmentDecodeTicks;     // decoding time of the next fragment
     int64_t mMaxChunkDurationUs;
     int64_t mLastDecodingTimeUs;
 
@@ -497,6 +527,28 @@ void MPEG4Writer::initInternal(int fd, bool isFirstSession) {
     mUse32BitOffset = true;
     mOffset = 0;
     mMdatOffset = 0;
+    mPendingWrite = WriteJob();
+    mFsyncIntervalBytes = 0;
+    mBytesSinceFsync = 0;
+    mPreallocateBytes = 0;
+    mPreallocatedEnd = 0;
+    mOutOfSpace = false;
+    mNumPreallocations = 0;
+    mIOQueuedBytes = 0;
+    mIOBudgetBytes = kDefaultWriteQueueBytes;
+    mIOThreadStarted = false;
+    mIODone = false;
+    mBackpressure = false;
+    mNumSampleWrites = 0;
+    mSampleBytesWritten = 0;
+    mNumFsyncs = 0;
+    std::fill(mWriteLatency, mWriteLatency + kNumWriteLatencyBuckets, 0);
+    mNumBackpressure = 0;
+    mNumWriteQueueFull = 0;
+    mWriteQueueFullUs = 0;
+    mFragmentDurationUs = 0;
+    mFragmentInitWritten = false;
+    mFragmentSequence = 0;
     mInMemoryCache = NULL;
     mInMemoryCacheOffset = 0;
     mInMemoryCacheSize = 0;
@@ -545,6 +597,35 @@ status_t MPEG4Writer::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     mStarted: %s\n", mStarted? "true": "false");
     result.append(buffer);
+    {
+        Mutex::Autolock autoLock(mIOLock);
+        snprintf(buffer, SIZE, "     sample writes: %" PRId64 ", %" PRId64 " bytes per write\n",
+                mNumSampleWrites,
+                mNumSampleWrites > 0 ? mSampleBytesWritten / mNumSampleWrites : 0);
+        result.append(buffer);
+        snprintf(buffer, SIZE, "     write latency (<1/4/16/64/256ms/1/4s/longer):");
+        result.append(buffer);
+        for (size_t i = 0; i < kNumWriteLatencyBuckets; ++i) {
+            snprintf(buffer, SIZE, " %" PRId64, mWriteLatency[i]);
+            result.append(buffer);
+        }
+        result.append("\n");
+        snprintf(buffer, SIZE, "     write queue: %zu of %zu bytes, full %" PRId64 " times"
+                " for %" PRId64 " ms, backpressure %" PRId64 " times\n",
+                mIOQueuedBytes, mIOBudgetBytes, mNumWriteQueueFull, mWriteQueueFullUs / 1000,
+                mNumBackpressure);
+        result.append(buffer);
+        snprintf(buffer, SIZE, "     fsyncs: %" PRId64 "\n", mNumFsyncs);
+        result.append(buffer);
+    }
+    snprintf(buffer, SIZE, "     preallocated: %" PRId64 " bytes in %" PRId64 " steps%s\n",
+            (int64_t)mPreallocatedEnd, mNumPreallocations, mOutOfSpace ? ", out of space" : "");
+    result.append(buffer);
+    if (isFragmented()) {
+        snprintf(buffer, SIZE, "     fragments: %u of %" PRId64 " us\n",
+                mFragmentSequence, mFragmentDurationUs);
+        result.append(buffer);
+    }
     ::write(fd, result.string(), result.size());
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
@@ -803,6 +884,26 @@ status_t MPEG4Writer::start(MetaData *param) {
         mIsFileSizeLimitExplicitlyRequested = true;
     }
 
+    // 0 leaves syncing to the kernel; otherwise data is synced every N MB and at stop.
+    mFsyncIntervalBytes =
+        std::max(0, property_get_int32("media.mp4writer.fsync-interval-mb", 0)) * 1024LL * 1024LL;
+    mBytesSinceFsync = 0;
+    int32_t writeQueueMb = property_get_int32("media.mp4writer.write-queue-mb", 0);
+    mIOBudgetBytes = writeQueueMb > 0 ? writeQueueMb * 1024 * 1024 : kDefaultWriteQueueBytes;
+
+    // Reserving N seconds of data at the expected bit rate keeps long recordings
+    // contiguous, and a full disk shows up as the file size limit before a write fails.
+    int32_t preallocateSec = property_get_int32("media.mp4writer.preallocate-sec", 0);
+    if (preallocateSec > 0) {
+        int32_t totalBitRate = 0;
+        if (param) {
+            param->findInt32(kKeyBitRate, &totalBitRate);
+        }
+        mPreallocateBytes = std::min(kMaxPreallocateBytes, std::max(kMinPreallocateBytes,
+                (int64_t)std::max(totalBitRate, 0) / 8 * preallocateSec));
+    }
+    (void)posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
     int32_t use64BitOffset;
     if (param &&
         param->findInt32(kKey64BitFileOffset, &use64BitOffset) &&
@@ -838,6 +939,22 @@ status_t MPEG4Writer::start(MetaData *param) {
         mIsRealTimeRecording = isRealTimeRecording;
     }
 
+    int64_t fragmentDurationUs;
+    if (!mStarted && param &&
+        param->findInt64(kKeyFragmentDurationUs, &fragmentDurationUs) &&
+        fragmentDurationUs > 0) {
+        if (mHasFileLevelMeta) {
+            ALOGW("Fragmented files cannot hold image items, writing a regular file");
+        } else if (fragmentDurationUs > UINT32_MAX) {
+            ALOGE("Fragment duration %" PRId64 " us is too large", fragmentDurationUs);
+            return BAD_VALUE;
+        } else {
+            // a fragment is written for each chunk
+            mFragmentDurationUs = fragmentDurationUs;
+            mInterleaveDurationUs = fragmentDurationUs;
+        }
+    }
+
     mStartTimestampUs = -1;
 
     if (mStarted) {
@@ -865,6 +982,28 @@ status_t MPEG4Writer::start(MetaData *param) {
         (mMaxFileSizeLimitBytes != 0 &&
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
+    if (isFragmented()) {
+        // The moov box goes before the first fragment, and there is no
+        // mdat box covering all the samples.
+        writeFtypBox(param);
+        mStreamableFile = false;
+        mFreeBoxOffset = mOffset;
+        mMdatOffset = mOffset;
+
+        status_t err = startWriterThread();
+        if (err != OK) {
+            return err;
+        }
+
+        err = startTracks(param);
+        if (err != OK) {
+            return err;
+        }
+
+        mStarted = true;
+        return OK;
+    }
+
     /*
      * mWriteBoxToMemory is true if the amount of data in a file-level meta or
      * moov box is smaller than the reserved free space at the beginning of a
@@ -1037,6 +1176,14 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    stopIOThread();
+    if (mPreallocatedEnd > 0) {
+        // give back the space reserved past the end of the file
+        struct stat st;
+        if (fstat(mFd, &st) == 0 && st.st_size < mPreallocatedEnd) {
+            (void)ftruncate(mFd, st.st_size);
+        }
+    }
     close(mFd);
     mFd = -1;
     if (mNextFd != -1) {
@@ -1116,6 +1263,7 @@ status_t MPEG4Writer::reset(bool stopSource) {
     }
 
     stopWriterThread();
+    flushSampleWrites_l(true /* all */);
 
     // Do not write out movie header on error.
     if (err != OK) {
@@ -1123,6 +1271,23 @@ status_t MPEG4Writer::reset(bool stopSource) {
         return err;
     }
 
+    if (isFragmented()) {
+        // Every fragment is complete already. Only a session without any
+        // sample still lacks the moov box.
+        if (!mFragmentInitWritten) {
+            writeMoovBox(0);
+            mFragmentInitWritten = true;
+        }
+        CHECK(mBoxes.empty());
+        if (mFsyncIntervalBytes > 0) {
+            fsync(mFd);
+            Mutex::Autolock autoLock(mIOLock);
+            ++mNumFsyncs;
+        }
+        release();
+        return err;
+    }
+
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
         lseek64(mFd, mMdatOffset, SEEK_SET);
@@ -1177,6 +1342,12 @@ status_t MPEG4Writer::reset(bool stopSource) {
 
     CHECK(mBoxes.empty());
 
+    if (mFsyncIntervalBytes > 0) {
+        fsync(mFd);
+        Mutex::Autolock autoLock(mIOLock);
+        ++mNumFsyncs;
+    }
+
     release();
     return err;
 }
@@ -1262,6 +1433,16 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
         writeUdtaBox();
     }
     writeMoovLevelMetaBox();
+    if (isFragmented()) {
+        // the samples are described by the fragments
+        for (List<Track *>::iterator it = mTracks.begin();
+            it != mTracks.end(); ++it) {
+            (*it)->writeTrackHeader(mUse32BitOffset);
+        }
+        writeMvexBox();
+        endBox();  // moov
+        return;
+    }
     // Loop through all the tracks to get the global time offset if there is
     // any ctts table appears in a video track.
     int64_t minCttsOffsetTimeUs = kMaxCttsOffsetTimeUs;
@@ -1291,6 +1472,15 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
     endBox();  // moov
 }
 
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        (*it)->writeTrexBox();
+    }
+    endBox();  // mvex
+}
+
 void MPEG4Writer::writeFtypBox(MetaData *param) {
     beginBox("ftyp");
 
@@ -1321,6 +1511,9 @@ void MPEG4Writer::writeFtypBox(MetaData *param) {
             writeFourcc("mp42");
         }
     }
+    if (isFragmented()) {
+        writeFourcc("iso5");
+    }
 
     endBox();
 }
@@ -1375,12 +1568,11 @@ off64_t MPEG4Writer::addSample_l(
         addMultipleLengthPrefixedSamples_l(buffer);
     } else {
         if (tiffHdrOffset > 0) {
-            tiffHdrOffset = htonl(tiffHdrOffset);
-            ::write(mFd, &tiffHdrOffset, 4); // exif_tiff_header_offset field
+            addSamplePrefix_l(tiffHdrOffset, 4); // exif_tiff_header_offset field
             mOffset += 4;
         }
 
-        ::write(mFd,
+        addSampleWrite_l(
               (const uint8_t *)buffer->data() + buffer->range_offset(),
               buffer->range_length());
 
@@ -1433,16 +1625,8 @@ void MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
     size_t length = buffer->range_length();
 
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
+        addSamplePrefix_l(length, 4);
+        addSampleWrite_l(
               (const uint8_t *)buffer->data() + buffer->range_offset(),
               length);
 
@@ -1450,15 +1634,306 @@ void MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
     } else {
         CHECK_LT(length, 65536u);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
+        addSamplePrefix_l(length, 2);
+        addSampleWrite_l((const uint8_t *)buffer->data() + buffer->range_offset(), length);
         mOffset += length + 2;
     }
 }
 
+void MPEG4Writer::addSampleWrite_l(const void *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(data);
+    iov.iov_len = size;
+    mPendingWrite.mIovecs.push_back(iov);
+    mPendingWrite.mBytes += size;
+}
+
+const uint8_t *MPEG4Writer::addSamplePrefix_l(uint32_t value, size_t size) {
+    CHECK_LE(size, 4u);
+    mPendingWrite.mPrefixes.emplace_back();
+    uint8_t *prefix = mPendingWrite.mPrefixes.back().data();
+    for (size_t i = 0; i < size; ++i) {
+        prefix[i] = (value >> (8 * (size - 1 - i))) & 0xff;
+    }
+    addSampleWrite_l(prefix, size);
+    return prefix;
+}
+
+void MPEG4Writer::addSampleBuffer_l(MediaBuffer *buffer) {
+    mPendingWrite.mBuffers.push_back(buffer);
+}
+
+void MPEG4Writer::preallocate_l() {
+    if (mPreallocateBytes == 0 || mOutOfSpace
+            || mOffset + mPreallocateBytes / 2 < mPreallocatedEnd) {
+        return;
+    }
+    off64_t end = mOffset + mPreallocateBytes;
+    if (mMaxFileSizeLimitBytes != 0) {
+        end = std::min(end, (off64_t)mMaxFileSizeLimitBytes);
+    }
+    if (end <= mPreallocatedEnd) {
+        return;
+    }
+
+    // KEEP_SIZE, as the moov box may be written into the reserved free box
+    // after the data, and readers must not see zeros at the end meanwhile.
+    if (fallocate(mFd, FALLOC_FL_KEEP_SIZE, mPreallocatedEnd, end - mPreallocatedEnd) == 0) {
+        mPreallocatedEnd = end;
+        ++mNumPreallocations;
+    } else if (errno == ENOSPC) {
+        ALOGW("out of space at %" PRId64 " bytes, stopping at the file size limit",
+                (int64_t)mOffset);
+        mOutOfSpace = true;
+    } else {
+        ALOGV("no preallocation: %s", strerror(errno));
+        mPreallocateBytes = 0;
+    }
+}
+
+void MPEG4Writer::flushSampleWrites_l(bool all) {
+    preallocate_l();
+    if (mPendingWrite.mBytes > 0) {
+        // Small writes that don't end on a block boundary cost the storage a
+        // read-modify-write, so the unaligned end waits for the next flush.
+        WriteJob job;
+        std::swap(job, mPendingWrite);
+        const off64_t start = mOffset - job.mBytes;
+        size_t headBytes = job.mBytes;
+        if (!all) {
+            off64_t alignedEnd = mOffset & ~(off64_t)(kSampleWriteAlignment - 1);
+            headBytes = alignedEnd > start ? alignedEnd - start : 0;
+        }
+
+        // Keep a copy of the rest, as the sample buffers go with the job.
+        size_t index = 0;
+        size_t bytes = 0;
+        while (index < job.mIovecs.size() && bytes + job.mIovecs[index].iov_len <= headBytes) {
+            bytes += job.mIovecs[index++].iov_len;
+        }
+        if (index < job.mIovecs.size()) {
+            std::vector<uint8_t> tail;
+            tail.reserve(job.mBytes - headBytes);
+            const size_t split = headBytes - bytes;
+            const uint8_t *data = (const uint8_t *)job.mIovecs[index].iov_base;
+            tail.insert(tail.end(), data + split, data + job.mIovecs[index].iov_len);
+            for (size_t i = index + 1; i < job.mIovecs.size(); ++i) {
+                data = (const uint8_t *)job.mIovecs[i].iov_base;
+                tail.insert(tail.end(), data, data + job.mIovecs[i].iov_len);
+            }
+            job.mIovecs[index].iov_len = split;
+            job.mIovecs.resize(split > 0 ? index + 1 : index);
+            job.mBytes = headBytes;
+
+            mPendingWrite.mStorage.push_back(std::move(tail));
+            addSampleWrite_l(mPendingWrite.mStorage.back().data(),
+                    mPendingWrite.mStorage.back().size());
+        }
+
+        Mutex::Autolock autoLock(mIOLock);
+        if (job.mBytes == 0) {
+            for (MediaBuffer *buffer : job.mBuffers) {
+                buffer->release();
+            }
+        } else if (!mIOThreadStarted) {
+            writeJob(&job);
+        } else {
+            // Bounded memory: wait for room, but always take a job into an
+            // empty queue, however large.
+            if (mIOQueuedBytes > 0 && mIOQueuedBytes + job.mBytes > mIOBudgetBytes) {
+                const int64_t startUs = systemTime() / 1000;
+                ++mNumWriteQueueFull;
+                while (mIOQueuedBytes > 0 && mIOQueuedBytes + job.mBytes > mIOBudgetBytes) {
+                    mIOCondition.wait(mIOLock);
+                }
+                mWriteQueueFullUs += systemTime() / 1000 - startUs;
+            }
+            mIOQueuedBytes += job.mBytes;
+            mIOQueue.push_back(std::move(job));
+            updateBackpressure_l();
+            mIOCondition.broadcast();
+        }
+    }
+
+    if (all) {
+        Mutex::Autolock autoLock(mIOLock);
+        while (!mIOQueue.empty()) {
+            mIOCondition.wait(mIOLock);
+        }
+    }
+}
+
+void MPEG4Writer::setBackpressureNotify(const sp<AMessage> &notify) {
+    Mutex::Autolock autoLock(mIOLock);
+    mBackpressureNotify = notify;
+}
+
+void MPEG4Writer::updateBackpressure_l() {
+    // on at three quarters of the budget, off at a quarter
+    bool backpressure = mBackpressure;
+    if (mIOQueuedBytes > mIOBudgetBytes / 4 * 3) {
+        backpressure = true;
+    } else if (mIOQueuedBytes < mIOBudgetBytes / 4) {
+        backpressure = false;
+    }
+    if (backpressure == mBackpressure) {
+        return;
+    }
+    mBackpressure = backpressure;
+    ALOGW_IF(backpressure, "write queue at %zu bytes, storage is falling behind", mIOQueuedBytes);
+    if (backpressure) {
+        ++mNumBackpressure;
+    }
+    if (mBackpressureNotify != NULL) {
+        sp<AMessage> notify = mBackpressureNotify->dup();
+        notify->setInt32("active", backpressure);
+        notify->post();
+    }
+}
+
+void MPEG4Writer::startIOThread() {
+    Mutex::Autolock autoLock(mIOLock);
+    if (mIOThreadStarted) {
+        return;
+    }
+    mIODone = false;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    mIOThreadStarted = pthread_create(&mIOThread, &attr, IOThreadWrapper, this) == 0;
+    pthread_attr_destroy(&attr);
+    ALOGW_IF(!mIOThreadStarted, "no I/O thread, writing on the writer thread");
+}
+
+void MPEG4Writer::stopIOThread() {
+    {
+        Mutex::Autolock autoLock(mIOLock);
+        if (!mIOThreadStarted) {
+            return;
+        }
+        // the queued jobs are written first
+        mIODone = true;
+        mIOCondition.broadcast();
+    }
+
+    void *dummy;
+    pthread_join(mIOThread, &dummy);
+    Mutex::Autolock autoLock(mIOLock);
+    mIOThreadStarted = false;
+    if (mBackpressure) {
+        mBackpressure = false;
+        if (mBackpressureNotify != NULL) {
+            sp<AMessage> notify = mBackpressureNotify->dup();
+            notify->setInt32("active", false);
+            notify->post();
+        }
+    }
+}
+
+void *MPEG4Writer::IOThreadWrapper(void *me) {
+    static_cast<MPEG4Writer *>(me)->ioThreadFunc();
+    return NULL;
+}
+
+void MPEG4Writer::ioThreadFunc() {
+    prctl(PR_SET_NAME, (unsigned long)"MPEG4WriterIO", 0, 0, 0);
+    if (mIsRealTimeRecording) {
+        androidSetThreadPriority(0, ANDROID_PRIORITY_AUDIO);
+    }
+
+    Mutex::Autolock autoLock(mIOLock);
+    while (true) {
+        while (mIOQueue.empty() && !mIODone) {
+            mIOCondition.wait(mIOLock);
+        }
+        if (mIOQueue.empty()) {
+            break;
+        }
+
+        // the job stays queued, and counted, until it is written
+        WriteJob &job = mIOQueue.front();
+        mIOLock.unlock();
+        writeJob(&job);
+        mIOLock.lock();
+
+        mIOQueuedBytes -= job.mBytes;
+        mIOQueue.pop_front();
+        updateBackpressure_l();
+        mIOCondition.broadcast();
+    }
+}
+
+void MPEG4Writer::writeJob(WriteJob *job) {
+    std::vector<struct iovec> &iovecs = job->mIovecs;
+    size_t index = 0;
+    int64_t numWrites = 0;
+    int64_t bytesWritten = 0;
+    int64_t latency[kNumWriteLatencyBuckets] = {};
+    while (index < iovecs.size()) {
+        int count = std::min((size_t)IOV_MAX, iovecs.size() - index);
+        const nsecs_t startNs = systemTime();
+        ssize_t n = ::writev(mFd, &iovecs[index], count);
+        const int64_t latencyMs = (systemTime() - startNs) / 1000000;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("failed to write %zu bytes: %s (%d)",
+                    (size_t)(job->mBytes - bytesWritten), strerror(errno), errno);
+            break;
+        }
+        size_t bucket = 0;
+        for (int64_t limitMs = 1; bucket + 1 < kNumWriteLatencyBuckets && latencyMs >= limitMs;
+                limitMs *= 4) {
+            ++bucket;
+        }
+        ++latency[bucket];
+        ++numWrites;
+        bytesWritten += n;
+        while (n > 0) {
+            struct iovec &iov = iovecs[index];
+            size_t len = std::min((size_t)n, iov.iov_len);
+            iov.iov_base = (uint8_t *)iov.iov_base + len;
+            iov.iov_len -= len;
+            n -= len;
+            if (iov.iov_len == 0) {
+                ++index;
+            }
+        }
+    }
+
+    for (MediaBuffer *buffer : job->mBuffers) {
+        buffer->release();
+    }
+    job->mBuffers.clear();
+
+    bool synced = false;
+    mBytesSinceFsync += bytesWritten;
+    if (mFsyncIntervalBytes > 0 && mBytesSinceFsync >= mFsyncIntervalBytes) {
+        fdatasync(mFd);
+        mBytesSinceFsync = 0;
+        synced = true;
+    }
+
+    // without an I/O thread mIOLock is held already
+    if (mIOThreadStarted) {
+        mIOLock.lock();
+    }
+    mNumSampleWrites += numWrites;
+    mSampleBytesWritten += bytesWritten;
+    mNumFsyncs += synced;
+    for (size_t i = 0; i < kNumWriteLatencyBuckets; ++i) {
+        mWriteLatency[i] += latency[i];
+    }
+    if (mIOThreadStarted) {
+        mIOLock.unlock();
+    }
+}
+
 size_t MPEG4Writer::write(
         const void *ptr, size_t size, size_t nmemb) {
 
@@ -1476,6 +1951,7 @@ size_t MPEG4Writer::write(
                  it != mBoxes.end(); ++it) {
                 (*it) += mOffset;
             }
+            flushSampleWrites_l(true /* all */);
             lseek64(mFd, mOffset, SEEK_SET);
             ::write(mFd, mInMemoryCache, mInMemoryCacheOffset);
             ::write(mFd, ptr, bytes);
@@ -1488,6 +1964,8 @@ size_t MPEG4Writer::write(
             mInMemoryCacheOffset += bytes;
         }
     } else {
+        // boxes go after any sample data not written yet
+        flushSampleWrites_l(true /* all */);
         ::write(mFd, ptr, size * nmemb);
         mOffset += bytes;
     }
@@ -1675,6 +2153,9 @@ bool MPEG4Writer::isFileStreamable() const {
 }
 
 bool MPEG4Writer::exceedsFileSizeLimit() {
+    if (mOutOfSpace) {
+        return true;
+    }
     // No limit
     if (mMaxFileSizeLimitBytes == 0) {
         return false;
@@ -1784,6 +2265,7 @@ MPEG4Writer::Track::Track(
       mIsMalformed(false),
       mTrackId(trackId),
       mTrackDurationUs(0),
+      mFragmentDecodeTicks(0),
       mEstimatedTrackSizeBytes(0),
       mSamplesHaveSameSize(true),
       mStszTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
@@ -1866,6 +2348,7 @@ void MPEG4Writer::Track::resetInternal() {
     mGotStartKeyFrame = false;
     mIsMalformed = false;
     mTrackDurationUs = 0;
+    mFragmentDecodeTicks = 0;
     mEstimatedTrackSizeBytes = 0;
     mSamplesHaveSameSize = 0;
     if (mStszTableEntries != NULL) {
@@ -2297,6 +2780,11 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
     ALOGV("writeChunkToFile: %" PRId64 " from %s track",
         chunk->mTimeStampUs, chunk->mTrack->getTrackType());
 
+    if (isFragmented()) {
+        writeFragment(chunk);
+        return;
+    }
+
     int32_t isFirstSample = true;
     while (!chunk->mSamples.empty()) {
         List<MediaBuffer *>::iterator it = chunk->mSamples.begin();
@@ -2319,11 +2807,84 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
             isFirstSample = false;
         }
 
-        (*it)->release();
-        (*it) = NULL;
+        addSampleBuffer_l(*it);
         chunk->mSamples.erase(it);
     }
     chunk->mSamples.clear();
+
+    flushSampleWrites_l(false /* all */);
+}
+
+bool MPEG4Writer::fragmentInitReady_l() {
+    if (!isFragmented() || mFragmentInitWritten) {
+        return true;
+    }
+    // A track has its codec specific data once it buffered a chunk.
+    for (List<ChunkInfo>::iterator it = mChunkInfos.begin();
+         it != mChunkInfos.end(); ++it) {
+        if (it->mChunks.empty() && !it->mTrack->reachedEOS()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MPEG4Writer::writeFragment(Chunk *chunk) {
+    if (!mFragmentInitWritten) {
+        writeMoovBox(0);
+        mFragmentInitWritten = true;
+    }
+
+    // The moof box and the mdat header go in front of the sample data, but
+    // can only be built once the sample sizes are known. Their size is fixed:
+    // moof 8, mfhd 16, traf 8, tfhd 16, tfdt 20, trun 20 + 16 per sample.
+    Track *track = chunk->mTrack;
+    const size_t moofSize = 88 + 16 * chunk->mSamples.size();
+    mPendingWrite.mStorage.emplace_back(moofSize + 8);
+    std::vector<uint8_t> &header = mPendingWrite.mStorage.back();
+    addSampleWrite_l(header.data(), header.size());
+    mOffset += header.size();
+
+    std::vector<uint32_t> sampleSizes;
+    uint32_t mdatSize = 8;
+    for (MediaBuffer *sample : chunk->mSamples) {
+        size_t bytesWritten;
+        addSample_l(sample, track->usePrefix(), 0 /* tiffHdrOffset */, &bytesWritten);
+        sampleSizes.push_back(bytesWritten);
+        mdatSize += bytesWritten;
+    }
+
+    // Build the header with the in-memory box writing, which write() sizes
+    // with room for a free box.
+    uint8_t *inMemoryCache = mInMemoryCache;
+    off64_t inMemoryCacheOffset = mInMemoryCacheOffset;
+    off64_t inMemoryCacheSize = mInMemoryCacheSize;
+    mInMemoryCache = header.data();
+    mInMemoryCacheOffset = 0;
+    mInMemoryCacheSize = header.size() + 8;
+    mWriteBoxToMemory = true;
+
+    beginBox("moof");
+        beginBox("mfhd");
+        writeInt32(0);                  // version=0, flags=0
+        writeInt32(++mFragmentSequence);
+        endBox();  // mfhd
+        track->writeTrafBox(chunk->mSamples, sampleSizes, header.size());
+    endBox();  // moof
+    writeInt32(mdatSize);
+    write("mdat", 4);
+    CHECK_EQ(mInMemoryCacheOffset, (off64_t)header.size());
+
+    mWriteBoxToMemory = false;
+    mInMemoryCache = inMemoryCache;
+    mInMemoryCacheOffset = inMemoryCacheOffset;
+    mInMemoryCacheSize = inMemoryCacheSize;
+
+    for (MediaBuffer *sample : chunk->mSamples) {
+        addSampleBuffer_l(sample);
+    }
+    chunk->mSamples.clear();
+    flushSampleWrites_l(false /* all */);
 }
 
 void MPEG4Writer::writeAllChunks() {
@@ -2396,7 +2957,8 @@ void MPEG4Writer::threadFunc() {
         Chunk chunk;
         bool chunkFound = false;
 
-        while (!mDone && !(chunkFound = findChunkToWrite(&chunk))) {
+        while (!mDone &&
+                !(chunkFound = fragmentInitReady_l() && findChunkToWrite(&chunk))) {
             mChunkReadyCondition.wait(mLock);
         }
 
@@ -2421,6 +2983,8 @@ void MPEG4Writer::threadFunc() {
 status_t MPEG4Writer::startWriterThread() {
     ALOGV("startWriterThread");
 
+    startIOThread();
+
     mDone = false;
     mIsFirstChunk = true;
     mDriftTimeUs = 0;
@@ -2503,6 +3067,19 @@ status_t MPEG4Writer::Track::start(MetaData *params) {
     mMdatSizeBytes = 0;
     mMaxChunkDurationUs = 0;
     mLastDecodingTimeUs = -1;
+    mFragmentDecodeTicks = 0;
+
+    if (mOwner->isFragmented()) {
+        // The fragments describe the samples, so only the sample counts are
+        // needed, and memory stays bounded however long the recording is.
+        mStszTableEntries->keepCountOnly();
+        mStcoTableEntries->keepCountOnly();
+        mCo64TableEntries->keepCountOnly();
+        mStscTableEntries->keepCountOnly();
+        mStssTableEntries->keepCountOnly();
+        mSttsTableEntries->keepCountOnly();
+        mCttsTableEntries->keepCountOnly();
+    }
 
     pthread_create(&mThread, &attr, ThreadWrapper, this);
     pthread_attr_destroy(&attr);
@@ -2933,6 +3510,8 @@ status_t MPEG4Writer::Track::threadEntry() {
     int32_t count = 0;
     const int64_t interleaveDurationUs = mOwner->interleaveDuration();
     const bool hasMultipleTracks = (mOwner->numTracks() > 1);
+    // fragments are written from chunks, even for a single track
+    const bool bufferChunks = hasMultipleTracks || mOwner->isFragmented();
     int64_t chunkTimestampUs = 0;
     int32_t nChunks = 0;
     int32_t nActualFrames = 0;        // frames containing non-CSD data (non-0 length)
@@ -2949,6 +3528,7 @@ status_t MPEG4Writer::Track::threadEntry() {
     int64_t currCttsOffsetTimeTicks = 0;   // Timescale based ticks
     int64_t lastCttsOffsetTimeTicks = -1;  // Timescale based ticks
     int32_t cttsSampleCount = 0;           // Sample count in the current ctts table entry
+    int64_t ctsOffsetTicks = 0;            // Composition minus decoding time, in ticks
     uint32_t lastSamplesPerChunk = 0;
 
     if (mIsAudio) {
@@ -3055,14 +3635,21 @@ status_t MPEG4Writer::Track::threadEntry() {
 
         ++nActualFrames;
 
-        // Make a deep copy of the MediaBuffer and Metadata and release
-        // the original as soon as we can
-        MediaBuffer *copy = new MediaBuffer(buffer->range_length());
-        memcpy(copy->data(), (uint8_t *)buffer->data() + buffer->range_offset(),
-                buffer->range_length());
-        copy->set_range(0, buffer->range_length());
+        MediaBuffer *copy;
+        int32_t mayHold;
         meta_data = new MetaData(buffer->meta_data());
-        buffer->release();
+        if (buffer->meta_data().findInt32(kKeyMayHoldBuffer, &mayHold) && mayHold) {
+            // The source lends us the buffer until it is written, see MediaMuxer.
+            copy = static_cast<MediaBuffer *>(buffer);
+        } else {
+            // Make a deep copy of the MediaBuffer and Metadata and release
+            // the original as soon as we can
+            copy = new MediaBuffer(buffer->range_length());
+            memcpy(copy->data(), (uint8_t *)buffer->data() + buffer->range_offset(),
+                    buffer->range_length());
+            copy->set_range(0, buffer->range_length());
+            buffer->release();
+        }
         buffer = NULL;
 
         if (isExif) {
@@ -3212,6 +3799,8 @@ status_t MPEG4Writer::Track::threadEntry() {
                 // Update ctts box table if necessary
                 currCttsOffsetTimeTicks =
                         (cttsOffsetTimeUs * mTimeScale + 500000LL) / 1000000LL;
+                ctsOffsetTicks = currCttsOffsetTimeTicks -
+                        (kMaxCttsOffsetTimeUs * mTimeScale + 500000LL) / 1000000LL;
                 if (WARN_UNLESS(currCttsOffsetTimeTicks <= 0x0FFFFFFFFLL, "for %s track", trackName)) {
                     copy->release();
                     mSource->stop();
@@ -3337,7 +3926,7 @@ status_t MPEG4Writer::Track::threadEntry() {
                 trackProgressStatus(timestampUs);
             }
         }
-        if (!hasMultipleTracks) {
+        if (!bufferChunks) {
             size_t bytesWritten;
             off64_t offset = mOwner->addSample_l(
                     copy, usePrefix, tiffHdrOffset, &bytesWritten);
@@ -3353,11 +3942,22 @@ status_t MPEG4Writer::Track::threadEntry() {
                     addChunkOffset(offset);
                 }
             }
-            copy->release();
+            mOwner->addSampleBuffer_l(copy);
+            mOwner->flushSampleWrites_l(false /* all */);
             copy = NULL;
             continue;
         }
 
+        if (mOwner->isFragmented()) {
+            // for the trun box; a sample lasts until the next one
+            copy->meta_data().setInt32(kKeyIsSyncFrame, isSync);
+            copy->meta_data().setInt64(kKeyFragmentCtsOffsetTicks, ctsOffsetTicks);
+            if (!mChunkSamples.empty()) {
+                mChunkSamples.back()->meta_data().setInt64(
+                        kKeyFragmentDurationTicks, currDurationTicks);
+            }
+        }
+
         mChunkSamples.push_back(copy);
         if (mIsHeic) {
             bufferChunk(0 /*timestampUs*/);
@@ -3370,7 +3970,9 @@ status_t MPEG4Writer::Track::threadEntry() {
                 chunkTimestampUs = timestampUs;
             } else {
                 int64_t chunkDurationUs = timestampUs - chunkTimestampUs;
-                if (chunkDurationUs > interleaveDurationUs) {
+                // Video fragments start with a sync sample.
+                if (chunkDurationUs > interleaveDurationUs &&
+                        (!mOwner->isFragmented() || !mIsVideo || isSync)) {
                     if (chunkDurationUs > mMaxChunkDurationUs) {
                         mMaxChunkDurationUs = chunkDurationUs;
                     }
@@ -3380,7 +3982,15 @@ status_t MPEG4Writer::Track::threadEntry() {
                         lastSamplesPerChunk = mChunkSamples.size();
                         addOneStscTableEntry(nChunks, lastSamplesPerChunk);
                     }
-                    bufferChunk(timestampUs);
+                    if (mOwner->isFragmented()) {
+                        // this sample starts the next fragment, as its
+                        // duration is not known yet
+                        mChunkSamples.pop_back();
+                        bufferChunk(chunkTimestampUs);
+                        mChunkSamples.push_back(copy);
+                    } else {
+                        bufferChunk(timestampUs);
+                    }
                     chunkTimestampUs = timestampUs;
                 }
             }
@@ -3402,10 +4012,15 @@ status_t MPEG4Writer::Track::threadEntry() {
         }
     } else {
         // Last chunk
-        if (!hasMultipleTracks) {
+        if (!bufferChunks) {
             addOneStscTableEntry(1, mStszTableEntries->count());
         } else if (!mChunkSamples.empty()) {
             addOneStscTableEntry(++nChunks, mChunkSamples.size());
+            if (mOwner->isFragmented()) {
+                // repeat the previous duration, as for the stts table
+                mChunkSamples.back()->meta_data().setInt64(kKeyFragmentDurationTicks,
+                        mStszTableEntries->count() > 1 ? lastDurationTicks : 0);
+            }
             bufferChunk(timestampUs);
         }
 
@@ -3726,6 +4341,23 @@ void MPEG4Writer::Track::writeStblBox(bool use32BitOffset) {
         writeMetadataFourCCBox();
     }
     mOwner->endBox();  // stsd
+    if (mOwner->isFragmented()) {
+        // no samples outside of the fragments
+        static const char *kEmptyTables[] = { "stts", "stsc", "stco" };
+        for (const char *table : kEmptyTables) {
+            mOwner->beginBox(table);
+            mOwner->writeInt32(0);  // version=0, flags=0
+            mOwner->writeInt32(0);  // entry count
+            mOwner->endBox();
+        }
+        mOwner->beginBox("stsz");
+        mOwner->writeInt32(0);  // version=0, flags=0
+        mOwner->writeInt32(0);  // sample size
+        mOwner->writeInt32(0);  // sample count
+        mOwner->endBox();  // stsz
+        mOwner->endBox();  // stbl
+        return;
+    }
     writeSttsBox();
     if (mIsVideo) {
         writeCttsBox();
@@ -4020,7 +4652,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId);      // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // the moov box of a fragmented file is written before the samples
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -4055,6 +4688,55 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->endBox();  // tkhd
 }
 
+void MPEG4Writer::Track::writeTrexBox() {
+    mOwner->beginBox("trex");
+    mOwner->writeInt32(0);             // version=0, flags=0
+    mOwner->writeInt32(mTrackId);
+    mOwner->writeInt32(1);             // default sample description index
+    mOwner->writeInt32(0);             // default sample duration
+    mOwner->writeInt32(0);             // default sample size
+    mOwner->writeInt32(0);             // default sample flags
+    mOwner->endBox();  // trex
+}
+
+void MPEG4Writer::Track::writeTrafBox(const List<MediaBuffer *> &samples,
+        const std::vector<uint32_t> &sampleSizes, int32_t dataOffset) {
+    mOwner->beginBox("traf");
+        mOwner->beginBox("tfhd");
+        mOwner->writeInt32(0x020000);      // version=0, flags=default-base-is-moof
+        mOwner->writeInt32(mTrackId);
+        mOwner->endBox();  // tfhd
+
+        mOwner->beginBox("tfdt");
+        mOwner->writeInt32(1 << 24);       // version=1, flags=0
+        mOwner->writeInt64(mFragmentDecodeTicks);
+        mOwner->endBox();  // tfdt
+
+        mOwner->beginBox("trun");
+        // version=1 for signed composition offsets, flags=data offset, sample
+        // duration, size, flags and composition offset present
+        mOwner->writeInt32((1 << 24) | 0xf01);
+        mOwner->writeInt32(samples.size());
+        mOwner->writeInt32(dataOffset);
+        size_t i = 0;
+        for (MediaBuffer *sample : samples) {
+            int64_t durationTicks = 0;
+            int64_t ctsOffsetTicks = 0;
+            int32_t isSync = 0;
+            sample->meta_data().findInt64(kKeyFragmentDurationTicks, &durationTicks);
+            sample->meta_data().findInt64(kKeyFragmentCtsOffsetTicks, &ctsOffsetTicks);
+            sample->meta_data().findInt32(kKeyIsSyncFrame, &isSync);
+            mOwner->writeInt32(durationTicks);
+            mOwner->writeInt32(sampleSizes[i++]);
+            // a sync sample does not depend on others; others do and are not sync
+            mOwner->writeInt32(!mIsVideo || isSync ? 0x02000000 : 0x01010000);
+            mOwner->writeInt32(ctsOffsetTicks);
+            mFragmentDecodeTicks += durationTicks;
+        }
+        mOwner->endBox();  // trun
+    mOwner->endBox();  // traf
+}
+
 void MPEG4Writer::Track::writeVmhdBox() {
     mOwner->beginBox("vmhd");
     mOwner->writeInt32(0x01);        // version=0, flags=1
@@ -4096,6 +4778,11 @@ void MPEG4Writer::Track::writeEdtsBox(){
     ALOGV("%s : getStartTimeOffsetTimeUs of track:%" PRId64 " us", getTrackType(),
         getStartTimeOffsetTimeUs());
 
+    // Fragments carry signed composition offsets instead.
+    if (mOwner->isFragmented()) {
+        return;
+    }
+
     // Prepone video playback.
     if (mMinCttsOffsetTicks != mMaxCttsOffsetTicks) {
         int32_t mvhdTimeScale = mOwner->getTimeScale();
@@ -4120,7 +4807,7 @@ void MPEG4Writer::Track::writeEdtsBox(){
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int64_t mdhdDuration = (trakDurationUs * mTimeScale + 5E5) / 1E6;
     mOwner->beginBox("mdhd");
 
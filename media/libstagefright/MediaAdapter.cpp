@@ -26,6 +26,7 @@ namespace android {
 
 MediaAdapter::MediaAdapter(const sp<MetaData> &meta)
     : mCurrentMediaBuffer(NULL),
+      mCurrentBufferHeld(false),
       mStarted(false),
       mOutputFormat(meta) {
 }
@@ -58,6 +59,8 @@ status_t MediaAdapter::stop() {
 
             // While read() is still waiting, we should signal it to finish.
             mBufferReadCond.signal();
+            // A buffer the reader may hold is not returned to us.
+            mBufferReturnedCond.signal();
         }
     }
     if (currentBuffer != NULL) {
@@ -104,6 +107,10 @@ status_t MediaAdapter::read(
 
     *buffer = mCurrentMediaBuffer;
     mCurrentMediaBuffer = NULL;
+    if (mCurrentBufferHeld) {
+        // the reader owns it now, pushBuffer() need not wait for its release
+        mBufferReturnedCond.signal();
+    }
 
     return OK;
 }
@@ -119,10 +126,23 @@ status_t MediaAdapter::pushBuffer(MediaBuffer *buffer) {
         ALOGE("pushBuffer called before start");
         return INVALID_OPERATION;
     }
+    int32_t mayHold = 0;
+    (void)buffer->meta_data().findInt32(kKeyMayHoldBuffer, &mayHold);
     mCurrentMediaBuffer = buffer;
-    mCurrentMediaBuffer->setObserver(this);
+    mCurrentBufferHeld = mayHold != 0;
+    if (!mCurrentBufferHeld) {
+        mCurrentMediaBuffer->setObserver(this);
+    }
     mBufferReadCond.signal();
 
+    if (mCurrentBufferHeld) {
+        ALOGV("wait for the buffer read @ pushBuffer! %p", buffer);
+        while (mCurrentMediaBuffer == buffer && mStarted) {
+            mBufferReturnedCond.wait(mAdapterLock);
+        }
+        return OK;
+    }
+
     ALOGV("wait for the buffer returned @ pushBuffer! %p", buffer);
     mBufferReturnedCond.wait(mAdapterLock);
 
@@ -30,10 +30,12 @@ namespace android {
 // If larger than this threshold, it's treated as discontinuity.
 static const int64_t kAnchorFluctuationAllowedUs = 10000LL;
 
-MediaClock::Timer::Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs)
+MediaClock::Timer::Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs,
+        int32_t id)
     : mNotify(notify),
       mMediaTimeUs(mediaTimeUs),
-      mAdjustRealUs(adjustRealUs) {
+      mAdjustRealUs(adjustRealUs),
+      mId(id) {
 }
 
 MediaClock::MediaClock()
@@ -42,7 +44,14 @@ MediaClock::MediaClock()
       mMaxTimeMediaUs(INT64_MAX),
       mStartingTimeMediaUs(-1),
       mPlaybackRate(1.0),
-      mGeneration(0) {
+      mAnchorSeq(0),
+      mPublishedAnchorTimeMediaUs(-1),
+      mPublishedAnchorTimeRealUs(-1),
+      mPublishedMaxTimeMediaUs(INT64_MAX),
+      mPublishedStartingTimeMediaUs(-1),
+      mPublishedPlaybackRate(1.0),
+      mGeneration(0),
+      mNextTimerId(1) {
     mLooper = new ALooper;
     mLooper->setName("MediaClock");
     mLooper->start(false /* runOnCallingThread */,
@@ -73,12 +82,14 @@ void MediaClock::reset() {
     mMaxTimeMediaUs = INT64_MAX;
     mStartingTimeMediaUs = -1;
     updateAnchorTimesAndPlaybackRate_l(-1, -1, 1.0);
+    publishAnchor_l();
     ++mGeneration;
 }
 
 void MediaClock::setStartingTimeMedia(int64_t startingTimeMediaUs) {
     Mutex::Autolock autoLock(mLock);
     mStartingTimeMediaUs = startingTimeMediaUs;
+    publishAnchor_l();
 }
 
 void MediaClock::clearAnchor() {
@@ -104,8 +115,9 @@ void MediaClock::updateAnchor(
         return;
     }
 
-    if (maxTimeMediaUs != -1) {
+    if (maxTimeMediaUs != -1 && maxTimeMediaUs != mMaxTimeMediaUs) {
         mMaxTimeMediaUs = maxTimeMediaUs;
+        publishAnchor_l();
     }
     if (mAnchorTimeRealUs != -1) {
         int64_t oldNowMediaUs =
@@ -124,6 +136,7 @@ void MediaClock::updateAnchor(
 void MediaClock::updateMaxTimeMedia(int64_t maxTimeMediaUs) {
     Mutex::Autolock autoLock(mLock);
     mMaxTimeMediaUs = maxTimeMediaUs;
+    publishAnchor_l();
 }
 
 void MediaClock::setPlaybackRate(float rate) {
@@ -131,6 +144,7 @@ void MediaClock::setPlaybackRate(float rate) {
     Mutex::Autolock autoLock(mLock);
     if (mAnchorTimeRealUs == -1) {
         mPlaybackRate = rate;
+        publishAnchor_l();
         return;
     }
 
@@ -149,8 +163,7 @@ void MediaClock::setPlaybackRate(float rate) {
 }
 
 float MediaClock::getPlaybackRate() const {
-    Mutex::Autolock autoLock(mLock);
-    return mPlaybackRate;
+    return mPublishedPlaybackRate.load(std::memory_order_acquire);
 }
 
 status_t MediaClock::getMediaTime(
@@ -159,23 +172,33 @@ status_t MediaClock::getMediaTime(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock autoLock(mLock);
-    return getMediaTime_l(realUs, outMediaUs, allowPastMaxTime);
+    Anchor anchor;
+    readAnchor(&anchor);
+    return getMediaTimeFor(anchor, realUs, outMediaUs, allowPastMaxTime);
 }
 
 status_t MediaClock::getMediaTime_l(
         int64_t realUs, int64_t *outMediaUs, bool allowPastMaxTime) const {
-    if (mAnchorTimeRealUs == -1) {
+    const Anchor anchor = {
+        mAnchorTimeMediaUs, mAnchorTimeRealUs, mMaxTimeMediaUs, mStartingTimeMediaUs,
+        mPlaybackRate };
+    return getMediaTimeFor(anchor, realUs, outMediaUs, allowPastMaxTime);
+}
+
+// static
+status_t MediaClock::getMediaTimeFor(
+        const Anchor &anchor, int64_t realUs, int64_t *outMediaUs, bool allowPastMaxTime) {
+    if (anchor.mAnchorTimeRealUs == -1) {
         return NO_INIT;
     }
 
-    int64_t mediaUs = mAnchorTimeMediaUs
-            + (realUs - mAnchorTimeRealUs) * (double)mPlaybackRate;
-    if (mediaUs > mMaxTimeMediaUs && !allowPastMaxTime) {
-        mediaUs = mMaxTimeMediaUs;
+    int64_t mediaUs = anchor.mAnchorTimeMediaUs
+            + (realUs - anchor.mAnchorTimeRealUs) * (double)anchor.mPlaybackRate;
+    if (mediaUs > anchor.mMaxTimeMediaUs && !allowPastMaxTime) {
+        mediaUs = anchor.mMaxTimeMediaUs;
     }
-    if (mediaUs < mStartingTimeMediaUs) {
-        mediaUs = mStartingTimeMediaUs;
+    if (mediaUs < anchor.mStartingTimeMediaUs) {
+        mediaUs = anchor.mStartingTimeMediaUs;
     }
     if (mediaUs < 0) {
         mediaUs = 0;
@@ -190,24 +213,64 @@ status_t MediaClock::getRealTimeFor(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock autoLock(mLock);
-    if (mPlaybackRate == 0.0) {
+    Anchor anchor;
+    readAnchor(&anchor);
+    if (anchor.mPlaybackRate == 0.0) {
         return NO_INIT;
     }
 
     int64_t nowUs = ALooper::GetNowUs();
     int64_t nowMediaUs;
     status_t status =
-            getMediaTime_l(nowUs, &nowMediaUs, true /* allowPastMaxTime */);
+            getMediaTimeFor(anchor, nowUs, &nowMediaUs, true /* allowPastMaxTime */);
     if (status != OK) {
         return status;
     }
-    *outRealUs = (targetMediaUs - nowMediaUs) / (double)mPlaybackRate + nowUs;
+    *outRealUs = (targetMediaUs - nowMediaUs) / (double)anchor.mPlaybackRate + nowUs;
     return OK;
 }
 
-void MediaClock::addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs,
-                          int64_t adjustRealUs) {
+void MediaClock::publishAnchor_l() {
+    const uint32_t seq = mAnchorSeq.load(std::memory_order_relaxed);
+    mAnchorSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mPublishedAnchorTimeMediaUs.store(mAnchorTimeMediaUs, std::memory_order_relaxed);
+    mPublishedAnchorTimeRealUs.store(mAnchorTimeRealUs, std::memory_order_relaxed);
+    mPublishedMaxTimeMediaUs.store(mMaxTimeMediaUs, std::memory_order_relaxed);
+    mPublishedStartingTimeMediaUs.store(mStartingTimeMediaUs, std::memory_order_relaxed);
+    mPublishedPlaybackRate.store(mPlaybackRate, std::memory_order_relaxed);
+    mAnchorSeq.store(seq + 2, std::memory_order_release);
+}
+
+void MediaClock::readAnchor(Anchor *anchor) const {
+    for (;;) {
+        const uint32_t seq = mAnchorSeq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            // a writer is in the middle of an update and holds the lock.
+            Mutex::Autolock autoLock(mLock);
+            anchor->mAnchorTimeMediaUs = mAnchorTimeMediaUs;
+            anchor->mAnchorTimeRealUs = mAnchorTimeRealUs;
+            anchor->mMaxTimeMediaUs = mMaxTimeMediaUs;
+            anchor->mStartingTimeMediaUs = mStartingTimeMediaUs;
+            anchor->mPlaybackRate = mPlaybackRate;
+            return;
+        }
+        anchor->mAnchorTimeMediaUs =
+                mPublishedAnchorTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mAnchorTimeRealUs = mPublishedAnchorTimeRealUs.load(std::memory_order_relaxed);
+        anchor->mMaxTimeMediaUs = mPublishedMaxTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mStartingTimeMediaUs =
+                mPublishedStartingTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mPlaybackRate = mPublishedPlaybackRate.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mAnchorSeq.load(std::memory_order_relaxed) == seq) {
+            return;
+        }
+    }
+}
+
+int32_t MediaClock::addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs,
+                             int64_t adjustRealUs) {
     Mutex::Autolock autoLock(mLock);
 
     bool updateTimer = (mPlaybackRate != 0.0);
@@ -223,12 +286,29 @@ void MediaClock::addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs,
         }
     }
 
-    mTimers.emplace_back(notify, mediaTimeUs, adjustRealUs);
+    const int32_t timerId = mNextTimerId++;
+    if (mNextTimerId <= 0) {
+        mNextTimerId = 1;
+    }
+    mTimers.emplace_back(notify, mediaTimeUs, adjustRealUs, timerId);
 
     if (updateTimer) {
         ++mGeneration;
         processTimers_l();
     }
+    return timerId;
+}
+
+status_t MediaClock::cancelTimer(int32_t timerId) {
+    Mutex::Autolock autoLock(mLock);
+    for (auto it = mTimers.begin(); it != mTimers.end(); ++it) {
+        if (it->mId == timerId) {
+            // a pending wake up finds nothing to do for this timer.
+            mTimers.erase(it);
+            return OK;
+        }
+    }
+    return NAME_NOT_FOUND;
 }
 
 void MediaClock::onMessageReceived(const sp<AMessage> &msg) {
@@ -316,6 +396,7 @@ void MediaClock::updateAnchorTimesAndPlaybackRate_l(int64_t anchorTimeMediaUs,
         mAnchorTimeMediaUs = anchorTimeMediaUs;
         mAnchorTimeRealUs = anchorTimeRealUs;
         mPlaybackRate = playbackRate;
+        publishAnchor_l();
         notifyDiscontinuity_l();
     }
 }
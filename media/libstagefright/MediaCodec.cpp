@@ -21,6 +21,9 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "include/SecureBuffer.h"
 #include "include/SharedMemoryBuffer.h"
 #include "include/SoftwareRenderer.h"
@@ -94,6 +97,9 @@ static const char *kCodecLatencyAvg = "android.media.mediacodec.latency.avg";
 static const char *kCodecLatencyCount = "android.media.mediacodec.latency.n";
 static const char *kCodecLatencyHist = "android.media.mediacodec.latency.hist"; /* in us */
 static const char *kCodecLatencyUnknown = "android.media.mediacodec.latency.unknown";
+static const char *kCodecLatencyP50 = "android.media.mediacodec.latency.p50";   /* in us */
+static const char *kCodecLatencyP90 = "android.media.mediacodec.latency.p90";   /* in us */
+static const char *kCodecLatencyP99 = "android.media.mediacodec.latency.p99";   /* in us */
 
 // the kCodecRecent* fields appear only in getMetrics() results
 static const char *kCodecRecentLatencyMax = "android.media.mediacodec.recent.max";      /* in us */
@@ -101,6 +107,9 @@ static const char *kCodecRecentLatencyMin = "android.media.mediacodec.recent.min
 static const char *kCodecRecentLatencyAvg = "android.media.mediacodec.recent.avg";      /* in us */
 static const char *kCodecRecentLatencyCount = "android.media.mediacodec.recent.n";
 static const char *kCodecRecentLatencyHist = "android.media.mediacodec.recent.hist";    /* in us */
+static const char *kCodecRecentLatencyP50 = "android.media.mediacodec.recent.p50";      /* in us */
+static const char *kCodecRecentLatencyP90 = "android.media.mediacodec.recent.p90";      /* in us */
+static const char *kCodecRecentLatencyP99 = "android.media.mediacodec.recent.p99";      /* in us */
 
 // XXX suppress until we get our representation right
 static bool kEmitHistogram = false;
@@ -575,6 +584,9 @@ void MediaCodec::updateAnalyticsItem() {
         mAnalyticsItem->setInt64(kCodecLatencyMin, mLatencyHist.getMin());
         mAnalyticsItem->setInt64(kCodecLatencyAvg, mLatencyHist.getAvg());
         mAnalyticsItem->setInt64(kCodecLatencyCount, mLatencyHist.getCount());
+        mAnalyticsItem->setInt64(kCodecLatencyP50, mLatencyHist.getPercentile(50));
+        mAnalyticsItem->setInt64(kCodecLatencyP90, mLatencyHist.getPercentile(90));
+        mAnalyticsItem->setInt64(kCodecLatencyP99, mLatencyHist.getPercentile(99));
 
         if (kEmitHistogram) {
             // and the histogram itself
@@ -605,12 +617,14 @@ void MediaCodec::updateEphemeralAnalytics(MediaAnalyticsItem *item) {
     recentHist.setup(kLatencyHistBuckets, kLatencyHistWidth, kLatencyHistFloor);
 
     // stuff it with the samples in the ring buffer
+    std::vector<int64_t> samples;
     {
         Mutex::Autolock al(mRecentLock);
 
         for (int i=0; i<kRecentLatencyFrames; i++) {
             if (mRecentSamples[i] != kRecentSampleInvalid) {
                 recentHist.insert(mRecentSamples[i]);
+                samples.push_back(mRecentSamples[i]);
             }
         }
     }
@@ -623,6 +637,13 @@ void MediaCodec::updateEphemeralAnalytics(MediaAnalyticsItem *item) {
         item->setInt64(kCodecRecentLatencyAvg, recentHist.getAvg());
         item->setInt64(kCodecRecentLatencyCount, recentHist.getCount());
 
+        // few enough samples to get the exact percentiles
+        std::sort(samples.begin(), samples.end());
+        const size_t n = samples.size();
+        item->setInt64(kCodecRecentLatencyP50, samples[(n - 1) * 50 / 100]);
+        item->setInt64(kCodecRecentLatencyP90, samples[(n - 1) * 90 / 100]);
+        item->setInt64(kCodecRecentLatencyP99, samples[(n - 1) * 99 / 100]);
+
         if (kEmitHistogram) {
             // and the histogram itself
             std::string hist = recentHist.emit();
@@ -710,6 +731,33 @@ void MediaCodec::Histogram::insert(int64_t sample)
     return;
 }
 
+int64_t MediaCodec::Histogram::getPercentile(int percentile) const
+{
+    if (mBuckets == NULL || mCount == 0) {
+        return 0;
+    }
+
+    // the rank of the sample we are after, 1-based
+    int64_t rank = (mCount * percentile + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    if (rank <= mBelow) {
+        return mMin;
+    }
+    int64_t seen = mBelow;
+    for (int i = 0; i < mBucketCount; i++) {
+        if (rank <= seen + mBuckets[i]) {
+            int64_t value = mFloor + i * mWidth + mWidth * (rank - seen) / mBuckets[i];
+            return std::max(mMin, std::min(mMax, value));
+        }
+        seen += mBuckets[i];
+    }
+    // in the overflow bucket; the most we know is the maximum
+    return mMax;
+}
+
 std::string MediaCodec::Histogram::emit()
 {
     std::string value;
@@ -989,8 +1037,14 @@ status_t MediaCodec::init(const AString &name) {
 }
 
 status_t MediaCodec::setCallback(const sp<AMessage> &callback) {
+    return setCallback(callback, NULL);
+}
+
+status_t MediaCodec::setCallback(
+        const sp<AMessage> &callback, const sp<BufferListener> &listener) {
     sp<AMessage> msg = new AMessage(kWhatSetCallback, this);
     msg->setMessage("callback", callback);
+    msg->setObject("listener", listener);
 
     sp<AMessage> response;
     return PostAndAwaitResponse(msg, &response);
@@ -1360,6 +1414,29 @@ status_t MediaCodec::queueInputBuffer(
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::queueInputBuffers(
+        const QueueInputInfo *infos,
+        size_t count,
+        size_t *numQueued,
+        AString *errorDetailMsg) {
+    *numQueued = 0;
+    if (errorDetailMsg != NULL) {
+        errorDetailMsg->clear();
+    }
+    if (count == 0) {
+        return OK;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatQueueInputBuffers, this);
+    msg->setPointer("infos", (void *)infos);
+    msg->setSize("count", count);
+    msg->setPointer("numQueued", numQueued);
+    msg->setPointer("errorDetailMsg", errorDetailMsg);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
 status_t MediaCodec::queueSecureInputBuffer(
         size_t index,
         size_t offset,
@@ -1463,6 +1540,34 @@ status_t MediaCodec::releaseOutputBuffer(size_t index) {
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::releaseOutputBuffers(
+        const ReleaseOutputInfo *infos, size_t count, size_t *numReleased) {
+    *numReleased = 0;
+    if (count == 0) {
+        return OK;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffers, this);
+    msg->setPointer("infos", (void *)infos);
+    msg->setSize("count", count);
+    msg->setPointer("numReleased", numReleased);
+
+    sp<AMessage> response;
+    return PostAndAwaitResponse(msg, &response);
+}
+
+status_t MediaCodec::releaseOutputBufferAsync(size_t index, bool render, int64_t timestampNs) {
+    sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, this);
+    msg->setSize("index", index);
+    if (render) {
+        msg->setInt32("render", true);
+        if (timestampNs >= 0) {
+            msg->setInt64("timestampNs", timestampNs);
+        }
+    }
+    return msg->post();
+}
+
 status_t MediaCodec::signalEndOfInputStream() {
     sp<AMessage> msg = new AMessage(kWhatSignalEndOfInputStream, this);
 
@@ -2402,7 +2507,11 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             sp<AMessage> callback;
             CHECK(msg->findMessage("callback", &callback));
 
+            sp<RefBase> obj;
+            CHECK(msg->findObject("listener", &obj));
+
             mCallback = callback;
+            mBufferListener = callback != NULL ? static_cast<BufferListener *>(obj.get()) : NULL;
 
             if (mCallback != NULL) {
                 ALOGI("MediaCodec will operate in async mode");
@@ -2793,6 +2902,88 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatQueueInputBuffers:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (!isExecuting()) {
+                PostReplyWithError(replyID, INVALID_OPERATION);
+                break;
+            } else if (mFlags & kFlagStickyError) {
+                PostReplyWithError(replyID, getStickyError());
+                break;
+            }
+
+            const QueueInputInfo *infos;
+            size_t count;
+            size_t *numQueued;
+            AString *errorDetailMsg;
+            CHECK(msg->findPointer("infos", (void **)&infos));
+            CHECK(msg->findSize("count", &count));
+            CHECK(msg->findPointer("numQueued", (void **)&numQueued));
+            CHECK(msg->findPointer("errorDetailMsg", (void **)&errorDetailMsg));
+
+            // the same message as queueInputBuffer() sends, once per buffer
+            status_t err = OK;
+            for (size_t i = 0; i < count && err == OK; ++i) {
+                sp<AMessage> item = new AMessage;
+                item->setSize("index", infos[i].index);
+                item->setSize("offset", infos[i].offset);
+                item->setSize("size", infos[i].size);
+                item->setInt64("timeUs", infos[i].presentationTimeUs);
+                item->setInt32("flags", infos[i].flags);
+                item->setPointer("errorDetailMsg", errorDetailMsg);
+                err = onQueueInputBuffer(item);
+                if (err == OK) {
+                    ++*numQueued;
+                }
+            }
+
+            PostReplyWithError(replyID, err);
+            break;
+        }
+
+        case kWhatReleaseOutputBuffers:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (!isExecuting()) {
+                PostReplyWithError(replyID, INVALID_OPERATION);
+                break;
+            } else if (mFlags & kFlagStickyError) {
+                PostReplyWithError(replyID, getStickyError());
+                break;
+            }
+
+            const ReleaseOutputInfo *infos;
+            size_t count;
+            size_t *numReleased;
+            CHECK(msg->findPointer("infos", (void **)&infos));
+            CHECK(msg->findSize("count", &count));
+            CHECK(msg->findPointer("numReleased", (void **)&numReleased));
+
+            status_t err = OK;
+            for (size_t i = 0; i < count && err == OK; ++i) {
+                sp<AMessage> item = new AMessage;
+                item->setSize("index", infos[i].index);
+                if (infos[i].render) {
+                    item->setInt32("render", true);
+                    if (infos[i].timestampNs >= 0) {
+                        item->setInt64("timestampNs", infos[i].timestampNs);
+                    }
+                }
+                err = onReleaseOutputBuffer(item);
+                if (err == OK) {
+                    ++*numReleased;
+                }
+            }
+
+            PostReplyWithError(replyID, err);
+            break;
+        }
+
         case kWhatDequeueOutputBuffer:
         {
             sp<AReplyToken> replyID;
@@ -2850,20 +3041,24 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
 
         case kWhatReleaseOutputBuffer:
         {
+            // no reply is expected from releaseOutputBufferAsync()
             sp<AReplyToken> replyID;
-            CHECK(msg->senderAwaitsResponse(&replyID));
+            const bool awaitsResponse = msg->senderAwaitsResponse(&replyID);
 
+            status_t err;
             if (!isExecuting()) {
-                PostReplyWithError(replyID, INVALID_OPERATION);
-                break;
+                err = INVALID_OPERATION;
             } else if (mFlags & kFlagStickyError) {
-                PostReplyWithError(replyID, getStickyError());
-                break;
+                err = getStickyError();
+            } else {
+                err = onReleaseOutputBuffer(msg);
             }
 
-            status_t err = onReleaseOutputBuffer(msg);
-
-            PostReplyWithError(replyID, err);
+            if (awaitsResponse) {
+                PostReplyWithError(replyID, err);
+            } else if (err != OK) {
+                ALOGW("[%s] could not release output buffer: %d", mComponentName.c_str(), err);
+            }
             break;
         }
 
@@ -3111,6 +3306,7 @@ void MediaCodec::setState(State newState) {
 
         mActivityNotify.clear();
         mCallback.clear();
+        mBufferListener.clear();
     }
 
     if (newState == UNINITIALIZED) {
@@ -3487,6 +3683,10 @@ status_t MediaCodec::handleSetSurface(const sp<Surface> &surface) {
 void MediaCodec::onInputBufferAvailable() {
     int32_t index;
     while ((index = dequeuePortBuffer(kPortIndexInput)) >= 0) {
+        if (mBufferListener != NULL) {
+            mBufferListener->onInputBufferAvailable(index);
+            continue;
+        }
         sp<AMessage> msg = mCallback->dup();
         msg->setInt32("callbackID", CB_INPUT_AVAILABLE);
         msg->setInt32("index", index);
@@ -3499,22 +3699,27 @@ void MediaCodec::onOutputBufferAvailable() {
     while ((index = dequeuePortBuffer(kPortIndexOutput)) >= 0) {
         const sp<MediaCodecBuffer> &buffer =
             mPortBuffers[kPortIndexOutput][index].mData;
-        sp<AMessage> msg = mCallback->dup();
-        msg->setInt32("callbackID", CB_OUTPUT_AVAILABLE);
-        msg->setInt32("index", index);
-        msg->setSize("offset", buffer->offset());
-        msg->setSize("size", buffer->size());
 
         int64_t timeUs;
         CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
 
-        msg->setInt64("timeUs", timeUs);
-
         statsBufferReceived(timeUs);
 
         int32_t flags;
         CHECK(buffer->meta()->findInt32("flags", &flags));
 
+        if (mBufferListener != NULL) {
+            mBufferListener->onOutputBufferAvailable(
+                    index, buffer->offset(), buffer->size(), timeUs, flags);
+            continue;
+        }
+
+        sp<AMessage> msg = mCallback->dup();
+        msg->setInt32("callbackID", CB_OUTPUT_AVAILABLE);
+        msg->setInt32("index", index);
+        msg->setSize("offset", buffer->offset());
+        msg->setSize("size", buffer->size());
+        msg->setInt64("timeUs", timeUs);
         msg->setInt32("flags", flags);
 
         msg->post();
@@ -20,16 +20,24 @@
 
 #include "MediaCodecListOverrides.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+
 #include <cutils/properties.h>
 #include <gui/Surface.h>
 #include <media/ICrypto.h>
 #include <media/IMediaCodecList.h>
+#include <media/MediaCodecBuffer.h>
 #include <media/MediaCodecInfo.h>
 #include <media/MediaResourcePolicy.h>
 #include <media/openmax/OMX_IVCommon.h>
+#include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
 #include <media/stagefright/MediaCodecList.h>
+#include <media/stagefright/MediaErrors.h>
 
 namespace android {
 
@@ -181,6 +189,222 @@ static size_t doProfileCodecs(
     return codecs.size();
 }
 
+// Sizes at which video encoders are driven with 1, 2, 4... concurrent instances to find the
+// aggregate frame rate they sustain together.
+static const struct {
+    int32_t width;
+    int32_t height;
+} kThroughputSizes[] = {
+    { 352, 288 },
+    { 1280, 720 },
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+static const size_t kMaxThroughputInstances = 8;
+static const int64_t kThroughputMeasureUs = 1000000ll;
+static const int64_t kThroughputTimeoutUs = 5000000ll;
+
+static bool getMaxSize(
+        const sp<MediaCodecInfo::Capabilities> &caps, int32_t *width, int32_t *height) {
+    AString sizeRange;
+    AString minSize;
+    AString maxSize;
+    AString sWidth;
+    AString sHeight;
+    if (!caps->getDetails()->findString("size-range", &sizeRange)
+            || !splitString(sizeRange, "-", &minSize, &maxSize)
+            || (!splitString(maxSize, "x", &sWidth, &sHeight)
+                && !splitString(maxSize, "*", &sWidth, &sHeight))) {
+        return false;
+    }
+    *width = strtol(sWidth.c_str(), NULL, 10);
+    *height = strtol(sHeight.c_str(), NULL, 10);
+    return (*width > 0) && (*height > 0);
+}
+
+// returns a color format that byte buffers can be filled in, or 0.
+static int32_t getByteBufferColorFormat(const sp<MediaCodecInfo::Capabilities> &caps) {
+    Vector<uint32_t> colorFormats;
+    caps->getSupportedColorFormats(&colorFormats);
+    for (uint32_t colorFormat : colorFormats) {
+        if (colorFormat == COLOR_FormatYUV420Flexible
+                || colorFormat == COLOR_FormatYUV420Planar
+                || colorFormat == COLOR_FormatYUV420SemiPlanar) {
+            return colorFormat;
+        }
+    }
+    return 0;
+}
+
+// Feeds synthetic frames to |numInstances| instances of encoder |name| at once and returns
+// the frames per second they output together, or 0 if they could not all run.
+static double measureThroughput(
+        const AString &name, const sp<AMessage> &format, size_t numInstances) {
+    int32_t width;
+    int32_t height;
+    CHECK(format->findInt32("width", &width));
+    CHECK(format->findInt32("height", &height));
+    const size_t frameSize = (size_t)width * height * 3 / 2;
+
+    status_t err = OK;
+    Vector<sp<MediaCodec>> codecs;
+    while (err == OK && codecs.size() < numInstances) {
+        sp<ALooper> looper = new ALooper;
+        looper->setName("MediaCodec_looper");
+        looper->start(
+                false /* runOnCallingThread */, false /* canCallJava */, ANDROID_PRIORITY_AUDIO);
+        sp<MediaCodec> codec = MediaCodec::CreateByComponentName(looper, name.c_str(), &err);
+        if (err != OK) {
+            break;
+        }
+        err = codec->configure(format, NULL /* nativeWindow */, NULL /* crypto */,
+                MediaCodec::CONFIGURE_FLAG_ENCODE);
+        if (err == OK) {
+            err = codec->start();
+        }
+        if (err != OK) {
+            codec->release();
+            break;
+        }
+        codecs.push_back(codec);
+    }
+
+    Vector<int64_t> queued;
+    Vector<bool> started;
+    queued.insertAt(0, 0, codecs.size());
+    started.insertAt(false, 0, codecs.size());
+    size_t numStarted = 0;
+    int64_t frames = 0;
+    const int64_t beginUs = ALooper::GetNowUs();
+    int64_t startUs = -1;
+    int64_t nowUs = beginUs;
+    while (err == OK && codecs.size() == numInstances) {
+        nowUs = ALooper::GetNowUs();
+        if ((startUs >= 0 && nowUs - startUs >= kThroughputMeasureUs)
+                || nowUs - beginUs >= kThroughputTimeoutUs) {
+            break;
+        }
+        bool progress = false;
+        for (size_t i = 0; err == OK && i < codecs.size(); ++i) {
+            size_t index;
+            if (codecs[i]->dequeueInputBuffer(&index) == OK) {
+                sp<MediaCodecBuffer> buffer;
+                err = codecs[i]->getInputBuffer(index, &buffer);
+                if (err != OK || buffer == NULL || buffer->capacity() < frameSize) {
+                    err = err != OK ? err : BAD_VALUE;
+                    break;
+                }
+                // a moving gradient, so that frames differ and the encoder has work to do
+                uint8_t *data = buffer->base();
+                const uint8_t offset = (uint8_t)(queued[i] * 3);
+                for (size_t j = 0; j < frameSize; ++j) {
+                    data[j] = (uint8_t)j + offset;
+                }
+                err = codecs[i]->queueInputBuffer(
+                        index, 0 /* offset */, frameSize, queued[i] * 33333ll, 0 /* flags */);
+                queued.editItemAt(i)++;
+                progress = true;
+            }
+
+            size_t offset;
+            size_t size;
+            int64_t timeUs;
+            uint32_t flags;
+            status_t res;
+            while (err == OK && (res = codecs[i]->dequeueOutputBuffer(
+                    &index, &offset, &size, &timeUs, &flags)) != -EAGAIN) {
+                if (res == INFO_FORMAT_CHANGED || res == INFO_OUTPUT_BUFFERS_CHANGED) {
+                    continue;
+                }
+                if (res != OK) {
+                    err = res;
+                    break;
+                }
+                err = codecs[i]->releaseOutputBuffer(index);
+                progress = true;
+                if (flags & MediaCodec::BUFFER_FLAG_CODECCONFIG) {
+                    continue;
+                }
+                if (!started[i]) {
+                    // count from when all instances are up to speed
+                    started.editItemAt(i) = true;
+                    if (++numStarted == codecs.size()) {
+                        startUs = ALooper::GetNowUs();
+                    }
+                } else if (startUs >= 0) {
+                    ++frames;
+                }
+            }
+        }
+        if (!progress) {
+            usleep(1000);
+        }
+    }
+
+    for (size_t i = 0; i < codecs.size(); ++i) {
+        codecs[i]->release();
+    }
+    if (err != OK || startUs < 0 || nowUs <= startUs) {
+        ALOGV("measureThroughput %s x%zu: failed (%d)", name.c_str(), numInstances, err);
+        return 0;
+    }
+    const double fps = frames * 1E6 / (nowUs - startUs);
+    ALOGV("measureThroughput %s %dx%d x%zu: %.1f fps", name.c_str(), width, height,
+            numInstances, fps);
+    return fps;
+}
+
+// Adds, for each size the encoder supports, the aggregate frame rates measured with 1, 2,
+// 4... up to |maxInstances| concurrent instances as "measured-concurrent-frame-rate-WxH"
+// (e.g. "1:240,2:400,4:410"), and the best of them as the "performance-point-WxH".
+static void profileThroughput(
+        const AString &name, const AString &mime, const sp<MediaCodecInfo::Capabilities> &caps,
+        size_t maxInstances, CodecSettings *settings) {
+    sp<AMessage> format = getMeasureFormat(true /* isEncoder */, mime, caps);
+    const int32_t colorFormat = getByteBufferColorFormat(caps);
+    int32_t maxWidth;
+    int32_t maxHeight;
+    if (format == NULL || colorFormat == 0 || !getMaxSize(caps, &maxWidth, &maxHeight)) {
+        return;
+    }
+    format->setInt32("color-format", colorFormat);
+    format->setFloat("frame-rate", 30.0);
+    format->setInt32("i-frame-interval", 1);
+    maxInstances = std::min(maxInstances, kMaxThroughputInstances);
+
+    for (const auto &size : kThroughputSizes) {
+        // either orientation
+        if (std::max(size.width, size.height) > std::max(maxWidth, maxHeight)
+                || std::min(size.width, size.height) > std::min(maxWidth, maxHeight)) {
+            continue;
+        }
+        format->setInt32("width", size.width);
+        format->setInt32("height", size.height);
+        format->setInt32("bitrate", size.width * size.height * 4);
+
+        AString curve;
+        int32_t best = 0;
+        for (size_t n = 1; n <= maxInstances; n = n < maxInstances && n * 2 > maxInstances ?
+                maxInstances : n * 2) {
+            const int32_t fps = (int32_t)measureThroughput(name, format, n);
+            if (fps <= 0) {
+                break;
+            }
+            curve.append(AStringPrintf("%s%zu:%d", curve.empty() ? "" : ",", n, fps));
+            best = std::max(best, fps);
+            if (n == maxInstances) {
+                break;
+            }
+        }
+        if (best > 0) {
+            settings->add(AStringPrintf("measured-concurrent-frame-rate-%dx%d",
+                    size.width, size.height), curve);
+            settings->add(AStringPrintf("performance-point-%dx%d", size.width, size.height),
+                    AStringPrintf("%d", best));
+        }
+    }
+}
+
 bool splitString(const AString &s, const AString &delimiter, AString *s1, AString *s2) {
     ssize_t pos = s.find(delimiter.c_str());
     if (pos < 0) {
@@ -245,6 +469,10 @@ void profileCodecs(
                 char maxStr[32];
                 sprintf(maxStr, "%zu", max);
                 settings.add("max-supported-instances", maxStr);
+                if (info->isEncoder() && mediaTypes[i].startsWith("video/")) {
+                    // decoders would need streams to decode, only encoders are driven.
+                    profileThroughput(name, mediaTypes[i], caps, max, &settings);
+                }
 
                 AString key = name;
                 key.append(" ");
@@ -294,8 +522,8 @@ static AString codecResultsToXml(const KeyedVector<AString, CodecSettings> &resu
         ret.append(codec);
         const CodecSettings &settings = results.valueAt(i);
         for (size_t i = 0; i < settings.size(); ++i) {
-            // WARNING: we assume all the settings are "Limit". Currently we have only one type
-            // of setting in this case, which is "max-supported-instances".
+            // WARNING: we assume all the settings are "Limit". Currently these are
+            // "max-supported-instances" and the measured throughput of encoders.
             AString setting = AStringPrintf(
                     "            <Limit name=\"%s\" value=\"%s\" />\n",
                     settings.keyAt(i).c_str(),
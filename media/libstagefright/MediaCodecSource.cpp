@@ -408,6 +408,10 @@ sp<MetaData> MediaCodecSource::getFormat() {
     return *meta;
 }
 
+sp<AMessage> MediaCodecSource::getBackpressureNotify() {
+    return new AMessage(kWhatBackpressure, mReflector);
+}
+
 sp<IGraphicBufferProducer> MediaCodecSource::getGraphicBufferProducer() {
     CHECK(mFlags & FLAG_USE_SURFACE_INPUT);
     return mGraphicBufferProducer;
@@ -455,6 +459,10 @@ MediaCodecSource::MediaCodecSource(
       mInputBufferTimeOffsetUs(0),
       mFirstSampleSystemTimeUs(-1LL),
       mPausePending(false),
+      mBackpressured(false),
+      mDropUntilSyncFrame(false),
+      mNumBackpressureDrops(0),
+      mFirstOutputSystemTimeUs(-1LL),
       mFirstSampleTimeUs(-1LL),
       mGeneration(0) {
     CHECK(mLooper != NULL);
@@ -913,6 +921,22 @@ void MediaCodecSource::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
+            if (mIsVideo && !(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)
+                    && (mBackpressured || mDropUntilSyncFrame)) {
+                if (mBackpressured || !(flags & MediaCodec::BUFFER_FLAG_SYNCFRAME)) {
+                    if (!(mFlags & FLAG_USE_SURFACE_INPUT)) {
+                        CHECK(!mDecodingTimeQueue.empty());
+                        mDecodingTimeQueue.erase(mDecodingTimeQueue.begin());
+                    }
+                    ++mNumBackpressureDrops;
+                    mEncoder->releaseOutputBuffer(index);
+                    break;
+                }
+                mDropUntilSyncFrame = false;
+                ALOGI("resuming output at %" PRId64 " us, %" PRId64 " frames dropped so far",
+                        timeUs, mNumBackpressureDrops);
+            }
+
             MediaBufferBase *mbuf = new MediaBuffer(outbuf->size());
             mbuf->setObserver(this);
             mbuf->add_ref();
@@ -960,6 +984,9 @@ void MediaCodecSource::onMessageReceived(const sp<AMessage> &msg) {
                             timeUs, timeUs / 1E6, driftTimeUs);
                 }
                 mbuf->meta_data().setInt64(kKeyTime, timeUs);
+                if (mFirstOutputSystemTimeUs < 0LL) {
+                    mFirstOutputSystemTimeUs = systemTime() / 1000;
+                }
             } else {
                 mbuf->meta_data().setInt64(kKeyTime, 0LL);
                 mbuf->meta_data().setInt32(kKeyIsCodecConfig, true);
@@ -1078,6 +1105,24 @@ void MediaCodecSource::onMessageReceived(const sp<AMessage> &msg) {
         break;
     }
 
+    case kWhatBackpressure:
+    {
+        int32_t active;
+        CHECK(msg->findInt32("active", &active));
+        if (!mIsVideo || mBackpressured == (active != 0)) {
+            break;
+        }
+        mBackpressured = active;
+        ALOGW("writer %s, %s output", active ? "falling behind" : "caught up",
+                active ? "dropping" : "resuming");
+        if (!active && mStarted && !mStopping) {
+            // the frames since the last sync frame are gone
+            mDropUntilSyncFrame = true;
+            mEncoder->requestIDRFrame();
+        }
+        break;
+    }
+
     case kWhatPause:
     {
         if (mFirstSampleSystemTimeUs < 0) {
@@ -18,6 +18,8 @@
 #define LOG_TAG "MediaExtractorFactory"
 #include <utils/Log.h>
 
+#include "include/CallbackDataSource.h"
+
 #include <android/dlext.h>
 #include <android-base/logging.h>
 #include <binder/IPCThreadState.h>
@@ -127,6 +129,9 @@ std::shared_ptr<std::list<sp<ExtractorPlugin>>> MediaExtractorFactory::gPlugins;
 bool MediaExtractorFactory::gPluginsRegistered = false;
 bool MediaExtractorFactory::gIgnoreVersion = false;
 
+// No extractor reports more than this, so sniffing can stop at such a match.
+static const float kConclusiveConfidence = 0.8f;
+
 // static
 void *MediaExtractorFactory::sniff(
         const sp<DataSource> &source, float *confidence, void **meta,
@@ -143,6 +148,9 @@ void *MediaExtractorFactory::sniff(
         plugins = gPlugins;
     }
 
+    // the sniffers run against a copy of the header, read once from the source.
+    sp<DataSource> sniffSource = new SniffCacheSource(source);
+
     void *bestCreator = NULL;
     for (auto it = plugins->begin(); it != plugins->end(); ++it) {
         ALOGV("sniffing %s", (*it)->def.extractor_name);
@@ -153,10 +161,10 @@ void *MediaExtractorFactory::sniff(
         void *curCreator = NULL;
         if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V1) {
             curCreator = (void*) (*it)->def.u.v2.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
+                    sniffSource->wrap(), &newConfidence, &newMeta, &newFreeMeta);
         } else if ((*it)->def.def_version == EXTRACTORDEF_VERSION_NDK_V2) {
             curCreator = (void*) (*it)->def.u.v3.sniff(
-                    source->wrap(), &newConfidence, &newMeta, &newFreeMeta);
+                    sniffSource->wrap(), &newConfidence, &newMeta, &newFreeMeta);
         }
 
         if (curCreator) {
@@ -170,6 +178,10 @@ void *MediaExtractorFactory::sniff(
                 plugin = *it;
                 bestCreator = curCreator;
                 *creatorVersion = (*it)->def.def_version;
+                if (newConfidence >= kConclusiveConfidence) {
+                    ALOGV("%s is conclusive", (*it)->def.extractor_name);
+                    break;
+                }
             } else {
                 if (newMeta != nullptr && newFreeMeta != nullptr) {
                     newFreeMeta(newMeta);
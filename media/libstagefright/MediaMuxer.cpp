@@ -21,9 +21,12 @@
 
 #include <utils/Log.h>
 
+#include <atomic>
+
 #include <media/stagefright/MediaMuxer.h>
 
 #include <media/mediarecorder.h>
+#include <media/MediaCodecBuffer.h>
 #include <media/MediaSource.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -40,6 +43,37 @@
 
 namespace android {
 
+struct MediaMuxer::TrackLending : public RefBase {
+    TrackLending() : mNumLent(0) {}
+
+    // changed on the writer's threads, which must not take mMuxerLock
+    std::atomic<int32_t> mNumLent;
+};
+
+// Keeps a codec output buffer alive for the MediaBuffer that wraps it, and
+// posts the caller's notification once the writer releases that.
+struct MediaMuxer::LentBuffer : public MediaBufferObserver {
+    LentBuffer(const sp<MediaCodecBuffer> &buffer, const sp<AMessage> &notify,
+               const sp<TrackLending> &lending)
+        : mBuffer(buffer), mNotify(notify), mLending(lending) {
+        ++mLending->mNumLent;
+    }
+
+    virtual void signalBufferReturned(MediaBufferBase *buffer) {
+        buffer->setObserver(NULL);
+        buffer->release();
+        mBuffer.clear();
+        --mLending->mNumLent;
+        mNotify->post();
+        delete this;
+    }
+
+private:
+    sp<MediaCodecBuffer> mBuffer;
+    sp<AMessage> mNotify;
+    sp<TrackLending> mLending;
+};
+
 static bool isMp4Format(MediaMuxer::OutputFormat format) {
     return format == MediaMuxer::OUTPUT_FORMAT_MPEG_4 ||
            format == MediaMuxer::OUTPUT_FORMAT_THREE_GPP ||
@@ -76,6 +110,7 @@ MediaMuxer::~MediaMuxer() {
     mFileMeta.clear();
     mWriter.clear();
     mTrackList.clear();
+    mLending.clear();
 }
 
 ssize_t MediaMuxer::addTrack(const sp<AMessage> &format) {
@@ -97,6 +132,7 @@ ssize_t MediaMuxer::addTrack(const sp<AMessage> &format) {
     sp<MediaAdapter> newTrack = new MediaAdapter(trackMeta);
     status_t result = mWriter->addSource(newTrack);
     if (result == OK) {
+        mLending.add(new TrackLending);
         return mTrackList.add(newTrack);
     }
     return -1;
@@ -133,6 +169,25 @@ status_t MediaMuxer::setLocation(int latitude, int longitude) {
     return static_cast<MPEG4Writer*>(mWriter.get())->setGeoData(latitude, longitude);
 }
 
+status_t MediaMuxer::setFragmentDuration(int64_t durationUs) {
+    Mutex::Autolock autoLock(mMuxerLock);
+    if (mState != INITIALIZED) {
+        ALOGE("setFragmentDuration() must be called before start().");
+        return INVALID_OPERATION;
+    }
+    if (!isMp4Format(mFormat) || mFormat == OUTPUT_FORMAT_HEIF) {
+        ALOGE("setFragmentDuration() is only supported for .mp4 or .3gp output.");
+        return INVALID_OPERATION;
+    }
+    if (durationUs < 0) {
+        ALOGE("setFragmentDuration() get invalid duration");
+        return -EINVAL;
+    }
+
+    mFileMeta->setInt64(kKeyFragmentDurationUs, durationUs);
+    return OK;
+}
+
 status_t MediaMuxer::start() {
     Mutex::Autolock autoLock(mMuxerLock);
     if (mState == INITIALIZED) {
@@ -162,11 +217,8 @@ status_t MediaMuxer::stop() {
     }
 }
 
-status_t MediaMuxer::writeSampleData(const sp<ABuffer> &buffer, size_t trackIndex,
-                                     int64_t timeUs, uint32_t flags) {
-    Mutex::Autolock autoLock(mMuxerLock);
-
-    if (buffer.get() == NULL) {
+status_t MediaMuxer::checkSampleData_l(bool isNull, size_t trackIndex) {
+    if (isNull) {
         ALOGE("WriteSampleData() get an NULL buffer.");
         return -EINVAL;
     }
@@ -180,12 +232,11 @@ status_t MediaMuxer::writeSampleData(const sp<ABuffer> &buffer, size_t trackInde
         ALOGE("WriteSampleData() get an invalid index %zu", trackIndex);
         return -EINVAL;
     }
+    return OK;
+}
 
-    MediaBuffer* mediaBuffer = new MediaBuffer(buffer);
-
-    mediaBuffer->add_ref(); // Released in MediaAdapter::signalBufferReturned().
-    mediaBuffer->set_range(buffer->offset(), buffer->size());
-
+status_t MediaMuxer::pushSample_l(MediaBuffer *mediaBuffer, size_t trackIndex,
+                                  int64_t timeUs, uint32_t flags) {
     MetaDataBase &sampleMetaData = mediaBuffer->meta_data();
     sampleMetaData.setInt64(kKeyTime, timeUs);
     // Just set the kKeyDecodingTime as the presentation time for now.
@@ -204,4 +255,53 @@ status_t MediaMuxer::writeSampleData(const sp<ABuffer> &buffer, size_t trackInde
     return currentTrack->pushBuffer(mediaBuffer);
 }
 
+status_t MediaMuxer::writeSampleData(const sp<ABuffer> &buffer, size_t trackIndex,
+                                     int64_t timeUs, uint32_t flags) {
+    Mutex::Autolock autoLock(mMuxerLock);
+
+    status_t err = checkSampleData_l(buffer.get() == NULL, trackIndex);
+    if (err != OK) {
+        return err;
+    }
+
+    MediaBuffer* mediaBuffer = new MediaBuffer(buffer);
+
+    mediaBuffer->add_ref(); // Released in MediaAdapter::signalBufferReturned().
+    mediaBuffer->set_range(buffer->offset(), buffer->size());
+
+    return pushSample_l(mediaBuffer, trackIndex, timeUs, flags);
+}
+
+status_t MediaMuxer::writeSampleData(const sp<MediaCodecBuffer> &buffer, size_t trackIndex,
+                                     int64_t timeUs, uint32_t flags,
+                                     const sp<AMessage> &releaseNotify) {
+    Mutex::Autolock autoLock(mMuxerLock);
+
+    status_t err = checkSampleData_l(buffer.get() == NULL, trackIndex);
+    if (err != OK) {
+        return err;
+    }
+    if (releaseNotify == NULL) {
+        ALOGE("WriteSampleData() get no release notification.");
+        return -EINVAL;
+    }
+
+    MediaBuffer* mediaBuffer;
+    sp<TrackLending> lending = mLending[trackIndex];
+    if (lending->mNumLent < kMaxLentBuffers) {
+        mediaBuffer = new MediaBuffer(buffer->base(), buffer->capacity());
+        mediaBuffer->setObserver(new LentBuffer(buffer, releaseNotify, lending));
+        mediaBuffer->add_ref(); // Released by the writer once written.
+        mediaBuffer->set_range(buffer->offset(), buffer->size());
+    } else {
+        // The copy is ours, so the writer can still keep it without another copy.
+        mediaBuffer = new MediaBuffer(buffer->size());
+        memcpy(mediaBuffer->data(), buffer->data(), buffer->size());
+        releaseNotify->post();
+    }
+    mediaBuffer->meta_data().setInt32(kKeyMayHoldBuffer, true);
+
+    return pushSample_l(mediaBuffer, trackIndex, timeUs, flags);
+}
+
 }  // namespace android
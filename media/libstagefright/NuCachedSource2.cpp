@@ -21,12 +21,18 @@
 #include <utils/Log.h>
 
 #include "include/NuCachedSource2.h"
+#include "include/DiskCache.h"
 #include "include/HTTPBase.h"
 
 #include <cutils/properties.h>
+#include <media/MediaHTTPConnection.h>
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaHTTP.h>
 
 namespace android {
 
@@ -179,10 +185,91 @@ void PageCache::copy(size_t from, void *data, size_t size) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// An extra connection to the source that reads the ranges it is given.
+struct NuCachedSource2::RangeFetcher : public AHandler {
+    RangeFetcher(
+            const sp<HTTPBase> &source, const char *uri,
+            const KeyedVector<String8, String8> *headers, const sp<AMessage> &notify)
+        : mSource(source),
+          mURI(uri),
+          mNotify(notify),
+          mConnected(false) {
+        if (headers != NULL) {
+            mHeaders = *headers;
+        }
+    }
+
+    void fetch(off64_t offset, size_t size, int32_t generation) {
+        sp<AMessage> msg = new AMessage(kWhatFetch, this);
+        msg->setInt64("offset", offset);
+        msg->setSize("size", size);
+        msg->setInt32("generation", generation);
+        msg->post();
+    }
+
+    const sp<HTTPBase> &source() const {
+        return mSource;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        CHECK_EQ(msg->what(), (uint32_t)kWhatFetch);
+
+        int64_t offset;
+        size_t size;
+        int32_t generation;
+        CHECK(msg->findInt64("offset", &offset));
+        CHECK(msg->findSize("size", &size));
+        CHECK(msg->findInt32("generation", &generation));
+
+        sp<AMessage> notify = mNotify->dup();
+        notify->setInt64("offset", offset);
+        notify->setInt32("generation", generation);
+
+        status_t err = OK;
+        if (!mConnected) {
+            err = mSource->connect(mURI.c_str(), &mHeaders, offset);
+            mConnected = (err == OK);
+        }
+        if (err == OK) {
+            // later ranges are range requests of the same connection.
+            sp<ABuffer> buffer = new ABuffer(size);
+            int64_t startUs = ALooper::GetNowUs();
+            ssize_t n = mSource->readAt(offset, buffer->data(), size);
+            if (n < 0) {
+                err = n;
+            } else {
+                ALOGV("range at %lld: %zd bytes in %lld us", (long long)offset, n,
+                        (long long)(ALooper::GetNowUs() - startUs));
+                buffer->setRange(0, n);
+                notify->setBuffer("buffer", buffer);
+            }
+        }
+        notify->setInt32("err", err);
+        notify->post();
+    }
+
+private:
+    enum {
+        kWhatFetch = 'ftch',
+    };
+
+    sp<HTTPBase> mSource;
+    AString mURI;
+    KeyedVector<String8, String8> mHeaders;
+    sp<AMessage> mNotify;
+    bool mConnected;
+
+    DISALLOW_EVIL_CONSTRUCTORS(RangeFetcher);
+};
+
 NuCachedSource2::NuCachedSource2(
         const sp<DataSource> &source,
         const char *cacheConfig,
-        bool disconnectAtHighwatermark)
+        bool disconnectAtHighwatermark,
+        const sp<MediaHTTPService> &httpService,
+        const char *uri,
+        const KeyedVector<String8, String8> *headers)
     : mSource(source),
       mReflector(new AHandlerReflector<NuCachedSource2>(this)),
       mLooper(new ALooper),
@@ -197,7 +284,13 @@ NuCachedSource2::NuCachedSource2(
       mHighwaterThresholdBytes(kDefaultHighWaterThreshold),
       mLowwaterThresholdBytes(kDefaultLowWaterThreshold),
       mKeepAliveIntervalUs(kDefaultKeepAliveIntervalUs),
-      mDisconnectAtHighwatermark(disconnectAtHighwatermark) {
+      mDisconnectAtHighwatermark(disconnectAtHighwatermark),
+      mDiskChunkOffset(-1),
+      mSourceSize(-1),
+      mNextRangeOffset(-1),
+      mRangeGeneration(0),
+      mRangesGeneration(0),
+      mWaitingForRange(false) {
     // We are NOT going to support disconnect-at-highwatermark indefinitely
     // and we are not guaranteeing support for client-specified cache
     // parameters. Both of these are temporary measures to solve a specific
@@ -214,9 +307,44 @@ NuCachedSource2::NuCachedSource2(
         mKeepAliveIntervalUs = 0;
     }
 
+    if ((mSource->flags() & kIsHTTPBasedSource)
+            && mSource->getSize(&mSourceSize) == OK) {
+        mDiskCache = DiskCache::getInstance();
+        // the size tells apart different versions of the content at the same URI.
+        mDiskCacheURI = AStringPrintf(
+                "%s#%lld", mSource->getUri().string(), (long long)mSourceSize);
+    }
+
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
 
+    // Range requests need the size, to stay within the source.
+    int32_t numConnections = property_get_int32("media.stagefright.cache-connections", 1);
+    if (numConnections > kMaxNumConnections) {
+        numConnections = kMaxNumConnections;
+    }
+    if (httpService != NULL && uri != NULL && mSourceSize > 0 && !mDisconnectAtHighwatermark) {
+        for (int32_t i = 1; i < numConnections; ++i) {
+            sp<MediaHTTPConnection> conn = httpService->makeHTTPConnection();
+            if (conn == NULL) {
+                break;
+            }
+            sp<AMessage> notify = new AMessage(kWhatRangeFetched, mReflector);
+            notify->setSize("index", mRangeConnections.size());
+
+            RangeConnection connection;
+            connection.mLooper = new ALooper;
+            connection.mLooper->setName("NuCachedSource2.range");
+            connection.mFetcher = new RangeFetcher(new MediaHTTP(conn), uri, headers, notify);
+            connection.mLooper->registerHandler(connection.mFetcher);
+            connection.mLooper->start(
+                    false /* runOnCallingThread */, true /* canCallJava */);
+            connection.mBusy = false;
+            connection.mFailed = false;
+            mRangeConnections.push_back(connection);
+        }
+    }
+
     // Since it may not be obvious why our looper thread needs to be
     // able to call into java since it doesn't appear to do so at all...
     // IMediaHTTPConnection may be (and most likely is) implemented in JAVA
@@ -232,6 +360,12 @@ NuCachedSource2::~NuCachedSource2() {
     mLooper->stop();
     mLooper->unregisterHandler(mReflector->id());
 
+    for (size_t i = 0; i < mRangeConnections.size(); ++i) {
+        mRangeConnections[i].mFetcher->source()->disconnect();
+        mRangeConnections[i].mLooper->stop();
+        mRangeConnections[i].mLooper->unregisterHandler(mRangeConnections[i].mFetcher->id());
+    }
+
     delete mCache;
     mCache = NULL;
 }
@@ -240,9 +374,12 @@ NuCachedSource2::~NuCachedSource2() {
 sp<NuCachedSource2> NuCachedSource2::Create(
         const sp<DataSource> &source,
         const char *cacheConfig,
-        bool disconnectAtHighwatermark) {
+        bool disconnectAtHighwatermark,
+        const sp<MediaHTTPService> &httpService,
+        const char *uri,
+        const KeyedVector<String8, String8> *headers) {
     sp<NuCachedSource2> instance = new NuCachedSource2(
-            source, cacheConfig, disconnectAtHighwatermark);
+            source, cacheConfig, disconnectAtHighwatermark, httpService, uri, headers);
     Mutex::Autolock autoLock(instance->mLock);
     (new AMessage(kWhatFetchMore, instance->mReflector))->post();
     return instance;
@@ -251,7 +388,18 @@ sp<NuCachedSource2> NuCachedSource2::Create(
 status_t NuCachedSource2::getEstimatedBandwidthKbps(int32_t *kbps) {
     if (mSource->flags() & kIsHTTPBasedSource) {
         HTTPBase* source = static_cast<HTTPBase *>(mSource.get());
-        return source->getEstimatedBandwidthKbps(kbps);
+        status_t err = source->getEstimatedBandwidthKbps(kbps);
+        // the connections share the link, so their throughputs add up.
+        for (size_t i = 0; i < mRangeConnections.size(); ++i) {
+            int32_t rangeKbps;
+            if (mRangeConnections[i].mFetcher->source()->getEstimatedBandwidthKbps(
+                    &rangeKbps) == OK) {
+                ALOGV("range connection %zu: %d kbps", i, rangeKbps);
+                *kbps = (err == OK ? *kbps : 0) + rangeKbps;
+                err = OK;
+            }
+        }
+        return err;
     }
     return ERROR_UNSUPPORTED;
 }
@@ -278,6 +426,9 @@ void NuCachedSource2::disconnect() {
         // explicitly disconnect from the source, to allow any
         // pending reads to return more promptly
         static_cast<HTTPBase *>(mSource.get())->disconnect();
+        for (size_t i = 0; i < mRangeConnections.size(); ++i) {
+            mRangeConnections[i].mFetcher->source()->disconnect();
+        }
     }
 }
 
@@ -317,6 +468,12 @@ void NuCachedSource2::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatRangeFetched:
+        {
+            onRangeFetched(msg);
+            break;
+        }
+
         default:
             TRESPASS();
     }
@@ -326,11 +483,19 @@ void NuCachedSource2::fetchInternal() {
     ALOGV("fetchInternal");
 
     bool reconnect = false;
+    mWaitingForRange = false;
 
     {
         Mutex::Autolock autoLock(mLock);
         CHECK(mFinalStatus == OK || mNumRetriesLeft > 0);
 
+        if (mRangeGeneration != mRangesGeneration) {
+            // seeked, results of ranges in progress are dropped when they come in.
+            mRangesGeneration = mRangeGeneration;
+            mRanges.clear();
+            mNextRangeOffset = -1;
+        }
+
         if (mFinalStatus != OK) {
             --mNumRetriesLeft;
 
@@ -361,10 +526,24 @@ void NuCachedSource2::fetchInternal() {
         }
     }
 
+    off64_t offset = mCacheOffset + mCache->totalSize();
     PageCache::Page *page = mCache->acquirePage();
 
-    ssize_t n = mSource->readAt(
-            mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+    ssize_t n = -ENOENT;
+    size_t size = kPageSize;
+    if (!mRangeConnections.empty()) {
+        scheduleRanges(offset);
+        n = readFromRanges(offset, page->mData, &size);
+        if (n == -EAGAIN) {
+            mWaitingForRange = true;
+            Mutex::Autolock autoLock(mLock);
+            mCache->releasePage(page);
+            return;
+        }
+    }
+    if (n == -ENOENT) {
+        n = readPage(offset, page->mData, size);
+    }
 
     Mutex::Autolock autoLock(mLock);
 
@@ -397,6 +576,162 @@ void NuCachedSource2::fetchInternal() {
     }
 }
 
+ssize_t NuCachedSource2::readPage(off64_t offset, void *data, size_t size) {
+    if (mDiskCache == NULL) {
+        return mSource->readAt(offset, data, size);
+    }
+
+    off64_t chunkOffset = offset - offset % kPageSize;
+    size_t delta = offset - chunkOffset;
+    sp<ABuffer> chunk = mDiskCache->lookup(mDiskCacheURI, chunkOffset, kPageSize);
+    if (chunk != NULL) {
+        // only the last chunk is shorter than a page.
+        if (chunk->size() <= delta) {
+            return 0;
+        }
+        if (size > chunk->size() - delta) {
+            size = chunk->size() - delta;
+        }
+        memcpy(data, chunk->data() + delta, size);
+        return size;
+    }
+
+    // stop at the end of the chunk, so that it can be stored.
+    if (size > kPageSize - delta) {
+        size = kPageSize - delta;
+    }
+    ssize_t n = mSource->readAt(offset, data, size);
+    addToDiskChunk(offset, data, n);
+    return n;
+}
+
+ssize_t NuCachedSource2::readFromRanges(off64_t offset, void *data, size_t *size) {
+    while (!mRanges.isEmpty()) {
+        // drop what the page cache has already.
+        const sp<ABuffer> &first = mRanges.valueAt(0);
+        if (first != NULL && mRanges.keyAt(0) + (off64_t)first->size() <= offset) {
+            mRanges.removeItemsAt(0);
+            continue;
+        }
+        break;
+    }
+
+    for (size_t i = 0; i < mRanges.size(); ++i) {
+        off64_t start = mRanges.keyAt(i);
+        const sp<ABuffer> &buffer = mRanges.valueAt(i);
+        if (offset < start) {
+            if (start - offset < (off64_t)*size) {
+                *size = start - offset;
+            }
+            return -ENOENT;
+        }
+        if (buffer == NULL) {
+            if (offset < start + kRangeSize) {
+                return -EAGAIN;
+            }
+            continue;
+        }
+        if (offset < start + (off64_t)buffer->size()) {
+            size_t n = buffer->size() - (offset - start);
+            if (n > kPageSize) {
+                n = kPageSize;
+            }
+            memcpy(data, buffer->data() + (offset - start), n);
+            if (mDiskCache != NULL) {
+                addToDiskChunk(offset, data, n);
+            }
+            return n;
+        }
+    }
+    return -ENOENT;
+}
+
+void NuCachedSource2::scheduleRanges(off64_t offset) {
+    // the range at offset is left to mSource.
+    if (mNextRangeOffset < offset + kRangeSize) {
+        mNextRangeOffset = offset + kRangeSize;
+    }
+
+    off64_t windowEnd = offset;
+    if (mHighwaterThresholdBytes > mCache->totalSize()) {
+        windowEnd += mHighwaterThresholdBytes - mCache->totalSize();
+    }
+    if (windowEnd > mSourceSize) {
+        windowEnd = mSourceSize;
+    }
+
+    for (size_t i = 0; i < mRangeConnections.size() && mNextRangeOffset < windowEnd; ++i) {
+        RangeConnection &connection = mRangeConnections.editItemAt(i);
+        if (connection.mBusy || connection.mFailed) {
+            continue;
+        }
+        size_t size = kRangeSize;
+        if (mSourceSize - mNextRangeOffset < (off64_t)size) {
+            size = mSourceSize - mNextRangeOffset;
+        }
+        mRanges.add(mNextRangeOffset, NULL);
+        connection.mFetcher->fetch(mNextRangeOffset, size, mRangesGeneration);
+        connection.mBusy = true;
+        mNextRangeOffset += size;
+    }
+}
+
+void NuCachedSource2::onRangeFetched(const sp<AMessage> &msg) {
+    size_t index;
+    int64_t offset;
+    int32_t generation, err;
+    CHECK(msg->findSize("index", &index));
+    CHECK(msg->findInt64("offset", &offset));
+    CHECK(msg->findInt32("generation", &generation));
+    CHECK(msg->findInt32("err", &err));
+
+    RangeConnection &connection = mRangeConnections.editItemAt(index);
+    connection.mBusy = false;
+
+    if (err != OK) {
+        ALOGW("range connection %zu failed (%d), leaving its ranges to the main one",
+                index, err);
+        connection.mFailed = true;
+    }
+    if (generation != mRangesGeneration || mRanges.indexOfKey(offset) < 0) {
+        return;
+    }
+
+    sp<ABuffer> buffer;
+    if (err != OK || !msg->findBuffer("buffer", &buffer) || buffer->size() == 0) {
+        mRanges.removeItem(offset);
+        return;
+    }
+    mRanges.replaceValueFor(offset, buffer);
+}
+
+void NuCachedSource2::addToDiskChunk(off64_t offset, const void *data, ssize_t n) {
+    if (n < 0) {
+        return;
+    }
+
+    if (mDiskChunk == NULL || mDiskChunkOffset + (off64_t)mDiskChunk->size() != offset) {
+        mDiskChunk.clear();
+        if (offset % kPageSize != 0) {
+            // started in the middle of a chunk, e.g. after a seek
+            return;
+        }
+        mDiskChunk = new ABuffer(kPageSize);
+        mDiskChunk->setRange(0, 0);
+        mDiskChunkOffset = offset;
+    }
+
+    memcpy(mDiskChunk->data() + mDiskChunk->size(), data, n);
+    mDiskChunk->setRange(0, mDiskChunk->size() + n);
+
+    // a short read at the end of the source, not one cut off by a disconnect
+    bool atEnd = mDiskChunkOffset + (off64_t)mDiskChunk->size() == mSourceSize;
+    if (mDiskChunk->size() == kPageSize || (atEnd && mDiskChunk->size() > 0)) {
+        mDiskCache->insert(mDiskCacheURI, mDiskChunkOffset, kPageSize, mDiskChunk);
+        mDiskChunk.clear();
+    }
+}
+
 void NuCachedSource2::onFetch() {
     ALOGV("onFetch");
 
@@ -441,6 +776,8 @@ void NuCachedSource2::onFetch() {
         if (mFinalStatus != OK && mNumRetriesLeft > 0) {
             // We failed this time and will try again in 3 seconds.
             delayUs = 3000000LL;
+        } else if (mWaitingForRange) {
+            delayUs = 10000LL;
         } else {
             delayUs = 0;
         }
@@ -673,6 +1010,7 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
     ALOGI("new range: offset= %lld", (long long)offset);
 
     mCacheOffset = offset;
+    ++mRangeGeneration;
 
     size_t totalSize = mCache->totalSize();
     CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
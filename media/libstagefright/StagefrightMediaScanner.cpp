@@ -22,6 +22,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <media/stagefright/MediaExtractorFactory.h>
 #include <media/stagefright/StagefrightMediaScanner.h>
 
@@ -64,9 +68,64 @@ MediaScanResult StagefrightMediaScanner::processFile(
     return result;
 }
 
+void StagefrightMediaScanner::processFiles(
+        BatchEntry *entries, size_t count, size_t numThreads) {
+    if (count == 0) {
+        return;
+    }
+    // the extension list is filled lazily, so do it before the workers race for it.
+    (void)FileHasAcceptableExtension(".");
+
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    if (numThreads > count) {
+        numThreads = count;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [this, entries, count, &next] {
+        size_t i;
+        while ((i = next.fetch_add(1)) < count) {
+            processBatchEntry(&entries[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void StagefrightMediaScanner::processBatchEntry(BatchEntry *entry) {
+    ALOGV("processBatchEntry '%s'.", entry->path);
+    entry->albumArt = NULL;
+
+    MediaScannerClient &client = *entry->client;
+    client.setLocale(locale());
+    client.beginFile();
+    sp<MediaMetadataRetriever> retriever;
+    entry->result = processFileInternal(entry->path, entry->mimeType, client, &retriever);
+    if (entry->mimeType == NULL && entry->result != MEDIA_SCAN_RESULT_OK) {
+        ALOGW("media scan failed for %s", entry->path);
+        client.setMimeType("application/octet-stream");
+    }
+    client.endFile();
+
+    if (entry->wantAlbumArt && entry->result == MEDIA_SCAN_RESULT_OK && retriever != NULL) {
+        sp<IMemory> mem = retriever->extractAlbumArt();
+        if (mem != NULL) {
+            MediaAlbumArt *art = static_cast<MediaAlbumArt *>(mem->pointer());
+            entry->albumArt = art->clone();
+        }
+    }
+}
+
 MediaScanResult StagefrightMediaScanner::processFileInternal(
         const char *path, const char * /* mimeType */,
-        MediaScannerClient &client) {
+        MediaScannerClient &client, sp<MediaMetadataRetriever> *retriever) {
     const char *extension = strrchr(path, '.');
 
     if (!extension) {
@@ -142,6 +201,9 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
         }
     }
 
+    if (retriever != NULL) {
+        *retriever = mRetriever;
+    }
     return MEDIA_SCAN_RESULT_OK;
 }
 
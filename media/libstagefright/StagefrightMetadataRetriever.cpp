@@ -19,6 +19,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include <utils/Log.h>
 #include <cutils/properties.h>
 
@@ -267,9 +269,69 @@ status_t StagefrightMetadataRetriever::getFrameAtIndex(
             colorFormat, metaOnly, NULL /*outFrame*/, frames);
 }
 
+status_t StagefrightMetadataRetriever::getFramesAtTimes(
+        std::vector<sp<IMemory> >* frames,
+        const std::vector<int64_t> &timesUs, int option, int colorFormat) {
+    ALOGV("getFramesAtTimes: %zu times, option: %d colorFormat: %d",
+            timesUs.size(), option, colorFormat);
+
+    if (timesUs.empty()) {
+        return BAD_VALUE;
+    }
+
+    if (option != MediaSource::ReadOptions::SEEK_CLOSEST) {
+        // a frame at a sync sample takes a single decode anyway
+        std::vector<sp<IMemory> > syncFrames;
+        for (int64_t timeUs : timesUs) {
+            sp<IMemory> frame;
+            status_t err = getFrameInternal(
+                    timeUs, 1, option, colorFormat, false /*metaOnly*/, &frame, NULL);
+            if (err != OK) {
+                return err;
+            }
+            syncFrames.push_back(frame);
+        }
+        frames->insert(frames->end(), syncFrames.begin(), syncFrames.end());
+        return OK;
+    }
+
+    // decode in increasing time order, and return the frames in the order asked
+    std::vector<size_t> order(timesUs.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&timesUs](size_t a, size_t b) {
+        return timesUs[a] < timesUs[b];
+    });
+    std::vector<int64_t> sortedTimesUs;
+    for (size_t i : order) {
+        sortedTimesUs.push_back(timesUs[i]);
+    }
+
+    std::vector<sp<IMemory> > sortedFrames;
+    status_t err = getFrameInternal(
+            sortedTimesUs[0], sortedTimesUs.size(), option, colorFormat,
+            false /*metaOnly*/, NULL /*outFrame*/, &sortedFrames, &sortedTimesUs);
+    if (err != OK) {
+        return err;
+    }
+    if (sortedFrames.size() != sortedTimesUs.size()) {
+        ALOGE("got %zu frames for %zu times", sortedFrames.size(), sortedTimesUs.size());
+        return UNKNOWN_ERROR;
+    }
+
+    std::vector<sp<IMemory> > orderedFrames(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        orderedFrames[order[i]] = sortedFrames[i];
+    }
+    frames->insert(frames->end(), orderedFrames.begin(), orderedFrames.end());
+    return OK;
+}
+
 status_t StagefrightMetadataRetriever::getFrameInternal(
         int64_t timeUs, int numFrames, int option, int colorFormat, bool metaOnly,
-        sp<IMemory>* outFrame, std::vector<sp<IMemory> >* outFrames) {
+        sp<IMemory>* outFrame, std::vector<sp<IMemory> >* outFrames,
+        const std::vector<int64_t> *timesUs) {
     if (mExtractor.get() == NULL) {
         ALOGE("no extractor.");
         return NO_INIT;
@@ -357,7 +419,9 @@ status_t StagefrightMetadataRetriever::getFrameInternal(
                     return OK;
                 }
             } else if (outFrames != NULL) {
-                status_t err = decoder->extractFrames(outFrames);
+                status_t err = (timesUs != NULL)
+                        ? decoder->extractFramesAtTimes(*timesUs, outFrames)
+                        : decoder->extractFrames(outFrames);
                 if (err == OK) {
                     return OK;
                 }
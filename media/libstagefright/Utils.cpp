@@ -17,10 +17,13 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "Utils"
 #include <utils/Log.h>
+#include <utils/Mutex.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -637,183 +640,257 @@ static void parseAV1ProfileLevelFromCsd(const sp<ABuffer> &csd, sp<AMessage> &fo
 }
 
 
-static std::vector<std::pair<const char *, uint32_t>> stringMappings {
-    {
-        { "album", kKeyAlbum },
-        { "albumartist", kKeyAlbumArtist },
-        { "artist", kKeyArtist },
-        { "author", kKeyAuthor },
-        { "cdtracknum", kKeyCDTrackNumber },
-        { "compilation", kKeyCompilation },
-        { "composer", kKeyComposer },
-        { "date", kKeyDate },
-        { "discnum", kKeyDiscNumber },
-        { "genre", kKeyGenre },
-        { "location", kKeyLocation },
-        { "lyricist", kKeyWriter },
-        { "manufacturer", kKeyManufacturer },
-        { "title", kKeyTitle },
-        { "year", kKeyYear },
-    }
-};
-
-static std::vector<std::pair<const char *, uint32_t>> floatMappings {
-    {
-        { "capture-rate", kKeyCaptureFramerate },
-    }
-};
-
-static std::vector<std::pair<const char *, uint32_t>> int64Mappings {
-    {
-        { "exif-offset", kKeyExifOffset },
-        { "exif-size", kKeyExifSize },
-        { "target-time", kKeyTargetTime },
-        { "thumbnail-time", kKeyThumbnailTime },
-        { "timeUs", kKeyTime },
-        { "durationUs", kKeyDuration },
-    }
-};
-
-static std::vector<std::pair<const char *, uint32_t>> int32Mappings {
-    {
-        { "loop", kKeyAutoLoop },
-        { "time-scale", kKeyTimeScale },
-        { "crypto-mode", kKeyCryptoMode },
-        { "crypto-default-iv-size", kKeyCryptoDefaultIVSize },
-        { "crypto-encrypted-byte-block", kKeyEncryptedByteBlock },
-        { "crypto-skip-byte-block", kKeySkipByteBlock },
-        { "frame-count", kKeyFrameCount },
-        { "max-bitrate", kKeyMaxBitRate },
-        { "pcm-big-endian", kKeyPcmBigEndian },
-        { "temporal-layer-count", kKeyTemporalLayerCount },
-        { "temporal-layer-id", kKeyTemporalLayerId },
-        { "thumbnail-width", kKeyThumbnailWidth },
-        { "thumbnail-height", kKeyThumbnailHeight },
-        { "valid-samples", kKeyValidSamples },
-    }
+enum MappingType {
+    kMappingString,
+    kMappingFloat,
+    kMappingInt64,
+    kMappingInt32,
+    kMappingBuffer,
+    kMappingCSD,
 };
 
-static std::vector<std::pair<const char *, uint32_t>> bufferMappings {
-    {
-        { "albumart", kKeyAlbumArt },
-        { "audio-presentation-info", kKeyAudioPresentationInfo },
-        { "pssh", kKeyPssh },
-        { "crypto-iv", kKeyCryptoIV },
-        { "crypto-key", kKeyCryptoKey },
-        { "crypto-encrypted-sizes", kKeyEncryptedSizes },
-        { "crypto-plain-sizes", kKeyPlainSizes },
-        { "icc-profile", kKeyIccProfile },
-        { "sei", kKeySEI },
-        { "text-format-data", kKeyTextFormatData },
-        { "thumbnail-csd-hevc", kKeyThumbnailHVCC },
-    }
+struct FormatMapping {
+    const char *mName;
+    uint32_t mKey;
+    MappingType mType;
 };
 
-static std::vector<std::pair<const char *, uint32_t>> CSDMappings {
-    {
-        { "csd-0", kKeyOpaqueCSD0 },
-        { "csd-1", kKeyOpaqueCSD1 },
-        { "csd-2", kKeyOpaqueCSD2 },
-    }
+// Keys that translate one to one between MetaData and AMessage formats.
+static const FormatMapping kFormatMappings[] = {
+    { "album", kKeyAlbum, kMappingString },
+    { "albumartist", kKeyAlbumArtist, kMappingString },
+    { "artist", kKeyArtist, kMappingString },
+    { "author", kKeyAuthor, kMappingString },
+    { "cdtracknum", kKeyCDTrackNumber, kMappingString },
+    { "compilation", kKeyCompilation, kMappingString },
+    { "composer", kKeyComposer, kMappingString },
+    { "date", kKeyDate, kMappingString },
+    { "discnum", kKeyDiscNumber, kMappingString },
+    { "genre", kKeyGenre, kMappingString },
+    { "location", kKeyLocation, kMappingString },
+    { "lyricist", kKeyWriter, kMappingString },
+    { "manufacturer", kKeyManufacturer, kMappingString },
+    { "title", kKeyTitle, kMappingString },
+    { "year", kKeyYear, kMappingString },
+
+    { "capture-rate", kKeyCaptureFramerate, kMappingFloat },
+
+    { "exif-offset", kKeyExifOffset, kMappingInt64 },
+    { "exif-size", kKeyExifSize, kMappingInt64 },
+    { "target-time", kKeyTargetTime, kMappingInt64 },
+    { "thumbnail-time", kKeyThumbnailTime, kMappingInt64 },
+    { "timeUs", kKeyTime, kMappingInt64 },
+    { "durationUs", kKeyDuration, kMappingInt64 },
+
+    { "loop", kKeyAutoLoop, kMappingInt32 },
+    { "time-scale", kKeyTimeScale, kMappingInt32 },
+    { "crypto-mode", kKeyCryptoMode, kMappingInt32 },
+    { "crypto-default-iv-size", kKeyCryptoDefaultIVSize, kMappingInt32 },
+    { "crypto-encrypted-byte-block", kKeyEncryptedByteBlock, kMappingInt32 },
+    { "crypto-skip-byte-block", kKeySkipByteBlock, kMappingInt32 },
+    { "frame-count", kKeyFrameCount, kMappingInt32 },
+    { "max-bitrate", kKeyMaxBitRate, kMappingInt32 },
+    { "pcm-big-endian", kKeyPcmBigEndian, kMappingInt32 },
+    { "temporal-layer-count", kKeyTemporalLayerCount, kMappingInt32 },
+    { "temporal-layer-id", kKeyTemporalLayerId, kMappingInt32 },
+    { "thumbnail-width", kKeyThumbnailWidth, kMappingInt32 },
+    { "thumbnail-height", kKeyThumbnailHeight, kMappingInt32 },
+    { "valid-samples", kKeyValidSamples, kMappingInt32 },
+
+    { "albumart", kKeyAlbumArt, kMappingBuffer },
+    { "audio-presentation-info", kKeyAudioPresentationInfo, kMappingBuffer },
+    { "pssh", kKeyPssh, kMappingBuffer },
+    { "crypto-iv", kKeyCryptoIV, kMappingBuffer },
+    { "crypto-key", kKeyCryptoKey, kMappingBuffer },
+    { "crypto-encrypted-sizes", kKeyEncryptedSizes, kMappingBuffer },
+    { "crypto-plain-sizes", kKeyPlainSizes, kMappingBuffer },
+    { "icc-profile", kKeyIccProfile, kMappingBuffer },
+    { "sei", kKeySEI, kMappingBuffer },
+    { "text-format-data", kKeyTextFormatData, kMappingBuffer },
+    { "thumbnail-csd-hevc", kKeyThumbnailHVCC, kMappingBuffer },
+
+    { "csd-0", kKeyOpaqueCSD0, kMappingCSD },
+    { "csd-1", kKeyOpaqueCSD1, kMappingCSD },
+    { "csd-2", kKeyOpaqueCSD2, kMappingCSD },
 };
 
-void convertMessageToMetaDataFromMappings(const sp<AMessage> &msg, sp<MetaData> &meta) {
-    for (auto elem : stringMappings) {
-        AString value;
-        if (msg->findString(elem.first, &value)) {
-            meta->setCString(elem.second, value.c_str());
-        }
-    }
-
-    for (auto elem : floatMappings) {
-        float value;
-        if (msg->findFloat(elem.first, &value)) {
-            meta->setFloat(elem.second, value);
-        }
-    }
-
-    for (auto elem : int64Mappings) {
-        int64_t value;
-        if (msg->findInt64(elem.first, &value)) {
-            meta->setInt64(elem.second, value);
-        }
-    }
+// The formats have a handful of entries, so look up only those instead of trying
+// every mapping.
+static const std::unordered_map<std::string, const FormatMapping *> &mappingsByName() {
+    static const std::unordered_map<std::string, const FormatMapping *> sMappings = [] {
+        std::unordered_map<std::string, const FormatMapping *> mappings;
+        for (const FormatMapping &mapping : kFormatMappings) {
+            mappings[mapping.mName] = &mapping;
+        }
+        return mappings;
+    }();
+    return sMappings;
+}
 
-    for (auto elem : int32Mappings) {
-        int32_t value;
-        if (msg->findInt32(elem.first, &value)) {
-            meta->setInt32(elem.second, value);
+static const std::unordered_map<uint32_t, const FormatMapping *> &mappingsByKey() {
+    static const std::unordered_map<uint32_t, const FormatMapping *> sMappings = [] {
+        std::unordered_map<uint32_t, const FormatMapping *> mappings;
+        for (const FormatMapping &mapping : kFormatMappings) {
+            mappings[mapping.mKey] = &mapping;
         }
-    }
+        return mappings;
+    }();
+    return sMappings;
+}
 
-    for (auto elem : bufferMappings) {
-        sp<ABuffer> value;
-        if (msg->findBuffer(elem.first, &value)) {
-            meta->setData(elem.second,
-                    MetaDataBase::Type::TYPE_NONE, value->data(), value->size());
+void convertMessageToMetaDataFromMappings(const sp<AMessage> &msg, sp<MetaData> &meta) {
+    const std::unordered_map<std::string, const FormatMapping *> &mappings = mappingsByName();
+    for (size_t i = 0; i < msg->countEntries(); ++i) {
+        AMessage::Type entryType;
+        const char *name = msg->getEntryNameAt(i, &entryType);
+        auto it = mappings.find(name);
+        if (it == mappings.end()) {
+            continue;
         }
-    }
+        const FormatMapping &elem = *it->second;
 
-    for (auto elem : CSDMappings) {
-        sp<ABuffer> value;
-        if (msg->findBuffer(elem.first, &value)) {
-            meta->setData(elem.second,
-                    MetaDataBase::Type::TYPE_NONE, value->data(), value->size());
+        switch (elem.mType) {
+            case kMappingString:
+            {
+                AString value;
+                if (msg->findString(elem.mName, &value)) {
+                    meta->setCString(elem.mKey, value.c_str());
+                }
+                break;
+            }
+            case kMappingFloat:
+            {
+                float value;
+                if (msg->findFloat(elem.mName, &value)) {
+                    meta->setFloat(elem.mKey, value);
+                }
+                break;
+            }
+            case kMappingInt64:
+            {
+                int64_t value;
+                if (msg->findInt64(elem.mName, &value)) {
+                    meta->setInt64(elem.mKey, value);
+                }
+                break;
+            }
+            case kMappingInt32:
+            {
+                int32_t value;
+                if (msg->findInt32(elem.mName, &value)) {
+                    meta->setInt32(elem.mKey, value);
+                }
+                break;
+            }
+            case kMappingBuffer:
+            case kMappingCSD:
+            {
+                sp<ABuffer> value;
+                if (msg->findBuffer(elem.mName, &value)) {
+                    meta->setData(elem.mKey,
+                            MetaDataBase::Type::TYPE_NONE, value->data(), value->size());
+                }
+                break;
+            }
         }
     }
 }
 
 void convertMetaDataToMessageFromMappings(const MetaDataBase *meta, sp<AMessage> format) {
-    for (auto elem : stringMappings) {
-        const char *value;
-        if (meta->findCString(elem.second, &value)) {
-            format->setString(elem.first, value, strlen(value));
+    const std::unordered_map<uint32_t, const FormatMapping *> &mappings = mappingsByKey();
+    for (size_t i = 0; i < meta->countEntries(); ++i) {
+        auto it = mappings.find(meta->getEntryKeyAt(i));
+        if (it == mappings.end()) {
+            continue;
         }
-    }
+        const FormatMapping &elem = *it->second;
 
-    for (auto elem : floatMappings) {
-        float value;
-        if (meta->findFloat(elem.second, &value)) {
-            format->setFloat(elem.first, value);
+        switch (elem.mType) {
+            case kMappingString:
+            {
+                const char *value;
+                if (meta->findCString(elem.mKey, &value)) {
+                    format->setString(elem.mName, value, strlen(value));
+                }
+                break;
+            }
+            case kMappingFloat:
+            {
+                float value;
+                if (meta->findFloat(elem.mKey, &value)) {
+                    format->setFloat(elem.mName, value);
+                }
+                break;
+            }
+            case kMappingInt64:
+            {
+                int64_t value;
+                if (meta->findInt64(elem.mKey, &value)) {
+                    format->setInt64(elem.mName, value);
+                }
+                break;
+            }
+            case kMappingInt32:
+            {
+                int32_t value;
+                if (meta->findInt32(elem.mKey, &value)) {
+                    format->setInt32(elem.mName, value);
+                }
+                break;
+            }
+            case kMappingBuffer:
+            case kMappingCSD:
+            {
+                uint32_t type;
+                const void* data;
+                size_t size;
+                if (meta->findData(elem.mKey, &type, &data, &size)) {
+                    sp<ABuffer> buf = ABuffer::CreateAsCopy(data, size);
+                    if (elem.mType == kMappingCSD) {
+                        buf->meta()->setInt32("csd", true);
+                        buf->meta()->setInt64("timeUs", 0);
+                    }
+                    format->setBuffer(elem.mName, buf);
+                }
+                break;
+            }
         }
     }
+}
 
-    for (auto elem : int64Mappings) {
-        int64_t value;
-        if (meta->findInt64(elem.second, &value)) {
-            format->setInt64(elem.first, value);
+// Returns a copy of |format| that shares nothing the caller could modify.
+static sp<AMessage> copyFormat(const sp<AMessage> &format) {
+    sp<AMessage> copy = format->dup();
+    for (size_t i = 0; i < copy->countEntries(); ++i) {
+        AMessage::Type type;
+        const char *name = copy->getEntryNameAt(i, &type);
+        sp<ABuffer> buffer;
+        if (type != AMessage::kTypeBuffer || !copy->findBuffer(name, &buffer)
+                || buffer == NULL) {
+            continue;
         }
+        sp<ABuffer> bufferCopy = ABuffer::CreateAsCopy(buffer->data(), buffer->size());
+        bufferCopy->meta()->extend(buffer->meta());
+        copy->setBuffer(name, bufferCopy);
     }
+    return copy;
+}
 
-    for (auto elem : int32Mappings) {
-        int32_t value;
-        if (meta->findInt32(elem.second, &value)) {
-            format->setInt32(elem.first, value);
-        }
-    }
+// Track formats are converted again on every format change and codec configuration,
+// so remember the last few results by MetaDataBase::generation().
+static constexpr size_t kFormatCacheSize = 8;
 
-    for (auto elem : bufferMappings) {
-        uint32_t type;
-        const void* data;
-        size_t size;
-        if (meta->findData(elem.second, &type, &data, &size)) {
-            sp<ABuffer> buf = ABuffer::CreateAsCopy(data, size);
-            format->setBuffer(elem.first, buf);
-        }
-    }
+struct CachedFormat {
+    uint64_t mGeneration;
+    sp<AMessage> mFormat;
+};
 
-    for (auto elem : CSDMappings) {
-        uint32_t type;
-        const void* data;
-        size_t size;
-        if (meta->findData(elem.second, &type, &data, &size)) {
-            sp<ABuffer> buf = ABuffer::CreateAsCopy(data, size);
-            buf->meta()->setInt32("csd", true);
-            buf->meta()->setInt64("timeUs", 0);
-            format->setBuffer(elem.first, buf);
-        }
-    }
-}
+static Mutex gFormatCacheLock;
+static CachedFormat gFormatCache[kFormatCacheSize];
+static size_t gNextFormatCacheSlot = 0;
+
+static status_t convertMetaDataToMessageUncached(
+        const MetaDataBase *meta, sp<AMessage> *format);
 
 status_t convertMetaDataToMessage(
         const sp<MetaData> &meta, sp<AMessage> *format) {
@@ -830,6 +907,34 @@ status_t convertMetaDataToMessage(
         return BAD_VALUE;
     }
 
+    const uint64_t generation = meta->generation();
+    {
+        Mutex::Autolock autoLock(gFormatCacheLock);
+        for (const CachedFormat &cached : gFormatCache) {
+            if (cached.mGeneration == generation && cached.mFormat != NULL) {
+                *format = copyFormat(cached.mFormat);
+                return OK;
+            }
+        }
+    }
+
+    status_t err = convertMetaDataToMessageUncached(meta, format);
+    if (err != OK) {
+        return err;
+    }
+
+    sp<AMessage> copy = copyFormat(*format);
+    Mutex::Autolock autoLock(gFormatCacheLock);
+    CachedFormat &slot = gFormatCache[gNextFormatCacheSlot];
+    gNextFormatCacheSlot = (gNextFormatCacheSlot + 1) % kFormatCacheSize;
+    slot.mGeneration = generation;
+    slot.mFormat = copy;
+    return OK;
+}
+
+static status_t convertMetaDataToMessageUncached(
+        const MetaDataBase *meta, sp<AMessage> *format) {
+
     const char *mime;
     if (!meta->findCString(kKeyMIMEType, &mime)) {
         return BAD_VALUE;
@@ -332,6 +332,8 @@ GraphicBufferSource::GraphicBufferSource() :
     mStopTimeUs(-1),
     mLastActionTimeUs(-1LL),
     mSkipFramesBeforeNs(-1LL),
+    mMaxLatencyUs(-1LL),
+    mNumStaleFramesDropped(0),
     mFrameRepeatIntervalUs(-1LL),
     mRepeatLastFrameGeneration(0),
     mOutstandingFrameRepeatCount(0),
@@ -470,6 +472,8 @@ Status GraphicBufferSource::stop() {
         // We are only interested in the transition from executing->idle,
         // not loaded->idle.
         mExecuting = false;
+        ALOGI_IF(mNumStaleFramesDropped > 0, "dropped %lld frames older than %lld us",
+                (long long)mNumStaleFramesDropped, (long long)mMaxLatencyUs);
     }
     return Status::ok();
 }
@@ -608,18 +612,34 @@ bool GraphicBufferSource::fillCodecBuffer_l() {
     }
 
     VideoBuffer item;
-    if (mAvailableBuffers.empty()) {
-        ALOGV("fillCodecBuffer_l: acquiring available buffer, available=%zu+%d",
-                mAvailableBuffers.size(), mNumAvailableUnacquiredBuffers);
-        if (acquireBuffer_l(&item) != OK) {
-            ALOGE("fillCodecBuffer_l: failed to acquire available buffer");
-            return false;
+    while (true) {
+        if (mAvailableBuffers.empty()) {
+            ALOGV("fillCodecBuffer_l: acquiring available buffer, available=%zu+%d",
+                    mAvailableBuffers.size(), mNumAvailableUnacquiredBuffers);
+            if (acquireBuffer_l(&item) != OK) {
+                ALOGE("fillCodecBuffer_l: failed to acquire available buffer");
+                return false;
+            }
+        } else {
+            ALOGV("fillCodecBuffer_l: getting available buffer, available=%zu+%d",
+                    mAvailableBuffers.size(), mNumAvailableUnacquiredBuffers);
+            item = *mAvailableBuffers.begin();
+            mAvailableBuffers.erase(mAvailableBuffers.begin());
         }
-    } else {
-        ALOGV("fillCodecBuffer_l: getting available buffer, available=%zu+%d",
-                mAvailableBuffers.size(), mNumAvailableUnacquiredBuffers);
-        item = *mAvailableBuffers.begin();
-        mAvailableBuffers.erase(mAvailableBuffers.begin());
+
+        // Skip frames that waited longer than the latency budget for a codec buffer, as
+        // long as a newer one is there. The newest frame is always encoded, and the
+        // action queue is applied to it as if the skipped frames had been seen.
+        if (mMaxLatencyUs <= 0 || !haveAvailableBuffers_l()) {
+            break;
+        }
+        int64_t ageUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000 - item.mTimestampNs / 1000;
+        if (ageUs <= mMaxLatencyUs) {
+            break;
+        }
+        ++mNumStaleFramesDropped;
+        ALOGV("fillCodecBuffer_l: dropping frame %lld us old (%lld dropped)",
+                (long long)ageUs, (long long)mNumStaleFramesDropped);
     }
 
     int64_t itemTimeUs = item.mTimestampNs / 1000;
@@ -1296,6 +1316,24 @@ status_t GraphicBufferSource::setMaxFps(float maxFps) {
     return OK;
 }
 
+status_t GraphicBufferSource::setMaxLatencyUs(int64_t maxLatencyUs) {
+    ALOGV("setMaxLatencyUs: maxLatencyUs=%lld", (long long)maxLatencyUs);
+
+    Mutex::Autolock autoLock(mMutex);
+
+    if (mExecuting) {
+        return INVALID_OPERATION;
+    }
+
+    mMaxLatencyUs = maxLatencyUs;
+    return OK;
+}
+
+int64_t GraphicBufferSource::getNumStaleFramesDropped() const {
+    Mutex::Autolock autoLock(mMutex);
+    return mNumStaleFramesDropped;
+}
+
 status_t GraphicBufferSource::setStartTimeUs(int64_t skipFramesBeforeUs) {
     ALOGV("setStartTimeUs: skipFramesBeforeUs=%lld", (long long)skipFramesBeforeUs);
 
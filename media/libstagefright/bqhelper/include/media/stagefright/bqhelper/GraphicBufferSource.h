@@ -65,6 +65,7 @@ class IGraphicBufferConsumer;
  * The source, furthermore, may choose to not encode (drop) frames if:
  *
  * - to throttle the frame rate (keep it under a certain limit)
+ * - to bound the latency (skip frames that waited too long for a codec buffer)
  *
  * Finally the source may optionally hold onto the last non-discarded frame
  * (even if it was dropped) to reencode it after an interval if no further
@@ -176,6 +177,15 @@ public:
      */
     status_t setMaxFps(float maxFps);
 
+    // Sets the latency budget for frames waiting for a codec buffer, when the
+    // encoder falls behind the producer. A frame older than maxLatencyUs (by its
+    // SYSTEM_TIME_MONOTONIC timestamp) is dropped if a newer frame is waiting.
+    // A value <= 0 disables dropping, which is the default.
+    status_t setMaxLatencyUs(int64_t maxLatencyUs);
+
+    // Returns the number of frames dropped for the latency budget.
+    int64_t getNumStaleFramesDropped() const;
+
     // Sets the time lapse (or slow motion) parameters.
     // When set, the sample's timestamp will be modified to playback framerate,
     // and capture timestamp will be modified to capture rate.
@@ -411,6 +421,10 @@ private:
 
     sp<FrameDropper> mFrameDropper;
 
+    // latency budget for frames waiting for a codec buffer (<= 0 if unbounded)
+    int64_t mMaxLatencyUs;
+    int64_t mNumStaleFramesDropped;
+
     sp<ALooper> mLooper;
     sp<AHandlerReflector<GraphicBufferSource> > mReflector;
 
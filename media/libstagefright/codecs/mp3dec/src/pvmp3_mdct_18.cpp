@@ -71,6 +71,10 @@ Returns
 #include "pv_mp3dec_fxd_op.h"
 #include "pvmp3_mdct_18.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -147,8 +151,52 @@ void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window)
     int32 *pt_vec   =  vec;
     int32 *pt_vec_o = &vec[17];
 
+    i = 9;
+
+#if defined(__aarch64__)
+    /*
+     *  the first 8 of the 9 butterflies, 4 at a time. The lanes of the
+     *  vectors read backwards are reversed. Each product is truncated as in
+     *  fxp_mul32_Qxx(), so the result is bit exact with the C code.
+     */
+    for (; i > 4; i -= 4)
+    {
+        int32x4_t a  = vld1q_s32(pt_vec);
+        int32x4_t b  = vld1q_s32(pt_vec_o - 3);
+        int32x4_t c  = vld1q_s32(pt_cos);
+        int32x4_t cx = vld1q_s32(pt_cos_x - 3);
+        int32x4_t cs = vld1q_s32(pt_cos_split);
+        b  = vrev64q_s32(b);
+        b  = vextq_s32(b, b, 2);
+        cx = vrev64q_s32(cx);
+        cx = vextq_s32(cx, cx, 2);
+
+        a = vshlq_n_s32(a, 1);
+        int32x4_t t  = vuzp2q_s32(
+                           vreinterpretq_s32_s64(vmull_s32(vget_low_s32(a), vget_low_s32(c))),
+                           vreinterpretq_s32_s64(vmull_high_s32(a, c)));
+        int32x4_t t1 = vcombine_s32(
+                           vshrn_n_s64(vmull_s32(vget_low_s32(b), vget_low_s32(cx)), 27),
+                           vshrn_n_s64(vmull_high_s32(b, cx), 27));
+        int32x4_t d  = vsubq_s32(t, t1);
+        int32x4_t o  = vcombine_s32(
+                           vshrn_n_s64(vmull_s32(vget_low_s32(d), vget_low_s32(cs)), 28),
+                           vshrn_n_s64(vmull_high_s32(d, cs), 28));
+        o = vrev64q_s32(o);
+        o = vextq_s32(o, o, 2);
+
+        vst1q_s32(pt_vec, vaddq_s32(t, t1));
+        vst1q_s32(pt_vec_o - 3, o);
+
+        pt_vec       += 4;
+        pt_vec_o     -= 4;
+        pt_cos       += 4;
+        pt_cos_x     -= 4;
+        pt_cos_split += 4;
+    }
+#endif
 
-    for (i = 9; i != 0; i--)
+    for (; i != 0; i--)
     {
         tmp  = *(pt_vec);
         tmp1 = *(pt_vec_o);
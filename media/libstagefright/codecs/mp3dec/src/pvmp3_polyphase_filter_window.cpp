@@ -76,6 +76,10 @@ Input
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /*----------------------------------------------------------------------------
 ; MACROS
 ; Define module1 specific macros here
@@ -112,6 +116,94 @@ Input
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(__aarch64__)
+
+/*
+ *  fxp_mul32_Q32() on 4 lanes: the high half of each 64 bit product, so the
+ *  sums below are bit exact with the C code.
+ */
+static inline int32x4_t mul32_Q32_neon(int32x4_t a, int32x4_t b)
+{
+    int32x4_t lo = vreinterpretq_s32_s64(vmull_s32(vget_low_s32(a), vget_low_s32(b)));
+    int32x4_t hi = vreinterpretq_s32_s64(vmull_high_s32(a, b));
+    return vuzp2q_s32(lo, hi);
+}
+
+static inline int32x4_t reverse_neon(int32x4_t a)
+{
+    a = vrev64q_s32(a);
+    return vextq_s32(a, a, 2);
+}
+
+/*
+ *  Computes the outputs of 4 consecutive subbands j0..j0+3 of the loop below,
+ *  one per lane. winPtr points to the 4 x 16 window coefficients of these
+ *  subbands.
+ */
+static inline void polyphase_4_subbands_neon(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels,
+        int32 j0,
+        const int32 *winPtr)
+{
+    /* pt_1[SUBBANDS_NUMBER*n], and pt_2[SUBBANDS_NUMBER*n] reversed */
+    const int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j0];
+    const int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j0 - 3];
+
+    int32x4_t sum1 = vdupq_n_s32(0x00000020);
+    int32x4_t sum2 = vdupq_n_s32(0x00000020);
+
+    for (int32 g = 0; g < 4; g++)
+    {
+        /* transpose the coefficients 4g..4g+3 of the 4 subbands */
+        int32x4_t r0 = vld1q_s32(&winPtr[     4*g]);
+        int32x4_t r1 = vld1q_s32(&winPtr[16 + 4*g]);
+        int32x4_t r2 = vld1q_s32(&winPtr[32 + 4*g]);
+        int32x4_t r3 = vld1q_s32(&winPtr[48 + 4*g]);
+        int64x2_t t0 = vreinterpretq_s64_s32(vtrn1q_s32(r0, r1));
+        int64x2_t t1 = vreinterpretq_s64_s32(vtrn2q_s32(r0, r1));
+        int64x2_t t2 = vreinterpretq_s64_s32(vtrn1q_s32(r2, r3));
+        int64x2_t t3 = vreinterpretq_s64_s32(vtrn2q_s32(r2, r3));
+        int32x4_t w0 = vreinterpretq_s32_s64(vtrn1q_s64(t0, t2));
+        int32x4_t w1 = vreinterpretq_s32_s64(vtrn1q_s64(t1, t3));
+        int32x4_t w2 = vreinterpretq_s32_s64(vtrn2q_s64(t0, t2));
+        int32x4_t w3 = vreinterpretq_s32_s64(vtrn2q_s64(t1, t3));
+
+        int32x4_t temp1 = vld1q_s32(&pt_1[SUBBANDS_NUMBER*(2*g)]);
+        int32x4_t temp3 = reverse_neon(vld1q_s32(&pt_2[SUBBANDS_NUMBER*(15 - 2*g)]));
+        int32x4_t temp2 = reverse_neon(vld1q_s32(&pt_2[SUBBANDS_NUMBER*(2*g + 1)]));
+        int32x4_t temp4 = vld1q_s32(&pt_1[SUBBANDS_NUMBER*(14 - 2*g)]);
+
+        sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp1, w0));
+        sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp3, w0));
+        sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp1, w1));
+        sum1 = vsubq_s32(sum1, mul32_Q32_neon(temp3, w1));
+        sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp2, w2));
+        sum2 = vsubq_s32(sum2, mul32_Q32_neon(temp4, w2));
+        sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp2, w3));
+        sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp4, w3));
+    }
+
+    /* saturate16(sum >> 6) */
+    int16x4_t out1 = vqmovn_s32(vshrq_n_s32(sum1, 6));
+    int16x4_t out2 = vqmovn_s32(vshrq_n_s32(sum2, 6));
+
+    int32 k = j0 << (numChannels - 1);
+    int32 step = 1 << (numChannels - 1);
+    int16 *pt_out1 = &outPcm[k];
+    int16 *pt_out2 = &outPcm[(numChannels<<5) - k];
+    vst1_lane_s16(pt_out1, out1, 0);
+    vst1_lane_s16(pt_out2, out2, 0);
+    vst1_lane_s16(pt_out1 + step, out1, 1);
+    vst1_lane_s16(pt_out2 - step, out2, 1);
+    vst1_lane_s16(pt_out1 + 2*step, out1, 2);
+    vst1_lane_s16(pt_out2 - 2*step, out2, 2);
+    vst1_lane_s16(pt_out1 + 3*step, out1, 3);
+    vst1_lane_s16(pt_out2 - 3*step, out2, 3);
+}
+
+#endif  /* __aarch64__ */
+
 void pvmp3_polyphase_filter_window(int32 *synth_buffer,
                                    int16 *outPcm,
                                    int32 numChannels)
@@ -120,9 +212,18 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     int32 sum2;
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
+    int16 j = 1;
 
+#if defined(__aarch64__)
+    /* subbands 1..12 four at a time, the remaining 3 below */
+    for (; j + 3 < SUBBANDS_NUMBER / 2; j += 4)
+    {
+        polyphase_4_subbands_neon(synth_buffer, outPcm, numChannels, j, winPtr);
+        winPtr += 4 * 16;
+    }
+#endif
 
-    for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
+    for (; j < SUBBANDS_NUMBER / 2; j++)
     {
         sum1 = 0x00000020;
         sum2 = 0x00000020;
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// Decodes each of the given mp3 files without writing the output, and reports how
+// much faster than realtime the decoder runs and the share of one core it needs
+// for realtime playback, per file and over all of them.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "pvmp3decoder_api.h"
+#include "mp3reader.h"
+
+enum {
+    kInputBufferSize = 10 * 1024,
+    kOutputBufferSize = 4608 * 2,
+};
+
+static int64_t threadCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void report(const char *name, double audioSeconds, int64_t cpuNs) {
+    const double cpuSeconds = cpuNs / 1e9;
+    if (cpuSeconds <= 0 || audioSeconds <= 0) {
+        printf("%s: nothing decoded\n", name);
+        return;
+    }
+    printf("%s: %.1f s of audio in %.3f s, %.1fx realtime, %.2f%% of a core\n",
+           name, audioSeconds, cpuSeconds, audioSeconds / cpuSeconds,
+           100.0 * cpuSeconds / audioSeconds);
+}
+
+// Returns false on a decoding error.
+static bool decodeFile(const char *path, void *decoderBuf, uint8_t *inputBuf,
+                       int16_t *outputBuf, double *audioSeconds, int64_t *cpuNs) {
+    *audioSeconds = 0;
+    *cpuNs = 0;
+
+    Mp3Reader mp3Reader;
+    if (!mp3Reader.init(path)) {
+        fprintf(stderr, "Encountered error reading %s\n", path);
+        return false;
+    }
+
+    tPVMP3DecoderExternal config;
+    config.equalizerType = flat;
+    config.crcEnabled = false;
+    pvmp3_InitDecoder(&config, decoderBuf);
+
+    uint64_t frames = 0;
+    bool ok = true;
+    while (1) {
+        uint32_t bytesRead;
+        if (!mp3Reader.getFrame(inputBuf, &bytesRead)) break;
+
+        config.inputBufferCurrentLength = bytesRead;
+        config.inputBufferMaxLength = 0;
+        config.inputBufferUsedLength = 0;
+        config.pInputBuffer = inputBuf;
+        config.pOutputBuffer = outputBuf;
+        config.outputFrameSize = kOutputBufferSize / sizeof(int16_t);
+
+        const int64_t startNs = threadCpuTimeNs();
+        ERROR_CODE decoderErr = pvmp3_framedecoder(&config, decoderBuf);
+        *cpuNs += threadCpuTimeNs() - startNs;
+        if (decoderErr != NO_DECODING_ERROR) {
+            fprintf(stderr, "Decoder encountered error in %s\n", path);
+            ok = false;
+            break;
+        }
+        frames += config.outputFrameSize / mp3Reader.getNumChannels();
+    }
+    *audioSeconds = (double)frames / mp3Reader.getSampleRate();
+    mp3Reader.close();
+    return ok;
+}
+
+int main(int argc, const char **argv) {
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage %s <input file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    void *decoderBuf = malloc(pvmp3_decoderMemRequirements());
+    assert(decoderBuf != NULL);
+    uint8_t *inputBuf = static_cast<uint8_t*>(malloc(kInputBufferSize));
+    assert(inputBuf != NULL);
+    int16_t *outputBuf = static_cast<int16_t*>(malloc(kOutputBufferSize));
+    assert(outputBuf != NULL);
+
+    int retVal = EXIT_SUCCESS;
+    double totalAudioSeconds = 0;
+    int64_t totalCpuNs = 0;
+    for (int i = 1; i < argc; ++i) {
+        double audioSeconds;
+        int64_t cpuNs;
+        if (!decodeFile(argv[i], decoderBuf, inputBuf, outputBuf, &audioSeconds, &cpuNs)) {
+            retVal = EXIT_FAILURE;
+        }
+        report(argv[i], audioSeconds, cpuNs);
+        totalAudioSeconds += audioSeconds;
+        totalCpuNs += cpuNs;
+    }
+    if (argc > 2) {
+        report("total", totalAudioSeconds, totalCpuNs);
+    }
+
+    free(inputBuf);
+    free(outputBuf);
+    free(decoderBuf);
+
+    return retVal;
+}
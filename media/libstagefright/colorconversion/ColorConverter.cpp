@@ -26,10 +26,14 @@
 #include <media/stagefright/MediaErrors.h>
 
 #include "libyuv/convert_from.h"
+#include "libyuv/convert_from_argb.h"
 #include "libyuv/convert_argb.h"
 #include "libyuv/planar_functions.h"
 #include "libyuv/video_common.h"
+#include <algorithm>
 #include <functional>
+#include <thread>
+#include <vector>
 #include <sys/time.h>
 
 #define USE_LIBYUV
@@ -48,6 +52,13 @@
 
 namespace android {
 
+// rows converted to ARGB at a time by convertViaARGB(); even, for the 4:2:0 sources
+static const size_t kARGBBandRows = 16;
+
+// smallest frame and band converted on several threads, see setNumThreads()
+static const size_t kMinPixelsForThreads = 1920 * 1080;
+static const size_t kMinBandRows = 64;
+
 static bool isRGB(OMX_COLOR_FORMATTYPE colorFormat) {
     return colorFormat == OMX_COLOR_Format16bitRGB565
             || colorFormat == OMX_COLOR_Format32BitRGBA8888
@@ -70,7 +81,8 @@ ColorConverter::ColorConverter(
     : mSrcFormat(from),
       mDstFormat(to),
       mSrcColorSpace({0, 0, 0}),
-      mClip(NULL) {
+      mClip(NULL),
+      mNumThreads(1) {
 }
 
 ColorConverter::~ColorConverter() {
@@ -92,17 +104,18 @@ bool ColorConverter::isValid() const {
 
         case OMX_COLOR_FormatCbYCrY:
         case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
-        case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
-            return mDstFormat == OMX_COLOR_Format16bitRGB565;
-
         case OMX_COLOR_FormatYUV420SemiPlanar:
 #ifdef USE_LIBYUV
             return mDstFormat == OMX_COLOR_Format16bitRGB565
-                    || mDstFormat == OMX_COLOR_Format32BitRGBA8888;
+                    || mDstFormat == OMX_COLOR_Format32BitRGBA8888
+                    || mDstFormat == OMX_COLOR_Format32bitBGRA8888;
 #else
             return mDstFormat == OMX_COLOR_Format16bitRGB565;
 #endif
 
+        case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
+            return mDstFormat == OMX_COLOR_Format16bitRGB565;
+
         default:
             return false;
     }
@@ -123,6 +136,10 @@ void ColorConverter::setSrcColorSpace(
     mSrcColorSpace.mTransfer = transfer;
 }
 
+void ColorConverter::setNumThreads(size_t numThreads) {
+    mNumThreads = numThreads > 0 ? numThreads : 1;
+}
+
 /*
  * If stride is non-zero, client's stride will be used. For planar
  * or semi-planar YUV formats, stride must be even numbers.
@@ -211,6 +228,59 @@ status_t ColorConverter::convert(
         return ERROR_UNSUPPORTED;
     }
 
+    // Only split frames large enough to make up for starting the threads, and keep bands
+    // an even number of rows for the 4:2:0 sources.
+    size_t numBands = std::min(mNumThreads, src.cropHeight() / kMinBandRows);
+    if (src.cropWidth() * src.cropHeight() < kMinPixelsForThreads
+            // its chroma offset depends on the crop in a way that does not split
+            || mSrcFormat == OMX_TI_COLOR_FormatYUV420PackedSemiPlanar) {
+        numBands = 1;
+    }
+    if (numBands > 1) {
+        return convertInBands(src, dst, numBands);
+    }
+    return convertBitmap(src, dst);
+}
+
+status_t ColorConverter::convertInBands(
+        const BitmapParams &src, const BitmapParams &dst, size_t numBands) {
+    const size_t height = src.cropHeight();
+    std::vector<status_t> results(numBands, OK);
+    std::vector<std::thread> threads;
+
+    auto convertBand = [this, &src, &dst, &results, height, numBands](size_t band) {
+        const size_t top = (height * band / numBands) & ~1;
+        const size_t bottom = band + 1 == numBands ? height : (height * (band + 1) / numBands) & ~1;
+
+        BitmapParams bandSrc = src;
+        bandSrc.mCropTop = src.mCropTop + top;
+        bandSrc.mCropBottom = src.mCropTop + bottom - 1;
+        BitmapParams bandDst = dst;
+        bandDst.mCropTop = dst.mCropTop + top;
+        bandDst.mCropBottom = dst.mCropTop + bottom - 1;
+
+        ColorConverter converter(mSrcFormat, mDstFormat);
+        converter.mSrcColorSpace = mSrcColorSpace;
+        results[band] = converter.convertBitmap(bandSrc, bandDst);
+    };
+
+    for (size_t band = 1; band < numBands; ++band) {
+        threads.emplace_back(convertBand, band);
+    }
+    convertBand(0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (status_t err : results) {
+        if (err != OK) {
+            return err;
+        }
+    }
+    return OK;
+}
+
+status_t ColorConverter::convertBitmap(const BitmapParams &src, const BitmapParams &dst) {
     status_t err;
 
     switch (mSrcFormat) {
@@ -227,7 +297,15 @@ status_t ColorConverter::convert(
 #if PERF_PROFILING
             int64_t startTimeUs = ALooper::GetNowUs();
 #endif
+#ifdef USE_LIBYUV
+            if (isRGB(mDstFormat)) {
+                err = convertYUV420Planar16UseLibYUV(src, dst);
+            } else {
+                err = convertYUV420Planar16(src, dst);
+            }
+#else
             err = convertYUV420Planar16(src, dst);
+#endif
 #if PERF_PROFILING
             int64_t endTimeUs = ALooper::GetNowUs();
             ALOGD("convertYUV420Planar16 took %lld us", (long long) (endTimeUs - startTimeUs));
@@ -236,11 +314,19 @@ status_t ColorConverter::convert(
         }
 
         case OMX_COLOR_FormatCbYCrY:
+#ifdef USE_LIBYUV
+            err = convertCbYCrYUseLibYUV(src, dst);
+#else
             err = convertCbYCrY(src, dst);
+#endif
             break;
 
         case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
+#ifdef USE_LIBYUV
+            err = convertYVU420SemiPlanarUseLibYUV(src, dst);
+#else
             err = convertQCOMYUV420SemiPlanar(src, dst);
+#endif
             break;
 
         case OMX_COLOR_FormatYUV420SemiPlanar:
@@ -412,6 +498,107 @@ status_t ColorConverter::convertYUV420SemiPlanarUseLibYUV(
    return OK;
 }
 
+status_t ColorConverter::convertViaARGB(
+        const BitmapParams &src, const BitmapParams &dst, const ToARGB &toARGB) {
+    uint8_t *dst_ptr = (uint8_t *)dst.mBits
+        + dst.mCropTop * dst.mStride + dst.mCropLeft * dst.mBpp;
+
+    const size_t width = src.cropWidth();
+    const size_t height = src.cropHeight();
+
+    if (mDstFormat == OMX_COLOR_Format32bitBGRA8888) {
+        return toARGB(0, height, dst_ptr, dst.mStride) == 0 ? OK : ERROR_UNSUPPORTED;
+    }
+
+    const size_t argbStride = width * 4;
+    mARGBRows.resize(argbStride * kARGBBandRows);
+    for (size_t row = 0; row < height; row += kARGBBandRows) {
+        const size_t rows = std::min(kARGBBandRows, height - row);
+        if (toARGB(row, rows, mARGBRows.data(), argbStride) != 0) {
+            return ERROR_UNSUPPORTED;
+        }
+
+        uint8_t *rows_ptr = dst_ptr + row * dst.mStride;
+        int res;
+        switch (mDstFormat) {
+        case OMX_COLOR_Format16bitRGB565:
+            res = libyuv::ARGBToRGB565(mARGBRows.data(), argbStride, (uint8 *)rows_ptr,
+                    dst.mStride, width, rows);
+            break;
+
+        case OMX_COLOR_Format32BitRGBA8888:
+            res = libyuv::ARGBToABGR(mARGBRows.data(), argbStride, (uint8 *)rows_ptr,
+                    dst.mStride, width, rows);
+            break;
+
+        default:
+            return ERROR_UNSUPPORTED;
+        }
+        if (res != 0) {
+            return ERROR_UNSUPPORTED;
+        }
+    }
+
+    return OK;
+}
+
+status_t ColorConverter::convertCbYCrYUseLibYUV(
+        const BitmapParams &src, const BitmapParams &dst) {
+    const uint8_t *src_ptr = (const uint8_t *)src.mBits
+        + src.mCropTop * src.mStride + src.mCropLeft * src.mBpp;
+
+    return convertViaARGB(src, dst,
+            [&src, src_ptr](size_t row, size_t rows, uint8_t *argb, int argbStride) {
+        return libyuv::UYVYToARGB(src_ptr + row * src.mStride, src.mStride,
+                (uint8 *)argb, argbStride, src.cropWidth(), rows);
+    });
+}
+
+status_t ColorConverter::convertYVU420SemiPlanarUseLibYUV(
+        const BitmapParams &src, const BitmapParams &dst) {
+    const uint8_t *src_y =
+        (const uint8_t *)src.mBits + src.mCropTop * src.mStride + src.mCropLeft;
+
+    const uint8_t *src_vu =
+        (const uint8_t *)src.mBits + src.mStride * src.mHeight
+        + (src.mCropTop / 2) * src.mStride + src.mCropLeft;
+
+    return convertViaARGB(src, dst,
+            [&src, src_y, src_vu](size_t row, size_t rows, uint8_t *argb, int argbStride) {
+        return libyuv::NV21ToARGB(src_y + row * src.mStride, src.mStride,
+                src_vu + (row / 2) * src.mStride, src.mStride,
+                (uint8 *)argb, argbStride, src.cropWidth(), rows);
+    });
+}
+
+status_t ColorConverter::convertYUV420Planar16UseLibYUV(
+        const BitmapParams &src, const BitmapParams &dst) {
+    // strides in samples
+    const size_t stride_y = src.mStride / 2;
+    const size_t stride_uv = src.mStride / 4;
+
+    const uint16_t *src_y = (const uint16_t *)src.mBits
+        + src.mCropTop * stride_y + src.mCropLeft;
+
+    const uint16_t *src_u = (const uint16_t *)src.mBits + stride_y * src.mHeight
+        + (src.mCropTop / 2) * stride_uv + src.mCropLeft / 2;
+
+    const uint16_t *src_v = src_u + stride_uv * (src.mHeight / 2);
+
+    int (*toARGB)(const uint16_t *, int, const uint16_t *, int, const uint16_t *, int,
+            uint8 *, int, int, int) =
+        mSrcColorSpace.isBt709() ? libyuv::H010ToARGB : libyuv::I010ToARGB;
+
+    return convertViaARGB(src, dst,
+            [&src, toARGB, src_y, src_u, src_v, stride_y, stride_uv](
+                    size_t row, size_t rows, uint8_t *argb, int argbStride) {
+        return toARGB(src_y + row * stride_y, stride_y,
+                src_u + (row / 2) * stride_uv, stride_uv,
+                src_v + (row / 2) * stride_uv, stride_uv,
+                (uint8 *)argb, argbStride, src.cropWidth(), rows);
+    });
+}
+
 std::function<void (void *, void *, void *, size_t,
                     signed *, signed *, signed *, signed *)>
 getReadFromSrc(OMX_COLOR_FORMATTYPE srcFormat) {
@@ -36,6 +36,25 @@ static int ALIGN(int x, int y) {
     return (x + y - 1) & ~(y - 1);
 }
 
+// Copies |height| rows of |width| bytes. Rows the same distance apart on both
+// sides, including the padding between them, are copied at once.
+static void copyPlane(
+        uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride,
+        size_t width, size_t height) {
+    if (height == 0) {
+        return;
+    }
+    if (dstStride == srcStride) {
+        memcpy(dst, src, srcStride * (height - 1) + width);
+        return;
+    }
+    for (size_t y = 0; y < height; ++y) {
+        memcpy(dst, src, width);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 SoftwareRenderer::SoftwareRenderer(
         const sp<ANativeWindow> &nativeWindow, int32_t rotation)
     : mColorFormat(OMX_COLOR_FormatUnused),
@@ -96,6 +115,7 @@ void SoftwareRenderer::resetFormatIfChanged(
     if (static_cast<int32_t>(mColorFormat) == colorFormatNew &&
         mWidth == widthNew &&
         mHeight == heightNew &&
+        mStride == strideNew &&
         mCropLeft == cropLeftNew &&
         mCropTop == cropTopNew &&
         mCropRight == cropRightNew &&
@@ -126,6 +146,19 @@ void SoftwareRenderer::resetFormatIfChanged(
     {
         switch (mColorFormat) {
             case OMX_COLOR_FormatYUV420Planar:
+            {
+                halFormat = HAL_PIXEL_FORMAT_YV12;
+                bufWidth = (mCropWidth + 1) & ~1;
+                bufHeight = (mCropHeight + 1) & ~1;
+                // YV12 aligns the luma stride to 16 and the chroma stride to
+                // 16 as well. A decoder stride aligned to 32 fits both, so
+                // ask for a buffer that wide and render each plane with a
+                // single copy. The crop keeps the padding out of view.
+                if (mStride % 32 == 0 && (size_t)mStride >= bufWidth) {
+                    bufWidth = mStride;
+                }
+                break;
+            }
             case OMX_COLOR_FormatYUV420SemiPlanar:
             case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
             {
@@ -300,22 +333,11 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         dst_v += (mCropTop/2) * dst_c_stride + mCropLeft/2;
         dst_u += (mCropTop/2) * dst_c_stride + mCropLeft/2;
 
-        for (int y = 0; y < mCropHeight; ++y) {
-            memcpy(dst_y, src_y, mCropWidth);
-
-            src_y += mStride;
-            dst_y += buf->stride;
-        }
-
-        for (int y = 0; y < (mCropHeight + 1) / 2; ++y) {
-            memcpy(dst_u, src_u, (mCropWidth + 1) / 2);
-            memcpy(dst_v, src_v, (mCropWidth + 1) / 2);
-
-            src_u += mStride / 2;
-            src_v += mStride / 2;
-            dst_u += dst_c_stride;
-            dst_v += dst_c_stride;
-        }
+        copyPlane(dst_y, buf->stride, src_y, mStride, mCropWidth, mCropHeight);
+        copyPlane(dst_u, dst_c_stride, src_u, mStride / 2,
+                (mCropWidth + 1) / 2, (mCropHeight + 1) / 2);
+        copyPlane(dst_v, dst_c_stride, src_v, mStride / 2,
+                (mCropWidth + 1) / 2, (mCropHeight + 1) / 2);
     } else if (mColorFormat == OMX_COLOR_FormatYUV420Planar16) {
         const uint8_t *src_y = (const uint8_t *)data + mCropTop * mStride + mCropLeft * 2;
         const uint8_t *src_u = (const uint8_t *)data + mStride * mHeight + mCropTop * mStride / 4;
@@ -373,12 +395,7 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         dst_v += (mCropTop/2) * dst_c_stride + mCropLeft/2;
         dst_u += (mCropTop/2) * dst_c_stride + mCropLeft/2;
 
-        for (int y = 0; y < mCropHeight; ++y) {
-            memcpy(dst_y, src_y, mCropWidth);
-
-            src_y += mWidth;
-            dst_y += buf->stride;
-        }
+        copyPlane(dst_y, buf->stride, src_y, mWidth, mCropWidth, mCropHeight);
 
         for (int y = 0; y < (mCropHeight + 1) / 2; ++y) {
             size_t tmp = (mCropWidth + 1) / 2;
@@ -395,11 +412,7 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         uint8_t* srcPtr = (uint8_t*)data + mWidth * mCropTop * 3 + mCropLeft * 3;
         uint8_t* dstPtr = (uint8_t*)dst + buf->stride * mCropTop * 3 + mCropLeft * 3;
 
-        for (size_t y = 0; y < (size_t)mCropHeight; ++y) {
-            memcpy(dstPtr, srcPtr, mCropWidth * 3);
-            srcPtr += mWidth * 3;
-            dstPtr += buf->stride * 3;
-        }
+        copyPlane(dstPtr, buf->stride * 3, srcPtr, mWidth * 3, mCropWidth * 3, mCropHeight);
     } else if (mColorFormat == OMX_COLOR_Format32bitARGB8888) {
         uint8_t *srcPtr, *dstPtr;
 
@@ -418,11 +431,7 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         uint8_t* srcPtr = (uint8_t*)data + mWidth * mCropTop * 4 + mCropLeft * 4;
         uint8_t* dstPtr = (uint8_t*)dst + buf->stride * mCropTop * 4 + mCropLeft * 4;
 
-        for (size_t y = 0; y < (size_t)mCropHeight; ++y) {
-            memcpy(dstPtr, srcPtr, mCropWidth * 4);
-            srcPtr += mWidth * 4;
-            dstPtr += buf->stride * 4;
-        }
+        copyPlane(dstPtr, buf->stride * 4, srcPtr, mWidth * 4, mCropWidth * 4, mCropHeight);
     } else {
         LOG_ALWAYS_FATAL("bad color format %#x", mColorFormat);
     }
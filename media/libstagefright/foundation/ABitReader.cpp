@@ -37,9 +37,20 @@ bool ABitReader::fillReservoir() {
         return false;
     }
 
+    if (mSize >= sizeof(mReservoir)) {
+        mReservoir = 0;
+        for (size_t i = 0; i < sizeof(mReservoir); ++i) {
+            mReservoir = (mReservoir << 8) | mData[i];
+        }
+        mData += sizeof(mReservoir);
+        mSize -= sizeof(mReservoir);
+        mNumBitsLeft = 8 * sizeof(mReservoir);
+        return true;
+    }
+
     mReservoir = 0;
     size_t i;
-    for (i = 0; mSize > 0 && i < 4; ++i) {
+    for (i = 0; mSize > 0; ++i) {
         mReservoir = (mReservoir << 8) | *mData;
 
         ++mData;
@@ -47,7 +58,7 @@ bool ABitReader::fillReservoir() {
     }
 
     mNumBitsLeft = 8 * i;
-    mReservoir <<= 32 - mNumBitsLeft;
+    mReservoir <<= 64 - mNumBitsLeft;
     return true;
 }
 
@@ -68,7 +79,8 @@ bool ABitReader::getBitsGraceful(size_t n, uint32_t *out) {
         return false;
     }
 
-    uint32_t result = 0;
+    // n may be 32, so accumulate in 64 bits to keep the shift defined.
+    uint64_t result = 0;
     while (n > 0) {
         if (mNumBitsLeft == 0) {
             if (!fillReservoir()) {
@@ -81,14 +93,14 @@ bool ABitReader::getBitsGraceful(size_t n, uint32_t *out) {
             m = mNumBitsLeft;
         }
 
-        result = (result << m) | (mReservoir >> (32 - m));
+        result = (result << m) | (mReservoir >> (64 - m));
         mReservoir <<= m;
         mNumBitsLeft -= m;
 
         n -= m;
     }
 
-    *out = result;
+    *out = (uint32_t)result;
     return true;
 }
 
@@ -113,14 +125,17 @@ void ABitReader::putBits(uint32_t x, size_t n) {
     }
 
     CHECK_LE(n, 32u);
+    if (n == 0) {
+        return;
+    }
 
-    while (mNumBitsLeft + n > 32) {
+    while (mNumBitsLeft + n > 64) {
         mNumBitsLeft -= 8;
         --mData;
         ++mSize;
     }
 
-    mReservoir = (mReservoir >> n) | (x << (32 - n));
+    mReservoir = (mReservoir >> n) | ((uint64_t)x << (64 - n));
     mNumBitsLeft += n;
 }
 
@@ -176,6 +191,8 @@ bool NALBitReader::fillReservoir() {
     }
 
     mReservoir = 0;
+    // Four bytes at a time as before, so that emulation prevention bytes are consumed,
+    // and counted by numBitsLeft(), at the same positions.
     size_t i = 0;
     while (mSize > 0 && i < 4) {
         bool isEmulationPreventionByte = (mNumZeros >= 2 && *mData == 3);
@@ -197,7 +214,9 @@ bool NALBitReader::fillReservoir() {
     }
 
     mNumBitsLeft = 8 * i;
-    mReservoir <<= 32 - mNumBitsLeft;
+    if (i > 0) { // all remaining bytes may have been emulation prevention bytes
+        mReservoir <<= 64 - mNumBitsLeft;
+    }
     return true;
 }
 
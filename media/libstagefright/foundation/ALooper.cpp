@@ -23,9 +23,12 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
+
 #include "ALooper.h"
 
 #include "AHandler.h"
+#include "ALooperGroup.h"
 #include "ALooperRoster.h"
 #include "AMessage.h"
 
@@ -70,7 +73,12 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mNextEventSeq(0),
+      mMaxQueueDepth(0),
+      mDispatchCount(0),
+      mTotalDispatchLatencyUs(0),
+      mMaxDispatchLatencyUs(0),
+      mRunningLocally(false) {
     // clean up stale AHandlers. Doing it here instead of in the destructor avoids
     // the side effect of objects being deleted from the unregister function recursively.
     gLooperRoster.unregisterStaleHandlers();
@@ -99,7 +107,7 @@ status_t ALooper::start(
         {
             Mutex::Autolock autoLock(mLock);
 
-            if (mThread != NULL || mRunningLocally) {
+            if (isRunning_l()) {
                 return INVALID_OPERATION;
             }
 
@@ -114,7 +122,7 @@ status_t ALooper::start(
 
     Mutex::Autolock autoLock(mLock);
 
-    if (mThread != NULL || mRunningLocally) {
+    if (isRunning_l()) {
         return INVALID_OPERATION;
     }
 
@@ -129,17 +137,46 @@ status_t ALooper::start(
     return err;
 }
 
+status_t ALooper::start(const sp<ALooperGroup> &group) {
+    if (group == NULL) {
+        return BAD_VALUE;
+    }
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        if (isRunning_l()) {
+            return INVALID_OPERATION;
+        }
+        mGroup = group;
+    }
+    // not under mLock, as the group locks itself before the loopers.
+    group->addLooper(this);
+    return OK;
+}
+
 status_t ALooper::stop() {
     sp<LooperThread> thread;
     bool runningLocally;
+    sp<ALooperGroup> group;
 
     {
         Mutex::Autolock autoLock(mLock);
 
         thread = mThread;
         runningLocally = mRunningLocally;
+        group = mGroup;
         mThread.clear();
         mRunningLocally = false;
+        mGroup.clear();
+    }
+
+    if (group != NULL) {
+        group->removeLooper(this);
+        {
+            Mutex::Autolock autoLock(mRepliesLock);
+            mRepliesCondition.broadcast();
+        }
+        return OK;
     }
 
     if (thread == NULL && !runningLocally) {
@@ -166,31 +203,73 @@ status_t ALooper::stop() {
 }
 
 void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
-    Mutex::Autolock autoLock(mLock);
+    sp<ALooperGroup> group;
+    {
+        Mutex::Autolock autoLock(mLock);
 
-    int64_t whenUs;
-    if (delayUs > 0) {
-        int64_t nowUs = GetNowUs();
-        whenUs = (delayUs > INT64_MAX - nowUs ? INT64_MAX : nowUs + delayUs);
+        int64_t whenUs;
+        if (delayUs > 0) {
+            int64_t nowUs = GetNowUs();
+            whenUs = (delayUs > INT64_MAX - nowUs ? INT64_MAX : nowUs + delayUs);
 
-    } else {
-        whenUs = GetNowUs();
-    }
+        } else {
+            whenUs = GetNowUs();
+        }
+
+        Event event;
+        event.mWhenUs = whenUs;
+        event.mSeq = mNextEventSeq++;
+        event.mMessage = msg;
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
+        mEventQueue.push_back(event);
+        std::push_heap(mEventQueue.begin(), mEventQueue.end());
+
+        if (mEventQueue.front().mSeq == event.mSeq) {
+            mQueueChangedCondition.signal();
+            group = mGroup;
+        }
+        if (mEventQueue.size() > mMaxQueueDepth) {
+            mMaxQueueDepth = mEventQueue.size();
+        }
     }
 
-    Event event;
-    event.mWhenUs = whenUs;
-    event.mMessage = msg;
+    // the group locks itself before the loopers, so wake it after releasing mLock.
+    if (group != NULL) {
+        group->wake();
+    }
+}
 
-    if (it == mEventQueue.begin()) {
-        mQueueChangedCondition.signal();
+bool ALooper::dequeueDueEvent_l(int64_t nowUs, Event *event) {
+    if (mEventQueue.empty() || mEventQueue.front().mWhenUs > nowUs) {
+        return false;
     }
+    const int64_t latencyUs = nowUs - mEventQueue.front().mWhenUs;
+    std::pop_heap(mEventQueue.begin(), mEventQueue.end());
+    *event = mEventQueue.back();
+    mEventQueue.pop_back();
+
+    ++mDispatchCount;
+    mTotalDispatchLatencyUs += latencyUs;
+    if (latencyUs > mMaxDispatchLatencyUs) {
+        mMaxDispatchLatencyUs = latencyUs;
+    }
+    return true;
+}
+
+int64_t ALooper::getNextEventTimeUs() {
+    Mutex::Autolock autoLock(mLock);
+    return mEventQueue.empty() ? INT64_MAX : mEventQueue.front().mWhenUs;
+}
 
-    mEventQueue.insert(it, event);
+void ALooper::deliverNextEvent() {
+    Event event;
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mGroup == NULL || !dequeueDueEvent_l(GetNowUs(), &event)) {
+            return;
+        }
+    }
+    event.mMessage->deliver();
 }
 
 bool ALooper::loop() {
@@ -205,7 +284,7 @@ bool ALooper::loop() {
             mQueueChangedCondition.wait(mLock);
             return true;
         }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
+        int64_t whenUs = mEventQueue.front().mWhenUs;
         int64_t nowUs = GetNowUs();
 
         if (whenUs > nowUs) {
@@ -218,8 +297,7 @@ bool ALooper::loop() {
             return true;
         }
 
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
+        dequeueDueEvent_l(nowUs, &event);
     }
 
     event.mMessage->deliver();
@@ -232,6 +310,21 @@ bool ALooper::loop() {
     return true;
 }
 
+void ALooper::dumpStats(AString *s, bool clear) {
+    Mutex::Autolock autoLock(mLock);
+    s->append(AStringPrintf(
+            "queued %zu (max %zu), dispatched %lld, latency avg %lld us max %lld us",
+            mEventQueue.size(), mMaxQueueDepth, (long long)mDispatchCount,
+            (long long)(mDispatchCount > 0 ? mTotalDispatchLatencyUs / mDispatchCount : 0),
+            (long long)mMaxDispatchLatencyUs));
+    if (clear) {
+        mMaxQueueDepth = mEventQueue.size();
+        mDispatchCount = 0;
+        mTotalDispatchLatencyUs = 0;
+        mMaxDispatchLatencyUs = 0;
+    }
+}
+
 // to be called by AMessage::postAndAwaitResponse only
 sp<AReplyToken> ALooper::createReplyToken() {
     return new AReplyToken(this);
@@ -245,7 +338,7 @@ status_t ALooper::awaitResponse(const sp<AReplyToken> &replyToken, sp<AMessage>
     while (!replyToken->retrieveReply(response)) {
         {
             Mutex::Autolock autoLock(mLock);
-            if (mThread == NULL) {
+            if (mThread == NULL && mGroup == NULL) {
                 return -ENOENT;
             }
         }
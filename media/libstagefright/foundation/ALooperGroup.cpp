@@ -0,0 +1,217 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooperGroup"
+
+#include <media/stagefright/foundation/ADebug.h>
+
+#include <unistd.h>
+
+#include <utils/Log.h>
+
+#include "ALooper.h"
+#include "ALooperGroup.h"
+
+namespace android {
+
+struct ALooperGroup::WorkerThread : public Thread {
+    explicit WorkerThread(ALooperGroup *group)
+        : Thread(false /* canCallJava */),
+          mGroup(group) {
+    }
+
+    virtual bool threadLoop() {
+        return mGroup->workerLoop();
+    }
+
+protected:
+    virtual ~WorkerThread() {}
+
+private:
+    ALooperGroup *mGroup;
+
+    DISALLOW_EVIL_CONSTRUCTORS(WorkerThread);
+};
+
+ALooperGroup::ALooperGroup(const char *name, size_t numThreads, int32_t priority)
+    : mName(name),
+      mNumThreads(numThreads > 0 ? numThreads : 1),
+      mPriority(priority),
+      mNextLooper(0),
+      mStopping(false) {
+}
+
+ALooperGroup::~ALooperGroup() {
+    stop();
+}
+
+status_t ALooperGroup::start() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (!mThreads.empty()) {
+        return INVALID_OPERATION;
+    }
+    mStopping = false;
+
+    for (size_t i = 0; i < mNumThreads; ++i) {
+        sp<WorkerThread> thread = new WorkerThread(this);
+        status_t err = thread->run(
+                AStringPrintf("%s.%zu", mName.c_str(), i).c_str(), mPriority);
+        if (err != OK) {
+            ALOGE("could not start worker %zu of %s: %d", i, mName.c_str(), err);
+            if (i > 0) {
+                break; // run with fewer threads
+            }
+            return err;
+        }
+        mThreads.push_back(thread);
+    }
+    return OK;
+}
+
+status_t ALooperGroup::stop() {
+    Vector<sp<WorkerThread> > threads;
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mThreads.empty()) {
+            return INVALID_OPERATION;
+        }
+        threads = mThreads;
+        mThreads.clear();
+        mStopping = true;
+        mCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->requestExit();
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        // a worker stopping the group from a handler cannot wait for itself.
+        if (threads[i]->getTid() != gettid()) {
+            threads[i]->requestExitAndWait();
+        }
+    }
+    return OK;
+}
+
+void ALooperGroup::addLooper(const sp<ALooper> &looper) {
+    Mutex::Autolock autoLock(mLock);
+    LooperInfo info;
+    info.mLooper = looper;
+    info.mLooperPtr = looper.get();
+    info.mWorkerId = NULL;
+    mLoopers.push_back(info);
+    mCondition.signal();
+}
+
+void ALooperGroup::removeLooper(ALooper *looper) {
+    Mutex::Autolock autoLock(mLock);
+    const android_thread_id_t self = androidGetThreadId();
+    for (size_t i = 0; i < mLoopers.size(); ++i) {
+        if (mLoopers[i].mLooperPtr != looper) {
+            continue;
+        }
+        // wait for a message being delivered on another worker, so that no message of
+        // this looper is delivered after stop() returns.
+        while (i < mLoopers.size() && mLoopers[i].mLooperPtr == looper
+                && mLoopers[i].mWorkerId != NULL && mLoopers[i].mWorkerId != self) {
+            mCondition.wait(mLock);
+            i = 0;
+            while (i < mLoopers.size() && mLoopers[i].mLooperPtr != looper) {
+                ++i;
+            }
+        }
+        if (i < mLoopers.size()) {
+            mLoopers.removeAt(i);
+        }
+        return;
+    }
+}
+
+void ALooperGroup::wake() {
+    Mutex::Autolock autoLock(mLock);
+    mCondition.signal();
+}
+
+bool ALooperGroup::workerLoop() {
+    sp<ALooper> looper;
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mStopping) {
+            return false;
+        }
+
+        const size_t n = mLoopers.size();
+        int64_t nextUs = INT64_MAX;
+        size_t index = 0;
+        for (size_t j = 0; j < n; ++j) {
+            const size_t i = (mNextLooper + j) % n;
+            if (mLoopers[i].mWorkerId != NULL) {
+                continue; // keep the looper serial
+            }
+            // A looper removes itself in its destructor, which needs mLock, so the
+            // pointer is valid here. Only promote it once chosen: releasing the last
+            // reference while holding mLock would deadlock.
+            const int64_t whenUs = mLoopers[i].mLooperPtr->getNextEventTimeUs();
+            if (whenUs <= ALooper::GetNowUs()) {
+                looper = mLoopers[i].mLooper.promote();
+                if (looper == NULL) {
+                    continue; // being destroyed
+                }
+                index = i;
+                break;
+            }
+            if (whenUs < nextUs) {
+                nextUs = whenUs;
+            }
+        }
+
+        if (looper == NULL) {
+            if (nextUs == INT64_MAX) {
+                mCondition.wait(mLock);
+            } else {
+                int64_t delayUs = nextUs - ALooper::GetNowUs();
+                if (delayUs > INT64_MAX / 1000) {
+                    delayUs = INT64_MAX / 1000;
+                }
+                mCondition.waitRelative(mLock, delayUs * 1000ll);
+            }
+            return true;
+        }
+        mLoopers.editItemAt(index).mWorkerId = androidGetThreadId();
+        mNextLooper = (index + 1) % n;
+    }
+
+    looper->deliverNextEvent();
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        for (size_t i = 0; i < mLoopers.size(); ++i) {
+            if (mLoopers[i].mLooperPtr == looper.get()) {
+                mLoopers.editItemAt(i).mWorkerId = NULL;
+                break;
+            }
+        }
+        // for removeLooper(), and for idle workers that skipped this looper.
+        mCondition.broadcast();
+    }
+    // the last reference may go away here, and ~ALooper() takes mLock.
+    looper.clear();
+    return true;
+}
+
+}  // namespace android
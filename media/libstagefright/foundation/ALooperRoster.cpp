@@ -16,6 +16,8 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "ALooperRoster"
+#include <algorithm>
+
 #include <utils/Log.h>
 #include <utils/String8.h>
 
@@ -133,11 +135,16 @@ void ALooperRoster::dump(int fd, const Vector<String16>& args) {
     size_t n = mHandlers.size();
     s.appendFormat(" %zu registered handlers:\n", n);
 
+    Vector<sp<ALooper> > loopers;
+
     for (size_t i = 0; i < n; i++) {
         s.appendFormat("  %d: ", mHandlers.keyAt(i));
         HandlerInfo &info = mHandlers.editValueAt(i);
         sp<ALooper> looper = info.mLooper.promote();
         if (looper != NULL) {
+            if (std::find(loopers.begin(), loopers.end(), looper) == loopers.end()) {
+                loopers.push_back(looper);
+            }
             s.append(looper->getName());
             sp<AHandler> handler = info.mHandler.promote();
             if (handler != NULL) {
@@ -166,6 +173,13 @@ void ALooperRoster::dump(int fd, const Vector<String16>& args) {
         }
         s.append("\n");
     }
+
+    s.appendFormat(" %zu loopers:\n", loopers.size());
+    for (const sp<ALooper> &looper : loopers) {
+        AString stats;
+        looper->dumpStats(&stats, clear);
+        s.appendFormat("  %s: %s\n", looper->getName(), stats.c_str());
+    }
     write(fd, s.string(), s.size());
 }
 
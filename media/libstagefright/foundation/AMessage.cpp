@@ -24,6 +24,7 @@
 
 #include <binder/Parcel.h>
 #include <log/log.h>
+#include <utils/Mutex.h>
 
 #include "AAtomizer.h"
 #include "ABuffer.h"
@@ -52,12 +53,14 @@ status_t AReplyToken::setReply(const sp<AMessage> &reply) {
 AMessage::AMessage(void)
     : mWhat(0),
       mTarget(0),
-      mNumItems(0) {
+      mNumItems(0),
+      mIndexed(false) {
 }
 
 AMessage::AMessage(uint32_t what, const sp<const AHandler> &handler)
     : mWhat(what),
-      mNumItems(0) {
+      mNumItems(0),
+      mIndexed(false) {
     setTarget(handler);
 }
 
@@ -85,14 +88,47 @@ void AMessage::setTarget(const sp<const AHandler> &handler) {
     }
 }
 
+// Free list of AMessage storage. Messages are usually allocated on one thread and released
+// on another (the looper), so the list is shared rather than per thread.
+static constexpr size_t kMaxPooledMessages = 32;
+static Mutex gMessagePoolLock;
+static void *gMessagePool[kMaxPooledMessages];
+static size_t gMessagePoolSize = 0;
+
+// static
+void *AMessage::operator new(size_t size) {
+    if (size == sizeof(AMessage)) {
+        Mutex::Autolock autoLock(gMessagePoolLock);
+        if (gMessagePoolSize > 0) {
+            return gMessagePool[--gMessagePoolSize];
+        }
+    }
+    return ::operator new(size);
+}
+
+// static
+void AMessage::operator delete(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (size == sizeof(AMessage)) {
+        Mutex::Autolock autoLock(gMessagePoolLock);
+        if (gMessagePoolSize < kMaxPooledMessages) {
+            gMessagePool[gMessagePoolSize++] = ptr;
+            return;
+        }
+    }
+    ::operator delete(ptr);
+}
+
 void AMessage::clear() {
     for (size_t i = 0; i < mNumItems; ++i) {
         Item *item = &mItems[i];
-        delete[] item->mName;
-        item->mName = NULL;
+        item->clearName();
         freeItemValue(item);
     }
     mNumItems = 0;
+    mIndexed = false;
 }
 
 void AMessage::freeItemValue(Item *item) {
@@ -149,20 +185,42 @@ static void reportStats() {
 }
 #endif
 
+// static
+inline uint32_t AMessage::HashName(const char *name, size_t len) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
 inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
 #ifdef DUMP_STATS
     size_t memchecks = 0;
 #endif
-    size_t i = 0;
-    for (; i < mNumItems; i++) {
-        if (len != mItems[i].mNameLength) {
-            continue;
+    const uint32_t hash = HashName(name, len);
+    size_t i = mNumItems;
+    if (mIndexed) {
+        for (size_t slot = hash % kIndexSize; mIndex[slot] != 0; slot = (slot + 1) % kIndexSize) {
+            const Item &item = mItems[mIndex[slot] - 1];
+            if (item.mNameHash == hash && item.mNameLength == len
+                    && !memcmp(item.mName, name, len)) {
+                i = mIndex[slot] - 1;
+                break;
+            }
         }
+    } else {
+        for (i = 0; i < mNumItems; i++) {
+            if (hash != mItems[i].mNameHash || len != mItems[i].mNameLength) {
+                continue;
+            }
 #ifdef DUMP_STATS
-        ++memchecks;
+            ++memchecks;
 #endif
-        if (!memcmp(mItems[i].mName, name, len)) {
-            break;
+            if (!memcmp(mItems[i].mName, name, len)) {
+                break;
+            }
         }
     }
 #ifdef DUMP_STATS
@@ -178,11 +236,54 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
     return i;
 }
 
+void AMessage::addToIndex(size_t index) {
+    size_t slot = mItems[index].mNameHash % kIndexSize;
+    while (mIndex[slot] != 0) {
+        slot = (slot + 1) % kIndexSize;
+    }
+    mIndex[slot] = index + 1;
+}
+
+void AMessage::rebuildIndex() {
+    mIndexed = mNumItems > kMinIndexedItems;
+    if (mIndexed) {
+        memset(mIndex, 0, sizeof(mIndex));
+        for (size_t i = 0; i < mNumItems; ++i) {
+            addToIndex(i);
+        }
+    }
+}
+
 // assumes item's name was uninitialized or NULL
 void AMessage::Item::setName(const char *name, size_t len) {
     mNameLength = len;
-    mName = new char[len + 1];
-    memcpy((void*)mName, name, len + 1);
+    mNameHash = HashName(name, len);
+    char *dst = len < kMaxInlineNameLength ? mInlineName : new char[len + 1];
+    memcpy(dst, name, len + 1);
+    mName = dst;
+}
+
+void AMessage::Item::clearName() {
+    if (mName != mInlineName) {
+        delete[] mName;
+    }
+    mName = NULL;
+}
+
+// takes over other's name and value, leaving other without a name
+void AMessage::Item::moveFrom(Item *other) {
+    u = other->u;
+    mType = other->mType;
+    mNameLength = other->mNameLength;
+    mNameHash = other->mNameHash;
+    if (other->mName == other->mInlineName) {
+        memcpy(mInlineName, other->mInlineName, mNameLength + 1);
+        mName = mInlineName;
+    } else {
+        mName = other->mName;
+    }
+    other->mName = NULL;
+    other->mType = kTypeInt32;
 }
 
 AMessage::Item *AMessage::allocateItem(const char *name) {
@@ -199,6 +300,11 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
         item = &mItems[i];
         item->mType = kTypeInt32;
         item->setName(name, len);
+        if (mIndexed) {
+            addToIndex(i);
+        } else if (mNumItems > kMinIndexedItems) {
+            rebuildIndex();
+        }
     }
 
     return item;
@@ -515,6 +621,8 @@ sp<AMessage> AMessage::dup() const {
         }
     }
 
+    msg->rebuildIndex();
+
     return msg;
 }
 
@@ -745,6 +853,8 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
         item->setName(name, strlen(name));
     }
 
+    msg->rebuildIndex();
+
     return msg;
 }
 
@@ -994,9 +1104,9 @@ status_t AMessage::setEntryNameAt(size_t index, const char *name) {
     if (findItemIndex(name, len) < mNumItems) {
         return ALREADY_EXISTS;
     }
-    delete[] mItems[index].mName;
-    mItems[index].mName = nullptr;
+    mItems[index].clearName();
     mItems[index].setName(name, len);
+    rebuildIndex();
     return OK;
 }
 
@@ -1060,16 +1170,14 @@ status_t AMessage::removeEntryAt(size_t index) {
     }
     // delete entry data and objects
     --mNumItems;
-    delete[] mItems[index].mName;
-    mItems[index].mName = nullptr;
+    mItems[index].clearName();
     freeItemValue(&mItems[index]);
 
     // swap entry with last entry and clear last entry's data
     if (index < mNumItems) {
-        mItems[index] = mItems[mNumItems];
-        mItems[mNumItems].mName = nullptr;
-        mItems[mNumItems].mType = kTypeInt32;
+        mItems[index].moveFrom(&mItems[mNumItems]);
     }
+    rebuildIndex();
     return OK;
 }
 
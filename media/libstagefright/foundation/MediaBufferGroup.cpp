@@ -17,12 +17,15 @@
 #define LOG_TAG "MediaBufferGroup"
 #include <utils/Log.h>
 
+#include <atomic>
+#include <inttypes.h>
 #include <list>
 
 #include <binder/MemoryDealer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
+#include <utils/String8.h>
 #include <utils/threads.h>
 
 namespace android {
@@ -41,6 +44,26 @@ struct MediaBufferGroup::InternalData {
     Condition mCondition;
     size_t mGrowthLimit;  // Do not automatically grow group larger than this.
     std::list<MediaBufferBase *> mBuffers;
+
+    // acquire_buffer() callers about to wait, so that buffer returns only take
+    // mLock when someone needs to be woken up.
+    std::atomic<int32_t> mWaiters{0};
+
+    // statistics, protected by mLock
+    size_t mPeakBuffers = 0;
+    int64_t mAcquires = 0;
+    int64_t mAllocations = 0;     // by acquire_buffer(), to grow or to replace a buffer
+    int64_t mReallocations = 0;   // of those, replacing a smaller free buffer
+    int64_t mWouldBlock = 0;
+    int64_t mWaits = 0;
+    nsecs_t mTotalWaitNs = 0;
+    nsecs_t mMaxWaitNs = 0;
+
+    void updatePeak_l() {
+        if (mBuffers.size() > mPeakBuffers) {
+            mPeakBuffers = mBuffers.size();
+        }
+    }
 };
 
 MediaBufferGroup::MediaBufferGroup(size_t growthLimit)
@@ -102,6 +125,7 @@ void MediaBufferGroup::init(size_t buffers, size_t buffer_size, size_t growthLim
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
+    ALOGV("%s", dump().c_str());
     for (MediaBufferBase *buffer : mInternal->mBuffers) {
         if (buffer->refcount() != 0) {
             const int localRefcount = buffer->localRefcount();
@@ -147,6 +171,7 @@ void MediaBufferGroup::add_buffer(MediaBufferBase *buffer) {
 
     buffer->setObserver(this);
     mInternal->mBuffers.emplace_back(buffer);
+    mInternal->updatePeak_l();
 }
 
 bool MediaBufferGroup::has_buffers() {
@@ -164,6 +189,8 @@ bool MediaBufferGroup::has_buffers() {
 status_t MediaBufferGroup::acquire_buffer(
         MediaBufferBase **out, bool nonBlocking, size_t requestedSize) {
     Mutex::Autolock autoLock(mInternal->mLock);
+    bool waiting = false;
+    nsecs_t waitStartNs = 0;
     for (;;) {
         size_t smallest = requestedSize;
         size_t biggest = requestedSize;
@@ -199,7 +226,9 @@ status_t MediaBufferGroup::acquire_buffer(
                 buffer = nullptr;
             } else {
                 buffer->setObserver(this);
+                ++mInternal->mAllocations;
                 if (free != mInternal->mBuffers.end()) {
+                    ++mInternal->mReallocations;
                     ALOGV("reallocate buffer, requested size %zu vs available %zu",
                             requestedSize, (*free)->size());
                     (*free)->setObserver(nullptr);
@@ -208,6 +237,7 @@ status_t MediaBufferGroup::acquire_buffer(
                 } else {
                     ALOGV("allocate buffer, requested size %zu", requestedSize);
                     mInternal->mBuffers.emplace_back(buffer);
+                    mInternal->updatePeak_l();
                 }
             }
         }
@@ -215,12 +245,31 @@ status_t MediaBufferGroup::acquire_buffer(
             buffer->add_ref();
             buffer->reset();
             *out = buffer;
+            ++mInternal->mAcquires;
+            if (waiting) {
+                --mInternal->mWaiters;
+                const nsecs_t waitNs = systemTime(SYSTEM_TIME_MONOTONIC) - waitStartNs;
+                mInternal->mTotalWaitNs += waitNs;
+                if (waitNs > mInternal->mMaxWaitNs) {
+                    mInternal->mMaxWaitNs = waitNs;
+                }
+            }
             return OK;
         }
         if (nonBlocking) {
             *out = nullptr;
+            ++mInternal->mWouldBlock;
             return WOULD_BLOCK;
         }
+        if (!waiting) {
+            // Announce the wait, then scan again: a buffer returned before the
+            // announcement did not signal, one returned after it will.
+            waiting = true;
+            waitStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+            ++mInternal->mWaits;
+            ++mInternal->mWaiters;
+            continue;
+        }
         // All buffers are in use, block until one of them is returned.
         mInternal->mCondition.wait(mInternal->mLock);
     }
@@ -232,8 +281,37 @@ size_t MediaBufferGroup::buffers() const {
 }
 
 void MediaBufferGroup::signalBufferReturned(MediaBufferBase *) {
+    // The buffer refcount was released before this call, so a waiter either sees the
+    // buffer free in its scan, or is counted here. Most returns have no waiter and
+    // then do not contend with acquire_buffer() for mLock.
+    if (mInternal->mWaiters == 0) {
+        return;
+    }
     Mutex::Autolock autoLock(mInternal->mLock);
     mInternal->mCondition.signal();
 }
 
+std::string MediaBufferGroup::dump() const {
+    Mutex::Autolock autoLock(mInternal->mLock);
+    size_t inUse = 0;
+    for (MediaBufferBase *buffer : mInternal->mBuffers) {
+        if (buffer->refcount() != 0) {
+            ++inUse;
+        }
+    }
+    String8 s;
+    s.appendFormat("MediaBufferGroup %p: %zu buffers (%zu in use, peak %zu, limit %zu)\n",
+            this, mInternal->mBuffers.size(), inUse, mInternal->mPeakBuffers,
+            mInternal->mGrowthLimit);
+    s.appendFormat("  acquired %" PRId64 ", allocated %" PRId64 " (%" PRId64 " replacing),"
+            " would block %" PRId64 "\n",
+            mInternal->mAcquires, mInternal->mAllocations, mInternal->mReallocations,
+            mInternal->mWouldBlock);
+    s.appendFormat("  waits %" PRId64 ", wait avg %" PRId64 " us max %" PRId64 " us\n",
+            mInternal->mWaits,
+            mInternal->mWaits > 0 ? mInternal->mTotalWaitNs / mInternal->mWaits / 1000 : 0,
+            mInternal->mMaxWaitNs / 1000);
+    return s.string();
+}
+
 }  // namespace android
@@ -16,6 +16,7 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "MetaDataBase"
+#include <atomic>
 #include <inttypes.h>
 #include <binder/Parcel.h>
 #include <utils/KeyedVector.h>
@@ -74,32 +75,61 @@ struct MetaDataBase::Rect {
 };
 
 
-struct MetaDataBase::MetaDataInternal {
+static std::atomic<uint64_t> gNextGeneration(1);
+
+struct MetaDataBase::MetaDataInternal : public LightRefBase<MetaDataBase::MetaDataInternal> {
+    MetaDataInternal()
+        : mGeneration(gNextGeneration++) {
+    }
+
     KeyedVector<uint32_t, MetaDataBase::typed_data> mItems;
+    uint64_t mGeneration;
 };
 
+// Copies share the items, so copying a track format into every sample's meta data, or
+// returning it from getFormat(), does not allocate. Setters and remove() detach the
+// instance they are called on first. A MetaDataBase instance is still not thread safe,
+// but distinct copies may be used on different threads.
 
 MetaDataBase::MetaDataBase()
     : mInternalData(new MetaDataInternal()) {
 }
 
 MetaDataBase::MetaDataBase(const MetaDataBase &from)
-    : mInternalData(new MetaDataInternal()) {
-    mInternalData->mItems = from.mInternalData->mItems;
+    : mInternalData(from.mInternalData) {
 }
 
 MetaDataBase& MetaDataBase::operator = (const MetaDataBase &rhs) {
-    this->mInternalData->mItems = rhs.mInternalData->mItems;
+    mInternalData = rhs.mInternalData;
     return *this;
 }
 
 MetaDataBase::~MetaDataBase() {
-    clear();
-    delete mInternalData;
+}
+
+MetaDataBase::MetaDataInternal *MetaDataBase::editInternalData() {
+    if (mInternalData->getStrongCount() > 1) {
+        // the other owners cannot take new references through this instance, so the
+        // count cannot go up behind our back.
+        sp<MetaDataInternal> copy = new MetaDataInternal();
+        copy->mItems = mInternalData->mItems;
+        mInternalData = copy;
+    } else {
+        // pairs with the release in the decStrong() of a copy that was just destroyed.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        mInternalData->mGeneration = gNextGeneration++;
+    }
+    return mInternalData.get();
 }
 
 void MetaDataBase::clear() {
-    mInternalData->mItems.clear();
+    if (mInternalData->getStrongCount() > 1) {
+        mInternalData = new MetaDataInternal();
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        mInternalData->mItems.clear();
+        mInternalData->mGeneration = gNextGeneration++;
+    }
 }
 
 bool MetaDataBase::remove(uint32_t key) {
@@ -109,7 +139,7 @@ bool MetaDataBase::remove(uint32_t key) {
         return false;
     }
 
-    mInternalData->mItems.removeItemsAt(i);
+    editInternalData()->mItems.removeItemsAt(i);
 
     return true;
 }
@@ -249,15 +279,16 @@ bool MetaDataBase::setData(
         uint32_t key, uint32_t type, const void *data, size_t size) {
     bool overwrote_existing = true;
 
-    ssize_t i = mInternalData->mItems.indexOfKey(key);
+    MetaDataInternal *internal = editInternalData();
+    ssize_t i = internal->mItems.indexOfKey(key);
     if (i < 0) {
         typed_data item;
-        i = mInternalData->mItems.add(key, item);
+        i = internal->mItems.add(key, item);
 
         overwrote_existing = false;
     }
 
-    typed_data &item = mInternalData->mItems.editValueAt(i);
+    typed_data &item = internal->mItems.editValueAt(i);
 
     item.setData(type, data, size);
 
@@ -289,6 +320,18 @@ bool MetaDataBase::hasData(uint32_t key) const {
     return true;
 }
 
+size_t MetaDataBase::countEntries() const {
+    return mInternalData->mItems.size();
+}
+
+uint32_t MetaDataBase::getEntryKeyAt(size_t index) const {
+    return mInternalData->mItems.keyAt(index);
+}
+
+uint64_t MetaDataBase::generation() const {
+    return mInternalData->mGeneration;
+}
+
 MetaDataBase::typed_data::typed_data()
     : mType(0),
       mSize(0) {
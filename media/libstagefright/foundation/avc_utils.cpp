@@ -275,6 +275,23 @@ void FindAVCDimensions(
     }
 }
 
+size_t findNALStartCode(const uint8_t *data, size_t size) {
+    size_t offset = 2;
+    while (offset < size) {
+        const uint8_t *one = (const uint8_t *)memchr(&data[offset], 0x01, size - offset);
+        if (one == NULL) {
+            break;
+        }
+        offset = one - data;
+        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
+            return offset - 2;
+        }
+        // data[offset] is not 0x00, so the next start code ends at offset + 3 or later.
+        offset += 3;
+    }
+    return size;
+}
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
@@ -289,17 +306,10 @@ status_t getNextNALUnit(
         return -EAGAIN;
     }
 
-    size_t offset = 0;
-
     // A valid startcode consists of at least two 0x00 bytes followed by 0x01.
-    for (; offset + 2 < size; ++offset) {
-        if (data[offset + 2] == 0x01 && data[offset] == 0x00
-                && data[offset + 1] == 0x00) {
-            break;
-        }
-    }
-    if (offset + 2 >= size) {
-        *_data = &data[offset];
+    size_t offset = findNALStartCode(data, size);
+    if (offset == size) {
+        *_data = &data[size - 2];
         *_size = 2;
         return -EAGAIN;
     }
@@ -307,25 +317,15 @@ status_t getNextNALUnit(
 
     size_t startOffset = offset;
 
-    for (;;) {
-        while (offset < size && data[offset] != 0x01) {
-            ++offset;
-        }
-
-        if (offset == size) {
-            if (startCodeFollows) {
-                offset = size + 2;
-                break;
-            }
-
+    // offset is set to the 0x01 of the next start code.
+    offset = startOffset + findNALStartCode(&data[startOffset], size - startOffset);
+    if (offset == size) {
+        if (!startCodeFollows) {
             return -EAGAIN;
         }
-
-        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
-            break;
-        }
-
-        ++offset;
+        offset = size + 2;
+    } else {
+        offset += 2;
     }
 
     size_t endOffset = offset - 2;
@@ -515,6 +515,39 @@ bool IsAVCReferenceFrame(const sp<ABuffer> &accessUnit) {
     return true;
 }
 
+bool IsHEVCReferenceFrame(const sp<ABuffer> &accessUnit, uint32_t *maxTemporalId) {
+    const uint8_t *data = accessUnit->data();
+    size_t size = accessUnit->size();
+    if (data == NULL) {
+        ALOGE("IsHEVCReferenceFrame: called on NULL data (%p, %zu)", accessUnit.get(), size);
+        return false;
+    }
+
+    const uint8_t *nalStart;
+    size_t nalSize;
+    while (getNextNALUnit(&data, &size, &nalStart, &nalSize, true) == OK) {
+        if (nalSize < 2) {
+            ALOGE("IsHEVCReferenceFrame: invalid nalSize: %zu (%p, %zu)",
+                    nalSize, accessUnit.get(), size);
+            return false;
+        }
+
+        unsigned nalType = (nalStart[0] >> 1) & 0x3f;
+        if (nalType > 31) {
+            continue;  // not a slice
+        }
+        unsigned temporalIdPlus1 = nalStart[1] & 7;
+        uint32_t temporalId = temporalIdPlus1 > 0 ? temporalIdPlus1 - 1 : 0;
+        if (temporalId > *maxTemporalId) {
+            *maxTemporalId = temporalId;
+        }
+        // even types below 16 are sub-layer non-reference pictures
+        return nalType >= 16 || (nalType & 1) || temporalId < *maxTemporalId;
+    }
+
+    return true;
+}
+
 uint32_t FindAVCLayerId(const uint8_t *data, size_t size) {
     CHECK(data != NULL);
 
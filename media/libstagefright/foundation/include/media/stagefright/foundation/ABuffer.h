@@ -43,6 +43,11 @@ struct ABuffer : public RefBase {
     // create buffer from dup of some memory block
     static sp<ABuffer> CreateAsCopy(const void *data, size_t capacity);
 
+    // create buffer sharing [offset, offset + size) of this buffer's range, without a copy.
+    // The slice keeps this buffer alive and has its own range and meta, but the data is
+    // shared, so neither buffer may be modified in place while the other is in use.
+    sp<ABuffer> slice(size_t offset, size_t size);
+
     void setInt32Data(int32_t data) { mInt32Data = data; }
     int32_t int32Data() const { return mInt32Data; }
 
@@ -53,6 +58,7 @@ protected:
 
 private:
     sp<AMessage> mMeta;
+    sp<ABuffer> mParent;    // owner of the data of a slice
 
     void *mData;
     size_t mCapacity;
@@ -26,9 +26,12 @@
 #include <utils/RefBase.h>
 #include <utils/threads.h>
 
+#include <vector>
+
 namespace android {
 
 struct AHandler;
+struct ALooperGroup;
 struct AMessage;
 struct AReplyToken;
 
@@ -50,6 +53,10 @@ struct ALooper : public RefBase {
             int32_t priority = PRIORITY_DEFAULT
             );
 
+    // Delivers the messages on a worker of group instead of a thread of this looper.
+    // Messages are still delivered one at a time and in order. Stop with stop().
+    status_t start(const sp<ALooperGroup> &group);
+
     status_t stop();
 
     static int64_t GetNowUs();
@@ -58,15 +65,26 @@ struct ALooper : public RefBase {
         return mName.c_str();
     }
 
+    // Appends the queue depth and dispatch latency statistics, and resets them if clear.
+    void dumpStats(AString *s, bool clear);
+
 protected:
     virtual ~ALooper();
 
 private:
     friend struct AMessage;       // post()
+    friend struct ALooperGroup;   // getNextEventTimeUs(), deliverNextEvent()
 
     struct Event {
         int64_t mWhenUs;
+        uint64_t mSeq;  // keeps events due at the same time in posting order
         sp<AMessage> mMessage;
+
+        // ordering for a min-heap on (mWhenUs, mSeq)
+        bool operator<(const Event &other) const {
+            return mWhenUs > other.mWhenUs
+                    || (mWhenUs == other.mWhenUs && mSeq > other.mSeq);
+        }
     };
 
     Mutex mLock;
@@ -74,11 +92,20 @@ private:
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // binary heap, the next event is at the front.
+    std::vector<Event> mEventQueue;
+    uint64_t mNextEventSeq;
+
+    // statistics, protected by mLock
+    size_t mMaxQueueDepth;
+    int64_t mDispatchCount;
+    int64_t mTotalDispatchLatencyUs;    // from the due time to the dequeue
+    int64_t mMaxDispatchLatencyUs;
 
     struct LooperThread;
     sp<LooperThread> mThread;
     bool mRunningLocally;
+    sp<ALooperGroup> mGroup;
 
     // use a separate lock for reply handling, as it is always on another thread
     // use a central lock, however, to avoid creating a mutex for each reply
@@ -103,6 +130,18 @@ private:
 
     bool loop();
 
+    bool isRunning_l() const {
+        return mThread != NULL || mRunningLocally || mGroup != NULL;
+    }
+
+    // removes the next event if it is due, and updates the statistics
+    bool dequeueDueEvent_l(int64_t nowUs, Event *event);
+
+    // for ALooperGroup: due time of the next event, or INT64_MAX if the queue is empty
+    int64_t getNextEventTimeUs();
+    // for ALooperGroup: delivers the next event if it is due
+    void deliverNextEvent();
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooper);
 };
 
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_LOOPER_GROUP_H_
+
+#define A_LOOPER_GROUP_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ALooper;
+
+// A bounded pool of threads shared by several ALoopers, see ALooper::start(group).
+//
+// Each looper still delivers its messages one at a time and in order, so its handlers
+// see the same serial execution as with a dedicated thread, but independent loopers
+// run in parallel on at most numThreads threads.  A handler that blocks, e.g. in
+// postAndAwaitResponse() to a looper of the same group, holds on to a worker, so the
+// group needs more threads than the depth of such call chains.
+struct ALooperGroup : public RefBase {
+    ALooperGroup(const char *name, size_t numThreads, int32_t priority = PRIORITY_DEFAULT);
+
+    status_t start();
+
+    // Stops the workers. Loopers still in the group stop delivering messages.
+    status_t stop();
+
+protected:
+    virtual ~ALooperGroup();
+
+private:
+    friend struct ALooper;
+
+    struct WorkerThread;
+
+    struct LooperInfo {
+        wp<ALooper> mLooper;
+        ALooper *mLooperPtr;                // for removal from the ALooper destructor
+        android_thread_id_t mWorkerId;      // worker delivering a message, or NULL
+    };
+
+    const AString mName;
+    const size_t mNumThreads;
+    const int32_t mPriority;
+
+    Mutex mLock;
+    Condition mCondition;
+    Vector<LooperInfo> mLoopers;
+    size_t mNextLooper;                     // where the next scan starts, for fairness
+    Vector<sp<WorkerThread> > mThreads;
+    bool mStopping;
+
+    // called by ALooper
+    void addLooper(const sp<ALooper> &looper);
+    void removeLooper(ALooper *looper);
+    void wake();
+
+    // returns false when the group is stopping
+    bool workerLoop();
+
+    DISALLOW_EVIL_CONSTRUCTORS(ALooperGroup);
+};
+
+}  // namespace android
+
+#endif  // A_LOOPER_GROUP_H_
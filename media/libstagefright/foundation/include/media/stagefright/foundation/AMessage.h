@@ -259,6 +259,11 @@ struct AMessage : public RefBase {
      */
     status_t removeEntryAt(size_t index);
 
+    // AMessage storage is recycled through a small process-wide free list, as messages are
+    // allocated and released at a high rate by the loopers.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
 protected:
     virtual ~AMessage();
 
@@ -287,8 +292,17 @@ private:
         } u;
         const char *mName;
         size_t      mNameLength;
+        uint32_t    mNameHash;  // see HashName()
         Type mType;
+        // names shorter than kMaxInlineNameLength are stored here instead of on the heap.
+        char        mInlineName[16];
         void setName(const char *name, size_t len);
+        void clearName();
+        void moveFrom(Item *other);
+    };
+
+    enum {
+        kMaxInlineNameLength = sizeof(Item::mInlineName)
     };
 
     enum {
@@ -297,6 +311,19 @@ private:
     Item mItems[kMaxNumItems];
     size_t mNumItems;
 
+    // Messages with more than kMinIndexedItems items also keep an open addressing
+    // hash table of item index + 1 (0 is empty), so lookups do not scan all items.
+    enum {
+        kMinIndexedItems = 16,
+        kIndexSize = 2 * kMaxNumItems,
+    };
+    bool mIndexed;
+    uint8_t mIndex[kIndexSize];
+
+    static uint32_t HashName(const char *name, size_t len);
+    void addToIndex(size_t index);
+    void rebuildIndex();
+
     Item *allocateItem(const char *name);
     void freeItemValue(Item *item);
     const Item *findItem(const char *name, Type type) const;
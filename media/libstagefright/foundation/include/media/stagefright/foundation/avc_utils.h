@@ -75,6 +75,10 @@ inline void skipSE(ABitReader *br) {
     (void)parseSEWithFallback(br, 0);
 }
 
+// Returns the offset of the first 0x00 0x00 0x01 start code in |data|, or |size| if there
+// is none. Uses memchr() to find the 0x01 bytes, which libc vectorizes.
+size_t findNALStartCode(const uint8_t *data, size_t size);
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
@@ -86,6 +90,11 @@ sp<ABuffer> MakeAVCCodecSpecificData(
 
 bool IsIDR(const uint8_t *data, size_t size);
 bool IsAVCReferenceFrame(const sp<ABuffer> &accessUnit);
+// For HEVC, false for a sub-layer non-reference picture (TRAIL_N, RASL_N, ...) of the
+// highest temporal sub-layer seen so far, which no later picture refers to. Skipping other
+// sub-layer non-reference pictures could break higher sub-layers. Pass the same
+// *maxTemporalId, initially 0, for all access units of a stream.
+bool IsHEVCReferenceFrame(const sp<ABuffer> &accessUnit, uint32_t *maxTemporalId);
 uint32_t FindAVCLayerId(const uint8_t *data, size_t size);
 
 const char *AVCProfileToString(uint8_t profile);
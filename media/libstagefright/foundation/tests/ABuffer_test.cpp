@@ -0,0 +1,57 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABuffer_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+TEST(ABuffer_test, slice) {
+    sp<ABuffer> parent = new ABuffer(16);
+    for (size_t i = 0; i < parent->size(); ++i) {
+        parent->data()[i] = i;
+    }
+    parent->setRange(4, 8);
+
+    // offsets are relative to the range of the parent.
+    sp<ABuffer> slice = parent->slice(2, 4);
+    ASSERT_EQ(4u, slice->size());
+    EXPECT_EQ(4u, slice->capacity());
+    EXPECT_EQ(0u, slice->offset());
+    EXPECT_EQ(parent->data() + 2, slice->data());
+    EXPECT_EQ(6, slice->data()[0]);
+
+    // the slice has its own range and meta.
+    slice->setRange(1, 2);
+    slice->meta()->setInt32("rtp-time", 1);
+    EXPECT_EQ(8u, parent->size());
+    EXPECT_FALSE(parent->meta()->contains("rtp-time"));
+
+    // the slice keeps the data alive.
+    uint8_t *data = slice->data();
+    parent.clear();
+    EXPECT_EQ(7, data[0]);
+
+    sp<ABuffer> empty = slice->slice(2, 0);
+    EXPECT_EQ(0u, empty->size());
+}
+
+}  // namespace android
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooperGroup_test"
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/ALooperGroup.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+namespace {
+
+enum {
+    kWhatSequence = 'sequ',
+    kWhatEcho     = 'echo',
+};
+
+struct SequenceHandler : public AHandler {
+    SequenceHandler()
+        : mNext(0),
+          mOutOfOrder(0),
+          mConcurrent(0),
+          mActive(0) {
+    }
+
+    bool waitFor(int32_t count, int64_t timeoutUs) {
+        Mutex::Autolock autoLock(mLock);
+        while (mNext < count) {
+            if (mCondition.waitRelative(mLock, timeoutUs * 1000ll) != OK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int32_t mNext;
+    int32_t mOutOfOrder;
+    std::atomic<int32_t> mConcurrent;     // deliveries that overlapped another one
+    Vector<int32_t> mReceived;  // only the first few sequence numbers
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        switch (msg->what()) {
+            case kWhatSequence:
+            {
+                if (mActive.fetch_add(1) != 0) {
+                    ++mConcurrent;
+                }
+                int32_t seq;
+                CHECK(msg->findInt32("seq", &seq));
+                Mutex::Autolock autoLock(mLock);
+                if (seq != mNext) {
+                    ++mOutOfOrder;
+                }
+                if (mReceived.size() < 16) {
+                    mReceived.push_back(seq);
+                }
+                ++mNext;
+                mCondition.broadcast();
+                mActive.fetch_sub(1);
+                break;
+            }
+
+            case kWhatEcho:
+            {
+                sp<AReplyToken> replyID;
+                CHECK(msg->senderAwaitsResponse(&replyID));
+                sp<AMessage> response = new AMessage;
+                response->setInt32("value", 42);
+                response->postReply(replyID);
+                break;
+            }
+        }
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    std::atomic<int32_t> mActive;
+};
+
+}  // namespace
+
+TEST(ALooperGroup_test, per_looper_order) {
+    static constexpr size_t kNumLoopers = 8;
+    static constexpr int32_t kNumMessages = 2000;
+
+    sp<ALooperGroup> group = new ALooperGroup("ALooperGroup_test", 3);
+    ASSERT_EQ(OK, group->start());
+
+    sp<ALooper> loopers[kNumLoopers];
+    sp<SequenceHandler> handlers[kNumLoopers];
+    for (size_t i = 0; i < kNumLoopers; ++i) {
+        loopers[i] = new ALooper;
+        ASSERT_EQ(OK, loopers[i]->start(group));
+        handlers[i] = new SequenceHandler;
+        loopers[i]->registerHandler(handlers[i]);
+    }
+    // a looper runs either on its own thread or in a group.
+    EXPECT_EQ(INVALID_OPERATION, loopers[0]->start());
+
+    for (int32_t seq = 0; seq < kNumMessages; ++seq) {
+        for (size_t i = 0; i < kNumLoopers; ++i) {
+            sp<AMessage> msg = new AMessage(kWhatSequence, handlers[i]);
+            msg->setInt32("seq", seq);
+            msg->post();
+        }
+    }
+
+    for (size_t i = 0; i < kNumLoopers; ++i) {
+        ASSERT_TRUE(handlers[i]->waitFor(kNumMessages, 5000000ll)) << "looper " << i;
+        EXPECT_EQ(0, handlers[i]->mOutOfOrder) << "looper " << i;
+        EXPECT_EQ(0, handlers[i]->mConcurrent) << "looper " << i;
+        loopers[i]->unregisterHandler(handlers[i]->id());
+        EXPECT_EQ(OK, loopers[i]->stop());
+    }
+    EXPECT_EQ(OK, group->stop());
+}
+
+TEST(ALooperGroup_test, delayed_and_reply) {
+    sp<ALooperGroup> group = new ALooperGroup("ALooperGroup_test", 2);
+    ASSERT_EQ(OK, group->start());
+
+    sp<ALooper> looper = new ALooper;
+    ASSERT_EQ(OK, looper->start(group));
+    sp<SequenceHandler> handler = new SequenceHandler;
+    looper->registerHandler(handler);
+
+    // due times in reverse posting order.
+    for (int32_t seq = 0; seq < 3; ++seq) {
+        sp<AMessage> msg = new AMessage(kWhatSequence, handler);
+        msg->setInt32("seq", seq);
+        msg->post((3 - seq) * 20000ll);
+    }
+    const int64_t startUs = ALooper::GetNowUs();
+    ASSERT_TRUE(handler->waitFor(3, 1000000ll));
+    EXPECT_GE(ALooper::GetNowUs() - startUs, 55000ll);
+    ASSERT_EQ(3u, handler->mReceived.size());
+    EXPECT_EQ(2, handler->mReceived[0]);
+    EXPECT_EQ(1, handler->mReceived[1]);
+    EXPECT_EQ(0, handler->mReceived[2]);
+
+    sp<AMessage> response;
+    ASSERT_EQ(OK, (new AMessage(kWhatEcho, handler))->postAndAwaitResponse(&response));
+    int32_t value;
+    ASSERT_TRUE(response->findInt32("value", &value));
+    EXPECT_EQ(42, value);
+
+    looper->unregisterHandler(handler->id());
+    EXPECT_EQ(OK, looper->stop());
+    EXPECT_EQ(OK, group->stop());
+}
+
+}  // namespace android
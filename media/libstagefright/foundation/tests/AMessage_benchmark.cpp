@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark for AMessage allocation and lookup.
+// Posts messages shaped like the NuPlayer and ACodec ones to a looper and reports the
+// throughput and the number of global operator new calls per message. Run it on builds
+// with and without the AMessage free list and inline item names to compare.
+// Also times lookups in a message large enough to be indexed.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AMessage_benchmark"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+static std::atomic<size_t> gAllocations(0);
+
+void *operator new(size_t size) {
+    ++gAllocations;
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace android {
+
+static constexpr int32_t kNumMessages = 100000;
+
+struct CountingHandler : public AHandler {
+    void waitFor(int32_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCondition.wait(lock, [&] { return mReceived >= count; });
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        int32_t generation;
+        int64_t timeUs;
+        (void)msg->findInt32("generation", &generation);
+        (void)msg->findInt64("timeUs", &timeUs);
+        std::lock_guard<std::mutex> lock(mLock);
+        if (++mReceived % 1024 == 0 || mReceived == kNumMessages) {
+            mCondition.notify_all();
+        }
+    }
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int32_t mReceived = 0;
+};
+
+static void fillMessage(const sp<AMessage> &msg, int32_t i) {
+    msg->setInt32("generation", i);
+    msg->setInt64("timeUs", i * 1000LL);
+    msg->setSize("portIndex", 1);
+}
+
+TEST(AMessage_benchmark, create_release) {
+    // warm up the free list
+    for (int32_t i = 0; i < 16; ++i) {
+        fillMessage(new AMessage(1, nullptr), i);
+    }
+
+    const size_t allocations = gAllocations;
+    const auto start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < kNumMessages; ++i) {
+        fillMessage(new AMessage(1, nullptr), i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const double perMessage = (gAllocations - allocations) / (double)kNumMessages;
+
+    std::cout << "create/release: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+                      / kNumMessages
+              << " ns, " << perMessage << " allocations per message" << std::endl;
+    // a recycled message with short item names only allocates its RefBase reference counts.
+    EXPECT_LT(perMessage, 1.01);
+}
+
+TEST(AMessage_benchmark, post_deliver) {
+    sp<ALooper> looper = new ALooper;
+    looper->setName("AMessage_benchmark");
+    ASSERT_EQ(OK, looper->start());
+    sp<CountingHandler> handler = new CountingHandler;
+    looper->registerHandler(handler);
+
+    const size_t allocations = gAllocations;
+    const auto start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < kNumMessages; ++i) {
+        sp<AMessage> msg = new AMessage(1, handler);
+        fillMessage(msg, i);
+        msg->post();
+    }
+    handler->waitFor(kNumMessages);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "post/deliver: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+                      / kNumMessages
+              << " ns, " << (gAllocations - allocations) / (double)kNumMessages
+              << " allocations per message" << std::endl;
+
+    looper->unregisterHandler(handler->id());
+    looper->stop();
+}
+
+TEST(AMessage_benchmark, find_many_items) {
+    // more items than AMessage indexes, as in codec output formats.
+    static constexpr int32_t kNumItems = 40;
+    static constexpr int32_t kNumLookups = 100000;
+    sp<AMessage> msg = new AMessage;
+    for (int32_t i = 0; i < kNumItems; ++i) {
+        msg->setInt32(AStringPrintf("key-%d", i).c_str(), i);
+    }
+    // removal and renaming move entries around.
+    ASSERT_EQ(OK, msg->removeEntryAt(msg->findEntryByName("key-3")));
+    ASSERT_EQ(OK, msg->setEntryNameAt(msg->findEntryByName("key-5"), "renamed-5"));
+    sp<AMessage> copy = msg->dup();
+
+    for (const sp<AMessage> &m : { msg, copy }) {
+        int32_t value;
+        EXPECT_FALSE(m->findInt32("key-3", &value));
+        EXPECT_FALSE(m->findInt32("key-5", &value));
+        EXPECT_TRUE(m->findInt32("renamed-5", &value));
+        EXPECT_EQ(5, value);
+        for (int32_t i = 0; i < kNumItems; ++i) {
+            if (i == 3 || i == 5) {
+                continue;
+            }
+            ASSERT_TRUE(m->findInt32(AStringPrintf("key-%d", i).c_str(), &value)) << i;
+            EXPECT_EQ(i, value);
+        }
+    }
+
+    int32_t sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < kNumLookups; ++i) {
+        int32_t value = 0;
+        (void)msg->findInt32("key-39", &value);
+        sum += value;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(39 * kNumLookups, sum);
+    std::cout << "find in " << msg->countEntries() << " items: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()
+                      / kNumLookups
+              << " ns" << std::endl;
+}
+
+} // namespace android
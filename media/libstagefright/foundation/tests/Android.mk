@@ -8,11 +8,15 @@ LOCAL_MODULE := sf_foundation_test
 LOCAL_MODULE_TAGS := tests
 
 LOCAL_SRC_FILES := \
+	ABuffer_test.cpp \
 	AData_test.cpp \
+	ALooperGroup_test.cpp \
 	Base64_test.cpp \
 	Flagged_test.cpp \
+	MetaDataBase_test.cpp \
 	TypeTraits_test.cpp \
 	Utils_test.cpp \
+	avc_utils_test.cpp \
 
 LOCAL_SHARED_LIBRARIES := \
 	liblog \
@@ -27,6 +31,54 @@ LOCAL_CLANG := true
 
 include $(BUILD_NATIVE_TEST)
 
+# Separate binary, as it replaces the global operator new to count allocations.
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := sf_foundation_amessage_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	AMessage_benchmark.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libstagefright_foundation \
+	libutils \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/include \
+
+LOCAL_CFLAGS += -Werror -Wall
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_TEST)
+
+# google-benchmark microbenchmarks for the foundation primitives.
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := sf_foundation_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	foundation_benchmark.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libstagefright_foundation \
+	libutils \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/include \
+
+LOCAL_CFLAGS += -Werror -Wall -Wno-multichar
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_BENCHMARK)
+
 # Include subdirectory makefiles
 # ============================================================
 
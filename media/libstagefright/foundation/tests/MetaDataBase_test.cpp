@@ -0,0 +1,97 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MetaDataBase_test"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/MetaDataBase.h>
+
+namespace android {
+
+TEST(MetaDataBase_test, copies_are_independent) {
+    static const uint8_t kCsd[] = { 0x01, 0x64, 0x00, 0x1f, 0xff, 0xe1, 0x00, 0x17 };
+    MetaDataBase format;
+    format.setCString(kKeyMIMEType, "video/avc");
+    format.setInt32(kKeyWidth, 1920);
+    format.setData(kKeyAVCC, kTypeAVCC, kCsd, sizeof(kCsd));
+
+    MetaDataBase sample(format);
+    MetaDataBase other;
+    other = format;
+    sample.setInt64(kKeyTime, 33366);
+    sample.setInt32(kKeyWidth, 1280);
+    other.remove(kKeyMIMEType);
+
+    int32_t width;
+    int64_t timeUs;
+    const char *mime;
+    ASSERT_TRUE(format.findInt32(kKeyWidth, &width));
+    EXPECT_EQ(1920, width);
+    EXPECT_FALSE(format.findInt64(kKeyTime, &timeUs));
+    ASSERT_TRUE(format.findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ("video/avc", mime);
+
+    ASSERT_TRUE(sample.findInt32(kKeyWidth, &width));
+    EXPECT_EQ(1280, width);
+    ASSERT_TRUE(sample.findInt64(kKeyTime, &timeUs));
+    EXPECT_EQ(33366, timeUs);
+    ASSERT_TRUE(sample.findCString(kKeyMIMEType, &mime));
+
+    EXPECT_FALSE(other.hasData(kKeyMIMEType));
+    uint32_t type;
+    const void *data;
+    size_t size;
+    ASSERT_TRUE(other.findData(kKeyAVCC, &type, &data, &size));
+    EXPECT_EQ((uint32_t)kTypeAVCC, type);
+    ASSERT_EQ(sizeof(kCsd), size);
+    EXPECT_EQ(0, memcmp(kCsd, data, size));
+
+    sample.clear();
+    EXPECT_FALSE(sample.hasData(kKeyWidth));
+    EXPECT_TRUE(format.hasData(kKeyWidth));
+    EXPECT_TRUE(other.hasData(kKeyWidth));
+}
+
+TEST(MetaDataBase_test, generation_and_entries) {
+    MetaDataBase format;
+    format.setInt32(kKeyWidth, 1920);
+    format.setInt32(kKeyHeight, 1080);
+    const uint64_t generation = format.generation();
+
+    MetaDataBase copy(format);
+    EXPECT_EQ(generation, copy.generation());
+    copy.setInt32(kKeyWidth, 1920);
+    EXPECT_NE(generation, copy.generation());
+    EXPECT_EQ(generation, format.generation());
+
+    format.setInt64(kKeyDuration, 1000000);
+    EXPECT_NE(generation, format.generation());
+    EXPECT_NE(copy.generation(), format.generation());
+
+    ASSERT_EQ(3u, format.countEntries());
+    bool foundDuration = false;
+    for (size_t i = 0; i < format.countEntries(); ++i) {
+        EXPECT_TRUE(format.hasData(format.getEntryKeyAt(i)));
+        foundDuration |= format.getEntryKeyAt(i) == kKeyDuration;
+    }
+    EXPECT_TRUE(foundDuration);
+}
+
+}  // namespace android
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "avc_utils_test"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/avc_utils.h>
+
+namespace android {
+
+static size_t naiveFindNALStartCode(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i + 2 < size; ++i) {
+        if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01) {
+            return i;
+        }
+    }
+    return size;
+}
+
+TEST(avc_utils_test, find_start_code) {
+    // bytes from {0, 1, 2} make start codes and near misses frequent.
+    std::vector<uint8_t> data(64);
+    srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        const size_t size = rand() % data.size();
+        for (size_t j = 0; j < size; ++j) {
+            data[j] = rand() % 3;
+        }
+        ASSERT_EQ(naiveFindNALStartCode(data.data(), size),
+                  findNALStartCode(data.data(), size)) << "iteration " << i;
+    }
+}
+
+TEST(avc_utils_test, next_nal_unit) {
+    const uint8_t stream[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00,
+        0x00, 0x00, 0x01, 0x68, 0xce,
+        0x00, 0x00, 0x01, 0x65, 0x88, 0x00, 0x01,
+    };
+    const uint8_t *data = stream;
+    size_t size = sizeof(stream);
+    const uint8_t *nalStart;
+    size_t nalSize;
+
+    ASSERT_EQ(OK, getNextNALUnit(&data, &size, &nalStart, &nalSize, true));
+    ASSERT_EQ(2u, nalSize);  // the trailing zero belongs to the next start code
+    EXPECT_EQ(0x67, nalStart[0]);
+    ASSERT_EQ(OK, getNextNALUnit(&data, &size, &nalStart, &nalSize, true));
+    ASSERT_EQ(2u, nalSize);
+    EXPECT_EQ(0x68, nalStart[0]);
+    ASSERT_EQ(OK, getNextNALUnit(&data, &size, &nalStart, &nalSize, true));
+    ASSERT_EQ(4u, nalSize);
+    EXPECT_EQ(0x65, nalStart[0]);
+    EXPECT_EQ(0u, size);
+
+    // without a following start code the last unit is incomplete.
+    data = &stream[12];
+    size = sizeof(stream) - 12;
+    EXPECT_EQ(-EAGAIN, getNextNALUnit(&data, &size, &nalStart, &nalSize, false));
+}
+
+TEST(avc_utils_test, start_code_scan_speed) {
+    // a synthetic slice: random payload with emulation prevention, one start code at the end.
+    std::vector<uint8_t> data(1 << 20);
+    srand(2);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = 2 + rand() % 254;
+    }
+    data[data.size() - 3] = 0x00;
+    data[data.size() - 2] = 0x00;
+    data[data.size() - 1] = 0x01;
+
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 16; ++i) {
+        found += naiveFindNALStartCode(data.data(), data.size());
+    }
+    const auto naive = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 16; ++i) {
+        found -= findNALStartCode(data.data(), data.size());
+    }
+    const auto fast = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(0u, found);
+    // Timing depends on the device and load, so only report it.
+    std::cout << "start code scan of 1 MiB: naive "
+              << std::chrono::duration_cast<std::chrono::microseconds>(naive).count() / 16
+              << " us, memchr "
+              << std::chrono::duration_cast<std::chrono::microseconds>(fast).count() / 16
+              << " us" << std::endl;
+}
+
+TEST(avc_utils_test, bit_reader_wide_reads) {
+    const uint8_t data[] = {
+        0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x0f, 0xed, 0xcb,
+    };
+    ABitReader bits(data, sizeof(data));
+    EXPECT_EQ(0x1u, bits.getBits(4));
+    EXPECT_EQ(0x23456789u, bits.getBits(32));
+    EXPECT_EQ(88u - 36, bits.numBitsLeft());
+    bits.putBits(0x789, 12);
+    EXPECT_EQ(0x789abcdeu, bits.getBits(32));
+    bits.skipBits(4);
+    EXPECT_EQ(0x00fedcbu, bits.getBits(28));
+    EXPECT_EQ(0u, bits.numBitsLeft());
+    uint32_t value;
+    EXPECT_FALSE(bits.getBitsGraceful(1, &value));
+}
+
+TEST(avc_utils_test, hevc_reference_frame) {
+    // start code, a two byte NAL header (nal_unit_type << 1, nuh_temporal_id_plus1), payload
+    auto accessUnit = [](uint8_t nalType, uint8_t temporalId) {
+        const uint8_t data[] = {
+            0x00, 0x00, 0x00, 0x01, (uint8_t)(nalType << 1), (uint8_t)(temporalId + 1), 0xaf,
+        };
+        return sp<ABuffer>(ABuffer::CreateAsCopy(data, sizeof(data)));
+    };
+    uint32_t maxTemporalId = 0;
+    EXPECT_TRUE(IsHEVCReferenceFrame(accessUnit(19 /* IDR_W_RADL */, 0), &maxTemporalId));
+    EXPECT_TRUE(IsHEVCReferenceFrame(accessUnit(1 /* TRAIL_R */, 1), &maxTemporalId));
+    EXPECT_EQ(1u, maxTemporalId);
+    EXPECT_FALSE(IsHEVCReferenceFrame(accessUnit(0 /* TRAIL_N */, 1), &maxTemporalId));
+    // a lower sub-layer may still be referenced by a higher one.
+    EXPECT_TRUE(IsHEVCReferenceFrame(accessUnit(0 /* TRAIL_N */, 0), &maxTemporalId));
+}
+
+}  // namespace android
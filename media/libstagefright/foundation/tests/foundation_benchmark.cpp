@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks for the stagefright foundation primitives.
+// Run on device with
+//   adb shell /data/benchmarktest/sf_foundation_benchmark/sf_foundation_benchmark
+// and compare runs with --benchmark_filter to measure a single change.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "foundation_benchmark"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <media/stagefright/MediaBufferBase.h>
+#include <media/stagefright/MediaBufferGroup.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/foundation/base64.h>
+
+namespace android {
+
+enum {
+    kWhatPing = 'ping',
+    kWhatPost = 'post',
+};
+
+struct EchoHandler : public AHandler {
+    void waitFor(int64_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCondition.wait(lock, [&] { return mReceived >= count; });
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        switch (msg->what()) {
+            case kWhatPing:
+            {
+                sp<AReplyToken> replyID;
+                CHECK(msg->senderAwaitsResponse(&replyID));
+                (new AMessage)->postReply(replyID);
+                break;
+            }
+
+            case kWhatPost:
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                ++mReceived;
+                mCondition.notify_all();
+                break;
+            }
+        }
+    }
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int64_t mReceived = 0;
+};
+
+// ALooper
+
+static void BM_ALooper_roundTrip(benchmark::State &state) {
+    sp<ALooper> looper = new ALooper;
+    looper->setName("foundation_benchmark");
+    looper->start();
+    sp<EchoHandler> handler = new EchoHandler;
+    looper->registerHandler(handler);
+
+    for (auto _ : state) {
+        sp<AMessage> response;
+        (new AMessage(kWhatPing, handler))->postAndAwaitResponse(&response);
+    }
+
+    looper->unregisterHandler(handler->id());
+    looper->stop();
+}
+BENCHMARK(BM_ALooper_roundTrip);
+
+static void BM_ALooper_postThroughput(benchmark::State &state) {
+    sp<ALooper> looper = new ALooper;
+    looper->setName("foundation_benchmark");
+    looper->start();
+    sp<EchoHandler> handler = new EchoHandler;
+    looper->registerHandler(handler);
+
+    int64_t posted = 0;
+    for (auto _ : state) {
+        (new AMessage(kWhatPost, handler))->post();
+        ++posted;
+    }
+    handler->waitFor(posted);
+    state.SetItemsProcessed(posted);
+
+    looper->unregisterHandler(handler->id());
+    looper->stop();
+}
+BENCHMARK(BM_ALooper_postThroughput);
+
+// AMessage
+
+static void BM_AMessage_setFind(benchmark::State &state) {
+    const int32_t numItems = state.range(0);
+    AString names[64];
+    for (int32_t i = 0; i < numItems; ++i) {
+        names[i] = AStringPrintf("key-%d", i);
+    }
+
+    for (auto _ : state) {
+        sp<AMessage> msg = new AMessage;
+        for (int32_t i = 0; i < numItems; ++i) {
+            msg->setInt32(names[i].c_str(), i);
+        }
+        int32_t sum = 0;
+        for (int32_t i = 0; i < numItems; ++i) {
+            int32_t value;
+            if (msg->findInt32(names[i].c_str(), &value)) {
+                sum += value;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_AMessage_setFind)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_AMessage_dup(benchmark::State &state) {
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", "video/avc");
+    format->setInt32("width", 1920);
+    format->setInt32("height", 1080);
+    format->setInt64("durationUs", 60000000ll);
+    format->setBuffer("csd-0", new ABuffer(32));
+    format->setBuffer("csd-1", new ABuffer(8));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(format->dup());
+    }
+}
+BENCHMARK(BM_AMessage_dup);
+
+// ABuffer
+
+static void BM_ABuffer_createCopy(benchmark::State &state) {
+    std::vector<uint8_t> data(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ABuffer::CreateAsCopy(data.data(), data.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ABuffer_createCopy)->Arg(64)->Arg(4096)->Arg(65536);
+
+static void BM_ABuffer_slice(benchmark::State &state) {
+    sp<ABuffer> buffer = new ABuffer(65536);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer->slice(1024, 4096));
+    }
+}
+BENCHMARK(BM_ABuffer_slice);
+
+// MediaBufferGroup
+
+static void BM_MediaBufferGroup_acquireRelease(benchmark::State &state) {
+    MediaBufferGroup group(4 /* buffers */, 4096 /* buffer_size */);
+    for (auto _ : state) {
+        MediaBufferBase *buffer;
+        if (group.acquire_buffer(&buffer) != OK) {
+            state.SkipWithError("acquire_buffer failed");
+            break;
+        }
+        buffer->release();
+    }
+}
+BENCHMARK(BM_MediaBufferGroup_acquireRelease);
+
+// AString
+
+static void BM_AString_append(benchmark::State &state) {
+    for (auto _ : state) {
+        AString s;
+        for (int32_t i = 0; i < 16; ++i) {
+            s.append("key=");
+            s.append(i);
+            s.append(", ");
+        }
+        benchmark::DoNotOptimize(s.c_str());
+    }
+}
+BENCHMARK(BM_AString_append);
+
+static void BM_AStringPrintf(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AStringPrintf("%s.%d.%lld", "looper", 42, 123456789ll));
+    }
+}
+BENCHMARK(BM_AStringPrintf);
+
+// base64
+
+static void BM_base64_encodeDecode(benchmark::State &state) {
+    std::vector<uint8_t> data(state.range(0));
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i * 37;
+    }
+    for (auto _ : state) {
+        AString encoded;
+        encodeBase64(data.data(), data.size(), &encoded);
+        benchmark::DoNotOptimize(decodeBase64(encoded));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_base64_encodeDecode)->Arg(64)->Arg(4096);
+
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "HTTPConnectionPool"
+#include <utils/Log.h>
+
+#include "HTTPConnectionPool.h"
+
+#include <media/MediaHTTPService.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+
+#include "include/HTTPBase.h"
+
+namespace android {
+
+// shorter than the keep-alive timeout of common servers, so that an idle connection
+// has not been closed by the other end yet.
+static const int64_t kMaxIdleUs = 30000000LL;
+static const size_t kMaxIdleConnections = 8;
+
+static Mutex gPoolLock;
+static sp<HTTPConnectionPool> gPool;
+
+// static
+sp<HTTPConnectionPool> HTTPConnectionPool::getInstance() {
+    Mutex::Autolock autoLock(gPoolLock);
+    if (gPool == NULL) {
+        gPool = new HTTPConnectionPool;
+    }
+    return gPool;
+}
+
+// static
+AString HTTPConnectionPool::GetOrigin(const char *url) {
+    AString origin(url);
+    ssize_t schemeEnd = origin.find("://");
+    if (schemeEnd < 0) {
+        return AString();
+    }
+    ssize_t hostEnd = origin.find("/", schemeEnd + 3);
+    if (hostEnd >= 0) {
+        origin.erase(hostEnd, origin.size() - hostEnd);
+    }
+    // drop credentials, they are not part of the origin.
+    ssize_t at = origin.find("@", schemeEnd + 3);
+    if (at >= 0) {
+        origin.erase(schemeEnd + 3, at + 1 - (schemeEnd + 3));
+    }
+    origin.tolower();
+    return origin;
+}
+
+HTTPConnectionPool::HTTPConnectionPool() {
+}
+
+HTTPConnectionPool::~HTTPConnectionPool() {
+}
+
+sp<HTTPBase> HTTPConnectionPool::acquire(
+        const sp<MediaHTTPService> &httpService, const AString &origin) {
+    Vector<Entry> expired;
+    sp<HTTPBase> connection;
+    {
+        Mutex::Autolock autoLock(mLock);
+        pruneExpired_l(ALooper::GetNowUs(), &expired);
+
+        // the most recently used connection is the most likely to be still open.
+        for (size_t i = mEntries.size(); i-- > 0;) {
+            const Entry &entry = mEntries[i];
+            if (entry.mHTTPService == httpService && entry.mOrigin == origin) {
+                connection = entry.mConnection;
+                mEntries.removeAt(i);
+                break;
+            }
+        }
+    }
+    ALOGV("%s connection to %s", connection != NULL ? "reusing" : "no idle", origin.c_str());
+    // expired connections go away here, outside of mLock.
+    return connection;
+}
+
+void HTTPConnectionPool::release(
+        const sp<MediaHTTPService> &httpService, const AString &origin,
+        const sp<HTTPBase> &connection) {
+    if (connection == NULL || origin.empty()) {
+        return;
+    }
+
+    Vector<Entry> expired;
+    {
+        Mutex::Autolock autoLock(mLock);
+        int64_t nowUs = ALooper::GetNowUs();
+        pruneExpired_l(nowUs, &expired);
+
+        Entry entry;
+        entry.mHTTPService = httpService;
+        entry.mOrigin = origin;
+        entry.mConnection = connection;
+        entry.mIdleSinceUs = nowUs;
+        mEntries.push_back(entry);
+
+        while (mEntries.size() > kMaxIdleConnections) {
+            expired.push_back(mEntries[0]);
+            mEntries.removeAt(0);
+        }
+    }
+}
+
+void HTTPConnectionPool::pruneExpired_l(int64_t nowUs, Vector<Entry> *expired) {
+    while (!mEntries.empty() && nowUs - mEntries[0].mIdleSinceUs > kMaxIdleUs) {
+        expired->push_back(mEntries[0]);
+        mEntries.removeAt(0);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_CONNECTION_POOL_H_
+
+#define HTTP_CONNECTION_POOL_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct HTTPBase;
+struct MediaHTTPService;
+
+// Idle HTTP connections of the process by origin (scheme, host and port), shared
+// by the downloaders of all HLS sessions. Fetching a playlist, key or segment from
+// a host used recently then reuses its connection, and the keep-alive socket
+// behind it, instead of setting up a new one.
+struct HTTPConnectionPool : public RefBase {
+    static sp<HTTPConnectionPool> getInstance();
+
+    // "scheme://host[:port]" of url in lower case, empty if url has no host.
+    static AString GetOrigin(const char *url);
+
+    // Returns an idle connection to origin made by httpService, or NULL.
+    sp<HTTPBase> acquire(const sp<MediaHTTPService> &httpService, const AString &origin);
+
+    // Hands a connection that is not in use any more back to the pool.
+    void release(
+            const sp<MediaHTTPService> &httpService, const AString &origin,
+            const sp<HTTPBase> &connection);
+
+protected:
+    virtual ~HTTPConnectionPool();
+
+private:
+    struct Entry {
+        sp<MediaHTTPService> mHTTPService;
+        AString mOrigin;
+        sp<HTTPBase> mConnection;
+        int64_t mIdleSinceUs;
+    };
+
+    Mutex mLock;
+    Vector<Entry> mEntries;     // oldest first
+
+    HTTPConnectionPool();
+
+    // moves the entries idle for too long to expired.
+    void pruneExpired_l(int64_t nowUs, Vector<Entry> *expired);
+
+    DISALLOW_EVIL_CONSTRUCTORS(HTTPConnectionPool);
+};
+
+}  // namespace android
+
+#endif  // HTTP_CONNECTION_POOL_H_
@@ -18,14 +18,17 @@
 #define LOG_TAG "HTTPDownloader"
 #include <utils/Log.h>
 
+#include "HTTPConnectionPool.h"
 #include "HTTPDownloader.h"
 #include "M3UParser.h"
+#include "include/DiskCache.h"
 
 #include <media/DataSource.h>
 #include <media/MediaHTTPConnection.h>
 #include <media/MediaHTTPService.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/ClearMediaHTTP.h>
 #include <media/stagefright/ClearFileSource.h>
 #include <openssl/aes.h>
@@ -35,25 +38,109 @@
 
 namespace android {
 
+// A resource read back from the disk cache.
+struct DiskCacheSource : public DataSource {
+    explicit DiskCacheSource(const sp<ABuffer> &buffer)
+        : mBuffer(buffer) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset < 0 || offset >= (off64_t)mBuffer->size()) {
+            return 0;
+        }
+        if (size > mBuffer->size() - offset) {
+            size = mBuffer->size() - offset;
+        }
+        memcpy(data, mBuffer->data() + offset, size);
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mBuffer->size();
+        return OK;
+    }
+
+private:
+    sp<ABuffer> mBuffer;
+
+    DISALLOW_EVIL_CONSTRUCTORS(DiskCacheSource);
+};
+
 HTTPDownloader::HTTPDownloader(
         const sp<MediaHTTPService> &httpService,
-        const KeyedVector<String8, String8> &headers) :
-    mHTTPDataSource(new ClearMediaHTTP(httpService->makeHTTPConnection())),
+        const KeyedVector<String8, String8> &headers,
+        const sp<HTTPDownloadStats> &stats) :
+    mHTTPService(httpService),
+    mStats(stats),
+    mConnectTimeUs(-1LL),
+    mDiskCache(DiskCache::getInstance()),
+    mStoreInDiskCache(false),
+    mDiskCacheRangeOffset(0),
+    mDiskCacheRangeLength(-1),
+    mFromDiskCache(false),
     mExtraHeaders(headers),
     mDisconnecting(false) {
 }
 
+HTTPDownloader::~HTTPDownloader() {
+    if (!mDisconnecting) {
+        HTTPConnectionPool::getInstance()->release(mHTTPService, mOrigin, mHTTPDataSource);
+    }
+}
+
+void HTTPDownloader::setOrigin(const AString &origin) {
+    sp<HTTPBase> previous;
+    {
+        AutoMutex _l(mLock);
+        if (mHTTPDataSource != NULL && mOrigin == origin) {
+            return;
+        }
+        previous = mHTTPDataSource;
+    }
+    sp<HTTPConnectionPool> pool = HTTPConnectionPool::getInstance();
+    if (previous != NULL) {
+        if (mDataSource == previous) {
+            mDataSource.clear();
+        }
+        pool->release(mHTTPService, mOrigin, previous);
+    }
+
+    sp<HTTPBase> connection = pool->acquire(mHTTPService, origin);
+    if (connection != NULL) {
+        if (mStats != NULL) {
+            ++mStats->mNumReusedConnections;
+        }
+    } else {
+        connection = new ClearMediaHTTP(mHTTPService->makeHTTPConnection());
+        if (mStats != NULL) {
+            ++mStats->mNumConnections;
+        }
+    }
+
+    AutoMutex _l(mLock);
+    mHTTPDataSource = connection;
+    mOrigin = origin;
+}
+
 void HTTPDownloader::reconnect() {
     AutoMutex _l(mLock);
     mDisconnecting = false;
 }
 
 void HTTPDownloader::disconnect() {
+    sp<HTTPBase> source;
     {
         AutoMutex _l(mLock);
         mDisconnecting = true;
+        source = mHTTPDataSource;
+    }
+    if (source != NULL) {
+        source->disconnect();
     }
-    mHTTPDataSource->disconnect();
 }
 
 bool HTTPDownloader::isDisconnecting() {
@@ -61,6 +148,10 @@ bool HTTPDownloader::isDisconnecting() {
     return mDisconnecting;
 }
 
+bool HTTPDownloader::isFromDiskCache() const {
+    return mFromDiskCache;
+}
+
 /*
  * Illustration of parameters:
  *
@@ -83,6 +174,16 @@ ssize_t HTTPDownloader::fetchBlock(
         uint32_t block_size, /* download block size */
         String8 *actualUrl,
         bool reconnect /* force connect HTTP when resuing source */) {
+    return fetchBlockInternal(
+            url, out, range_offset, range_length, block_size, actualUrl, reconnect,
+            true /* useDiskCache */);
+}
+
+ssize_t HTTPDownloader::fetchBlockInternal(
+        const char *url, sp<ABuffer> *out,
+        int64_t range_offset, int64_t range_length,
+        uint32_t block_size, String8 *actualUrl, bool reconnect,
+        bool useDiskCache) {
     if (isDisconnecting()) {
         return ERROR_NOT_CONNECTED;
     }
@@ -90,7 +191,18 @@ ssize_t HTTPDownloader::fetchBlock(
     off64_t size;
 
     if (reconnect) {
-        if (!strncasecmp(url, "file://", 7)) {
+        mStoreInDiskCache = false;
+        mFromDiskCache = false;
+        sp<ABuffer> cached;
+        if (useDiskCache && mDiskCache != NULL && strncasecmp(url, "file://", 7)) {
+            cached = mDiskCache->lookup(AString(url), range_offset, range_length);
+        }
+
+        if (cached != NULL) {
+            ALOGV("'%s' from the disk cache", url);
+            mDataSource = new DiskCacheSource(cached);
+            mFromDiskCache = true;
+        } else if (!strncasecmp(url, "file://", 7)) {
             mDataSource = new ClearFileSource(url + 7);
         } else if (strncasecmp(url, "http://", 7)
                 && strncasecmp(url, "https://", 8)) {
@@ -109,6 +221,8 @@ ssize_t HTTPDownloader::fetchBlock(
                                             range_offset + range_length - 1).c_str()).c_str()));
             }
 
+            setOrigin(HTTPConnectionPool::GetOrigin(url));
+            mConnectTimeUs = ALooper::GetNowUs();
             status_t err = mHTTPDataSource->connect(url, &headers);
 
             if (isDisconnecting()) {
@@ -120,6 +234,11 @@ ssize_t HTTPDownloader::fetchBlock(
             }
 
             mDataSource = mHTTPDataSource;
+
+            mStoreInDiskCache = useDiskCache && mDiskCache != NULL;
+            mDiskCacheURL = url;
+            mDiskCacheRangeOffset = range_offset;
+            mDiskCacheRangeLength = range_length;
         }
     }
 
@@ -139,6 +258,7 @@ ssize_t HTTPDownloader::fetchBlock(
     }
 
     ssize_t bytesRead = 0;
+    bool eof = false;
     // adjust range_length if only reading partial block
     if (block_size > 0 && (range_length == -1 || (int64_t)(buffer->size() + block_size) < range_length)) {
         range_length = buffer->size() + block_size;
@@ -198,7 +318,16 @@ ssize_t HTTPDownloader::fetchBlock(
             return n;
         }
 
+        if (n > 0 && mConnectTimeUs >= 0 && mDataSource == mHTTPDataSource) {
+            if (mStats != NULL) {
+                ++mStats->mNumRequests;
+                mStats->mTotalTimeToFirstByteUs += ALooper::GetNowUs() - mConnectTimeUs;
+            }
+            mConnectTimeUs = -1LL;
+        }
+
         if (n == 0) {
+            eof = true;
             break;
         }
 
@@ -206,6 +335,15 @@ ssize_t HTTPDownloader::fetchBlock(
         bytesRead += n;
     }
 
+    // whole resource or range downloaded
+    if (mStoreInDiskCache && mDataSource == mHTTPDataSource
+            && (mDiskCacheRangeLength < 0
+                    ? eof && buffer->size() > 0
+                    : (int64_t)buffer->size() == mDiskCacheRangeLength)) {
+        mStoreInDiskCache = false;
+        mDiskCache->insert(mDiskCacheURL, mDiskCacheRangeOffset, mDiskCacheRangeLength, buffer);
+    }
+
     *out = buffer;
     if (actualUrl != NULL) {
         *actualUrl = mDataSource->getUri();
@@ -219,10 +357,13 @@ ssize_t HTTPDownloader::fetchBlock(
 
 ssize_t HTTPDownloader::fetchFile(
         const char *url, sp<ABuffer> *out, String8 *actualUrl) {
-    ssize_t err = fetchBlock(url, out, 0, -1, 0, actualUrl, true /* reconnect */);
+    ssize_t err = fetchBlockInternal(
+            url, out, 0, -1, 0, actualUrl, true /* reconnect */, false /* useDiskCache */);
 
     // close off the connection after use
-    mHTTPDataSource->disconnect();
+    if (mHTTPDataSource != NULL) {
+        mHTTPDataSource->disconnect();
+    }
 
     return err;
 }
@@ -238,7 +379,9 @@ sp<M3UParser> HTTPDownloader::fetchPlaylist(
     ssize_t err = fetchFile(url, &buffer, &actualUrl);
 
     // close off the connection after use
-    mHTTPDataSource->disconnect();
+    if (mHTTPDataSource != NULL) {
+        mHTTPDataSource->disconnect();
+    }
 
     if (err <= 0) {
         return NULL;
@@ -18,7 +18,10 @@
 
 #define HTTP_DOWNLOADER_H_
 
+#include <atomic>
+
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AString.h>
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/RefBase.h>
@@ -27,14 +30,40 @@ namespace android {
 
 struct ABuffer;
 class DataSource;
+struct DiskCache;
 struct HTTPBase;
 struct MediaHTTPService;
 struct M3UParser;
 
+// Connection statistics, shared by the downloaders of a session.
+struct HTTPDownloadStats : public RefBase {
+    HTTPDownloadStats()
+        : mNumConnections(0),
+          mNumReusedConnections(0),
+          mNumRequests(0),
+          mTotalTimeToFirstByteUs(0) {
+    }
+
+    std::atomic<int32_t> mNumConnections;         // made for the session
+    std::atomic<int32_t> mNumReusedConnections;   // taken from the connection pool
+    std::atomic<int32_t> mNumRequests;            // with a time to first byte
+    std::atomic<int64_t> mTotalTimeToFirstByteUs;
+
+protected:
+    virtual ~HTTPDownloadStats() {}
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(HTTPDownloadStats);
+};
+
+// Downloads through connections of the process wide HTTPConnectionPool: a
+// connection is reused for requests to the same origin and handed back to the
+// pool when the downloader moves to another origin or goes away.
 struct HTTPDownloader : public RefBase {
     HTTPDownloader(
             const sp<MediaHTTPService> &httpService,
-            const KeyedVector<String8, String8> &headers);
+            const KeyedVector<String8, String8> &headers,
+            const sp<HTTPDownloadStats> &stats = NULL);
 
     void reconnect();
     void disconnect();
@@ -70,14 +99,44 @@ struct HTTPDownloader : public RefBase {
     sp<M3UParser> fetchPlaylist(
             const char *url, uint8_t *curPlaylistHash, bool *unchanged);
 
+    // Whether the data of the last fetchBlock() came from the disk cache, and
+    // says nothing about the network bandwidth.
+    bool isFromDiskCache() const;
+
+protected:
+    virtual ~HTTPDownloader();
+
 private:
+    sp<MediaHTTPService> mHTTPService;
+    sp<HTTPDownloadStats> mStats;
+    AString mOrigin;                // of mHTTPDataSource
+    int64_t mConnectTimeUs;         // of the request waiting for its first byte, or -1
     sp<HTTPBase> mHTTPDataSource;
+    sp<DiskCache> mDiskCache;
+    // the resource of the current fetchBlock() download, when it is to be stored in
+    // mDiskCache once complete.
+    bool mStoreInDiskCache;
+    AString mDiskCacheURL;
+    int64_t mDiskCacheRangeOffset;
+    int64_t mDiskCacheRangeLength;
+    bool mFromDiskCache;
     sp<DataSource> mDataSource;
     KeyedVector<String8, String8> mExtraHeaders;
 
-    Mutex mLock;
+    Mutex mLock;                    // guards mDisconnecting and mHTTPDataSource
     bool mDisconnecting;
 
+    // Makes mHTTPDataSource a connection to origin, from the pool if possible.
+    void setOrigin(const AString &origin);
+
+    // Playlists change and keys are not to be written out, so only fetchBlock()
+    // callers use the disk cache.
+    ssize_t fetchBlockInternal(
+            const char *url, sp<ABuffer> *out,
+            int64_t range_offset, int64_t range_length,
+            uint32_t block_size, String8 *actualUrl, bool reconnect,
+            bool useDiskCache);
+
     DISALLOW_EVIL_CONSTRUCTORS(HTTPDownloader);
 };
 
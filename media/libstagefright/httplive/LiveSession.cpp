@@ -48,6 +48,7 @@ const int64_t LiveSession::kUpSwitchMarkUs = 15000000LL;
 const int64_t LiveSession::kDownSwitchMarkUs = 20000000LL;
 const int64_t LiveSession::kUpSwitchMarginUs = 5000000LL;
 const int64_t LiveSession::kResumeThresholdUs = 100000LL;
+const int64_t LiveSession::kMinUpSwitchIntervalUs = 10000000LL;
 
 //TODO: redefine this mark to a fair value
 // default buffer underflow mark
@@ -60,11 +61,13 @@ struct LiveSession::BandwidthEstimator : public RefBase {
     bool estimateBandwidth(
             int32_t *bandwidth,
             bool *isStable = NULL,
-            int32_t *shortTermBps = NULL);
+            int32_t *shortTermBps = NULL,
+            int32_t *harmonicMeanBps = NULL);
 
 private:
     // Bandwidth estimation parameters
     static const int32_t kShortTermBandwidthItems = 3;
+    static const int32_t kHarmonicMeanBandwidthItems = 5;
     static const int32_t kMinBandwidthHistoryItems = 20;
     static const int64_t kMinBandwidthHistoryWindowUs = 5000000LL; // 5 sec
     static const int64_t kMaxBandwidthHistoryWindowUs = 30000000LL; // 30 sec
@@ -80,6 +83,7 @@ private:
     List<BandwidthEntry> mBandwidthHistory;
     List<int32_t> mPrevEstimates;
     int32_t mShortTermEstimate;
+    int32_t mHarmonicMeanEstimate;
     bool mHasNewSample;
     bool mIsStable;
     int64_t mTotalTransferTimeUs;
@@ -90,6 +94,7 @@ private:
 
 LiveSession::BandwidthEstimator::BandwidthEstimator() :
     mShortTermEstimate(0),
+    mHarmonicMeanEstimate(0),
     mHasNewSample(false),
     mIsStable(true),
     mTotalTransferTimeUs(0),
@@ -137,7 +142,8 @@ void LiveSession::BandwidthEstimator::addBandwidthMeasurement(
 }
 
 bool LiveSession::BandwidthEstimator::estimateBandwidth(
-        int32_t *bandwidthBps, bool *isStable, int32_t *shortTermBps) {
+        int32_t *bandwidthBps, bool *isStable, int32_t *shortTermBps,
+        int32_t *harmonicMeanBps) {
     AutoMutex autoLock(mLock);
 
     if (mBandwidthHistory.size() < 2) {
@@ -152,6 +158,9 @@ bool LiveSession::BandwidthEstimator::estimateBandwidth(
         if (shortTermBps) {
             *shortTermBps = mShortTermEstimate;
         }
+        if (harmonicMeanBps) {
+            *harmonicMeanBps = mHarmonicMeanEstimate;
+        }
         return true;
     }
 
@@ -177,6 +186,27 @@ bool LiveSession::BandwidthEstimator::estimateBandwidth(
         *shortTermBps = mShortTermEstimate;
     }
 
+    // The harmonic mean of the recent per-sample throughputs follows dips
+    // quickly and is not inflated by a few fast samples, unlike the averages
+    // above which are weighted by transfer time.
+    double inverseSum = 0;
+    int32_t numSamples = 0;
+    List<BandwidthEntry>::iterator entry = mBandwidthHistory.end();
+    while (entry != mBandwidthHistory.begin()
+            && numSamples < kHarmonicMeanBandwidthItems) {
+        --entry;
+        if (entry->mNumBytes == 0 || entry->mDelayUs <= 0) {
+            continue;
+        }
+        inverseSum += entry->mDelayUs / (entry->mNumBytes * 8E6);
+        ++numSamples;
+    }
+    mHarmonicMeanEstimate = numSamples > 0 ?
+            (int32_t)(numSamples / inverseSum) : *bandwidthBps;
+    if (harmonicMeanBps) {
+        *harmonicMeanBps = mHarmonicMeanEstimate;
+    }
+
     int64_t minEstimate = -1, maxEstimate = -1;
     List<int32_t>::iterator it;
     for (it = mPrevEstimates.begin(); it != mPrevEstimates.end(); it++) {
@@ -287,6 +317,10 @@ LiveSession::LiveSession(
       mLastBandwidthBps(-1LL),
       mLastBandwidthStable(false),
       mBandwidthEstimator(new BandwidthEstimator()),
+      mLastSwitchTimeUs(-1LL),
+      mNumUpSwitches(0),
+      mNumDownSwitches(0),
+      mHTTPStats(new HTTPDownloadStats),
       mMaxWidth(720),
       mMaxHeight(480),
       mStreamMask(0),
@@ -490,8 +524,26 @@ status_t LiveSession::getStreamFormatMeta(StreamType stream, sp<MetaData> *meta)
     return OK;
 }
 
+sp<AMessage> LiveSession::getStats() const {
+    sp<AMessage> stats = new AMessage;
+    Mutex::Autolock autoLock(mStatsLock);
+    stats->setInt32("bandwidth-up-switches", mNumUpSwitches);
+    stats->setInt32("bandwidth-down-switches", mNumDownSwitches);
+    if (mLastBandwidthBps >= 0) {
+        stats->setInt32("bandwidth-estimate-bps", mLastBandwidthBps);
+    }
+    stats->setInt32("http-connections", mHTTPStats->mNumConnections);
+    stats->setInt32("http-reused-connections", mHTTPStats->mNumReusedConnections);
+    int32_t numRequests = mHTTPStats->mNumRequests;
+    if (numRequests > 0) {
+        stats->setInt64("http-time-to-first-byte-us",
+                mHTTPStats->mTotalTimeToFirstByteUs / numRequests);
+    }
+    return stats;
+}
+
 sp<HTTPDownloader> LiveSession::getHTTPDownloader() {
-    return new HTTPDownloader(mHTTPService, mExtraHeaders);
+    return new HTTPDownloader(mHTTPService, mExtraHeaders, mHTTPStats);
 }
 
 void LiveSession::setBufferingSettings(
@@ -2299,6 +2351,11 @@ bool LiveSession::tryBandwidthFallback() {
         // not on that variant already.
         ssize_t lowestValid = getLowestValidBandwidthIndex();
         if (mCurBandwidthIndex > lowestValid) {
+            {
+                Mutex::Autolock autoLock(mStatsLock);
+                ++mNumDownSwitches;
+            }
+            mLastSwitchTimeUs = ALooper::GetNowUs();
             cancelBandwidthSwitch();
             changeConfiguration(-1LL, lowestValid);
             return true;
@@ -2325,13 +2382,15 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
         return false;
     }
 
-    int32_t bandwidthBps, shortTermBps;
+    int32_t bandwidthBps, shortTermBps, harmonicMeanBps;
     bool isStable;
     if (mBandwidthEstimator->estimateBandwidth(
-            &bandwidthBps, &isStable, &shortTermBps)) {
+            &bandwidthBps, &isStable, &shortTermBps, &harmonicMeanBps)) {
         ALOGV("bandwidth estimated at %.2f kbps, "
-                "stable %d, shortTermBps %.2f kbps",
-                bandwidthBps / 1024.0f, isStable, shortTermBps / 1024.0f);
+                "stable %d, shortTermBps %.2f kbps, harmonicMeanBps %.2f kbps",
+                bandwidthBps / 1024.0f, isStable, shortTermBps / 1024.0f,
+                harmonicMeanBps / 1024.0f);
+        Mutex::Autolock autoLock(mStatsLock);
         mLastBandwidthBps = bandwidthBps;
         mLastBandwidthStable = isStable;
     } else {
@@ -2339,6 +2398,20 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
         return false;
     }
 
+    // Only switch up on the lower of the long term and the harmonic mean
+    // estimate, and not again shortly after a switch, so that a few fast
+    // samples don't make playback bounce between variants.
+    const int64_t nowUs = ALooper::GetNowUs();
+    if (bufferHigh) {
+        if (harmonicMeanBps < bandwidthBps) {
+            bandwidthBps = harmonicMeanBps;
+        }
+        if (mLastSwitchTimeUs >= 0
+                && nowUs - mLastSwitchTimeUs < kMinUpSwitchIntervalUs) {
+            bufferHigh = false;
+        }
+    }
+
     int32_t curBandwidth = mBandwidthItems.itemAt(mCurBandwidthIndex).mBandwidth;
     // canSwithDown and canSwitchUp can't both be true.
     // we only want to switch up when measured bw is 120% higher than current variant,
@@ -2367,6 +2440,16 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
         // both enough buffer and enough bw.
         if ((canSwitchUp && bandwidthIndex > mCurBandwidthIndex)
          || (canSwitchDown && bandwidthIndex < mCurBandwidthIndex)) {
+            {
+                Mutex::Autolock autoLock(mStatsLock);
+                if (canSwitchUp) {
+                    ++mNumUpSwitches;
+                } else {
+                    ++mNumDownSwitches;
+                }
+            }
+            mLastSwitchTimeUs = nowUs;
+
             // if not yet prepared, just restart again with new bw index.
             // this is faster and playback experience is cleaner.
             changeConfiguration(
@@ -22,6 +22,7 @@
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/mediaplayer.h>
 
+#include <utils/Mutex.h>
 #include <utils/String8.h>
 
 #include "mpeg2ts/ATSParser.h"
@@ -39,6 +40,7 @@ struct M3UParser;
 struct PlaylistFetcher;
 struct HLSTime;
 struct HTTPDownloader;
+struct HTTPDownloadStats;
 
 struct LiveSession : public AHandler {
     enum Flags {
@@ -100,6 +102,9 @@ struct LiveSession : public AHandler {
     bool isSeekable() const;
     bool hasDynamicDuration() const;
 
+    // Variant switches so far and the last bandwidth estimate, for metrics.
+    sp<AMessage> getStats() const;
+
     static const char *getKeyForStream(StreamType type);
     static const char *getNameForStream(StreamType type);
     static ATSParser::SourceType getSourceTypeForStream(StreamType type);
@@ -139,6 +144,8 @@ private:
     static const int64_t kUpSwitchMarkUs;
     static const int64_t kDownSwitchMarkUs;
     static const int64_t kUpSwitchMarginUs;
+    // no up switch for this long after a switch
+    static const int64_t kMinUpSwitchIntervalUs;
     static const int64_t kResumeThresholdUs;
 
     // Buffer Prepare/Ready/Underflow Marks
@@ -204,6 +211,12 @@ private:
     int32_t mLastBandwidthBps;
     bool mLastBandwidthStable;
     sp<BandwidthEstimator> mBandwidthEstimator;
+    int64_t mLastSwitchTimeUs;
+
+    mutable Mutex mStatsLock;   // for getStats(), guards the counters and mLastBandwidthBps
+    int32_t mNumUpSwitches;
+    int32_t mNumDownSwitches;
+    sp<HTTPDownloadStats> mHTTPStats;   // of the downloaders of all fetchers
 
     sp<M3UParser> mPlaylist;
     int32_t mMaxWidth;
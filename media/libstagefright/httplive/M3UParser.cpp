@@ -261,6 +261,10 @@ M3UParser::M3UParser(
       mTargetDurationUs(-1LL),
       mDiscontinuitySeq(0),
       mDiscontinuityCount(0),
+      mPartTargetDurationUs(-1LL),
+      mPartHoldBackUs(-1LL),
+      mCanBlockReload(false),
+      mIsEncrypted(false),
       mSelectedIndex(-1) {
     mInitCheck = parse(data, size);
 }
@@ -337,6 +341,53 @@ bool M3UParser::itemAt(size_t index, AString *uri, sp<AMessage> *meta) {
     return true;
 }
 
+int64_t M3UParser::getPartTargetDuration() const {
+    return mPartTargetDurationUs;
+}
+
+int64_t M3UParser::getPartHoldBack() const {
+    return mPartHoldBackUs;
+}
+
+bool M3UParser::canBlockReload() const {
+    return mCanBlockReload;
+}
+
+bool M3UParser::isEncrypted() const {
+    return mIsEncrypted;
+}
+
+size_t M3UParser::getPartCount(int32_t seqNumber) const {
+    const int32_t segmentIndex = seqNumber - mFirstSeqNumber;
+    size_t count = 0;
+    for (size_t i = 0; i < mParts.size(); ++i) {
+        int32_t index;
+        CHECK(mParts.itemAt(i).mMeta->findInt32("segment-index", &index));
+        if (index == segmentIndex) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool M3UParser::partAt(
+        int32_t seqNumber, size_t partIndex, AString *uri, sp<AMessage> *meta) {
+    const int32_t segmentIndex = seqNumber - mFirstSeqNumber;
+    for (size_t i = 0; i < mParts.size(); ++i) {
+        int32_t index;
+        CHECK(mParts.itemAt(i).mMeta->findInt32("segment-index", &index));
+        if (index != segmentIndex) {
+            continue;
+        }
+        if (partIndex-- == 0) {
+            *uri = mParts.itemAt(i).makeURL(mBaseURI.c_str());
+            *meta = mParts.itemAt(i).mMeta;
+            return true;
+        }
+    }
+    return false;
+}
+
 void M3UParser::pickRandomMediaItems() {
     for (size_t i = 0; i < mMediaGroups.size(); ++i) {
         mMediaGroups.valueAt(i)->pickRandomMediaItems();
@@ -573,6 +624,7 @@ status_t M3UParser::parse(const void *_data, size_t size) {
     const char *data = (const char *)_data;
     size_t offset = 0;
     uint64_t segmentRangeOffset = 0;
+    uint64_t partRangeOffset = 0;
     while (offset < size) {
         size_t offsetLF = offset;
         while (offsetLF < size && data[offsetLF] != '\n') {
@@ -615,6 +667,11 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                     return ERROR_MALFORMED;
                 }
                 err = parseCipherInfo(line, &itemMeta, mBaseURI);
+                AString method;
+                if (err == OK && itemMeta->findString("cipher-method", &method)
+                        && method != "NONE") {
+                    mIsEncrypted = true;
+                }
             } else if (line.startsWith("#EXT-X-ENDLIST")) {
                 mIsComplete = true;
             } else if (line.startsWith("#EXT-X-PLAYLIST-TYPE:EVENT")) {
@@ -671,6 +728,14 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 }
             } else if (line.startsWith("#EXT-X-MEDIA")) {
                 err = parseMedia(line);
+            } else if (line.startsWith("#EXT-X-SERVER-CONTROL")) {
+                err = parseServerControl(line);
+            } else if (line.startsWith("#EXT-X-PART-INF")) {
+                err = parsePartInf(line);
+            } else if (line.startsWith("#EXT-X-PART")) {
+                err = parsePart(line, false /* preloadHint */, itemMeta, &partRangeOffset);
+            } else if (line.startsWith("#EXT-X-PRELOAD-HINT")) {
+                err = parsePart(line, true /* preloadHint */, itemMeta, &partRangeOffset);
             }
 
             if (err != OK) {
@@ -1282,6 +1347,157 @@ status_t M3UParser::parseMedia(const AString &line) {
             flags);
 }
 
+status_t M3UParser::parseServerControl(const AString &line) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString val;
+    if (attrs->findString("can-block-reload", &val)) {
+        mCanBlockReload = (val == "YES");
+    }
+    double holdBackSecs;
+    if (attrs->findString("part-hold-back", &val)
+            && ParseDouble(val.c_str(), &holdBackSecs) == OK) {
+        mPartHoldBackUs = holdBackSecs * 1E6;
+    }
+    return OK;
+}
+
+status_t M3UParser::parsePartInf(const AString &line) {
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    AString val;
+    double targetSecs;
+    if (!attrs->findString("part-target", &val)
+            || ParseDouble(val.c_str(), &targetSecs) != OK || targetSecs <= 0) {
+        ALOGE("EXT-X-PART-INF without a valid PART-TARGET");
+        return ERROR_MALFORMED;
+    }
+    mPartTargetDurationUs = targetSecs * 1E6;
+    return OK;
+}
+
+status_t M3UParser::parsePart(
+        const AString &line, bool preloadHint, const sp<AMessage> &itemMeta,
+        uint64_t *partRangeOffset) {
+    if (mIsVariantPlaylist) {
+        return ERROR_MALFORMED;
+    }
+
+    sp<AMessage> attrs;
+    status_t err = parseAttributes(line, &attrs);
+    if (err != OK) {
+        return err;
+    }
+
+    Item part;
+    if (!attrs->findString("uri", &part.mURI)) {
+        return ERROR_MALFORMED;
+    }
+    part.mMeta = new AMessage;
+
+    AString val;
+    if (preloadHint) {
+        // hints for the next initialization section are of no use here.
+        if (!attrs->findString("type", &val) || val != "PART") {
+            return OK;
+        }
+        part.mMeta->setInt32("preload-hint", true);
+        if (attrs->findString("byterange-start", &val)) {
+            char *end;
+            uint64_t start = strtoull(val.c_str(), &end, 10);
+            if (end == val.c_str() || *end != ' ') {
+                return ERROR_MALFORMED;
+            }
+            // the server sends the part up to its end, whatever its length.
+            part.mMeta->setInt64("range-offset", start);
+            part.mMeta->setInt64("range-length", -1);
+        }
+    } else {
+        double durationSecs;
+        if (!attrs->findString("duration", &val)
+                || ParseDouble(val.c_str(), &durationSecs) != OK) {
+            return ERROR_MALFORMED;
+        }
+        part.mMeta->setInt64("durationUs", durationSecs * 1E6);
+        if (attrs->findString("independent", &val) && val == "YES") {
+            part.mMeta->setInt32("independent", true);
+        }
+        if (attrs->findString("byterange", &val)) {
+            AString range(":");
+            range.append(val);
+            uint64_t length, offset;
+            err = parseByteRange(range, *partRangeOffset, &length, &offset);
+            if (err != OK) {
+                return err;
+            }
+            part.mMeta->setInt64("range-offset", offset);
+            part.mMeta->setInt64("range-length", length);
+            *partRangeOffset = offset + length;
+        }
+    }
+
+    // a discontinuity applies to the first part of the segment.
+    int32_t discontinuity, lastSegmentIndex = -1;
+    if (!mParts.empty()) {
+        CHECK(mParts.itemAt(mParts.size() - 1).mMeta->findInt32(
+                "segment-index", &lastSegmentIndex));
+    }
+    if (itemMeta != NULL && itemMeta->findInt32("discontinuity", &discontinuity)
+            && lastSegmentIndex != (int32_t)mItems.size()) {
+        part.mMeta->setInt32("discontinuity", discontinuity);
+    }
+    part.mMeta->setInt32("discontinuity-sequence", mDiscontinuitySeq + mDiscontinuityCount);
+    part.mMeta->setInt32("segment-index", mItems.size());
+    mParts.push_back(part);
+    return OK;
+}
+
+// static
+status_t M3UParser::parseAttributes(const AString &line, sp<AMessage> *attrs) {
+    ssize_t colonPos = line.find(":");
+
+    if (colonPos < 0) {
+        return ERROR_MALFORMED;
+    }
+
+    *attrs = new AMessage;
+    size_t offset = colonPos + 1;
+    while (offset < line.size()) {
+        ssize_t end = FindNextUnquoted(line, ',', offset);
+        if (end < 0) {
+            end = line.size();
+        }
+
+        AString attr(line, offset, end - offset);
+        attr.trim();
+
+        offset = end + 1;
+
+        ssize_t equalPos = attr.find("=");
+        if (equalPos < 0) {
+            continue;
+        }
+
+        AString key(attr, 0, equalPos);
+        key.trim();
+        key.tolower();
+
+        AString val(attr, equalPos + 1, attr.size() - equalPos - 1);
+        val.trim();
+
+        (*attrs)->setString(key.c_str(), unquoteString(val));
+    }
+    return OK;
+}
+
 // static
 status_t M3UParser::parseDiscontinuitySequence(const AString &line, size_t *seq) {
     ssize_t colonPos = line.find(":");
@@ -45,6 +45,17 @@ struct M3UParser : public RefBase {
     size_t size();
     bool itemAt(size_t index, AString *uri, sp<AMessage> *meta = NULL);
 
+    // Low-latency playlists (EXT-X-PART). The part target duration is -1 if the
+    // playlist lists no parts.
+    int64_t getPartTargetDuration() const;
+    int64_t getPartHoldBack() const;
+    bool canBlockReload() const;
+    bool isEncrypted() const;
+    // Parts of segment seqNumber, which may be the segment after the last one,
+    // still being produced. Its last part may be a preload hint.
+    size_t getPartCount(int32_t seqNumber) const;
+    bool partAt(int32_t seqNumber, size_t partIndex, AString *uri, sp<AMessage> *meta);
+
     void pickRandomMediaItems();
     status_t selectTrack(size_t index, bool select);
     size_t getTrackCount() const;
@@ -79,9 +90,15 @@ private:
     int64_t mTargetDurationUs;
     size_t mDiscontinuitySeq;
     int32_t mDiscontinuityCount;
+    int64_t mPartTargetDurationUs;
+    int64_t mPartHoldBackUs;
+    bool mCanBlockReload;
+    bool mIsEncrypted;
 
     sp<AMessage> mMeta;
     Vector<Item> mItems;
+    // parts in playlist order, "segment-index" is the index of their segment in mItems
+    Vector<Item> mParts;
     ssize_t mSelectedIndex;
 
     // Media groups keyed by group ID.
@@ -107,6 +124,15 @@ private:
 
     status_t parseMedia(const AString &line);
 
+    status_t parseServerControl(const AString &line);
+    status_t parsePartInf(const AString &line);
+    status_t parsePart(
+            const AString &line, bool preloadHint, const sp<AMessage> &itemMeta,
+            uint64_t *partRangeOffset);
+
+    // Attributes of a tag, keyed by the lower case attribute name, unquoted.
+    static status_t parseAttributes(const AString &line, sp<AMessage> *attrs);
+
     static status_t parseDiscontinuitySequence(const AString &line, size_t *seq);
 
     static status_t ParseInt32(const char *s, int32_t *x);
@@ -141,6 +141,180 @@ void PlaylistFetcher::DownloadState::saveState(
     mLastSeqNumberInPlaylist = lastSeqNumberInPlaylist;
 }
 
+// Downloads the segment after the current one on its own connection, while the
+// fetcher is still parsing or waiting for its buffers to drain.
+struct PlaylistFetcher::SegmentPrefetcher : public AHandler {
+    explicit SegmentPrefetcher(const sp<HTTPDownloader> &downloader);
+
+    // Starts downloading the segment, dropping any earlier one.
+    void prefetch(const AString &uri, int64_t rangeOffset, int64_t rangeLength);
+
+    // Returns the segment if it was prefetched, waiting for a download in progress,
+    // or NULL if it has to be fetched normally. delayUs is the download time,
+    // or -1 if it was read back from the disk cache.
+    sp<ABuffer> take(
+            const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+            int64_t *delayUs);
+
+    void disconnect();
+    void reconnect();
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
+private:
+    enum {
+        kWhatFetch = 'ftch',
+    };
+
+    enum State {
+        IDLE,
+        FETCHING,
+        DONE,
+    };
+
+    // Larger segments are left to the fetcher, which only holds one block at a time
+    // for transport streams.
+    static const size_t kMaxSegmentSize = 16 * 1024 * 1024;
+
+    sp<HTTPDownloader> mDownloader;
+
+    Mutex mLock;
+    Condition mCondition;
+    int32_t mGeneration;
+    State mState;
+    AString mURI;
+    int64_t mRangeOffset;
+    int64_t mRangeLength;
+    sp<ABuffer> mBuffer;
+    int64_t mDelayUs;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentPrefetcher);
+};
+
+PlaylistFetcher::SegmentPrefetcher::SegmentPrefetcher(
+        const sp<HTTPDownloader> &downloader)
+    : mDownloader(downloader),
+      mGeneration(0),
+      mState(IDLE),
+      mRangeOffset(0),
+      mRangeLength(-1),
+      mDelayUs(0) {
+}
+
+void PlaylistFetcher::SegmentPrefetcher::prefetch(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength) {
+    Mutex::Autolock autoLock(mLock);
+    ++mGeneration;
+    mState = FETCHING;
+    mURI = uri;
+    mRangeOffset = rangeOffset;
+    mRangeLength = rangeLength;
+    mBuffer.clear();
+
+    sp<AMessage> msg = new AMessage(kWhatFetch, this);
+    msg->setInt32("generation", mGeneration);
+    msg->setString("uri", uri);
+    msg->setInt64("rangeOffset", rangeOffset);
+    msg->setInt64("rangeLength", rangeLength);
+    msg->post();
+}
+
+sp<ABuffer> PlaylistFetcher::SegmentPrefetcher::take(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+        int64_t *delayUs) {
+    Mutex::Autolock autoLock(mLock);
+    if (mState == IDLE || mURI != uri
+            || mRangeOffset != rangeOffset || mRangeLength != rangeLength) {
+        // a stale download finishes on its own and is ignored.
+        ++mGeneration;
+        mState = IDLE;
+        mBuffer.clear();
+        return NULL;
+    }
+
+    // the segment is already coming in on the other connection.
+    const int32_t generation = mGeneration;
+    while (mState == FETCHING && generation == mGeneration) {
+        mCondition.wait(mLock);
+    }
+    if (generation != mGeneration) {
+        return NULL;
+    }
+
+    sp<ABuffer> buffer = mBuffer;
+    *delayUs = mDelayUs;
+    mState = IDLE;
+    mBuffer.clear();
+    return buffer;
+}
+
+void PlaylistFetcher::SegmentPrefetcher::disconnect() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mGeneration;
+        mState = IDLE;
+        mBuffer.clear();
+        mCondition.broadcast();
+    }
+    mDownloader->disconnect();
+}
+
+void PlaylistFetcher::SegmentPrefetcher::reconnect() {
+    mDownloader->reconnect();
+}
+
+void PlaylistFetcher::SegmentPrefetcher::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatFetch:
+        {
+            int32_t generation;
+            AString uri;
+            int64_t rangeOffset, rangeLength;
+            CHECK(msg->findInt32("generation", &generation));
+            CHECK(msg->findString("uri", &uri));
+            CHECK(msg->findInt64("rangeOffset", &rangeOffset));
+            CHECK(msg->findInt64("rangeLength", &rangeLength));
+
+            sp<ABuffer> buffer;
+            bool connectHTTP = true;
+            ssize_t bytesRead;
+            const int64_t startUs = ALooper::GetNowUs();
+            do {
+                {
+                    Mutex::Autolock autoLock(mLock);
+                    if (generation != mGeneration) {
+                        return;
+                    }
+                }
+                bytesRead = mDownloader->fetchBlock(
+                        uri.c_str(), &buffer, rangeOffset, rangeLength, kDownloadBlockSize,
+                        NULL /* actualURL */, connectHTTP);
+                connectHTTP = false;
+            } while (bytesRead > 0 && buffer->size() <= kMaxSegmentSize);
+
+            Mutex::Autolock autoLock(mLock);
+            if (generation != mGeneration) {
+                break;
+            }
+            if (bytesRead == 0) {
+                mBuffer = buffer;
+                // -1: read back from the disk cache, not a bandwidth sample
+                mDelayUs = mDownloader->isFromDiskCache() ? -1 : ALooper::GetNowUs() - startUs;
+            } else {
+                ALOGV("prefetching '%s' failed or segment too large (%zd)",
+                        uriDebugString(uri).c_str(), bytesRead);
+            }
+            mState = DONE;
+            mCondition.broadcast();
+            break;
+        }
+
+        default:
+            TRESPASS();
+    }
+}
+
 PlaylistFetcher::PlaylistFetcher(
         const sp<AMessage> &notify,
         const sp<LiveSession> &session,
@@ -159,6 +333,8 @@ PlaylistFetcher::PlaylistFetcher(
       mLastPlaylistFetchTimeUs(-1LL),
       mPlaylistTimeUs(-1LL),
       mSeqNumber(-1),
+      mPartIndex(0),
+      mDownloadingPart(false),
       mNumRetries(0),
       mNumRetriesForMonitorQueue(0),
       mStartup(true),
@@ -176,15 +352,26 @@ PlaylistFetcher::PlaylistFetcher(
       mSampleAesKeyItemChanged(false),
       mThresholdRatio(-1.0f),
       mDownloadState(new DownloadState()),
+      mPrefetchedSize(-1),
       mHasMetadata(false) {
     memset(mPlaylistHash, 0, sizeof(mPlaylistHash));
     mHTTPDownloader = mSession->getHTTPDownloader();
 
+    mPrefetcher = new SegmentPrefetcher(mSession->getHTTPDownloader());
+    mPrefetchLooper = new ALooper;
+    mPrefetchLooper->setName("PlaylistFetcherPrefetch");
+    mPrefetchLooper->start();
+    mPrefetchLooper->registerHandler(mPrefetcher);
+
     memset(mKeyData, 0, sizeof(mKeyData));
     memset(mAESInitVec, 0, sizeof(mAESInitVec));
 }
 
 PlaylistFetcher::~PlaylistFetcher() {
+    // break out of a download in progress before waiting for the looper.
+    mPrefetcher->disconnect();
+    mPrefetchLooper->unregisterHandler(mPrefetcher->id());
+    mPrefetchLooper->stop();
 }
 
 int32_t PlaylistFetcher::getFetcherID() const {
@@ -199,7 +386,9 @@ int64_t PlaylistFetcher::getSegmentStartTimeUs(int32_t seqNumber) const {
             &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
 
     CHECK_GE(seqNumber, firstSeqNumberInPlaylist);
-    CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
+    // the segment after the last one may be in progress as parts.
+    CHECK_LE(seqNumber, lastSeqNumberInPlaylist
+            + (mPlaylist->getPartCount(lastSeqNumberInPlaylist + 1) > 0 ? 1 : 0));
 
     int64_t segmentStartUs = 0LL;
     for (int32_t index = 0;
@@ -225,6 +414,11 @@ int64_t PlaylistFetcher::getSegmentDurationUs(int32_t seqNumber) const {
             &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
 
     CHECK_GE(seqNumber, firstSeqNumberInPlaylist);
+    if (seqNumber > lastSeqNumberInPlaylist
+            && mPlaylist->getPartCount(seqNumber) > 0) {
+        // still in progress, its duration is not known yet.
+        return mPlaylist->getTargetDuration();
+    }
     CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
 
     int32_t index = seqNumber - firstSeqNumberInPlaylist;
@@ -238,6 +432,13 @@ int64_t PlaylistFetcher::getSegmentDurationUs(int32_t seqNumber) const {
     return itemDurationUs;
 }
 
+bool PlaylistFetcher::isLowLatency() const {
+    // the key and IV handling assumes whole segments, so encrypted streams are
+    // fetched segment by segment.
+    return mPlaylist != NULL && !mPlaylist->isComplete()
+            && mPlaylist->getPartTargetDuration() > 0 && !mPlaylist->isEncrypted();
+}
+
 int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
     int64_t nowUs = ALooper::GetNowUs();
 
@@ -250,6 +451,24 @@ int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
         return (~0LLU >> 1);
     }
 
+    if (isLowLatency() && mSeqNumber >= 0) {
+        int32_t firstSeqNumberInPlaylist, lastSeqNumberInPlaylist;
+        mPlaylist->getSeqNumberRange(
+                &firstSeqNumberInPlaylist, &lastSeqNumberInPlaylist);
+        int64_t partTargetUs = mPlaylist->getPartTargetDuration();
+        if (mSeqNumber <= lastSeqNumberInPlaylist
+                || mPlaylist->getPartCount(mSeqNumber) > (size_t)mPartIndex) {
+            // the next part or segment is listed already.
+            return partTargetUs;
+        }
+        if (mPlaylist->canBlockReload()) {
+            // the server holds the request until the part is published.
+            return 0LL;
+        }
+        int64_t delayUs = mLastPlaylistFetchTimeUs + partTargetUs / 2 - nowUs;
+        return delayUs > 0LL ? delayUs : 0LL;
+    }
+
     int64_t targetDurationUs = mPlaylist->getTargetDuration();
 
     int64_t minPlaylistAgeUs;
@@ -306,6 +525,11 @@ status_t PlaylistFetcher::decryptBuffer(
     bool found = false;
     AString method;
 
+    if (playlistIndex >= mPlaylist->size()) {
+        // a part of the segment after the last one
+        playlistIndex = mPlaylist->size() - 1;
+    }
+
     for (ssize_t i = playlistIndex; i >= 0; --i) {
         AString uri;
         CHECK(mPlaylist->itemAt(i, &uri, &itemMeta));
@@ -449,10 +673,15 @@ status_t PlaylistFetcher::decryptBuffer(
     }
 
 
-    AES_KEY aes_key;
-    if (AES_set_decrypt_key(key->data(), 128, &aes_key) != 0) {
-        ALOGE("failed to set AES decryption key.");
-        return UNKNOWN_ERROR;
+    // the key schedule is the same for all blocks of a segment, and usually for the
+    // whole playlist.
+    if (key != mAESKeyBuffer) {
+        if (AES_set_decrypt_key(key->data(), 128, &mAESKey) != 0) {
+            ALOGE("failed to set AES decryption key.");
+            mAESKeyBuffer.clear();
+            return UNKNOWN_ERROR;
+        }
+        mAESKeyBuffer = key;
     }
 
     size_t n = buffer->size();
@@ -467,7 +696,7 @@ status_t PlaylistFetcher::decryptBuffer(
 
     AES_cbc_encrypt(
             buffer->data(), buffer->data(), buffer->size(),
-            &aes_key, mAESInitVec, AES_DECRYPT);
+            &mAESKey, mAESInitVec, AES_DECRYPT);
 
     return OK;
 }
@@ -523,6 +752,7 @@ void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        mPrefetcher->disconnect();
     }
 }
 
@@ -533,9 +763,11 @@ void PlaylistFetcher::resetStoppingThreshold(bool disconnect) {
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        mPrefetcher->disconnect();
     } else {
         // allow reconnect
         mHTTPDownloader->reconnect();
+        mPrefetcher->reconnect();
     }
 }
 
@@ -775,6 +1007,7 @@ status_t PlaylistFetcher::onStart(const sp<AMessage> &msg) {
         mStartTimeUs = startTimeUs;
         mFirstPTSValid = false;
         mSeqNumber = -1;
+        mPartIndex = 0;
         mTimeChangeSignaled = false;
         mDownloadState->resetState();
     }
@@ -933,9 +1166,16 @@ void PlaylistFetcher::onMonitorQueue() {
 
 status_t PlaylistFetcher::refreshPlaylist() {
     if (delayUsToRefreshPlaylist() <= 0) {
+        AString url = mURI;
+        if (isLowLatency() && mPlaylist->canBlockReload() && mSeqNumber >= 0) {
+            // blocking reload of the playlist that lists the part we need next
+            url.append(mURI.find("?") < 0 ? "?" : "&");
+            url.append(AStringPrintf("_HLS_msn=%d&_HLS_part=%d", mSeqNumber, mPartIndex));
+        }
+
         bool unchanged;
         sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                mURI.c_str(), mPlaylistHash, &unchanged);
+                url.c_str(), mPlaylistHash, &unchanged);
 
         if (playlist == NULL) {
             if (unchanged) {
@@ -1035,14 +1275,38 @@ bool PlaylistFetcher::shouldPauseDownload() {
 void PlaylistFetcher::initSeqNumberForLiveStream(
         int32_t &firstSeqNumberInPlaylist,
         int32_t &lastSeqNumberInPlaylist) {
-    // start at least 3 target durations from the end.
+    // start at least 3 target durations from the end, or the part hold back
+    // for low-latency playlists.
     int64_t timeFromEnd = 0;
     size_t index = mPlaylist->size();
     sp<AMessage> itemMeta;
     int64_t itemDurationUs;
     int32_t targetDuration;
+    int64_t holdBackUs = -1;
+    if (isLowLatency()) {
+        holdBackUs = mPlaylist->getPartHoldBack();
+        if (holdBackUs <= 0) {
+            holdBackUs = mPlaylist->getPartTargetDuration() * 3;
+        }
+        // the parts of the segment in progress count towards the hold back.
+        AString uri;
+        for (size_t i = 0; mPlaylist->partAt(lastSeqNumberInPlaylist + 1, i, &uri, &itemMeta);
+                ++i) {
+            if (itemMeta->findInt64("durationUs", &itemDurationUs)) {
+                timeFromEnd += itemDurationUs;
+            }
+        }
+        if (timeFromEnd >= holdBackUs) {
+            mSeqNumber = lastSeqNumberInPlaylist + 1;
+            mPartIndex = 0;
+            return;
+        }
+    }
     if (mPlaylist->meta() != NULL
             && mPlaylist->meta()->findInt32("target-duration", &targetDuration)) {
+        if (holdBackUs < 0) {
+            holdBackUs = targetDuration * 3E6;
+        }
         do {
             --index;
             if (!mPlaylist->itemAt(index, NULL /* uri */, &itemMeta)
@@ -1054,7 +1318,7 @@ void PlaylistFetcher::initSeqNumberForLiveStream(
 
             timeFromEnd += itemDurationUs;
             mSeqNumber = firstSeqNumberInPlaylist + index;
-        } while (timeFromEnd < targetDuration * 3E6 && index > 0);
+        } while (timeFromEnd < holdBackUs && index > 0);
     } else {
         ALOGW("target-duration missing");
         mSeqNumber = lastSeqNumberInPlaylist - 3;
@@ -1084,9 +1348,8 @@ bool PlaylistFetcher::initDownloadState(
         }
     }
 
-    mSegmentFirstPTS = -1LL;
-
     if (mPlaylist != NULL && mSeqNumber < 0) {
+        mPartIndex = 0;
         CHECK_GE(mStartTimeUs, 0LL);
 
         if (mSegmentStartTimeUs < 0) {
@@ -1140,10 +1403,38 @@ bool PlaylistFetcher::initDownloadState(
         }
     }
 
+    mDownloadingPart = false;
+    if (err == OK && mPlaylist != NULL && mSeqNumber >= firstSeqNumberInPlaylist
+            && (mPartIndex > 0 || mSeqNumber == lastSeqNumberInPlaylist + 1)) {
+        if (isLowLatency()
+                && mPlaylist->partAt(mSeqNumber, mPartIndex, &uri, &itemMeta)) {
+            mDownloadingPart = true;
+        } else if (mSeqNumber <= lastSeqNumberInPlaylist) {
+            // the rest of the segment we fetched in parts, or parts no longer listed
+            // for it once complete.
+            ++mSeqNumber;
+            mPartIndex = 0;
+            if (mSeqNumber == lastSeqNumberInPlaylist + 1 && isLowLatency()
+                    && mPlaylist->partAt(mSeqNumber, mPartIndex, &uri, &itemMeta)) {
+                mDownloadingPart = true;
+            }
+        } else if (isLowLatency() && mPlaylist->getPartCount(mSeqNumber) > 0) {
+            // wait for the next part
+            FLOGV("part %d of segment %d not yet available", mPartIndex, mSeqNumber);
+            postMonitorQueue(delayUsToRefreshPlaylist());
+            return false;
+        }
+    }
+
+    if (!mDownloadingPart || mPartIndex == 0) {
+        mSegmentFirstPTS = -1LL;
+    }
+
     // if mPlaylist is NULL then err must be non-OK; but the other way around might not be true
-    if (mSeqNumber < firstSeqNumberInPlaylist
+    if (!mDownloadingPart
+            && (mSeqNumber < firstSeqNumberInPlaylist
             || mSeqNumber > lastSeqNumberInPlaylist
-            || err != OK) {
+            || err != OK)) {
         if ((err != OK || !mPlaylist->isComplete()) && mNumRetries < kMaxNumRetries) {
             ++mNumRetries;
 
@@ -1235,10 +1526,13 @@ bool PlaylistFetcher::initDownloadState(
 
     mNumRetries = 0;
 
-    CHECK(mPlaylist->itemAt(
-                mSeqNumber - firstSeqNumberInPlaylist,
-                &uri,
-                &itemMeta));
+    if (!mDownloadingPart) {
+        mPartIndex = 0;
+        CHECK(mPlaylist->itemAt(
+                    mSeqNumber - firstSeqNumberInPlaylist,
+                    &uri,
+                    &itemMeta));
+    }
 
     CHECK(itemMeta->findInt32("discontinuity-sequence", &mDiscontinuitySeq));
 
@@ -1320,8 +1614,9 @@ bool PlaylistFetcher::initDownloadState(
         }
     }
 
-    FLOGV("fetching segment %d from (%d .. %d)",
-            mSeqNumber, firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
+    FLOGV("fetching segment %d%s from (%d .. %d)",
+            mSeqNumber, mDownloadingPart ? AStringPrintf(" part %d", mPartIndex).c_str() : "",
+            firstSeqNumberInPlaylist, lastSeqNumberInPlaylist);
     return true;
 }
 
@@ -1362,14 +1657,41 @@ void PlaylistFetcher::onDownloadNext() {
         range_length = -1;
     }
 
+    if (connectHTTP) {
+        int64_t delayUs;
+        buffer = mPrefetcher->take(uri, range_offset, range_length, &delayUs);
+        mPrefetchedSize = -1;
+        if (buffer != NULL) {
+            FLOGV("using prefetched segment (%zu bytes)", buffer->size());
+            mPrefetchedSize = buffer->size();
+            buffer->setRange(0, 0);
+            if (!mStartup && mStopParams == NULL && mPrefetchedSize > 0 && delayUs >= 0
+                    && (mStreamTypeMask
+                            & (LiveSession::STREAMTYPE_AUDIO
+                            | LiveSession::STREAMTYPE_VIDEO))) {
+                mSession->addBandwidthMeasurement(mPrefetchedSize, delayUs);
+            }
+        }
+    }
+
     // block-wise download
     bool shouldPause = false;
     ssize_t bytesRead;
     do {
         int64_t startUs = ALooper::GetNowUs();
-        bytesRead = mHTTPDownloader->fetchBlock(
-                uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
-                NULL /* actualURL */, connectHTTP);
+        if (mPrefetchedSize >= 0) {
+            // parse the prefetched segment in blocks as if it was coming in, so that
+            // pausing and the stopping threshold work the same.
+            bytesRead = mPrefetchedSize - buffer->size();
+            if (bytesRead > kDownloadBlockSize) {
+                bytesRead = kDownloadBlockSize;
+            }
+            buffer->setRange(0, buffer->size() + bytesRead);
+        } else {
+            bytesRead = mHTTPDownloader->fetchBlock(
+                    uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
+                    NULL /* actualURL */, connectHTTP);
+        }
         int64_t delayUs = ALooper::GetNowUs() - startUs;
 
         if (bytesRead == ERROR_NOT_CONNECTED) {
@@ -1385,7 +1707,10 @@ void PlaylistFetcher::onDownloadNext() {
         // add sample for bandwidth estimation, excluding samples from subtitles (as
         // its too small), or during startup/resumeUntil (when we could have more than
         // one connection open which affects bandwidth)
-        if (!mStartup && mStopParams == NULL && bytesRead > 0
+        // Parts are published as they are produced, so their download time says
+        // little about the bandwidth.
+        if (!mStartup && mStopParams == NULL && bytesRead > 0 && mPrefetchedSize < 0
+                && !mDownloadingPart && !mHTTPDownloader->isFromDiskCache()
                 && (mStreamTypeMask
                         & (LiveSession::STREAMTYPE_AUDIO
                         | LiveSession::STREAMTYPE_VIDEO))) {
@@ -1473,8 +1798,14 @@ void PlaylistFetcher::onDownloadNext() {
             shouldPause = true;
         }
     } while (bytesRead != 0);
+    mPrefetchedSize = -1;
+
+    if (!shouldPause && mStopParams == NULL && !mDownloadingPart) {
+        prefetchSegment(mSeqNumber + 1, firstSeqNumberInPlaylist);
+    }
 
-    if (bufferStartsWithTsSyncByte(buffer)) {
+    // a single part may not carry every stream yet.
+    if (bufferStartsWithTsSyncByte(buffer) && !mDownloadingPart) {
         // If we don't see a stream in the program table after fetching a full ts segment
         // mark it as nonexistent.
         ATSParser::SourceType srcTypes[] =
@@ -1538,7 +1869,12 @@ void PlaylistFetcher::onDownloadNext() {
         }
     }
 
-    ++mSeqNumber;
+    if (mDownloadingPart) {
+        ++mPartIndex;
+    } else {
+        ++mSeqNumber;
+        mPartIndex = 0;
+    }
 
     // if adapting, pause after found the next starting point
     if (mSeekMode != LiveSession::kSeekModeExactPosition && startUp != mStartup) {
@@ -1553,6 +1889,31 @@ void PlaylistFetcher::onDownloadNext() {
     }
 }
 
+void PlaylistFetcher::prefetchSegment(
+        int32_t seqNumber, int32_t firstSeqNumberInPlaylist) {
+    if (mPlaylist == NULL) {
+        return;
+    }
+    const int32_t index = seqNumber - firstSeqNumberInPlaylist;
+    if (index < 0 || index >= (int32_t)mPlaylist->size()) {
+        // a live playlist may grow, the segment is fetched normally then.
+        return;
+    }
+
+    AString uri;
+    sp<AMessage> itemMeta;
+    CHECK(mPlaylist->itemAt(index, &uri, &itemMeta));
+
+    int64_t rangeOffset, rangeLength;
+    if (!itemMeta->findInt64("range-offset", &rangeOffset)
+            || !itemMeta->findInt64("range-length", &rangeLength)) {
+        rangeOffset = 0;
+        rangeLength = -1;
+    }
+    FLOGV("prefetching segment %d: '%s'", seqNumber, uriDebugString(uri).c_str());
+    mPrefetcher->prefetch(uri, rangeOffset, rangeLength);
+}
+
 /*
  * returns true if we need to adjust mSeqNumber
  */
@@ -1738,15 +2099,10 @@ status_t PlaylistFetcher::extractAndQueueAccessUnitsFromTs(const sp<ABuffer> &bu
         mSampleAesKeyItemChanged = false;
     }
 
-    size_t offset = 0;
-    while (offset + 188 <= buffer->size()) {
-        status_t err = mTSParser->feedTSPacket(buffer->data() + offset, 188);
-
-        if (err != OK) {
-            return err;
-        }
-
-        offset += 188;
+    const size_t offset = buffer->size() - buffer->size() % 188;
+    status_t feedErr = mTSParser->feedTSPackets(buffer->data(), offset);
+    if (feedErr != OK) {
+        return feedErr;
     }
     // setRange to indicate consumed bytes.
     buffer->setRange(buffer->offset() + offset, buffer->size() - offset);
@@ -106,6 +106,7 @@ private:
     };
 
     struct DownloadState;
+    struct SegmentPrefetcher;
 
     static const int64_t kMaxMonitorDelayUs;
     static const int32_t kNumSkipFrames;
@@ -144,6 +145,10 @@ private:
     int64_t mPlaylistTimeUs;
     sp<M3UParser> mPlaylist;
     int32_t mSeqNumber;
+    // next part of mSeqNumber on low-latency playlists, and whether the current
+    // download is a part rather than the whole segment.
+    int32_t mPartIndex;
+    bool mDownloadingPart;
     int32_t mNumRetries;
     int32_t mNumRetriesForMonitorQueue;
     bool mStartup;
@@ -187,6 +192,15 @@ private:
 
     sp<DownloadState> mDownloadState;
 
+    sp<ALooper> mPrefetchLooper;
+    sp<SegmentPrefetcher> mPrefetcher;
+    // size of the prefetched segment being parsed, or -1 when reading from the network
+    ssize_t mPrefetchedSize;
+
+    // expanded decryption key, and the key it was expanded from
+    AES_KEY mAESKey;
+    sp<ABuffer> mAESKeyBuffer;
+
     bool mHasMetadata;
 
     // Set first to true if decrypting the first segment of a playlist segment. When
@@ -202,6 +216,9 @@ private:
             bool first = true);
     status_t checkDecryptPadding(const sp<ABuffer> &buffer);
 
+    // Starts downloading the segment seqNumber on the prefetch connection.
+    void prefetchSegment(int32_t seqNumber, int32_t firstSeqNumberInPlaylist);
+
     void postMonitorQueue(int64_t delayUs = 0, int64_t minDelayUs = 0);
     void cancelMonitorQueue();
     void setStoppingThreshold(float thresholdRatio, bool disconnect);
@@ -209,6 +226,8 @@ private:
     float getStoppingThreshold();
     bool shouldPauseDownload();
 
+    // Live playlist with parts that are fetched as they are published.
+    bool isLowLatency() const;
     int64_t delayUsToRefreshPlaylist() const;
     status_t refreshPlaylist();
 
@@ -92,29 +92,41 @@ private:
 };
 
 
-ID3::ID3(DataSourceHelper *sourcehelper, bool ignoreV1, off64_t offset)
+ID3::ID3(DataSourceHelper *sourcehelper, bool ignoreV1, off64_t offset, bool lazy)
     : mIsValid(false),
       mData(NULL),
       mSize(0),
       mFirstFrameOffset(0),
       mVersion(ID3_UNKNOWN),
-      mRawSize(0) {
-    DataSourceUnwrapper source(sourcehelper);
-    mIsValid = parseV2(&source, offset);
+      mRawSize(0),
+      mLazy(false),
+      mSource(NULL),
+      mOwnedSource(NULL) {
+    DataSourceUnwrapper *source = new DataSourceUnwrapper(sourcehelper);
+    mIsValid = parseV2(source, offset, lazy);
 
     if (!mIsValid && !ignoreV1) {
-        mIsValid = parseV1(&source);
+        mIsValid = parseV1(source);
+    }
+
+    if (mLazy) {
+        mOwnedSource = source;
+    } else {
+        delete source;
     }
 }
 
-ID3::ID3(DataSourceBase *source, bool ignoreV1, off64_t offset)
+ID3::ID3(DataSourceBase *source, bool ignoreV1, off64_t offset, bool lazy)
     : mIsValid(false),
       mData(NULL),
       mSize(0),
       mFirstFrameOffset(0),
       mVersion(ID3_UNKNOWN),
-      mRawSize(0) {
-    mIsValid = parseV2(source, offset);
+      mRawSize(0),
+      mLazy(false),
+      mSource(NULL),
+      mOwnedSource(NULL) {
+    mIsValid = parseV2(source, offset, lazy);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -127,13 +139,16 @@ ID3::ID3(const uint8_t *data, size_t size, bool ignoreV1)
       mSize(0),
       mFirstFrameOffset(0),
       mVersion(ID3_UNKNOWN),
-      mRawSize(0) {
+      mRawSize(0),
+      mLazy(false),
+      mSource(NULL),
+      mOwnedSource(NULL) {
     MemorySource *source = new (std::nothrow) MemorySource(data, size);
 
     if (source == NULL)
         return;
 
-    mIsValid = parseV2(source, 0);
+    mIsValid = parseV2(source, 0, false /* lazy */);
 
     if (!mIsValid && !ignoreV1) {
         mIsValid = parseV1(source);
@@ -146,6 +161,10 @@ ID3::~ID3() {
         free(mData);
         mData = NULL;
     }
+    for (const FrameInfo &frame : mFrames) {
+        free(frame.mData);
+    }
+    delete mOwnedSource;
 }
 
 bool ID3::isValid() const {
@@ -170,7 +189,7 @@ bool ID3::ParseSyncsafeInteger(const uint8_t encoded[4], size_t *x) {
     return true;
 }
 
-bool ID3::parseV2(DataSourceBase *source, off64_t offset) {
+bool ID3::parseV2(DataSourceBase *source, off64_t offset, bool lazy) {
 struct id3_header {
     char id[3];
     uint8_t version_major;
@@ -231,6 +250,20 @@ struct id3_header {
         return false;
     }
 
+    // before 2.4, unsynchronization applies to the frame headers too, so frames can only be
+    // found after processing the whole tag.
+    if (lazy && (header.version_major == 4 || !(header.flags & 0x80))) {
+        if (parseV2FrameIndex(source, offset + sizeof(header), size,
+                    header.version_major, header.flags)) {
+            mRawSize = size + sizeof(header);
+            mLazy = true;
+            mSource = source;
+            return true;
+        }
+        ALOGV("could not index the ID3 frames, reading the whole tag");
+        mFrames.clear();
+    }
+
     mData = (uint8_t *)malloc(size);
 
     if (mData == NULL) {
@@ -379,26 +412,28 @@ struct id3_header {
     return true;
 }
 
-void ID3::removeUnsynchronization() {
+// returns the size of the data after unsynchronization is removed in place.
+static size_t RemoveUnsynchronization(uint8_t *data, size_t size) {
 
     // This file has "unsynchronization", so we have to replace occurrences
     // of 0xff 0x00 with just 0xff in order to get the real data.
 
     size_t writeOffset = 1;
-    for (size_t readOffset = 1; readOffset < mSize; ++readOffset) {
-        if (mData[readOffset - 1] == 0xff && mData[readOffset] == 0x00) {
+    for (size_t readOffset = 1; readOffset < size; ++readOffset) {
+        if (data[readOffset - 1] == 0xff && data[readOffset] == 0x00) {
             continue;
         }
         // Only move data if there's actually something to move.
         // This handles the special case of the data being only [0xff, 0x00]
         // which should be converted to just 0xff if unsynchronization is on.
-        mData[writeOffset++] = mData[readOffset];
+        data[writeOffset++] = data[readOffset];
     }
 
-    if (writeOffset < mSize) {
-        mSize = writeOffset;
-    }
+    return writeOffset < size ? writeOffset : size;
+}
 
+void ID3::removeUnsynchronization() {
+    mSize = RemoveUnsynchronization(mData, mSize);
 }
 
 static void WriteSyncsafeInteger(uint8_t *dst, size_t x) {
@@ -488,10 +523,150 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
     return true;
 }
 
+bool ID3::parseV2FrameIndex(
+        DataSourceBase *source, off64_t start, size_t size,
+        uint8_t majorVersion, uint8_t flags) {
+    size_t firstFrameOffset = 0;
+    size_t end = size;
+    uint8_t ext[10];
+    if (majorVersion == 3 && (flags & 0x40)) {
+        if (size < 4 || source->readAt(start, ext, 4) != 4) {
+            return false;
+        }
+        size_t extendedHeaderSize = U32_AT(&ext[0]);
+        if (extendedHeaderSize > size - 4) {
+            return false;
+        }
+        extendedHeaderSize += 4;
+        firstFrameOffset = extendedHeaderSize;
+
+        if (extendedHeaderSize >= 10) {
+            if (source->readAt(start + 6, &ext[6], 4) != 4) {
+                return false;
+            }
+            size_t paddingSize = U32_AT(&ext[6]);
+            if (paddingSize > size - firstFrameOffset) {
+                return false;
+            }
+            end -= paddingSize;
+        }
+    } else if (majorVersion == 4 && (flags & 0x40)) {
+        size_t ext_size;
+        if (size < 4 || source->readAt(start, ext, 4) != 4
+                || !ParseSyncsafeInteger(ext, &ext_size)
+                || ext_size < 6 || ext_size > size) {
+            return false;
+        }
+        firstFrameOffset = ext_size;
+    }
+
+    const size_t headerLength = (majorVersion == 2) ? 6 : 10;
+    const size_t idLength = (majorVersion == 2) ? 3 : 4;
+    size_t offset = firstFrameOffset;
+    while (end >= headerLength && offset <= end - headerLength) {
+        uint8_t header[10];
+        if (source->readAt(start + offset, header, headerLength) != (ssize_t)headerLength) {
+            return false;
+        }
+        if (!memcmp(header, "\0\0\0\0", idLength)) {
+            break;  // padding
+        }
+
+        size_t dataSize;
+        uint16_t frameFlags = 0;
+        if (majorVersion == 2) {
+            dataSize = (header[3] << 16) | (header[4] << 8) | header[5];
+        } else {
+            if (majorVersion == 4) {
+                // leave sizes that are not syncsafe to the iTunes hack of the full parse.
+                if (!ParseSyncsafeInteger(&header[4], &dataSize)) {
+                    return false;
+                }
+            } else {
+                dataSize = U32_AT(&header[4]);
+            }
+            frameFlags = U16_AT(&header[8]);
+        }
+        if (dataSize == 0) {
+            break;
+        }
+        if (dataSize > end - offset - headerLength) {
+            return false;
+        }
+
+        FrameInfo frame;
+        memcpy(frame.mID, header, idLength);
+        frame.mID[idLength] = '\0';
+        frame.mOffset = start + offset;
+        frame.mSize = headerLength + dataSize;
+        frame.mFlags = frameFlags;
+        frame.mData = NULL;
+        frame.mLoadedSize = 0;
+        mFrames.push_back(frame);
+
+        offset += frame.mSize;
+    }
+
+    mFirstFrameOffset = 0;
+    mSize = end;
+    if (majorVersion == 2) {
+        mVersion = ID3_V2_2;
+    } else if (majorVersion == 3) {
+        mVersion = ID3_V2_3;
+    } else {
+        CHECK_EQ(majorVersion, 4);
+        mVersion = ID3_V2_4;
+    }
+    ALOGV("indexed %zu ID3 frames", mFrames.size());
+    return true;
+}
+
+const uint8_t *ID3::loadFrame(size_t index, size_t *size) const {
+    const FrameInfo &frame = mFrames[index];
+    if (frame.mData == NULL) {
+        uint8_t *data = (uint8_t *)malloc(frame.mSize);
+        if (data == NULL) {
+            return NULL;
+        }
+        if (mSource->readAt(frame.mOffset, data, frame.mSize) != (ssize_t)frame.mSize) {
+            free(data);
+            return NULL;
+        }
+
+        size_t loadedSize = frame.mSize;
+        if (mVersion == ID3_V2_4 && (frame.mFlags & 3)) {
+            // as removeUnsynchronizationV2_4() does for the whole tag
+            uint16_t flags = frame.mFlags;
+            if (flags & 1) {
+                // Strip data length indicator
+                if (loadedSize < 14) {
+                    free(data);
+                    return NULL;
+                }
+                memmove(&data[10], &data[14], loadedSize - 14);
+                loadedSize -= 4;
+                flags &= ~1;
+            }
+            if (flags & 2) {
+                loadedSize = 10 + RemoveUnsynchronization(&data[10], loadedSize - 10);
+                flags &= ~2;
+            }
+            WriteSyncsafeInteger(&data[4], loadedSize - 10);
+            data[8] = flags >> 8;
+            data[9] = flags & 0xff;
+        }
+
+        frame.mData = data;
+        frame.mLoadedSize = loadedSize;
+    }
+    *size = frame.mLoadedSize;
+    return frame.mData;
+}
+
 ID3::Iterator::Iterator(const ID3 &parent, const char *id)
     : mParent(parent),
       mID(NULL),
-      mOffset(mParent.mFirstFrameOffset),
+      mOffset(mParent.mLazy ? 0 : mParent.mFirstFrameOffset),
       mFrameData(NULL),
       mFrameSize(0) {
     if (id) {
@@ -517,7 +692,11 @@ void ID3::Iterator::next() {
         return;
     }
 
-    mOffset += mFrameSize;
+    if (mParent.mLazy) {
+        ++mOffset;
+    } else {
+        mOffset += mFrameSize;
+    }
 
     findFrame();
 }
@@ -530,9 +709,9 @@ void ID3::Iterator::getID(String8 *id) const {
     }
 
     if (mParent.mVersion == ID3_V2_2) {
-        id->setTo((const char *)&mParent.mData[mOffset], 3);
+        id->setTo((const char *)mFrameData - getHeaderLength(), 3);
     } else if (mParent.mVersion == ID3_V2_3 || mParent.mVersion == ID3_V2_4) {
-        id->setTo((const char *)&mParent.mData[mOffset], 4);
+        id->setTo((const char *)mFrameData - getHeaderLength(), 4);
     } else {
         CHECK(mParent.mVersion == ID3_V1 || mParent.mVersion == ID3_V1_1);
 
@@ -747,6 +926,30 @@ size_t ID3::Iterator::getHeaderLength() const {
 }
 
 void ID3::Iterator::findFrame() {
+    if (mParent.mLazy) {
+        mFrameData = NULL;
+        mFrameSize = 0;
+        for (; mOffset < mParent.mFrames.size(); ++mOffset) {
+            const FrameInfo &frame = mParent.mFrames[mOffset];
+            if (mID && strcmp(frame.mID, mID)) {
+                continue;
+            }
+            if ((mParent.mVersion == ID3_V2_4 && (frame.mFlags & 0x000c))
+                || (mParent.mVersion == ID3_V2_3 && (frame.mFlags & 0x00c0))) {
+                ALOGV("Skipping unsupported frame (compression or encryption)");
+                continue;
+            }
+            const uint8_t *data = mParent.loadFrame(mOffset, &mFrameSize);
+            if (data == NULL) {
+                mFrameSize = 0;
+                continue;
+            }
+            mFrameData = data + getHeaderLength();
+            return;
+        }
+        return;
+    }
+
     for (;;) {
         mFrameData = NULL;
         mFrameSize = 0;
@@ -68,6 +68,33 @@ static void hexdump(const void *_data, size_t size) {
     }
 }
 
+// checks that parsing with lazily loaded frames finds the same frames as a full parse.
+static void compareLazy(const ID3 &tag, const sp<FileSource> &file) {
+    ID3 lazyTag(file.get(), false /* ignoreV1 */, 0 /* offset */, true /* lazy */);
+    CHECK_EQ(tag.isValid(), lazyTag.isValid());
+    CHECK_EQ(tag.version(), lazyTag.version());
+
+    ID3::Iterator it(tag, NULL);
+    ID3::Iterator lazyIt(lazyTag, NULL);
+    while (!it.done()) {
+        CHECK(!lazyIt.done());
+        String8 id, lazyId;
+        it.getID(&id);
+        lazyIt.getID(&lazyId);
+        CHECK(id == lazyId);
+
+        size_t size, lazySize;
+        const uint8_t *data = it.getData(&size);
+        const uint8_t *lazyData = lazyIt.getData(&lazySize);
+        CHECK_EQ(size, lazySize);
+        CHECK(size == 0 || !memcmp(data, lazyData, size));
+
+        it.next();
+        lazyIt.next();
+    }
+    CHECK(lazyIt.done());
+}
+
 void scanFile(const char *path) {
     sp<FileSource> file = new FileSource(path);
     CHECK_EQ(file->initCheck(), (status_t)OK);
@@ -106,6 +133,8 @@ void scanFile(const char *path) {
 
             hexdump(data, dataSize > 128 ? 128 : dataSize);
         }
+
+        compareLazy(tag, file);
     }
 }
 
@@ -90,6 +90,37 @@ private:
     DISALLOW_EVIL_CONSTRUCTORS(TinyCacheSource);
 };
 
+// A DataSource that reads the start of the wrapped source once, for sniffing.
+// The extractor sniffers mostly look at the same few header bytes, so they are
+// served from memory instead of each reading them again from the source.
+class SniffCacheSource : public DataSource {
+public:
+    explicit SniffCacheSource(const sp<DataSource>& source);
+    virtual ~SniffCacheSource();
+
+    virtual status_t initCheck() const;
+    virtual ssize_t readAt(off64_t offset, void* data, size_t size);
+    virtual status_t getSize(off64_t* size);
+    virtual uint32_t flags();
+    virtual String8 toString() {
+        return mName;
+    }
+    virtual sp<IDataSource> getIDataSource() const;
+
+private:
+    // enough for the boxes, tags and packets the sniffers start with.
+    enum {
+        kHeaderSize = 64 * 1024,
+    };
+
+    sp<DataSource> mSource;
+    uint8_t *mHeader;
+    ssize_t mHeaderSize;        // < 0 until the header has been read
+    String8 mName;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SniffCacheSource);
+};
+
 }; // namespace android
 
 #endif // ANDROID_CALLBACKDATASOURCE_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISK_CACHE_H_
+
+#define DISK_CACHE_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Bounded cache of downloaded data in a directory, shared by NuCachedSource2 and
+// the HLS downloader so that replaying or seeking back in the same content does
+// not fetch it again. Entries are keyed by URI and byte range, evicted least
+// recently used first, and dropped when their checksum does not match on lookup.
+//
+// The process wide instance is enabled by setting media.stagefright.disk-cache-dir
+// to a directory the process can write to; media.stagefright.disk-cache-mb sets
+// its size.
+struct DiskCache : public RefBase {
+    // Returns NULL if the cache is disabled.
+    static sp<DiskCache> getInstance();
+
+    DiskCache(const char *dir, size_t maxBytes);
+
+    status_t initCheck() const;
+
+    // A length of -1 stands for the data from offset to the end of the resource.
+    sp<ABuffer> lookup(const AString &uri, int64_t offset, int64_t length);
+    void insert(const AString &uri, int64_t offset, int64_t length, const sp<ABuffer> &data);
+
+    size_t maxEntrySize() const;
+
+protected:
+    virtual ~DiskCache();
+
+private:
+    struct Entry {
+        AString mName;      // file name in mDir
+        size_t mSize;       // of the file
+    };
+
+    const AString mDir;
+    const size_t mMaxBytes;
+    status_t mInitCheck;
+
+    Mutex mLock;
+    Vector<Entry> mEntries;     // least recently used first
+    size_t mTotalBytes;
+
+    void loadIndex();
+    ssize_t findEntry_l(const AString &name) const;
+    // removes entries until the cache fits, returns their paths.
+    void evict_l(Vector<AString> *paths);
+    void removeFile(const AString &name);
+
+    static AString MakeKey(const AString &uri, int64_t offset, int64_t length);
+    static uint64_t Hash(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+    DISALLOW_EVIL_CONSTRUCTORS(DiskCache);
+};
+
+}  // namespace android
+
+#endif  // DISK_CACHE_H_
@@ -17,6 +17,8 @@
 #ifndef FRAME_DECODER_H_
 #define FRAME_DECODER_H_
 
+#include <deque>
+#include <future>
 #include <memory>
 #include <vector>
 
@@ -71,12 +73,30 @@ protected:
             bool firstSample,
             uint32_t *flags) = 0;
 
+    // Decoders that extract only part of the track return false once they have read
+    // every sample the current extraction needs; reading resumes with the next one.
+    virtual bool needsInput() const { return true; }
+
+    // Called for each sample read. Returns true to drop it instead of decoding it.
+    virtual bool onSkipInput(MetaDataBase &/*sampleMeta*/) { return false; }
+
+    // Called when the decoder reaches the end of stream before the extraction is
+    // done. Returns true to finish it with the frames extracted so far.
+    virtual bool onEndOfStream() { return false; }
+
     virtual status_t onOutputReceived(
             const sp<MediaCodecBuffer> &videoFrameBuffer,
             const sp<AMessage> &outputFormat,
             int64_t timeUs,
             bool *done) = 0;
 
+    // Decoders that convert output on other threads return true here. They keep each
+    // buffer after onOutputReceived() returns and hand the buffers back, oldest first,
+    // with releaseHeldOutputBuffer(). onFlushOutputs() finishes all pending work.
+    virtual bool keepsOutputBuffers() const { return false; }
+    virtual status_t onFlushOutputs() { return OK; }
+    void releaseHeldOutputBuffer();
+
     sp<MetaData> trackMeta()     const      { return mTrackMeta; }
     OMX_COLOR_FORMATTYPE dstFormat() const  { return mDstFormat; }
     int32_t dstBpp()             const      { return mDstBpp; }
@@ -85,6 +105,11 @@ protected:
         mFrames.push_back(frame);
     }
 
+    // Moves the input to |timeUs| before the next sample is read.
+    void seekTo(int64_t timeUs, MediaSource::ReadOptions::SeekMode mode) {
+        mReadOptions.setSeekTo(timeUs, mode);
+    }
+
 private:
     AString mComponentName;
     sp<MetaData> mTrackMeta;
@@ -97,8 +122,10 @@ private:
     sp<AMessage> mOutputFormat;
     bool mHaveMoreInputs;
     bool mFirstSample;
+    std::deque<size_t> mHeldOutputBuffers;
 
     status_t extractInternal();
+    status_t flushOutputs();
 
     DISALLOW_EVIL_CONSTRUCTORS(FrameDecoder);
 };
@@ -109,6 +136,13 @@ struct VideoFrameDecoder : public FrameDecoder {
             const sp<MetaData> &trackMeta,
             const sp<IMediaSource> &source);
 
+    // Extracts the frames closest to each of |timesUs|, in increasing order, in one
+    // decoding session. Times in the group of pictures being decoded are reached by
+    // decoding on, later ones by seeking. Requires init() with the first time,
+    // timesUs.size() frames and SEEK_CLOSEST.
+    status_t extractFramesAtTimes(
+            const std::vector<int64_t> &timesUs, std::vector<sp<IMemory> > *frames);
+
 protected:
     virtual sp<AMessage> onGetFormatAndSeekOptions(
             int64_t frameTimeUs,
@@ -133,12 +167,24 @@ protected:
             int64_t timeUs,
             bool *done) override;
 
+    virtual bool onSkipInput(MetaDataBase &sampleMeta) override;
+    virtual bool onEndOfStream() override;
+
 private:
     bool mIsAvcOrHevc;
     MediaSource::ReadOptions::SeekMode mSeekMode;
     int64_t mTargetTimeUs;
     size_t mNumFrames;
     size_t mNumFramesDecoded;
+
+    // extractFramesAtTimes() only
+    std::vector<int64_t> mBatchTimesUs;
+    sp<IMemory> mLastFrame;
+    bool mSeeking;              // the next sample read is the first after a seek
+    size_t mSeekIndex;          // the time of mBatchTimesUs sought to
+    bool mSkipping;             // reading up to the last queued sample again
+    int64_t mLastQueuedTimeUs;
+    int64_t mMaxQueuedTimeUs;
 };
 
 struct ImageDecoder : public FrameDecoder {
@@ -168,6 +214,12 @@ protected:
             int64_t timeUs,
             bool *done) override;
 
+    virtual bool needsInput() const override;
+    virtual bool onSkipInput(MetaDataBase &sampleMeta) override;
+
+    virtual bool keepsOutputBuffers() const override { return mGridRows * mGridCols > 1; }
+    virtual status_t onFlushOutputs() override;
+
 private:
     VideoFrame *mFrame;
     int32_t mWidth;
@@ -176,8 +228,22 @@ private:
     int32_t mGridCols;
     int32_t mTileWidth;
     int32_t mTileHeight;
-    int32_t mTilesDecoded;
-    int32_t mTargetTiles;
+    // tiles of the requested rect, in grid columns and rows
+    int32_t mRegionLeft;
+    int32_t mRegionTop;
+    int32_t mRegionRight;
+    int32_t mRegionBottom;
+    int32_t mRegionTilesLeft;
+    int32_t mTilesRead;
+    int32_t mReadLimit;
+    std::vector<bool> mTileDecoded;
+    // tiles queued to the decoder, in decoding order
+    std::deque<int32_t> mQueuedTiles;
+    // tiles being converted while the next ones decode, oldest first
+    std::deque<std::future<status_t> > mPendingTiles;
+
+    bool isTileInRegion(int32_t tile) const;
+    status_t finishOldestTile();
 };
 
 }  // namespace android
@@ -18,6 +18,8 @@
 
 #define ID3_H_
 
+#include <vector>
+
 #include <utils/RefBase.h>
 
 namespace android {
@@ -36,8 +38,14 @@ struct ID3 {
         ID3_V2_4,
     };
 
-    explicit ID3(DataSourceHelper *source, bool ignoreV1 = false, off64_t offset = 0);
-    explicit ID3(DataSourceBase *source, bool ignoreV1 = false, off64_t offset = 0);
+    // With |lazy| set, parsing only reads the frame headers, and each frame is read from
+    // |source| when an Iterator first reaches it, so frames that are never asked for (e.g.
+    // the album art) are not loaded. |source| must then outlive the ID3. Tags that need
+    // unsynchronization over the whole tag are still read at once.
+    explicit ID3(DataSourceHelper *source, bool ignoreV1 = false, off64_t offset = 0,
+            bool lazy = false);
+    explicit ID3(DataSourceBase *source, bool ignoreV1 = false, off64_t offset = 0,
+            bool lazy = false);
     ID3(const uint8_t *data, size_t size, bool ignoreV1 = false);
     ~ID3();
 
@@ -60,7 +68,7 @@ struct ID3 {
     private:
         const ID3 &mParent;
         char *mID;
-        size_t mOffset;
+        size_t mOffset;     // into mParent.mData, or index into mParent.mFrames if lazy
 
         const uint8_t *mFrameData;
         size_t mFrameSize;
@@ -77,6 +85,18 @@ struct ID3 {
     size_t rawSize() const { return mRawSize; }
 
 private:
+    // a frame of a lazily parsed tag
+    struct FrameInfo {
+        char mID[5];
+        off64_t mOffset;    // of the frame header in mSource
+        size_t mSize;       // including the header, as stored
+        uint16_t mFlags;
+
+        // read on first use, with the frame unsynchronization and data length removed
+        mutable uint8_t *mData;
+        mutable size_t mLoadedSize;
+    };
+
     bool mIsValid;
     uint8_t *mData;
     size_t mSize;
@@ -87,8 +107,17 @@ private:
     // only valid for IDV2+
     size_t mRawSize;
 
+    bool mLazy;
+    DataSourceBase *mSource;        // only set if lazy
+    DataSourceBase *mOwnedSource;
+    std::vector<FrameInfo> mFrames;
+
     bool parseV1(DataSourceBase *source);
-    bool parseV2(DataSourceBase *source, off64_t offset);
+    bool parseV2(DataSourceBase *source, off64_t offset, bool lazy);
+    bool parseV2FrameIndex(
+            DataSourceBase *source, off64_t start, size_t size,
+            uint8_t majorVersion, uint8_t flags);
+    const uint8_t *loadFrame(size_t index, size_t *size) const;
     void removeUnsynchronization();
     bool removeUnsynchronizationV2_4(bool iTunesHack);
 
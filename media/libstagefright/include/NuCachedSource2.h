@@ -21,17 +21,29 @@
 #include <media/DataSource.h>
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
 
 namespace android {
 
+struct ABuffer;
 struct ALooper;
+struct DiskCache;
+struct MediaHTTPService;
 struct PageCache;
 
 struct NuCachedSource2 : public DataSource {
+    // Given the HTTP service, uri and headers of an HTTP source, up to
+    // media.stagefright.cache-connections - 1 more connections fetch ranges of the
+    // read-ahead window in parallel with source.
     static sp<NuCachedSource2> Create(
             const sp<DataSource> &source,
             const char *cacheConfig = NULL,
-            bool disconnectAtHighwatermark = false);
+            bool disconnectAtHighwatermark = false,
+            const sp<MediaHTTPService> &httpService = NULL,
+            const char *uri = NULL,
+            const KeyedVector<String8, String8> *headers = NULL);
 
     virtual status_t initCheck() const;
 
@@ -64,7 +76,7 @@ struct NuCachedSource2 : public DataSource {
 
     // The following methods are supported only if the
     // data source is HTTP-based; otherwise, ERROR_UNSUPPORTED
-    // is returned.
+    // is returned. The bandwidth is the sum over all connections.
     status_t getEstimatedBandwidthKbps(int32_t *kbps);
     status_t setCacheStatCollectFreq(int32_t freqMs);
 
@@ -79,13 +91,21 @@ protected:
 private:
     friend struct AHandlerReflector<NuCachedSource2>;
 
+    struct RangeFetcher;
+
     NuCachedSource2(
             const sp<DataSource> &source,
             const char *cacheConfig,
-            bool disconnectAtHighwatermark);
+            bool disconnectAtHighwatermark,
+            const sp<MediaHTTPService> &httpService,
+            const char *uri,
+            const KeyedVector<String8, String8> *headers);
 
     enum {
         kPageSize                       = 65536,
+        // unit of the parallel range requests
+        kRangeSize                      = 16 * kPageSize,
+        kMaxNumConnections              = 4,
         kDefaultHighWaterThreshold      = 20 * 1024 * 1024,
         kDefaultLowWaterThreshold       = 4 * 1024 * 1024,
 
@@ -95,8 +115,9 @@ private:
     };
 
     enum {
-        kWhatFetchMore  = 'fetc',
-        kWhatRead       = 'read',
+        kWhatFetchMore      = 'fetc',
+        kWhatRead           = 'read',
+        kWhatRangeFetched   = 'rang',
     };
 
     enum {
@@ -131,11 +152,46 @@ private:
 
     bool mDisconnectAtHighwatermark;
 
+    // Pages of HTTP sources of a known size also go to the disk cache, if enabled.
+    // They are stored by chunks of kPageSize at multiples of kPageSize, mDiskChunk
+    // collects the data of the chunk at mDiskChunkOffset read from the network.
+    sp<DiskCache> mDiskCache;
+    AString mDiskCacheURI;
+    sp<ABuffer> mDiskChunk;
+    off64_t mDiskChunkOffset;
+
+    off64_t mSourceSize;        // of HTTP sources, -1 if unknown
+
+    // The connections besides mSource fetch the ranges after the one mSource reads,
+    // and mRanges holds them by offset, NULL while they are coming in, until
+    // fetchInternal() reaches them and moves them into the page cache.
+    struct RangeConnection {
+        sp<ALooper> mLooper;
+        sp<RangeFetcher> mFetcher;
+        bool mBusy;
+        bool mFailed;
+    };
+    Vector<RangeConnection> mRangeConnections;
+    KeyedVector<off64_t, sp<ABuffer> > mRanges;
+    off64_t mNextRangeOffset;
+    int32_t mRangeGeneration;           // bumped by seeks, guarded by mLock
+    int32_t mRangesGeneration;          // of mRanges
+    bool mWaitingForRange;
+
     void onMessageReceived(const sp<AMessage> &msg);
     void onFetch();
     void onRead(const sp<AMessage> &msg);
 
     void fetchInternal();
+    // reads up to size bytes, at most a page, at offset, from the disk cache if possible.
+    ssize_t readPage(off64_t offset, void *data, size_t size);
+    // Copies the data at offset of a fetched range. Returns -EAGAIN while the range
+    // is coming in, or -ENOENT if mSource is to read it, then cuts size at the
+    // next range.
+    ssize_t readFromRanges(off64_t offset, void *data, size_t *size);
+    void scheduleRanges(off64_t offset);
+    void onRangeFetched(const sp<AMessage> &msg);
+    void addToDiskChunk(off64_t offset, const void *data, ssize_t n);
     ssize_t readInternal(off64_t offset, void *data, size_t size);
     status_t seekInternal_l(off64_t offset);
 
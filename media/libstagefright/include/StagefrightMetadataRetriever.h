@@ -50,6 +50,9 @@ struct StagefrightMetadataRetriever : public MediaMetadataRetrieverBase {
     virtual status_t getFrameAtIndex(
             std::vector<sp<IMemory> >* frames,
             int frameIndex, int numFrames, int colorFormat, bool metaOnly);
+    virtual status_t getFramesAtTimes(
+            std::vector<sp<IMemory> >* frames,
+            const std::vector<int64_t> &timesUs, int option, int colorFormat);
 
     virtual MediaAlbumArt *extractAlbumArt();
     virtual const char *extractMetadata(int keyCode);
@@ -71,7 +74,8 @@ private:
 
     status_t getFrameInternal(
             int64_t timeUs, int numFrames, int option, int colorFormat, bool metaOnly,
-            sp<IMemory>* outFrame, std::vector<sp<IMemory> >* outFrames);
+            sp<IMemory>* outFrame, std::vector<sp<IMemory> >* outFrames,
+            const std::vector<int64_t> *timesUs = NULL);
     virtual sp<IMemory> getImageInternal(
             int index, int colorFormat, bool metaOnly, bool thumbnail, FrameRect* rect);
 
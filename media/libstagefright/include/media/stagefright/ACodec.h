@@ -180,6 +180,7 @@ private:
         sp<RefBase> mMemRef;         // and a reference to the IMemory, so it does not go away
         sp<MediaCodecBuffer> mCodecData;  // the codec's buffer
         sp<RefBase> mCodecRef;            // and a reference to the IMemory
+        hardware::hidl_memory mCodecMemToken;  // the shared memory of mCodecData, if any
 
         sp<GraphicBuffer> mGraphicBuffer;
         bool mNewGraphicBuffer;
@@ -277,12 +278,19 @@ private:
     IOMX::PortMode mPortMode[2];
     int32_t mMetadataBuffersToSubmit;
     size_t mNumUndequeuedBuffers;
+
+    // While the output port is being reconfigured, the shared memory of the freed output
+    // buffers is kept here so that the buffers allocated afterwards can reuse it when it is
+    // large enough, instead of going to the allocator again.
+    bool mKeepOutputMemory;
+    std::vector<hardware::hidl_memory> mReusableOutputMemory;
     sp<DataConverter> mConverter[2];
 
     sp<IGraphicBufferSource> mGraphicBufferSource;
     int64_t mRepeatFrameDelayUs;
     int64_t mMaxPtsGapUs;
     float mMaxFps;
+    int64_t mMaxInputLatencyUs;
     double mFps;
     double mCaptureFps;
     bool mCreateInputBuffersSuspended;
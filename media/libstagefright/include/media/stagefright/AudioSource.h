@@ -89,6 +89,15 @@ private:
         // This is the initial mute duration to suppress
         // the video recording signal tone
         kAutoRampStartUs = 0,
+
+        // Returned buffers are kept for reuse, up to this many.
+        kMaxFreeBuffers = 32,
+
+        // The time of the first recorded frame, as derived from AudioRecord::getTimestamp(),
+        // jitters by a few ms between callbacks. It is averaged over about this many
+        // callbacks, unless it moves by more than kMaxTimestampJumpUs at once.
+        kTimestampSmoothing = 16,
+        kMaxTimestampJumpUs = 20000,
     };
 
     Mutex mLock;
@@ -113,8 +122,10 @@ private:
     int64_t mNumFramesLost;
     int64_t mNumClientOwnedBuffers;
     bool mNoMoreFramesToRead;
+    int64_t mTimestampBaseUs;  // smoothed, -1 before the first timestamp
 
     List<MediaBuffer * > mBuffersReceived;
+    List<MediaBuffer * > mFreeBuffers;  // of kMaxBufferSize, for reuse
 
     void trackMaxAmplitude(int16_t *data, int nSamples);
 
@@ -124,8 +135,10 @@ private:
         int32_t startFrame, int32_t rampDurationFrames,
         uint8_t *data,   size_t bytes);
 
+    MediaBuffer *obtainBuffer_l(size_t size);
     void queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs);
     void releaseQueuedFrames_l();
+    void releaseFreeBuffers_l();
     void waitOutstandingEncodingFrames_l();
     status_t reset();
 
@@ -282,6 +282,9 @@ private:
     // A mapping from ANativeWindowBuffer sent to encoder to BufferItem received from camera.
     // This is protected by mLock.
     KeyedVector<ANativeWindowBuffer*, BufferItem> mReceivedBufferItemMap;
+    // Buffers the encoder is done with, returned to the buffer queue by
+    // releasePendingBuffers() once mLock is dropped. This is protected by mLock.
+    std::vector<BufferItem> mBuffersToRelease;
     sp<BufferQueueListener> mBufferQueueListener;
 
     Mutex mBatchLock; // protecting access to mInflightXXXXX members below
@@ -293,6 +296,7 @@ private:
 
     void releaseQueuedFrames();
     void releaseOneRecordingFrame(const sp<IMemory>& frame);
+    void releasePendingBuffers();
     void createVideoBufferMemoryHeap(size_t size, uint32_t bufferCount);
 
     status_t init(const sp<hardware::ICamera>& camera, const sp<ICameraRecordingProxy>& proxy,
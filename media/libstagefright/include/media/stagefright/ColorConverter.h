@@ -23,6 +23,9 @@
 #include <stdint.h>
 #include <utils/Errors.h>
 
+#include <functional>
+#include <vector>
+
 #include <OMX_Video.h>
 
 namespace android {
@@ -37,6 +40,10 @@ struct ColorConverter {
 
     void setSrcColorSpace(uint32_t standard, uint32_t range, uint32_t transfer);
 
+    // Lets convert() split large frames into bands of rows converted on up to |numThreads|
+    // threads, including the calling one. The default of 1 converts on the calling thread.
+    void setNumThreads(size_t numThreads);
+
     status_t convert(
             const void *srcBits,
             size_t srcWidth, size_t srcHeight, size_t srcStride,
@@ -78,12 +85,31 @@ private:
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
     ColorSpace mSrcColorSpace;
     uint8_t *mClip;
+    size_t mNumThreads;
+    std::vector<uint8_t> mARGBRows; // a band of rows for convertViaARGB()
 
     uint8_t *initClip();
 
+    status_t convertBitmap(const BitmapParams &src, const BitmapParams &dst);
+
+    // Converts bands of rows of the crop on |numBands| threads, each with its own converter.
+    status_t convertInBands(
+            const BitmapParams &src, const BitmapParams &dst, size_t numBands);
+
+    // Converts through libyuv's ARGB (B, G, R, A in memory) for the sources that libyuv can
+    // only convert to ARGB. |toARGB| converts |rows| rows from crop row |row| on, and returns
+    // 0 on success like libyuv does. BGRA destinations get the ARGB rows directly, the others
+    // get them packed from a band of mARGBRows.
+    typedef std::function<int(size_t row, size_t rows, uint8_t *argb, int argbStride)> ToARGB;
+    status_t convertViaARGB(
+            const BitmapParams &src, const BitmapParams &dst, const ToARGB &toARGB);
+
     status_t convertCbYCrY(
             const BitmapParams &src, const BitmapParams &dst);
 
+    status_t convertCbYCrYUseLibYUV(
+            const BitmapParams &src, const BitmapParams &dst);
+
     status_t convertYUV420Planar(
             const BitmapParams &src, const BitmapParams &dst);
 
@@ -93,6 +119,12 @@ private:
     status_t convertYUV420SemiPlanarUseLibYUV(
             const BitmapParams &src, const BitmapParams &dst);
 
+    status_t convertYVU420SemiPlanarUseLibYUV(
+            const BitmapParams &src, const BitmapParams &dst);
+
+    status_t convertYUV420Planar16UseLibYUV(
+            const BitmapParams &src, const BitmapParams &dst);
+
     status_t convertYUV420Planar16(
             const BitmapParams &src, const BitmapParams &dst);
 
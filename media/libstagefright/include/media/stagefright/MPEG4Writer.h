@@ -19,6 +19,11 @@
 #define MPEG4_WRITER_H_
 
 #include <stdio.h>
+#include <sys/uio.h>
+
+#include <array>
+#include <deque>
+#include <vector>
 
 #include <media/stagefright/MediaWriter.h>
 #include <utils/List.h>
@@ -71,6 +76,11 @@ public:
     virtual int32_t getStartTimeOffsetMs() const { return mStartTimeOffsetMs; }
     virtual status_t setNextFd(int fd);
 
+    // |notify| is posted with "active" set to 1 when the data waiting to be
+    // written nears the write queue budget, and with 0 once it has drained.
+    // A source can drop frames meanwhile instead of letting them pile up.
+    void setBackpressureNotify(const sp<AMessage> &notify);
+
 protected:
     virtual ~MPEG4Writer();
 
@@ -96,6 +106,59 @@ private:
     bool mSendNotify;
     off64_t mOffset;
     off_t mMdatOffset;
+
+    // Sample data to be written with one writev(), and what it points to.
+    struct WriteJob {
+        WriteJob() : mBytes(0) {}
+
+        std::vector<struct iovec> mIovecs;
+        std::deque<std::array<uint8_t, 4> > mPrefixes;   // length prefixes
+        std::deque<std::vector<uint8_t> > mStorage;      // copied data, box headers
+        std::vector<MediaBuffer *> mBuffers;             // released once written
+        size_t mBytes;
+    };
+
+    // Sample data is gathered per chunk and handed to the I/O thread up to a
+    // block boundary. mOffset includes the bytes still pending.
+    WriteJob mPendingWrite;
+    int64_t mFsyncIntervalBytes;        // 0 for no fdatasync() while recording
+    int64_t mBytesSinceFsync;           // I/O thread only
+
+    // Space is reserved ahead of the data, mPreallocateBytes at a time.
+    int64_t mPreallocateBytes;          // 0 for no preallocation
+    off64_t mPreallocatedEnd;
+    volatile bool mOutOfSpace;          // preallocation hit ENOSPC
+    int64_t mNumPreallocations;
+
+    // I/O thread, so that storage latency does not hold up the writer and
+    // track threads until the queue is full.
+    enum {
+        kNumWriteLatencyBuckets = 8,    // < 1ms, < 4ms, ... < 4s, longer
+    };
+    Mutex mIOLock;
+    Condition mIOCondition;
+    std::deque<WriteJob> mIOQueue;      // the front one is being written
+    size_t mIOQueuedBytes;
+    size_t mIOBudgetBytes;
+    bool mIOThreadStarted;
+    bool mIODone;
+    pthread_t mIOThread;
+    sp<AMessage> mBackpressureNotify;
+    bool mBackpressure;
+    // statistics, under mIOLock
+    int64_t mNumSampleWrites;
+    int64_t mSampleBytesWritten;
+    int64_t mNumFsyncs;
+    int64_t mWriteLatency[kNumWriteLatencyBuckets];
+    int64_t mNumBackpressure;
+    int64_t mNumWriteQueueFull;
+    int64_t mWriteQueueFullUs;          // time waited for room in the queue
+
+    // Fragmented MP4: a moov box without samples, written before the first
+    // fragment, then a moof and mdat box for each chunk.
+    int64_t mFragmentDurationUs;        // 0 for a regular file
+    bool mFragmentInitWritten;
+    uint32_t mFragmentSequence;
     uint8_t *mInMemoryCache;
     off64_t mInMemoryCacheOffset;
     off64_t mInMemoryCacheSize;
@@ -227,6 +290,14 @@ private:
     // Actually write the given chunk to the file.
     void writeChunkToFile(Chunk* chunk);
 
+    bool isFragmented() const { return mFragmentDurationUs > 0; }
+    // Return whether every track can be described in the moov box of a
+    // fragmented file, or that moov box is written already.
+    bool fragmentInitReady_l();
+    // Write the chunk as a movie fragment.
+    void writeFragment(Chunk *chunk);
+    void writeMvexBox();
+
     // Adjust other track media clock (presumably wall clock)
     // based on audio track media clock with the drift time.
     int64_t mDriftTimeUs;
@@ -258,6 +329,23 @@ private:
             uint32_t tiffHdrOffset, size_t *bytesWritten);
     void addLengthPrefixedSample_l(MediaBuffer *buffer);
     void addMultipleLengthPrefixedSamples_l(MediaBuffer *buffer);
+    // The data must stay valid until the next flushSampleWrites_l().
+    void addSampleWrite_l(const void *data, size_t size);
+    const uint8_t *addSamplePrefix_l(uint32_t value, size_t size);
+    // Release |buffer| once the pending data is written.
+    void addSampleBuffer_l(MediaBuffer *buffer);
+    // Queues the pending sample data up to the last block boundary, or all of
+    // it and waits until it is written if |all|.
+    void flushSampleWrites_l(bool all);
+    // Reserves space before the pending data gets close to the end of the last reservation.
+    void preallocate_l();
+
+    void startIOThread();
+    void stopIOThread();
+    static void *IOThreadWrapper(void *me);
+    void ioThreadFunc();
+    void writeJob(WriteJob *job);
+    void updateBackpressure_l();
     uint16_t addProperty_l(const ItemProperty &);
     uint16_t addItem_l(const ItemInfo &);
     void addRefs_l(uint16_t itemId, const ItemRefs &);
@@ -54,6 +54,8 @@ public:
 
     // pushBuffer() will wait for the read() finish, and read() will have a
     // deep copy, such that after pushBuffer return, the buffer can be re-used.
+    // A buffer with kKeyMayHoldBuffer set keeps its own observer and belongs
+    // to the reader once read, so pushBuffer() only waits for the read().
     status_t pushBuffer(MediaBuffer *buffer);
 
 private:
@@ -64,6 +66,7 @@ private:
     Condition mBufferReturnedCond;
 
     MediaBuffer *mCurrentMediaBuffer;
+    bool mCurrentBufferHeld;
 
     bool mStarted;
     sp<MetaData> mOutputFormat;
@@ -19,6 +19,7 @@
 #define MEDIA_BUFFER_GROUP_H_
 
 #include <list>
+#include <string>
 
 #include <media/MediaExtractorPluginApi.h>
 #include <media/NdkMediaErrorPriv.h>
@@ -56,6 +57,9 @@ public:
 
     size_t buffers() const;
 
+    // Readable summary of the buffers and the statistics of the growth policy.
+    std::string dump() const;
+
     // If buffer is nullptr, have acquire_buffer() check for remote release.
     virtual void signalBufferReturned(MediaBufferBase *buffer);
 
@@ -18,6 +18,7 @@
 
 #define MEDIA_CLOCK_H_
 
+#include <atomic>
 #include <list>
 #include <media/stagefright/foundation/AHandler.h>
 #include <utils/Mutex.h>
@@ -51,6 +52,9 @@ struct MediaClock : public AHandler {
     void setPlaybackRate(float rate);
     float getPlaybackRate() const;
 
+    // Time queries do not take the lock: they read the anchor through a sequence
+    // counter and retry if it changed meanwhile.
+
     // query media time corresponding to real time |realUs|, and save the
     // result in |outMediaUs|.
     status_t getMediaTime(
@@ -64,7 +68,12 @@ struct MediaClock : public AHandler {
     // request to set up a timer. The target time is |mediaTimeUs|, adjusted by
     // system time of |adjustRealUs|. In other words, the wake up time is
     // mediaTimeUs + (adjustRealUs / playbackRate)
-    void addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs = 0);
+    // Returns an id for cancelTimer().
+    int32_t addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs = 0);
+
+    // Removes a timer that has not fired yet, without posting its notify message.
+    // Returns NAME_NOT_FOUND if the timer already fired or was reset.
+    status_t cancelTimer(int32_t timerId);
 
     void setNotificationMessage(const sp<AMessage> &msg);
 
@@ -81,10 +90,21 @@ private:
     };
 
     struct Timer {
-        Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs);
+        Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs,
+                int32_t id);
         const sp<AMessage> mNotify;
         int64_t mMediaTimeUs;
         int64_t mAdjustRealUs;
+        int32_t mId;
+    };
+
+    // the values time queries depend on
+    struct Anchor {
+        int64_t mAnchorTimeMediaUs;
+        int64_t mAnchorTimeRealUs;
+        int64_t mMaxTimeMediaUs;
+        int64_t mStartingTimeMediaUs;
+        float mPlaybackRate;
     };
 
     status_t getMediaTime_l(
@@ -92,6 +112,16 @@ private:
             int64_t *outMediaUs,
             bool allowPastMaxTime) const;
 
+    static status_t getMediaTimeFor(
+            const Anchor &anchor,
+            int64_t realUs,
+            int64_t *outMediaUs,
+            bool allowPastMaxTime);
+
+    // copies the anchor for readers; call after every change of the values in Anchor.
+    void publishAnchor_l();
+    void readAnchor(Anchor *anchor) const;
+
     void processTimers_l();
 
     void updateAnchorTimesAndPlaybackRate_l(
@@ -109,7 +139,17 @@ private:
 
     float mPlaybackRate;
 
+    // Published copy of the values above. The writers hold mLock; the sequence is odd
+    // while a writer is updating the copy.
+    std::atomic<uint32_t> mAnchorSeq;
+    std::atomic<int64_t> mPublishedAnchorTimeMediaUs;
+    std::atomic<int64_t> mPublishedAnchorTimeRealUs;
+    std::atomic<int64_t> mPublishedMaxTimeMediaUs;
+    std::atomic<int64_t> mPublishedStartingTimeMediaUs;
+    std::atomic<float> mPublishedPlaybackRate;
+
     int32_t mGeneration;
+    int32_t mNextTimerId;
     std::list<Timer> mTimers;
     sp<AMessage> mNotify;
 
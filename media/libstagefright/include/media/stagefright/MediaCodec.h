@@ -106,6 +106,23 @@ struct MediaCodec : public AHandler {
 
     status_t setCallback(const sp<AMessage> &callback);
 
+    // Low latency alternative to the CB_INPUT_AVAILABLE and CB_OUTPUT_AVAILABLE callback
+    // messages, which take a trip through the looper of the callback message for every buffer.
+    // The methods are called directly on MediaCodec's own looper thread, so they must return
+    // quickly and must not call MediaCodec methods that wait for a reply (i.e. all of them,
+    // except releaseOutputBufferAsync()); hand the index over to another thread instead.
+    struct BufferListener : public RefBase {
+        virtual void onInputBufferAvailable(size_t index) = 0;
+        virtual void onOutputBufferAvailable(
+                size_t index, size_t offset, size_t size, int64_t timeUs, int32_t flags) = 0;
+    protected:
+        virtual ~BufferListener() = default;
+    };
+
+    // Same as setCallback(), but buffer availability goes to |listener| instead of |callback|.
+    // The other callbacks are still delivered through |callback|.
+    status_t setCallback(const sp<AMessage> &callback, const sp<BufferListener> &listener);
+
     status_t setOnFrameRenderedNotification(const sp<AMessage> &notify);
 
     status_t createInputSurface(sp<IGraphicBufferProducer>* bufferProducer);
@@ -136,6 +153,22 @@ struct MediaCodec : public AHandler {
             uint32_t flags,
             AString *errorDetailMsg = NULL);
 
+    struct QueueInputInfo {
+        size_t index;
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+    };
+
+    // Queues |count| input buffers in one round trip to the codec looper, stopping at the
+    // first one that fails. |numQueued| receives the number of buffers queued.
+    status_t queueInputBuffers(
+            const QueueInputInfo *infos,
+            size_t count,
+            size_t *numQueued,
+            AString *errorDetailMsg = NULL);
+
     status_t queueSecureInputBuffer(
             size_t index,
             size_t offset,
@@ -163,6 +196,21 @@ struct MediaCodec : public AHandler {
     status_t renderOutputBufferAndRelease(size_t index);
     status_t releaseOutputBuffer(size_t index);
 
+    struct ReleaseOutputInfo {
+        size_t index;
+        bool render;
+        int64_t timestampNs;    // render time, or -1 for the buffer timestamp
+    };
+
+    // Releases |count| output buffers in one round trip to the codec looper, stopping at the
+    // first one that fails. |numReleased| receives the number of buffers released.
+    status_t releaseOutputBuffers(
+            const ReleaseOutputInfo *infos, size_t count, size_t *numReleased);
+
+    // Releases (and renders, if |render| is set) an output buffer without waiting for the
+    // codec looper; errors are only logged. |timestampNs| is used if not negative.
+    status_t releaseOutputBufferAsync(size_t index, bool render, int64_t timestampNs = -1);
+
     status_t signalEndOfInputStream();
 
     status_t getOutputFormat(sp<AMessage> *format) const;
@@ -241,6 +289,8 @@ private:
         kWhatQueueInputBuffer               = 'queI',
         kWhatDequeueOutputBuffer            = 'deqO',
         kWhatReleaseOutputBuffer            = 'relO',
+        kWhatQueueInputBuffers              = 'qIBs',
+        kWhatReleaseOutputBuffers           = 'rOBs',
         kWhatSignalEndOfInputStream         = 'eois',
         kWhatGetBuffers                     = 'getB',
         kWhatFlush                          = 'flus',
@@ -330,6 +380,7 @@ private:
     sp<AMessage> mOutputFormat;
     sp<AMessage> mInputFormat;
     sp<AMessage> mCallback;
+    sp<BufferListener> mBufferListener;
     sp<AMessage> mOnFrameRenderedNotification;
 
     sp<IResourceManagerClient> mResourceManagerClient;
@@ -494,6 +545,8 @@ private:
         int64_t getCount() const { return mCount; }
         int64_t getSum() const { return mSum; }
         int64_t getAvg() const { return mSum / (mCount == 0 ? 1 : mCount); }
+        // estimated from the buckets, interpolating within the bucket holding the sample
+        int64_t getPercentile(int percentile) const;
         std::string emit();
       private:
         int64_t mFloor, mCeiling, mWidth;
@@ -17,6 +17,8 @@
 #ifndef MediaCodecSource_H_
 #define MediaCodecSource_H_
 
+#include <atomic>
+
 #include <media/MediaSource.h>
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
@@ -49,6 +51,11 @@ struct MediaCodecSource : public MediaSource,
     sp<IGraphicBufferProducer> getGraphicBufferProducer();
     status_t setInputBufferTimeOffset(int64_t timeOffsetUs);
     int64_t getFirstSampleSystemTimeUs();
+    // System time (us) the first encoded frame was output at, or -1 if none was yet.
+    int64_t getFirstOutputSystemTimeUs() const { return mFirstOutputSystemTimeUs; }
+    // For the writer to post with "active" set while it cannot keep up with the
+    // output. Video frames are dropped meanwhile, up to the next sync frame.
+    sp<AMessage> getBackpressureNotify();
 
     // MediaSource
     virtual status_t start(MetaData *params = NULL);
@@ -86,6 +93,7 @@ private:
         kWhatSetStopTimeUs,
         kWhatGetFirstSampleSystemTimeUs,
         kWhatStopStalled,
+        kWhatBackpressure,
     };
 
     MediaCodecSource(
@@ -142,6 +150,10 @@ private:
     int64_t mInputBufferTimeOffsetUs;
     int64_t mFirstSampleSystemTimeUs;
     bool mPausePending;
+    bool mBackpressured;
+    bool mDropUntilSyncFrame;
+    int64_t mNumBackpressureDrops;
+    std::atomic<int64_t> mFirstOutputSystemTimeUs;
 
     // audio drift time
     int64_t mFirstSampleTimeUs;
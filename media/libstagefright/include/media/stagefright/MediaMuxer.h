@@ -30,6 +30,7 @@ struct ABuffer;
 struct AMessage;
 struct MediaAdapter;
 class MediaBuffer;
+class MediaCodecBuffer;
 struct MediaSource;
 class MetaData;
 struct MediaWriter;
@@ -91,6 +92,17 @@ public:
      */
     status_t setLocation(int latitude, int longitude);
 
+    /**
+     * Write a fragmented MP4 file: a moov box without samples, followed by
+     * movie fragments of about the given duration. The file stays playable up
+     * to the last complete fragment if muxing is interrupted, and stop() does
+     * not need to write any sample tables.
+     * This method should be called before start(). MPEG4 and 3GPP only.
+     * @param durationUs fragment duration, 0 for a regular file.
+     * @return OK if no error.
+     */
+    status_t setFragmentDuration(int64_t durationUs);
+
     /**
      * Stop muxing.
      * This method is a blocking call. Depending on how
@@ -117,10 +129,41 @@ public:
     status_t writeSampleData(const sp<ABuffer> &buffer, size_t trackIndex,
                              int64_t timeUs, uint32_t flags) ;
 
+    /**
+     * Send a MediaCodec output buffer for muxing without copying it.
+     * The writer keeps a reference to the buffer until the sample is
+     * written, so the caller must not release the buffer back to the
+     * codec until |releaseNotify| is posted. To keep the codec from
+     * running out of output buffers, only kMaxLentBuffers buffers of a
+     * track are held this way. Further buffers are copied, and their
+     * |releaseNotify| is posted right away.
+     * @param buffer the codec output buffer; its range is the sample.
+     * @param trackIndex the buffer's track index number.
+     * @param timeUs the buffer's time stamp.
+     * @param flags as for the ABuffer version.
+     * @param releaseNotify posted once the buffer is no longer used.
+     * @return OK if no error.
+     */
+    status_t writeSampleData(const sp<MediaCodecBuffer> &buffer, size_t trackIndex,
+                             int64_t timeUs, uint32_t flags,
+                             const sp<AMessage> &releaseNotify);
+
+    enum {
+        kMaxLentBuffers = 2,
+    };
+
 private:
+    struct LentBuffer;
+    struct TrackLending;
+
+    status_t checkSampleData_l(bool isNull, size_t trackIndex);
+    status_t pushSample_l(MediaBuffer *mediaBuffer, size_t trackIndex,
+                          int64_t timeUs, uint32_t flags);
+
     const OutputFormat mFormat;
     sp<MediaWriter> mWriter;
     Vector< sp<MediaAdapter> > mTrackList;  // Each track has its MediaAdapter.
+    Vector< sp<TrackLending> > mLending;    // buffers held by the writer, per track
     sp<MetaData> mFileMeta;  // Metadata for the whole file.
 
     Mutex mMuxerLock;
@@ -116,6 +116,11 @@ enum {
     kKey64BitFileOffset   = 'fobt',  // int32_t (bool)
     kKey2ByteNalLength    = '2NAL',  // int32_t (bool)
 
+    // Set this key to a positive duration to author a fragmented MP4 file
+    kKeyFragmentDurationUs = 'frgd', // int64_t
+    // The reader may keep the buffer until it is done with it instead of copying it.
+    kKeyMayHoldBuffer     = 'mhld',  // int32_t (bool)
+
     // Identify the file output format for authoring
     // Please see <media/mediarecorder.h> for the supported
     // file output formats.
@@ -306,6 +311,13 @@ public:
 
     bool hasData(uint32_t key) const;
 
+    size_t countEntries() const;
+    uint32_t getEntryKeyAt(size_t index) const;
+
+    // Unmodified copies share a generation, and every modification changes it, so it
+    // can be used to cache values derived from the meta data.
+    uint64_t generation() const;
+
     String8 toString() const;
     void dumpToLog() const;
 
@@ -318,7 +330,9 @@ private:
     struct typed_data;
     struct Rect;
     struct MetaDataInternal;
-    MetaDataInternal *mInternalData;
+    // Shared by copies until one of them is modified, see editInternalData().
+    sp<MetaDataInternal> mInternalData;
+    MetaDataInternal *editInternalData();
     status_t writeToParcel(Parcel &parcel);
     status_t updateFromParcel(const Parcel &parcel);
 };
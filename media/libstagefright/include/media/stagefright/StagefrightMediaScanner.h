@@ -19,9 +19,12 @@
 #define STAGEFRIGHT_MEDIA_SCANNER_H_
 
 #include <media/mediascanner.h>
+#include <utils/StrongPointer.h>
 
 namespace android {
 
+class MediaMetadataRetriever;
+
 struct StagefrightMediaScanner : public MediaScanner {
     StagefrightMediaScanner();
     virtual ~StagefrightMediaScanner();
@@ -32,13 +35,32 @@ struct StagefrightMediaScanner : public MediaScanner {
 
     virtual MediaAlbumArt *extractAlbumArt(int fd);
 
+    // A file scanned by processFiles(). Each entry has its own client, which is only
+    // called from the worker thread scanning that file.
+    struct BatchEntry {
+        const char *path;
+        const char *mimeType;
+        MediaScannerClient *client;
+        bool wantAlbumArt;
+
+        // set by processFiles()
+        MediaScanResult result;
+        MediaAlbumArt *albumArt;    // or NULL, allocated with malloc(), freed by the caller
+    };
+
+    // Scans |count| files on up to |numThreads| worker threads, like processFile() for each.
+    // The metadata and the album art of a file are read through the same retriever, so
+    // each file is opened and sniffed once.
+    void processFiles(BatchEntry *entries, size_t count, size_t numThreads);
+
 private:
     StagefrightMediaScanner(const StagefrightMediaScanner &);
     StagefrightMediaScanner &operator=(const StagefrightMediaScanner &);
 
     MediaScanResult processFileInternal(
             const char *path, const char *mimeType,
-            MediaScannerClient &client);
+            MediaScannerClient &client, sp<MediaMetadataRetriever> *retriever = NULL);
+    void processBatchEntry(BatchEntry *entry);
 };
 
 }  // namespace android
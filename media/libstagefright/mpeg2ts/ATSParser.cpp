@@ -45,6 +45,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 namespace android {
 using hardware::hidl_string;
 using hardware::hidl_vec;
@@ -77,6 +79,10 @@ struct ATSParser::Program : public RefBase {
             unsigned random_access_indicator,
             ABitReader *br, status_t *err, SyncEvent *event);
 
+    bool hasStream(unsigned pid) const {
+        return mStreams.indexOfKey(pid) >= 0;
+    }
+
     void signalDiscontinuity(
             DiscontinuityType type, const sp<AMessage> &extra);
 
@@ -409,6 +415,7 @@ bool ATSParser::Program::switchPIDs(const Vector<StreamInfo> &infos) {
             }
 
             mStreams.clear();
+            mParser->mProgramForPID.clear();
             for (i = 0; i < temp.size(); ++i) {
                 // The two checks below shouldn't happen,
                 // we already checked above the stream count matches
@@ -742,6 +749,7 @@ status_t ATSParser::Program::parseProgramMap(ABitReader *br) {
 
             isAddingScrambledStream |= info.mCADescriptor.mSystemID >= 0;
             mStreams.add(info.mPID, stream);
+            mParser->mProgramForPID.clear();
         }
         else if (index >= 0 && mStreams.editValueAt(index)->isAudio()
                  && audioPresentationsChanged) {
@@ -1033,7 +1041,11 @@ bool ATSParser::Stream::ensureBufferCapacity(size_t neededSize) {
         ALOGD("[stream %d] created shared buffer for descrambling, size %zu",
                 mElementaryPID, neededSize);
     } else {
-        // Align to multiples of 64K.
+        // Grow geometrically, so that a large PES is not copied once per 64K,
+        // and align to multiples of 64K.
+        if (mBuffer != NULL && neededSize < 2 * mBuffer->capacity()) {
+            neededSize = 2 * mBuffer->capacity();
+        }
         neededSize = (neededSize + 65535) & ~65535;
     }
 
@@ -1119,6 +1131,14 @@ status_t ATSParser::Stream::parse(
     }
 
     size_t neededSize = mBuffer->size() + payloadSizeBits / 8;
+    if (payload_unit_start_indicator && !mScrambled && payloadSizeBits >= 48) {
+        // reserve the whole PES packet up front if its header tells the length
+        const uint8_t *pes = br->data();
+        const size_t pesLength = U16_AT(pes + 4);
+        if (pes[0] == 0x00 && pes[1] == 0x00 && pes[2] == 0x01 && pesLength > 0) {
+            neededSize = std::max(neededSize, mBuffer->size() + 6 + pesLength);
+        }
+    }
     if (!ensureBufferCapacity(neededSize)) {
         return NO_MEMORY;
     }
@@ -1893,6 +1913,19 @@ status_t ATSParser::feedTSPacket(const void *data, size_t size,
     return parseTS(&br, event);
 }
 
+status_t ATSParser::feedTSPackets(const void *data, size_t size) {
+    const uint8_t *packet = (const uint8_t *)data;
+    for (size_t n = size / kTSPacketSize; n > 0; --n) {
+        ABitReader br(packet, kTSPacketSize);
+        status_t err = parseTS(&br, NULL /* event */);
+        if (err != OK) {
+            return err;
+        }
+        packet += kTSPacketSize;
+    }
+    return OK;
+}
+
 status_t ATSParser::setMediaCas(const sp<ICas> &cas) {
     status_t err = mCasManager->setMediaCas(cas);
     if (err != OK) {
@@ -2015,6 +2048,7 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
             if (!found) {
                 mPrograms.push(
                         new Program(this, program_number, programMapPID, mLastRecoveredPTS));
+                mProgramForPID.clear();
                 if (mSampleAesKeyItem != NULL) {
                     mPrograms.top()->signalNewSampleAesKey(mSampleAesKeyItem);
                 }
@@ -2102,10 +2136,23 @@ status_t ATSParser::parsePID(
         return OK;
     }
 
+    ssize_t programIndex = mProgramForPID.indexOfKey(PID);
+    if (programIndex < 0) {
+        sp<Program> program;
+        for (size_t i = 0; i < mPrograms.size(); ++i) {
+            if (mPrograms.itemAt(i)->hasStream(PID)) {
+                program = mPrograms.itemAt(i);
+                break;
+            }
+        }
+        programIndex = mProgramForPID.add(PID, program);
+    }
+
     bool handled = false;
-    for (size_t i = 0; i < mPrograms.size(); ++i) {
+    const sp<Program> &program = mProgramForPID.valueAt(programIndex);
+    if (program != NULL) {
         status_t err;
-        if (mPrograms.editItemAt(i)->parsePID(
+        if (program->parsePID(
                     PID, continuity_counter,
                     payload_unit_start_indicator,
                     transport_scrambling_control,
@@ -2116,7 +2163,6 @@ status_t ATSParser::parsePID(
             }
 
             handled = true;
-            break;
         }
     }
 
@@ -2204,32 +2250,39 @@ status_t ATSParser::parseAdaptationField(
 status_t ATSParser::parseTS(ABitReader *br, SyncEvent *event) {
     ALOGV("---");
 
-    unsigned sync_byte = br->getBits(8);
+    // the 4 header bytes, decoded directly
+    const uint8_t *header = br->data();
+    if (br->numBitsLeft() < 32) {
+        return ERROR_MALFORMED;
+    }
+    br->skipBits(32);
+
+    unsigned sync_byte = header[0];
     if (sync_byte != 0x47u) {
         ALOGE("[error] parseTS: return error as sync_byte=0x%x", sync_byte);
         return BAD_VALUE;
     }
 
-    if (br->getBits(1)) {  // transport_error_indicator
+    if (header[1] & 0x80) {  // transport_error_indicator
         // silently ignore.
         return OK;
     }
 
-    unsigned payload_unit_start_indicator = br->getBits(1);
+    unsigned payload_unit_start_indicator = (header[1] >> 6) & 1;
     ALOGV("payload_unit_start_indicator = %u", payload_unit_start_indicator);
 
-    MY_LOGV("transport_priority = %u", br->getBits(1));
+    MY_LOGV("transport_priority = %u", (header[1] >> 5) & 1);
 
-    unsigned PID = br->getBits(13);
+    unsigned PID = ((header[1] & 0x1f) << 8) | header[2];
     ALOGV("PID = 0x%04x", PID);
 
-    unsigned transport_scrambling_control = br->getBits(2);
+    unsigned transport_scrambling_control = header[3] >> 6;
     ALOGV("transport_scrambling_control = %u", transport_scrambling_control);
 
-    unsigned adaptation_field_control = br->getBits(2);
+    unsigned adaptation_field_control = (header[3] >> 4) & 3;
     ALOGV("adaptation_field_control = %u", adaptation_field_control);
 
-    unsigned continuity_counter = br->getBits(4);
+    unsigned continuity_counter = header[3] & 0x0f;
     ALOGV("PID = 0x%04x, continuity_counter = %u", PID, continuity_counter);
 
     // ALOGI("PID = 0x%04x, continuity_counter = %u", PID, continuity_counter);
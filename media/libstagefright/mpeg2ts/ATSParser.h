@@ -122,6 +122,11 @@ struct ATSParser : public RefBase {
     status_t feedTSPacket(
             const void *data, size_t size, SyncEvent *event = NULL);
 
+    // Feed the whole 188 byte TS packets in a contiguous buffer, any trailing
+    // partial packet is ignored. Stops at the first packet that
+    // fails to parse and returns its error.
+    status_t feedTSPackets(const void *data, size_t size);
+
     void signalDiscontinuity(
             DiscontinuityType type, const sp<AMessage> &extra);
 
@@ -209,6 +214,10 @@ private:
     // Keyed by PID
     KeyedVector<unsigned, sp<PSISection> > mPSISections;
 
+    // The program that has a stream with a PID, or NULL if none does. Filled on
+    // demand and cleared whenever programs or their streams change.
+    KeyedVector<unsigned, sp<Program> > mProgramForPID;
+
     int64_t mAbsoluteTimeAnchorUs;
 
     bool mTimeOffsetValid;
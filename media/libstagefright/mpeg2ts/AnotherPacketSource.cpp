@@ -285,15 +285,31 @@ bool AnotherPacketSource::wasFormatChange(
 }
 
 void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
+    Mutex::Autolock autoLock(mLock);
+    if (queueAccessUnit_l(buffer)) {
+        mCondition.signal();
+    }
+}
+
+void AnotherPacketSource::queueAccessUnits(const List<sp<ABuffer> > &buffers) {
+    Mutex::Autolock autoLock(mLock);
+    bool queued = false;
+    for (List<sp<ABuffer> >::const_iterator it = buffers.begin(); it != buffers.end(); ++it) {
+        queued |= queueAccessUnit_l(*it);
+    }
+    if (queued) {
+        mCondition.signal();
+    }
+}
+
+bool AnotherPacketSource::queueAccessUnit_l(const sp<ABuffer> &buffer) {
     int32_t damaged;
     if (buffer->meta()->findInt32("damaged", &damaged) && damaged) {
         // LOG(VERBOSE) << "discarding damaged AU";
-        return;
+        return false;
     }
 
-    Mutex::Autolock autoLock(mLock);
     mBuffers.push_back(buffer);
-    mCondition.signal();
 
     int32_t discontinuity;
     if (buffer->meta()->findInt32("discontinuity", &discontinuity)){
@@ -304,7 +320,7 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
         mLatestEnqueuedMeta = NULL;
 
         mDiscontinuitySegments.push_back(DiscontinuitySegment());
-        return;
+        return true;
     }
 
     int64_t lastQueuedTimeUs;
@@ -338,6 +354,7 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
             mLatestEnqueuedMeta->setInt64("durationUs", frameDeltaUs);
         }
     }
+    return true;
 }
 
 void AnotherPacketSource::clear() {
@@ -64,6 +64,9 @@ struct AnotherPacketSource : public MediaSource {
 
     void queueAccessUnit(const sp<ABuffer> &buffer);
 
+    // Queues several access units under one lock and wakes up a reader once.
+    void queueAccessUnits(const List<sp<ABuffer> > &buffers);
+
     void queueDiscontinuity(
             ATSParser::DiscontinuityType type,
             const sp<AMessage> &extra,
@@ -124,6 +127,9 @@ private:
 
     bool wasFormatChange(int32_t discontinuityType) const;
 
+    // Returns false if the buffer was discarded.
+    bool queueAccessUnit_l(const sp<ABuffer> &buffer);
+
     DISALLOW_EVIL_CONSTRUCTORS(AnotherPacketSource);
 };
 
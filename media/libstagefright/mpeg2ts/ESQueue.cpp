@@ -33,6 +33,8 @@
 #include <media/cas/DescramblerAPI.h>
 #include <media/hardware/CryptoAPI.h>
 
+#include <algorithm>
+
 #include <inttypes.h>
 #include <netinet/in.h>
 
@@ -44,6 +46,7 @@ ElementaryStreamQueue::ElementaryStreamQueue(Mode mode, uint32_t flags)
       mEOSReached(false),
       mCASystemId(0),
       mAUIndex(0) {
+    resetH264Scan();
 
     ALOGV("ElementaryStreamQueue(%p) mode %x  flags %x  isScrambled %d  isSampleEncrypted %d",
             this, mode, flags, isScrambled(), isSampleEncrypted());
@@ -57,10 +60,21 @@ sp<MetaData> ElementaryStreamQueue::getFormat() {
     return mFormat;
 }
 
+void ElementaryStreamQueue::resetH264Scan() {
+    mH264Scan.mNals.clear();
+    mH264Scan.mNalStart = -1;
+    mH264Scan.mSearchOffset = 0;
+    mH264Scan.mTotalSize = 0;
+    mH264Scan.mSeiCount = 0;
+    mH264Scan.mFoundSlice = false;
+    mH264Scan.mFoundIDR = false;
+}
+
 void ElementaryStreamQueue::clear(bool clearFormat) {
     if (mBuffer != NULL) {
         mBuffer->setRange(0, 0);
     }
+    resetH264Scan();
 
     mRangeInfos.clear();
 
@@ -452,15 +466,8 @@ status_t ElementaryStreamQueue::appendData(
 #else
                 uint8_t *ptr = (uint8_t *)data;
 
-                ssize_t startOffset = -1;
-                for (size_t i = 0; i + 2 < size; ++i) {
-                    if (!memcmp("\x00\x00\x01", &ptr[i], 3)) {
-                        startOffset = i;
-                        break;
-                    }
-                }
-
-                if (startOffset < 0) {
+                ssize_t startOffset = findNALStartCode(ptr, size);
+                if ((size_t)startOffset == size) {
                     return ERROR_MALFORMED;
                 }
 
@@ -485,15 +492,8 @@ status_t ElementaryStreamQueue::appendData(
 #else
                 uint8_t *ptr = (uint8_t *)data;
 
-                ssize_t startOffset = -1;
-                for (size_t i = 0; i + 2 < size; ++i) {
-                    if (!memcmp("\x00\x00\x01", &ptr[i], 3)) {
-                        startOffset = i;
-                        break;
-                    }
-                }
-
-                if (startOffset < 0) {
+                ssize_t startOffset = findNALStartCode(ptr, size);
+                if ((size_t)startOffset == size) {
                     return ERROR_MALFORMED;
                 }
 
@@ -662,6 +662,11 @@ status_t ElementaryStreamQueue::appendData(
 
     size_t neededSize = (mBuffer == NULL ? 0 : mBuffer->size()) + size;
     if (mBuffer == NULL || neededSize > mBuffer->capacity()) {
+        // grow geometrically, so that appending a large access unit in
+        // pieces does not copy the buffer once per 64K.
+        if (mBuffer != NULL && neededSize < 2 * mBuffer->capacity()) {
+            neededSize = 2 * mBuffer->capacity();
+        }
         neededSize = (neededSize + 65535) & ~65535;
 
         ALOGV("resizing buffer to size %zu", neededSize);
@@ -708,6 +713,9 @@ void ElementaryStreamQueue::appendScrambledData(
 
     size_t neededSize = (mScrambledBuffer == NULL ? 0 : mScrambledBuffer->size()) + size;
     if (mScrambledBuffer == NULL || neededSize > mScrambledBuffer->capacity()) {
+        if (mScrambledBuffer != NULL && neededSize < 2 * mScrambledBuffer->capacity()) {
+            neededSize = 2 * mScrambledBuffer->capacity();
+        }
         neededSize = (neededSize + 65535) & ~65535;
 
         ALOGI("resizing scrambled buffer to size %zu", neededSize);
@@ -1326,22 +1334,51 @@ int64_t ElementaryStreamQueue::fetchTimestamp(
 
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
     const uint8_t *data = mBuffer->data();
+    const size_t size = mBuffer->size();
+
+    // The NAL units found by earlier calls stay in mH264Scan, only the data
+    // appended since is scanned. This finds the same NAL units as
+    // getNextNALUnit().
+    H264ScanState &scan = mH264Scan;
+    Vector<NALPosition> &nals = scan.mNals;
+    size_t &totalSize = scan.mTotalSize;
+    size_t &seiCount = scan.mSeiCount;
+    bool &foundSlice = scan.mFoundSlice;
+    bool &foundIDR = scan.mFoundIDR;
 
-    size_t size = mBuffer->size();
-    Vector<NALPosition> nals;
+    ALOGV("dequeueAccessUnit_H264[%d] %p/%zu", mAUIndex, data, size);
+
+    for (;;) {
+        if (scan.mNalStart < 0) {
+            const size_t offset = scan.mSearchOffset
+                    + findNALStartCode(data + scan.mSearchOffset, size - scan.mSearchOffset);
+            if (offset == size) {
+                // a start code may straddle the end of the data
+                scan.mSearchOffset = size < 2 ? 0 : std::max(scan.mSearchOffset, size - 2);
+                return NULL;
+            }
+            scan.mNalStart = offset + 3;
+            scan.mSearchOffset = offset + 3;
+        }
 
-    size_t totalSize = 0;
-    size_t seiCount = 0;
+        const size_t nextStartCode = scan.mSearchOffset
+                + findNALStartCode(data + scan.mSearchOffset, size - scan.mSearchOffset);
+        if (nextStartCode == size) {
+            scan.mSearchOffset = std::max(scan.mSearchOffset, size < 2 ? 0 : size - 2);
+            return NULL;
+        }
 
-    status_t err;
-    const uint8_t *nalStart;
-    size_t nalSize;
-    bool foundSlice = false;
-    bool foundIDR = false;
+        size_t endOffset = nextStartCode;
+        while (endOffset > (size_t)scan.mNalStart + 1 && data[endOffset - 1] == 0x00) {
+            --endOffset;
+        }
+        const uint8_t *nalStart = data + scan.mNalStart;
+        const size_t nalSize = endOffset - scan.mNalStart;
 
-    ALOGV("dequeueAccessUnit_H264[%d] %p/%zu", mAUIndex, data, size);
+        // the next NAL unit starts with the start code just found
+        scan.mNalStart = -1;
+        scan.mSearchOffset = nextStartCode;
 
-    while ((err = getNextNALUnit(&data, &size, &nalStart, &nalSize)) == OK) {
         if (nalSize == 0) continue;
 
         unsigned nalType = nalStart[0] & 0x1f;
@@ -1452,6 +1489,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
             const NALPosition &pos = nals.itemAt(nals.size() - 1);
             size_t nextScan = pos.nalOffset + pos.nalSize;
+            const size_t numNals = nals.size();
+            const bool isSync = foundIDR;
+            // the current NAL unit starts the next access unit, scan it again.
+            resetH264Scan();
 
             memmove(mBuffer->data(),
                     mBuffer->data() + nextScan,
@@ -1466,7 +1507,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
             }
 
             accessUnit->meta()->setInt64("timeUs", timeUs);
-            if (foundIDR) {
+            if (isSync) {
                 accessUnit->meta()->setInt32("isSync", 1);
             }
 
@@ -1486,9 +1527,9 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
                 accessUnit->setRange(0, adjustedSize);
             }
 
-            ALOGV("dequeueAccessUnitH264[%d]: AU %p(%zu) dstOffset:%zu, nals:%zu, totalSize:%zu ",
+            ALOGV("dequeueAccessUnitH264[%d]: AU %p(%zu) dstOffset:%zu, nals:%zu",
                     mAUIndex, accessUnit->data(), accessUnit->size(),
-                    dstOffset, nals.size(), totalSize);
+                    dstOffset, numNals);
             mAUIndex++;
 
             return accessUnit;
@@ -1502,12 +1543,6 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
         totalSize += nalSize;
     }
-    if (err != (status_t)-EAGAIN) {
-        ALOGE("Unexpeted err");
-        return NULL;
-    }
-
-    return NULL;
 }
 
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGAudio() {
@@ -20,9 +20,11 @@
 
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/avc_utils.h>
 #include <utils/Errors.h>
 #include <utils/List.h>
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 #include <vector>
 
 #include "HlsSampleDecryptor.h"
@@ -112,6 +114,22 @@ private:
     sp<HlsSampleDecryptor> mSampleDecryptor;
     int mAUIndex;
 
+    // Where dequeueAccessUnitH264() stopped scanning mBuffer, so that data
+    // appended later is scanned once rather than from the start of the
+    // pending access unit every time.
+    struct H264ScanState {
+        Vector<NALPosition> mNals;  // complete NAL units of the pending AU
+        ssize_t mNalStart;          // start of the unterminated NAL unit, or -1
+        size_t mSearchOffset;       // where the search for a start code resumes
+        size_t mTotalSize;
+        size_t mSeiCount;
+        bool mFoundSlice;
+        bool mFoundIDR;
+    };
+    H264ScanState mH264Scan;
+
+    void resetH264Scan();
+
     bool isSampleEncrypted() const {
         return (mFlags & kFlag_SampleEncryptedData) != 0;
     }
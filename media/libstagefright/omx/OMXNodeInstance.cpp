@@ -109,14 +109,16 @@ struct BufferMeta {
           mCopyFromOmx(portIndex == kPortIndexOutput && copy),
           mCopyToOmx(portIndex == kPortIndexInput && copy),
           mPortIndex(portIndex),
-          mBackup(backup) {
+          mBackup(backup),
+          mBufferID(0) {
     }
 
     explicit BufferMeta(OMX_U32 portIndex)
         : mCopyFromOmx(false),
           mCopyToOmx(false),
           mPortIndex(portIndex),
-          mBackup(NULL) {
+          mBackup(NULL),
+          mBufferID(0) {
     }
 
     explicit BufferMeta(const sp<GraphicBuffer> &graphicBuffer, OMX_U32 portIndex)
@@ -124,7 +126,8 @@ struct BufferMeta {
           mCopyFromOmx(false),
           mCopyToOmx(false),
           mPortIndex(portIndex),
-          mBackup(NULL) {
+          mBackup(NULL),
+          mBufferID(0) {
     }
 
     OMX_U8 *getPointer() {
@@ -139,9 +142,11 @@ struct BufferMeta {
         }
 
         // check component returns proper range
-        sp<ABuffer> codec = getBuffer(header, true /* limit */);
-
-        memcpy(getPointer() + header->nOffset, codec->data(), codec->size());
+        if (header->nOffset + header->nFilledLen > header->nOffset
+                && header->nOffset + header->nFilledLen <= header->nAllocLen) {
+            memcpy(getPointer() + header->nOffset, header->pBuffer + header->nOffset,
+                    header->nFilledLen);
+        }
     }
 
     void CopyToOMX(const OMX_BUFFERHEADERTYPE *header) {
@@ -180,6 +185,15 @@ struct BufferMeta {
         return mPortIndex;
     }
 
+    // the id of the buffer, read by component callbacks without mBufferIDLock
+    void setBufferID(IOMX::buffer_id buffer) {
+        mBufferID.store(buffer, std::memory_order_relaxed);
+    }
+
+    IOMX::buffer_id getBufferID() const {
+        return mBufferID.load(std::memory_order_relaxed);
+    }
+
     ~BufferMeta() {
         delete[] mBackup;
     }
@@ -193,6 +207,7 @@ private:
     bool mCopyToOmx;
     OMX_U32 mPortIndex;
     OMX_U8 *mBackup;
+    std::atomic<IOMX::buffer_id> mBufferID;
 
     BufferMeta(const BufferMeta &);
     BufferMeta &operator=(const BufferMeta &);
@@ -370,6 +385,10 @@ OMXNodeInstance::OMXNodeInstance(
     mDebugLevelBumpPendingBuffers[1] = 0;
     mMetadataType[0] = kMetadataBufferTypeInvalid;
     mMetadataType[1] = kMetadataBufferTypeInvalid;
+    for (BufferIDSlot &slot : mBufferIDSlots) {
+        slot.mID.store(0, std::memory_order_relaxed);
+        slot.mHeader.store(NULL, std::memory_order_relaxed);
+    }
     mPortMode[0] = IOMX::kPortModePresetByteBuffer;
     mPortMode[1] = IOMX::kPortModePresetByteBuffer;
     mSecureBufferType[0] = kSecureBufferTypeUnknown;
@@ -415,6 +434,11 @@ sp<IOMXObserver> OMXNodeInstance::observer() {
 
 status_t OMXNodeInstance::freeNode() {
     CLOG_LIFE(freeNode, "handle=%p", mHandle);
+    {
+        Mutex::Autolock _l(mDebugLock);
+        CLOG_LIFE(freeNode, "emptyBuffer %s, fillBuffer %s",
+                mEmptyBufferStats.toString().c_str(), mFillBufferStats.toString().c_str());
+    }
     static int32_t kMaxNumIterations = 10;
 
     // Transition the node from its current state all the way down
@@ -1453,18 +1477,18 @@ status_t OMXNodeInstance::updateGraphicBufferInMeta_l(
         return BAD_VALUE;
     }
 
+    // the metadata is updated in place in the codec buffer
     BufferMeta *bufferMeta = (BufferMeta *)(header->pAppPrivate);
-    sp<ABuffer> data = bufferMeta->getBuffer(header, false /* limit */);
     bufferMeta->setGraphicBuffer(graphicBuffer);
     MetadataBufferType metaType = mMetadataType[portIndex];
     if (metaType == kMetadataBufferTypeGrallocSource
-            && data->capacity() >= sizeof(VideoGrallocMetadata)) {
-        VideoGrallocMetadata &metadata = *(VideoGrallocMetadata *)(data->data());
+            && header->nAllocLen >= sizeof(VideoGrallocMetadata)) {
+        VideoGrallocMetadata &metadata = *(VideoGrallocMetadata *)(header->pBuffer);
         metadata.eType = kMetadataBufferTypeGrallocSource;
         metadata.pHandle = graphicBuffer == NULL ? NULL : graphicBuffer->handle;
     } else if (metaType == kMetadataBufferTypeANWBuffer
-            && data->capacity() >= sizeof(VideoNativeMetadata)) {
-        VideoNativeMetadata &metadata = *(VideoNativeMetadata *)(data->data());
+            && header->nAllocLen >= sizeof(VideoNativeMetadata)) {
+        VideoNativeMetadata &metadata = *(VideoNativeMetadata *)(header->pBuffer);
         metadata.eType = kMetadataBufferTypeANWBuffer;
         metadata.pBuffer = graphicBuffer == NULL ? NULL : graphicBuffer->getNativeBuffer();
         metadata.nFenceFd = -1;
@@ -1494,17 +1518,16 @@ status_t OMXNodeInstance::updateNativeHandleInMeta_l(
     }
 
     BufferMeta *bufferMeta = (BufferMeta *)(header->pAppPrivate);
-    sp<ABuffer> data = bufferMeta->getBuffer(header, false /* limit */);
     bufferMeta->setNativeHandle(nativeHandle);
     if (mMetadataType[portIndex] == kMetadataBufferTypeNativeHandleSource
-            && data->capacity() >= sizeof(VideoNativeHandleMetadata)) {
-        VideoNativeHandleMetadata &metadata = *(VideoNativeHandleMetadata *)(data->data());
+            && header->nAllocLen >= sizeof(VideoNativeHandleMetadata)) {
+        VideoNativeHandleMetadata &metadata = *(VideoNativeHandleMetadata *)(header->pBuffer);
         metadata.eType = mMetadataType[portIndex];
         metadata.pHandle =
             nativeHandle == NULL ? NULL : const_cast<native_handle*>(nativeHandle->handle());
     } else {
-        CLOG_ERROR(updateNativeHandleInMeta, BAD_VALUE, "%s:%u, %#x bad type (%d) or size (%zu)",
-            portString(portIndex), portIndex, buffer, mMetadataType[portIndex], data->capacity());
+        CLOG_ERROR(updateNativeHandleInMeta, BAD_VALUE, "%s:%u, %#x bad type (%d) or size (%u)",
+            portString(portIndex), portIndex, buffer, mMetadataType[portIndex], header->nAllocLen);
         return BAD_VALUE;
     }
 
@@ -1675,6 +1698,7 @@ status_t OMXNodeInstance::freeBuffer(
 
 status_t OMXNodeInstance::fillBuffer(
         IOMX::buffer_id buffer, const OMXBuffer &omxBuffer, int fenceFd) {
+    CallTimer timer(this, &mFillBufferStats);
     Mutex::Autolock autoLock(mLock);
     if (mHandle == NULL) {
         return DEAD_OBJECT;
@@ -1728,6 +1752,7 @@ status_t OMXNodeInstance::fillBuffer(
 status_t OMXNodeInstance::emptyBuffer(
         buffer_id buffer, const OMXBuffer &omxBuffer,
         OMX_U32 flags, OMX_TICKS timestamp, int fenceFd) {
+    CallTimer timer(this, &mEmptyBufferStats);
     Mutex::Autolock autoLock(mLock);
     if (mHandle == NULL) {
         return DEAD_OBJECT;
@@ -2431,6 +2456,36 @@ void OMXNodeInstance::freeActiveBuffers() {
     }
 }
 
+void OMXNodeInstance::CallStats::add(nsecs_t ns) {
+    ++mCalls;
+    mTotalNs += ns;
+    if (ns > mMaxNs) {
+        mMaxNs = ns;
+    }
+}
+
+AString OMXNodeInstance::CallStats::toString() const {
+    return AStringPrintf("%lld calls, avg %lld us, max %lld us", (long long)mCalls,
+            mCalls > 0 ? (long long)(mTotalNs / mCalls / 1000) : 0ll, (long long)(mMaxNs / 1000));
+}
+
+struct OMXNodeInstance::CallTimer {
+    CallTimer(OMXNodeInstance *instance, CallStats *stats)
+        : mInstance(instance), mStats(stats), mStartNs(systemTime(SYSTEM_TIME_MONOTONIC)) {
+    }
+
+    ~CallTimer() {
+        const nsecs_t ns = systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs;
+        Mutex::Autolock _l(mInstance->mDebugLock);
+        mStats->add(ns);
+    }
+
+private:
+    OMXNodeInstance *mInstance;
+    CallStats *mStats;
+    const nsecs_t mStartNs;
+};
+
 IOMX::buffer_id OMXNodeInstance::makeBufferID(OMX_BUFFERHEADERTYPE *bufferHeader) {
     if (bufferHeader == NULL) {
         return 0;
@@ -2445,21 +2500,44 @@ IOMX::buffer_id OMXNodeInstance::makeBufferID(OMX_BUFFERHEADERTYPE *bufferHeader
     } while (mBufferIDToBufferHeader.indexOfKey(buffer) >= 0);
     mBufferIDToBufferHeader.add(buffer, bufferHeader);
     mBufferHeaderToBufferID.add(bufferHeader, buffer);
+    static_cast<BufferMeta *>(bufferHeader->pAppPrivate)->setBufferID(buffer);
+
+    BufferIDSlot &slot = mBufferIDSlots[buffer % kNumBufferIDSlots];
+    if (slot.mID.load(std::memory_order_relaxed) == 0) {
+        slot.mHeader.store(bufferHeader, std::memory_order_relaxed);
+        slot.mID.store(buffer, std::memory_order_release);
+    }
     return buffer;
 }
 
+OMX_BUFFERHEADERTYPE *OMXNodeInstance::findBufferHeaderInSlot(IOMX::buffer_id buffer) {
+    // the header is valid if the slot held |buffer| both before and after reading it.
+    BufferIDSlot &slot = mBufferIDSlots[buffer % kNumBufferIDSlots];
+    if (slot.mID.load(std::memory_order_acquire) != buffer) {
+        return NULL;
+    }
+    OMX_BUFFERHEADERTYPE *header = slot.mHeader.load(std::memory_order_acquire);
+    if (slot.mID.load(std::memory_order_acquire) != buffer) {
+        return NULL;
+    }
+    return header;
+}
+
 OMX_BUFFERHEADERTYPE *OMXNodeInstance::findBufferHeader(
         IOMX::buffer_id buffer, OMX_U32 portIndex) {
     if (buffer == 0) {
         return NULL;
     }
-    Mutex::Autolock autoLock(mBufferIDLock);
-    ssize_t index = mBufferIDToBufferHeader.indexOfKey(buffer);
-    if (index < 0) {
-        CLOGW("findBufferHeader: buffer %u not found", buffer);
-        return NULL;
+    OMX_BUFFERHEADERTYPE *header = findBufferHeaderInSlot(buffer);
+    if (header == NULL) {
+        Mutex::Autolock autoLock(mBufferIDLock);
+        ssize_t index = mBufferIDToBufferHeader.indexOfKey(buffer);
+        if (index < 0) {
+            CLOGW("findBufferHeader: buffer %u not found", buffer);
+            return NULL;
+        }
+        header = mBufferIDToBufferHeader.valueAt(index);
     }
-    OMX_BUFFERHEADERTYPE *header = mBufferIDToBufferHeader.valueAt(index);
     BufferMeta *buffer_meta =
         static_cast<BufferMeta *>(header->pAppPrivate);
     if (buffer_meta->getPortIndex() != portIndex) {
@@ -2474,6 +2552,14 @@ IOMX::buffer_id OMXNodeInstance::findBufferID(OMX_BUFFERHEADERTYPE *bufferHeader
     if (bufferHeader == NULL) {
         return 0;
     }
+    // only trust the id kept with the header if it maps back to the header.
+    const BufferMeta *bufferMeta = static_cast<const BufferMeta *>(bufferHeader->pAppPrivate);
+    if (bufferMeta != NULL) {
+        const IOMX::buffer_id buffer = bufferMeta->getBufferID();
+        if (buffer != 0 && findBufferHeaderInSlot(buffer) == bufferHeader) {
+            return buffer;
+        }
+    }
     Mutex::Autolock autoLock(mBufferIDLock);
     ssize_t index = mBufferHeaderToBufferID.indexOfKey(bufferHeader);
     if (index < 0) {
@@ -2493,6 +2579,11 @@ void OMXNodeInstance::invalidateBufferID(IOMX::buffer_id buffer) {
         CLOGW("invalidateBufferID: buffer %u not found", buffer);
         return;
     }
+    BufferIDSlot &slot = mBufferIDSlots[buffer % kNumBufferIDSlots];
+    if (slot.mID.load(std::memory_order_relaxed) == buffer) {
+        slot.mID.store(0, std::memory_order_release);
+        slot.mHeader.store(NULL, std::memory_order_relaxed);
+    }
     mBufferHeaderToBufferID.removeItem(mBufferIDToBufferHeader.valueAt(index));
     mBufferIDToBufferHeader.removeItemsAt(index);
 }
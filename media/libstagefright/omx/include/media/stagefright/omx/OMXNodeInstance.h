@@ -21,7 +21,9 @@
 #include <atomic>
 
 #include <media/IOMX.h>
+#include <media/stagefright/foundation/AString.h>
 #include <utils/RefBase.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 #include <utils/KeyedVector.h>
 #include <utils/SortedVector.h>
@@ -150,6 +152,15 @@ private:
     uint32_t mBufferIDCount;
     KeyedVector<IOMX::buffer_id, OMX_BUFFERHEADERTYPE *> mBufferIDToBufferHeader;
     KeyedVector<OMX_BUFFERHEADERTYPE *, IOMX::buffer_id> mBufferHeaderToBufferID;
+    // Buffer ids are also kept in slots indexed by their low bits, which are looked up
+    // without mBufferIDLock by the per-frame calls and the component callbacks. A slot is
+    // only written under mBufferIDLock; ids that collide are found in the maps above.
+    struct BufferIDSlot {
+        std::atomic<uint32_t> mID;  // 0 if free, written after mHeader
+        std::atomic<OMX_BUFFERHEADERTYPE *> mHeader;
+    };
+    enum { kNumBufferIDSlots = 128 };
+    BufferIDSlot mBufferIDSlots[kNumBufferIDSlots];
 
     bool mLegacyAdaptiveExperiment;
     IOMX::PortMode mPortMode[2];
@@ -180,6 +191,16 @@ private:
     int DEBUG_BUMP;
     SortedVector<OMX_BUFFERHEADERTYPE *> mInputBuffersWithCodec, mOutputBuffersWithCodec;
     size_t mDebugLevelBumpPendingBuffers[2];
+    // time spent in emptyBuffer() and fillBuffer(), logged when the node is freed
+    struct CallStats {
+        int64_t mCalls = 0;
+        nsecs_t mTotalNs = 0;
+        nsecs_t mMaxNs = 0;
+        void add(nsecs_t ns);
+        AString toString() const;
+    };
+    struct CallTimer;
+    CallStats mEmptyBufferStats, mFillBufferStats;
     void bumpDebugLevel_l(size_t numInputBuffers, size_t numOutputBuffers);
     void unbumpDebugLevel_l(size_t portIndex);
 
@@ -192,6 +213,7 @@ private:
     // For buffer id management
     IOMX::buffer_id makeBufferID(OMX_BUFFERHEADERTYPE *bufferHeader);
     OMX_BUFFERHEADERTYPE *findBufferHeader(IOMX::buffer_id buffer, OMX_U32 portIndex);
+    OMX_BUFFERHEADERTYPE *findBufferHeaderInSlot(IOMX::buffer_id buffer);
     IOMX::buffer_id findBufferID(OMX_BUFFERHEADERTYPE *bufferHeader);
     void invalidateBufferID(IOMX::buffer_id buffer);
 
@@ -159,8 +159,7 @@ bool AAVCAssembler::addSingleTimeAggregationPacket(const sp<ABuffer> &buffer) {
             return false;
         }
 
-        sp<ABuffer> unit = new ABuffer(nalSize);
-        memcpy(unit->data(), &data[2], nalSize);
+        sp<ABuffer> unit = buffer->slice(data + 2 - buffer->data(), nalSize);
 
         CopyTimes(unit, buffer);
 
@@ -31,12 +31,18 @@
 
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 
 namespace android {
 
 static const uint32_t kSourceID = 0xdeadbeef;
 
+// Bounds of the time an assembler waits for a reordered packet. The lower one
+// is the previous fixed timeout, the upper one caps the added latency.
+static const int64_t kMinJitterBufferDelayUs = 10000LL;
+static const int64_t kMaxJitterBufferDelayUs = 200000LL;
+
 ARTPSource::ARTPSource(
         uint32_t id,
         const sp<ASessionDescription> &sessionDesc, size_t index,
@@ -47,6 +53,10 @@ ARTPSource::ARTPSource(
       mBaseSeqNumber(0),
       mNumBuffersReceived(0),
       mPrevNumBuffersReceived(0),
+      mClockRate(0),
+      mHaveTransit(false),
+      mLastTransit(0),
+      mJitter(0.0),
       mLastNTPTime(0),
       mLastNTPTimeUpdateUs(0),
       mIssueFIRRequests(false),
@@ -58,6 +68,13 @@ ARTPSource::ARTPSource(
     AString params;
     sessionDesc->getFormatType(index, &PT, &desc, &params);
 
+    // "<encoding>/<clock rate>[/<channels>]", only used for the jitter
+    // estimate, so don't insist on a well-formed description here.
+    const char *slash = strchr(desc.c_str(), '/');
+    if (slash != NULL) {
+        mClockRate = (int32_t)strtol(slash + 1, NULL, 10);
+    }
+
     if (!strncmp(desc.c_str(), "H264/", 5)) {
         mAssembler = new AAVCAssembler(notify);
         mIssueFIRRequests = true;
@@ -90,10 +107,49 @@ static uint32_t AbsDiff(uint32_t seq1, uint32_t seq2) {
 
 void ARTPSource::processRTPPacket(const sp<ABuffer> &buffer) {
     if (queuePacket(buffer) && mAssembler != NULL) {
+        updateJitter(buffer);
         mAssembler->onPacketReceived(this);
     }
 }
 
+void ARTPSource::updateJitter(const sp<ABuffer> &buffer) {
+    uint32_t rtpTime;
+    if (mClockRate <= 0
+            || !buffer->meta()->findInt32("rtp-time", (int32_t *)&rtpTime)) {
+        return;
+    }
+
+    // The arrival time in RTP timestamp units, only differences matter.
+    uint32_t arrival = (uint32_t)(ALooper::GetNowUs() * mClockRate / 1000000LL);
+    uint32_t transit = arrival - rtpTime;
+
+    if (mHaveTransit) {
+        int32_t d = (int32_t)(transit - mLastTransit);
+        if (d < 0) {
+            d = -d;
+        }
+        mJitter += (d - mJitter) / 16.0;
+    }
+    mLastTransit = transit;
+    mHaveTransit = true;
+}
+
+int64_t ARTPSource::jitterBufferDelayUs() const {
+    if (mClockRate <= 0) {
+        return kMinJitterBufferDelayUs;
+    }
+
+    // The jitter estimate is a mean deviation, a few of them cover most of
+    // the reordering without holding back every frame on a clean network.
+    int64_t delayUs = (int64_t)(4.0 * mJitter * 1E6 / mClockRate);
+    if (delayUs < kMinJitterBufferDelayUs) {
+        return kMinJitterBufferDelayUs;
+    } else if (delayUs > kMaxJitterBufferDelayUs) {
+        return kMaxJitterBufferDelayUs;
+    }
+    return delayUs;
+}
+
 void ARTPSource::timeUpdate(uint32_t rtpTime, uint64_t ntpTime) {
     mLastNTPTime = ntpTime;
     mLastNTPTimeUpdateUs = ALooper::GetNowUs();
@@ -155,14 +211,20 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
 
     buffer->setInt32Data(seqNum);
 
-    List<sp<ABuffer> >::iterator it = mQueue.begin();
-    while (it != mQueue.end() && (uint32_t)(*it)->int32Data() < seqNum) {
-        ++it;
-    }
-
-    if (it != mQueue.end() && (uint32_t)(*it)->int32Data() == seqNum) {
-        ALOGW("Discarding duplicate buffer");
-        return false;
+    // Packets mostly arrive in order or only slightly reordered, so look for
+    // the insertion point from the tail of the queue.
+    List<sp<ABuffer> >::iterator it = mQueue.end();
+    while (it != mQueue.begin()) {
+        List<sp<ABuffer> >::iterator prev = it;
+        --prev;
+        if ((uint32_t)(*prev)->int32Data() < seqNum) {
+            break;
+        }
+        if ((uint32_t)(*prev)->int32Data() == seqNum) {
+            ALOGW("Discarding duplicate buffer");
+            return false;
+        }
+        it = prev;
     }
 
     mQueue.insert(it, buffer);
@@ -273,10 +335,11 @@ void ARTPSource::addReceiverReport(const sp<ABuffer> &buffer) {
     data[18] = (mHighestSeqNumber >> 8) & 0xff;
     data[19] = mHighestSeqNumber & 0xff;
 
-    data[20] = 0x00;  // Interarrival jitter
-    data[21] = 0x00;
-    data[22] = 0x00;
-    data[23] = 0x00;
+    uint32_t jitter = (uint32_t)mJitter;
+    data[20] = jitter >> 24;  // Interarrival jitter
+    data[21] = (jitter >> 16) & 0xff;
+    data[22] = (jitter >> 8) & 0xff;
+    data[23] = jitter & 0xff;
 
     uint32_t LSR = 0;
     uint32_t DLSR = 0;
@@ -46,6 +46,10 @@ struct ARTPSource : public RefBase {
     void addReceiverReport(const sp<ABuffer> &buffer);
     void addFIR(const sp<ABuffer> &buffer);
 
+    // How long an assembler waits for a missing packet before declaring it
+    // lost, derived from the interarrival jitter (RFC 3550, A.8).
+    int64_t jitterBufferDelayUs() const;
+
 private:
     uint32_t mID;
     uint32_t mHighestSeqNumber;
@@ -57,6 +61,11 @@ private:
     List<sp<ABuffer> > mQueue;
     sp<ARTPAssembler> mAssembler;
 
+    int32_t mClockRate;
+    bool mHaveTransit;
+    uint32_t mLastTransit;
+    double mJitter;  // in RTP timestamp units
+
     uint64_t mLastNTPTime;
     int64_t mLastNTPTimeUpdateUs;
 
@@ -67,6 +76,7 @@ private:
     sp<AMessage> mNotify;
 
     bool queuePacket(const sp<ABuffer> &buffer);
+    void updateJitter(const sp<ABuffer> &buffer);
 
     DISALLOW_EVIL_CONSTRUCTORS(ARTPSource);
 };
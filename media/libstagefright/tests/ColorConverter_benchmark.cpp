@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark for ColorConverter. Converts a 1080p frame from every supported
+// source format to every supported RGB destination, as FrameDecoder does for
+// thumbnails and SoftwareRenderer does per frame, and reports the time per frame.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ColorConverter_benchmark"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/ColorConverter.h>
+
+namespace android {
+
+static constexpr size_t kWidth = 1920;
+static constexpr size_t kHeight = 1080;
+static constexpr size_t kNumFrames = 20;
+
+struct Format {
+    OMX_COLOR_FORMATTYPE mFormat;
+    const char *mName;
+    size_t mFrameSize; // bytes per frame at kWidth x kHeight
+};
+
+static const Format kSrcFormats[] = {
+    { OMX_COLOR_FormatYUV420Planar, "YUV420Planar", kWidth * kHeight * 3 / 2 },
+    { OMX_COLOR_FormatYUV420Planar16, "YUV420Planar16", kWidth * kHeight * 3 },
+    { OMX_COLOR_FormatYUV420SemiPlanar, "YUV420SemiPlanar", kWidth * kHeight * 3 / 2 },
+    { (OMX_COLOR_FORMATTYPE)OMX_QCOM_COLOR_FormatYVU420SemiPlanar, "YVU420SemiPlanar",
+      kWidth * kHeight * 3 / 2 },
+    { OMX_COLOR_FormatCbYCrY, "CbYCrY", kWidth * kHeight * 2 },
+    { (OMX_COLOR_FORMATTYPE)OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+      "TIYUV420PackedSemiPlanar", kWidth * kHeight * 3 / 2 },
+};
+
+static const Format kDstFormats[] = {
+    { OMX_COLOR_Format16bitRGB565, "RGB565", kWidth * kHeight * 2 },
+    { OMX_COLOR_Format32BitRGBA8888, "RGBA8888", kWidth * kHeight * 4 },
+    { OMX_COLOR_Format32bitBGRA8888, "BGRA8888", kWidth * kHeight * 4 },
+};
+
+TEST(ColorConverter_benchmark, convert_1080p) {
+    for (const Format &srcFormat : kSrcFormats) {
+        std::vector<uint8_t> src(srcFormat.mFrameSize);
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = (uint8_t)(i * 7 + i / kWidth);
+        }
+        if (srcFormat.mFormat == OMX_COLOR_FormatYUV420Planar16) {
+            // keep the samples within 10 bits
+            for (size_t i = 1; i < src.size(); i += 2) {
+                src[i] &= 0x03;
+            }
+        }
+
+        for (const Format &dstFormat : kDstFormats) {
+            ColorConverter converter(srcFormat.mFormat, dstFormat.mFormat);
+            if (!converter.isValid()) {
+                continue;
+            }
+            std::vector<uint8_t> dst(dstFormat.mFrameSize);
+
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t frame = 0; frame < kNumFrames; ++frame) {
+                ASSERT_EQ(OK, converter.convert(
+                        src.data(), kWidth, kHeight, 0 /* stride */,
+                        0, 0, kWidth - 1, kHeight - 1,
+                        dst.data(), kWidth, kHeight, 0 /* stride */,
+                        0, 0, kWidth - 1, kHeight - 1))
+                        << srcFormat.mName << " to " << dstFormat.mName;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            std::cout << srcFormat.mName << " to " << dstFormat.mName << ": "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+                              / kNumFrames
+                      << " us per frame" << std::endl;
+        }
+    }
+}
+
+} // namespace android
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark for splitting an H.264 elementary stream into access units.
+// Feeds a stream with 4K sized frames to ElementaryStreamQueue in transport stream
+// payload sized pieces and dequeues after every piece, as ATSParser does for
+// streams that start a PES packet per TS packet. Each piece used to rescan the
+// whole pending access unit, so the time per frame grew with the frame size.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ESQueue_benchmark"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+#include "mpeg2ts/ESQueue.h"
+
+namespace android {
+
+static constexpr size_t kNumFrames = 60;
+static constexpr size_t kIdrInterval = 30;
+static constexpr size_t kIdrSliceSize = 1024 * 1024;
+static constexpr size_t kSliceSize = 192 * 1024;
+static constexpr size_t kTSPayloadSize = 184;
+static constexpr int64_t kFrameDurationUs = 33333;
+
+static const uint8_t kAUD[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+
+static size_t sliceSize(size_t frame) {
+    return frame % kIdrInterval == 0 ? kIdrSliceSize : kSliceSize;
+}
+
+// An access unit delimiter and one slice, without bytes that could form a start code.
+static void appendFrame(std::vector<uint8_t> *stream, size_t frame) {
+    stream->insert(stream->end(), kAUD, kAUD + sizeof(kAUD));
+    const uint8_t header[] = {
+        0x00, 0x00, 0x00, 0x01,
+        (uint8_t)(frame % kIdrInterval == 0 ? 0x65 : 0x41),
+        0x88 /* first_mb_in_slice 0 */ };
+    stream->insert(stream->end(), header, header + sizeof(header));
+    for (size_t i = 2; i < sliceSize(frame); ++i) {
+        stream->push_back(0x80 | ((i + frame) & 0x7f));
+    }
+}
+
+TEST(ESQueue_benchmark, h264_small_appends) {
+    std::vector<uint8_t> stream;
+    std::vector<size_t> frameEnd;
+    for (size_t frame = 0; frame < kNumFrames; ++frame) {
+        appendFrame(&stream, frame);
+        frameEnd.push_back(stream.size());
+    }
+    // the last frame ends at the next delimiter
+    stream.insert(stream.end(), kAUD, kAUD + sizeof(kAUD));
+
+    ElementaryStreamQueue queue(ElementaryStreamQueue::H264);
+    size_t numFrames = 0;
+    size_t frameStart = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < stream.size(); offset += kTSPayloadSize) {
+        const size_t size = std::min(kTSPayloadSize, stream.size() - offset);
+        // a frame takes the timestamp of the piece its delimiter starts in
+        const size_t frame = std::min(
+                (size_t)(std::upper_bound(
+                        frameEnd.begin(), frameEnd.end(), offset + size - 1)
+                        - frameEnd.begin()),
+                kNumFrames - 1);
+        ASSERT_EQ(OK, queue.appendData(&stream[offset], size, frame * kFrameDurationUs));
+
+        sp<ABuffer> accessUnit;
+        while ((accessUnit = queue.dequeueAccessUnit()) != NULL) {
+            ASSERT_LT(numFrames, kNumFrames);
+            // the delimiter and the slice, each with a 4 byte start code
+            EXPECT_EQ(frameEnd[numFrames] - frameStart, accessUnit->size()) << numFrames;
+            int64_t timeUs;
+            ASSERT_TRUE(accessUnit->meta()->findInt64("timeUs", &timeUs));
+            EXPECT_EQ((int64_t)numFrames * kFrameDurationUs, timeUs) << numFrames;
+            int32_t isSync = 0;
+            (void)accessUnit->meta()->findInt32("isSync", &isSync);
+            EXPECT_EQ(numFrames % kIdrInterval == 0, isSync != 0) << numFrames;
+            frameStart = frameEnd[numFrames];
+            ++numFrames;
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(kNumFrames, numFrames);
+
+    std::cout << "h264 " << (stream.size() + kTSPayloadSize - 1) / kTSPayloadSize
+              << " appends: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+                      / kNumFrames
+              << " us per frame" << std::endl;
+}
+
+} // namespace android
@@ -39,6 +39,9 @@ static const char kTestOverridesStr[] =
 "    <Encoders>\n"
 "        <MediaCodec name=\"OMX.qcom.video.encoder.avc\" type=\"video/avc\" update=\"true\" >\n"
 "            <Limit name=\"max-supported-instances\" value=\"4\" />\n"
+"            <Limit name=\"measured-concurrent-frame-rate-1280x720\""
+        " value=\"1:240,2:400,4:410\" />\n"
+"            <Limit name=\"performance-point-1280x720\" value=\"410\" />\n"
 "        </MediaCodec>\n"
 "        <MediaCodec name=\"OMX.qcom.video.encoder.mpeg4\" type=\"video/mp4v-es\" update=\"true\" >\n"
 "            <Limit name=\"max-supported-instances\" value=\"4\" />\n"
@@ -78,7 +81,8 @@ public:
         for (size_t i = 0; i < results.size(); ++i) {
             const AString &key = results.keyAt(i);
             const CodecSettings &settings = results.valueAt(i);
-            EXPECT_EQ(1u, settings.size());
+            // encoders may also have their measured throughput.
+            EXPECT_LE(1u, settings.size());
             EXPECT_TRUE(settings.keyAt(0) == "max-supported-instances");
             const AString &valueS = settings.valueAt(0);
             int32_t value = strtol(valueS.c_str(), NULL, 10);
@@ -92,7 +96,11 @@ public:
         gR.add("supports-multiple-secure-codecs", "false");
         gR.add("supports-secure-with-non-secure-codec", "true");
         KeyedVector<AString, CodecSettings> eR;
-        addMaxInstancesSetting("OMX.qcom.video.encoder.avc video/avc", "4", &eR);
+        CodecSettings avcSettings;
+        avcSettings.add("max-supported-instances", "4");
+        avcSettings.add("measured-concurrent-frame-rate-1280x720", "1:240,2:400,4:410");
+        avcSettings.add("performance-point-1280x720", "410");
+        eR.add("OMX.qcom.video.encoder.avc video/avc", avcSettings);
         addMaxInstancesSetting("OMX.qcom.video.encoder.mpeg4 video/mp4v-es", "4", &eR);
         KeyedVector<AString, CodecSettings> dR;
         addMaxInstancesSetting("OMX.qcom.video.decoder.avc.secure video/avc", "1", &dR);
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark for scanning a directory of media files, one file at a time with
+// processFile() and extractAlbumArt() as the media provider does, and in batches on
+// worker threads with processFiles(). Reports files per second for each.
+// The directory is taken from MEDIA_SCANNER_BENCHMARK_DIR, /data/local/tmp/media by default.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "StagefrightMediaScanner_benchmark"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/StagefrightMediaScanner.h>
+
+namespace android {
+
+namespace {
+
+class CountingClient : public MediaScannerClient {
+public:
+    CountingClient() : mTags(0) {}
+
+    virtual status_t scanFile(const char * /* path */, long long /* lastModified */,
+            long long /* fileSize */, bool /* isDirectory */, bool /* noMedia */) {
+        return OK;
+    }
+
+    virtual status_t handleStringTag(const char * /* name */, const char * /* value */) {
+        ++mTags;
+        return OK;
+    }
+
+    virtual status_t setMimeType(const char * /* mimeType */) {
+        return OK;
+    }
+
+    size_t mTags;
+};
+
+std::vector<std::string> listFiles() {
+    const char *dir = getenv("MEDIA_SCANNER_BENCHMARK_DIR");
+    if (dir == NULL) {
+        dir = "/data/local/tmp/media";
+    }
+    std::vector<std::string> files;
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return files;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_type == DT_REG) {
+            files.push_back(std::string(dir) + "/" + entry->d_name);
+        }
+    }
+    closedir(d);
+    return files;
+}
+
+double filesPerSecond(size_t files, std::chrono::steady_clock::duration elapsed) {
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? files / seconds : 0;
+}
+
+}  // namespace
+
+TEST(StagefrightMediaScanner_benchmark, serial_vs_batch) {
+    const std::vector<std::string> files = listFiles();
+    if (files.empty()) {
+        std::cout << "no files to scan, set MEDIA_SCANNER_BENCHMARK_DIR" << std::endl;
+        return;
+    }
+    StagefrightMediaScanner scanner;
+
+    size_t serialTags = 0;
+    size_t serialArt = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &file : files) {
+        CountingClient client;
+        if (scanner.processFile(file.c_str(), NULL, client) != MEDIA_SCAN_RESULT_OK) {
+            continue;
+        }
+        serialTags += client.mTags;
+        int fd = open(file.c_str(), O_RDONLY | O_LARGEFILE);
+        if (fd >= 0) {
+            MediaAlbumArt *art = scanner.extractAlbumArt(fd);
+            if (art != NULL) {
+                ++serialArt;
+                free(art);
+            }
+            close(fd);
+        }
+    }
+    const auto serialElapsed = std::chrono::steady_clock::now() - start;
+    std::cout << files.size() << " files, serial: "
+              << filesPerSecond(files.size(), serialElapsed) << " files/s" << std::endl;
+
+    for (size_t numThreads : { 1, 2, 4, 8 }) {
+        std::vector<CountingClient> clients(files.size());
+        std::vector<StagefrightMediaScanner::BatchEntry> entries(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            entries[i].path = files[i].c_str();
+            entries[i].mimeType = NULL;
+            entries[i].client = &clients[i];
+            entries[i].wantAlbumArt = true;
+        }
+        start = std::chrono::steady_clock::now();
+        scanner.processFiles(entries.data(), entries.size(), numThreads);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        size_t tags = 0;
+        size_t art = 0;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (entries[i].result == MEDIA_SCAN_RESULT_OK) {
+                tags += clients[i].mTags;
+            }
+            if (entries[i].albumArt != NULL) {
+                ++art;
+                free(entries[i].albumArt);
+            }
+        }
+        // the batch reports the same metadata as the serial scan.
+        EXPECT_EQ(serialTags, tags) << numThreads << " threads";
+        EXPECT_EQ(serialArt, art) << numThreads << " threads";
+        std::cout << files.size() << " files, batch with " << numThreads << " threads: "
+                  << filesPerSecond(files.size(), elapsed) << " files/s" << std::endl;
+    }
+}
+
+} // namespace android
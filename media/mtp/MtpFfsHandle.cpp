@@ -17,6 +17,7 @@
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <asyncio/AsyncIO.h>
+#include <chrono>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -41,11 +42,12 @@ namespace {
 
 constexpr unsigned AIO_BUFS_MAX = 128;
 constexpr unsigned AIO_BUF_LEN = 16384;
+// A chunk of AIO_BUF_LEN requests only lasts a few ms on a SuperSpeed link,
+// so use larger requests there.
+constexpr unsigned AIO_BUF_LEN_SS = 65536;
 
 constexpr unsigned FFS_NUM_EVENTS = 5;
 
-constexpr unsigned MAX_FILE_CHUNK_SIZE = AIO_BUFS_MAX * AIO_BUF_LEN;
-
 constexpr uint32_t MAX_MTP_FILE_SIZE = 0xFFFFFFFF;
 // Note: POLL_TIMEOUT_MS = 0 means return immediately i.e. no sleep.
 // And this will cause high CPU usage.
@@ -53,6 +55,11 @@ constexpr int32_t POLL_TIMEOUT_MS = 500;
 
 struct timespec ZERO_TIMEOUT = { 0, 0 };
 
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 struct mtp_device_status {
     uint16_t  wLength;
     uint16_t  wCode;
@@ -72,7 +79,9 @@ int MtpFfsHandle::getPacketSize(int ffs_fd) {
     }
 }
 
-MtpFfsHandle::MtpFfsHandle(int controlFd) {
+MtpFfsHandle::MtpFfsHandle(int controlFd) :
+    mIobufLen(0),
+    mTransferStats() {
     mControl.reset(controlFd);
 }
 
@@ -113,7 +122,7 @@ bool MtpFfsHandle::openEndpoints(bool ptp) {
 
 void MtpFfsHandle::advise(int fd) {
     for (unsigned i = 0; i < NUM_IO_BUFS; i++) {
-        if (posix_madvise(mIobuf[i].bufs.data(), MAX_FILE_CHUNK_SIZE,
+        if (posix_madvise(mIobuf[i].bufs.data(), mIobuf[i].bufs.size(),
                 POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED) < 0)
             PLOG(ERROR) << "Failed to madvise";
     }
@@ -126,6 +135,31 @@ bool MtpFfsHandle::writeDescriptors(bool ptp) {
     return ::android::writeDescriptors(mControl, ptp);
 }
 
+void MtpFfsHandle::adaptIobufs(int packet_size) {
+    unsigned len = packet_size >= MAX_PACKET_SIZE_SS ? AIO_BUF_LEN_SS : AIO_BUF_LEN;
+    if (len == mIobufLen)
+        return;
+    mIobufLen = len;
+    for (unsigned i = 0; i < NUM_IO_BUFS; i++) {
+        mIobuf[i].bufs.resize(AIO_BUFS_MAX * len);
+        mIobuf[i].bufs.shrink_to_fit();
+        for (unsigned j = 0; j < AIO_BUFS_MAX; j++) {
+            mIobuf[i].buf[j] = mIobuf[i].bufs.data() + j * len;
+        }
+    }
+}
+
+void MtpFfsHandle::endTransfer(const char *what, uint64_t start_us) {
+    mTransferStats.total_us = nowUs() - start_us;
+    if (mTransferStats.total_us > 0) {
+        LOG(VERBOSE) << "Mtp " << what << " " << mTransferStats.bytes << " bytes in "
+            << mTransferStats.total_us / 1000 << " ms, "
+            << mTransferStats.bytes / mTransferStats.total_us << " MB/s, waited "
+            << mTransferStats.usb_wait_us / 1000 << " ms for usb and "
+            << mTransferStats.file_wait_us / 1000 << " ms for the file";
+    }
+}
+
 void MtpFfsHandle::closeConfig() {
     mControl.reset();
 }
@@ -135,10 +169,10 @@ int MtpFfsHandle::doAsync(void* data, size_t len, bool read, bool zero_packet) {
     size_t total = 0;
 
     while (total < len) {
-        size_t this_len = std::min(len - total, static_cast<size_t>(AIO_BUF_LEN * AIO_BUFS_MAX));
-        int num_bufs = this_len / AIO_BUF_LEN + (this_len % AIO_BUF_LEN == 0 ? 0 : 1);
+        size_t this_len = std::min(len - total, static_cast<size_t>(mIobufLen * AIO_BUFS_MAX));
+        int num_bufs = this_len / mIobufLen + (this_len % mIobufLen == 0 ? 0 : 1);
         for (int i = 0; i < num_bufs; i++) {
-            mIobuf[0].buf[i] = reinterpret_cast<unsigned char*>(data) + total + i * AIO_BUF_LEN;
+            mIobuf[0].buf[i] = reinterpret_cast<unsigned char*>(data) + total + i * mIobufLen;
         }
         int ret = iobufSubmit(&mIobuf[0], read ? mBulkOut : mBulkIn, this_len, read);
         if (ret < 0) return -1;
@@ -157,7 +191,7 @@ int MtpFfsHandle::doAsync(void* data, size_t len, bool read, bool zero_packet) {
     }
 
     for (unsigned i = 0; i < AIO_BUFS_MAX; i++) {
-        mIobuf[0].buf[i] = mIobuf[0].bufs.data() + i * AIO_BUF_LEN;
+        mIobuf[0].buf[i] = mIobuf[0].bufs.data() + i * mIobufLen;
     }
     return total;
 }
@@ -270,15 +304,16 @@ int MtpFfsHandle::start(bool ptp) {
         return -1;
 
     for (unsigned i = 0; i < NUM_IO_BUFS; i++) {
-        mIobuf[i].bufs.resize(MAX_FILE_CHUNK_SIZE);
         mIobuf[i].iocb.resize(AIO_BUFS_MAX);
         mIobuf[i].iocbs.resize(AIO_BUFS_MAX);
         mIobuf[i].buf.resize(AIO_BUFS_MAX);
         for (unsigned j = 0; j < AIO_BUFS_MAX; j++) {
-            mIobuf[i].buf[j] = mIobuf[i].bufs.data() + j * AIO_BUF_LEN;
             mIobuf[i].iocb[j] = &mIobuf[i].iocbs[j];
         }
     }
+    // Sized for high speed until a transfer finds a faster link.
+    mIobufLen = 0;
+    adaptIobufs(MAX_PACKET_SIZE_HS);
 
     memset(&mCtx, 0, sizeof(mCtx));
     if (io_setup(AIO_BUFS_MAX, &mCtx) < 0) {
@@ -412,13 +447,13 @@ int MtpFfsHandle::iobufSubmit(struct io_buffer *buf, int fd, unsigned length, bo
     int ret = 0;
     buf->actual = AIO_BUFS_MAX;
     for (unsigned j = 0; j < AIO_BUFS_MAX; j++) {
-        unsigned rq_length = std::min(AIO_BUF_LEN, length - AIO_BUF_LEN * j);
+        unsigned rq_length = std::min(mIobufLen, length - mIobufLen * j);
         io_prep(buf->iocb[j], fd, buf->buf[j], rq_length, 0, read);
         buf->iocb[j]->aio_flags |= IOCB_FLAG_RESFD;
         buf->iocb[j]->aio_resfd = mEventFd;
 
         // Not enough data, so table is truncated.
-        if (rq_length < AIO_BUF_LEN || length == AIO_BUF_LEN * (j + 1)) {
+        if (rq_length < mIobufLen || length == mIobufLen * (j + 1)) {
             buf->actual = j + 1;
             break;
         }
@@ -455,20 +490,28 @@ int MtpFfsHandle::receiveFile(mtp_file_range mfr, bool zero_packet) {
     bool write_error = false;
     int packet_size = getPacketSize(mBulkOut);
     bool short_packet = false;
+    adaptIobufs(packet_size);
+    const uint32_t chunk_size = AIO_BUFS_MAX * mIobufLen;
     advise(mfr.fd);
 
+    const uint64_t start_us = nowUs();
+    uint64_t wait_start_us;
+    mTransferStats = {};
+
     // Break down the file into pieces that fit in buffers
     while (file_length > 0 || has_write) {
         // Queue an asynchronous read from USB.
         if (file_length > 0) {
-            length = std::min(static_cast<uint32_t>(MAX_FILE_CHUNK_SIZE), file_length);
+            length = std::min(chunk_size, file_length);
             if (iobufSubmit(&mIobuf[i], mBulkOut, length, true) == -1)
                 error = true;
         }
 
         // Get the return status of the last write request.
         if (has_write) {
+            wait_start_us = nowUs();
             aio_suspend(aiol, 1, nullptr);
+            mTransferStats.file_wait_us += nowUs() - wait_start_us;
             int written = aio_return(&aio);
             if (static_cast<size_t>(written) < aio.aio_nbytes) {
                 errno = written == -1 ? aio_error(&aio) : EIO;
@@ -491,7 +534,9 @@ int MtpFfsHandle::receiveFile(mtp_file_range mfr, bool zero_packet) {
                 // Get all events up to the short read, if there is one.
                 // We must wait for each event since data transfer could end at any time.
                 int this_events = 0;
+                wait_start_us = nowUs();
                 int event_ret = waitEvents(&mIobuf[i], 1, ioevs, &this_events);
+                mTransferStats.usb_wait_us += nowUs() - wait_start_us;
                 num_events += this_events;
 
                 if (event_ret == -1) {
@@ -540,10 +585,12 @@ int MtpFfsHandle::receiveFile(mtp_file_range mfr, bool zero_packet) {
             aio_write(&aio);
 
             offset += ret;
+            mTransferStats.bytes += ret;
             i = (i + 1) % NUM_IO_BUFS;
             has_write = true;
         }
     }
+    endTransfer("received", start_us);
     if ((ret % packet_size == 0 && !short_packet) || zero_packet) {
         // Receive an empty packet if size is a multiple of the endpoint size
         // and we didn't already get an empty packet from the header or large file.
@@ -560,6 +607,8 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
             file_length + sizeof(mtp_data_header));
     uint64_t offset = mfr.offset;
     int packet_size = getPacketSize(mBulkIn);
+    adaptIobufs(packet_size);
+    const uint64_t chunk_size = AIO_BUFS_MAX * mIobufLen;
 
     // If file_length is larger than a size_t, truncating would produce the wrong comparison.
     // Instead, promote the left side to 64 bits, then truncate the small result.
@@ -568,6 +617,10 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
 
     advise(mfr.fd);
 
+    const uint64_t start_us = nowUs();
+    uint64_t wait_start_us;
+    mTransferStats = {};
+
     struct aiocb aio;
     aio.aio_fildes = mfr.fd;
     struct aiocb *aiol[] = {&aio};
@@ -596,12 +649,13 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
     file_length -= init_read_len;
     offset += init_read_len;
     ret = init_read_len + sizeof(mtp_data_header);
+    mTransferStats.bytes = init_read_len;
 
     // Break down the file into pieces that fit in buffers
     while(file_length > 0 || has_write) {
         if (file_length > 0) {
             // Queue up a read from disk.
-            length = std::min(static_cast<uint64_t>(MAX_FILE_CHUNK_SIZE), file_length);
+            length = std::min(chunk_size, file_length);
             aio_prepare(&aio, mIobuf[i].bufs.data(), length, offset);
             aio_read(&aio);
         }
@@ -609,8 +663,11 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
         if (has_write) {
             // Wait for usb write. Cancel unwritten portion if there's an error.
             int num_events = 0;
-            if (waitEvents(&mIobuf[(i-1)%NUM_IO_BUFS], mIobuf[(i-1)%NUM_IO_BUFS].actual, ioevs,
-                        &num_events) != ret) {
+            wait_start_us = nowUs();
+            int written = waitEvents(&mIobuf[(i-1)%NUM_IO_BUFS],
+                    mIobuf[(i-1)%NUM_IO_BUFS].actual, ioevs, &num_events);
+            mTransferStats.usb_wait_us += nowUs() - wait_start_us;
+            if (written != ret) {
                 error = true;
                 cancelEvents(mIobuf[(i-1)%NUM_IO_BUFS].iocb.data(), ioevs, num_events,
                         mIobuf[(i-1)%NUM_IO_BUFS].actual);
@@ -620,7 +677,9 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
 
         if (file_length > 0) {
             // Wait for the previous read to finish
+            wait_start_us = nowUs();
             aio_suspend(aiol, 1, nullptr);
+            mTransferStats.file_wait_us += nowUs() - wait_start_us;
             num_read = aio_return(&aio);
             if (static_cast<size_t>(num_read) < aio.aio_nbytes) {
                 errno = num_read == -1 ? aio_error(&aio) : EIO;
@@ -642,10 +701,12 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
             }
             has_write = true;
             ret = num_read;
+            mTransferStats.bytes += num_read;
         }
 
         i = (i + 1) % NUM_IO_BUFS;
     }
+    endTransfer("sent", start_us);
 
     if (ret % packet_size == 0) {
         // If the last packet wasn't short, send a final empty packet
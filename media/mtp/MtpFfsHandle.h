@@ -39,6 +39,14 @@ struct io_buffer {
     unsigned actual;                    // The number of buffers submitted for this request
 };
 
+// Where the time of a file transfer went, to tell a slow link from slow storage.
+struct transfer_stats {
+    uint64_t bytes;                     // File data transferred
+    uint64_t total_us;                  // Duration of the whole transfer
+    uint64_t usb_wait_us;               // Time spent waiting for usb requests
+    uint64_t file_wait_us;              // Time spent waiting for file reads or writes
+};
+
 template <class T> class MtpFfsHandleTest;
 
 class MtpFfsHandle : public IMtpHandle {
@@ -72,6 +80,18 @@ protected:
 
     struct io_buffer mIobuf[NUM_IO_BUFS];
 
+    // Length of each usb request, larger on a SuperSpeed link so that a chunk
+    // keeps the link busy for longer between two waits.
+    unsigned mIobufLen;
+
+    struct transfer_stats mTransferStats;
+
+    // Size the io buffers for the speed of the link given by its packet size.
+    void adaptIobufs(int packet_size);
+
+    // Log and keep the stats of a transfer started at start_us.
+    void endTransfer(const char *what, uint64_t start_us);
+
     // Submit an io request of given length. Return amount submitted or -1.
     int iobufSubmit(struct io_buffer *buf, int fd, unsigned length, bool read);
 
@@ -95,6 +115,9 @@ public:
 
     bool writeDescriptors(bool ptp);
 
+    // Stats of the last receiveFile() or sendFile().
+    const struct transfer_stats &getTransferStats() const { return mTransferStats; }
+
     MtpFfsHandle(int controlFd);
     ~MtpFfsHandle();
 };
@@ -385,4 +385,42 @@ TYPED_TEST(MtpFfsHandleTest, testSendEvent) {
     EXPECT_STREQ(buf, dummyDataStr.c_str());
 }
 
+typedef MtpFfsHandleTest<MtpFfsHandle> MtpFfsHandleAioTest;
+
+TEST_F(MtpFfsHandleAioTest, testWriteLargeSuperSpeed) {
+    std::stringstream ss;
+    int size = TEST_PACKET_SIZE * MED_MULT;
+    char buf[size + 1];
+    buf[size] = '\0';
+
+    this->handle->adaptIobufs(MAX_PACKET_SIZE_SS);
+    EXPECT_GT(this->handle->mIobufLen, static_cast<unsigned>(16384));
+    for (int i = 0; i < MED_MULT; i++)
+        ss << dummyDataStr;
+
+    EXPECT_EQ(this->handle->write(ss.str().c_str(), size), size);
+    EXPECT_EQ(read(this->bulk_in, buf, size), size);
+
+    EXPECT_STREQ(buf, ss.str().c_str());
+}
+
+TEST_F(MtpFfsHandleAioTest, testTransferStats) {
+    std::stringstream ss;
+    mtp_file_range mfr;
+    int size = TEST_PACKET_SIZE * MED_MULT;
+
+    mfr.offset = 0;
+    mfr.length = size;
+    mfr.fd = this->dummy_file.fd;
+    for (int i = 0; i < MED_MULT; i++)
+        ss << dummyDataStr;
+
+    EXPECT_EQ(write(this->bulk_out, ss.str().c_str(), size), size);
+    EXPECT_EQ(this->handle->receiveFile(mfr, false), 0);
+
+    const struct transfer_stats &stats = this->handle->getTransferStats();
+    EXPECT_EQ(stats.bytes, static_cast<uint64_t>(size));
+    EXPECT_GE(stats.total_us, stats.usb_wait_us + stats.file_wait_us);
+}
+
 } // namespace android
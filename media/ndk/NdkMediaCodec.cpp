@@ -563,6 +563,26 @@ media_status_t AMediaCodec_queueInputBuffer(AMediaCodec *mData,
     return translate_error(ret);
 }
 
+EXPORT
+media_status_t AMediaCodec_queueInputBuffers(AMediaCodec *mData,
+        const AMediaCodecQueueInputInfo *infos, size_t count, size_t *numQueued) {
+    if (mData == NULL || (infos == NULL && count > 0) || numQueued == NULL) {
+        return AMEDIA_ERROR_INVALID_PARAMETER;
+    }
+    std::vector<MediaCodec::QueueInputInfo> queueInfos(count);
+    for (size_t i = 0; i < count; ++i) {
+        queueInfos[i].index = infos[i].index;
+        queueInfos[i].offset = infos[i].offset;
+        queueInfos[i].size = infos[i].size;
+        queueInfos[i].presentationTimeUs = infos[i].presentationTimeUs;
+        queueInfos[i].flags = infos[i].flags;
+    }
+    AString errorMsg;
+    status_t ret = mData->mCodec->queueInputBuffers(
+            queueInfos.data(), count, numQueued, &errorMsg);
+    return translate_error(ret);
+}
+
 EXPORT
 ssize_t AMediaCodec_dequeueOutputBuffer(AMediaCodec *mData,
         AMediaCodecBufferInfo *info, int64_t timeoutUs) {
@@ -630,6 +650,22 @@ media_status_t AMediaCodec_releaseOutputBufferAtTime(
     return translate_error(mData->mCodec->renderOutputBufferAndRelease(idx, timestampNs));
 }
 
+EXPORT
+media_status_t AMediaCodec_releaseOutputBuffers(AMediaCodec *mData,
+        const AMediaCodecReleaseOutputInfo *infos, size_t count, size_t *numReleased) {
+    if (mData == NULL || (infos == NULL && count > 0) || numReleased == NULL) {
+        return AMEDIA_ERROR_INVALID_PARAMETER;
+    }
+    std::vector<MediaCodec::ReleaseOutputInfo> releaseInfos(count);
+    for (size_t i = 0; i < count; ++i) {
+        releaseInfos[i].index = infos[i].index;
+        releaseInfos[i].render = infos[i].render;
+        releaseInfos[i].timestampNs = infos[i].timestampNs;
+    }
+    return translate_error(
+            mData->mCodec->releaseOutputBuffers(releaseInfos.data(), count, numReleased));
+}
+
 EXPORT
 media_status_t AMediaCodec_setOutputSurface(AMediaCodec *mData, ANativeWindow* window) {
     sp<Surface> surface = NULL;
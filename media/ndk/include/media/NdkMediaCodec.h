@@ -415,6 +415,51 @@ bool AMediaCodecActionCode_isTransient(int32_t actionCode) __INTRODUCED_IN(28);
 
 #endif /* __ANDROID_API__ >= 28 */
 
+#if __ANDROID_API__ >= 30
+
+/**
+ * One buffer for AMediaCodec_queueInputBuffers(), with the arguments of
+ * AMediaCodec_queueInputBuffer().
+ */
+typedef struct AMediaCodecQueueInputInfo {
+    size_t index;
+    size_t offset;
+    size_t size;
+    uint64_t presentationTimeUs;
+    uint32_t flags;
+} AMediaCodecQueueInputInfo;
+
+/**
+ * Send several buffers to the codec for processing at once, which is cheaper than one
+ * AMediaCodec_queueInputBuffer() call per buffer when the buffers are small.
+ * The buffers are queued in order, and queueing stops at the first buffer that
+ * fails. The number of buffers queued is returned in numQueued.
+ */
+media_status_t AMediaCodec_queueInputBuffers(
+        AMediaCodec*, const AMediaCodecQueueInputInfo *infos, size_t count,
+        size_t *numQueued) __INTRODUCED_IN(30);
+
+/**
+ * One buffer for AMediaCodec_releaseOutputBuffers(). If render is set, the buffer is
+ * rendered at timestampNs, or at its presentation time if timestampNs is negative.
+ */
+typedef struct AMediaCodecReleaseOutputInfo {
+    size_t index;
+    bool render;
+    int64_t timestampNs;
+} AMediaCodecReleaseOutputInfo;
+
+/**
+ * Return several output buffers to the codec at once, rendering the ones that ask for it.
+ * The buffers are released in order, and releasing stops at the first buffer that
+ * fails. The number of buffers released is returned in numReleased.
+ */
+media_status_t AMediaCodec_releaseOutputBuffers(
+        AMediaCodec*, const AMediaCodecReleaseOutputInfo *infos, size_t count,
+        size_t *numReleased) __INTRODUCED_IN(30);
+
+#endif /* __ANDROID_API__ >= 30 */
+
 typedef enum {
     AMEDIACODECRYPTOINFO_MODE_CLEAR = 0,
     AMEDIACODECRYPTOINFO_MODE_AES_CTR = 1,
@@ -420,6 +420,7 @@ void AudioFlinger::dumpClients(int fd, const Vector<String16>& args __unused)
         if (client != 0) {
             snprintf(buffer, SIZE, "  pid: %d\n", client->pid());
             result.append(buffer);
+            client->dumpHeapPool(result);
         }
     }
 
@@ -753,29 +754,32 @@ sp<IAudioTrack> AudioFlinger::createTrack(const CreateTrackInput& input,
     }
 
     {
-        Mutex::Autolock _l(mLock);
-        PlaybackThread *thread = checkPlaybackThread_l(output.outputId);
-        if (thread == NULL) {
-            ALOGE("no playback thread found for output handle %d", output.outputId);
-            lStatus = BAD_VALUE;
-            goto Exit;
+        // mLock is only held to look up the threads, and to update the AudioFlinger state
+        // once the track exists. The Client and the Track are created without it, the strong
+        // references below keep the threads alive even if their output is closed meanwhile.
+        sp<PlaybackThread> thread;
+        std::vector<sp<PlaybackThread>> secondaryThreads;
+        {
+            Mutex::Autolock _l(mLock);
+            thread = checkPlaybackThread_l(output.outputId);
+            if (thread == 0) {
+                ALOGE("no playback thread found for output handle %d", output.outputId);
+                lStatus = BAD_VALUE;
+                goto Exit;
+            }
+            for (audio_io_handle_t secondaryOutput : secondaryOutputs) {
+                PlaybackThread *secondaryThread = checkPlaybackThread_l(secondaryOutput);
+                if (secondaryThread == NULL) {
+                    ALOGE("no playback thread found for secondary output %d", output.outputId);
+                    continue;
+                }
+                secondaryThreads.push_back(secondaryThread);
+            }
         }
 
+        // registerPid() may allocate the client heap and only needs mClientLock.
         client = registerPid(clientPid);
 
-        PlaybackThread *effectThread = NULL;
-        // check if an effect chain with the same session ID is present on another
-        // output thread and move it here.
-        for (size_t i = 0; i < mPlaybackThreads.size(); i++) {
-            sp<PlaybackThread> t = mPlaybackThreads.valueAt(i);
-            if (mPlaybackThreads.keyAt(i) != output.outputId) {
-                uint32_t sessions = t->hasAudioSession(sessionId);
-                if (sessions & ThreadBase::EFFECT_SESSION) {
-                    effectThread = t.get();
-                    break;
-                }
-            }
-        }
         ALOGV("createTrack() sessionId: %d", sessionId);
 
         output.sampleRate = input.config.sample_rate;
@@ -803,13 +807,7 @@ sp<IAudioTrack> AudioFlinger::createTrack(const CreateTrackInput& input,
             // Any secondary output setup failure will lead to a desync between the AP and AF until
             // the track is destroyed.
             TeePatches teePatches;
-            for (audio_io_handle_t secondaryOutput : secondaryOutputs) {
-                PlaybackThread *secondaryThread = checkPlaybackThread_l(secondaryOutput);
-                if (secondaryThread == NULL) {
-                    ALOGE("no playback thread found for secondary output %d", output.outputId);
-                    continue;
-                }
-
+            for (const sp<PlaybackThread>& secondaryThread : secondaryThreads) {
                 size_t frameCount = std::lcm(thread->frameCount(), secondaryThread->frameCount());
 
                 using namespace std::chrono_literals;
@@ -834,16 +832,16 @@ sp<IAudioTrack> AudioFlinger::createTrack(const CreateTrackInput& input,
                 // for now, we exclude fast tracks by removing the Fast flag.
                 const audio_output_flags_t outputFlags =
                         (audio_output_flags_t)(output.flags & ~AUDIO_OUTPUT_FLAG_FAST);
-                sp patchTrack = new PlaybackThread::PatchTrack(secondaryThread,
-                                                               streamType,
-                                                               output.sampleRate,
-                                                               input.config.channel_mask,
-                                                               input.config.format,
-                                                               frameCount,
-                                                               patchRecord->buffer(),
-                                                               patchRecord->bufferSize(),
-                                                               outputFlags,
-                                                               0ns /* timeout */);
+                sp patchTrack = new PlaybackThread::PatchTrack(secondaryThread.get(),
+                                                                     streamType,
+                                                                     output.sampleRate,
+                                                                     input.config.channel_mask,
+                                                                     input.config.format,
+                                                                     frameCount,
+                                                                     patchRecord->buffer(),
+                                                                     patchRecord->bufferSize(),
+                                                                     outputFlags,
+                                                                     0ns /* timeout */);
                 status = patchTrack->initCheck();
                 if (status != NO_ERROR) {
                     ALOGE("Secondary output patchTrack init failed: %d", status);
@@ -859,13 +857,35 @@ sp<IAudioTrack> AudioFlinger::createTrack(const CreateTrackInput& input,
             track->setTeePatches(std::move(teePatches));
         }
 
+        Mutex::Autolock _l(mLock);
+        if (lStatus == NO_ERROR && checkPlaybackThread_l(output.outputId) != thread.get()) {
+            // The output was closed while the track was being created. The client restores
+            // an invalid track, as it does for the tracks of an output closed after creation.
+            ALOGW("createTrack() output %d closed during track creation", output.outputId);
+            track->invalidate();
+        }
+
+        PlaybackThread *effectThread = NULL;
+        // check if an effect chain with the same session ID is present on another
+        // output thread and move it here.
+        for (size_t i = 0; i < mPlaybackThreads.size(); i++) {
+            sp<PlaybackThread> t = mPlaybackThreads.valueAt(i);
+            if (mPlaybackThreads.keyAt(i) != output.outputId) {
+                uint32_t sessions = t->hasAudioSession(sessionId);
+                if (sessions & ThreadBase::EFFECT_SESSION) {
+                    effectThread = t.get();
+                    break;
+                }
+            }
+        }
+
         // move effect chain to this output thread if an effect on same session was waiting
         // for a track to be created
         if (lStatus == NO_ERROR && effectThread != NULL) {
             // no risk of deadlock because AudioFlinger::mLock is held
             Mutex::Autolock _dl(thread->mLock);
             Mutex::Autolock _sl(effectThread->mLock);
-            if (moveEffectChain_l(sessionId, effectThread, thread) == NO_ERROR) {
+            if (moveEffectChain_l(sessionId, effectThread, thread.get()) == NO_ERROR) {
                 effectThreadId = thread->id();
                 effectIds = thread->getEffectIds_l(sessionId);
             }
@@ -886,7 +906,7 @@ sp<IAudioTrack> AudioFlinger::createTrack(const CreateTrackInput& input,
             }
         }
 
-        setAudioHwSyncForSession_l(thread, sessionId);
+        setAudioHwSyncForSession_l(thread.get(), sessionId);
     }
 
     if (lStatus != NO_ERROR) {
@@ -1753,6 +1773,7 @@ AudioFlinger::Client::Client(const sp<AudioFlinger>& audioFlinger, pid_t pid)
     mMemoryDealer = new MemoryDealer(
             audioFlinger->getClientSharedHeapSize(),
             (std::string("AudioFlinger::Client(") + std::to_string(pid) + ")").c_str());
+    mHeapPool = new ClientHeapPool(mMemoryDealer);
 }
 
 // Client destructor must be called with AudioFlinger::mClientLock held
@@ -2252,6 +2273,39 @@ status_t AudioFlinger::getMicrophones(std::vector<media::MicrophoneInfo> *microp
     return status;
 }
 
+status_t AudioFlinger::controlTracks(const std::vector<sp<IAudioTrack>>& tracks,
+                                     track_control_t control,
+                                     std::vector<status_t> *statuses)
+{
+    // The tracks are TrackHandles created by createTrack(), so this does not need mLock.
+    // Each control takes the lock of the thread the track is attached to, as it would
+    // for a call through IAudioTrack, but all tracks share one binder transaction.
+    statuses->clear();
+    for (const auto& track : tracks) {
+        status_t status = NO_ERROR;
+        if (track == 0) {
+            status = BAD_VALUE;
+        } else {
+            switch (control) {
+            case TRACK_CONTROL_START:
+                status = track->start();
+                break;
+            case TRACK_CONTROL_STOP:
+                track->stop();
+                break;
+            case TRACK_CONTROL_PAUSE:
+                track->pause();
+                break;
+            default:
+                status = BAD_VALUE;
+                break;
+            }
+        }
+        statuses->push_back(status);
+    }
+    return NO_ERROR;
+}
+
 // setAudioHwSyncForSession_l() must be called with AudioFlinger::mLock held
 void AudioFlinger::setAudioHwSyncForSession_l(PlaybackThread *thread, audio_session_t sessionId)
 {
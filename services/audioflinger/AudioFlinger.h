@@ -79,9 +79,11 @@
 #include "FastMixer.h"
 #include <media/nbaio/NBAIO.h>
 #include "AudioWatchdog.h"
+#include "ClientHeapPool.h"
 #include "AudioStreamOut.h"
 #include "SpdifStreamOut.h"
 #include "AudioHwDevice.h"
+#include "MmapStreamHealth.h"
 #include "NBAIO_Tee.h"
 
 #include <powermanager/IPowerManager.h>
@@ -279,6 +281,10 @@ public:
 
     virtual status_t getMicrophones(std::vector<media::MicrophoneInfo> *microphones);
 
+    virtual status_t controlTracks(const std::vector<sp<IAudioTrack>>& tracks,
+                                   track_control_t control,
+                                   std::vector<status_t> *statuses);
+
     virtual     status_t    onTransact(
                                 uint32_t code,
                                 const Parcel& data,
@@ -453,6 +459,9 @@ private:
                             Client(const sp<AudioFlinger>& audioFlinger, pid_t pid);
         virtual             ~Client();
         sp<MemoryDealer>    heap() const;
+        // Track shared memory, served by size class from mHeapPool, see ClientHeapPool.
+        sp<IMemory>         allocate(size_t size) { return mHeapPool->allocate(size); }
+        void                dumpHeapPool(String8& result) const { mHeapPool->dump(result); }
         pid_t               pid() const { return mPid; }
         sp<AudioFlinger>    audioFlinger() const { return mAudioFlinger; }
 
@@ -461,6 +470,7 @@ private:
 
         const sp<AudioFlinger> mAudioFlinger;
               sp<MemoryDealer> mMemoryDealer;
+              sp<ClientHeapPool> mHeapPool;
         const pid_t         mPid;
     };
 
@@ -24,9 +24,12 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include <audio_utils/string.h>
+#include <system/audio.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 // ------------------------------
 // BufLogSingleton
@@ -56,18 +59,48 @@ bool BufLogSingleton::instanceExists() {
 // BufLog
 // ------------------------------
 
-BufLog::BufLog() {
+BufLog::BufLog() : mExiting(false), mThreadStarted(false) {
     memset(mStreams, 0, sizeof(mStreams));
+    int ret = pthread_create(&mThread, NULL, threadEntry, this);
+    if (ret == 0) {
+        mThreadStarted = true;
+        (void)pthread_setname_np(mThread, "BufLog");
+    } else {
+        ALOGE("Error: could not create BufLog writer thread %s", strerror(ret));
+    }
 }
 
 BufLog::~BufLog() {
-    android::Mutex::Autolock autoLock(mLock);
+    if (mThreadStarted) {
+        {
+            android::Mutex::Autolock autoLock(mDrainLock);
+            mExiting = true;
+            mDrainCondition.signal();
+        }
+        pthread_join(mThread, NULL);
+    }
+    reset();
+}
 
-    for (unsigned int id = 0; id < BUFLOG_MAXSTREAMS; id++) {
-        BufLogStream *pBLStream = mStreams[id];
-        if (pBLStream != NULL) {
-            delete pBLStream ;
-            mStreams[id] = NULL;
+void *BufLog::threadEntry(void *me) {
+    static_cast<BufLog *>(me)->threadLoop();
+    return NULL;
+}
+
+void BufLog::threadLoop() {
+    android::Mutex::Autolock autoLock(mDrainLock);
+    while (!mExiting) {
+        (void)mDrainCondition.waitRelative(mDrainLock,
+                (nsecs_t)BUFLOG_DRAIN_PERIOD_MS * 1000000);
+        BufLogStream *streams[BUFLOG_MAXSTREAMS];
+        {
+            android::Mutex::Autolock _l(mLock);
+            memcpy(streams, mStreams, sizeof(streams));
+        }
+        for (unsigned int id = 0; id < BUFLOG_MAXSTREAMS; id++) {
+            if (streams[id] != NULL) {
+                streams[id]->drain();
+            }
         }
     }
 }
@@ -89,15 +122,20 @@ size_t BufLog::write(int streamid, const char *tag, int format, int channels,
 }
 
 void BufLog::reset() {
-    android::Mutex::Autolock autoLock(mLock);
-    ALOGV("Resetting all BufLogs");
-    int count = 0;
+    BufLogStream *streams[BUFLOG_MAXSTREAMS];
+    {
+        android::Mutex::Autolock autoLock(mLock);
+        ALOGV("Resetting all BufLogs");
+        memcpy(streams, mStreams, sizeof(streams));
+        memset(mStreams, 0, sizeof(mStreams));
+    }
 
+    // the writer thread may still be draining the streams.
+    android::Mutex::Autolock autoLock(mDrainLock);
+    int count = 0;
     for (unsigned int id = 0; id < BUFLOG_MAXSTREAMS; id++) {
-        BufLogStream *pBLStream = mStreams[id];
-        if (pBLStream != NULL) {
-            delete pBLStream;
-            mStreams[id] = NULL;
+        if (streams[id] != NULL) {
+            delete streams[id];
             count++;
         }
     }
@@ -114,7 +152,8 @@ BufLogStream::BufLogStream(unsigned int id,
         unsigned int channels,
         unsigned int samplingRate,
         size_t maxBytes = 0) : mId(id), mFormat(format), mChannels(channels),
-                mSamplingRate(samplingRate), mMaxBytes(maxBytes) {
+                mSamplingRate(samplingRate), mMaxBytes(maxBytes), mEnded(false),
+                mDroppedBytes(0), mOpenFailed(false), mFile(NULL) {
     mByteCount = 0;
     mPaused = false;
     if (tag != NULL) {
@@ -125,7 +164,22 @@ BufLogStream::BufLogStream(unsigned int id,
     ALOGV("Creating BufLogStream id:%d tag:%s format:%#x ch:%d sr:%d maxbytes:%zu", mId, mTag,
             mFormat, mChannels, mSamplingRate, mMaxBytes);
 
-    //open file (s), info about tag, format, etc.
+    // the ring holds BUFLOGSTREAM_RING_MS of audio, but no more than the whole file.
+    size_t frameSize = audio_bytes_per_sample((audio_format_t)mFormat) * mChannels;
+    if (frameSize == 0) {
+        frameSize = sizeof(int16_t) * 2;   // compressed or unknown format
+    }
+    size_t ringBytes = MAX((size_t)BUFLOGSTREAM_MIN_RING_BYTES,
+            (size_t)mSamplingRate * frameSize * BUFLOGSTREAM_RING_MS / 1000);
+    if (mMaxBytes > 0) {
+        ringBytes = MIN(ringBytes, mMaxBytes);
+    }
+    mRingBuffer = new uint8_t[ringBytes];
+    mFifo = new audio_utils_fifo((uint32_t)ringBytes, 1 /* frameSize */, mRingBuffer);
+    mFifoWriter = new audio_utils_fifo_writer(*mFifo);
+    mFifoReader = new audio_utils_fifo_reader(*mFifo);
+
+    //file name: info about tag, format, etc.
     //timestamp
     char timeStr[16];   //size 16: format %Y%m%d%H%M%S 14 chars + string null terminator
     struct timeval tv;
@@ -133,17 +187,10 @@ BufLogStream::BufLogStream(unsigned int id,
     struct tm tm;
     localtime_r(&tv.tv_sec, &tm);
     strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &tm);
-    char logPath[BUFLOG_MAX_PATH_SIZE];
-    snprintf(logPath, BUFLOG_MAX_PATH_SIZE, "%s/%s_%d_%s_%d_%d_%d.raw", BUFLOG_BASE_PATH, timeStr,
+    snprintf(mPath, sizeof(mPath), "%s/%s_%d_%s_%d_%d_%d.raw", BUFLOG_BASE_PATH, timeStr,
             mId, mTag, mFormat, mChannels, mSamplingRate);
-    ALOGV("data output: %s", logPath);
-
-    mFile = fopen(logPath, "wb");
-    if (mFile != NULL) {
-        ALOGV("Success creating file at: %p", mFile);
-    } else {
-        ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
-    }
+    ALOGV("data output: %s", mPath);
+    // the file is opened by the writer thread, on the first data.
 }
 
 void BufLogStream::closeStream_l() {
@@ -152,31 +199,43 @@ void BufLogStream::closeStream_l() {
         fclose(mFile);
         mFile = NULL;
     }
+    size_t dropped = mDroppedBytes.load();
+    if (dropped > 0) {
+        ALOGW("BufLogStream id:%d tag:%s dropped %zu bytes, the writer thread was too slow",
+                mId, mTag, dropped);
+    }
 }
 
 BufLogStream::~BufLogStream() {
     ALOGV("Destroying BufLogStream id:%d tag:%s", mId, mTag);
-    android::Mutex::Autolock autoLock(mLock);
-    closeStream_l();
+    finalize();
+    delete mFifoReader;
+    delete mFifoWriter;
+    delete mFifo;
+    delete[] mRingBuffer;
 }
 
 size_t BufLogStream::write(const void *buf, size_t size) {
 
     size_t bytes = 0;
-    if (!mPaused && mFile != NULL) {
+    if (!mPaused && !mEnded.load(std::memory_order_relaxed)) {
         if (size > 0 && buf != NULL) {
-            android::Mutex::Autolock autoLock(mLock);
             if (mMaxBytes > 0) {
                 size = MIN(size, mMaxBytes - mByteCount);
             }
-            bytes = fwrite(buf, 1, size, mFile);
-            mByteCount += bytes;
+            // no timeout: a full ring drops the data rather than blocking the caller.
+            ssize_t queued = mFifoWriter->write(buf, size);
+            bytes = queued > 0 ? (size_t)queued : 0;
+            if (bytes < size) {
+                mDroppedBytes.fetch_add(size - bytes, std::memory_order_relaxed);
+            }
+            mByteCount += size;
             if (mMaxBytes > 0 && mMaxBytes == mByteCount) {
-                closeStream_l();
+                mEnded = true;  // the writer thread closes the file once drained
             }
         }
-        ALOGV("wrote %zu/%zu bytes to BufLogStream %d tag:%s. Total Bytes: %zu", bytes, size, mId,
-                mTag, mByteCount);
+        ALOGV("queued %zu/%zu bytes to BufLogStream %d tag:%s. Total Bytes: %zu", bytes, size,
+                mId, mTag, mByteCount);
     } else {
         ALOGV("Warning: trying to write to %s BufLogStream id:%d tag:%s",
                 mPaused ? "paused" : "closed", mId, mTag);
@@ -184,6 +243,45 @@ size_t BufLogStream::write(const void *buf, size_t size) {
     return bytes;
 }
 
+size_t BufLogStream::drain() {
+    android::Mutex::Autolock autoLock(mLock);
+    return drain_l();
+}
+
+size_t BufLogStream::drain_l() {
+    const bool ended = mEnded.load();   // before reading, so no data queued after is lost
+    size_t total = 0;
+    if (mFile == NULL && !mOpenFailed && mFifoReader->available() > 0) {
+        mFile = fopen(mPath, "wb");
+        if (mFile != NULL) {
+            ALOGV("Success creating file at: %p", mFile);
+        } else {
+            ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
+            mOpenFailed = true;
+        }
+    }
+    for (;;) {
+        audio_utils_iovec iovec[2];
+        ssize_t available = mFifoReader->obtain(iovec, SIZE_MAX);
+        if (available <= 0) {
+            break;
+        }
+        if (mFile != NULL) {
+            for (int i = 0; i < 2; i++) {
+                if (iovec[i].mLength > 0) {
+                    total += fwrite(mRingBuffer + iovec[i].mOffset, 1, iovec[i].mLength,
+                            mFile);
+                }
+            }
+        }
+        mFifoReader->release(available);
+    }
+    if (ended && mFile != NULL) {
+        closeStream_l();
+    }
+    return total;
+}
+
 bool BufLogStream::setPause(bool pause) {
     bool old = mPaused;
     mPaused = pause;
@@ -192,5 +290,7 @@ bool BufLogStream::setPause(bool pause) {
 
 void BufLogStream::finalize() {
     android::Mutex::Autolock autoLock(mLock);
+    mEnded = true;
+    (void)drain_l();
     closeStream_l();
 }
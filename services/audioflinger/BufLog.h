@@ -64,6 +64,11 @@
  *  BUFLOG_RESET        If an instance of BufLog exists, it stops the capture and closes all
  *                      streams.
  *                      If a new call to BUFLOG(..) is done, new streams are created.
+ *
+ * BUFLOG(..) only copies the buffer into a ring of the stream and never blocks on file I/O,
+ * so it can be called from the mixer or capture threads. A background thread owned by BufLog
+ * opens the files and drains the rings to them. If the writer thread falls more than
+ * BUFLOGSTREAM_RING_MS behind, the data that does not fit is dropped and counted.
  */
 
 #ifndef BUFLOG_NDEBUG
@@ -100,15 +105,22 @@
 #endif
 
 
+#include <atomic>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include <audio_utils/fifo.h>
+#include <utils/Condition.h>
 #include <utils/Mutex.h>
 
 //BufLog configuration
 #define BUFLOGSTREAM_MAX_TAGSIZE    32
 #define BUFLOG_BASE_PATH            "/data/misc/audioserver"
 #define BUFLOG_MAX_PATH_SIZE        300
+#define BUFLOGSTREAM_RING_MS        2000        // audio buffered ahead of the writer thread
+#define BUFLOGSTREAM_MIN_RING_BYTES (64 * 1024)
+#define BUFLOG_DRAIN_PERIOD_MS      20
 
 class BufLogStream {
 public:
@@ -120,17 +132,22 @@ public:
             size_t maxBytes);
     ~BufLogStream();
 
-    // write buffer to stream
+    // queue buffer to stream, never blocks. Called by a single writer at a time.
     //  buf:  pointer to buffer
     //  size: number of bytes to write
+    //  return value: number of bytes queued.
     size_t          write(const void *buf, size_t size);
 
+    // write queued data to the file, opening it if needed. Called by the BufLog writer thread.
+    //  return value: number of bytes written to the file.
+    size_t          drain();
+
     // pause/resume stream
     //  pause: true = paused, false = not paused
     //  return value: previous state of stream (paused or not).
     bool            setPause(bool pause);
 
-    // will stop the stream and close any open file
+    // will stop the stream, write any queued data and close any open file
     // the stream can't be reopen. Instead, a new stream (and file) should be created.
     void            finalize();
 
@@ -142,10 +159,22 @@ private:
     const unsigned int  mChannels;
     const unsigned int  mSamplingRate;
     const size_t        mMaxBytes;
-    size_t              mByteCount;
-    FILE                *mFile;
+    size_t              mByteCount;         // queued, only accessed by the writer
+    std::atomic<bool>   mEnded;             // no more data will be queued
+    std::atomic<size_t> mDroppedBytes;      // did not fit in the ring
+    char                mPath[BUFLOG_MAX_PATH_SIZE];
+    bool                mOpenFailed;
+
+    uint8_t             *mRingBuffer;
+    audio_utils_fifo    *mFifo;
+    audio_utils_fifo_writer *mFifoWriter;
+    audio_utils_fifo_reader *mFifoReader;
+
+    // protects the file and the reader side of the ring.
     mutable android::Mutex mLock;
+    FILE                *mFile;
 
+    size_t          drain_l();
     void            closeStream_l();
 };
 
@@ -182,8 +211,20 @@ public:
 
 protected:
     static const unsigned int BUFLOG_MAXSTREAMS = 16;
+    // held by write() only to look up or create a stream and to queue, never across file I/O.
     BufLogStream    *mStreams[BUFLOG_MAXSTREAMS];
     mutable android::Mutex mLock;
+
+    // the writer thread holds mDrainLock while draining, so streams are only deleted
+    // under mDrainLock. Lock order: mDrainLock, then mLock.
+    mutable android::Mutex mDrainLock;
+    android::Condition  mDrainCondition;
+    bool            mExiting;
+    bool            mThreadStarted;
+    pthread_t       mThread;
+
+    static void     *threadEntry(void *me);
+    void            threadLoop();
 };
 
 class BufLogSingleton {
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioFlinger"
+//#define LOG_NDEBUG 0
+
+#include <binder/MemoryBase.h>
+#include <utils/Log.h>
+
+#include "ClientHeapPool.h"
+
+namespace android {
+
+// A block of the pool shared with the client. It only holds a weak reference on the pool,
+// so that a block still mapped by the client process does not keep the pool alive.
+class ClientHeapPool::PooledMemory : public MemoryBase {
+public:
+    PooledMemory(const sp<ClientHeapPool>& pool, size_t sizeClass,
+                 const sp<IMemory>& block, ssize_t offset, size_t size)
+        : MemoryBase(block->getMemory(), offset, size)
+        , mPool(pool)
+        , mSizeClass(sizeClass)
+        , mBlock(block) {}
+
+    virtual ~PooledMemory() {
+        sp<ClientHeapPool> pool = mPool.promote();
+        if (pool != 0) {
+            pool->release(mSizeClass, mBlock);
+        }
+    }
+
+private:
+    const wp<ClientHeapPool>  mPool;
+    const size_t              mSizeClass;
+    const sp<IMemory>         mBlock;   // the MemoryDealer allocation
+};
+
+ClientHeapPool::ClientHeapPool(const sp<MemoryDealer>& dealer)
+    : mDealer(dealer)
+{
+}
+
+sp<IMemory> ClientHeapPool::allocate(size_t size)
+{
+    Mutex::Autolock _l(mLock);
+    if (size == 0 || size > kMaxPooledSize) {
+        mUnpooled++;
+        return allocateFromDealer_l(size);
+    }
+    size_t sizeClass = 0;
+    while ((kMinPooledSize << sizeClass) < size) {
+        sizeClass++;
+    }
+
+    sp<IMemory> block;
+    if (!mFree[sizeClass].empty()) {
+        block = mFree[sizeClass].back();
+        mFree[sizeClass].pop_back();
+        mHits++;
+    } else {
+        block = allocateFromDealer_l(kMinPooledSize << sizeClass);
+        if (block == 0) {
+            return nullptr;
+        }
+        mMisses++;
+    }
+    mInUse[sizeClass]++;
+
+    ssize_t offset;
+    block->getMemory(&offset);
+    return new PooledMemory(this, sizeClass, block, offset, size);
+}
+
+sp<IMemory> ClientHeapPool::allocateFromDealer_l(size_t size)
+{
+    sp<IMemory> memory = mDealer->allocate(size);
+    if (memory == 0) {
+        // Free blocks of other classes may be what is missing, return them and retry.
+        bool trimmed = false;
+        for (auto& freeList : mFree) {
+            trimmed |= !freeList.empty();
+            freeList.clear();
+        }
+        if (trimmed) {
+            mTrims++;
+            memory = mDealer->allocate(size);
+        }
+    }
+    return memory;
+}
+
+void ClientHeapPool::release(size_t sizeClass, const sp<IMemory>& block)
+{
+    Mutex::Autolock _l(mLock);
+    mInUse[sizeClass]--;
+    if (mFree[sizeClass].size() < kMaxFreePerClass) {
+        mFree[sizeClass].push_back(block);
+    }
+    // otherwise the block goes back to the MemoryDealer with the last reference.
+}
+
+void ClientHeapPool::dump(String8& result) const
+{
+    Mutex::Autolock _l(mLock);
+    result.appendFormat("    heap pool: hits %llu, misses %llu, unpooled %llu, trims %llu\n",
+            (unsigned long long) mHits, (unsigned long long) mMisses,
+            (unsigned long long) mUnpooled, (unsigned long long) mTrims);
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+        if (mInUse[i] != 0 || !mFree[i].empty()) {
+            result.appendFormat("      %4zu KiB: in use %zu, free %zu\n",
+                    (kMinPooledSize << i) / 1024, mInUse[i], mFree[i].size());
+        }
+    }
+}
+
+} // namespace android
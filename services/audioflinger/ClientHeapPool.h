@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_CLIENT_HEAP_POOL_H
+#define ANDROID_CLIENT_HEAP_POOL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include <binder/IMemory.h>
+#include <binder/MemoryDealer.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// Size class pool on top of the MemoryDealer of an AudioFlinger::Client.
+//
+// Track control blocks and buffers up to kMaxPooledSize are rounded up to a power of 2
+// size class. A block is returned to the free list of its class when the last reference
+// to it is released, including the one held by the client process, and is reused by the next
+// allocation of the same class. Short-lived sound effect tracks then do not fragment the heap,
+// and allocation and release are O(1) once the pool is warm.
+// Larger sizes go directly to the MemoryDealer.
+class ClientHeapPool : public RefBase {
+public:
+    static constexpr size_t kMinPooledSize = 4 * 1024;     // smallest size class
+    static constexpr size_t kNumSizeClasses = 6;           // 4 KiB to 128 KiB
+    static constexpr size_t kMaxPooledSize = kMinPooledSize << (kNumSizeClasses - 1);
+    // Free blocks kept per class, the rest is returned to the MemoryDealer.
+    static constexpr size_t kMaxFreePerClass = 4;
+
+    explicit ClientHeapPool(const sp<MemoryDealer>& dealer);
+
+    // Returns nullptr if the heap is exhausted, as MemoryDealer::allocate() does.
+    sp<IMemory> allocate(size_t size);
+
+    // One line per size class with blocks in use or free, and the hit count.
+    void dump(String8& result) const;
+
+private:
+    class PooledMemory;
+
+    // Called by PooledMemory when its last reference is released.
+    void release(size_t sizeClass, const sp<IMemory>& block);
+
+    // must be called with mLock held
+    sp<IMemory> allocateFromDealer_l(size_t size);
+
+    const sp<MemoryDealer>    mDealer;
+
+    mutable Mutex             mLock;
+    std::vector<sp<IMemory>>  mFree[kNumSizeClasses];
+    size_t                    mInUse[kNumSizeClasses] = {};
+    uint64_t                  mHits = 0;       // allocations served from a free list
+    uint64_t                  mMisses = 0;     // pooled allocations served by the MemoryDealer
+    uint64_t                  mUnpooled = 0;   // allocations larger than kMaxPooledSize
+    uint64_t                  mTrims = 0;      // times the free lists were emptied to retry
+};
+
+} // namespace android
+
+#endif // ANDROID_CLIENT_HEAP_POOL_H
@@ -920,6 +920,37 @@ status_t AudioFlinger::EffectModule::command(uint32_t cmdCode,
                                              void *pReplyData)
 {
     Mutex::Autolock _l(mLock);
+    return command_l(cmdCode, cmdSize, pCmdData, replySize, pReplyData);
+}
+
+status_t AudioFlinger::EffectModule::setParameters(
+        const std::vector<std::vector<uint8_t>>& params, int *reply)
+{
+    // a single lock hold, so that process() sees either none or all of the parameters.
+    Mutex::Autolock _l(mLock);
+    *reply = 0;
+    for (const std::vector<uint8_t>& param : params) {
+        uint32_t rsize = sizeof(*reply);
+        // a copy, as the effect may modify the command data
+        std::vector<uint8_t> cmd(param);
+        status_t status = command_l(EFFECT_CMD_SET_PARAM, cmd.size(), cmd.data(), &rsize, reply);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        if (*reply != NO_ERROR) {
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+// must be called with EffectModule::mLock held
+status_t AudioFlinger::EffectModule::command_l(uint32_t cmdCode,
+                                               uint32_t cmdSize,
+                                               void *pCmdData,
+                                               uint32_t *replySize,
+                                               void *pReplyData)
+{
     ALOGVV("command(), cmdCode: %d, mEffectInterface: %p", cmdCode, mEffectInterface.get());
 
     if (mState == DESTROYED || mEffectInterface == 0) {
@@ -1748,6 +1779,31 @@ void AudioFlinger::EffectHandle::disconnect(bool unpinIfLast)
     }
 }
 
+// Removes the parameter blocks that a later block of the same parameter overrides.
+// Blocks are effect_param_t: the same parameter has the same psize and parameter bytes.
+static void removeOverriddenParameters(std::vector<std::vector<uint8_t>> *params)
+{
+    auto sameParameter = [](const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        const effect_param_t *pa = (const effect_param_t *)a.data();
+        const effect_param_t *pb = (const effect_param_t *)b.data();
+        return pa->psize == pb->psize
+                && pa->psize <= a.size() - sizeof(effect_param_t)
+                && pb->psize <= b.size() - sizeof(effect_param_t)
+                && memcmp(pa->data, pb->data, pa->psize) == 0;
+    };
+    for (size_t i = 0; i < params->size(); ) {
+        bool overridden = false;
+        for (size_t j = i + 1; j < params->size() && !overridden; j++) {
+            overridden = sameParameter((*params)[i], (*params)[j]);
+        }
+        if (overridden) {
+            params->erase(params->begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
 status_t AudioFlinger::EffectHandle::command(uint32_t cmdCode,
                                              uint32_t cmdSize,
                                              void *pCmdData,
@@ -1828,56 +1884,40 @@ status_t AudioFlinger::EffectHandle::command(uint32_t cmdCode,
             mCblk->clientIndex = 0;
             return BAD_VALUE;
         }
+        // Copy all blocks to local memory first, in case of client corruption b/32220769.
+        // An automating client may have queued several values for the same parameter:
+        // only the last one is sent, and the batch is applied between two process() calls.
+        std::vector<std::vector<uint8_t>> params;
         status_t status = NO_ERROR;
-        effect_param_t *param = NULL;
         for (uint32_t index = serverIndex; index < clientIndex;) {
             int *p = (int *)(mBuffer + index);
             const int size = *p++;
-            if (size < 0
+            if (size < (int)sizeof(effect_param_t)
                     || size > EFFECT_PARAM_BUFFER_SIZE
                     || ((uint8_t *)p + size) > mBuffer + clientIndex) {
                 ALOGW("command(): invalid parameter block size");
                 status = BAD_VALUE;
                 break;
             }
+            params.emplace_back((uint8_t *)p, (uint8_t *)p + size);
+            index += size;
+        }
 
-            // copy to local memory in case of client corruption b/32220769
-            param = (effect_param_t *)realloc(param, size);
-            if (param == NULL) {
-                ALOGW("command(): out of memory");
-                status = NO_MEMORY;
-                break;
-            }
-            memcpy(param, p, size);
+        // verify shared memory: server index shouldn't change; client index can't go back.
+        if (serverIndex != mCblk->serverIndex
+                || clientIndex > mCblk->clientIndex) {
+            android_errorWriteLog(0x534e4554, "32220769");
+            status = BAD_VALUE;
+        }
 
+        if (status == NO_ERROR) {
+            removeOverriddenParameters(&params);
             int reply = 0;
-            uint32_t rsize = sizeof(reply);
-            status_t ret = effect->command(EFFECT_CMD_SET_PARAM,
-                                            size,
-                                            param,
-                                            &rsize,
-                                            &reply);
-
-            // verify shared memory: server index shouldn't change; client index can't go back.
-            if (serverIndex != mCblk->serverIndex
-                    || clientIndex > mCblk->clientIndex) {
-                android_errorWriteLog(0x534e4554, "32220769");
-                status = BAD_VALUE;
-                break;
-            }
-
-            // stop at first error encountered
-            if (ret != NO_ERROR) {
-                status = ret;
+            status = effect->setParameters(params, &reply);
+            if (status != NO_ERROR || reply != NO_ERROR) {
                 *(int *)pReplyData = reply;
-                break;
-            } else if (reply != NO_ERROR) {
-                *(int *)pReplyData = reply;
-                break;
             }
-            index += size;
         }
-        free(param);
         mCblk->serverIndex = 0;
         mCblk->clientIndex = 0;
         return status;
@@ -1946,6 +1986,68 @@ void AudioFlinger::EffectHandle::dumpToBuffer(char* buffer, size_t size)
 #undef LOG_TAG
 #define LOG_TAG "AudioFlinger::EffectChain"
 
+// Worker running the effects of a chain whose processing is deferred by one period.
+// One process is outstanding at most: post() is only called after waitIdle().
+class AudioFlinger::EffectChain::DeferredProcessor : public Thread {
+public:
+    DeferredProcessor() : Thread(false /*canCallJava*/) {}
+
+    void post(const Vector< sp<EffectModule> >& effects) {
+        Mutex::Autolock _l(mLock);
+        mEffects = effects;
+        mPending = true;
+        mWorkCond.signal();
+    }
+
+    void waitIdle() {
+        Mutex::Autolock _l(mLock);
+        while (mPending) {
+            mIdleCond.wait(mLock);
+        }
+    }
+
+    void stop() {
+        requestExit();
+        {
+            Mutex::Autolock _l(mLock);
+            mWorkCond.signal();
+        }
+        requestExitAndWait();
+    }
+
+private:
+    bool threadLoop() override {
+        Vector< sp<EffectModule> > effects;
+        {
+            Mutex::Autolock _l(mLock);
+            while (!mPending && !exitPending()) {
+                mWorkCond.wait(mLock);
+            }
+            if (exitPending()) {
+                mPending = false;
+                mEffects.clear();
+                mIdleCond.broadcast();
+                return false;
+            }
+            effects = mEffects;
+        }
+        for (size_t i = 0; i < effects.size(); i++) {
+            effects[i]->process();
+        }
+        Mutex::Autolock _l(mLock);
+        mPending = false;
+        mEffects.clear();
+        mIdleCond.broadcast();
+        return true;
+    }
+
+    Mutex mLock;
+    Condition mWorkCond;
+    Condition mIdleCond;
+    bool mPending = false;
+    Vector< sp<EffectModule> > mEffects;    // effects to process, references held while pending
+};
+
 AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
                                         audio_session_t sessionId)
     : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
@@ -1962,6 +2064,137 @@ AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
 
 AudioFlinger::EffectChain::~EffectChain()
 {
+    if (mDeferredProcessor != 0) {
+        mDeferredProcessor->stop();
+    }
+}
+
+void AudioFlinger::EffectChain::setDeferredProcessing(bool deferred)
+{
+    if (deferred == (mDeferredProcessor != 0)) {
+        return;
+    }
+    if (deferred) {
+        sp<DeferredProcessor> processor = new DeferredProcessor();
+        const status_t status = processor->run("AudioEffectChain", ANDROID_PRIORITY_URGENT_AUDIO);
+        if (status != NO_ERROR) {
+            ALOGW("%s: cannot start worker for session %d: %d", __func__, mSessionId, status);
+            return;
+        }
+        mDeferredProcessor = processor;
+    } else {
+        mDeferredProcessor->stop();
+        mDeferredProcessor.clear();
+        mInBuffer = mThreadInBuffer;
+        mOutBuffer = mThreadOutBuffer;
+    }
+}
+
+pid_t AudioFlinger::EffectChain::deferredProcessingTid() const
+{
+    return mDeferredProcessor != 0 ? mDeferredProcessor->getTid() : -1;
+}
+
+void AudioFlinger::EffectChain::waitDeferredProcessing()
+{
+    if (mDeferredProcessor != 0) {
+        mDeferredProcessor->waitIdle();
+    }
+}
+
+sp<EffectBufferHalInterface> AudioFlinger::EffectChain::allocateDeferredBuffer(
+        const sp<EffectBufferHalInterface>& threadBuffer)
+{
+    sp<ThreadBase> thread = mThread.promote();
+    if (thread == 0) {
+        return nullptr;
+    }
+    sp<EffectBufferHalInterface> buffer;
+    const size_t size = threadBuffer->getSize();
+    if (thread->mAudioFlinger->mEffectsFactoryHal->allocateBuffer(size, &buffer) != OK) {
+        return nullptr;
+    }
+    memset(buffer->audioBuffer()->raw, 0, size);
+    return buffer;
+}
+
+void AudioFlinger::EffectChain::setInBuffer(const sp<EffectBufferHalInterface>& buffer)
+{
+    waitDeferredProcessing();
+    mThreadInBuffer = buffer;
+    mInBuffer = buffer;
+    if (mDeferredProcessor != 0 && buffer != 0) {
+        sp<EffectBufferHalInterface> privateBuffer = allocateDeferredBuffer(buffer);
+        if (privateBuffer == 0) {
+            ALOGW("%s: cannot allocate buffer, not deferring session %d", __func__, mSessionId);
+            setDeferredProcessing(false);
+            return;
+        }
+        mInBuffer = privateBuffer;
+    }
+}
+
+void AudioFlinger::EffectChain::setOutBuffer(const sp<EffectBufferHalInterface>& buffer)
+{
+    waitDeferredProcessing();
+    mThreadOutBuffer = buffer;
+    mOutBuffer = buffer;
+    if (mDeferredProcessor != 0 && buffer != 0) {
+        if (buffer == mThreadInBuffer) {
+            mOutBuffer = mInBuffer;     // processed in place
+            return;
+        }
+        sp<EffectBufferHalInterface> privateBuffer = allocateDeferredBuffer(buffer);
+        if (privateBuffer == 0) {
+            ALOGW("%s: cannot allocate buffer, not deferring session %d", __func__, mSessionId);
+            setDeferredProcessing(false);
+            return;
+        }
+        mOutBuffer = privateBuffer;
+    }
+}
+
+bool AudioFlinger::EffectChain::hasAuxiliaryEffect_l() const
+{
+    // auxiliary effects are first in the chain
+    return mEffects.size() > 0
+            && (mEffects[0]->desc().flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY;
+}
+
+// Must be called with EffectChain::mLock locked and the worker idle
+void AudioFlinger::EffectChain::exchangeDeferredBuffers_l()
+{
+    const size_t size = std::min(mThreadInBuffer->getSize(), mInBuffer->getSize());
+    uint8_t *threadIn = reinterpret_cast<uint8_t*>(mThreadInBuffer->ptr());
+    uint8_t *privateIn = reinterpret_cast<uint8_t*>(mInBuffer->audioBuffer()->raw);
+    if (mThreadOutBuffer == mThreadInBuffer) {
+        // in place: the thread gets the processed last period, the effects the new input
+        std::swap_ranges(threadIn, threadIn + size, privateIn);
+    } else {
+        commitDeferredBuffers_l();
+        memcpy(privateIn, threadIn, size);
+    }
+}
+
+// Must be called with EffectChain::mLock locked and the worker idle
+void AudioFlinger::EffectChain::commitDeferredBuffers_l()
+{
+    if (mThreadOutBuffer == mThreadInBuffer) {
+        memcpy(mThreadInBuffer->ptr(), mInBuffer->audioBuffer()->raw,
+                std::min(mThreadInBuffer->getSize(), mInBuffer->getSize()));
+        return;
+    }
+    // the last effect accumulates in the output buffer, as it would in the thread buffer
+    const size_t size = std::min(mThreadOutBuffer->getSize(), mOutBuffer->getSize());
+    void *privateOut = mOutBuffer->audioBuffer()->raw;
+#ifdef FLOAT_EFFECT_CHAIN
+    accumulate_float(reinterpret_cast<float*>(mThreadOutBuffer->ptr()),
+            reinterpret_cast<const float*>(privateOut), size / sizeof(float));
+#else
+    accumulate_i16(reinterpret_cast<int16_t*>(mThreadOutBuffer->ptr()),
+            reinterpret_cast<const int16_t*>(privateOut), size / sizeof(int16_t));
+#endif
+    memset(privateOut, 0, size);
 }
 
 // getEffectFromDesc_l() must be called with ThreadBase::mLock held
@@ -2019,6 +2252,7 @@ std::vector<int> AudioFlinger::EffectChain::getEffectIds()
 void AudioFlinger::EffectChain::clearInputBuffer()
 {
     Mutex::Autolock _l(mLock);
+    waitDeferredProcessing();
     sp<ThreadBase> thread = mThread.promote();
     if (thread == 0) {
         ALOGW("clearInputBuffer(): cannot promote mixer thread");
@@ -2034,12 +2268,16 @@ void AudioFlinger::EffectChain::clearInputBuffer()
 // Must be called with EffectChain::mLock locked
 void AudioFlinger::EffectChain::clearInputBuffer_l(const sp<ThreadBase>& thread)
 {
-    if (mInBuffer == NULL) {
+    if (mThreadInBuffer == NULL) {
         return;
     }
     const size_t frameSize =
             audio_bytes_per_sample(EFFECT_BUFFER_FORMAT) * thread->channelCount();
 
+    if (mDeferredProcessor != 0) {
+        memset(mThreadInBuffer->ptr(), 0, thread->frameCount() * frameSize);
+        return;
+    }
     memset(mInBuffer->audioBuffer()->raw, 0, thread->frameCount() * frameSize);
     mInBuffer->commit();
 }
@@ -2079,7 +2317,25 @@ void AudioFlinger::EffectChain::process_l()
     }
 
     size_t size = mEffects.size();
-    if (doProcess) {
+    if (mDeferredProcessor != 0) {
+        // the worker has processed the input of the previous period
+        mDeferredProcessor->waitIdle();
+        if (doProcess) {
+            if (hasAuxiliaryEffect_l()) {
+                // Tracks accumulate in the input buffers of auxiliary effects while mixing,
+                // so these chains are processed inline, in the private buffers.
+                memcpy(mInBuffer->audioBuffer()->raw, mThreadInBuffer->ptr(),
+                        std::min(mThreadInBuffer->getSize(), mInBuffer->getSize()));
+                for (size_t i = 0; i < size; i++) {
+                    mEffects[i]->process();
+                }
+                commitDeferredBuffers_l();
+                doProcess = false;
+            } else {
+                exchangeDeferredBuffers_l();
+            }
+        }
+    } else if (doProcess) {
         // Only the input and output buffers of the chain can be external,
         // and 'update' / 'commit' do nothing for allocated buffers, thus
         // it's not needed to consider any other buffers here.
@@ -2102,6 +2358,10 @@ void AudioFlinger::EffectChain::process_l()
     if (doResetVolume) {
         resetVolume_l();
     }
+    if (mDeferredProcessor != 0 && doProcess) {
+        // effect states are only updated while the worker is idle
+        mDeferredProcessor->post(mEffects);
+    }
 }
 
 // createEffect_l() must be called with ThreadBase::mLock held
@@ -2133,6 +2393,8 @@ status_t AudioFlinger::EffectChain::addEffect_l(const sp<EffectModule>& effect)
 // addEffect_l() must be called with ThreadBase::mLock and EffectChain::mLock held
 status_t AudioFlinger::EffectChain::addEffect_ll(const sp<EffectModule>& effect)
 {
+    // the buffer connections are about to change
+    waitDeferredProcessing();
     effect_descriptor_t desc = effect->desc();
     uint32_t insertPref = desc.flags & EFFECT_FLAG_INSERT_MASK;
 
@@ -2258,6 +2520,7 @@ size_t AudioFlinger::EffectChain::removeEffect_l(const sp<EffectModule>& effect,
                                                  bool release)
 {
     Mutex::Autolock _l(mLock);
+    waitDeferredProcessing();
     size_t size = mEffects.size();
     uint32_t type = effect->desc().flags & EFFECT_FLAG_TYPE_MASK;
 
@@ -2427,6 +2690,10 @@ void AudioFlinger::EffectChain::dump(int fd, const Vector<String16>& args)
                 (int)outBufferStr.size(), "Out buffer      ");
         result.appendFormat("\t%s   %s   %d\n",
                 inBufferStr.c_str(), outBufferStr.c_str(), mActiveTrackCnt);
+        if (mDeferredProcessor != 0) {
+            result.appendFormat("\tProcessing deferred by one period on tid %d\n",
+                    (int)mDeferredProcessor->getTid());
+        }
         write(fd, result.string(), result.size());
 
         for (size_t i = 0; i < numEffects; ++i) {
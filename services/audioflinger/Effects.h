@@ -68,6 +68,9 @@ public:
                      void *pCmdData,
                      uint32_t *replySize,
                      void *pReplyData);
+    // Sends EFFECT_CMD_SET_PARAM for each block, with no process() call in between.
+    // Stops at the first error, *reply is then the effect's reply for that block.
+    status_t setParameters(const std::vector<std::vector<uint8_t>>& params, int *reply);
 
     void reset_l();
     status_t configure();
@@ -150,6 +153,12 @@ private:
     friend class AudioFlinger;      // for mHandles
     bool                mPinned;
 
+    status_t command_l(uint32_t cmdCode,
+                       uint32_t cmdSize,
+                       void *pCmdData,
+                       uint32_t *replySize,
+                       void *pReplyData);
+
     // Maximum time allocated to effect engines to complete the turn off sequence
     static const uint32_t MAX_DISABLE_TIME_MS = 10000;
 
@@ -354,17 +363,24 @@ public:
     void setMode_l(audio_mode_t mode);
     void setAudioSource_l(audio_source_t source);
 
-    void setInBuffer(const sp<EffectBufferHalInterface>& buffer) {
-        mInBuffer = buffer;
-    }
+    // When deferred, the effects are processed on a worker thread one period behind the
+    // thread: process_l() hands the new input to the worker and returns the output of the
+    // previous period.  Must be set before the chain buffers.
+    void setDeferredProcessing(bool deferred);
+    // Returns the tid of the deferred processing worker, or -1 if not deferred.
+    pid_t deferredProcessingTid() const;
+
+    // The buffers shared with the thread.  Effects are connected to private copies of them
+    // when processing is deferred.
+    void setInBuffer(const sp<EffectBufferHalInterface>& buffer);
     effect_buffer_t *inBuffer() const {
-        return mInBuffer != 0 ? reinterpret_cast<effect_buffer_t*>(mInBuffer->ptr()) : NULL;
-    }
-    void setOutBuffer(const sp<EffectBufferHalInterface>& buffer) {
-        mOutBuffer = buffer;
+        return mThreadInBuffer != 0 ?
+                reinterpret_cast<effect_buffer_t*>(mThreadInBuffer->ptr()) : NULL;
     }
+    void setOutBuffer(const sp<EffectBufferHalInterface>& buffer);
     effect_buffer_t *outBuffer() const {
-        return mOutBuffer != 0 ? reinterpret_cast<effect_buffer_t*>(mOutBuffer->ptr()) : NULL;
+        return mThreadOutBuffer != 0 ?
+                reinterpret_cast<effect_buffer_t*>(mThreadOutBuffer->ptr()) : NULL;
     }
 
     void incTrackCnt() { android_atomic_inc(&mTrackCnt); }
@@ -447,12 +463,28 @@ private:
 
     void setVolumeForOutput_l(uint32_t left, uint32_t right);
 
+    class DeferredProcessor;
+
+    // Waits until the worker is done with the chain buffers, if processing is deferred.
+    void waitDeferredProcessing();
+    sp<EffectBufferHalInterface> allocateDeferredBuffer(
+            const sp<EffectBufferHalInterface>& threadBuffer);
+    // Exchanges the new input from the thread with the processed output of the last period.
+    void exchangeDeferredBuffers_l();
+    // Delivers the output of the private buffers to the thread.
+    void commitDeferredBuffers_l();
+    bool hasAuxiliaryEffect_l() const;
+
              wp<ThreadBase> mThread;     // parent mixer thread
     mutable  Mutex mLock;        // mutex protecting effect list
              Vector< sp<EffectModule> > mEffects; // list of effect modules
              audio_session_t mSessionId; // audio session ID
              sp<EffectBufferHalInterface> mInBuffer;  // chain input buffer
              sp<EffectBufferHalInterface> mOutBuffer; // chain output buffer
+             // same as mInBuffer and mOutBuffer unless processing is deferred
+             sp<EffectBufferHalInterface> mThreadInBuffer;
+             sp<EffectBufferHalInterface> mThreadOutBuffer;
+             sp<DeferredProcessor> mDeferredProcessor;  // non-0 if processing is deferred
 
     // 'volatile' here means these are accessed with atomic operations instead of mutex
     volatile int32_t mActiveTrackCnt;    // number of active tracks connected
@@ -46,6 +46,10 @@
 
 namespace android {
 
+// Write a lone unity-gain fast track straight from its buffer provider to the sink,
+// skipping the mix and format conversion, when its format already matches the sink.
+static constexpr bool kUseMixerBypass = true;
+
 /*static*/ const FastMixerState FastMixer::sInitial;
 
 FastMixer::FastMixer(audio_io_handle_t parentIoHandle)
@@ -64,6 +68,7 @@ FastMixer::FastMixer(audio_io_handle_t parentIoHandle)
     mFormat(Format_Invalid),
     mSampleRate(0),
     mFastTracksGen(0),
+    mUnityTrack(-1),
     mTotalNativeFramesWritten(0),
     // timestamp
     mNativeFramesWrittenButNotPresented(0),   // the = 0 is to silence the compiler
@@ -342,6 +347,51 @@ void FastMixer::onStateChange()
     }
 }
 
+bool FastMixer::isBypassCompatible(const FastTrack *fastTrack) const
+{
+    // Float tracks are excluded because the mixer clamps their samples (b/68099072),
+    // and haptic sinks need the channel adjustment done after the mix.
+    return fastTrack->mFormat == mFormat.mFormat
+            && fastTrack->mFormat != AUDIO_FORMAT_PCM_FLOAT
+            && fastTrack->mChannelMask == mSinkChannelMask
+            && (mSinkChannelMask & AUDIO_CHANNEL_HAPTIC_ALL) == AUDIO_CHANNEL_NONE;
+}
+
+void *FastMixer::obtainBypassBuffer(ExtendedAudioBufferProvider *provider, size_t frameCount,
+        AudioBufferProvider::Buffer *buffer)
+{
+    buffer->frameCount = frameCount;
+    if (provider->getNextBuffer(buffer) == NO_ERROR && buffer->frameCount == frameCount) {
+        return buffer->raw; // released by the caller after write()
+    }
+
+    // The track buffer wraps around (or the track underran after framesReady()),
+    // so gather the period into the sink buffer with a plain copy.
+    // mMixerBuffer is large enough when there is no sink buffer, see onStateChange().
+    void *dst = mSinkBuffer != NULL ? mSinkBuffer : mMixerBuffer;
+    const size_t frameSize = audio_bytes_per_frame(mSinkChannelCount, mFormat.mFormat);
+    size_t framesCopied = 0;
+    while (buffer->frameCount > 0) {
+        memcpy((char *)dst + framesCopied * frameSize, buffer->raw,
+                buffer->frameCount * frameSize);
+        framesCopied += buffer->frameCount;
+        provider->releaseBuffer(buffer);
+        if (framesCopied >= frameCount) {
+            break;
+        }
+        buffer->frameCount = frameCount - framesCopied;
+        if (provider->getNextBuffer(buffer) != NO_ERROR) {
+            break;
+        }
+    }
+    if (framesCopied < frameCount) {
+        memset((char *)dst + framesCopied * frameSize, 0, (frameCount - framesCopied) * frameSize);
+    }
+    buffer->frameCount = 0;
+    mMixerBufferState = UNDEFINED;
+    return dst;
+}
+
 void FastMixer::onWork()
 {
     // TODO: pass an ID parameter to indicate which time series we want to write to in NBLog.cpp
@@ -366,6 +416,7 @@ void FastMixer::onWork()
     }
     const FastMixerState::Command command = mCommand;
     const size_t frameCount = current->mFrameCount;
+    int bypassTrack = -1;   // index of the fast track written directly to the sink, if any
 
     if ((command & FastMixerState::MIX) && (mMixer != NULL) && mIsWarm) {
         ALOG_ASSERT(mMixerBuffer != NULL);
@@ -373,6 +424,8 @@ void FastMixer::onWork()
         // AudioMixer::mState.enabledTracks is undefined if mState.hook == process__validate,
         // so we keep a side copy of enabledTracks
         bool anyEnabledTracks = false;
+        unsigned enabledTrackCount = 0;
+        int unityTrack = -1;    // the last enabled track, if full and eligible for bypass
 
         // for each track, update volume and check for underrun
         unsigned currentTrackMask = current->mTrackMask;
@@ -400,6 +453,7 @@ void FastMixer::onWork()
             fastTrack->mBufferProvider->onTimestamp(perTrackTimestamp);
 
             const int name = i;
+            bool unityGain = true;
             if (fastTrack->mVolumeProvider != NULL) {
                 gain_minifloat_packed_t vlr = fastTrack->mVolumeProvider->getVolumeLR();
                 float vlf = float_from_gain(gain_minifloat_unpack_left(vlr));
@@ -407,6 +461,8 @@ void FastMixer::onWork()
 
                 mMixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0, &vlf);
                 mMixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1, &vrf);
+                unityGain = vlf == AudioMixer::UNITY_GAIN_FLOAT
+                        && vrf == AudioMixer::UNITY_GAIN_FLOAT;
             }
             // FIXME The current implementation of framesReady() for fast tracks
             // takes a tryLock, which can block
@@ -434,58 +490,89 @@ void FastMixer::onWork()
                     underruns.mBitFields.mMostRecent = UNDERRUN_PARTIAL;
                     mMixer->enable(name);
                     anyEnabledTracks = true;
+                    enabledTrackCount++;
+                    unityTrack = -1;
                 }
             } else {
                 underruns.mBitFields.mFull++;
                 underruns.mBitFields.mMostRecent = UNDERRUN_FULL;
                 mMixer->enable(name);
                 anyEnabledTracks = true;
+                enabledTrackCount++;
+                unityTrack = unityGain && isBypassCompatible(fastTrack) ? i : -1;
             }
             ftDump->mUnderruns = underruns;
             ftDump->mFramesReady = framesReady;
             ftDump->mFramesWritten = trackFramesWritten;
         }
 
-        if (anyEnabledTracks) {
+        if (enabledTrackCount != 1) {
+            unityTrack = -1;
+        }
+        // The bypass is only taken once the mixer has mixed the track at unity gain for a
+        // full period, so that any volume ramp towards unity has completed.  The mixer does
+        // not hold on to track frames between process() calls, so we can switch either way
+        // at a period boundary.
+        if (kUseMixerBypass && unityTrack >= 0 && unityTrack == mUnityTrack
+                && (command & FastMixerState::WRITE) && mOutputSink != NULL
+                && !mMasterMono.load() && mMasterBalance.load() == 0.f) {
+            bypassTrack = unityTrack;
+            if (mMixerBufferState == MIXED) {
+                mMixerBufferState = UNDEFINED;
+            }
+        } else if (anyEnabledTracks) {
             // process() is CPU-bound
             mMixer->process();
             mMixerBufferState = MIXED;
         } else if (mMixerBufferState != ZEROED) {
             mMixerBufferState = UNDEFINED;
         }
+        mUnityTrack = unityTrack;
 
-    } else if (mMixerBufferState == MIXED) {
-        mMixerBufferState = UNDEFINED;
+    } else {
+        mUnityTrack = -1;
+        if (mMixerBufferState == MIXED) {
+            mMixerBufferState = UNDEFINED;
+        }
     }
     //bool didFullWrite = false;    // dumpsys could display a count of partial writes
     if ((command & FastMixerState::WRITE) && (mOutputSink != NULL) && (mMixerBuffer != NULL)) {
-        if (mMixerBufferState == UNDEFINED) {
-            memset(mMixerBuffer, 0, mMixerBufferSize);
-            mMixerBufferState = ZEROED;
-        }
+        void *buffer;
+        ExtendedAudioBufferProvider *bypassProvider = NULL;
+        AudioBufferProvider::Buffer bypassBuffer;
+        if (bypassTrack >= 0) {
+            bypassProvider = current->mFastTracks[bypassTrack].mBufferProvider;
+            buffer = obtainBypassBuffer(bypassProvider, frameCount, &bypassBuffer);
+            dumpState->mBypassWrites++;
+        } else {
+            if (mMixerBufferState == UNDEFINED) {
+                memset(mMixerBuffer, 0, mMixerBufferSize);
+                mMixerBufferState = ZEROED;
+            }
 
-        if (mMasterMono.load()) {  // memory_order_seq_cst
-            mono_blend(mMixerBuffer, mMixerBufferFormat, Format_channelCount(mFormat), frameCount,
-                    true /*limit*/);
-        }
+            if (mMasterMono.load()) {  // memory_order_seq_cst
+                mono_blend(mMixerBuffer, mMixerBufferFormat, Format_channelCount(mFormat),
+                        frameCount, true /*limit*/);
+            }
 
-        // Balance must take effect after mono conversion.
-        // mBalance detects zero balance within the class for speed (not needed here).
-        mBalance.setBalance(mMasterBalance.load());
-        mBalance.process((float *)mMixerBuffer, frameCount);
+            // Balance must take effect after mono conversion.
+            // mBalance detects zero balance within the class for speed (not needed here).
+            mBalance.setBalance(mMasterBalance.load());
+            mBalance.process((float *)mMixerBuffer, frameCount);
 
-        // prepare the buffer used to write to sink
-        void *buffer = mSinkBuffer != NULL ? mSinkBuffer : mMixerBuffer;
-        if (mFormat.mFormat != mMixerBufferFormat) { // sink format not the same as mixer format
-            memcpy_by_audio_format(buffer, mFormat.mFormat, mMixerBuffer, mMixerBufferFormat,
-                    frameCount * Format_channelCount(mFormat));
-        }
-        if (mSinkChannelMask & AUDIO_CHANNEL_HAPTIC_ALL) {
-            // When there are haptic channels, the sample data is partially interleaved.
-            // Make the sample data fully interleaved here.
-            adjust_channels_non_destructive(buffer, mAudioChannelCount, buffer, mSinkChannelCount,
-                    audio_bytes_per_sample(mFormat.mFormat),
-                    frameCount * audio_bytes_per_frame(mAudioChannelCount, mFormat.mFormat));
+            // prepare the buffer used to write to sink
+            buffer = mSinkBuffer != NULL ? mSinkBuffer : mMixerBuffer;
+            if (mFormat.mFormat != mMixerBufferFormat) { // sink format not the same as mixer format
+                memcpy_by_audio_format(buffer, mFormat.mFormat, mMixerBuffer, mMixerBufferFormat,
+                        frameCount * Format_channelCount(mFormat));
+            }
+            if (mSinkChannelMask & AUDIO_CHANNEL_HAPTIC_ALL) {
+                // When there are haptic channels, the sample data is partially interleaved.
+                // Make the sample data fully interleaved here.
+                adjust_channels_non_destructive(buffer, mAudioChannelCount, buffer,
+                        mSinkChannelCount, audio_bytes_per_sample(mFormat.mFormat),
+                        frameCount * audio_bytes_per_frame(mAudioChannelCount, mFormat.mFormat));
+            }
         }
         // if non-NULL, then duplicate write() to this non-blocking sink
 #ifdef TEE_SINK
@@ -498,6 +585,10 @@ void FastMixer::onWork()
         ssize_t framesWritten = mOutputSink->write(buffer, frameCount);
         ATRACE_END();
         dumpState->mWriteSequence++;
+        if (bypassBuffer.frameCount != 0) {
+            // the sink read directly from the track buffer, so release it only now
+            bypassProvider->releaseBuffer(&bypassBuffer);
+        }
         if (framesWritten >= 0) {
             ALOG_ASSERT((size_t) framesWritten <= frameCount);
             mTotalNativeFramesWritten += framesWritten;
@@ -67,6 +67,14 @@ private:
     // called when a fast track of index has been removed, added, or modified
     void updateMixerTrack(int index, Reason reason);
 
+    // true if the fast track can be written to the sink without mixing or conversion
+    bool isBypassCompatible(const FastTrack *fastTrack) const;
+    // obtains one period of the bypassed track for write(), directly from the track buffer
+    // when contiguous (buffer->frameCount != 0 then, to be released after write()),
+    // otherwise copied into the sink buffer.
+    void *obtainBypassBuffer(ExtendedAudioBufferProvider *provider, size_t frameCount,
+            AudioBufferProvider::Buffer *buffer);
+
     // FIXME these former local variables need comments
     static const FastMixerState sInitial;
 
@@ -93,6 +101,8 @@ private:
     NBAIO_Format    mFormat;
     unsigned        mSampleRate;
     int             mFastTracksGen;
+    int             mUnityTrack;        // index of the lone full track mixed at unity gain
+                                        // in the previous cycle, or -1
     FastMixerDumpState mDummyFastMixerDumpState;
     int64_t         mTotalNativeFramesWritten;  // copied to dumpState->mFramesWritten
 
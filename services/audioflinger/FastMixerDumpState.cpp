@@ -32,7 +32,7 @@ namespace android {
 
 FastMixerDumpState::FastMixerDumpState() : FastThreadDumpState(),
     mWriteSequence(0), mFramesWritten(0),
-    mNumTracks(0), mWriteErrors(0),
+    mNumTracks(0), mWriteErrors(0), mBypassWrites(0),
     mSampleRate(0), mFrameCount(0),
     mTrackMask(0)
 {
@@ -68,11 +68,11 @@ void FastMixerDumpState::dump(int fd) const
     dprintf(fd, "  FastMixer command=%s writeSequence=%u framesWritten=%u\n"
                 "            numTracks=%u writeErrors=%u underruns=%u overruns=%u\n"
                 "            sampleRate=%u frameCount=%zu measuredWarmup=%.3g ms, warmupCycles=%u\n"
-                "            mixPeriod=%.2f ms latency=%.2f ms\n",
+                "            mixPeriod=%.2f ms latency=%.2f ms bypassWrites=%u\n",
                 FastMixerState::commandToString(mCommand), mWriteSequence, mFramesWritten,
                 mNumTracks, mWriteErrors, mUnderruns, mOverruns,
                 mSampleRate, mFrameCount, measuredWarmupMs, mWarmupCycles,
-                mixPeriodSec * 1e3, mLatencyMs);
+                mixPeriodSec * 1e3, mLatencyMs, mBypassWrites);
     dprintf(fd, "  FastMixer Timestamp stats: %s\n", mTimestampVerifier.toString().c_str());
 #ifdef FAST_THREAD_STATISTICS
     // find the interval of valid samples
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioFlinger"
+//#define LOG_NDEBUG 0
+
+#include <math.h>
+#include <string.h>
+
+#include <string>
+
+#include <utils/Log.h>
+
+#include "MmapStreamHealth.h"
+
+namespace android {
+
+void MmapStreamHealth::reset()
+{
+    mLastPositionFrames = 0;
+    mLastTimeNs = 0;
+    mStallStartNs = 0;
+    mSamples = 0;
+    memset(mJitterBins, 0, sizeof(mJitterBins));
+    mMaxJitterMs = 0.;
+    memset(mStallBins, 0, sizeof(mStallBins));
+    mStalls = 0;
+    mMaxStallMs = 0.;
+    mTotalStallMs = 0.;
+}
+
+// static
+size_t MmapStreamHealth::binOf(double ms)
+{
+    size_t bin = 0;
+    for (double limit = 1.; bin < kNumBins - 1 && ms >= limit; limit *= 2.) {
+        ++bin;
+    }
+    return bin;
+}
+
+void MmapStreamHealth::addSample(int64_t positionFrames, int64_t timeNs, uint32_t sampleRate)
+{
+    if (sampleRate == 0 || timeNs <= mLastTimeNs) {
+        return;
+    }
+    const int64_t lastTimeNs = mLastTimeNs;
+    const int64_t deltaFrames = positionFrames - mLastPositionFrames;
+    mLastPositionFrames = positionFrames;
+    mLastTimeNs = timeNs;
+    if (lastTimeNs == 0 || deltaFrames < 0) {
+        mStallStartNs = 0;
+        return;
+    }
+
+    if (deltaFrames == 0) {
+        if (mStallStartNs == 0) {
+            mStallStartNs = lastTimeNs;
+        }
+        return;
+    }
+    if (mStallStartNs != 0) {
+        const double stallMs = (lastTimeNs - mStallStartNs) * 1e-6;
+        mStallStartNs = 0;
+        mStallBins[binOf(stallMs)]++;
+        mStalls++;
+        mTotalStallMs += stallMs;
+        if (stallMs > mMaxStallMs) {
+            mMaxStallMs = stallMs;
+        }
+    }
+
+    const double advanceMs = deltaFrames * 1e3 / sampleRate;
+    const double jitterMs = fabs(advanceMs - (timeNs - lastTimeNs) * 1e-6);
+    mSamples++;
+    mJitterBins[binOf(jitterMs)]++;
+    if (jitterMs > mMaxJitterMs) {
+        mMaxJitterMs = jitterMs;
+    }
+}
+
+// static
+String8 MmapStreamHealth::histogramToString(const int64_t (&bins)[kNumBins])
+{
+    String8 result;
+    for (size_t i = 0; i < kNumBins; ++i) {
+        result.appendFormat("%s%lld", i == 0 ? "" : ",", (long long)bins[i]);
+    }
+    return result;
+}
+
+String8 MmapStreamHealth::toString() const
+{
+    return String8::format("samples %lld jitter ms [%s] max %.2f"
+            " stalls %lld ms [%s] max %.2f total %.2f",
+            (long long)mSamples, histogramToString(mJitterBins).string(), mMaxJitterMs,
+            (long long)mStalls, histogramToString(mStallBins).string(), mMaxStallMs,
+            mTotalStallMs);
+}
+
+void MmapStreamHealth::addToItem(MediaAnalyticsItem *item, const char *prefix) const
+{
+    const std::string p(prefix);
+    item->setInt64((p + "samples").c_str(), mSamples);
+    item->setCString((p + "jitterMs.histogram").c_str(),
+            histogramToString(mJitterBins).string());
+    item->setDouble((p + "jitterMs.max").c_str(), mMaxJitterMs);
+    item->setInt64((p + "stalls").c_str(), mStalls);
+    item->setCString((p + "stallMs.histogram").c_str(),
+            histogramToString(mStallBins).string());
+    item->setDouble((p + "stallMs.max").c_str(), mMaxStallMs);
+    item->setDouble((p + "stallMs.total").c_str(), mTotalStallMs);
+}
+
+} // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_MMAP_STREAM_HEALTH_H
+#define ANDROID_MMAP_STREAM_HEALTH_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <media/MediaAnalyticsItem.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// Health of an MMAP stream as seen from samples of its HAL position.
+//
+// The position of a running stream advances at the sample rate. Each sample records how far
+// the advance since the previous sample is from that (jitter), and spans during which the
+// position does not move at all are recorded as stalls when it moves again. Both go to
+// histograms with power of 2 millisecond bins, so that they can be compared across devices.
+class MmapStreamHealth {
+public:
+    // bin i counts values below 2^i ms, the last bin the rest
+    static constexpr size_t kNumBins = 10;
+
+    MmapStreamHealth() { reset(); }
+
+    void reset();
+
+    // the next sample starts over, e.g. after standby or a HAL restart
+    void discontinuity() { mLastTimeNs = 0; }
+
+    void addSample(int64_t positionFrames, int64_t timeNs, uint32_t sampleRate);
+
+    int64_t samples() const { return mSamples; }
+
+    String8 toString() const;
+
+    // adds the histograms and maxima to a MediaMetrics item, names starting with prefix
+    void addToItem(MediaAnalyticsItem *item, const char *prefix) const;
+
+private:
+    static size_t binOf(double ms);
+    static String8 histogramToString(const int64_t (&bins)[kNumBins]);
+
+    int64_t mLastPositionFrames;
+    int64_t mLastTimeNs;        // 0 if there is no previous sample
+    int64_t mStallStartNs;      // 0 if the position moved at the last sample
+
+    int64_t mSamples;
+    int64_t mJitterBins[kNumBins];
+    double mMaxJitterMs;
+    int64_t mStallBins[kNumBins];
+    int64_t mStalls;
+    double mMaxStallMs;
+    double mTotalStallMs;
+};
+
+} // namespace android
+
+#endif // ANDROID_MMAP_STREAM_HEALTH_H
@@ -72,5 +72,6 @@ private:
     pid_t mPid;
     bool  mSilenced;            // protected by MMapThread::mLock
     bool  mSilencedNotified;    // protected by MMapThread::mLock
+    MmapStreamHealth mHealth;   // while this client was active, protected by MMapThread::mLock
 };  // end of Track
 
@@ -20,6 +20,7 @@
 //#define LOG_NDEBUG 0
 
 #include "Configuration.h"
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <audio_utils/primitives.h>
 
@@ -445,6 +446,16 @@ status_t AudioFlinger::PatchPanel::Patch::createConnections(PatchPanel *panel)
         *mPlayback.handlePtr() = AUDIO_PATCH_HANDLE_NONE;
     }
 
+    if (canUseBridge()) {
+        mBridge = new PatchBridge(mRecord.thread(), mPlayback.thread());
+        status = mBridge->start();
+        if (status == NO_ERROR) {
+            return status;
+        }
+        ALOGW("%s() could not start bridge: %d, using patch tracks", __func__, status);
+        mBridge.clear();
+    }
+
     // use a pseudo LCM between input and output framecount
     size_t playbackFrameCount = mPlayback.thread()->frameCount();
     int playbackShift = __builtin_ctz(playbackFrameCount);
@@ -544,6 +555,10 @@ void AudioFlinger::PatchPanel::Patch::clearConnections(PatchPanel *panel)
 {
     ALOGV("%s() mRecord.handle %d mPlayback.handle %d",
             __func__, mRecord.handle(), mPlayback.handle());
+    if (mBridge != 0) {
+        mBridge->stop();
+        mBridge.clear();
+    }
     mRecord.stopTrack();
     mPlayback.stopTrack();
     mRecord.clearTrackPeer(); // mRecord stop is synchronous. Break PeerProxy sp<> cycle.
@@ -555,6 +570,11 @@ status_t AudioFlinger::PatchPanel::Patch::getLatencyMs(double *latencyMs) const
 {
     if (!isSoftware()) return INVALID_OPERATION;
 
+    if (mBridge != 0) {
+        *latencyMs = mBridge->getLatencyMs();
+        return OK;
+    }
+
     auto recordTrack = mRecord.const_track();
     if (recordTrack.get() == nullptr) return INVALID_OPERATION;
 
@@ -621,9 +641,109 @@ String8 AudioFlinger::PatchPanel::Patch::dump(audio_patch_handle_t myHandle) con
     if (getLatencyMs(&latencyMs) == OK) {
         result.appendFormat("  latency: %.2lf ms", latencyMs);
     }
+    if (mBridge != 0) {
+        result.appendFormat("  %s", mBridge->dump().string());
+    }
     return result;
 }
 
+bool AudioFlinger::PatchPanel::Patch::canUseBridge() const
+{
+    // the bridge needs both threads for itself, and no conversion between them.
+    if (mAudioPatch.num_sources != 1 || mAudioPatch.num_sinks == 0 ||
+            !property_get_bool("af.patch_bridge.direct", false /* default_value */)) {
+        return false;
+    }
+    sp<const RecordThread> recordThread = mRecord.const_thread();
+    sp<const PlaybackThread> playbackThread = mPlayback.const_thread();
+    return audio_is_linear_pcm(recordThread->format()) &&
+            recordThread->format() == playbackThread->format() &&
+            recordThread->sampleRate() == playbackThread->sampleRate() &&
+            recordThread->channelCount() == playbackThread->channelCount() &&
+            recordThread->frameSize() == playbackThread->frameSize();
+}
+
+AudioFlinger::PatchPanel::PatchBridge::PatchBridge(const sp<RecordThread>& recordThread,
+        const sp<PlaybackThread>& playbackThread)
+    : Thread(false /* canCallJava */),
+      mRecordThread(recordThread),
+      mPlaybackThread(playbackThread),
+      mBuffer(recordThread->frameCount() * recordThread->frameSize()),
+      mFrameSize(recordThread->frameSize()),
+      mSampleRate(recordThread->sampleRate())
+{
+}
+
+status_t AudioFlinger::PatchPanel::PatchBridge::start()
+{
+    static const int kPriorityPatchBridge = 3; // same as the fast mixer and fast capture
+
+    mInput = mRecordThread->standbyForBridge();
+    mOutput = mPlaybackThread->standbyForBridge();
+    if (mInput == nullptr || mOutput == nullptr || mBuffer.empty()) {
+        return NO_INIT;
+    }
+    status_t status = run("PatchBridge", ANDROID_PRIORITY_URGENT_AUDIO);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    const pid_t tid = getTid();
+    if (tid != -1) {
+        mPlaybackThread->sendPrioConfigEvent(getpid(), tid, kPriorityPatchBridge,
+                false /*forApp*/);
+    }
+    mInput->stream->setHalThreadPriority(kPriorityPatchBridge);
+    mOutput->stream->setHalThreadPriority(kPriorityPatchBridge);
+    return NO_ERROR;
+}
+
+void AudioFlinger::PatchPanel::PatchBridge::stop()
+{
+    requestExitAndWait();
+    if (mInput != nullptr) {
+        mInput->stream->standby();
+    }
+    if (mOutput != nullptr) {
+        mOutput->stream->standby();
+    }
+}
+
+bool AudioFlinger::PatchPanel::PatchBridge::threadLoop()
+{
+    size_t bytesRead = 0;
+    status_t status = mInput->stream->read(mBuffer.data(), mBuffer.size(), &bytesRead);
+    if (status != NO_ERROR || bytesRead == 0) {
+        ALOGW_IF(mReadErrors++ == 0, "%s() read failed: %d", __func__, status);
+        // do not spin on an input in error, wait for about one burst.
+        usleep(mBuffer.size() / mFrameSize * 1000000ll / mSampleRate);
+        return true;
+    }
+    size_t offset = 0;
+    while (offset < bytesRead && !exitPending()) {
+        const ssize_t written = mOutput->write(mBuffer.data() + offset, bytesRead - offset);
+        if (written <= 0) {
+            // drop the rest of the burst rather than fall behind the input.
+            ALOGW_IF(mWriteErrors++ == 0, "%s() write failed: %zd", __func__, written);
+            break;
+        }
+        offset += written;
+    }
+    mFramesBridged += offset / mFrameSize;
+    return true;
+}
+
+double AudioFlinger::PatchPanel::PatchBridge::getLatencyMs() const
+{
+    return mBuffer.size() / mFrameSize * 1e3 / mSampleRate + mPlaybackThread->latency();
+}
+
+String8 AudioFlinger::PatchPanel::PatchBridge::dump() const
+{
+    return String8::format("direct bridge: %zu frame bursts, %lld frames, %d read errors,"
+            " %d write errors", mBuffer.size() / mFrameSize, (long long)mFramesBridged.load(),
+            mReadErrors.load(), mWriteErrors.load());
+}
+
 /* Disconnect a patch */
 status_t AudioFlinger::PatchPanel::releaseAudioPatch(audio_patch_handle_t handle)
 {
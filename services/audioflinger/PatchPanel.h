@@ -150,6 +150,37 @@ private:
         sp<TrackType> mTrack;
     };
 
+    // Copies audio from the input stream of a software patch straight to its output stream
+    // on one real time thread, a burst at a time, instead of going through a PatchRecord, a
+    // PatchTrack and the buffering of both threads. The threads stay opened for routing but
+    // are kept in standby. Only used when the two streams have the same PCM configuration.
+    class PatchBridge : public Thread {
+    public:
+        PatchBridge(const sp<RecordThread>& recordThread,
+                const sp<PlaybackThread>& playbackThread);
+
+        status_t start();
+        void stop();
+
+        // latency of one input burst plus the output latency.
+        double getLatencyMs() const;
+        String8 dump() const;
+
+    private:
+        bool threadLoop() override;
+
+        const sp<RecordThread> mRecordThread;
+        const sp<PlaybackThread> mPlaybackThread;
+        AudioStreamIn *mInput = nullptr;
+        AudioStreamOut *mOutput = nullptr;
+        std::vector<uint8_t> mBuffer;           // one input burst
+        const size_t mFrameSize;
+        const uint32_t mSampleRate;
+        std::atomic<int64_t> mFramesBridged{0};
+        std::atomic<int32_t> mReadErrors{0};
+        std::atomic<int32_t> mWriteErrors{0};
+    };
+
     class Patch {
     public:
         explicit Patch(const struct audio_patch &patch) : mAudioPatch(patch) {}
@@ -182,6 +213,11 @@ private:
         Endpoint<PlaybackThread, PlaybackThread::PatchTrack> mPlayback;
         // connects source device to record thread input
         Endpoint<RecordThread, RecordThread::PatchRecord> mRecord;
+        // replaces the patch record and patch track when the streams match
+        sp<PatchBridge> mBridge;
+
+    private:
+        bool canUseBridge() const;
     };
 
     AudioHwDevice* findAudioHwDeviceByModule(audio_module_handle_t module);
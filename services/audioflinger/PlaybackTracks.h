@@ -186,6 +186,9 @@ protected:
     virtual int64_t framesReleased() const;
     virtual void onTimestamp(const ExtendedTimestamp &timestamp);
 
+    // Direct and offloaded tracks only, called by the playback thread with its mLock held.
+    void setPresentationTimestamp(const AudioTimestamp &timestamp);
+
     bool isPausing() const { return mState == PAUSING; }
     bool isPaused() const { return mState == PAUSED; }
     bool isResuming() const { return mState == RESUMING; }
@@ -209,6 +212,9 @@ protected:
 
     /** Set that a metadata has changed and needs to be notified to backend. Thread safe. */
     void setMetadataHasChanged() { mChangeNotified.clear(); }
+
+    /** Accumulate the processing time of one mix period, see MixerThread::logTrackCpuTime_l(). */
+    void logCpuTime(const AudioMixer::TrackTiming& timing, int64_t effectsNs);
 public:
     void triggerEvents(AudioSystem::sync_event_t type);
     virtual void invalidate();
@@ -264,6 +270,13 @@ protected:
     sp<AudioVibrationController> mAudioVibrationController;
     sp<os::ExternalVibration>    mExternalVibration;
 
+    // Processing time per mix period in microseconds, see logCpuTime().
+    // Written under the thread lock, read by appendDump().
+    audio_utils::Statistics<double> mCpuInputUs{0.995 /* alpha */};
+    audio_utils::Statistics<double> mCpuResampleUs{0.995 /* alpha */};
+    audio_utils::Statistics<double> mCpuMixUs{0.995 /* alpha */};
+    audio_utils::Statistics<double> mCpuEffectsUs{0.995 /* alpha */};
+
 private:
     void                interceptBuffer(const AudioBufferProvider::Buffer& buffer);
     /** Write the source data in the buffer provider. @return written frame count. */
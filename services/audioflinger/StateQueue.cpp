@@ -33,8 +33,21 @@ void StateQueueObserverDump::dump(int fd)
 
 void StateQueueMutatorDump::dump(int fd)
 {
-    dprintf(fd, "State queue mutator: pushDirty=%u pushAck=%u blockedSequence=%u\n",
-            mPushDirty, mPushAck, mBlockedSequence);
+    dprintf(fd, "State queue mutator: pushDirty=%u pushAck=%u blockedSequence=%u"
+            " blockedUs=%u blockedMaxUs=%u\n",
+            mPushDirty, mPushAck, mBlockedSequence, mBlockedUs, mBlockedMaxUs);
+}
+
+static void updateBlockedTime(StateQueueMutatorDump *dump, const struct timespec &start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const unsigned us = (now.tv_sec - start.tv_sec) * 1000000 +
+            (now.tv_nsec - start.tv_nsec) / 1000;
+    dump->mBlockedUs += us;
+    if (us > dump->mBlockedMaxUs) {
+        dump->mBlockedMaxUs = us;
+    }
 }
 #endif
 
@@ -43,7 +56,7 @@ void StateQueueMutatorDump::dump(int fd)
 template<typename T> StateQueue<T>::StateQueue() :
     mAck(NULL), mCurrent(NULL),
     mMutating(&mStates[0]), mExpecting(NULL),
-    mInMutation(false), mIsDirty(false), mIsInitialized(false)
+    mInMutation(false), mIsDirty(false), mIsInitialized(false), mPushSequence(0)
 #ifdef STATE_QUEUE_DUMP
     , mObserverDump(&mObserverDummyDump), mMutatorDump(&mMutatorDummyDump)
 #endif
@@ -115,6 +128,7 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
         if (mExpecting != NULL) {
 #ifdef STATE_QUEUE_DUMP
             unsigned count = 0;
+            struct timespec start = {};
 #endif
             for (;;) {
                 const T *ack = (const T *) mAck;    // no additional barrier needed
@@ -127,7 +141,9 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
                     return false;
                 }
 #ifdef STATE_QUEUE_DUMP
-                if (count == 1) {
+                if (count == 0) {
+                    clock_gettime(CLOCK_MONOTONIC, &start);
+                } else if (count == 1) {
                     mMutatorDump->mBlockedSequence++;
                 }
                 ++count;
@@ -138,12 +154,16 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
             if (count > 1) {
                 mMutatorDump->mBlockedSequence++;
             }
+            if (count > 0) {
+                updateBlockedTime(mMutatorDump, start);
+            }
 #endif
         }
 
         // publish
         atomic_store_explicit(&mNext, (uintptr_t)mMutating, memory_order_release);
         mExpecting = mMutating;
+        ++mPushSequence;
 
         // copy with circular wraparound
         if (++mMutating >= &mStates[kN]) {
@@ -159,6 +179,7 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
         if (mExpecting != NULL) {
 #ifdef STATE_QUEUE_DUMP
             unsigned count = 0;
+            struct timespec start = {};
 #endif
             for (;;) {
                 const T *ack = (const T *) mAck;    // no additional barrier needed
@@ -167,7 +188,9 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
                     break;
                 }
 #ifdef STATE_QUEUE_DUMP
-                if (count == 1) {
+                if (count == 0) {
+                    clock_gettime(CLOCK_MONOTONIC, &start);
+                } else if (count == 1) {
                     mMutatorDump->mBlockedSequence++;
                 }
                 ++count;
@@ -178,6 +201,9 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
             if (count > 1) {
                 mMutatorDump->mBlockedSequence++;
             }
+            if (count > 0) {
+                updateBlockedTime(mMutatorDump, start);
+            }
 #endif
         }
     }
@@ -185,6 +211,18 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
     return true;
 }
 
+template<typename T> bool StateQueue<T>::isAcked(unsigned sequence)
+{
+    ALOG_ASSERT(!mInMutation, "isAcked() called when in a mutation");
+
+    if (mExpecting != NULL && (const T *) mAck == mExpecting) { // no additional barrier needed
+        mExpecting = NULL;
+    }
+    // push() waits for each state to be acknowledged before pushing the next one,
+    // so only the most recent push can still be pending
+    return mExpecting == NULL || (int) (sequence - mPushSequence) < 0;
+}
+
 }   // namespace android
 
 // hack for gcc
@@ -112,13 +112,16 @@ struct StateQueueObserverDump {
 };
 
 struct StateQueueMutatorDump {
-    StateQueueMutatorDump() : mPushDirty(0), mPushAck(0), mBlockedSequence(0) { }
+    StateQueueMutatorDump() : mPushDirty(0), mPushAck(0), mBlockedSequence(0),
+            mBlockedUs(0), mBlockedMaxUs(0) { }
     /*virtual*/ ~StateQueueMutatorDump() { }
     unsigned    mPushDirty;       // incremented each time push() is called with a dirty state
     unsigned    mPushAck;         // incremented each time push(BLOCK_UNTIL_ACKED) is called
     unsigned    mBlockedSequence; // incremented before and after each time that push()
                                   // blocks for more than one PUSH_BLOCK_ACK_NS;
                                   // if odd, then mutator is currently blocked inside push()
+    unsigned    mBlockedUs;       // total time push() waited for an acknowledgement
+    unsigned    mBlockedMaxUs;    // longest single wait of push() for an acknowledgement
     void        dump(int fd);
 };
 #endif
@@ -173,6 +176,17 @@ public:
     // Return whether the current state is dirty (modified and not pushed).
     bool    isDirty() const { return mIsDirty; }
 
+    // Return the sequence number of the most recently pushed state, or 0 if none was pushed.
+    // Sequence numbers increase by one with each state pushed.
+    unsigned pushSequence() const { return mPushSequence; }
+
+    // Return whether the observer has acknowledged the state pushed with the given sequence
+    // number, or a later one.  Never blocks.  This lets the mutator defer work that has to wait
+    // for an acknowledgement, such as releasing resources referenced only by older states,
+    // instead of calling push(BLOCK_UNTIL_ACKED).
+    // Must not be called in the middle of a mutation.
+    bool    isAcked(unsigned sequence);
+
 #ifdef STATE_QUEUE_DUMP
     // Register location of observer dump area
     void    setObserverDump(StateQueueObserverDump *dump)
@@ -200,6 +214,7 @@ private:
     bool              mInMutation;      // whether we're currently in the middle of a mutation
     bool              mIsDirty;         // whether mutating state has been modified since last push
     bool              mIsInitialized;   // whether mutating state has been initialized yet
+    unsigned          mPushSequence;    // sequence number of the most recently pushed state
 
 #ifdef STATE_QUEUE_DUMP
     StateQueueObserverDump  mObserverDummyDump; // default area for observer dump if not set
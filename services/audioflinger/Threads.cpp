@@ -23,11 +23,13 @@
 #include "Configuration.h"
 #include <math.h>
 #include <fcntl.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <linux/futex.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
+#include <unistd.h>
 #include <cutils/properties.h>
 #include <media/AudioParameter.h>
 #include <media/AudioResamplerPublic.h>
@@ -142,6 +144,14 @@ static const uint32_t kMinNormalSinkBufferSizeMs = 20;
 // maximum normal sink buffer size
 static const uint32_t kMaxNormalSinkBufferSizeMs = 24;
 
+// Adaptive normal period ("af.mixer.adaptive_period"): the period grows by one multiple of its
+// initial size, up to kMaxNormalPeriodScale, when a window of writes has enough late writes,
+// and shrinks by one again after writes have been on time for kAdaptivePeriodShrinkDelayNs.
+static const uint32_t kMaxNormalPeriodScale = 4;
+static const uint32_t kAdaptivePeriodWindowWrites = 128;
+static const uint32_t kAdaptivePeriodGrowLateWrites = 4;
+static const nsecs_t kAdaptivePeriodShrinkDelayNs = 30 * NANOS_PER_SECOND;
+
 // minimum capture buffer size in milliseconds to _not_ need a fast capture thread
 // FIXME This should be based on experimentally observed scheduling jitter
 static const uint32_t kMinNormalCaptureBufferSizeMs = 12;
@@ -187,6 +197,12 @@ static const enum {
 static const int kPriorityAudioApp = 2;
 static const int kPriorityFastMixer = 3;
 static const int kPriorityFastCapture = 3;
+static const int kPriorityMixerWorker = 2;  // below FastMixer, which may share the output
+static const int kPriorityEffectWorker = 2; // deferred effect chain processing
+
+// Upper limit of the "af.mixer.resample_workers" property: the number of helper threads
+// a MixerThread may use to resample its tracks in parallel. Zero (the default) disables.
+static const int32_t kMaxMixerResampleWorkers = 4;
 
 // IAudioFlinger::createTrack() has an in/out parameter 'pFrameCount' for the total size of the
 // track buffer in shared memory.  Zero on input means to use a default value.  For fast tracks,
@@ -1723,6 +1739,11 @@ void AudioFlinger::ThreadBase::sendStatistics(bool force)
         item->setDouble(MM_PREFIX "latencyMs.mean", mLatencyMs.getMean());
         item->setDouble(MM_PREFIX "latencyMs.std", mLatencyMs.getStdDev());
     }
+    if (mTrackCpuUs.getN() > 0) {
+        item->setDouble(MM_PREFIX "trackCpuUs.mean", mTrackCpuUs.getMean());
+        item->setDouble(MM_PREFIX "trackCpuUs.std", mTrackCpuUs.getStdDev());
+        item->setDouble(MM_PREFIX "trackCpuUs.max", mTrackCpuUs.getMax());
+    }
 
     item->selfrecord();
 }
@@ -1939,7 +1960,8 @@ void AudioFlinger::PlaybackThread::dumpInternals_l(int fd, const Vector<String16
     }
 }
 
-// PlaybackThread::createTrack_l() must be called with AudioFlinger::mLock held
+// PlaybackThread::createTrack_l() is called without AudioFlinger::mLock held. It takes the
+// thread mLock while accessing the thread state. The caller holds a strong reference on the thread.
 sp<AudioFlinger::PlaybackThread::Track> AudioFlinger::PlaybackThread::createTrack_l(
         const sp<AudioFlinger::Client>& client,
         audio_stream_type_t streamType,
@@ -2243,7 +2265,7 @@ sp<AudioFlinger::PlaybackThread::Track> AudioFlinger::PlaybackThread::createTrac
         lStatus = track != 0 ? track->initCheck() : (status_t) NO_MEMORY;
         if (lStatus != NO_ERROR) {
             ALOGE("createTrack_l() initCheck failed %d; no control block?", lStatus);
-            // track must be cleared from the caller as the caller has the AF lock
+            // track must be cleared from the caller, see AudioFlinger::createTrack()
             goto Exit;
         }
         mTracks.add(track);
@@ -2292,6 +2314,28 @@ uint32_t AudioFlinger::PlaybackThread::correctLatency_l(uint32_t latency) const
     return latency;
 }
 
+void AudioFlinger::PlaybackThread::updateAdaptivePeriod(double jitterMs, nsecs_t nowNs)
+{
+    // A write later than a whole period has most likely let the HAL buffer run dry.
+    if (jitterMs > mNormalFrameCount * 1000. / mSampleRate) {
+        mAdaptiveLateWrites++;
+        mLastLateWriteNs = nowNs;
+    }
+    if (++mAdaptiveWrites >= kAdaptivePeriodWindowWrites) {
+        if (mAdaptiveLateWrites >= kAdaptivePeriodGrowLateWrites
+                && mNormalPeriodScale < kMaxNormalPeriodScale) {
+            mRequestedNormalPeriodScale = mNormalPeriodScale + 1;
+        }
+        mAdaptiveWrites = 0;
+        mAdaptiveLateWrites = 0;
+    }
+    if (mNormalPeriodScale > 1 && mRequestedNormalPeriodScale == mNormalPeriodScale
+            && nowNs - std::max(mLastLateWriteNs, mLastPeriodChangeNs)
+                    > kAdaptivePeriodShrinkDelayNs) {
+        mRequestedNormalPeriodScale = mNormalPeriodScale - 1;
+    }
+}
+
 uint32_t AudioFlinger::PlaybackThread::latency() const
 {
     Mutex::Autolock _l(mLock);
@@ -2680,7 +2724,7 @@ void AudioFlinger::PlaybackThread::readOutputParameters_l()
             multiplier = floor(multiplier);
         }
     }
-    mNormalFrameCount = multiplier * mFrameCount;
+    mNormalFrameCount = multiplier * mFrameCount * mNormalPeriodScale;
     // round up to nearest 16 frames to satisfy AudioMixer
     if (mType == MIXER || mType == DUPLICATING) {
         mNormalFrameCount = (mNormalFrameCount + 15) & ~15;
@@ -2819,6 +2863,18 @@ AudioStreamOut* AudioFlinger::PlaybackThread::getOutput() const
     return mOutput;
 }
 
+AudioStreamOut* AudioFlinger::PlaybackThread::standbyForBridge()
+{
+    Mutex::Autolock _l(mLock);
+    ALOGW_IF(!mTracks.isEmpty(), "%s() thread %p has tracks", __func__, this);
+    // the thread loop only puts the output in standby when it is not already.
+    if (!mStandby) {
+        threadLoop_standby();
+        mStandby = true;
+    }
+    return mOutput;
+}
+
 AudioStreamOut* AudioFlinger::PlaybackThread::clearOutput()
 {
     Mutex::Autolock _l(mLock);
@@ -3112,8 +3168,16 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
         }
     }
     chain->setThread(this);
+    // Deferring trades one period of latency for taking the effects off the critical path.
+    // Haptic data is copied past the chain audio undelayed, so such outputs are excluded.
+    chain->setDeferredProcessing(mType == MIXER && mHapticChannelCount == 0
+            && property_get_bool("af.effect.deferred_chains", false /* default_value */));
     chain->setInBuffer(halInBuffer);
     chain->setOutBuffer(halOutBuffer);
+    const pid_t deferredTid = chain->deferredProcessingTid();
+    if (deferredTid > 0) {
+        sendPrioConfigEvent_l(getpid(), deferredTid, kPriorityEffectWorker, false /*forApp*/);
+    }
     // Effect chain for session AUDIO_SESSION_OUTPUT_STAGE is inserted at end of effect
     // chains list in order to be processed last as it contains output stage effects.
     // Effect chain for session AUDIO_SESSION_OUTPUT_MIX is inserted before
@@ -3275,6 +3339,19 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
         cpuStats.sample(myName);
 
+        // Changing the period moves the effect chains, which needs the AudioFlinger lock
+        // before mLock. As below, do not block on it, but retry on the next loop.
+        if (mRequestedNormalPeriodScale != mNormalPeriodScale && mBytesRemaining == 0
+                && mAudioFlinger->mLock.tryLock() == NO_ERROR) {
+            {
+                Mutex::Autolock _l(mLock);
+                if (!applyNormalPeriodScale_l()) {
+                    mRequestedNormalPeriodScale = mNormalPeriodScale;
+                }
+            }
+            mAudioFlinger->mLock.unlock();
+        }
+
         Vector< sp<EffectChain> > effectChains;
         audio_session_t activeHapticSessionId = AUDIO_SESSION_NONE;
         std::vector<sp<Track>> activeTracks;
@@ -3452,6 +3529,19 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                 }
             }
 
+            // Direct and offloaded tracks have no server or kernel location in the
+            // ExtendedTimestamp, so publish the presentation position to their control block
+            // for the client to read instead of calling IAudioTrack::getTimestamp().
+            if ((mType == DIRECT || mType == OFFLOAD)
+                    && !mStandby && !mActiveTracks.isEmpty()) {
+                AudioTimestamp presentation;
+                if (getTimestamp_l(presentation) == NO_ERROR) {
+                    for (const sp<Track> &t : mActiveTracks) {
+                        t->setPresentationTimestamp(presentation);
+                    }
+                }
+            }
+
             } // if (mType ... ) { // no indentation
 #if 0
             // logFormat example
@@ -3650,7 +3740,12 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             // only process effects if we're going to write
             if (mSleepTimeUs == 0 && mType != OFFLOAD) {
                 for (size_t i = 0; i < effectChains.size(); i ++) {
+                    const int64_t chainBeginNs = mTimeEffectChains ? systemTime() : 0;
                     effectChains[i]->process_l();
+                    if (mTimeEffectChains) {
+                        mEffectChainNs.emplace_back(
+                                effectChains[i]->sessionId(), systemTime() - chainBeginNs);
+                    }
                     // TODO: Write haptic data directly to sink buffer when mixing.
                     if (activeHapticSessionId != AUDIO_SESSION_NONE
                             && activeHapticSessionId == effectChains[i]->sessionId()) {
@@ -3748,6 +3843,9 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                                 Mutex::Autolock _l(mLock);
                                 mIoJitterMs.add(jitterMs);
                                 mProcessTimeMs.add(processMs);
+                                if (mAdaptivePeriod) {
+                                    updateAdaptivePeriod(jitterMs, lastIoEndNs);
+                                }
                             }
 
                             // write blocked detection
@@ -4110,6 +4208,7 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
         // mAudioMixer below
         // mFastMixer below
         mFastMixerFutex(0),
+        mFastTracksPendingSequence(0),
         mMasterMono(false)
         // mOutputSink below
         // mPipeSink below
@@ -4122,6 +4221,14 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
             mSampleRate, mChannelMask, mChannelCount, mFormat, mFrameSize, mFrameCount,
             mNormalFrameCount);
     mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+    {
+        Mutex::Autolock _l(mLock);
+        configureResamplerWorkers_l();
+    }
+    if (property_get_bool("af.mixer.track_cpu_stats", false /* default_value */)) {
+        mAudioMixer->setTrackTimingEnabled(true);
+        mTimeEffectChains = true;
+    }
 
     if (type == DUPLICATING) {
         // The Duplicating thread uses the AudioMixer and delivers data to OutputTracks
@@ -4283,6 +4390,98 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
         mNormalSink = initFastMixer ? mPipeSink : mOutputSink;
         break;
     }
+
+    // Only without a FastMixer, whose MonoPipe is sized from the initial period,
+    // is the normal sink the HAL stream itself, so that the period can be changed.
+    mAdaptivePeriod = type == MIXER && mFastMixer == 0 && !mUseAsyncWrite
+            && property_get_bool("af.mixer.adaptive_period", false /* default_value */);
+}
+
+// Replaces mAudioMixer after mNormalFrameCount or the sink configuration has changed.
+// Track parameters are set again by the next prepareTracks_l().
+void AudioFlinger::MixerThread::recreateAudioMixer_l()
+{
+    delete mAudioMixer;
+    mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+    configureResamplerWorkers_l();
+    mAudioMixer->setTrackTimingEnabled(mTimeEffectChains);
+    for (const auto &track : mTracks) {
+        const int trackId = track->id();
+        status_t status = mAudioMixer->create(
+                trackId,
+                track->mChannelMask,
+                track->mFormat,
+                track->mSessionId);
+        ALOGW_IF(status != NO_ERROR,
+                "%s(): AudioMixer cannot create track(%d)"
+                " mask %#x, format %#x, sessionId %d",
+                __func__,
+                trackId, track->mChannelMask, track->mFormat, track->mSessionId);
+    }
+}
+
+bool AudioFlinger::MixerThread::applyNormalPeriodScale_l()
+{
+    const uint32_t scale = mRequestedNormalPeriodScale;
+    const size_t normalFrameCount = mNormalFrameCount / mNormalPeriodScale * scale;
+    if (scale > mNormalPeriodScale) {
+        // A track buffer must still hold two periods, or the track would never be ready.
+        for (const sp<Track> &track : mActiveTracks) {
+            if (uint64_t{track->frameCount()} * mSampleRate
+                    < uint64_t{normalFrameCount} * 2 * track->sampleRate()) {
+                ALOGV("%s: track %d buffer too small for %zu frames",
+                        __func__, track->id(), normalFrameCount);
+                return false;
+            }
+        }
+    }
+    ALOGI("%s: normal sink buffer size %zu -> %zu frames",
+            __func__, mNormalFrameCount, normalFrameCount);
+    mLocalLog.log("%s: normal period scale %u -> %u", __func__, mNormalPeriodScale, scale);
+    mNormalPeriodScale = scale;
+    mLastPeriodChangeNs = systemTime();
+    readOutputParameters_l();
+    recreateAudioMixer_l();
+    cacheParameters_l();
+    // updates the output latency and frame count cached by clients, see correctLatency_l().
+    sendIoConfigEvent_l(AUDIO_OUTPUT_CONFIG_CHANGED);
+    return true;
+}
+
+// Attributes the processing time of the previous mix period to the track, including the
+// effect chain of its session, which is shared with the other tracks of that session.
+void AudioFlinger::MixerThread::logTrackCpuTime_l(const sp<Track>& track)
+{
+    const AudioMixer::TrackTiming timing = mAudioMixer->consumeTrackTiming(track->id());
+    int64_t effectsNs = 0;
+    for (const auto &chainNs : mEffectChainNs) {
+        if (chainNs.first == track->sessionId()) {
+            effectsNs += chainNs.second;
+        }
+    }
+    const int64_t totalNs = timing.mInputNs + timing.mResampleNs + timing.mMixNs + effectsNs;
+    if (totalNs == 0) {
+        return; // not mixed, e.g. just created or not ready.
+    }
+    track->logCpuTime(timing, effectsNs);
+    mTrackCpuUs.add(totalNs * 1e-3);
+}
+
+// Optionally lets mAudioMixer resample tracks on helper threads, which run SCHED_FIFO
+// so that they are not preempted by CFS threads within a mix period.
+void AudioFlinger::MixerThread::configureResamplerWorkers_l()
+{
+    const int32_t workers = std::min(std::max(
+            property_get_int32("af.mixer.resample_workers", 0 /* default_value */), 0),
+            std::min(kMaxMixerResampleWorkers, (int32_t)sysconf(_SC_NPROCESSORS_ONLN) - 1));
+    if (workers <= 0) {
+        return;
+    }
+    mAudioMixer->setResamplerWorkerCount(workers);
+    for (const pid_t tid : mAudioMixer->getResamplerWorkerTids()) {
+        sendPrioConfigEvent_l(getpid(), tid, kPriorityMixerWorker, false /*forApp*/);
+    }
+    ALOGI("%s: %d resampler workers for thread %d", __func__, workers, mId);
 }
 
 AudioFlinger::MixerThread::~MixerThread()
@@ -4329,6 +4528,11 @@ uint32_t AudioFlinger::MixerThread::correctLatency_l(uint32_t latency) const
         MonoPipe *pipe = (MonoPipe *)mPipeSink.get();
         latency += (pipe->getAvgFrames() * 1000) / mSampleRate;
     }
+    if (mNormalPeriodScale > 1) {
+        // the HAL buffer was sized for the initial period, the remainder waits in the sink buffer.
+        latency += ((mNormalFrameCount - mNormalFrameCount / mNormalPeriodScale) * 1000)
+                / mSampleRate;
+    }
     return latency;
 }
 
@@ -4375,6 +4579,34 @@ ssize_t AudioFlinger::MixerThread::threadLoop_write()
     return PlaybackThread::threadLoop_write();
 }
 
+void AudioFlinger::MixerThread::threadLoop_removeTracks(
+        const Vector< sp<Track> >& tracksToRemove)
+{
+    PlaybackThread::threadLoop_removeTracks(tracksToRemove);
+    // The fast mixer no longer refers to these tracks; let go of them without the lock held,
+    // as for the removed tracks.
+    mFastTracksAcked.clear();
+}
+
+// Called at the start of each mix cycle, before mutating the fast mixer state.
+void AudioFlinger::MixerThread::releaseAckedFastTracks_l(FastMixerStateQueue *sq)
+{
+    if ((mFastTracksPendingAck.isEmpty() && mFastTracksPendingReset.isEmpty())
+            || !sq->isAcked(mFastTracksPendingSequence)) {
+        return;
+    }
+    for (const sp<Track> &track : mFastTracksPendingReset) {
+        // unless it was restarted in the meantime
+        if (track->isStopped()) {
+            track->reset();
+        }
+    }
+    mFastTracksAcked.appendVector(mFastTracksPendingAck);
+    mFastTracksAcked.appendVector(mFastTracksPendingReset);
+    mFastTracksPendingAck.clear();
+    mFastTracksPendingReset.clear();
+}
+
 void AudioFlinger::MixerThread::threadLoop_standby()
 {
     // Idle the fast mixer if it's currently running
@@ -4569,8 +4801,10 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
     bool didModify = false;
     FastMixerStateQueue::block_t block = FastMixerStateQueue::BLOCK_UNTIL_PUSHED;
     bool coldIdle = false;
+    Vector< sp<Track> > removedFastTracks;
     if (mFastMixer != 0) {
         sq = mFastMixer->sq();
+        releaseAckedFastTracks_l(sq);
         state = sq->begin();
         coldIdle = state->mCommand == FastMixerState::COLD_IDLE;
     }
@@ -4783,9 +5017,10 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                     fastTrack->mGeneration++;
                     state->mTrackMask &= ~(1 << j);
                     didModify = true;
-                    // If any fast tracks were removed, we must wait for acknowledgement
-                    // because we're about to decrement the last sp<> on those tracks.
-                    block = FastMixerStateQueue::BLOCK_UNTIL_ACKED;
+                    // If any fast tracks were removed, the fast mixer may still refer to them
+                    // until it acknowledges the new state, so keep them until then
+                    // rather than wait here for the acknowledgement.
+                    removedFastTracks.add(t);
                 } else {
                     // ALOGW rather than LOG_ALWAYS_FATAL because it seems there are cases where an
                     // AudioTrack may start (which may not be with a start() but with a write()
@@ -4817,6 +5052,10 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         // for all its buffers to be filled before processing it
         const int trackId = track->id();
 
+        if (mAudioMixer->isTrackTimingEnabled()) {
+            logTrackCpuTime_l(track);
+        }
+
         // if an active track doesn't exist in the AudioMixer, create it.
         // use the trackId as the AudioMixer name.
         if (!mAudioMixer->exists(trackId)) {
@@ -5154,6 +5393,7 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         }   // local variable scope to avoid goto warning
 
     }
+    mEffectChainNs.clear(); // attributed to the tracks above, if timed.
 
     if (mHapticChannelMask != AUDIO_CHANNEL_NONE && sq != NULL) {
         // When there is no fast track playing haptic and FastMixer exists,
@@ -5198,6 +5438,15 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         // active tracks, which may be added or removed.
         sq->push(coldIdle ? FastMixerStateQueue::BLOCK_NEVER : block);
     }
+    // Unless the push was acknowledged already, or the fast mixer is not running,
+    // release the removed fast tracks and reset the stopped ones in a later cycle,
+    // once the fast mixer has acknowledged this state.
+    const bool deferToAck = !removedFastTracks.isEmpty() && !coldIdle
+            && block != FastMixerStateQueue::BLOCK_UNTIL_ACKED;
+    if (deferToAck) {
+        mFastTracksPendingAck.appendVector(removedFastTracks);
+        mFastTracksPendingSequence = sq->pushSequence();
+    }
 #ifdef AUDIO_WATCHDOG
     if (pauseAudioWatchdog && mAudioWatchdog != 0) {
         mAudioWatchdog->pause();
@@ -5211,7 +5460,11 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         resetMask &= ~(1 << i);
         sp<Track> track = mActiveTracks[i];
         ALOG_ASSERT(track->isFastTrack() && track->isStopped());
-        track->reset();
+        if (deferToAck) {
+            mFastTracksPendingReset.add(track);
+        } else {
+            track->reset();
+        }
     }
 
     // Track destruction may occur outside of threadLoop once it is removed from active tracks.
@@ -5388,21 +5641,7 @@ bool AudioFlinger::MixerThread::checkForNewParameter_l(const String8& keyValuePa
         }
         if (status == NO_ERROR && reconfig) {
             readOutputParameters_l();
-            delete mAudioMixer;
-            mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
-            for (const auto &track : mTracks) {
-                const int trackId = track->id();
-                status_t status = mAudioMixer->create(
-                        trackId,
-                        track->mChannelMask,
-                        track->mFormat,
-                        track->mSessionId);
-                ALOGW_IF(status != NO_ERROR,
-                        "%s(): AudioMixer cannot create track(%d)"
-                        " mask %#x, format %#x, sessionId %d",
-                        __func__,
-                        trackId, track->mChannelMask, track->mFormat, track->mSessionId);
-            }
+            recreateAudioMixer_l();
             sendIoConfigEvent_l(AUDIO_OUTPUT_CONFIG_CHANGED);
         }
     }
@@ -5417,6 +5656,10 @@ void AudioFlinger::MixerThread::dumpInternals_l(int fd, const Vector<String16>&
     dprintf(fd, "  Thread throttle time (msecs): %u\n", mThreadThrottleTimeMs);
     dprintf(fd, "  AudioMixer tracks: %s\n", mAudioMixer->trackNames().c_str());
     dprintf(fd, "  Master mono: %s\n", mMasterMono ? "on" : "off");
+    if (mAdaptivePeriod) {
+        dprintf(fd, "  Adaptive period scale: %u (requested %u)\n",
+                mNormalPeriodScale, mRequestedNormalPeriodScale);
+    }
     dprintf(fd, "  Master balance: %f (%s)\n", mMasterBalance.load(),
             (hasFastMixer() ? std::to_string(mFastMixer->getMasterBalance())
                             : mBalance.toString()).c_str());
@@ -6783,6 +7026,11 @@ AudioFlinger::RecordThread::RecordThread(const sp<AudioFlinger>& audioFlinger,
         sq->end();
         sq->push(FastCaptureStateQueue::BLOCK_UNTIL_PUSHED);
 
+        NBLog::thread_info_t info;
+        info.id = mId;
+        info.type = NBLog::FASTCAPTURE;
+        mFastCaptureNBLogWriter->log<NBLog::EVENT_THREAD_INFO>(info);
+
         // start the fast capture
         mFastCapture->run("FastCapture", ANDROID_PRIORITY_URGENT_AUDIO);
         pid_t tid = mFastCapture->getTid();
@@ -7052,6 +7300,8 @@ reacquire_wakelock:
         // now run the fast track destructor with thread mutex unlocked
         fastTrackToRemove.clear();
 
+        updateSharedConversions(activeTracks);
+
         // Read from HAL to keep up with fastest client if multiple active tracks, not slowest one.
         // Only the client(s) that are too slow will overrun. But if even the fastest client is too
         // slow, then this RecordThread will overrun by not calling HAL read often enough.
@@ -7194,6 +7444,10 @@ reacquire_wakelock:
         }
         rear = mRsmpInRear += framesRead;
 
+        for (const auto &conversion : mSharedConversions) {
+            conversion->convert();
+        }
+
         size = activeTracks.size();
 
         // loop over each active track
@@ -7214,6 +7468,8 @@ reacquire_wakelock:
                 OVERRUN_FALSE
             } overrun = OVERRUN_UNKNOWN;
 
+            SharedConversion *sharedConversion = findSharedConversion(activeTrack.get());
+
             // loop over getNextBuffer to handle circular sink
             for (;;) {
 
@@ -7226,7 +7482,12 @@ reacquire_wakelock:
                 // if the record track isn't draining fast enough.
                 bool hasOverrun;
                 size_t framesIn;
-                activeTrack->mResamplerBufferProvider->sync(&framesIn, &hasOverrun);
+                if (sharedConversion != NULL) {
+                    // already converted, so in frames of the track
+                    framesIn = sharedConversion->framesAvailable(activeTrack.get(), &hasOverrun);
+                } else {
+                    activeTrack->mResamplerBufferProvider->sync(&framesIn, &hasOverrun);
+                }
                 if (hasOverrun) {
                     overrun = OVERRUN_TRUE;
                 }
@@ -7238,11 +7499,14 @@ reacquire_wakelock:
                 // from framesIn.
                 // This isn't strictly necessary but helps limit buffer resizing in
                 // RecordBufferConverter.  TODO: remove when no longer needed.
-                framesOut = min(framesOut,
+                framesOut = min(framesOut, sharedConversion != NULL ? framesIn :
                         destinationFramesPossible(
                                 framesIn, mSampleRate, activeTrack->mSampleRate));
 
-                if (activeTrack->isDirect()) {
+                if (sharedConversion != NULL) {
+                    framesOut = sharedConversion->read(
+                            activeTrack.get(), activeTrack->mSink.raw, framesOut);
+                } else if (activeTrack->isDirect()) {
                     // No RecordBufferConverter used for direct streams. Pass
                     // straight from RecordThread buffer to RecordTrack buffer.
                     AudioBufferProvider::Buffer buffer;
@@ -7921,9 +8185,18 @@ void AudioFlinger::RecordThread::setRecordSilenced(uid_t uid, bool silenced)
     }
 }
 
+sp<AudioFlinger::ThreadBase>
+AudioFlinger::RecordThread::ResamplerBufferProvider::getThread() const
+{
+    if (mRecordTrack == NULL) {
+        return mRecordThread;
+    }
+    return mRecordTrack->mThread.promote();
+}
+
 void AudioFlinger::RecordThread::ResamplerBufferProvider::reset()
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     RecordThread *recordThread = (RecordThread *) threadBase.get();
     mRsmpInFront = recordThread->mRsmpInRear;
     mRsmpInUnrel = 0;
@@ -7932,7 +8205,7 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::reset()
 void AudioFlinger::RecordThread::ResamplerBufferProvider::sync(
         size_t *framesAvailable, bool *hasOverrun)
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     RecordThread *recordThread = (RecordThread *) threadBase.get();
     const int32_t rear = recordThread->mRsmpInRear;
     const int32_t front = mRsmpInFront;
@@ -7966,7 +8239,7 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::sync(
 status_t AudioFlinger::RecordThread::ResamplerBufferProvider::getNextBuffer(
         AudioBufferProvider::Buffer* buffer)
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     if (threadBase == 0) {
         buffer->frameCount = 0;
         buffer->raw = NULL;
@@ -8019,6 +8292,170 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::releaseBuffer(
     buffer->frameCount = 0;
 }
 
+AudioFlinger::RecordThread::SharedConversion::SharedConversion(
+        RecordThread *thread, const RecordTrack *track)
+    : mSampleRate(track->mSampleRate),
+      mFormat(track->format()),
+      mChannelMask(track->mChannelMask),
+      mSrcSampleRate(thread->mSampleRate),
+      mFrameSize(audio_bytes_per_frame(
+              audio_channel_count_from_in_mask(mChannelMask), mFormat)),
+      mConverter(thread->mChannelMask, thread->mFormat, thread->mSampleRate,
+              mChannelMask, mFormat, mSampleRate),
+      mProvider(thread),
+      // as much as the input buffer holds, which bounds the lag of unshared tracks too
+      mFrames(destinationFramesPossible(thread->mRsmpInFrames, mSrcSampleRate, mSampleRate)),
+      mBuffer(mFrames * mFrameSize),
+      mRear(0)
+{
+    mProvider.reset();
+}
+
+AudioFlinger::RecordThread::SharedConversion::~SharedConversion()
+{
+}
+
+void AudioFlinger::RecordThread::SharedConversion::convert()
+{
+    size_t framesIn;
+    mProvider.sync(&framesIn);
+    while (framesIn > 0) {
+        const size_t offset = mRear % mFrames;
+        const size_t frames = min(mFrames - offset,
+                destinationFramesPossible(framesIn, mSrcSampleRate, mSampleRate));
+        if (frames == 0) {
+            break;
+        }
+        const size_t framesOut = mConverter.convert(
+                mBuffer.data() + offset * mFrameSize, &mProvider, frames);
+        if (framesOut == 0) {
+            break;
+        }
+        mRear += framesOut;
+        mProvider.sync(&framesIn);
+    }
+}
+
+size_t AudioFlinger::RecordThread::SharedConversion::framesAvailable(
+        const RecordTrack *track, bool *hasOverrun)
+{
+    int64_t &front = mFronts[track];
+    *hasOverrun = false;
+    if (mRear - front > (int64_t)mFrames) {
+        // the track is not keeping up, but give it the latest data
+        front = mRear - mFrames;
+        *hasOverrun = true;
+    }
+    return mRear - front;
+}
+
+size_t AudioFlinger::RecordThread::SharedConversion::read(
+        const RecordTrack *track, void *dst, size_t frames)
+{
+    int64_t &front = mFronts[track];
+    frames = min(frames, (size_t)(mRear - front));
+    const size_t offset = front % mFrames;
+    const size_t part1 = min(frames, mFrames - offset);
+    memcpy(dst, mBuffer.data() + offset * mFrameSize, part1 * mFrameSize);
+    if (frames > part1) {
+        memcpy((uint8_t *)dst + part1 * mFrameSize, mBuffer.data(),
+                (frames - part1) * mFrameSize);
+    }
+    front += frames;
+    return frames;
+}
+
+void AudioFlinger::RecordThread::updateSharedConversions(
+        const Vector< sp<RecordTrack> > &activeTracks)
+{
+    // tracks converted by their own RecordBufferConverter, grouped by configuration
+    std::vector<std::vector<RecordTrack *>> groups;
+    for (size_t i = 0; i < activeTracks.size(); i++) {
+        RecordTrack *track = activeTracks[i].get();
+        if (track->isFastTrack() || track->isDirect() || track->mRecordBufferConverter == NULL) {
+            continue;
+        }
+        auto group = groups.begin();
+        while (group != groups.end() && !(
+                group->front()->mSampleRate == track->mSampleRate
+                && group->front()->format() == track->format()
+                && group->front()->mChannelMask == track->mChannelMask)) {
+            ++group;
+        }
+        if (group == groups.end()) {
+            groups.push_back({ track });
+        } else {
+            group->push_back(track);
+        }
+    }
+
+    for (auto it = mSharedConversions.begin(); it != mSharedConversions.end(); ) {
+        SharedConversion *conversion = it->get();
+        auto group = groups.begin();
+        while (group != groups.end() && !conversion->matches(group->front())) {
+            ++group;
+        }
+        // the input configuration is not updated on reconfiguration, as for tracks
+        const bool keep = group != groups.end() && group->size() > 1
+                && conversion->mSrcSampleRate == mSampleRate;
+        for (auto front = conversion->mFronts.begin(); front != conversion->mFronts.end(); ) {
+            const bool inGroup = keep && std::find(group->begin(), group->end(),
+                    front->first) != group->end();
+            if (inGroup) {
+                ++front;
+                continue;
+            }
+            // a track leaving the group resumes its own conversion at the current input
+            for (size_t i = 0; i < activeTracks.size(); i++) {
+                if (activeTracks[i].get() == front->first) {
+                    activeTracks[i]->mResamplerBufferProvider->reset();
+                    activeTracks[i]->mRecordBufferConverter->reset();
+                    break;
+                }
+            }
+            front = conversion->mFronts.erase(front);
+        }
+        if (keep) {
+            ++it;
+        } else {
+            it = mSharedConversions.erase(it);
+        }
+    }
+
+    for (const auto &group : groups) {
+        if (group.size() < 2) {
+            continue;
+        }
+        SharedConversion *conversion = findSharedConversion(group.front());
+        if (conversion == NULL) {
+            conversion = new SharedConversion(this, group.front());
+            if (conversion->mConverter.initCheck() != NO_ERROR || conversion->mFrames == 0) {
+                delete conversion;
+                continue;
+            }
+            mSharedConversions.emplace_back(conversion);
+            ALOGV("%s() sharing conversion to %u Hz format %#x mask %#x for %zu tracks",
+                    __func__, conversion->mSampleRate, conversion->mFormat,
+                    conversion->mChannelMask, group.size());
+        }
+        for (RecordTrack *track : group) {
+            // a joining track starts with the input read next
+            conversion->mFronts.emplace(track, conversion->mRear);
+        }
+    }
+}
+
+AudioFlinger::RecordThread::SharedConversion *
+AudioFlinger::RecordThread::findSharedConversion(const RecordTrack *track) const
+{
+    for (const auto &conversion : mSharedConversions) {
+        if (conversion->mFronts.count(track) != 0) {
+            return conversion.get();
+        }
+    }
+    return NULL;
+}
+
 void AudioFlinger::RecordThread::checkBtNrec()
 {
     Mutex::Autolock _l(mLock);
@@ -8269,6 +8706,14 @@ KeyedVector<audio_session_t, bool> AudioFlinger::RecordThread::sessionIds() cons
     return ids;
 }
 
+AudioFlinger::AudioStreamIn* AudioFlinger::RecordThread::standbyForBridge()
+{
+    Mutex::Autolock _l(mLock);
+    ALOGW_IF(!mTracks.isEmpty(), "%s() thread %p has tracks", __func__, this);
+    standbyIfNotAlreadyInStandby();
+    return mInput;
+}
+
 AudioFlinger::AudioStreamIn* AudioFlinger::RecordThread::clearInput()
 {
     Mutex::Autolock _l(mLock);
@@ -8470,7 +8915,8 @@ AudioFlinger::MmapThread::MmapThread(
       mHalStream(stream), mHalDevice(hwDev->hwDevice()), mAudioHwDev(hwDev),
       mActiveTracks(&this->mLocalLog),
       mHalVolFloat(-1.0f), // Initialize to illegal value so it always gets set properly later.
-      mNoCallbackWarningCount(0)
+      mNoCallbackWarningCount(0),
+      mHealthSampling(false)
 {
     mStandby = true;
     readHalParameters_l();
@@ -8540,6 +8986,24 @@ status_t AudioFlinger::MmapThread::getMmapPosition(struct audio_mmap_position *p
     return mHalStream->getMmapPosition(position);
 }
 
+void AudioFlinger::MmapThread::sampleHealth_l()
+{
+    struct audio_mmap_position position;
+    if (mHalStream->getMmapPosition(&position) != NO_ERROR) {
+        return;
+    }
+    if (!mHealthSampling) {
+        // the stream may have been stopped and restarted since the last sample
+        mHealthSampling = true;
+        mHealth.discontinuity();
+    }
+    mHealth.addSample(position.position_frames, position.time_nanoseconds, mSampleRate);
+    for (const sp<MmapTrack> &track : mActiveTracks) {
+        track->mHealth.addSample(
+                position.position_frames, position.time_nanoseconds, mSampleRate);
+    }
+}
+
 status_t AudioFlinger::MmapThread::exitStandby()
 {
     status_t ret = mHalStream->start();
@@ -8701,7 +9165,23 @@ status_t AudioFlinger::MmapThread::stop(audio_port_handle_t handle)
 
     mActiveTracks.remove(track);
 
+    // report the health of the stream while this client was active
+    std::unique_ptr<MediaAnalyticsItem> item;
+    if (track->mHealth.samples() > 0) {
+#define MMAP_PREFIX "android.media.audiommap." // avoid cut-n-paste errors.
+        item.reset(MediaAnalyticsItem::create("audiommap"));
+        item->setInt32(MMAP_PREFIX "id", (int32_t)mId);
+        item->setInt32(MMAP_PREFIX "portId", (int32_t)track->portId());
+        item->setCString(MMAP_PREFIX "direction", isOutput() ? "output" : "input");
+        item->setInt32(MMAP_PREFIX "sampleRate", (int32_t)mSampleRate);
+        track->mHealth.addToItem(item.get(), MMAP_PREFIX);
+#undef MMAP_PREFIX
+    }
+
     mLock.unlock();
+    if (item != nullptr) {
+        item->selfrecord();
+    }
     if (isOutput()) {
         AudioSystem::stopOutput(track->portId());
         AudioSystem::releaseOutput(track->portId());
@@ -8777,10 +9257,17 @@ bool AudioFlinger::MmapThread::threadLoop()
                     break;
                 }
 
-                // wait until we have something to do...
-                ALOGV("%s going to sleep", myName.string());
-                mWaitWorkCV.wait(mLock);
-                ALOGV("%s waking up", myName.string());
+                if (mActiveTracks.isEmpty() || mStandby) {
+                    // wait until we have something to do...
+                    mHealthSampling = false;
+                    ALOGV("%s going to sleep", myName.string());
+                    mWaitWorkCV.wait(mLock);
+                    ALOGV("%s waking up", myName.string());
+                } else {
+                    // wake up regularly to sample the position while clients are active
+                    mWaitWorkCV.waitRelative(mLock, kHealthSamplePeriodNs);
+                    sampleHealth_l();
+                }
 
                 checkSilentMode_l();
 
@@ -9140,6 +9627,7 @@ void AudioFlinger::MmapThread::dumpInternals_l(int fd, const Vector<String16>& a
     dprintf(fd, "  Attributes: content type %d usage %d source %d\n",
             mAttr.content_type, mAttr.usage, mAttr.source);
     dprintf(fd, "  Session: %d port Id: %d\n", mSessionId, mPortId);
+    dprintf(fd, "  Health: %s\n", mHealth.toString().string());
     if (mActiveTracks.isEmpty()) {
         dprintf(fd, "  No active clients\n");
     }
@@ -9158,6 +9646,7 @@ void AudioFlinger::MmapThread::dumpTracks_l(int fd, const Vector<String16>& args
             sp<MmapTrack> track = mActiveTracks[i];
             result.append(prefix);
             track->appendDump(result, true /* active */);
+            result.appendFormat("%s  health: %s\n", prefix, track->mHealth.toString().string());
         }
     } else {
         dprintf(fd, "\n");
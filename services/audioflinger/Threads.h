@@ -554,6 +554,8 @@ protected:
                 audio_utils::Statistics<double> mIoJitterMs{0.995 /* alpha */};
                 audio_utils::Statistics<double> mProcessTimeMs{0.995 /* alpha */};
                 audio_utils::Statistics<double> mLatencyMs{0.995 /* alpha */};
+                // Per track and mix period, only collected if af.mixer.track_cpu_stats is set.
+                audio_utils::Statistics<double> mTrackCpuUs{0.995 /* alpha */};
 
                 // Save the last count when we delivered statistics to mediametrics.
                 int64_t                 mLastRecordedTimestampVerifierN = 0;
@@ -816,6 +818,9 @@ public:
                 AudioStreamOut* getOutput() const;
                 AudioStreamOut* clearOutput();
                 virtual sp<StreamHalInterface> stream() const;
+                // Puts the output in standby for good and returns it, so that a software patch
+                // bridge can write to it directly. The thread must have no tracks.
+                AudioStreamOut* standbyForBridge();
 
                 // a very large number of suspend() will eventually wraparound, but unlikely
                 void        suspend() { (void) android_atomic_inc(&mSuspended); }
@@ -898,6 +903,10 @@ protected:
     uint32_t                        mThreadThrottleEndMs;  // notify once per throttling
     uint32_t                        mHalfBufferMs;       // half the buffer size in milliseconds
 
+    // mNormalFrameCount in multiples of the period derived from the HAL buffer size,
+    // greater than 1 only while grown by the adaptive period, see updateAdaptivePeriod().
+    uint32_t                        mNormalPeriodScale = 1;
+
     void*                           mSinkBuffer;         // frame size aligned sink buffer
 
     // TODO:
@@ -958,6 +967,12 @@ protected:
     // for any processing (including output processing).
     bool                            mEffectBufferValid;
 
+    // Set by MixerThread if af.mixer.track_cpu_stats is set: threadLoop() then times each
+    // effect chain into mEffectChainNs, which prepareTracks_l() attributes to the tracks
+    // of the chain's session. Accessed only within the threadLoop().
+    bool                            mTimeEffectChains = false;
+    std::vector<std::pair<audio_session_t, int64_t>> mEffectChainNs;
+
     // suspend count, > 0 means suspended.  While suspended, the thread continues to pull from
     // tracks and mix, but doesn't write to HAL.  A2DP and SCO HAL implementations can't handle
     // concurrent use of both of them, so Audio Policy Service suspends one of the threads to
@@ -1001,6 +1016,13 @@ protected:
 
     virtual     uint32_t    correctLatency_l(uint32_t latency) const;
 
+    // Adaptive normal period, enabled by MixerThread. Counts writes which come later than
+    // a period, and requests a larger period when they recur, or a smaller one when stable.
+                void        updateAdaptivePeriod(double jitterMs, nsecs_t nowNs);
+    // Reconfigures the thread for mRequestedNormalPeriodScale, returns true if applied.
+    // Called with both AudioFlinger::mLock and mLock held, and no write in progress.
+    virtual     bool        applyNormalPeriodScale_l() { return false; }
+
     virtual     status_t    createAudioPatch_l(const struct audio_patch *patch,
                                    audio_patch_handle_t *handle);
     virtual     status_t    releaseAudioPatch_l(const audio_patch_handle_t handle);
@@ -1113,6 +1135,14 @@ private:
     // MIXER only
     nsecs_t                         maxPeriod;
 
+    // MIXER only, adaptive normal period state, accessed only within the threadLoop().
+    bool                            mAdaptivePeriod = false;
+    uint32_t                        mRequestedNormalPeriodScale = 1;
+    uint32_t                        mAdaptiveWrites = 0;
+    uint32_t                        mAdaptiveLateWrites = 0;
+    nsecs_t                         mLastLateWriteNs = 0;
+    nsecs_t                         mLastPeriodChangeNs = 0;
+
     // DUPLICATING only
     uint32_t                        writeFrames;
 
@@ -1204,6 +1234,7 @@ protected:
     virtual     void        threadLoop_standby();
     virtual     void        threadLoop_mix();
     virtual     void        threadLoop_sleepTime();
+    virtual     void        threadLoop_removeTracks(const Vector< sp<Track> >& tracksToRemove);
     virtual     uint32_t    correctLatency_l(uint32_t latency) const;
 
     virtual     status_t    createAudioPatch_l(const struct audio_patch *patch,
@@ -1212,6 +1243,12 @@ protected:
 
                 AudioMixer* mAudioMixer;    // normal mixer
 private:
+                void        configureResamplerWorkers_l();
+                void        logTrackCpuTime_l(const sp<Track>& track);
+                void        recreateAudioMixer_l();
+                bool        applyNormalPeriodScale_l() override;
+                void        releaseAckedFastTracks_l(FastMixerStateQueue *sq);
+
                 // one-time initialization, no locks required
                 sp<FastMixer>     mFastMixer;     // non-0 if there is also a fast mixer
                 sp<AudioWatchdog> mAudioWatchdog; // non-0 if there is an audio watchdog thread
@@ -1227,6 +1264,12 @@ private:
                 // accessible only within the threadLoop(), no locks required
                 //          mFastMixer->sq()    // for mutating and pushing state
                 int32_t     mFastMixerFutex;    // for cold idle
+                // fast tracks removed from the fast mixer state, kept alive until the fast mixer
+                // acknowledges the state pushed with mFastTracksPendingSequence
+                Vector< sp<Track> > mFastTracksPendingAck;
+                Vector< sp<Track> > mFastTracksPendingReset;   // also to reset then
+                unsigned    mFastTracksPendingSequence;
+                Vector< sp<Track> > mFastTracksAcked;   // released without the thread lock
 
                 std::atomic_bool mMasterMono;
 public:
@@ -1477,7 +1520,11 @@ public:
     {
     public:
         explicit ResamplerBufferProvider(RecordTrack* recordTrack) :
-            mRecordTrack(recordTrack),
+            mRecordTrack(recordTrack), mRecordThread(NULL),
+            mRsmpInUnrel(0), mRsmpInFront(0) { }
+        // for a conversion owned by the thread rather than by a track
+        explicit ResamplerBufferProvider(RecordThread* recordThread) :
+            mRecordTrack(NULL), mRecordThread(recordThread),
             mRsmpInUnrel(0), mRsmpInFront(0) { }
         virtual ~ResamplerBufferProvider() { }
 
@@ -1502,7 +1549,10 @@ public:
         virtual status_t    getNextBuffer(AudioBufferProvider::Buffer* buffer);
         virtual void        releaseBuffer(AudioBufferProvider::Buffer* buffer);
     private:
+        sp<ThreadBase>      getThread() const;
+
         RecordTrack * const mRecordTrack;
+        RecordThread * const mRecordThread;
         size_t              mRsmpInUnrel;   // unreleased frames remaining from
                                             // most recent getNextBuffer
                                             // for debug only
@@ -1564,6 +1614,9 @@ public:
 
             AudioStreamIn* clearInput();
             virtual sp<StreamHalInterface> stream() const;
+            // Puts the input in standby for good and returns it, so that a software patch
+            // bridge can read from it directly. The thread must have no tracks.
+            AudioStreamIn* standbyForBridge();
 
 
     virtual bool        checkForNewParameter_l(const String8& keyValuePair,
@@ -1644,6 +1697,42 @@ private:
 
             void    checkBtNrec_l();
 
+            // Conversion shared by the active record tracks that ask for the same sample rate,
+            // format and channel mask. The input is converted once per read into a ring, and
+            // each track of the group copies from that ring at its own pace.
+            struct SharedConversion {
+                SharedConversion(RecordThread *thread, const RecordTrack *track);
+                ~SharedConversion();
+
+                bool matches(const RecordTrack *track) const {
+                    return track->mSampleRate == mSampleRate && track->format() == mFormat
+                            && track->channelMask() == mChannelMask;
+                }
+                // converts all the input read since the last call
+                void convert();
+                // frames the track can copy, skipping those it fell too far behind for
+                size_t framesAvailable(const RecordTrack *track, bool *hasOverrun);
+                // copies up to frames frames to the track buffer, returns the frames copied
+                size_t read(const RecordTrack *track, void *dst, size_t frames);
+
+                const uint32_t                  mSampleRate;
+                const audio_format_t            mFormat;
+                const audio_channel_mask_t      mChannelMask;
+                const uint32_t                  mSrcSampleRate;
+                const size_t                    mFrameSize;
+                RecordBufferConverter           mConverter;
+                ResamplerBufferProvider         mProvider;
+                size_t                          mFrames;    // size of mBuffer in frames
+                std::vector<uint8_t>            mBuffer;
+                int64_t                         mRear;      // frames converted, never cleared
+                std::map<const RecordTrack *, int64_t> mFronts; // next frame for each track
+            };
+
+            // Shares the conversion of tracks with the same configuration; must be called with
+            // the active tracks of the thread loop, before reading.
+            void    updateSharedConversions(const Vector< sp<RecordTrack> >& activeTracks);
+            SharedConversion *findSharedConversion(const RecordTrack *track) const;
+
             AudioStreamIn                       *mInput;
             SortedVector < sp<RecordTrack> >    mTracks;
             // mActiveTracks has dual roles:  it indicates the current active track(s), and
@@ -1706,6 +1795,9 @@ private:
             std::atomic_bool                    mBtNrecSuspended;
 
             int64_t                             mFramesRead = 0;    // continuous running counter.
+
+            // only used by the thread loop
+            std::vector<std::unique_ptr<SharedConversion>> mSharedConversions;
 };
 
 class MmapThread : public ThreadBase
@@ -1802,6 +1894,13 @@ class MmapThread : public ThreadBase
 
                 int32_t                 mNoCallbackWarningCount;
      static     constexpr int32_t       kMaxNoCallbackWarnings = 5;
+
+                // samples the HAL position into mHealth and the health of the active tracks
+                void                    sampleHealth_l();
+                bool                    mHealthSampling;    // false if the last wait did not sample
+                // how often the position is sampled while clients are active
+     static     constexpr nsecs_t       kHealthSamplePeriodNs = 100 * 1000 * 1000;
+                MmapStreamHealth        mHealth;    // since the thread was opened
 };
 
 class MmapPlaybackThread : public MmapThread, public VolumeInterface
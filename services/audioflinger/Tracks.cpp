@@ -33,6 +33,7 @@
 #include <media/nbaio/PipeReader.h>
 #include <media/RecordBufferConverter.h>
 #include <mediautils/ServiceUtilities.h>
+#include <audio_utils/clock.h>
 #include <audio_utils/minifloat.h>
 
 // ----------------------------------------------------------------------------
@@ -146,7 +147,7 @@ AudioFlinger::ThreadBase::TrackBase::TrackBase(
     }
 
     if (client != 0) {
-        mCblkMemory = client->heap()->allocate(size);
+        mCblkMemory = client->allocate(size);
         if (mCblkMemory == 0 ||
                 (mCblk = static_cast<audio_track_cblk_t *>(mCblkMemory->pointer())) == NULL) {
             ALOGE("%s(%d): not enough memory for AudioTrack size=%zu", __func__, mId, size);
@@ -777,6 +778,26 @@ void AudioFlinger::PlaybackThread::Track::appendDump(String8& result, bool activ
         }
     }
     result.append("\n");
+
+    if (mCpuMixUs.getN() > 0) {
+        // mean and max processing time per mix period, effects are shared within the session.
+        result.appendFormat("%10s cpu us: input %.1f/%.1f resample %.1f/%.1f"
+                " mix %.1f/%.1f effects %.1f/%.1f\n",
+                "",
+                mCpuInputUs.getMean(), mCpuInputUs.getMax(),
+                mCpuResampleUs.getMean(), mCpuResampleUs.getMax(),
+                mCpuMixUs.getMean(), mCpuMixUs.getMax(),
+                mCpuEffectsUs.getMean(), mCpuEffectsUs.getMax());
+    }
+}
+
+void AudioFlinger::PlaybackThread::Track::logCpuTime(
+        const AudioMixer::TrackTiming& timing, int64_t effectsNs)
+{
+    mCpuInputUs.add(timing.mInputNs * 1e-3);
+    mCpuResampleUs.add(timing.mResampleNs * 1e-3);
+    mCpuMixUs.add(timing.mMixNs * 1e-3);
+    mCpuEffectsUs.add(effectsNs * 1e-3);
 }
 
 uint32_t AudioFlinger::PlaybackThread::Track::sampleRate() const {
@@ -897,6 +918,15 @@ void AudioFlinger::PlaybackThread::Track::onTimestamp(const ExtendedTimestamp &t
     mServerLatencyMs.store(latencyMs);
 }
 
+void AudioFlinger::PlaybackThread::Track::setPresentationTimestamp(
+        const AudioTimestamp &timestamp)
+{
+    PresentationTimestamp presentation;
+    presentation.mPosition = timestamp.mPosition;
+    presentation.mTimeNs = audio_utils_ns_from_timespec(&timestamp.mTime);
+    mAudioTrackServerProxy->setPresentationTimestamp(presentation);
+}
+
 // Don't call for fast tracks; the framesReady() could result in priority inversion
 bool AudioFlinger::PlaybackThread::Track::isReady() const {
     if (mFillingUpStatus != FS_FILLING || isStopped() || isPausing()) {
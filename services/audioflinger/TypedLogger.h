@@ -89,6 +89,11 @@ constexpr uint64_t hash(const char (&file)[n], uint32_t line) {
                                 x->logFormat((fmt), hash(__FILE__, __LINE__), ##__VA_ARGS__); } \
                                 while (0)
 
+// Same as LOGT, but packs the arguments into one entry without parsing the format string,
+// for use on threads with deadlines. Does not support %p.
+#define LOGTP(fmt, ...) do { NBLog::Writer *x = tlNBLogWriter; if (x != nullptr) \
+        x->logFormatPacked((fmt), hash(__FILE__, __LINE__), ##__VA_ARGS__); } while (0)
+
 // Write histogram timestamp entry
 #define LOG_HIST_TS() do { NBLog::Writer *x = tlNBLogWriter; if (x != nullptr) \
         x->logEventHistTs(NBLog::EVENT_HISTOGRAM_ENTRY_TS, hash(__FILE__, __LINE__)); } while(0)
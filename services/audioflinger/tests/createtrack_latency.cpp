@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stress benchmark for AudioFlinger::createTrack().
+// Several client threads create and release AudioTracks in a loop while one more thread
+// queries output parameters, and the creation latency percentiles are printed.
+// Usage: createtrack_latency [-c clients] [-n tracks per client]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <binder/ProcessState.h>
+#include <media/AudioSystem.h>
+#include <media/AudioTrack.h>
+#include <utils/Timers.h>
+
+using namespace android;
+
+static void printPercentiles(const char *name, std::vector<nsecs_t> &latencies)
+{
+    if (latencies.empty()) {
+        printf("%s: no samples\n", name);
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](size_t p) {
+        return latencies[std::min(latencies.size() - 1, latencies.size() * p / 100)] / 1e6;
+    };
+    printf("%s: %zu samples, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+            name, latencies.size(), percentile(50), percentile(90), percentile(99),
+            latencies.back() / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int clients = 32;
+    int tracksPerClient = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:")) != -1) {
+        switch (opt) {
+        case 'c':
+            clients = atoi(optarg);
+            break;
+        case 'n':
+            tracksPerClient = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-c clients] [-n tracks per client]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (clients <= 0 || tracksPerClient <= 0) {
+        fprintf(stderr, "clients and tracks per client must be positive\n");
+        return EXIT_FAILURE;
+    }
+    ProcessState::self()->startThreadPool();
+
+    std::mutex lock;
+    std::vector<nsecs_t> createLatencies;
+    std::vector<nsecs_t> queryLatencies;
+    std::atomic<int> failures{0};
+    std::atomic<bool> running{true};
+
+    // AudioFlinger::getParameters() takes AudioFlinger::mLock, so it contends with createTrack().
+    std::thread query([&]() {
+        std::vector<nsecs_t> latencies;
+        while (running) {
+            nsecs_t start = systemTime();
+            (void) AudioSystem::getParameters(String8("routing"));
+            latencies.push_back(systemTime() - start);
+            usleep(1000);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        queryLatencies = std::move(latencies);
+    });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; i++) {
+        threads.emplace_back([&]() {
+            std::vector<nsecs_t> latencies;
+            for (int j = 0; j < tracksPerClient; j++) {
+                nsecs_t start = systemTime();
+                sp<AudioTrack> track = new AudioTrack(AUDIO_STREAM_MUSIC,
+                                                      48000 /* sampleRate */,
+                                                      AUDIO_FORMAT_PCM_16_BIT,
+                                                      AUDIO_CHANNEL_OUT_STEREO);
+                if (track->initCheck() != NO_ERROR) {
+                    failures++;
+                    continue;
+                }
+                latencies.push_back(systemTime() - start);
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            createLatencies.insert(createLatencies.end(), latencies.begin(), latencies.end());
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    running = false;
+    query.join();
+
+    printf("%d clients, %d tracks per client, %d failures\n",
+            clients, tracksPerClient, failures.load());
+    printPercentiles("createTrack", createLatencies);
+    printPercentiles("getParameters", queryLatencies);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -740,7 +740,9 @@ Return<SurroundSoundFormatTraits::Element> SurroundSoundFormatTraits::deserializ
 
 status_t PolicySerializer::deserialize(const char *configFile, AudioPolicyConfig *config)
 {
-    auto doc = make_xmlUnique(xmlParseFile(configFile));
+    // Blank text nodes between elements are never looked at, so do not build them.
+    static constexpr int kXmlParseOptions = XML_PARSE_NOBLANKS | XML_PARSE_COMPACT;
+    auto doc = make_xmlUnique(xmlReadFile(configFile, nullptr, kXmlParseOptions));
     if (doc == nullptr) {
         ALOGE("%s: Could not parse %s document.", __func__, configFile);
         return BAD_VALUE;
@@ -750,7 +752,7 @@ status_t PolicySerializer::deserialize(const char *configFile, AudioPolicyConfig
         ALOGE("%s: Could not parse %s document: empty.", __func__, configFile);
         return BAD_VALUE;
     }
-    if (xmlXIncludeProcess(doc.get()) < 0) {
+    if (xmlXIncludeProcessFlags(doc.get(), kXmlParseOptions) < 0) {
         ALOGE("%s: libxml failed to resolve XIncludes on %s document.", __func__, configFile);
     }
 
@@ -29,6 +29,7 @@
 #include <string>
 #include <map>
 #include <utility>
+#include <vector>
 
 namespace android {
 
@@ -54,7 +55,11 @@ class VolumeCurve : public RefBase
 public:
     VolumeCurve(device_category device) : mDeviceCategory(device) {}
 
-    void add(const CurvePoint &point) { mCurvePoints.add(point); }
+    void add(const CurvePoint &point)
+    {
+        mCurvePoints.add(point);
+        mDbTable.clear();
+    }
 
     float volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
 
@@ -63,8 +68,18 @@ public:
     device_category getDeviceCategory() const { return mDeviceCategory; }
 
 private:
+    float computeVolIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
+
     const device_category mDeviceCategory;
     SortedVector<CurvePoint> mCurvePoints;
+
+    // Attenuation for each index from mDbTableIndexMin to mDbTableIndexMax, filled on first
+    // use for that index range. Curves are shared between volume groups and evaluated for
+    // every output and stream on each volume or routing change.
+    static constexpr int kMaxDbTableSize = 1024;
+    mutable std::vector<float> mDbTable;
+    mutable int mDbTableIndexMin = 0;
+    mutable int mDbTableIndexMax = 0;
 };
 
 // Volume Curves for a given use case indexed by device category
@@ -24,6 +24,23 @@
 namespace android {
 
 float VolumeCurve::volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const
+{
+    if (indexInUi < volIndexMin || indexInUi > volIndexMax || volIndexMin < 0 ||
+            volIndexMax - volIndexMin >= kMaxDbTableSize) {
+        return computeVolIndexToDb(indexInUi, volIndexMin, volIndexMax);
+    }
+    if (mDbTable.empty() || mDbTableIndexMin != volIndexMin || mDbTableIndexMax != volIndexMax) {
+        mDbTable.resize(volIndexMax - volIndexMin + 1);
+        for (int index = volIndexMin; index <= volIndexMax; index++) {
+            mDbTable[index - volIndexMin] = computeVolIndexToDb(index, volIndexMin, volIndexMax);
+        }
+        mDbTableIndexMin = volIndexMin;
+        mDbTableIndexMax = volIndexMax;
+    }
+    return mDbTable[indexInUi - volIndexMin];
+}
+
+float VolumeCurve::computeVolIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const
 {
     ALOG_ASSERT(!mCurvePoints.isEmpty(), "Invalid volume curve");
     if (volIndexMin < 0 || volIndexMax < 0) {
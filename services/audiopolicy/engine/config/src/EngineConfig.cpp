@@ -25,7 +25,9 @@
 #include <utils/Log.h>
 #include <libxml/parser.h>
 #include <libxml/xinclude.h>
+#include <memory>
 #include <string>
+#include <unistd.h>
 #include <vector>
 #include <map>
 #include <sstream>
@@ -603,9 +605,13 @@ static status_t deserializeLegacyVolumeCollection(_xmlDoc *doc, const _xmlNode *
     return NO_ERROR;
 }
 
+// Blank text nodes between elements are never looked at, so do not build them.
+static constexpr int kXmlParseOptions = XML_PARSE_NOBLANKS | XML_PARSE_COMPACT;
+
 ParsingResult parse(const char* path) {
-    xmlDocPtr doc;
-    doc = xmlParseFile(path);
+    std::unique_ptr<xmlDoc, decltype(xmlFreeDoc)*> docOwner(
+            xmlReadFile(path, nullptr, kXmlParseOptions), xmlFreeDoc);
+    xmlDocPtr doc = docOwner.get();
     if (doc == NULL) {
         ALOGE("%s: Could not parse document %s", __FUNCTION__, path);
         return {nullptr, 0};
@@ -613,10 +619,9 @@ ParsingResult parse(const char* path) {
     xmlNodePtr cur = xmlDocGetRootElement(doc);
     if (cur == NULL) {
         ALOGE("%s: Could not parse: empty document %s", __FUNCTION__, path);
-        xmlFreeDoc(doc);
         return {nullptr, 0};
     }
-    if (xmlXIncludeProcess(doc) < 0) {
+    if (xmlXIncludeProcessFlags(doc, kXmlParseOptions) < 0) {
         ALOGE("%s: libxml failed to resolve XIncludes on document %s", __FUNCTION__, path);
         return {nullptr, 0};
     }
@@ -641,8 +646,9 @@ ParsingResult parse(const char* path) {
 }
 
 android::status_t parseLegacyVolumeFile(const char* path, VolumeGroups &volumeGroups) {
-    xmlDocPtr doc;
-    doc = xmlParseFile(path);
+    std::unique_ptr<xmlDoc, decltype(xmlFreeDoc)*> docOwner(
+            xmlReadFile(path, nullptr, kXmlParseOptions), xmlFreeDoc);
+    xmlDocPtr doc = docOwner.get();
     if (doc == NULL) {
         ALOGE("%s: Could not parse document %s", __FUNCTION__, path);
         return BAD_VALUE;
@@ -650,10 +656,9 @@ android::status_t parseLegacyVolumeFile(const char* path, VolumeGroups &volumeGr
     xmlNodePtr cur = xmlDocGetRootElement(doc);
     if (cur == NULL) {
         ALOGE("%s: Could not parse: empty document %s", __FUNCTION__, path);
-        xmlFreeDoc(doc);
         return BAD_VALUE;
     }
-    if (xmlXIncludeProcess(doc) < 0) {
+    if (xmlXIncludeProcessFlags(doc, kXmlParseOptions) < 0) {
         ALOGE("%s: libxml failed to resolve XIncludes on document %s", __FUNCTION__, path);
         return BAD_VALUE;
     }
@@ -686,6 +691,9 @@ android::status_t parseLegacyVolumes(VolumeGroups &volumeGroups) {
         for (int i = 0; i < kConfigLocationListSize; i++) {
             snprintf(audioPolicyXmlConfigFile, sizeof(audioPolicyXmlConfigFile),
                      "%s/%s", kConfigLocationList[i], fileName);
+            if (access(audioPolicyXmlConfigFile, R_OK) != 0) {
+                continue;
+            }
             ret = parseLegacyVolumeFile(audioPolicyXmlConfigFile, volumeGroups);
             if (ret == NO_ERROR) {
                 return ret;
@@ -40,6 +40,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <set>
+#include <unistd.h>
 #include <unordered_set>
 #include <vector>
 #include <AudioPolicyManagerInterface.h>
@@ -1442,6 +1443,36 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
                                                        audio_format_t format,
                                                        audio_channel_mask_t channelMask,
                                                        uint32_t samplingRate)
+{
+    SelectOutputKey key(std::vector<audio_io_handle_t>(outputs.begin(), outputs.end()),
+                        flags, format, channelMask, samplingRate);
+    auto it = mSelectOutputCache.find(key);
+    if (it != mSelectOutputCache.end()) {
+        mSelectOutputCacheHits++;
+        return it->second;
+    }
+    mSelectOutputCacheMisses++;
+
+    const audio_io_handle_t output =
+            selectOutputInt(outputs, flags, format, channelMask, samplingRate);
+    if (mSelectOutputCache.size() >= kMaxSelectOutputCacheSize) {
+        mSelectOutputCache.clear();
+    }
+    mSelectOutputCache.emplace(std::move(key), output);
+    return output;
+}
+
+void AudioPolicyManager::invalidateSelectOutputCache()
+{
+    mSelectOutputCache.clear();
+}
+
+audio_io_handle_t AudioPolicyManager::selectOutputInt(
+        const SortedVector<audio_io_handle_t>& outputs,
+        audio_output_flags_t flags,
+        audio_format_t format,
+        audio_channel_mask_t channelMask,
+        uint32_t samplingRate)
 {
     LOG_ALWAYS_FATAL_IF(!(format == AUDIO_FORMAT_INVALID || audio_is_linear_pcm(format)),
         "%s called with format %#x", __func__, format);
@@ -3081,6 +3112,9 @@ void AudioPolicyManager::dump(String8 *dst) const
     dst->appendFormat(" TTS output %savailable\n", mTtsOutputAvailable ? "" : "not ");
     dst->appendFormat(" Master mono: %s\n", mMasterMono ? "on" : "off");
     dst->appendFormat(" Config source: %s\n", mConfig.getSource().c_str()); // getConfig not const
+    dst->appendFormat(" Output selection cache: %zu entries, %u hits, %u misses\n",
+                      mSelectOutputCache.size(), mSelectOutputCacheHits,
+                      mSelectOutputCacheMisses);
     mAvailableOutputDevices.dump(dst, String8("Available output"));
     mAvailableInputDevices.dump(dst, String8("Available input"));
     mHwModulesAll.dump(dst);
@@ -4262,6 +4296,11 @@ static status_t deserializeAudioPolicyXmlConfig(AudioPolicyConfig &config) {
         for (int i = 0; i < kConfigLocationListSize; i++) {
             snprintf(audioPolicyXmlConfigFile, sizeof(audioPolicyXmlConfigFile),
                      "%s/%s", kConfigLocationList[i], fileName);
+            // most locations have no file, do not let libxml try to parse them.
+            if (access(audioPolicyXmlConfigFile, R_OK) != 0) {
+                ret = NAME_NOT_FOUND;
+                continue;
+            }
             ret = deserializeAudioPolicyFile(audioPolicyXmlConfigFile, &config);
             if (ret == NO_ERROR) {
                 config.setSource(audioPolicyXmlConfigFile);
@@ -4525,6 +4564,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output,
                                    const sp<SwAudioOutputDescriptor>& outputDesc)
 {
     mOutputs.add(output, outputDesc);
+    invalidateSelectOutputCache();
     applyStreamVolumes(outputDesc, AUDIO_DEVICE_NONE, 0 /* delayMs */, true /* force */);
     updateMono(output); // update mono status when adding to output list
     selectOutputForMusicEffects();
@@ -4534,6 +4574,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output,
 void AudioPolicyManager::removeOutput(audio_io_handle_t output)
 {
     mOutputs.removeItem(output);
+    invalidateSelectOutputCache();
     selectOutputForMusicEffects();
 }
 
@@ -5027,12 +5068,17 @@ bool AudioPolicyManager::followsSameRouting(const audio_attributes_t &lAttr,
             mEngine->getProductStrategyForAttributes(rAttr);
 }
 
-void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr)
+bool AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr,
+                                                  bool outputsChanged)
 {
     auto psId = mEngine->getProductStrategyForAttributes(attr);
 
     DeviceVector oldDevices = mEngine->getOutputDevicesForAttributes(attr, 0, true /*fromCache*/);
     DeviceVector newDevices = mEngine->getOutputDevicesForAttributes(attr, 0, false /*fromCache*/);
+    if (!outputsChanged && oldDevices == newDevices) {
+        // same devices and same outputs: the source and destination outputs are the same.
+        return false;
+    }
     SortedVector<audio_io_handle_t> srcOutputs = getOutputsForDevices(oldDevices, mPreviousOutputs);
     SortedVector<audio_io_handle_t> dstOutputs = getOutputsForDevices(newDevices, mOutputs);
 
@@ -5054,51 +5100,72 @@ void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr
         }
     }
 
-    if (srcOutputs != dstOutputs) {
-        // get maximum latency of all source outputs to determine the minimum mute time guaranteeing
-        // audio from invalidated tracks will be rendered when unmuting
-        uint32_t maxLatency = 0;
-        for (audio_io_handle_t srcOut : srcOutputs) {
-            sp<SwAudioOutputDescriptor> desc = mPreviousOutputs.valueFor(srcOut);
-            if (desc != 0 && maxLatency < desc->latency()) {
-                maxLatency = desc->latency();
-            }
-        }
-        ALOGV_IF(!(srcOutputs.isEmpty() || dstOutputs.isEmpty()),
-              "%s: strategy %d, moving from output %s to output %s", __func__, psId,
-              std::to_string(srcOutputs[0]).c_str(),
-              std::to_string(dstOutputs[0]).c_str());
-        // mute strategy while moving tracks from one output to another
-        for (audio_io_handle_t srcOut : srcOutputs) {
-            sp<SwAudioOutputDescriptor> desc = mPreviousOutputs.valueFor(srcOut);
-            if (desc != 0 && desc->isStrategyActive(psId)) {
-                setStrategyMute(psId, true, desc);
-                setStrategyMute(psId, false, desc, maxLatency * LATENCY_MUTE_FACTOR,
-                                newDevices.types());
-            }
-            sp<SourceClientDescriptor> source = getSourceForAttributesOnOutput(srcOut, attr);
-            if (source != 0){
-                connectAudioSource(source);
-            }
-        }
+    if (srcOutputs == dstOutputs) {
+        return false;
+    }
 
-        // Move effects associated to this stream from previous output to new output
-        if (followsSameRouting(attr, attributes_initializer(AUDIO_USAGE_MEDIA))) {
-            selectOutputForMusicEffects();
+    // get maximum latency of all source outputs to determine the minimum mute time guaranteeing
+    // audio from invalidated tracks will be rendered when unmuting
+    uint32_t maxLatency = 0;
+    for (audio_io_handle_t srcOut : srcOutputs) {
+        sp<SwAudioOutputDescriptor> desc = mPreviousOutputs.valueFor(srcOut);
+        if (desc != 0 && maxLatency < desc->latency()) {
+            maxLatency = desc->latency();
         }
-        // Move tracks associated to this stream (and linked) from previous output to new output
-        for (auto stream :  mEngine->getStreamTypesForProductStrategy(psId)) {
-            mpClientInterface->invalidateStream(stream);
+    }
+    ALOGV_IF(!(srcOutputs.isEmpty() || dstOutputs.isEmpty()),
+          "%s: strategy %d, moving from output %s to output %s", __func__, psId,
+          std::to_string(srcOutputs[0]).c_str(),
+          std::to_string(dstOutputs[0]).c_str());
+    // mute strategy while moving tracks from one output to another
+    for (audio_io_handle_t srcOut : srcOutputs) {
+        sp<SwAudioOutputDescriptor> desc = mPreviousOutputs.valueFor(srcOut);
+        if (desc != 0 && desc->isStrategyActive(psId)) {
+            setStrategyMute(psId, true, desc);
+            setStrategyMute(psId, false, desc, maxLatency * LATENCY_MUTE_FACTOR,
+                            newDevices.types());
+        }
+        sp<SourceClientDescriptor> source = getSourceForAttributesOnOutput(srcOut, attr);
+        if (source != 0){
+            connectAudioSource(source);
         }
     }
+
+    // Move effects associated to this stream from previous output to new output
+    if (followsSameRouting(attr, attributes_initializer(AUDIO_USAGE_MEDIA))) {
+        selectOutputForMusicEffects();
+    }
+    // Move tracks associated to this stream (and linked) from previous output to new output
+    for (auto stream :  mEngine->getStreamTypesForProductStrategy(psId)) {
+        mpClientInterface->invalidateStream(stream);
+    }
+    return true;
 }
 
 void AudioPolicyManager::checkOutputForAllStrategies()
 {
+    const nsecs_t startNs = systemTime();
+
+    // When no output was opened or closed, only the strategies whose devices changed
+    // can move to another output.
+    bool outputsChanged = mOutputs.size() != mPreviousOutputs.size();
+    for (size_t i = 0; i < mOutputs.size() && !outputsChanged; i++) {
+        outputsChanged = mOutputs.keyAt(i) != mPreviousOutputs.keyAt(i)
+                || mOutputs.valueAt(i) != mPreviousOutputs.valueAt(i);
+    }
+
+    size_t numStrategies = 0;
+    size_t numMoved = 0;
     for (const auto &strategy : mEngine->getOrderedProductStrategies()) {
         auto attributes = mEngine->getAllAttributesForProductStrategy(strategy).front();
-        checkOutputForAttributes(attributes);
+        if (checkOutputForAttributes(attributes, outputsChanged)) {
+            numMoved++;
+        }
+        numStrategies++;
     }
+    ALOGV("%s() outputs %schanged, %zu of %zu strategies moved in %" PRId64 " us", __func__,
+          outputsChanged ? "" : "un", numMoved, numStrategies,
+          ns2us(systemTime() - startNs));
 }
 
 void AudioPolicyManager::checkSecondaryOutputs() {
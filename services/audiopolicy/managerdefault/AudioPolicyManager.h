@@ -18,8 +18,11 @@
 
 #include <atomic>
 #include <functional>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <unordered_set>
+#include <vector>
 
 #include <stdint.h>
 #include <sys/types.h>
@@ -508,8 +511,12 @@ protected:
          * attributes changes: connected device, phone state, force use...
          * Must be called before updateDevicesAndOutputs()
          * @param attr to be considered
+         * @param outputsChanged false if no output was opened or closed since mPreviousOutputs
+         *      was saved, in which case nothing is done unless the devices for attr changed.
+         * @return true if the outputs for attr changed
          */
-        void checkOutputForAttributes(const audio_attributes_t &attr);
+        bool checkOutputForAttributes(const audio_attributes_t &attr,
+                                      bool outputsChanged = true);
 
         bool followsSameRouting(const audio_attributes_t &lAttr,
                                 const audio_attributes_t &rAttr) const;
@@ -579,6 +586,13 @@ protected:
                                        audio_format_t format = AUDIO_FORMAT_INVALID,
                                        audio_channel_mask_t channelMask = AUDIO_CHANNEL_NONE,
                                        uint32_t samplingRate = 0);
+        audio_io_handle_t selectOutputInt(const SortedVector<audio_io_handle_t>& outputs,
+                                          audio_output_flags_t flags,
+                                          audio_format_t format,
+                                          audio_channel_mask_t channelMask,
+                                          uint32_t samplingRate);
+        // must be called whenever an output is added to or removed from mOutputs
+        void invalidateSelectOutputCache();
         // samplingRate, format, channelMask are in/out and so may be modified
         sp<IOProfile> getInputProfile(const sp<DeviceDescriptor> & device,
                                       uint32_t& samplingRate,
@@ -759,6 +773,15 @@ protected:
         std::unordered_set<audio_format_t> mManualSurroundFormats;
 
         std::unordered_map<uid_t, audio_flags_mask_t> mAllowedCapturePolicies;
+
+        // Results of selectOutput(), which only depend on its arguments and on the
+        // parameters of the outputs in mOutputs, which are fixed once they are opened.
+        typedef std::tuple<std::vector<audio_io_handle_t>, audio_output_flags_t,
+                audio_format_t, audio_channel_mask_t, uint32_t> SelectOutputKey;
+        static constexpr size_t kMaxSelectOutputCacheSize = 64;
+        std::map<SelectOutputKey, audio_io_handle_t> mSelectOutputCache;
+        uint32_t mSelectOutputCacheHits = 0;
+        uint32_t mSelectOutputCacheMisses = 0;
 protected:
         // Add or remove AC3 DTS encodings based on user preferences.
         void modifySurroundFormats(const sp<DeviceDescriptor>& devDesc, FormatVector *formatsPtr);
@@ -465,10 +465,16 @@ status_t CallbackProcessor::convertFromFlexibleYuv(int32_t previewFormat,
     // Copy Y plane, adjusting for stride
     const uint8_t *ySrc = src.data;
     uint8_t *yDst = dst;
-    for (size_t row = 0; row < src.height; row++) {
-        memcpy(yDst, ySrc, src.width);
-        ySrc += src.stride;
-        yDst += dstYStride;
+    if (src.stride == dstYStride) {
+        // Same row layout, copy the whole plane at once
+        memcpy(yDst, ySrc, dstYStride * (src.height - 1) + src.width);
+        yDst += dstYStride * src.height;
+    } else {
+        for (size_t row = 0; row < src.height; row++) {
+            memcpy(yDst, ySrc, src.width);
+            ySrc += src.stride;
+            yDst += dstYStride;
+        }
     }
 
     // Copy/swizzle chroma planes, 4:2:0 subsampling
@@ -487,10 +493,26 @@ status_t CallbackProcessor::convertFromFlexibleYuv(int32_t previewFormat,
         if (cbSrc == crSrc + 1 && src.chromaStep == 2) {
             ALOGV("%s: Fast NV21->NV21", __FUNCTION__);
             // Source has semiplanar CrCb chroma layout, can copy by rows
+            if (src.chromaStride == src.width) {
+                memcpy(crcbDst, crSrc, src.width * chromaHeight);
+            } else {
+                for (size_t row = 0; row < chromaHeight; row++) {
+                    memcpy(crcbDst, crSrc, src.width);
+                    crcbDst += src.width;
+                    crSrc += src.chromaStride;
+                }
+            }
+        } else if (crSrc == cbSrc + 1 && src.chromaStep == 2) {
+            ALOGV("%s: Fast NV12->NV21", __FUNCTION__);
+            // Source has semiplanar CbCr chroma layout, swap the bytes of each pair.
+            // Indexed by row so that the compiler can vectorize the inner loop.
             for (size_t row = 0; row < chromaHeight; row++) {
-                memcpy(crcbDst, crSrc, src.width);
-                crcbDst += src.width;
-                crSrc += src.chromaStride;
+                for (size_t col = 0; col < chromaWidth * 2; col += 2) {
+                    crcbDst[col] = cbSrc[col + 1];
+                    crcbDst[col + 1] = cbSrc[col];
+                }
+                crcbDst += chromaWidth * 2;
+                cbSrc += src.chromaStride;
             }
         } else {
             ALOGV("%s: Generic->NV21", __FUNCTION__);
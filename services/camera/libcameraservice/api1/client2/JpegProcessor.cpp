@@ -391,14 +391,22 @@ size_t JpegProcessor::findJpegSize(uint8_t* jpegBuffer, size_t maxSize) {
     }
 
     // Find End of Image
-    // Scan JPEG buffer until End of Image (EOI)
+    // Scan JPEG buffer until End of Image (EOI). Only markers and stuffed bytes contain
+    // 0xFF in the compressed stream, so let memchr skip to the next candidate.
     bool foundEnd = false;
-    for ( ; size <= maxSize - MARKER_LENGTH; size++) {
-        if ( checkJpegEnd(jpegBuffer + size) ) {
+    while (size <= maxSize - MARKER_LENGTH) {
+        uint8_t *mark = static_cast<uint8_t*>(
+                memchr(jpegBuffer + size, MARK, maxSize - MARKER_LENGTH + 1 - size));
+        if (mark == nullptr) {
+            break;
+        }
+        size = mark - jpegBuffer;
+        if ( checkJpegEnd(mark) ) {
             foundEnd = true;
             size += MARKER_LENGTH;
             break;
         }
+        size++;
     }
     if (!foundEnd) {
         ALOGE("Could not find end of JPEG marker");
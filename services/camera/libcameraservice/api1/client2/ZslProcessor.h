@@ -126,6 +126,9 @@ class ZslProcessor :
     size_t mBufferQueueDepth;
     size_t mFrameListDepth;
     Vector<CameraMetadata> mFrameList;
+    // Sensor timestamp of each mFrameList entry if it is good enough for reprocessing,
+    // -1 otherwise; evaluated once as the result arrives
+    Vector<nsecs_t> mFrameCandidateTimestamps;
     size_t mFrameListHead;
 
     ZslPair mNextPair;
@@ -155,6 +158,9 @@ class ZslProcessor :
 
     nsecs_t getCandidateTimestampLocked(size_t* metadataIdx) const;
 
+    // Whether the AE and AF states of a result allow reprocessing its buffer
+    bool isCandidateFrame(const CameraMetadata &frame) const;
+
     status_t enqueueInputBufferByTimestamp( nsecs_t timestamp,
         nsecs_t* actualTimestamp);
     status_t clearInputRingBufferLocked(nsecs_t* latestTimestamp);
@@ -88,7 +88,9 @@ CameraDeviceClient::CameraDeviceClient(const sp<CameraService>& cameraService,
                 cameraFacing, clientPid, clientUid, servicePid),
     mInputStream(),
     mStreamingRequestId(REQUEST_ID_NONE),
-    mRequestIdCounter(0) {
+    mRequestIdCounter(0),
+    mResultDeltaEnabled(false),
+    mPartialResultCount(1) {
 
     ATRACE_CALL();
     ALOGI("CameraDeviceClient %s: Opened", cameraId.string());
@@ -128,6 +130,12 @@ status_t CameraDeviceClient::initializeImpl(TProviderPtr providerPtr, const Stri
                 physicalKeysEntry.data.i32 + physicalKeysEntry.count);
     }
 
+    camera_metadata_entry_t partialResultCountEntry =
+            deviceInfo.find(ANDROID_REQUEST_PARTIAL_RESULT_COUNT);
+    if (partialResultCountEntry.count > 0) {
+        mPartialResultCount = partialResultCountEntry.data.i32[0];
+    }
+
     mProviderManager = providerPtr;
     return OK;
 }
@@ -1870,6 +1878,32 @@ binder::Status CameraDeviceClient::finalizeOutputConfigurations(int32_t streamId
     return res;
 }
 
+binder::Status CameraDeviceClient::setResultDeltaEnabled(bool enabled) {
+    ATRACE_CALL();
+
+    binder::Status res;
+    if (!(res = checkPidStatus(__FUNCTION__)).isOk()) return res;
+
+    Mutex::Autolock icl(mBinderSerializationLock);
+
+    if (!mDevice.get()) {
+        return STATUS_ERROR(CameraService::ERROR_DISCONNECTED, "Camera device no longer alive");
+    }
+
+    // the client reconstructs results from the first one on
+    if (mRequestIdCounter > 0) {
+        String8 msg = String8::format("Camera %s: Result deltas can only be changed before"
+                " the first request", mCameraIdStr.string());
+        ALOGE("%s: %s", __FUNCTION__, msg.string());
+        return STATUS_ERROR(CameraService::ERROR_INVALID_OPERATION, msg.string());
+    }
+
+    ALOGV("%s: Camera %s: result deltas %s", __FUNCTION__, mCameraIdStr.string(),
+            enabled ? "enabled" : "disabled");
+    mResultDeltaEnabled = enabled;
+    return res;
+}
+
 status_t CameraDeviceClient::dump(int fd, const Vector<String16>& args) {
     return BasicClient::dump(fd, args);
 }
@@ -2015,8 +2049,16 @@ void CameraDeviceClient::onResultAvailable(const CaptureResult& result) {
     // Thread-safe. No lock necessary.
     sp<hardware::camera2::ICameraDeviceCallbacks> remoteCb = mRemoteCallback;
     if (remoteCb != NULL) {
-        remoteCb->onResultReceived(result.mMetadata, result.mResultExtras,
-                result.mPhysicalMetadatas);
+        if (mResultDeltaEnabled
+                && result.mResultExtras.partialResultCount >= mPartialResultCount) {
+            CaptureResult delta(result);
+            encodeResultDelta(&delta);
+            remoteCb->onResultReceived(delta.mMetadata, delta.mResultExtras,
+                    delta.mPhysicalMetadatas);
+        } else {
+            remoteCb->onResultReceived(result.mMetadata, result.mResultExtras,
+                    result.mPhysicalMetadatas);
+        }
     }
 
     for (size_t i = 0; i < mCompositeStreamMap.size(); i++) {
@@ -2024,6 +2066,32 @@ void CameraDeviceClient::onResultAvailable(const CaptureResult& result) {
     }
 }
 
+void CameraDeviceClient::encodeResultDelta(CaptureResult* result) {
+    ATRACE_CALL();
+
+    // A complete result applied as a delta only misses the tags removed since the previous
+    // one, so that is what the client gets if no delta can be computed.
+    CameraMetadata delta;
+    if (result->mMetadata.getDelta(mLastResult, &delta) == OK) {
+        mLastResult.swap(result->mMetadata);
+        result->mMetadata.swap(delta);
+    } else {
+        ALOGW("%s: Camera %s: Sending a complete result", __FUNCTION__, mCameraIdStr.string());
+        mLastResult = result->mMetadata;
+    }
+
+    for (auto& physicalResult : result->mPhysicalMetadatas) {
+        CameraMetadata& last = mLastPhysicalResults[physicalResult.mPhysicalCameraId];
+        CameraMetadata physicalDelta;
+        if (physicalResult.mPhysicalCameraMetadata.getDelta(last, &physicalDelta) == OK) {
+            last.swap(physicalResult.mPhysicalCameraMetadata);
+            physicalResult.mPhysicalCameraMetadata.swap(physicalDelta);
+        } else {
+            last = physicalResult.mPhysicalCameraMetadata;
+        }
+    }
+}
+
 binder::Status CameraDeviceClient::checkPidStatus(const char* checkLocation) {
     if (mDisconnected) {
         return STATUS_ERROR(CameraService::ERROR_DISCONNECTED,
@@ -152,6 +152,9 @@ public:
     virtual binder::Status finalizeOutputConfigurations(int32_t streamId,
             const hardware::camera2::params::OutputConfiguration &outputConfiguration) override;
 
+    // Send complete results as deltas from the previous ones
+    virtual binder::Status setResultDeltaEnabled(bool enabled) override;
+
     /**
      * Interface used by CameraService
      */
@@ -318,6 +321,16 @@ private:
 
     KeyedVector<sp<IBinder>, sp<CompositeStream>> mCompositeStreamMap;
 
+    // Result delta encoding. The last complete results are only used on the frame processor
+    // thread; the flag cannot change once requests were submitted.
+    bool mResultDeltaEnabled;
+    int32_t mPartialResultCount;
+    CameraMetadata mLastResult;
+    std::map<String16, CameraMetadata> mLastPhysicalResults;
+
+    // Replace the complete result metadata in |result| with deltas from the previous ones
+    void encodeResultDelta(CaptureResult* result);
+
     static const int32_t MAX_SURFACES_PER_STREAM = 4;
     sp<CameraProviderManager> mProviderManager;
 };
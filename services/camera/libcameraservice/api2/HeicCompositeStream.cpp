@@ -1098,6 +1098,19 @@ void HeicCompositeStream::releaseInputFrameLocked(InputFrame *inputFrame /*out*/
     }
 }
 
+void HeicCompositeStream::releaseTiledYuvBufferLocked(InputFrame *inputFrame /*out*/) {
+    if (inputFrame == nullptr || inputFrame->error || inputFrame->yuvBuffer.data == nullptr) {
+        return;
+    }
+
+    if (inputFrame->codecInputCounter == mGridRows * mGridCols &&
+            inputFrame->codecInputBuffers.empty()) {
+        mMainImageConsumer->unlockBuffer(inputFrame->yuvBuffer);
+        inputFrame->yuvBuffer.data = nullptr;
+        mYuvBufferAcquired = false;
+    }
+}
+
 void HeicCompositeStream::releaseInputFramesLocked(int64_t currentTs) {
     auto it = mPendingInputFrames.begin();
     while (it != mPendingInputFrames.end()) {
@@ -1552,6 +1565,8 @@ bool HeicCompositeStream::threadLoop() {
             (mPendingInputFrames[currentTs].appSegmentWritten &&
             mPendingInputFrames[currentTs].pendingOutputTiles == 0)) {
         releaseInputFramesLocked(currentTs);
+    } else {
+        releaseTiledYuvBufferLocked(&mPendingInputFrames[currentTs]);
     }
 
     return true;
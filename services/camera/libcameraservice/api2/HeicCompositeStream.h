@@ -188,6 +188,9 @@ private:
 
     void releaseInputFrameLocked(InputFrame *inputFrame /*out*/);
     void releaseInputFramesLocked(int64_t currentTs);
+    // Return the YUV buffer of a frame once all of its tiles were queued to the codec, so
+    // that the next capture can be tiled while this one is still being encoded.
+    void releaseTiledYuvBufferLocked(InputFrame *inputFrame /*out*/);
 
     size_t findAppSegmentsSize(const uint8_t* appSegmentBuffer, size_t maxSize,
             size_t* app1SegmentSize);
@@ -308,6 +308,7 @@ status_t CameraProviderManager::openSession(const std::string &id,
     if (deviceInfo == nullptr) return NAME_NOT_FOUND;
 
     auto *deviceInfo3 = static_cast<ProviderInfo::DeviceInfo3*>(deviceInfo);
+    nsecs_t startTime = systemTime();
     const sp<provider::V2_4::ICameraProvider> provider =
             deviceInfo->mParentProvider->startProviderInterface();
     if (provider == nullptr) {
@@ -322,6 +323,8 @@ status_t CameraProviderManager::openSession(const std::string &id,
     if (interface == nullptr) {
         return DEAD_OBJECT;
     }
+    nsecs_t interfaceTime = systemTime();
+    mOpenInterfaceLatency.add(startTime, interfaceTime);
 
     ret = interface->open(callback, [&status, &session]
             (Status s, const sp<device::V3_2::ICameraDeviceSession>& cameraSession) {
@@ -330,6 +333,11 @@ status_t CameraProviderManager::openSession(const std::string &id,
                     *session = cameraSession;
                 }
             });
+    nsecs_t openTime = systemTime();
+    mOpenLatency.add(interfaceTime, openTime);
+    ALOGV("%s: Camera %s: interface ready in %" PRId64 " ms, opened in %" PRId64 " ms",
+            __FUNCTION__, id.c_str(), ns2ms(interfaceTime - startTime),
+            ns2ms(openTime - interfaceTime));
     if (!ret.isOk()) {
         removeRef(DeviceMode::CAMERA, id);
         ALOGE("%s: Transaction error opening a session for camera device %s: %s",
@@ -458,6 +466,8 @@ status_t CameraProviderManager::dump(int fd, const Vector<String16>& args) {
     for (auto& provider : mProviders) {
         provider->dump(fd, args);
     }
+    mOpenInterfaceLatency.dump(fd, "Camera open: provider and device interface latency");
+    mOpenLatency.dump(fd, "Camera open: HAL open latency");
     return OK;
 }
 
@@ -1276,16 +1286,43 @@ status_t CameraProviderManager::ProviderInfo::initialize(
 
     mIsRemote = interface->isRemote();
 
-    sp<StatusListener> listener = mManager->getStatusListener();
+    // Fetching the static information of a device takes several HAL calls; do it for all
+    // devices of a remote provider at once. Passthrough HALs may not expect concurrent calls,
+    // and HAL1 devices are opened to read their parameters.
+    bool concurrent = mIsRemote && devices.size() > 1;
     for (auto& device : devices) {
-        std::string id;
-        status_t res = addDevice(device, common::V1_0::CameraDeviceStatus::PRESENT, &id);
+        uint16_t major, minor;
+        std::string type, id;
+        if (parseDeviceName(device, &major, &minor, &type, &id) != OK || major != 3) {
+            concurrent = false;
+        }
+    }
+    nsecs_t enumerateStart = systemTime();
+    std::vector<std::future<status_t>> pending;
+    std::vector<std::string> ids(devices.size());
+    std::vector<std::unique_ptr<DeviceInfo>> deviceInfos(devices.size());
+    if (concurrent) {
+        for (size_t i = 0; i < devices.size(); i++) {
+            pending.push_back(std::async(std::launch::async,
+                    [this, &devices, &ids, &deviceInfos, i]() {
+                        return createDeviceInfo(devices[i], &ids[i], &deviceInfos[i]);
+                    }));
+        }
+    }
+    for (size_t i = 0; i < devices.size(); i++) {
+        status_t res = pending.empty() ? createDeviceInfo(devices[i], &ids[i], &deviceInfos[i]) :
+                pending[i].get();
         if (res != OK) {
             ALOGE("%s: Unable to enumerate camera device '%s': %s (%d)",
-                    __FUNCTION__, device.c_str(), strerror(-res), res);
+                    __FUNCTION__, devices[i].c_str(), strerror(-res), res);
             continue;
         }
+        insertDevice(std::move(deviceInfos[i]), ids[i],
+                common::V1_0::CameraDeviceStatus::PRESENT);
     }
+    ALOGI("%s: Enumerated %zu camera devices of provider %s in %" PRId64 " ms%s",
+            __FUNCTION__, devices.size(), mProviderName.c_str(),
+            ns2ms(systemTime() - enumerateStart), pending.empty() ? "" : " (concurrently)");
 
     ALOGI("Camera provider %s ready with %zu camera devices",
             mProviderName.c_str(), mDevices.size());
@@ -1347,6 +1384,22 @@ const std::string& CameraProviderManager::ProviderInfo::getType() const {
 
 status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
         CameraDeviceStatus initialStatus, /*out*/ std::string* parsedId) {
+    std::string id;
+    std::unique_ptr<DeviceInfo> deviceInfo;
+    status_t res = createDeviceInfo(name, &id, &deviceInfo);
+    if (res != OK) {
+        return res;
+    }
+    insertDevice(std::move(deviceInfo), id, initialStatus);
+
+    if (parsedId != nullptr) {
+        *parsedId = id;
+    }
+    return OK;
+}
+
+status_t CameraProviderManager::ProviderInfo::createDeviceInfo(const std::string& name,
+        /*out*/ std::string *parsedId, /*out*/ std::unique_ptr<DeviceInfo> *deviceInfo) {
 
     ALOGI("Enumerating new camera device: %s", name.c_str());
 
@@ -1368,14 +1421,13 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
         return BAD_VALUE;
     }
 
-    std::unique_ptr<DeviceInfo> deviceInfo;
     switch (major) {
         case 1:
-            deviceInfo = initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid,
+            *deviceInfo = initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid,
                     id, minor);
             break;
         case 3:
-            deviceInfo = initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid,
+            *deviceInfo = initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid,
                     id, minor);
             break;
         default:
@@ -1383,7 +1435,14 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
                     name.c_str(), major);
             return BAD_VALUE;
     }
-    if (deviceInfo == nullptr) return BAD_VALUE;
+    if (*deviceInfo == nullptr) return BAD_VALUE;
+
+    *parsedId = id;
+    return OK;
+}
+
+void CameraProviderManager::ProviderInfo::insertDevice(std::unique_ptr<DeviceInfo> deviceInfo,
+        const std::string& id, CameraDeviceStatus initialStatus) {
     deviceInfo->mStatus = initialStatus;
     bool isAPI1Compatible = deviceInfo->isAPI1Compatible();
 
@@ -1398,11 +1457,6 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
             mUniqueAPI1CompatibleCameraIds.push_back(id);
         }
     }
-
-    if (parsedId != nullptr) {
-        *parsedId = id;
-    }
-    return OK;
 }
 
 void CameraProviderManager::ProviderInfo::removeDevice(std::string id) {
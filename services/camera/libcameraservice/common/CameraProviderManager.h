@@ -33,6 +33,8 @@
 #include <android/hidl/manager/1.0/IServiceNotification.h>
 #include <camera/VendorTagDescriptor.h>
 
+#include "utils/LatencyHistogram.h"
+
 namespace android {
 
 /**
@@ -285,6 +287,12 @@ private:
     // Current overall Android device physical status
     android::hardware::hidl_bitfield<hardware::camera::provider::V2_5::DeviceState> mDeviceState;
 
+    // Latency of the phases of openSession (HAL3 devices)
+    static constexpr int32_t kOpenInterfaceLatencyBinSize = 5; // in ms
+    static constexpr int32_t kOpenLatencyBinSize = 40; // in ms
+    CameraLatencyHistogram mOpenInterfaceLatency{kOpenInterfaceLatencyBinSize};
+    CameraLatencyHistogram mOpenLatency{kOpenLatencyBinSize};
+
     // mProviderLifecycleLock is locked during onRegistration and removeProvider
     mutable std::mutex mProviderLifecycleLock;
 
@@ -556,6 +564,16 @@ private:
         static metadata_vendor_id_t generateVendorTagId(const std::string &name);
 
         void removeDevice(std::string id);
+
+        // Parse and validate a device name and query the device's static information;
+        // does not modify the provider's device lists, so may run concurrently for several
+        // devices of the provider
+        status_t createDeviceInfo(const std::string& name, /*out*/ std::string *parsedId,
+                /*out*/ std::unique_ptr<DeviceInfo> *deviceInfo);
+
+        // Add a device created by createDeviceInfo to the device lists
+        void insertDevice(std::unique_ptr<DeviceInfo> deviceInfo, const std::string& id,
+                hardware::camera::common::V1_0::CameraDeviceStatus initialStatus);
     };
 
     // Utility to find a DeviceInfo by ID; pointer is only valid while mInterfaceMutex is held
@@ -31,6 +31,7 @@
 #include <dynamic_depth/pose.h>
 #include <dynamic_depth/profile.h>
 #include <dynamic_depth/profiles.h>
+#include <future>
 #include <jpeglib.h>
 #include <libexif/exif-data.h>
 #include <libexif/exif-system.h>
@@ -367,19 +368,19 @@ std::unique_ptr<dynamic_depth::DepthMap> processDepthMapFrame(DepthPhotoInputFra
         return nullptr;
     }
 
-    std::vector<uint8_t> pointsQuantized, confidenceQuantized;
-    pointsQuantized.reserve(pointCount); confidenceQuantized.reserve(pointCount);
-    auto pointIt = points.begin();
-    auto confidenceIt = confidence.begin();
-    while ((pointIt != points.end()) && (confidenceIt != confidence.end())) {
-        auto point = *pointIt;
-        if ((*confidenceIt) < CONFIDENCE_THRESHOLD) {
-            point = std::clamp(point, near, far);
-        }
-        pointsQuantized.push_back(floorf(((far * (point - near)) /
-                (point * (far - near))) * 255.0f));
-        confidenceQuantized.push_back(floorf(*confidenceIt * 255.0f));
-        confidenceIt++; pointIt++;
+    // Written by index into sized vectors, without branches, so that the compiler can
+    // vectorize the loop.
+    std::vector<uint8_t> pointsQuantized(pointCount), confidenceQuantized(pointCount);
+    const float* pointData = points.data();
+    const float* confidenceData = confidence.data();
+    const float range = far - near;
+    for (size_t i = 0; i < pointCount; i++) {
+        float point = pointData[i];
+        float clamped = std::clamp(point, near, far);
+        point = (confidenceData[i] < CONFIDENCE_THRESHOLD) ? clamped : point;
+        pointsQuantized[i] = static_cast<uint8_t>(floorf(((far * (point - near)) /
+                (point * range)) * 255.0f));
+        confidenceQuantized[i] = static_cast<uint8_t>(floorf(confidenceData[i] * 255.0f));
     }
 
     DepthMapParams depthParams(DepthFormat::kRangeInverse, near, far, DepthUnits::kMeters,
@@ -388,24 +389,30 @@ std::unique_ptr<dynamic_depth::DepthMap> processDepthMapFrame(DepthPhotoInputFra
     depthParams.mime = "image/jpeg";
     depthParams.depth_image_data.resize(inputFrame.mMaxJpegSize);
     depthParams.confidence_data.resize(inputFrame.mMaxJpegSize);
+    // The two maps are independent, so encode the confidence map on another thread while
+    // this one encodes the depth map.
+    size_t actualConfidenceSize = 0;
+    auto confidenceEncode = std::async(std::launch::async, [&]() {
+        return encodeGrayscaleJpeg(width, height, confidenceQuantized.data(),
+                depthParams.confidence_data.data(), inputFrame.mMaxJpegSize,
+                inputFrame.mJpegQuality, exifOrientation, actualConfidenceSize);
+    });
     size_t actualJpegSize;
     auto ret = encodeGrayscaleJpeg(width, height, pointsQuantized.data(),
             depthParams.depth_image_data.data(), inputFrame.mMaxJpegSize,
             inputFrame.mJpegQuality, exifOrientation, actualJpegSize);
+    auto confidenceRet = confidenceEncode.get();
     if (ret != NO_ERROR) {
         ALOGE("%s: Depth map compression failed!", __FUNCTION__);
         return nullptr;
     }
     depthParams.depth_image_data.resize(actualJpegSize);
 
-    ret = encodeGrayscaleJpeg(width, height, confidenceQuantized.data(),
-            depthParams.confidence_data.data(), inputFrame.mMaxJpegSize,
-            inputFrame.mJpegQuality, exifOrientation, actualJpegSize);
-    if (ret != NO_ERROR) {
+    if (confidenceRet != NO_ERROR) {
         ALOGE("%s: Confidence map compression failed!", __FUNCTION__);
         return nullptr;
     }
-    depthParams.confidence_data.resize(actualJpegSize);
+    depthParams.confidence_data.resize(actualConfidenceSize);
 
     return DepthMap::FromData(depthParams, items);
 }
@@ -236,6 +236,58 @@ status_t Camera3BufferManager::checkAndFreeBufferOnOtherStreamsLocked(
     return OK;
 }
 
+bool Camera3BufferManager::takeFreeBufferFromOtherStreamLocked(int streamId, int streamSetId,
+        GraphicBufferEntry* buffer) {
+    StreamSet &streamSet = mStreamSetMap.editValueFor(streamSetId);
+    const StreamInfo info = streamSet.streamInfoMap.valueFor(streamId);
+
+    StreamId otherStreamId = CAMERA3_STREAM_ID_INVALID;
+    for (size_t i = 0; i < streamSet.streamInfoMap.size(); i++) {
+        const StreamInfo& otherInfo = streamSet.streamInfoMap[i];
+        if (otherInfo.streamId == streamId ||
+                otherInfo.width != info.width || otherInfo.height != info.height ||
+                otherInfo.format != info.format ||
+                (otherInfo.combinedUsage & info.combinedUsage) != info.combinedUsage) {
+            continue;
+        }
+        if (streamSet.attachedBufferCountMap.valueFor(otherInfo.streamId) >
+                streamSet.handoutBufferCountMap.valueFor(otherInfo.streamId)) {
+            otherStreamId = otherInfo.streamId;
+            break;
+        }
+    }
+    if (otherStreamId == CAMERA3_STREAM_ID_INVALID) {
+        return false;
+    }
+
+    sp<Camera3OutputStream> stream = mStreamMap.valueFor(otherStreamId).promote();
+    if (stream == nullptr) {
+        return false;
+    }
+
+    // Same as in checkAndFreeBufferOnOtherStreamsLocked, the other stream may be calling into
+    // the buffer manager in parallel.
+    sp<GraphicBuffer> graphicBuffer;
+    int fenceFd = -1;
+    mLock.unlock();
+    stream->detachBuffer(&graphicBuffer, &fenceFd);
+    mLock.lock();
+    if (graphicBuffer == nullptr) {
+        return false;
+    }
+
+    ALOGV("%s: stream %d takes a buffer from stream %d of stream set %d", __FUNCTION__,
+            streamId, otherStreamId, streamSetId);
+    if (checkIfStreamRegisteredLocked(otherStreamId, streamSetId)) {
+        StreamSet &currentSet = mStreamSetMap.editValueFor(streamSetId);
+        currentSet.attachedBufferCountMap.editValueFor(otherStreamId)--;
+        currentSet.sharedBufferCount++;
+    }
+    buffer->graphicBuffer = graphicBuffer;
+    buffer->fenceFd = fenceFd;
+    return true;
+}
+
 status_t Camera3BufferManager::getBufferForStream(int streamId, int streamSetId,
         sp<GraphicBuffer>* gb, int* fenceFd, bool noFreeBufferAtConsumer) {
     ATRACE_CALL();
@@ -272,48 +324,71 @@ status_t Camera3BufferManager::getBufferForStream(int streamId, int streamSetId,
         bufferCount++;
         return ALREADY_EXISTS;
     }
-    ALOGV("Stream %d set %d: Get buffer for stream: Allocate new", streamId, streamSetId);
 
     if (mGrallocVersion < HARDWARE_DEVICE_API_VERSION(1,0)) {
-        const StreamInfo& info = streamSet.streamInfoMap.valueFor(streamId);
         GraphicBufferEntry buffer;
-        buffer.fenceFd = -1;
-        buffer.graphicBuffer = new GraphicBuffer(
-                info.width, info.height, PixelFormat(info.format), info.combinedUsage,
-                std::string("Camera3BufferManager pid [") +
-                        std::to_string(getpid()) + "]");
-        status_t res = buffer.graphicBuffer->initCheck();
-
-        ALOGV("%s: allocating a new graphic buffer (%dx%d, format 0x%x) %p with handle %p",
-                __FUNCTION__, info.width, info.height, info.format,
-                buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
-        if (res < 0) {
-            ALOGE("%s: graphic buffer allocation failed: (error %d %s) ",
-                    __FUNCTION__, res, strerror(-res));
-            return res;
+        bool takenFromOtherStream =
+                takeFreeBufferFromOtherStreamLocked(streamId, streamSetId, &buffer);
+        // mLock may have been released, so look up the stream set again.
+        if (!checkIfStreamRegisteredLocked(streamId, streamSetId)) {
+            ALOGE("%s: stream %d was unregistered from stream set %d",
+                    __FUNCTION__, streamId, streamSetId);
+            if (buffer.fenceFd >= 0) {
+                close(buffer.fenceFd);
+            }
+            return BAD_VALUE;
+        }
+        StreamSet &currentSet = mStreamSetMap.editValueFor(streamSetId);
+        if (takenFromOtherStream) {
+            ALOGV("Stream %d set %d: Get buffer for stream: Take from other stream",
+                    streamId, streamSetId);
+        } else {
+            ALOGV("Stream %d set %d: Get buffer for stream: Allocate new",
+                    streamId, streamSetId);
+            const StreamInfo& info = currentSet.streamInfoMap.valueFor(streamId);
+            buffer.fenceFd = -1;
+            buffer.graphicBuffer = new GraphicBuffer(
+                    info.width, info.height, PixelFormat(info.format), info.combinedUsage,
+                    std::string("Camera3BufferManager pid [") +
+                            std::to_string(getpid()) + "]");
+            status_t res = buffer.graphicBuffer->initCheck();
+
+            ALOGV("%s: allocating a new graphic buffer (%dx%d, format 0x%x) %p with handle %p",
+                    __FUNCTION__, info.width, info.height, info.format,
+                    buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
+            if (res < 0) {
+                ALOGE("%s: graphic buffer allocation failed: (error %d %s) ",
+                        __FUNCTION__, res, strerror(-res));
+                return res;
+            }
+            ALOGV("%s: allocation done", __FUNCTION__);
         }
-        ALOGV("%s: allocation done", __FUNCTION__);
 
         // Increase the hand-out and attached buffer counts for tracking purposes.
-        bufferCount++;
-        attachedBufferCount++;
+        size_t& handoutCount = currentSet.handoutBufferCountMap.editValueFor(streamId);
+        handoutCount++;
+        currentSet.attachedBufferCountMap.editValueFor(streamId)++;
         // Update the water mark to be the max hand-out buffer count + 1. An additional buffer is
         // added to reduce the chance of buffer allocation during stream steady state, especially
         // for cases where one stream is active, the other stream may request some buffers randomly.
-        if (bufferCount + 1 > streamSet.allocatedBufferWaterMark) {
-            streamSet.allocatedBufferWaterMark = bufferCount + 1;
+        if (handoutCount + 1 > currentSet.allocatedBufferWaterMark) {
+            currentSet.allocatedBufferWaterMark = handoutCount + 1;
         }
         *gb = buffer.graphicBuffer;
         *fenceFd = buffer.fenceFd;
         ALOGV("%s: get buffer (%p) with handle (%p).",
                 __FUNCTION__, buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
+        if (takenFromOtherStream) {
+            // The stream set still has as many buffers as before.
+            return OK;
+        }
 
         // Proactively free buffers for other streams if the current number of allocated buffers
         // exceeds the water mark. This only for Gralloc V1, for V2, this logic can also be handled
         // in returnBufferForStream() if we want to free buffer more quickly.
         // TODO: probably should find out all the inactive stream IDs, and free the firstly found
         // buffers for them.
-        res = checkAndFreeBufferOnOtherStreamsLocked(streamId, streamSetId);
+        status_t res = checkAndFreeBufferOnOtherStreamsLocked(streamId, streamSetId);
         if (res != OK) {
             return res;
         }
@@ -452,6 +527,8 @@ void Camera3BufferManager::dump(int fd, const Vector<String16>& args) const {
                 mStreamSetMap[i].maxAllowedBufferCount);
         lines.appendFormat("          Stream set buffer count water mark: %zu\n",
                 mStreamSetMap[i].allocatedBufferWaterMark);
+        lines.appendFormat("          Buffers taken from other streams: %zu\n",
+                mStreamSetMap[i].sharedBufferCount);
         lines.appendFormat("          Handout buffer counts:\n");
         for (size_t m = 0; m < mStreamSetMap[i].handoutBufferCountMap.size(); m++) {
             int streamId = mStreamSetMap[i].handoutBufferCountMap.keyAt(m);
@@ -105,8 +105,10 @@ public:
      * This method obtains a buffer for a stream from this buffer manager.
      *
      * This method returns the first free buffer from the free buffer list (associated with this
-     * stream set) if there is any. Otherwise, it will allocate a buffer for this stream, return
-     * it and increment its count of handed-out buffers. When the total number of allocated buffers
+     * stream set) if there is any. Otherwise, it will take a free buffer from another stream of
+     * the stream set that has the same size and format and a superset of the usage flags, or
+     * allocate a buffer for this stream when there is none, return it and increment its count
+     * of handed-out buffers. When the total number of allocated buffers
      * is too high, it may deallocate the unused buffers to save memory footprint of this stream
      * set.
      *
@@ -282,10 +284,16 @@ private:
          * An attached buffer may be free or handed out
          */
         BufferCountMap attachedBufferCountMap;
+        /**
+         * The number of buffers moved from one stream of this set to another instead of
+         * being allocated.
+         */
+        size_t sharedBufferCount;
 
         StreamSet() {
             allocatedBufferWaterMark = 0;
             maxAllowedBufferCount = 0;
+            sharedBufferCount = 0;
         }
     };
 
@@ -311,6 +319,14 @@ private:
      * free one if so.
      */
     status_t checkAndFreeBufferOnOtherStreamsLocked(int streamId, int streamSetId);
+
+    /**
+     * Detach a free buffer from another stream in the stream set whose buffers can be used by
+     * this stream, so that switching between the streams of a set doesn't need new allocations.
+     * mLock is released while detaching. Returns false if no such buffer was found.
+     */
+    bool takeFreeBufferFromOtherStreamLocked(int streamId, int streamSetId,
+            /*out*/GraphicBufferEntry* buffer);
 };
 
 } // namespace camera3
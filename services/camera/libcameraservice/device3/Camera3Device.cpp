@@ -412,6 +412,14 @@ status_t Camera3Device::disconnectImpl() {
 
     flushInflightRequests();
 
+    {
+        Mutex::Autolock l(mInFlightLock);
+        mResultLatency.log("Capture result latency histogram");
+        mResultLatency.reset();
+        mInFlightLockWait.log("In-flight registration lock wait histogram");
+        mInFlightLockWait.reset();
+    }
+
     {
         Mutex::Autolock l(mLock);
         mInterface->clear();
@@ -743,7 +751,10 @@ status_t Camera3Device::dump(int fd, const Vector<String16> &args) {
     if (mRequestThread != NULL) {
         mRequestThread->dumpCaptureRequestLatency(fd,
                 "    ProcessCaptureRequest latency histogram:");
+        mRequestThread->dumpRequestPreparation(fd);
     }
+    mResultLatency.dump(fd, "    Capture result latency histogram:");
+    mInFlightLockWait.dump(fd, "    In-flight registration lock wait histogram:");
 
     {
         lines = String8("    Last request sent:\n");
@@ -2743,11 +2754,16 @@ bool Camera3Device::reconfigureCamera(const CameraMetadata& sessionParams) {
     nsecs_t maxExpectedDuration = getExpectedInFlightDuration();
 
     Mutex::Autolock l(mLock);
+    nsecs_t startTime = systemTime();
     auto rc = internalPauseAndWaitLocked(maxExpectedDuration);
     if (rc == NO_ERROR) {
+        nsecs_t idleTime = systemTime();
         mNeedConfig = true;
         rc = configureStreamsLocked(mOperatingMode, sessionParams, /*notifyRequestThread*/ false);
         if (rc == NO_ERROR) {
+            ALOGI("%s: Camera %s: Session parameter reconfiguration took %" PRId64 " ms "
+                    "(%" PRId64 " ms for in-flight requests to drain)", __FUNCTION__,
+                    mId.string(), ns2ms(systemTime() - startTime), ns2ms(idleTime - startTime));
             ret = true;
             mPauseStateNotify = false;
             //Moving to active state while holding 'mLock' is important.
@@ -2947,9 +2963,9 @@ status_t Camera3Device::configureStreamsLocked(int operatingMode,
     char value[PROPERTY_VALUE_MAX];
     property_get("camera.fifo.disable", value, "0");
     int32_t disableFifo = atoi(value);
-    if (disableFifo != 1) {
+    pid_t requestThreadTid = mRequestThread->getTid();
+    if (disableFifo != 1 && requestThreadTid != mBoostedRequestThreadTid) {
         // Boost priority of request thread to SCHED_FIFO.
-        pid_t requestThreadTid = mRequestThread->getTid();
         res = requestPriority(getpid(), requestThreadTid,
                 kRequestThreadPriority, /*isForApp*/ false, /*asynchronous*/ false);
         if (res != OK) {
@@ -2957,6 +2973,7 @@ status_t Camera3Device::configureStreamsLocked(int operatingMode,
                     strerror(-res), res);
         } else {
             ALOGD("Set real time priority for request queue thread (tid %d)", requestThreadTid);
+            mBoostedRequestThreadTid = requestThreadTid;
         }
     }
 
@@ -3116,12 +3133,17 @@ status_t Camera3Device::registerInFlight(uint32_t frameNumber,
         std::set<String8>& physicalCameraIds, bool isStillCapture,
         bool isZslCapture, const SurfaceMap& outputSurfaces) {
     ATRACE_CALL();
+    // Built before taking the lock, which the result path holds while returning buffers
+    InFlightRequest request(numBuffers, resultExtras, hasInput, hasAppCallback,
+            maxExpectedDuration, physicalCameraIds, isStillCapture, isZslCapture,
+            outputSurfaces);
+    nsecs_t lockStart = systemTime();
     Mutex::Autolock l(mInFlightLock);
+    request.registeredTime = systemTime();
+    mInFlightLockWait.add(lockStart, request.registeredTime);
 
     ssize_t res;
-    res = mInFlightMap.add(frameNumber, InFlightRequest(numBuffers, resultExtras, hasInput,
-            hasAppCallback, maxExpectedDuration, physicalCameraIds, isStillCapture, isZslCapture,
-            outputSurfaces));
+    res = mInFlightMap.add(frameNumber, request);
     if (res < 0) return res;
 
     if (mInFlightMap.size() == 1) {
@@ -3263,6 +3285,7 @@ void Camera3Device::removeInFlightRequestIfReadyLocked(int idx) {
             request.pendingOutputBuffers.size(), 0, /*timestampIncreasing*/true,
             request.outputSurfaces, request.resultExtras);
 
+        mResultLatency.add(request.registeredTime, systemTime());
         removeInFlightMapEntryLocked(idx);
         ALOGVV("%s: removed frame %d from InFlightMap", __FUNCTION__, frameNumber);
      }
@@ -4898,6 +4921,10 @@ Camera3Device::RequestThread::RequestThread(wp<Camera3Device> parent,
             hardware::camera2::ICameraDeviceUser::NO_IN_FLIGHT_REPEATING_FRAMES),
         mPrepareVideoStream(false),
         mConstrainedMode(false),
+        mPrepareTimeNs(0),
+        mPreparedFrames(0),
+        mSettingsSent(0),
+        mSettingsReused(0),
         mRequestLatency(kRequestLatencyBinSize),
         mSessionParamKeys(sessionParamKeys),
         mLatestSessionParams(sessionParamKeys.size()),
@@ -5172,6 +5199,54 @@ void Camera3Device::RequestThread::checkAndStopRepeatingRequest() {
     }
 }
 
+bool Camera3Device::RequestThread::isLastSentSettings(
+        PhysicalCameraSettingsList& settings) const {
+    if (mPrevRequest == nullptr || settings.size() != mPrevSettings.size()) {
+        return false;
+    }
+    auto prev = mPrevSettings.begin();
+    for (auto it = settings.begin(); it != settings.end(); it++, prev++) {
+        if (it->cameraId != prev->cameraId) {
+            return false;
+        }
+        // both sorted, so that equal settings have equal entries at each index
+        it->metadata.sort();
+        const camera_metadata_t* buffer = it->metadata.getAndLock();
+        const camera_metadata_t* prevBuffer = prev->metadata.getAndLock();
+        size_t count = get_camera_metadata_entry_count(buffer);
+        bool same = (count == get_camera_metadata_entry_count(prevBuffer));
+        for (size_t i = 0; same && i < count; i++) {
+            camera_metadata_ro_entry_t entry, prevEntry;
+            get_camera_metadata_ro_entry(buffer, i, &entry);
+            get_camera_metadata_ro_entry(prevBuffer, i, &prevEntry);
+            if (entry.tag != prevEntry.tag || entry.count != prevEntry.count) {
+                same = false;
+            } else if (entry.tag != ANDROID_REQUEST_ID) {
+                // The id differs for each submission. It is not for the HAL: results get
+                // theirs from the in-flight request.
+                same = (memcmp(entry.data.u8, prevEntry.data.u8,
+                        camera_metadata_type_size[entry.type] * entry.count) == 0);
+            }
+        }
+        it->metadata.unlock(buffer);
+        prev->metadata.unlock(prevBuffer);
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Camera3Device::RequestThread::dumpRequestPreparation(int fd) {
+    uint32_t frames = mPreparedFrames;
+    uint32_t sent = mSettingsSent;
+    uint32_t reused = mSettingsReused;
+    dprintf(fd, "    Request preparation: %" PRId64 " us per frame over %u frames\n",
+            frames > 0 ? (int64_t)(mPrepareTimeNs / frames / 1000) : 0, frames);
+    dprintf(fd, "    New request settings: %u sent, %u equal to the last ones and not sent\n",
+            sent, reused);
+}
+
 bool Camera3Device::RequestThread::sendRequestsBatch() {
     ATRACE_CALL();
     status_t res;
@@ -5434,7 +5509,10 @@ bool Camera3Device::RequestThread::threadLoop() {
     }
 
     // Prepare a batch of HAL requests and output buffers.
+    nsecs_t tPrepareStart = systemTime(SYSTEM_TIME_MONOTONIC);
     res = prepareHalRequests();
+    mPrepareTimeNs += systemTime(SYSTEM_TIME_MONOTONIC) - tPrepareStart;
+    mPreparedFrames += mNextRequests.size();
     if (res == TIMED_OUT) {
         // Not a fatal error if getting output buffers time out.
         cleanUpFailedRequests(/*sendRequestError*/ true);
@@ -5567,8 +5645,23 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
              *   are O(logn). Sidenote, sorting a sorted metadata is nop.
              */
             captureRequest->mSettingsList.begin()->metadata.sort();
-            halRequest->settings = captureRequest->mSettingsList.begin()->metadata.getAndLock();
+            // Triggers must reach the HAL with each request that has them.
+            bool sameSettings = !triggersMixedIn &&
+                    isLastSentSettings(captureRequest->mSettingsList);
             mPrevRequest = captureRequest;
+            if (sameSettings) {
+                // e.g. the same capture submitted again, or a repeating request replaced by
+                // an equal one. The HAL reuses what it has, as for the same request.
+                newRequest = false;
+                mSettingsReused++;
+                ALOGVV("%s: Request settings are REUSED from another request", __FUNCTION__);
+            } else {
+                mPrevSettings = captureRequest->mSettingsList;
+                mSettingsSent++;
+            }
+        }
+        if (newRequest) {
+            halRequest->settings = captureRequest->mSettingsList.begin()->metadata.getAndLock();
             ALOGVV("%s: Request settings are NEW", __FUNCTION__);
 
             IF_ALOGV() {
@@ -5589,6 +5682,7 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
             // leave request.settings NULL to indicate 'reuse latest given'
             ALOGVV("%s: Request settings are REUSED",
                    __FUNCTION__);
+            halRequest->settings = NULL;
         }
 
         if (captureRequest->mSettingsList.size() > 1) {
@@ -5872,9 +5966,8 @@ void Camera3Device::RequestThread::signalPipelineDrain(const std::vector<int>& s
 
 nsecs_t Camera3Device::getExpectedInFlightDuration() {
     ATRACE_CALL();
-    Mutex::Autolock al(mInFlightLock);
-    return mExpectedInflightDuration > kMinInflightDuration ?
-            mExpectedInflightDuration : kMinInflightDuration;
+    nsecs_t duration = mExpectedInflightDuration;
+    return duration > kMinInflightDuration ? duration : kMinInflightDuration;
 }
 
 void Camera3Device::RequestThread::cleanupPhysicalSettings(sp<CaptureRequest> request,
@@ -6099,6 +6192,7 @@ sp<Camera3Device::CaptureRequest>
     // request if so. Can't use 'NULL request == repeat' across configure calls.
     if (mReconfigured) {
         mPrevRequest.clear();
+        mPrevSettings.clear();
         mReconfigured = false;
     }
 
@@ -17,6 +17,7 @@
 #ifndef ANDROID_SERVERS_CAMERA3DEVICE_H
 #define ANDROID_SERVERS_CAMERA3DEVICE_H
 
+#include <atomic>
 #include <utility>
 #include <unordered_map>
 #include <set>
@@ -837,6 +838,9 @@ class Camera3Device :
             mRequestLatency.dump(fd, name);
         }
 
+        // dump time spent preparing HAL requests, and how often settings were resent
+        void dumpRequestPreparation(int fd);
+
         void signalPipelineDrain(const std::vector<int>& streamIds);
 
       protected:
@@ -879,6 +883,10 @@ class Camera3Device :
         // request batch.
         status_t prepareHalRequests();
 
+        // Whether the HAL already has |settings|, so that they need not be sent again even
+        // though they come with a different request. Sorts the settings.
+        bool isLastSentSettings(PhysicalCameraSettingsList& settings) const;
+
         // Return buffers, etc, for requests in mNextRequests that couldn't be fully constructed and
         // send request errors if sendRequestError is true. The buffers will be returned in the
         // ERROR state to mark them as not having valid data. mNextRequests will be cleared.
@@ -955,6 +963,14 @@ class Camera3Device :
 
         sp<CaptureRequest> mPrevRequest;
         int32_t            mPrevTriggers;
+        // settings last given to the HAL, valid as long as mPrevRequest is set
+        PhysicalCameraSettingsList mPrevSettings;
+
+        // Only updated by the request thread, read without a lock for dumps.
+        nsecs_t            mPrepareTimeNs;
+        uint32_t           mPreparedFrames;
+        uint32_t           mSettingsSent;
+        uint32_t           mSettingsReused;
 
         uint32_t           mFrameNumber;
 
@@ -989,6 +1005,9 @@ class Camera3Device :
         const bool         mUseHalBufManager;
     };
     sp<RequestThread> mRequestThread;
+    // Request thread already moved to SCHED_FIFO, so that reconfigurations skip the
+    // synchronous scheduling policy call
+    pid_t mBoostedRequestThreadTid = 0;
 
     /**
      * In-flight queue for tracking completion of capture requests.
@@ -1056,6 +1075,9 @@ class Camera3Device :
         // What shared surfaces an output should go to
         SurfaceMap outputSurfaces;
 
+        // When the request was registered, for the result latency histogram
+        nsecs_t registeredTime;
+
         // Default constructor needed by KeyedVector
         InFlightRequest() :
                 shutterTimestamp(0),
@@ -1068,7 +1090,8 @@ class Camera3Device :
                 maxExpectedDuration(kDefaultExpectedDuration),
                 skipResultMetadata(false),
                 stillCapture(false),
-                zslCapture(false) {
+                zslCapture(false),
+                registeredTime(0) {
         }
 
         InFlightRequest(int numBuffers, CaptureResultExtras extras, bool hasInput,
@@ -1089,7 +1112,8 @@ class Camera3Device :
                 physicalCameraIds(physicalCameraIdSet),
                 stillCapture(isStillCapture),
                 zslCapture(isZslCapture),
-                outputSurfaces(outSurfaces) {
+                outputSurfaces(outSurfaces),
+                registeredTime(0) {
         }
     };
 
@@ -1097,12 +1121,21 @@ class Camera3Device :
     typedef KeyedVector<uint32_t, InFlightRequest> InFlightMap;
 
 
-    Mutex                  mInFlightLock; // Protects mInFlightMap and
-                                          // mExpectedInflightDuration
+    Mutex                  mInFlightLock; // Protects mInFlightMap and the histograms
+                                          // below. Changes to mExpectedInflightDuration
+                                          // are also made with it held.
     InFlightMap            mInFlightMap;
-    nsecs_t                mExpectedInflightDuration = 0;
+    // Read by the request thread for every request, so without mInFlightLock
+    std::atomic<nsecs_t>   mExpectedInflightDuration{0};
     int                    mInFlightStatusId;
 
+    // Time from registering a request until all of its results and buffers were
+    // delivered, and time spent waiting for mInFlightLock to register a request.
+    static const int32_t   kResultLatencyBinSize = 40; // in ms
+    static const int32_t   kInFlightLockWaitBinSize = 1; // in ms
+    CameraLatencyHistogram mResultLatency{kResultLatencyBinSize};
+    CameraLatencyHistogram mInFlightLockWait{kInFlightLockWaitBinSize};
+
     status_t registerInFlight(uint32_t frameNumber,
             int32_t numBuffers, CaptureResultExtras resultExtras, bool hasInput,
             bool callback, nsecs_t maxExpectedDuration, std::set<String8>& physicalCameraIds,
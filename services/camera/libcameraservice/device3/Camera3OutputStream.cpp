@@ -47,7 +47,8 @@ Camera3OutputStream::Camera3OutputStream(int id,
         mTimestampOffset(timestampOffset),
         mConsumerUsage(0),
         mDropBuffers(false),
-        mDequeueBufferLatency(kDequeueLatencyBinSize) {
+        mDequeueBufferLatency(kDequeueLatencyBinSize),
+        mQueueBufferLatency(kQueueLatencyBinSize) {
 
     if (mConsumer == NULL) {
         ALOGE("%s: Consumer is NULL!", __FUNCTION__);
@@ -74,7 +75,8 @@ Camera3OutputStream::Camera3OutputStream(int id,
         mTimestampOffset(timestampOffset),
         mConsumerUsage(0),
         mDropBuffers(false),
-        mDequeueBufferLatency(kDequeueLatencyBinSize) {
+        mDequeueBufferLatency(kDequeueLatencyBinSize),
+        mQueueBufferLatency(kQueueLatencyBinSize) {
 
     if (format != HAL_PIXEL_FORMAT_BLOB && format != HAL_PIXEL_FORMAT_RAW_OPAQUE) {
         ALOGE("%s: Bad format for size-only stream: %d", __FUNCTION__,
@@ -107,7 +109,8 @@ Camera3OutputStream::Camera3OutputStream(int id,
         mTimestampOffset(timestampOffset),
         mConsumerUsage(consumerUsage),
         mDropBuffers(false),
-        mDequeueBufferLatency(kDequeueLatencyBinSize) {
+        mDequeueBufferLatency(kDequeueLatencyBinSize),
+        mQueueBufferLatency(kQueueLatencyBinSize) {
     // Deferred consumer only support preview surface format now.
     if (format != HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED) {
         ALOGE("%s: Deferred consumer only supports IMPLEMENTATION_DEFINED format now!",
@@ -149,7 +152,8 @@ Camera3OutputStream::Camera3OutputStream(int id, camera3_stream_type_t type,
         mTimestampOffset(timestampOffset),
         mConsumerUsage(consumerUsage),
         mDropBuffers(false),
-        mDequeueBufferLatency(kDequeueLatencyBinSize) {
+        mDequeueBufferLatency(kDequeueLatencyBinSize),
+        mQueueBufferLatency(kQueueLatencyBinSize) {
 
     if (setId > CAMERA3_STREAM_SET_ID_INVALID) {
         mBufferReleasedListener = new BufferReleasedListener(this);
@@ -237,6 +241,8 @@ status_t Camera3OutputStream::returnBufferCheckedLocked(
     mLock.unlock();
 
     ANativeWindowBuffer *anwBuffer = container_of(buffer.buffer, ANativeWindowBuffer, handle);
+    // Time the HAL callback thread spends handing the buffer to the consumer
+    nsecs_t returnStart = systemTime(SYSTEM_TIME_MONOTONIC);
     /**
      * Return buffer back to ANativeWindow
      */
@@ -276,11 +282,13 @@ status_t Camera3OutputStream::returnBufferCheckedLocked(
         /* Certain consumers (such as AudioSource or HardwareComposer) use
          * MONOTONIC time, causing time misalignment if camera timestamp is
          * in BOOTTIME. Do the conversion if necessary. */
-        res = native_window_set_buffers_timestamp(mConsumer.get(),
+        res = native_window_set_buffers_timestamp(currentConsumer.get(),
                 mUseMonoTimestamp ? timestamp - mTimestampOffset : timestamp);
         if (res != OK) {
             ALOGE("%s: Stream %d: Error setting timestamp: %s (%d)",
                   __FUNCTION__, mId, strerror(-res), res);
+            mLock.lock();
+            close(anwReleaseFence);
             return res;
         }
 
@@ -290,7 +298,9 @@ status_t Camera3OutputStream::returnBufferCheckedLocked(
                   " %s (%d)", __FUNCTION__, mId, strerror(-res), res);
         }
     }
+    nsecs_t returnEnd = systemTime(SYSTEM_TIME_MONOTONIC);
     mLock.lock();
+    mQueueBufferLatency.add(returnStart, returnEnd);
 
     // Once a valid buffer has been returned to the queue, can no longer
     // dequeue all buffers for preallocation.
@@ -318,6 +328,8 @@ void Camera3OutputStream::dump(int fd, const Vector<String16> &args) const {
 
     mDequeueBufferLatency.dump(fd,
         "      DequeueBuffer latency histogram:");
+    mQueueBufferLatency.dump(fd,
+        "      QueueBuffer latency histogram:");
 }
 
 status_t Camera3OutputStream::setTransform(int transform) {
@@ -710,6 +722,8 @@ status_t Camera3OutputStream::disconnectLocked() {
 
     mDequeueBufferLatency.log("Stream %d dequeueBuffer latency histogram", mId);
     mDequeueBufferLatency.reset();
+    mQueueBufferLatency.log("Stream %d queueBuffer latency histogram", mId);
+    mQueueBufferLatency.reset();
     return OK;
 }
 
@@ -324,6 +324,10 @@ class Camera3OutputStream :
     static const int32_t kDequeueLatencyBinSize = 5; // in ms
     CameraLatencyHistogram mDequeueBufferLatency;
 
+    // queueBuffer or cancelBuffer, done on the HAL result callback thread
+    static const int32_t kQueueLatencyBinSize = 5; // in ms
+    CameraLatencyHistogram mQueueBufferLatency;
+
 }; // class Camera3OutputStream
 
 } // namespace camera3
@@ -100,6 +100,18 @@ status_t Camera3SharedOutputStream::attachBufferToSplitterLocked(
     return res;
 }
 
+void Camera3SharedOutputStream::dump(int fd, const Vector<String16> &args) const {
+    Camera3OutputStream::dump(fd, args);
+
+    sp<Camera3StreamSplitter> splitter;
+    {
+        Mutex::Autolock l(mLock);
+        splitter = mStreamSplitter;
+    }
+    if (splitter != nullptr) {
+        splitter->dump(fd);
+    }
+}
 
 status_t Camera3SharedOutputStream::notifyBufferReleased(ANativeWindowBuffer *anwBuffer) {
     Mutex::Autolock l(mLock);
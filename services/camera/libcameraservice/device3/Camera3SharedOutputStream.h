@@ -43,6 +43,8 @@ public:
 
     virtual ~Camera3SharedOutputStream();
 
+    virtual void dump(int fd, const Vector<String16> &args) const override;
+
     virtual status_t notifyBufferReleased(ANativeWindowBuffer *buffer);
 
     virtual bool isConsumerConfigurationDeferred(size_t surface_id) const;
@@ -67,6 +67,8 @@ Camera3Stream::Camera3Stream(int id,
     mPreparedBufferIdx(0),
     mLastMaxCount(Camera3StreamInterface::ALLOCATE_PIPELINE_MAX),
     mBufferLimitLatency(kBufferLimitLatencyBinSize),
+    mHalBufferLatency(kHalBufferLatencyBinSize),
+    mErrorBufferCount(0),
     mFormatOverridden(false),
     mOriginalFormat(format),
     mDataSpaceOverridden(false),
@@ -637,7 +639,7 @@ status_t Camera3Stream::getBuffer(camera3_stream_buffer *buffer,
         fireBufferListenersLocked(*buffer, /*acquired*/true, /*output*/true);
         if (buffer->buffer) {
             Mutex::Autolock l(mOutstandingBuffersLock);
-            mOutstandingBuffers.push_back(*buffer->buffer);
+            mOutstandingBuffers.push_back({*buffer->buffer, systemTime()});
         }
     }
 
@@ -651,27 +653,29 @@ bool Camera3Stream::isOutstandingBuffer(const camera3_stream_buffer &buffer) con
 
     Mutex::Autolock l(mOutstandingBuffersLock);
 
-    for (auto b : mOutstandingBuffers) {
-        if (b == *buffer.buffer) {
+    for (const auto& b : mOutstandingBuffers) {
+        if (b.handle == *buffer.buffer) {
             return true;
         }
     }
     return false;
 }
 
-void Camera3Stream::removeOutstandingBuffer(const camera3_stream_buffer &buffer) {
+nsecs_t Camera3Stream::removeOutstandingBuffer(const camera3_stream_buffer &buffer) {
     if (buffer.buffer == nullptr) {
-        return;
+        return 0;
     }
 
     Mutex::Autolock l(mOutstandingBuffersLock);
 
     for (auto b = mOutstandingBuffers.begin(); b != mOutstandingBuffers.end(); b++) {
-        if (*b == *buffer.buffer) {
+        if (b->handle == *buffer.buffer) {
+            nsecs_t handoutTime = b->handoutTime;
             mOutstandingBuffers.erase(b);
-            return;
+            return handoutTime;
         }
     }
+    return 0;
 }
 
 status_t Camera3Stream::returnBuffer(const camera3_stream_buffer &buffer,
@@ -686,7 +690,13 @@ status_t Camera3Stream::returnBuffer(const camera3_stream_buffer &buffer,
         return BAD_VALUE;
     }
 
-    removeOutstandingBuffer(buffer);
+    nsecs_t handoutTime = removeOutstandingBuffer(buffer);
+    if (handoutTime != 0) {
+        mHalBufferLatency.add(handoutTime, systemTime());
+    }
+    if (buffer.status == CAMERA3_BUFFER_STATUS_ERROR) {
+        mErrorBufferCount++;
+    }
 
     // Buffer status may be changed, so make a copy of the stream_buffer struct.
     camera3_stream_buffer b = buffer;
@@ -748,7 +758,7 @@ status_t Camera3Stream::getInputBuffer(camera3_stream_buffer *buffer, bool respe
         fireBufferListenersLocked(*buffer, /*acquired*/true, /*output*/false);
         if (buffer->buffer) {
             Mutex::Autolock l(mOutstandingBuffersLock);
-            mOutstandingBuffers.push_back(*buffer->buffer);
+            mOutstandingBuffers.push_back({*buffer->buffer, systemTime()});
         }
     }
 
@@ -858,6 +868,10 @@ status_t Camera3Stream::disconnect() {
 
     mBufferLimitLatency.log("Stream %d latency histogram for wait on max_buffers", mId);
     mBufferLimitLatency.reset();
+    mHalBufferLatency.log("Stream %d latency histogram for output buffers held by the HAL "
+            "(%zu returned with error)", mId, mErrorBufferCount);
+    mHalBufferLatency.reset();
+    mErrorBufferCount = 0;
 
     if (res == -ENOTCONN) {
         // "Already disconnected" -- not an error
@@ -872,6 +886,11 @@ void Camera3Stream::dump(int fd, const Vector<String16> &args) const
     (void)args;
     mBufferLimitLatency.dump(fd,
             "      Latency histogram for wait on max_buffers");
+    String8 lines = String8::format("      Output buffers returned with error: %zu\n",
+            mErrorBufferCount);
+    write(fd, lines.string(), lines.size());
+    mHalBufferLatency.dump(fd,
+            "      Latency histogram for output buffers held by the HAL");
 }
 
 status_t Camera3Stream::getBufferLocked(camera3_stream_buffer *,
@@ -557,7 +557,8 @@ class Camera3Stream :
     status_t        cancelPrepareLocked();
 
     // Remove the buffer from the list of outstanding buffers.
-    void removeOutstandingBuffer(const camera3_stream_buffer& buffer);
+    // Returns the time the buffer was handed out, or 0 if it is not outstanding
+    nsecs_t removeOutstandingBuffer(const camera3_stream_buffer& buffer);
 
     // Tracking for PREPARING state
 
@@ -575,13 +576,23 @@ class Camera3Stream :
 
     mutable Mutex mOutstandingBuffersLock;
     // Outstanding buffers dequeued from the stream's buffer queue.
-    List<buffer_handle_t> mOutstandingBuffers;
+    struct OutstandingBuffer {
+        buffer_handle_t handle;
+        nsecs_t handoutTime;
+    };
+    List<OutstandingBuffer> mOutstandingBuffers;
 
     // Latency histogram of the wait time for handout buffer count to drop below
     // max_buffers.
     static const int32_t kBufferLimitLatencyBinSize = 33; //in ms
     CameraLatencyHistogram mBufferLimitLatency;
 
+    // Latency histogram of the time output buffers spend between being handed out for a
+    // request and being returned by the HAL, and count of those returned with an error.
+    static const int32_t kHalBufferLatencyBinSize = 20; // in ms
+    CameraLatencyHistogram mHalBufferLatency;
+    size_t mErrorBufferCount;
+
     //Keep track of original format when the stream is created in case it gets overridden
     bool mFormatOverridden;
     const int mOriginalFormat;
@@ -138,6 +138,10 @@ void Camera3StreamSplitter::disconnect() {
     mOutputs.clear();
     mOutputSlots.clear();
     mConsumerBufferCount.clear();
+    for (auto& latency : mOutputLatency) {
+        latency.second.log("Output %zu latency histogram", latency.first);
+    }
+    mOutputLatency.clear();
 
     mConsumer->consumerDisconnect();
 
@@ -152,6 +156,16 @@ void Camera3StreamSplitter::disconnect() {
     SP_LOGV("%s: Disconnected", __FUNCTION__);
 }
 
+void Camera3StreamSplitter::dump(int fd) {
+    Mutex::Autolock lock(mMutex);
+    for (auto& latency : mOutputLatency) {
+        String8 name = String8::format(
+                "      Output surface %zu latency histogram (acquire to queued):",
+                latency.first);
+        latency.second.dump(fd, name.string());
+    }
+}
+
 Camera3StreamSplitter::Camera3StreamSplitter(bool useHalBufManager) :
         mUseHalBufManager(useHalBufManager) {}
 
@@ -315,6 +329,7 @@ status_t Camera3StreamSplitter::removeOutputLocked(size_t surfaceId) {
     }
     mOutputs[surfaceId] = nullptr;
     mOutputSlots[gbp] = nullptr;
+    mOutputLatency.erase(surfaceId);
     for (const auto &id : pendingBufferIds) {
         decrementBufRefCountLocked(id, surfaceId);
     }
@@ -338,54 +353,94 @@ status_t Camera3StreamSplitter::removeOutputLocked(size_t surfaceId) {
     return res;
 }
 
-status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProducer>& output,
-        const BufferItem& bufferItem, size_t surfaceId) {
+status_t Camera3StreamSplitter::outputBufferLocked(const std::vector<size_t>& surfaceIds,
+        const BufferItem& bufferItem, nsecs_t acquireTime) {
     ATRACE_CALL();
-    status_t res;
+    status_t res = OK;
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
             bufferItem.mDataSpace, bufferItem.mCrop,
             static_cast<int32_t>(bufferItem.mScalingMode),
             bufferItem.mTransform, bufferItem.mFence);
 
-    IGraphicBufferProducer::QueueBufferOutput queueOutput;
+    struct PendingOutput {
+        size_t surfaceId;
+        sp<IGraphicBufferProducer> output;
+        int slot;
+        IGraphicBufferProducer::QueueBufferOutput queueOutput;
+        status_t res;
+    };
+    std::vector<PendingOutput> pendingOutputs;
+    pendingOutputs.reserve(surfaceIds.size());
 
     uint64_t bufferId = bufferItem.mGraphicBuffer->getId();
     const BufferTracker& tracker = *(mBuffers[bufferId]);
-    int slot = getSlotForOutputLocked(output, tracker.getBuffer());
+    for (const auto id : surfaceIds) {
+        if (mOutputs[id] == nullptr) {
+            //Output surface got likely removed by client.
+            continue;
+        }
+        PendingOutput pending;
+        pending.surfaceId = id;
+        pending.output = mOutputs[id];
+        pending.slot = getSlotForOutputLocked(pending.output, tracker.getBuffer());
+        pending.res = OK;
+        pendingOutputs.push_back(pending);
+    }
 
     // In case the output BufferQueue has its own lock, if we hold splitter lock while calling
     // queueBuffer (which will try to acquire the output lock), the output could be holding its
     // own lock calling releaseBuffer (which  will try to acquire the splitter lock), running into
-    // circular lock situation.
+    // circular lock situation. Release it once for all outputs, so that later outputs don't
+    // also wait for the lock behind the release callbacks of earlier ones.
+    std::vector<nsecs_t> queuedTimes(pendingOutputs.size());
     mMutex.unlock();
-    res = output->queueBuffer(slot, queueInput, &queueOutput);
+    for (size_t i = 0; i < pendingOutputs.size(); i++) {
+        PendingOutput& pending = pendingOutputs[i];
+        pending.res = pending.output->queueBuffer(pending.slot, queueInput,
+                &pending.queueOutput);
+        queuedTimes[i] = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
     mMutex.lock();
 
-    SP_LOGV("%s: Queuing buffer to buffer queue %p slot %d returns %d",
-            __FUNCTION__, output.get(), slot, res);
-    //During buffer queue 'mMutex' is not held which makes the removal of
-    //"output" possible. Check whether this is the case and return.
-    if (mOutputSlots[output] == nullptr) {
-        return res;
-    }
-    if (res != OK) {
-        if (res != NO_INIT && res != DEAD_OBJECT) {
-            SP_LOGE("Queuing buffer to output failed (%d)", res);
+    for (size_t i = 0; i < pendingOutputs.size(); i++) {
+        const PendingOutput& pending = pendingOutputs[i];
+        SP_LOGV("%s: Queuing buffer to buffer queue %p slot %d returns %d",
+                __FUNCTION__, pending.output.get(), pending.slot, pending.res);
+        //During buffer queue 'mMutex' is not held which makes the removal of
+        //"output" possible. Check whether this is the case and continue.
+        if (mOutputSlots[pending.output] == nullptr) {
+            if (pending.res != OK) {
+                res = pending.res;
+            }
+            continue;
+        }
+        if (pending.res != OK) {
+            if (pending.res != NO_INIT && pending.res != DEAD_OBJECT) {
+                SP_LOGE("Queuing buffer to output failed (%d)", pending.res);
+            }
+            // If we just discovered that this output has been abandoned, note
+            // that, increment the release count so that we still release this
+            // buffer eventually, and move on to the next output
+            onAbandonedLocked();
+            decrementBufRefCountLocked(bufferId, pending.surfaceId);
+            res = pending.res;
+            continue;
         }
-        // If we just discovered that this output has been abandoned, note
-        // that, increment the release count so that we still release this
-        // buffer eventually, and move on to the next output
-        onAbandonedLocked();
-        decrementBufRefCountLocked(bufferItem.mGraphicBuffer->getId(), surfaceId);
-        return res;
-    }
 
-    // If the queued buffer replaces a pending buffer in the async
-    // queue, no onBufferReleased is called by the buffer queue.
-    // Proactively trigger the callback to avoid buffer loss.
-    if (queueOutput.bufferReplaced) {
-        onBufferReplacedLocked(output, surfaceId);
+        auto latency = mOutputLatency.find(pending.surfaceId);
+        if (latency == mOutputLatency.end()) {
+            latency = mOutputLatency.emplace(pending.surfaceId,
+                    CameraLatencyHistogram(kOutputLatencyBinSize)).first;
+        }
+        latency->second.add(acquireTime, queuedTimes[i]);
+
+        // If the queued buffer replaces a pending buffer in the async
+        // queue, no onBufferReleased is called by the buffer queue.
+        // Proactively trigger the callback to avoid buffer loss.
+        if (pending.queueOutput.bufferReplaced) {
+            onBufferReplacedLocked(pending.output, pending.surfaceId);
+        }
     }
 
     return res;
@@ -482,6 +537,7 @@ void Camera3StreamSplitter::onFrameAvailable(const BufferItem& /*item*/) {
     // Acquire and detach the buffer from the input
     BufferItem bufferItem;
     status_t res = mConsumer->acquireBuffer(&bufferItem, /* presentWhen */ 0);
+    nsecs_t acquireTime = systemTime(SYSTEM_TIME_MONOTONIC);
     if (res != NO_ERROR) {
         SP_LOGE("%s: Acquiring buffer from input failed (%d)", __FUNCTION__, res);
         mOnFrameAvailableRes.store(res);
@@ -521,21 +577,10 @@ void Camera3StreamSplitter::onFrameAvailable(const BufferItem& /*item*/) {
 
     SP_LOGV("%s: BufferTracker for buffer %" PRId64 ", number of requests %zu",
            __FUNCTION__, bufferItem.mGraphicBuffer->getId(), tracker.requestedSurfaces().size());
-    for (const auto id : tracker.requestedSurfaces()) {
-
-        if (mOutputs[id] == nullptr) {
-            //Output surface got likely removed by client.
-            continue;
-        }
-
-        res = outputBufferLocked(mOutputs[id], bufferItem, id);
-        if (res != OK) {
-            SP_LOGE("%s: outputBufferLocked failed %d", __FUNCTION__, res);
-            mOnFrameAvailableRes.store(res);
-            // If we fail to send buffer to certain output, keep sending to
-            // other outputs.
-            continue;
-        }
+    // If we fail to send buffer to certain output, it is still sent to the other outputs.
+    res = outputBufferLocked(tracker.requestedSurfaces(), bufferItem, acquireTime);
+    if (res != OK) {
+        SP_LOGE("%s: outputBufferLocked failed %d", __FUNCTION__, res);
     }
 
     mOnFrameAvailableRes.store(res);
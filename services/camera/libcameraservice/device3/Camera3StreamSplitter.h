@@ -28,6 +28,8 @@
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
+#include "utils/LatencyHistogram.h"
+
 #define SP_LOGV(x, ...) ALOGV("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
 #define SP_LOGI(x, ...) ALOGI("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
 #define SP_LOGW(x, ...) ALOGW("[%s] " x, mConsumerName.string(), ##__VA_ARGS__)
@@ -91,6 +93,9 @@ public:
     // Disconnect the buffer queue from output surfaces.
     void disconnect();
 
+    // Dump how long each output waits for its buffers after they are queued to the input.
+    void dump(int fd);
+
 private:
     // From IConsumerListener
     //
@@ -205,11 +210,11 @@ private:
 
     status_t removeOutputLocked(size_t surfaceId);
 
-    // Send a buffer to particular output, and increment the reference count
-    // of the buffer. If this output is abandoned, the buffer's reference count
-    // won't be incremented.
-    status_t outputBufferLocked(const sp<IGraphicBufferProducer>& output,
-            const BufferItem& bufferItem, size_t surfaceId);
+    // Send a buffer to the given outputs. mMutex is released once around all of the
+    // queueBuffer calls. If an output is abandoned, the buffer's reference count is
+    // decremented for it. Returns the last error, if any.
+    status_t outputBufferLocked(const std::vector<size_t>& surfaceIds,
+            const BufferItem& bufferItem, nsecs_t acquireTime);
 
     // Get unique name for the buffer queue consumer
     String8 getUniqueConsumerName();
@@ -275,6 +280,11 @@ private:
     // Currently acquired input buffers
     size_t mAcquiredInputBuffers;
 
+    // Map surface ids -> time from acquiring a buffer from the input until it was queued to
+    // that output
+    static const int32_t kOutputLatencyBinSize = 2; // in ms
+    std::unordered_map<size_t, CameraLatencyHistogram> mOutputLatency;
+
     String8 mConsumerName;
 
     const bool mUseHalBufManager;
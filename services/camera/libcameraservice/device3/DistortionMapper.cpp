@@ -235,7 +235,7 @@ status_t DistortionMapper::mapRawToCorrected(int32_t *coordPairs, int coordCount
     }
 
     for (int i = 0; i < coordCount * 2; i += 2) {
-        const GridQuad *quad = findEnclosingQuad(coordPairs + i, mDistortedGrid);
+        const GridQuad *quad = findEnclosingDistortedQuad(coordPairs + i);
         if (quad == nullptr) {
             ALOGE("Raw to corrected mapping failure: No quad found for (%d, %d)",
                     *(coordPairs + i), *(coordPairs + i + 1));
@@ -446,47 +446,113 @@ status_t DistortionMapper::buildGrids() {
         }
     }
 
+    // Bucket the distorted quads by bounding box, so that a point only needs to be tested
+    // against the few quads near it instead of the whole grid.
+    float minX = mDistortedGrid[0].coords[0], maxX = minX;
+    float minY = mDistortedGrid[0].coords[1], maxY = minY;
+    for (const GridQuad& quad : mDistortedGrid) {
+        for (size_t c = 0; c < quad.coords.size(); c += 2) {
+            minX = std::min(minX, quad.coords[c]);
+            maxX = std::max(maxX, quad.coords[c]);
+            minY = std::min(minY, quad.coords[c + 1]);
+            maxY = std::max(maxY, quad.coords[c + 1]);
+        }
+    }
+    mCellOriginX = minX;
+    mCellOriginY = minY;
+    mInvCellWidth = kGridSize / std::max(maxX - minX, kFloatFuzz);
+    mInvCellHeight = kGridSize / std::max(maxY - minY, kFloatFuzz);
+    mDistortedGridCells.assign(kGridSize * kGridSize, std::vector<uint16_t>());
+    for (size_t q = 0; q < mDistortedGrid.size(); q++) {
+        const GridQuad& quad = mDistortedGrid[q];
+        float quadMinX = quad.coords[0], quadMaxX = quadMinX;
+        float quadMinY = quad.coords[1], quadMaxY = quadMinY;
+        for (size_t c = 2; c < quad.coords.size(); c += 2) {
+            quadMinX = std::min(quadMinX, quad.coords[c]);
+            quadMaxX = std::max(quadMaxX, quad.coords[c]);
+            quadMinY = std::min(quadMinY, quad.coords[c + 1]);
+            quadMaxY = std::max(quadMaxY, quad.coords[c + 1]);
+        }
+        size_t cellX0 = std::min(kGridSize - 1,
+                static_cast<size_t>((quadMinX - minX) * mInvCellWidth));
+        size_t cellX1 = std::min(kGridSize - 1,
+                static_cast<size_t>((quadMaxX - minX) * mInvCellWidth));
+        size_t cellY0 = std::min(kGridSize - 1,
+                static_cast<size_t>((quadMinY - minY) * mInvCellHeight));
+        size_t cellY1 = std::min(kGridSize - 1,
+                static_cast<size_t>((quadMaxY - minY) * mInvCellHeight));
+        for (size_t cy = cellY0; cy <= cellY1; cy++) {
+            for (size_t cx = cellX0; cx <= cellX1; cx++) {
+                mDistortedGridCells[cy * kGridSize + cx].push_back(static_cast<uint16_t>(q));
+            }
+        }
+    }
+
     mValidGrids = true;
     return OK;
 }
 
+const DistortionMapper::GridQuad* DistortionMapper::findEnclosingDistortedQuad(
+        const int32_t pt[2]) const {
+    const float cellX = (pt[0] - mCellOriginX) * mInvCellWidth;
+    const float cellY = (pt[1] - mCellOriginY) * mInvCellHeight;
+    // Points on the far edge of the bounding box still belong to the last cell
+    if (cellX < 0 || cellY < 0 || cellX > kGridSize || cellY > kGridSize) {
+        return nullptr;
+    }
+    size_t cell = std::min(kGridSize - 1, static_cast<size_t>(cellY)) * kGridSize +
+            std::min(kGridSize - 1, static_cast<size_t>(cellX));
+    for (uint16_t q : mDistortedGridCells[cell]) {
+        if (quadContains(pt, mDistortedGrid[q])) {
+            return &mDistortedGrid[q];
+        }
+    }
+    return nullptr;
+}
+
 const DistortionMapper::GridQuad* DistortionMapper::findEnclosingQuad(
         const int32_t pt[2], const std::vector<GridQuad>& grid) {
-    const float x = pt[0];
-    const float y = pt[1];
-
     for (const GridQuad& quad : grid) {
-        const float &x1 = quad.coords[0];
-        const float &y1 = quad.coords[1];
-        const float &x2 = quad.coords[2];
-        const float &y2 = quad.coords[3];
-        const float &x3 = quad.coords[4];
-        const float &y3 = quad.coords[5];
-        const float &x4 = quad.coords[6];
-        const float &y4 = quad.coords[7];
-
-        // Point-in-quad test:
-
-        // Quad has corners P1-P4; if P is within the quad, then it is on the same side of all the
-        // edges (or on top of one of the edges or corners), traversed in a consistent direction.
-        // This means that the cross product of edge En = Pn->P(n+1 mod 4) and line Ep = Pn->P must
-        // have the same sign (or be zero) for all edges.
-        // For clockwise traversal, the sign should be negative or zero for Ep x En, indicating that
-        // En is to the left of Ep, or overlapping.
-        float s1 = (x - x1) * (y2 - y1) - (y - y1) * (x2 - x1);
-        if (s1 > 0) continue;
-        float s2 = (x - x2) * (y3 - y2) - (y - y2) * (x3 - x2);
-        if (s2 > 0) continue;
-        float s3 = (x - x3) * (y4 - y3) - (y - y3) * (x4 - x3);
-        if (s3 > 0) continue;
-        float s4 = (x - x4) * (y1 - y4) - (y - y4) * (x1 - x4);
-        if (s4 > 0) continue;
-
-        return &quad;
+        if (quadContains(pt, quad)) {
+            return &quad;
+        }
     }
     return nullptr;
 }
 
+bool DistortionMapper::quadContains(const int32_t pt[2], const GridQuad& quad) {
+    const float x = pt[0];
+    const float y = pt[1];
+
+    const float &x1 = quad.coords[0];
+    const float &y1 = quad.coords[1];
+    const float &x2 = quad.coords[2];
+    const float &y2 = quad.coords[3];
+    const float &x3 = quad.coords[4];
+    const float &y3 = quad.coords[5];
+    const float &x4 = quad.coords[6];
+    const float &y4 = quad.coords[7];
+
+    // Point-in-quad test:
+
+    // Quad has corners P1-P4; if P is within the quad, then it is on the same side of all the
+    // edges (or on top of one of the edges or corners), traversed in a consistent direction.
+    // This means that the cross product of edge En = Pn->P(n+1 mod 4) and line Ep = Pn->P must
+    // have the same sign (or be zero) for all edges.
+    // For clockwise traversal, the sign should be negative or zero for Ep x En, indicating that
+    // En is to the left of Ep, or overlapping.
+    float s1 = (x - x1) * (y2 - y1) - (y - y1) * (x2 - x1);
+    if (s1 > 0) return false;
+    float s2 = (x - x2) * (y3 - y2) - (y - y2) * (x3 - x2);
+    if (s2 > 0) return false;
+    float s3 = (x - x3) * (y4 - y3) - (y - y3) * (x4 - x3);
+    if (s3 > 0) return false;
+    float s4 = (x - x4) * (y1 - y4) - (y - y4) * (x1 - x4);
+    if (s4 > 0) return false;
+
+    return true;
+}
+
 float DistortionMapper::calculateUorV(const int32_t pt[2], const GridQuad& quad, bool calculateU) {
     const float x = pt[0];
     const float y = pt[1];
@@ -177,6 +177,13 @@ class DistortionMapper {
     // Utility to create reverse mapping grids
     status_t buildGrids();
 
+    // Whether the point is within the quad or on its edges
+    static bool quadContains(const int32_t pt[2], const GridQuad& quad);
+
+    // Same as findEnclosingQuad on mDistortedGrid, but only tests the quads listed for the
+    // cell of the point in mDistortedGridCells
+    const GridQuad* findEnclosingDistortedQuad(const int32_t pt[2]) const;
+
 
     bool mValidMapping;
     bool mValidGrids;
@@ -198,6 +205,12 @@ class DistortionMapper {
     std::vector<GridQuad> mCorrectedGrid;
     std::vector<GridQuad> mDistortedGrid;
 
+    // Lookup of the distorted grid quads whose bounding boxes overlap each cell of a
+    // kGridSize x kGridSize partition of the distorted grid's bounding box, in grid order
+    std::vector<std::vector<uint16_t>> mDistortedGridCells;
+    float mCellOriginX, mCellOriginY;
+    float mInvCellWidth, mInvCellHeight;
+
 }; // class DistortionMapper
 
 } // namespace camera3
@@ -95,6 +95,12 @@ static constexpr int kMaxExpiredAtOnce = 50;
 
 // TODO: need to look at tuning kMaxRecords and friends for low-memory devices
 
+// summaries are kept in slices of a minute, for an hour; each slice has at most
+// this many key/package combinations, to bound memory against noisy clients.
+static constexpr nsecs_t kSummarySliceNs = 60 * (1000*1000*1000ll);
+static constexpr size_t kMaxSummarySlices = 60;
+static constexpr size_t kMaxSummariesPerSlice = 200;
+
 static const char *kServiceName = "media.metrics";
 
 void MediaAnalyticsService::instantiate() {
@@ -116,6 +122,7 @@ MediaAnalyticsService::MediaAnalyticsService()
     mItemsDiscarded = 0;
     mItemsDiscardedExpire = 0;
     mItemsDiscardedCount = 0;
+    mSummariesDropped = 0;
 
     mLastSessionID = 0;
     // recover any persistency we set up
@@ -137,9 +144,7 @@ MediaAnalyticsService::~MediaAnalyticsService() {
 
 MediaAnalyticsItem::SessionID_t MediaAnalyticsService::generateUniqueSessionID() {
     // generate a new sessionid
-
-    Mutex::Autolock _l(mLock_ids);
-    return (++mLastSessionID);
+    return ++mLastSessionID;
 }
 
 // caller surrenders ownership of 'item'
@@ -263,6 +268,8 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
     String16 helpOption("-help");
     String16 onlyOption("-only");
     std::string only;
+    String16 summaryOption("-summary");
+    bool summary = false;
     int n = args.size();
 
     for (int i = 0; i < n; i++) {
@@ -311,6 +318,8 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
                 String8 value(args[i]);
                 only = value.string();
             }
+        } else if (args[i] == summaryOption) {
+            summary = true;
         } else if (args[i] == helpOption) {
             result.append("Recognized parameters:\n");
             result.append("-help        this help message\n");
@@ -319,6 +328,7 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
             result.append("-only X      process records for component X\n");
             result.append("-since X     include records since X\n");
             result.append("             (X is milliseconds since the UNIX epoch)\n");
+            result.append("-summary     per minute and per hour aggregates, instead of records\n");
             write(fd, result.string(), result.size());
             return NO_ERROR;
         }
@@ -335,7 +345,11 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
 
     dumpHeaders(result, ts_since);
 
-    dumpRecent(result, ts_since, only.c_str());
+    if (summary) {
+        dumpSummaries(result, ts_since, only.c_str());
+    } else {
+        dumpRecent(result, ts_since, only.c_str());
+    }
 
 
     if (clear) {
@@ -347,8 +361,7 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
             mItemsDiscarded++;
         }
 
-        // shall we clear the summary data too?
-
+        mSummarySlices.clear();
     }
 
     write(fd, result.string(), result.size());
@@ -375,7 +388,7 @@ void MediaAnalyticsService::dumpHeaders(String8 &result, nsecs_t ts_since)
     snprintf(buffer, SIZE,
         "Since Boot: Submissions: %8" PRId64
             " Accepted: %8" PRId64 "\n",
-        mItemsSubmitted, mItemsFinalized);
+        mItemsSubmitted.load(), mItemsFinalized.load());
     result.append(buffer);
     snprintf(buffer, SIZE,
         "Records Discarded: %8" PRId64
@@ -410,6 +423,60 @@ void MediaAnalyticsService::dumpRecent(String8 &result, nsecs_t ts_since, const
     // talk about # records we discarded, perhaps "discarded w/o reading" too
 }
 
+// the rolling aggregates, for the last minute and the last hour
+void MediaAnalyticsService::dumpSummaries(String8 &result, nsecs_t ts_since, const char * only)
+{
+    if (only != NULL && *only == '\0') {
+        only = NULL;
+    }
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_REALTIME);
+    const struct {
+        const char *name;
+        nsecs_t durationNs;
+    } windows[] = {
+        { "last minute", kSummarySliceNs },
+        { "last hour", kSummarySliceNs * kMaxSummarySlices },
+    };
+
+    if (mSummariesDropped > 0) {
+        result.appendFormat("Summaries dropped (too many keys): %" PRId64 "\n",
+                mSummariesDropped);
+    }
+    for (const auto &window : windows) {
+        std::map<SummaryKey, Summary> summaries;
+        for (const SummarySlice &slice : mSummarySlices) {
+            if (slice.mStartNs + kSummarySliceNs <= now - window.durationNs
+                    || slice.mStartNs + kSummarySliceNs <= ts_since) {
+                continue;
+            }
+            for (const auto &entry : slice.mSummaries) {
+                if (only != NULL && strcmp(only, entry.first.first.c_str()) != 0) {
+                    continue;
+                }
+                summaries[entry.first].merge(entry.second);
+            }
+        }
+
+        result.appendFormat("\nSummary for the %s:\n", window.name);
+        if (summaries.empty()) {
+            result.append("empty\n");
+            continue;
+        }
+        for (const auto &entry : summaries) {
+            const Summary &summary = entry.second;
+            result.appendFormat("%s [%s]: %" PRId64 " records\n",
+                    entry.first.first.c_str(), entry.first.second.c_str(), summary.mRecords);
+            for (const auto &attr : summary.mAttrs) {
+                const AttrStats &stats = attr.second;
+                result.appendFormat("    %s: count %" PRId64 " sum %g mean %g min %g max %g\n",
+                        attr.first.c_str(), stats.mCount, stats.mSum,
+                        stats.mSum / stats.mCount, stats.mMin, stats.mMax);
+            }
+        }
+    }
+}
+
 // caller has locked mLock...
 String8 MediaAnalyticsService::dumpQueue() {
     return dumpQueue((nsecs_t) 0, NULL);
@@ -449,7 +516,8 @@ String8 MediaAnalyticsService::dumpQueue(nsecs_t ts_since, const char * only) {
 // we hold mLock when we get here
 // if item != NULL, it's the item we just inserted
 // true == more items eligible to be recovered
-bool MediaAnalyticsService::expirations_l(MediaAnalyticsItem *item)
+bool MediaAnalyticsService::expirations_l(MediaAnalyticsItem *item,
+                                          List<MediaAnalyticsItem *> *expired)
 {
     bool more = false;
     int handled = 0;
@@ -469,7 +537,7 @@ bool MediaAnalyticsService::expirations_l(MediaAnalyticsItem *item)
             }
             handled++;
             mItems.erase(mItems.begin());
-            delete oitem;
+            expired->push_back(oitem);
             mItemsDiscarded++;
             mItemsDiscardedCount++;
         }
@@ -498,7 +566,7 @@ bool MediaAnalyticsService::expirations_l(MediaAnalyticsItem *item)
             }
             handled++;
             mItems.erase(mItems.begin());
-            delete oitem;
+            expired->push_back(oitem);
             mItemsDiscarded++;
             mItemsDiscardedExpire++;
         }
@@ -509,6 +577,14 @@ bool MediaAnalyticsService::expirations_l(MediaAnalyticsItem *item)
     return more;
 }
 
+static void deleteItems(List<MediaAnalyticsItem *> *items)
+{
+    for (MediaAnalyticsItem *item : *items) {
+        delete item;
+    }
+    items->clear();
+}
+
 // process expirations in bite sized chunks, allowing new insertions through
 // runs in a pthread specifically started for this (which then exits)
 bool MediaAnalyticsService::processExpirations()
@@ -516,39 +592,128 @@ bool MediaAnalyticsService::processExpirations()
     bool more;
     do {
         sleep(1);
+        List<MediaAnalyticsItem *> expired;
         {
             Mutex::Autolock _l(mLock);
-            more = expirations_l(NULL);
-            if (!more) {
-                break;
-            }
+            more = expirations_l(NULL, &expired);
         }
+        deleteItems(&expired);
     } while (more);
     return true;        // value is for std::future thread synchronization
 }
 
+void MediaAnalyticsService::AttrStats::add(double value)
+{
+    if (mCount == 0 || value < mMin) {
+        mMin = value;
+    }
+    if (mCount == 0 || value > mMax) {
+        mMax = value;
+    }
+    mSum += value;
+    mCount++;
+}
+
+void MediaAnalyticsService::AttrStats::merge(const AttrStats &other)
+{
+    if (other.mCount == 0) {
+        return;
+    }
+    if (mCount == 0 || other.mMin < mMin) {
+        mMin = other.mMin;
+    }
+    if (mCount == 0 || other.mMax > mMax) {
+        mMax = other.mMax;
+    }
+    mSum += other.mSum;
+    mCount += other.mCount;
+}
+
+void MediaAnalyticsService::Summary::merge(const Summary &other)
+{
+    mRecords += other.mRecords;
+    for (const auto &attr : other.mAttrs) {
+        mAttrs[attr.first].merge(attr.second);
+    }
+}
+
+// we hold mLock when we get here
+void MediaAnalyticsService::summarize_l(MediaAnalyticsItem *item)
+{
+    // timestamps were set on arrival, so they only go forward (but for clock changes)
+    const nsecs_t when = item->getTimestamp();
+    const nsecs_t sliceStartNs = when - when % kSummarySliceNs;
+    if (mSummarySlices.empty() || mSummarySlices.back().mStartNs != sliceStartNs) {
+        mSummarySlices.push_back(SummarySlice{sliceStartNs, {}});
+        while (mSummarySlices.size() > kMaxSummarySlices) {
+            mSummarySlices.pop_front();
+        }
+    }
+    std::map<SummaryKey, Summary> &summaries = mSummarySlices.back().mSummaries;
+
+    SummaryKey key(item->getKey(), item->getPkgName());
+    auto it = summaries.find(key);
+    if (it == summaries.end()) {
+        if (summaries.size() >= kMaxSummariesPerSlice) {
+            mSummariesDropped++;
+            return;
+        }
+        it = summaries.emplace(key, Summary()).first;
+    }
+    Summary &summary = it->second;
+    summary.mRecords++;
+
+    for (size_t i = 0; i < item->mPropCount; i++) {
+        const MediaAnalyticsItem::Prop &prop = item->mProps[i];
+        double value;
+        switch (prop.mType) {
+            case MediaAnalyticsItem::kTypeInt32:
+                value = prop.u.int32Value;
+                break;
+            case MediaAnalyticsItem::kTypeInt64:
+                value = prop.u.int64Value;
+                break;
+            case MediaAnalyticsItem::kTypeDouble:
+                value = prop.u.doubleValue;
+                break;
+            case MediaAnalyticsItem::kTypeRate:
+                value = prop.u.rate.count;
+                break;
+            default:
+                // strings don't aggregate
+                continue;
+        }
+        summary.mAttrs[prop.mName].add(value);
+    }
+}
+
 // insert appropriately into queue
 void MediaAnalyticsService::saveItem(MediaAnalyticsItem * item)
 {
+    List<MediaAnalyticsItem *> expired;
+    {
+        Mutex::Autolock _l(mLock);
+        // mutex between insertion and dumping the contents
 
-    Mutex::Autolock _l(mLock);
-    // mutex between insertion and dumping the contents
-
-    // we want to dump 'in FIFO order', so insert at the end
-    mItems.push_back(item);
+        // we want to dump 'in FIFO order', so insert at the end
+        mItems.push_back(item);
+        summarize_l(item);
 
-    // clean old stuff from the queue
-    bool more = expirations_l(item);
+        // clean old stuff from the queue
+        bool more = expirations_l(item, &expired);
 
-    // consider scheduling some asynchronous cleaning, if not running
-    if (more) {
-        if (!mExpireFuture.valid()
-            || mExpireFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        // consider scheduling some asynchronous cleaning, if not running
+        if (more) {
+            if (!mExpireFuture.valid()
+                || mExpireFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
 
-            mExpireFuture = std::async(std::launch::async, [this]()
-                                       {return this->processExpirations();});
+                mExpireFuture = std::async(std::launch::async, [this]()
+                                           {return this->processExpirations();});
+            }
         }
     }
+    // freeing the records can take a while, don't hold up other submitters
+    deleteItems(&expired);
 }
 
 static std::string allowedKeys[] =
@@ -26,7 +26,12 @@
 #include <utils/String8.h>
 #include <utils/List.h>
 
+#include <atomic>
+#include <deque>
 #include <future>
+#include <map>
+#include <string>
+#include <utility>
 
 #include <media/IMediaAnalyticsService.h>
 
@@ -52,16 +57,16 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
     MediaAnalyticsItem::SessionID_t generateUniqueSessionID();
 
     // statistics about our analytics
-    int64_t mItemsSubmitted;
-    int64_t mItemsFinalized;
+    // submitted and finalized are counted outside of mLock
+    std::atomic<int64_t> mItemsSubmitted;
+    std::atomic<int64_t> mItemsFinalized;
     int64_t mItemsDiscarded;
     int64_t mItemsDiscardedExpire;
     int64_t mItemsDiscardedCount;
-    MediaAnalyticsItem::SessionID_t mLastSessionID;
+    std::atomic<MediaAnalyticsItem::SessionID_t> mLastSessionID;
 
     // partitioned a bit so we don't over serialize
     mutable Mutex           mLock;
-    mutable Mutex           mLock_ids;
     mutable Mutex           mLock_mappings;
 
     // limit how many records we'll retain
@@ -85,7 +90,8 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
     List<MediaAnalyticsItem *> mItems;
     void saveItem(MediaAnalyticsItem *);
 
-    bool expirations_l(MediaAnalyticsItem *);
+    // expired records are moved to 'expired', for the caller to delete without holding mLock
+    bool expirations_l(MediaAnalyticsItem *, List<MediaAnalyticsItem *> *expired);
     std::future<bool> mExpireFuture;
 
     // support for generating output
@@ -94,6 +100,31 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
     String8 dumpQueue();
     String8 dumpQueue(nsecs_t, const char *only);
 
+    // rolling aggregates of the numeric attributes, per key and package,
+    // updated as records arrive and kept in one minute slices for an hour.
+    struct AttrStats {
+        int64_t mCount = 0;
+        double mSum = 0;
+        double mMin = 0;
+        double mMax = 0;
+        void add(double value);
+        void merge(const AttrStats &other);
+    };
+    struct Summary {
+        int64_t mRecords = 0;
+        std::map<std::string, AttrStats> mAttrs;
+        void merge(const Summary &other);
+    };
+    // key, package
+    typedef std::pair<std::string, std::string> SummaryKey;
+    struct SummarySlice {
+        nsecs_t mStartNs;
+        std::map<SummaryKey, Summary> mSummaries;
+    };
+    std::deque<SummarySlice> mSummarySlices;    // oldest at front
+    int64_t mSummariesDropped;
+    void summarize_l(MediaAnalyticsItem *item);
+
     void dumpHeaders(String8 &result, nsecs_t ts_since);
     void dumpSummaries(String8 &result, nsecs_t ts_since, const char * only);
     void dumpRecent(String8 &result, nsecs_t ts_since, const char * only);
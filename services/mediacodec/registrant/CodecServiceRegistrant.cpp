@@ -17,7 +17,12 @@
 //#define LOG_NDEBUG 0
 #define LOG_TAG "CodecServiceRegistrant"
 
+#include <algorithm>
+#include <thread>
+
 #include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
 
 #include <C2PlatformSupport.h>
 #include <codec2/hidl/1.0/ComponentStore.h>
@@ -41,5 +46,16 @@ extern "C" void RegisterCodecServices() {
                     "Software Codec2 service created.";
         }
     }
+
+    // Components to load ahead of the first client, as a comma separated list of names.
+    std::vector<std::string> preload = android::base::Split(
+            android::base::GetProperty("debug.stagefright.c2-preload", ""), ",");
+    preload.erase(std::remove(preload.begin(), preload.end(), ""), preload.end());
+    if (!preload.empty()) {
+        std::thread([preload] {
+            LOG(INFO) << "Preloading " << preload.size() << " software Codec2 components.";
+            android::PreloadCodec2PlatformComponents(preload);
+        }).detach();
+    }
 }
 
@@ -18,8 +18,13 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <utils/String8.h>
+#include <utils/Timers.h>
 #include <utils/Vector.h>
 
+#include <inttypes.h>
+#include <unistd.h>
+
 #include <media/DataSource.h>
 #include <media/stagefright/DataSourceFactory.h>
 #include <media/stagefright/InterfaceUtils.h>
@@ -30,7 +35,9 @@
 namespace android {
 
 MediaExtractorService::MediaExtractorService()
-        : BnMediaExtractorService() {
+        : BnMediaExtractorService(),
+          mActiveRequests(0),
+          mMaxActiveRequests(0) {
     MediaExtractorFactory::LoadExtractors();
 }
 
@@ -38,6 +45,14 @@ sp<IMediaExtractor> MediaExtractorService::makeExtractor(
         const sp<IDataSource> &remoteSource, const char *mime) {
     ALOGV("@@@ MediaExtractorService::makeExtractor for %s", mime);
 
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (++mActiveRequests > mMaxActiveRequests) {
+            mMaxActiveRequests = mActiveRequests;
+        }
+    }
+    const nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
     sp<DataSource> localSource = CreateDataSourceFromIDataSource(remoteSource);
 
     sp<IMediaExtractor> extractor = MediaExtractorFactory::CreateFromService(localSource, mime);
@@ -46,6 +61,9 @@ sp<IMediaExtractor> MediaExtractorService::makeExtractor(
             extractor.get(),
             extractor == nullptr ? "" : extractor->name());
 
+    onRequestDone(gettid(), (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) / 1000,
+            extractor == nullptr);
+
     if (extractor != nullptr) {
         registerMediaExtractor(extractor, localSource, mime);
         return extractor;
@@ -63,7 +81,41 @@ std::unordered_set<std::string> MediaExtractorService::getSupportedTypes() {
     return MediaExtractorFactory::getSupportedTypes();
 }
 
+void MediaExtractorService::onRequestDone(pid_t tid, int64_t durationUs, bool failed) {
+    Mutex::Autolock autoLock(mLock);
+    --mActiveRequests;
+
+    ssize_t index = mWorkerStats.indexOfKey(tid);
+    if (index < 0) {
+        WorkerStats stats = {};
+        index = mWorkerStats.add(tid, stats);
+    }
+    WorkerStats &stats = mWorkerStats.editValueAt(index);
+    ++stats.mRequests;
+    if (failed) {
+        ++stats.mFailures;
+    }
+    stats.mTotalUs += durationUs;
+    if (durationUs > stats.mMaxUs) {
+        stats.mMaxUs = durationUs;
+    }
+}
+
 status_t MediaExtractorService::dump(int fd, const Vector<String16>& args) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        String8 out;
+        out.appendFormat("makeExtractor: %zu active, at most %zu at once\n",
+                mActiveRequests, mMaxActiveRequests);
+        for (size_t i = 0; i < mWorkerStats.size(); ++i) {
+            const WorkerStats &stats = mWorkerStats.valueAt(i);
+            out.appendFormat("  thread %d: %" PRIu64 " requests, %" PRIu64 " failed, "
+                    "avg %" PRId64 " us, max %" PRId64 " us\n",
+                    mWorkerStats.keyAt(i), stats.mRequests, stats.mFailures,
+                    stats.mTotalUs / (int64_t)stats.mRequests, stats.mMaxUs);
+        }
+        (void)write(fd, out.string(), out.size());
+    }
     return MediaExtractorFactory::dump(fd, args) || dumpExtractors(fd, args);
 }
 
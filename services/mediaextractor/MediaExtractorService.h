@@ -20,6 +20,7 @@
 #include <binder/BinderService.h>
 #include <media/IMediaExtractorService.h>
 #include <media/IMediaExtractor.h>
+#include <utils/KeyedVector.h>
 
 namespace android {
 
@@ -45,7 +46,20 @@ public:
                                 uint32_t flags);
 
 private:
+    // makeExtractor() calls served by one binder thread
+    struct WorkerStats {
+        uint64_t mRequests;
+        uint64_t mFailures;
+        int64_t mTotalUs;
+        int64_t mMaxUs;
+    };
+
     Mutex               mLock;
+    KeyedVector<pid_t, WorkerStats> mWorkerStats;
+    size_t              mActiveRequests;
+    size_t              mMaxActiveRequests;
+
+    void onRequestDone(pid_t tid, int64_t durationUs, bool failed);
 };
 
 }   // namespace android
@@ -40,6 +40,11 @@ static const char kSystemSeccompPolicyPath[] =
 static const char kVendorSeccompPolicyPath[] =
         "/vendor/etc/seccomp_policy/mediaextractor.policy";
 
+// Binder threads serving makeExtractor(). Each one can sniff and parse a file
+// independently, so a media scan does not hold up extraction for playback.
+static const char kMaxThreadsProperty[] = "ro.media.extractor.max_threads";
+static const size_t kMaxThreadsLimit = 64;
+
 int main(int argc __unused, char** argv)
 {
     limitProcessMemory(
@@ -59,7 +64,13 @@ int main(int argc __unused, char** argv)
 
     strcpy(argv[0], "media.extractor");
     sp<ProcessState> proc(ProcessState::self());
+    const size_t maxThreads = android::base::GetUintProperty<size_t>(
+            kMaxThreadsProperty, 0 /* default */, kMaxThreadsLimit);
+    if (maxThreads > 0) {
+        proc->setThreadPoolMaxThreadCount(maxThreads);
+    }
     sp<IServiceManager> sm = defaultServiceManager();
+    // loads and initializes all extractor plugins before the first request
     MediaExtractorService::instantiate();
 
     ProcessState::self()->startThreadPool();
@@ -61,8 +61,10 @@ void MediaLogService::registerWriter(const sp<IMemory>& shared, size_t size, con
     }
     sp<NBLog::Reader> reader(new NBLog::Reader(shared, size, name)); // Reader handled by merger
     sp<NBLog::DumpReader> dumpReader(new NBLog::DumpReader(shared, size, name)); // for dumpsys
+    const pid_t pid = IPCThreadState::self()->getCallingPid();
     Mutex::Autolock _l(mLock);
     mDumpReaders.add(dumpReader);
+    mDumpReaderPids.add(pid);
     mMerger.addReader(reader);
 }
 
@@ -75,6 +77,7 @@ void MediaLogService::unregisterWriter(const sp<IMemory>& shared)
     for (size_t i = 0; i < mDumpReaders.size(); ) {
         if (mDumpReaders[i]->isIMemory(shared)) {
             mDumpReaders.removeAt(i);
+            mDumpReaderPids.removeAt(i);
             // TODO mMerger.removeReaders(shared)
         } else {
             i++;
@@ -107,7 +110,8 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
 
     if (args.size() > 0) {
         const String8 arg0(args[0]);
-        if (!strcmp(arg0.string(), "-r")) {
+        const bool trace = !strcmp(arg0.string(), "--trace");
+        if (!strcmp(arg0.string(), "-r") || trace) {
             // needed because mReaders is protected by mLock
             bool locked = dumpTryLock(mLock);
 
@@ -122,6 +126,17 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
                 return NO_ERROR;
             }
 
+            if (trace) {
+                // one track per writer, loadable in Perfetto or chrome://tracing
+                dprintf(fd, "{\"traceEvents\":[\n");
+                bool first = true;
+                for (size_t i = 0; i < mDumpReaders.size(); ++i) {
+                    mDumpReaders[i]->dumpTraceEvents(fd, mDumpReaderPids[i], i + 1, &first);
+                }
+                dprintf(fd, "],\"displayTimeUnit\":\"ns\"}\n");
+                mLock.unlock();
+                return NO_ERROR;
+            }
             for (const auto &dumpReader : mDumpReaders) {
                 if (fd >= 0) {
                     dprintf(fd, "\n%s:\n", dumpReader->name().c_str());
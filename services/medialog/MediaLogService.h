@@ -57,6 +57,7 @@ private:
     Mutex               mLock;
 
     Vector<sp<NBLog::DumpReader>> mDumpReaders;   // protected by mLock
+    Vector<pid_t> mDumpReaderPids;                // writer process of each of mDumpReaders
 
     // FIXME Need comments on all of these, especially about locking
     NBLog::Shared *mMergerShared;
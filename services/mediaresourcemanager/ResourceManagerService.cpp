@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <utils/Timers.h>
 
 #include "ResourceManagerService.h"
 #include "ServiceLog.h"
@@ -148,12 +149,18 @@ status_t ResourceManagerService::dump(int fd, const Vector<String16>& /* args */
     bool supportsMultipleSecureCodecs;
     bool supportsSecureWithNonSecureCodec;
     String8 serviceLog;
+    int64_t reclaimCount;
+    int64_t reclaimTotalUs;
+    int64_t reclaimMaxUs;
     {
         Mutex::Autolock lock(mLock);
         mapCopy = mMap;  // Shadow copy, real copy will happen on write.
         supportsMultipleSecureCodecs = mSupportsMultipleSecureCodecs;
         supportsSecureWithNonSecureCodec = mSupportsSecureWithNonSecureCodec;
         serviceLog = mServiceLog->toString("    " /* linePrefix */);
+        reclaimCount = mReclaimCount;
+        reclaimTotalUs = mReclaimTotalUs;
+        reclaimMaxUs = mReclaimMaxUs;
     }
 
     const size_t SIZE = 256;
@@ -167,6 +174,13 @@ status_t ResourceManagerService::dump(int fd, const Vector<String16>& /* args */
             supportsSecureWithNonSecureCodec);
     result.append(buffer);
 
+    result.append("  Reclaims:\n");
+    snprintf(buffer, SIZE, "    Count: %lld, average %lld us, max %lld us\n",
+            (long long)reclaimCount,
+            (long long)(reclaimCount > 0 ? reclaimTotalUs / reclaimCount : 0),
+            (long long)reclaimMaxUs);
+    result.append(buffer);
+
     result.append("  Processes:\n");
     for (size_t i = 0; i < mapCopy.size(); ++i) {
         snprintf(buffer, SIZE, "    Pid: %d\n", mapCopy.keyAt(i));
@@ -204,7 +218,11 @@ ResourceManagerService::ResourceManagerService(sp<ProcessInfoInterface> processI
       mServiceLog(new ServiceLog()),
       mSupportsMultipleSecureCodecs(true),
       mSupportsSecureWithNonSecureCodec(true),
-      mCpuBoostCount(0) {}
+      mCpuBoostCount(0),
+      mReclaimInProgress(false),
+      mReclaimCount(0),
+      mReclaimTotalUs(0),
+      mReclaimMaxUs(0) {}
 
 ResourceManagerService::~ResourceManagerService() {}
 
@@ -313,75 +331,95 @@ void ResourceManagerService::getClientForResource_l(
     }
 }
 
-bool ResourceManagerService::reclaimResource(
-        int callingPid, const Vector<MediaResource> &resources) {
-    String8 log = String8::format("reclaimResource(callingPid %d, resources %s)",
-            callingPid, getString(resources).string());
-    mServiceLog->add(log);
-
+void ResourceManagerService::selectClientsToReclaim_l(
+        int callingPid, const Vector<MediaResource> &resources,
+        Vector<sp<IResourceManagerClient>> *outClients) {
+    if (!mProcessInfo->isValidPid(callingPid)) {
+        ALOGE("Rejected reclaimResource call with invalid callingPid.");
+        return;
+    }
+    // the clients are only returned if all the passes are satisfied.
     Vector<sp<IResourceManagerClient>> clients;
-    {
-        Mutex::Autolock lock(mLock);
-        if (!mProcessInfo->isValidPid(callingPid)) {
-            ALOGE("Rejected reclaimResource call with invalid callingPid.");
-            return false;
-        }
-        const MediaResource *secureCodec = NULL;
-        const MediaResource *nonSecureCodec = NULL;
-        const MediaResource *graphicMemory = NULL;
-        for (size_t i = 0; i < resources.size(); ++i) {
-            MediaResource::Type type = resources[i].mType;
-            if (resources[i].mType == MediaResource::kSecureCodec) {
-                secureCodec = &resources[i];
-            } else if (type == MediaResource::kNonSecureCodec) {
-                nonSecureCodec = &resources[i];
-            } else if (type == MediaResource::kGraphicMemory) {
-                graphicMemory = &resources[i];
-            }
+    const MediaResource *secureCodec = NULL;
+    const MediaResource *nonSecureCodec = NULL;
+    const MediaResource *graphicMemory = NULL;
+    for (size_t i = 0; i < resources.size(); ++i) {
+        MediaResource::Type type = resources[i].mType;
+        if (resources[i].mType == MediaResource::kSecureCodec) {
+            secureCodec = &resources[i];
+        } else if (type == MediaResource::kNonSecureCodec) {
+            nonSecureCodec = &resources[i];
+        } else if (type == MediaResource::kGraphicMemory) {
+            graphicMemory = &resources[i];
         }
+    }
 
-        // first pass to handle secure/non-secure codec conflict
-        if (secureCodec != NULL) {
-            if (!mSupportsMultipleSecureCodecs) {
-                if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
-                    return false;
-                }
+    // first pass to handle secure/non-secure codec conflict
+    if (secureCodec != NULL) {
+        if (!mSupportsMultipleSecureCodecs) {
+            if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
+                return;
             }
-            if (!mSupportsSecureWithNonSecureCodec) {
-                if (!getAllClients_l(callingPid, MediaResource::kNonSecureCodec, &clients)) {
-                    return false;
-                }
+        }
+        if (!mSupportsSecureWithNonSecureCodec) {
+            if (!getAllClients_l(callingPid, MediaResource::kNonSecureCodec, &clients)) {
+                return;
             }
         }
-        if (nonSecureCodec != NULL) {
-            if (!mSupportsSecureWithNonSecureCodec) {
-                if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
-                    return false;
-                }
+    }
+    if (nonSecureCodec != NULL) {
+        if (!mSupportsSecureWithNonSecureCodec) {
+            if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
+                return;
             }
         }
+    }
 
-        if (clients.size() == 0) {
-            // if no secure/non-secure codec conflict, run second pass to handle other resources.
-            getClientForResource_l(callingPid, graphicMemory, &clients);
-        }
+    if (clients.size() == 0) {
+        // if no secure/non-secure codec conflict, run second pass to handle other resources.
+        getClientForResource_l(callingPid, graphicMemory, &clients);
+    }
+
+    if (clients.size() == 0) {
+        // if we are here, run the third pass to free one codec with the same type.
+        getClientForResource_l(callingPid, secureCodec, &clients);
+        getClientForResource_l(callingPid, nonSecureCodec, &clients);
+    }
 
-        if (clients.size() == 0) {
-            // if we are here, run the third pass to free one codec with the same type.
-            getClientForResource_l(callingPid, secureCodec, &clients);
-            getClientForResource_l(callingPid, nonSecureCodec, &clients);
+    if (clients.size() == 0) {
+        // if we are here, run the fourth pass to free one codec with the different type.
+        if (secureCodec != NULL) {
+            MediaResource temp(MediaResource::kNonSecureCodec, 1);
+            getClientForResource_l(callingPid, &temp, &clients);
+        }
+        if (nonSecureCodec != NULL) {
+            MediaResource temp(MediaResource::kSecureCodec, 1);
+            getClientForResource_l(callingPid, &temp, &clients);
         }
+    }
+    *outClients = clients;
+}
 
-        if (clients.size() == 0) {
-            // if we are here, run the fourth pass to free one codec with the different type.
-            if (secureCodec != NULL) {
-                MediaResource temp(MediaResource::kNonSecureCodec, 1);
-                getClientForResource_l(callingPid, &temp, &clients);
-            }
-            if (nonSecureCodec != NULL) {
-                MediaResource temp(MediaResource::kSecureCodec, 1);
-                getClientForResource_l(callingPid, &temp, &clients);
-            }
+bool ResourceManagerService::reclaimResource(
+        int callingPid, const Vector<MediaResource> &resources) {
+    String8 log = String8::format("reclaimResource(callingPid %d, resources %s)",
+            callingPid, getString(resources).string());
+    mServiceLog->add(log);
+
+    Vector<sp<IResourceManagerClient>> clients;
+    {
+        Mutex::Autolock lock(mLock);
+        const nsecs_t startNs = systemTime();
+        mReclaimInProgress = true;
+        selectClientsToReclaim_l(callingPid, resources, &clients);
+        mReclaimInProgress = false;
+        mPriorityCache.clear();
+
+        const int64_t durationUs = ns2us(systemTime() - startNs);
+        mReclaimCount++;
+        mReclaimTotalUs += durationUs;
+        if (durationUs > mReclaimMaxUs) {
+            mReclaimMaxUs = durationUs;
         }
     }
 
@@ -459,7 +497,7 @@ bool ResourceManagerService::getLowestPriorityBiggestClient_l(
     int lowestPriorityPid;
     int lowestPriority;
     int callingPriority;
-    if (!mProcessInfo->getPriority(callingPid, &callingPriority)) {
+    if (!getPriority_l(callingPid, &callingPriority)) {
         ALOGE("getLowestPriorityBiggestClient_l: can't get process priority for pid %d",
                 callingPid);
         return false;
@@ -494,7 +532,7 @@ bool ResourceManagerService::getLowestPriorityPid_l(
         }
         int tempPid = mMap.keyAt(i);
         int tempPriority;
-        if (!mProcessInfo->getPriority(tempPid, &tempPriority)) {
+        if (!getPriority_l(tempPid, &tempPriority)) {
             ALOGV("getLowestPriorityPid_l: can't get priority of pid %d, skipped", tempPid);
             // TODO: remove this pid from mMap?
             continue;
@@ -514,18 +552,35 @@ bool ResourceManagerService::getLowestPriorityPid_l(
 
 bool ResourceManagerService::isCallingPriorityHigher_l(int callingPid, int pid) {
     int callingPidPriority;
-    if (!mProcessInfo->getPriority(callingPid, &callingPidPriority)) {
+    if (!getPriority_l(callingPid, &callingPidPriority)) {
         return false;
     }
 
     int priority;
-    if (!mProcessInfo->getPriority(pid, &priority)) {
+    if (!getPriority_l(pid, &priority)) {
         return false;
     }
 
     return (callingPidPriority < priority);
 }
 
+bool ResourceManagerService::getPriority_l(int pid, int* priority) {
+    if (mReclaimInProgress) {
+        ssize_t index = mPriorityCache.indexOfKey(pid);
+        if (index >= 0) {
+            *priority = mPriorityCache.valueAt(index);
+            return true;
+        }
+    }
+    if (!mProcessInfo->getPriority(pid, priority)) {
+        return false;
+    }
+    if (mReclaimInProgress) {
+        mPriorityCache.add(pid, *priority);
+    }
+    return true;
+}
+
 bool ResourceManagerService::getBiggestClient_l(
         int pid, MediaResource::Type type, sp<IResourceManagerClient> *client) {
     ssize_t index = mMap.indexOfKey(pid);
@@ -538,7 +593,7 @@ bool ResourceManagerService::getBiggestClient_l(
     uint64_t largestValue = 0;
     const ResourceInfos &infos = mMap.valueAt(index);
     for (size_t i = 0; i < infos.size(); ++i) {
-        Vector<MediaResource> resources = infos[i].resources;
+        const Vector<MediaResource> &resources = infos[i].resources;
         for (size_t j = 0; j < resources.size(); ++j) {
             if (resources[j].mType == type) {
                 if (resources[j].mValue > largestValue) {
@@ -102,6 +102,15 @@ private:
 
     bool isCallingPriorityHigher_l(int callingPid, int pid);
 
+    // Gets the priority of pid through mProcessInfo. While a reclaim is in progress, each
+    // pid is looked up at most once, as the passes of reclaimResource query the same pids.
+    bool getPriority_l(int pid, int* priority);
+
+    // Runs the reclaim passes for the requested resources. Returns no client if the request
+    // can't be fulfilled.
+    void selectClientsToReclaim_l(int callingPid, const Vector<MediaResource> &resources,
+            Vector<sp<IResourceManagerClient>> *clients);
+
     // A helper function basically calls getLowestPriorityBiggestClient_l and add the result client
     // to the given Vector.
     void getClientForResource_l(
@@ -114,6 +123,14 @@ private:
     bool mSupportsMultipleSecureCodecs;
     bool mSupportsSecureWithNonSecureCodec;
     int32_t mCpuBoostCount;
+
+    bool mReclaimInProgress;
+    KeyedVector<int, int> mPriorityCache;   // pid to priority, only valid during a reclaim
+
+    // reclaimResource() statistics for dump()
+    int64_t mReclaimCount;
+    int64_t mReclaimTotalUs;
+    int64_t mReclaimMaxUs;
 };
 
 // ----------------------------------------------------------------------------
@@ -34,13 +34,14 @@ static int64_t getId(const sp<IResourceManagerClient>& client) {
 }
 
 struct TestProcessInfo : public ProcessInfoInterface {
-    TestProcessInfo() {}
+    TestProcessInfo() : mNumPriorityQueries(0) {}
     virtual ~TestProcessInfo() {}
 
     virtual bool getPriority(int pid, int *priority) {
         // For testing, use pid as priority.
         // Lower the value higher the priority.
         *priority = pid;
+        ++mNumPriorityQueries;
         return true;
     }
 
@@ -48,6 +49,8 @@ struct TestProcessInfo : public ProcessInfoInterface {
         return true;
     }
 
+    int mNumPriorityQueries;
+
 private:
     DISALLOW_EVIL_CONSTRUCTORS(TestProcessInfo);
 };
@@ -95,7 +98,8 @@ static const int kHighPriorityPid = 10;
 class ResourceManagerServiceTest : public ::testing::Test {
 public:
     ResourceManagerServiceTest()
-        : mService(new ResourceManagerService(new TestProcessInfo)),
+        : mProcessInfo(new TestProcessInfo),
+          mService(new ResourceManagerService(mProcessInfo)),
           mTestClient1(new TestClient(kTestPid1, mService)),
           mTestClient2(new TestClient(kTestPid2, mService)),
           mTestClient3(new TestClient(kTestPid2, mService)) {
@@ -498,6 +502,28 @@ protected:
         EXPECT_TRUE(mService->isCallingPriorityHigher_l(99, 100));
     }
 
+    void testReclaimResourcePriorityLookups() {
+        addResource();
+        mService->mSupportsMultipleSecureCodecs = false;
+        mService->mSupportsSecureWithNonSecureCodec = false;
+
+        Vector<MediaResource> resources;
+        resources.push_back(MediaResource(MediaResource::kSecureCodec, 1));
+        resources.push_back(MediaResource(MediaResource::kGraphicMemory, 150));
+
+        // all passes look up the caller and the two owning pids once each.
+        mProcessInfo->mNumPriorityQueries = 0;
+        EXPECT_TRUE(mService->reclaimResource(kHighPriorityPid, resources));
+        verifyClients(true /* c1 */, true /* c2 */, true /* c3 */);
+        EXPECT_EQ(3, mProcessInfo->mNumPriorityQueries);
+
+        // priorities are looked up again on the next reclaim.
+        mProcessInfo->mNumPriorityQueries = 0;
+        EXPECT_FALSE(mService->reclaimResource(kHighPriorityPid, resources));
+        EXPECT_LE(1, mProcessInfo->mNumPriorityQueries);
+    }
+
+    sp<TestProcessInfo> mProcessInfo;
     sp<ResourceManagerService> mService;
     sp<IResourceManagerClient> mTestClient1;
     sp<IResourceManagerClient> mTestClient2;
@@ -521,6 +547,10 @@ TEST_F(ResourceManagerServiceTest, reclaimResource) {
     testReclaimResourceNonSecure();
 }
 
+TEST_F(ResourceManagerServiceTest, reclaimResourcePriorityLookups) {
+    testReclaimResourcePriorityLookups();
+}
+
 TEST_F(ResourceManagerServiceTest, getAllClients_l) {
     testGetAllClients();
 }
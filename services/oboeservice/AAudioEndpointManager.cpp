@@ -24,6 +24,7 @@
 #include <mutex>
 #include <sstream>
 #include <utility/AAudioUtilities.h>
+#include <utility/AudioClock.h>
 
 #include "AAudioEndpointManager.h"
 #include "AAudioServiceEndpointShared.h"
@@ -76,6 +77,7 @@ std::string AAudioEndpointManager::dump() const {
         result << "  ExclusiveFoundCount:   " << mExclusiveFoundCount << "\n";
         result << "  ExclusiveOpenCount:    " << mExclusiveOpenCount << "\n";
         result << "  ExclusiveCloseCount:   " << mExclusiveCloseCount << "\n";
+        result << "  ExclusiveOpenMsec:    " << dumpOpenLatency(mExclusiveOpenLatency) << "\n";
         result << "\n";
 
         if (isExclusiveLocked) {
@@ -94,6 +96,7 @@ std::string AAudioEndpointManager::dump() const {
     result << "  SharedFoundCount:      " << mSharedFoundCount << "\n";
     result << "  SharedOpenCount:       " << mSharedOpenCount << "\n";
     result << "  SharedCloseCount:      " << mSharedCloseCount << "\n";
+    result << "  SharedOpenMsec:       " << dumpOpenLatency(mSharedOpenLatency) << "\n";
     result << "\n";
 
     if (isSharedLocked) {
@@ -102,6 +105,26 @@ std::string AAudioEndpointManager::dump() const {
     return result.str();
 }
 
+void AAudioEndpointManager::addOpenLatency(int32_t histogram[], int64_t nanos) {
+    int64_t msec = nanos / AAUDIO_NANOS_PER_MILLISECOND;
+    int bucket = 0;
+    while (bucket < kOpenLatencyBuckets - 1 && msec >= (1 << bucket)) {
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+std::string AAudioEndpointManager::dumpOpenLatency(const int32_t histogram[]) {
+    std::stringstream result;
+    for (int bucket = 0; bucket < kOpenLatencyBuckets; bucket++) {
+        if (bucket < kOpenLatencyBuckets - 1) {
+            result << " <" << (1 << bucket) << ":" << histogram[bucket];
+        } else {
+            result << " >=" << (1 << (bucket - 1)) << ":" << histogram[bucket];
+        }
+    }
+    return result.str();
+}
 
 // Try to find an existing endpoint.
 sp<AAudioServiceEndpoint> AAudioEndpointManager::findExclusiveEndpoint_l(
@@ -170,13 +193,17 @@ sp<AAudioServiceEndpoint> AAudioEndpointManager::openExclusiveEndpoint(
               endpointMMap.get(), configuration.getDeviceId());
         endpoint = endpointMMap;
 
+        int64_t beginNanos = AudioClock::getNanoseconds();
         aaudio_result_t result = endpoint->open(request);
+        int64_t openNanos = AudioClock::getNanoseconds() - beginNanos;
         if (result != AAUDIO_OK) {
             ALOGV("openExclusiveEndpoint(), open failed");
             endpoint.clear();
         } else {
             mExclusiveStreams.push_back(endpointMMap);
             mExclusiveOpenCount++;
+            endpoint->setOpenLatencyNanos(openNanos);
+            addOpenLatency(mExclusiveOpenLatency, openNanos);
         }
     }
 
@@ -215,12 +242,16 @@ sp<AAudioServiceEndpoint> AAudioEndpointManager::openSharedEndpoint(
         }
 
         if (endpoint.get() != nullptr) {
+            int64_t beginNanos = AudioClock::getNanoseconds();
             aaudio_result_t result = endpoint->open(request);
+            int64_t openNanos = AudioClock::getNanoseconds() - beginNanos;
             if (result != AAUDIO_OK) {
                 endpoint.clear();
             } else {
                 mSharedStreams.push_back(endpoint);
                 mSharedOpenCount++;
+                endpoint->setOpenLatencyNanos(openNanos);
+                addOpenLatency(mSharedOpenLatency, openNanos);
             }
         }
         ALOGV("%s(), created endpoint %p, requested device = %d, dir = %d",
@@ -260,6 +291,7 @@ void AAudioEndpointManager::closeExclusiveEndpoint(sp<AAudioServiceEndpoint> ser
                 mExclusiveStreams.end());
 
         serviceEndpoint->close();
+        serviceEndpoint->logMetrics();
         mExclusiveCloseCount++;
         ALOGV("%s() %p for device %d",
               __func__, serviceEndpoint.get(), serviceEndpoint->getDeviceId());
@@ -283,6 +315,7 @@ void AAudioEndpointManager::closeSharedEndpoint(sp<AAudioServiceEndpoint> servic
                 mSharedStreams.end());
 
         serviceEndpoint->close();
+        serviceEndpoint->logMetrics();
         mSharedCloseCount++;
         ALOGV("%s() %p for device %d",
               __func__, serviceEndpoint.get(), serviceEndpoint->getDeviceId());
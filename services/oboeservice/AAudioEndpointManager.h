@@ -76,6 +76,12 @@ private:
     void closeExclusiveEndpoint(android::sp<AAudioServiceEndpoint> serviceEndpoint);
     void closeSharedEndpoint(android::sp<AAudioServiceEndpoint> serviceEndpoint);
 
+    // Histogram of the time taken by open() of a new endpoint.
+    // Bucket i counts opens shorter than 2^i msec, the last one counts the rest.
+    static constexpr int kOpenLatencyBuckets = 10;
+    static void addOpenLatency(int32_t histogram[], int64_t nanos);
+    static std::string dumpOpenLatency(const int32_t histogram[]);
+
     // Use separate locks because opening a Shared endpoint requires opening an Exclusive one.
     // That could cause a recursive lock.
     // Lock mSharedLock before mExclusiveLock.
@@ -96,6 +102,10 @@ private:
     int32_t mSharedFoundCount     = 0;
     int32_t mSharedOpenCount      = 0;
     int32_t mSharedCloseCount     = 0;
+
+    // Modified under the same locks as above.
+    int32_t mExclusiveOpenLatency[kOpenLatencyBuckets] = {};
+    int32_t mSharedOpenLatency[kOpenLatencyBuckets] = {};
 };
 } /* namespace aaudio */
 
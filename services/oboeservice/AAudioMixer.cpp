@@ -25,6 +25,30 @@
 
 #include "AAudioMixer.h"
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#ifndef USE_NEON
+#define USE_NEON (false)
+#endif
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSE2__)
+#ifndef USE_SSE
+#define USE_SSE (true)
+#endif
+#include <emmintrin.h>
+#else
+#ifndef USE_SSE
+#define USE_SSE (false)
+#endif
+#endif
+
 #ifndef AAUDIO_MIXER_ATRACE_ENABLED
 #define AAUDIO_MIXER_ATRACE_ENABLED    1
 #endif
@@ -110,8 +134,28 @@ int32_t AAudioMixer::mix(int streamIndex, FifoBuffer *fifo, bool allowUnderflow)
 
 void AAudioMixer::mixPart(float *destination, float *source, int32_t numFrames) {
     int32_t numSamples = numFrames * mSamplesPerFrame;
-    // TODO maybe optimize using SIMD
-    for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
+    // The client FIFO and the output buffer are only float aligned, so use unaligned access.
+    // Each sum is a single float add, so the result is identical to the scalar loop.
+#if USE_NEON
+    for (; numSamples >= 8; numSamples -= 8) {
+        float32x4_t lo = vaddq_f32(vld1q_f32(destination), vld1q_f32(source));
+        float32x4_t hi = vaddq_f32(vld1q_f32(destination + 4), vld1q_f32(source + 4));
+        vst1q_f32(destination, lo);
+        vst1q_f32(destination + 4, hi);
+        destination += 8;
+        source += 8;
+    }
+#elif USE_SSE
+    for (; numSamples >= 8; numSamples -= 8) {
+        __m128 lo = _mm_add_ps(_mm_loadu_ps(destination), _mm_loadu_ps(source));
+        __m128 hi = _mm_add_ps(_mm_loadu_ps(destination + 4), _mm_loadu_ps(source + 4));
+        _mm_storeu_ps(destination, lo);
+        _mm_storeu_ps(destination + 4, hi);
+        destination += 8;
+        source += 8;
+    }
+#endif
+    for (; numSamples > 0; numSamples--) {
         *destination++ += *source++;
     }
 }
@@ -21,8 +21,10 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string.h>
 
 #include <aaudio/AAudio.h>
+#include <media/MediaAnalyticsItem.h>
 #include <mediautils/SchedulingPolicyService.h>
 #include <mediautils/ServiceUtilities.h>
 #include <utils/String16.h>
@@ -64,7 +66,11 @@ status_t AAudioService::dump(int fd, const Vector<String16>& args) {
         result = ss.str();
         ALOGW("%s", result.c_str());
     } else {
+        std::stringstream fallbacks;
+        fallbacks << "Fallbacks: shared = " << mSharedFallbackCount.load()
+                  << ", legacy = " << mLegacyFallbackCount.load() << "\n";
         result = "------------ AAudio Service ------------\n"
+                 + fallbacks.str()
                  + mStreamTracker.dump()
                  + AAudioClientTracker::getInstance().dump()
                  + AAudioEndpointManager::getInstance().dump();
@@ -126,12 +132,14 @@ aaudio_handle_t AAudioService::openStream(const aaudio::AAudioStreamRequest &req
         aaudio::AAudioStreamRequest modifiedRequest = request;
         // Overwrite the original EXCLUSIVE mode with SHARED.
         modifiedRequest.getConfiguration().setSharingMode(AAUDIO_SHARING_MODE_SHARED);
+        logFallback("shared", result);
         serviceStream =  new AAudioServiceStreamShared(*this);
         result = serviceStream->open(modifiedRequest);
     }
 
     if (result != AAUDIO_OK) {
         serviceStream.clear();
+        logFallback("legacy", result);
         return result;
     } else {
         aaudio_handle_t handle = mStreamTracker.addStreamForHandle(serviceStream.get());
@@ -144,6 +152,18 @@ aaudio_handle_t AAudioService::openStream(const aaudio::AAudioStreamRequest &req
     }
 }
 
+void AAudioService::logFallback(const char *fallback, aaudio_result_t result) {
+    if (strcmp(fallback, "shared") == 0) {
+        mSharedFallbackCount++;
+    } else {
+        mLegacyFallbackCount++;
+    }
+    std::unique_ptr<MediaAnalyticsItem> item(MediaAnalyticsItem::create("aaudiofallback"));
+    item->setCString("android.media.aaudiofallback.to", fallback);
+    item->setInt32("android.media.aaudiofallback.result", result);
+    item->selfrecord();
+}
+
 // If a close request is pending then close the stream
 bool AAudioService::releaseStream(const sp<AAudioServiceStreamBase> &serviceStream) {
     bool closed = false;
@@ -17,6 +17,7 @@
 #ifndef AAUDIO_AAUDIO_SERVICE_H
 #define AAUDIO_AAUDIO_SERVICE_H
 
+#include <atomic>
 #include <time.h>
 #include <pthread.h>
 
@@ -102,10 +103,18 @@ private:
     aaudio_result_t checkForPendingClose(const sp<aaudio::AAudioServiceStreamBase> &serviceStream,
                                          aaudio_result_t defaultResult);
 
+    // Count and report to MediaMetrics an open that did not get what was requested.
+    void logFallback(const char *fallback, aaudio_result_t result);
+
     android::AudioClient            mAudioClient;
 
     aaudio::AAudioStreamTracker     mStreamTracker;
 
+    // EXCLUSIVE requests that were opened as SHARED.
+    std::atomic<int32_t>            mSharedFallbackCount{0};
+    // Failed opens, after which the client normally uses the legacy path.
+    std::atomic<int32_t>            mLegacyFallbackCount{0};
+
     enum constants {
         DEFAULT_AUDIO_PRIORITY = 2
     };
@@ -25,7 +25,9 @@
 #include <sstream>
 #include <vector>
 
+#include <media/MediaAnalyticsItem.h>
 #include <utils/Singleton.h>
+#include <utility/AudioClock.h>
 
 #include "AAudioEndpointManager.h"
 #include "AAudioServiceEndpoint.h"
@@ -63,6 +65,12 @@ std::string AAudioServiceEndpoint::dump() const {
     result << "    Reference Count:      " << mOpenCount << "\n";
     result << "    Session Id:           " << getSessionId() << "\n";
     result << "    Connected:            " << mConnected.load() << "\n";
+    result << "    Open Latency msec:    " << (mOpenLatencyNanos / AAUDIO_NANOS_PER_MILLISECOND)
+                                           << "\n";
+    result << "    Client XRuns:         " << mClientXRunCount.load() << "\n";
+    result << "    Streams Registered:   " << mRegisterCount << "\n";
+    result << "    Streams Peak:         " << mPeakStreamCount << "\n";
+    result << "    Streams Mean:         " << getMeanStreamCount_l() << "\n";
     result << "    Registered Streams:" << "\n";
     result << AAudioServiceStreamShared::dumpHeader() << "\n";
     for (const auto& stream : mRegisteredStreams) {
@@ -89,6 +97,7 @@ bool AAudioServiceEndpoint::isStreamRegistered(audio_port_handle_t portHandle) {
 void AAudioServiceEndpoint::disconnectRegisteredStreams() {
     std::lock_guard<std::mutex> lock(mLockStreams);
     mConnected.store(false);
+    updateStreamCountStatistics_l();
     for (const auto& stream : mRegisteredStreams) {
         ALOGD("disconnectRegisteredStreams() stop and disconnect port %d",
               stream->getPortHandle());
@@ -98,14 +107,68 @@ void AAudioServiceEndpoint::disconnectRegisteredStreams() {
     mRegisteredStreams.clear();
 }
 
+void AAudioServiceEndpoint::updateStreamCountStatistics_l() {
+    int64_t now = AudioClock::getNanoseconds();
+    if (mFirstRegisterNanos == 0) {
+        mFirstRegisterNanos = now;
+    } else {
+        mStreamCountNanos += (now - mLastStreamCountNanos) * (int64_t) mRegisteredStreams.size();
+    }
+    mLastStreamCountNanos = now;
+}
+
+double AAudioServiceEndpoint::getMeanStreamCount_l() const {
+    if (mFirstRegisterNanos == 0) {
+        return 0.0;
+    }
+    int64_t now = AudioClock::getNanoseconds();
+    int64_t totalNanos = now - mFirstRegisterNanos;
+    int64_t streamNanos = mStreamCountNanos
+            + (now - mLastStreamCountNanos) * (int64_t) mRegisteredStreams.size();
+    return (totalNanos > 0) ? ((double) streamNanos / totalNanos) : 0.0;
+}
+
+void AAudioServiceEndpoint::logMetrics() {
+    std::unique_ptr<MediaAnalyticsItem> item(MediaAnalyticsItem::create("aaudioendpoint"));
+
+#define MM_PREFIX "android.media.aaudioendpoint." // avoid cut-n-paste errors.
+
+    std::lock_guard<std::mutex> lock(mLockStreams);
+    item->setCString(MM_PREFIX "sharingMode",
+            (getSharingMode() == AAUDIO_SHARING_MODE_EXCLUSIVE) ? "exclusive" : "shared");
+    item->setCString(MM_PREFIX "direction",
+            (getDirection() == AAUDIO_DIRECTION_OUTPUT) ? "output" : "input");
+    item->setInt32(MM_PREFIX "sampleRate", getSampleRate());
+    item->setInt32(MM_PREFIX "framesPerBurst", mFramesPerBurst);
+    item->setDouble(MM_PREFIX "openLatencyMs",
+            (double) mOpenLatencyNanos / AAUDIO_NANOS_PER_MILLISECOND);
+    item->setInt32(MM_PREFIX "clientXRuns", mClientXRunCount.load());
+    item->setInt32(MM_PREFIX "streamsRegistered", mRegisterCount);
+    item->setInt32(MM_PREFIX "streamsPeak", mPeakStreamCount);
+    item->setDouble(MM_PREFIX "streamsMean", getMeanStreamCount_l());
+    if (mFirstRegisterNanos != 0) {
+        item->setInt64(MM_PREFIX "activeMs",
+                (AudioClock::getNanoseconds() - mFirstRegisterNanos)
+                / AAUDIO_NANOS_PER_MILLISECOND);
+    }
+
+#undef MM_PREFIX
+
+    item->selfrecord();
+}
+
 aaudio_result_t AAudioServiceEndpoint::registerStream(sp<AAudioServiceStreamBase>stream) {
     std::lock_guard<std::mutex> lock(mLockStreams);
+    updateStreamCountStatistics_l();
     mRegisteredStreams.push_back(stream);
+    mRegisterCount++;
+    mPeakStreamCount = std::max(mPeakStreamCount, (int32_t) mRegisteredStreams.size());
     return AAUDIO_OK;
 }
 
 aaudio_result_t AAudioServiceEndpoint::unregisterStream(sp<AAudioServiceStreamBase>stream) {
     std::lock_guard<std::mutex> lock(mLockStreams);
+    updateStreamCountStatistics_l();
     mRegisteredStreams.erase(std::remove(
             mRegisteredStreams.begin(), mRegisteredStreams.end(), stream),
                              mRegisteredStreams.end());
@@ -108,6 +108,25 @@ public:
         return mConnected;
     }
 
+    // This should only be called from the AAudioEndpointManager.
+    void setOpenLatencyNanos(int64_t nanos) {
+        mOpenLatencyNanos = nanos;
+    }
+
+    /**
+     * Count an underflow or overflow of a client stream.
+     * Called from the endpoint thread.
+     */
+    void incrementClientXRunCount() {
+        mClientXRunCount++;
+    }
+
+    /**
+     * Report the statistics collected over the life of this endpoint to MediaMetrics.
+     * Call once, after close().
+     */
+    void logMetrics();
+
 protected:
 
     /**
@@ -118,6 +137,12 @@ protected:
 
     void                     disconnectRegisteredStreams();
 
+    // Accumulate the number of registered streams over time, call before it changes.
+    void                     updateStreamCountStatistics_l();
+
+    // @return the average number of registered streams since the first one was registered
+    double                   getMeanStreamCount_l() const;
+
     mutable std::mutex       mLockStreams;
     std::vector<android::sp<AAudioServiceStreamBase>> mRegisteredStreams;
 
@@ -130,6 +155,16 @@ protected:
     int32_t                  mRequestedDeviceId = 0;
 
     std::atomic<bool>        mConnected{true};
+
+    // Statistics, see dump() and logMetrics().
+    int64_t                  mOpenLatencyNanos = 0;
+    std::atomic<int32_t>     mClientXRunCount{0};
+    // Protected by mLockStreams.
+    int32_t                  mPeakStreamCount = 0;
+    int32_t                  mRegisterCount = 0;
+    int64_t                  mFirstRegisterNanos = 0;
+    int64_t                  mLastStreamCountNanos = 0;
+    int64_t                  mStreamCountNanos = 0; // streams integrated over time
 };
 
 } /* namespace aaudio */
@@ -106,6 +106,7 @@ void *AAudioServiceEndpointCapture::callbackLoop() {
                             if (fifo->getEmptyFramesAvailable() <
                                     getFramesPerBurst()) {
                                 streamShared->incrementXRunCount();
+                                incrementClientXRunCount();
                             } else {
                                 fifo->write(mDistributionBuffer, getFramesPerBurst());
                             }
@@ -40,6 +40,8 @@ using namespace android;  // TODO just import names needed
 using namespace aaudio;   // TODO just import names needed
 
 #define BURSTS_PER_BUFFER_DEFAULT   2
+// Limit how deep the endpoint can get when only large buffer clients are running.
+#define BURSTS_PER_BUFFER_MAX_TUNED 8
 
 AAudioServiceEndpointPlay::AAudioServiceEndpointPlay(AAudioService &audioService)
         : mStreamInternalPlay(audioService, true) {
@@ -63,6 +65,20 @@ aaudio_result_t AAudioServiceEndpointPlay::open(const aaudio::AAudioStreamReques
     return result;
 }
 
+void AAudioServiceEndpointPlay::tuneBufferSize(int32_t targetFrames) {
+    const int32_t framesPerBurst = getFramesPerBurst();
+    // Clients without a target, or with a small one, get the double buffered default.
+    if (targetFrames == AAUDIO_UNSPECIFIED) {
+        targetFrames = BURSTS_PER_BUFFER_DEFAULT * framesPerBurst;
+    }
+    targetFrames = std::max(targetFrames, BURSTS_PER_BUFFER_DEFAULT * framesPerBurst);
+    targetFrames = std::min(targetFrames, BURSTS_PER_BUFFER_MAX_TUNED * framesPerBurst);
+    if (targetFrames != getStreamInternal()->getBufferSize()) {
+        aaudio_result_t result = getStreamInternal()->setBufferSize(targetFrames);
+        ALOGD("%s() buffer size %d frames, result = %d", __func__, targetFrames, result);
+    }
+}
+
 // Mix data from each application stream and write result to the shared MMAP stream.
 void *AAudioServiceEndpointPlay::callbackLoop() {
     ALOGD("%s() entering >>>>>>>>>>>>>>> MIXER", __func__);
@@ -73,6 +89,8 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
     while (mCallbackEnabled.load() && getStreamInternal()->isActive() && (result >= 0)) {
         // Mix data from each active stream.
         mMixer.clear();
+        // Smallest latency target of the clients that are running.
+        int32_t targetFrames = AAUDIO_UNSPECIFIED;
 
         { // brackets are for lock_guard
             int index = 0;
@@ -97,6 +115,15 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
                 sp<AAudioServiceStreamShared> streamShared =
                         static_cast<AAudioServiceStreamShared *>(clientStream.get());
 
+                // A client without a target only runs at the default size, so it wins.
+                int32_t clientTargetFrames = streamShared->getLatencyTargetFrames();
+                if (clientTargetFrames == AAUDIO_UNSPECIFIED) {
+                    clientTargetFrames = BURSTS_PER_BUFFER_DEFAULT * getFramesPerBurst();
+                }
+                if (targetFrames == AAUDIO_UNSPECIFIED || clientTargetFrames < targetFrames) {
+                    targetFrames = clientTargetFrames;
+                }
+
                 {
                     // Lock the AudioFifo to protect against close.
                     std::lock_guard <std::mutex> lock(streamShared->getAudioDataQueueLock());
@@ -120,6 +147,7 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
                                                && framesMixed < mMixer.getFramesPerBurst();
                             if (underflowed) {
                                 streamShared->incrementXRunCount();
+                                incrementClientXRunCount();
                             }
                         } else if (framesMixed > 0) {
                             // Mark beginning of data flow after a start.
@@ -141,6 +169,10 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
             }
         }
 
+        if (mLatencyTuningEnabled) {
+            tuneBufferSize(targetFrames);
+        }
+
         // Write mixer output to stream using a blocking write.
         result = getStreamInternal()->write(mMixer.getOutputBuffer(),
                                             getFramesPerBurst(), timeoutNanos);
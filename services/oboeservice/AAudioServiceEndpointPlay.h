@@ -45,8 +45,11 @@ public:
     void *callbackLoop() override;
 
 private:
+    // Resize the MMAP buffer to the smallest latency target of the running clients.
+    void tuneBufferSize(int32_t targetFrames);
+
     AudioStreamInternalPlay  mStreamInternalPlay; // for playing output of mixer
-    bool                     mLatencyTuningEnabled = false; // TODO implement tuning
+    bool                     mLatencyTuningEnabled = false;
     AAudioMixer              mMixer;    //
 };
 
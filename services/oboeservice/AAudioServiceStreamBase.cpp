@@ -60,7 +60,8 @@ AAudioServiceStreamBase::~AAudioServiceStreamBase() {
 }
 
 std::string AAudioServiceStreamBase::dumpHeader() {
-    return std::string("    T   Handle   UId   Port Run State Format Burst Chan Capacity");
+    return std::string("    T   Handle   UId   Port Run State Format Burst Chan Capacity"
+                       " TsMsg/s");
 }
 
 std::string AAudioServiceStreamBase::dump() const {
@@ -76,6 +77,8 @@ std::string AAudioServiceStreamBase::dump() const {
     result << std::setw(6) << mFramesPerBurst;
     result << std::setw(5) << getSamplesPerFrame();
     result << std::setw(9) << getBufferCapacity();
+    result << std::setw(8) << std::fixed << std::setprecision(1)
+           << (isRunning() ? getTimestampMessageRate() : 0.0);
 
     return result.str();
 }
@@ -191,6 +194,9 @@ aaudio_result_t AAudioServiceStreamBase::start() {
     // This should happen at the end of the start.
     sendServiceEvent(AAUDIO_SERVICE_EVENT_STARTED);
     setState(AAUDIO_STREAM_STATE_STARTED);
+    mTimestampMessageCount = 0;
+    mTimestampStartNanos = AudioClock::getNanoseconds();
+    mTimestampDisturbed = false;
     mThreadEnabled.store(true);
     result = mTimestampThread.start(this);
     if (result != AAUDIO_OK) goto error;
@@ -302,11 +308,17 @@ void AAudioServiceStreamBase::run() {
     while(mThreadEnabled.load()) {
         loopCount++;
         if (AudioClock::getNanoseconds() >= nextTime) {
-            aaudio_result_t result = sendCurrentTimestamp();
+            Timestamp sent(0, 0);
+            aaudio_result_t result = sendCurrentTimestamp(&sent);
             if (result != AAUDIO_OK) {
                 ALOGE("%s() timestamp thread got result = %d", __func__, result);
                 break;
             }
+            if (mTimestampDisturbed.exchange(false)) {
+                timestampScheduler.onDisturbance();
+            } else if (sent.getNanoseconds() != 0) {
+                timestampScheduler.onTimestamp(sent.getPosition(), sent.getNanoseconds());
+            }
             nextTime = timestampScheduler.nextAbsoluteTime();
         } else  {
             // Sleep until it is time to send the next timestamp.
@@ -314,8 +326,16 @@ void AAudioServiceStreamBase::run() {
             AudioClock::sleepUntilNanoTime(nextTime);
         }
     }
-    ALOGD("%s() %s exiting after %d loops <<<<<<<<<<<<<< TIMESTAMPS",
-          __func__, getTypeText(), loopCount);
+    ALOGD("%s() %s exiting after %d loops, %.1f msg/s <<<<<<<<<<<<<< TIMESTAMPS",
+          __func__, getTypeText(), loopCount, getTimestampMessageRate());
+}
+
+double AAudioServiceStreamBase::getTimestampMessageRate() const {
+    int64_t elapsedNanos = AudioClock::getNanoseconds() - mTimestampStartNanos.load();
+    if (mTimestampStartNanos.load() == 0 || elapsedNanos <= 0) {
+        return 0.0;
+    }
+    return mTimestampMessageCount.load() * (double) AAUDIO_NANOS_PER_SECOND / elapsedNanos;
 }
 
 void AAudioServiceStreamBase::disconnect() {
@@ -375,10 +395,11 @@ aaudio_result_t AAudioServiceStreamBase::writeUpMessageQueue(AAudioServiceMessag
 }
 
 aaudio_result_t AAudioServiceStreamBase::sendXRunCount(int32_t xRunCount) {
+    mTimestampDisturbed = true;
     return sendServiceEvent(AAUDIO_SERVICE_EVENT_XRUN, (int64_t) xRunCount);
 }
 
-aaudio_result_t AAudioServiceStreamBase::sendCurrentTimestamp() {
+aaudio_result_t AAudioServiceStreamBase::sendCurrentTimestamp(Timestamp *sent) {
     AAudioServiceMessage command;
     // It is not worth filling up the queue with timestamps.
     // That can cause the stream to get suspended.
@@ -398,6 +419,10 @@ aaudio_result_t AAudioServiceStreamBase::sendCurrentTimestamp() {
         result = writeUpMessageQueue(&command);
 
         if (result == AAUDIO_OK) {
+            mTimestampMessageCount++;
+            if (sent != nullptr) {
+                *sent = Timestamp(command.timestamp.position, command.timestamp.timestamp);
+            }
             // Send a hardware timestamp for presentation time.
             result = getHardwareTimestamp(&command.timestamp.position,
                                           &command.timestamp.timestamp);
@@ -407,6 +432,9 @@ aaudio_result_t AAudioServiceStreamBase::sendCurrentTimestamp() {
                       (long long) command.timestamp.timestamp);
                 command.what = AAudioServiceMessage::code::TIMESTAMP_HARDWARE;
                 result = writeUpMessageQueue(&command);
+                if (result == AAUDIO_OK) {
+                    mTimestampMessageCount++;
+                }
             }
         }
     }
@@ -270,7 +270,11 @@ protected:
 
     aaudio_result_t writeUpMessageQueue(AAudioServiceMessage *command);
 
-    aaudio_result_t sendCurrentTimestamp();
+    /**
+     * @param sent if not null, receives the free running position that was sent
+     * @return AAUDIO_OK or negative error, sent is only valid if a timestamp was sent
+     */
+    aaudio_result_t sendCurrentTimestamp(Timestamp *sent = nullptr);
 
     aaudio_result_t sendXRunCount(int32_t xRunCount);
 
@@ -295,6 +299,11 @@ protected:
     AAudioThread            mTimestampThread;
     // This is used by one thread to tell another thread to exit. So it must be atomic.
     std::atomic<bool>       mThreadEnabled{false};
+    // Set when the timing may have been disturbed, so timestamps are sent more often.
+    std::atomic<bool>       mTimestampDisturbed{false};
+    // Timestamp messages sent since the stream was last started, for dump().
+    std::atomic<int64_t>    mTimestampMessageCount{0};
+    std::atomic<int64_t>    mTimestampStartNanos{0};
 
     int32_t                 mFramesPerBurst = 0;
     android::AudioClient    mMmapClient; // set in open, used in MMAP start()
@@ -318,6 +327,11 @@ private:
      */
     bool isUpMessageQueueBusy();
 
+    /**
+     * @return timestamp messages per second since the stream was started
+     */
+    double getTimestampMessageRate() const;
+
     aaudio_handle_t         mHandle = -1;
     bool                    mFlowing = false;
 
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
@@ -176,6 +177,12 @@ aaudio_result_t AAudioServiceStreamShared::open(const aaudio::AAudioStreamReques
         setBufferCapacity(0);
         goto error;
     }
+    // A client that asked for a small buffer needs the endpoint to stay close behind it,
+    // one with a large buffer can keep up with a deeper endpoint from half of its FIFO.
+    if (configurationInput.getBufferCapacity() != AAUDIO_UNSPECIFIED) {
+        int32_t numBursts = std::max(1, getBufferCapacity() / (2 * mFramesPerBurst));
+        mLatencyTargetFrames = numBursts * mFramesPerBurst;
+    }
 
     {
         std::lock_guard<std::mutex> lock(mAudioDataQueueLock);
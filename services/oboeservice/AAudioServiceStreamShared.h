@@ -89,6 +89,15 @@ public:
 
     const char *getTypeText() const override { return "Shared"; }
 
+    /**
+     * The endpoint buffer size this client would like the mixer to run at,
+     * so that its own FIFO can absorb the rest of the scheduling jitter.
+     * @return frames or AAUDIO_UNSPECIFIED if the client did not request a capacity
+     */
+    int32_t getLatencyTargetFrames() const {
+        return mLatencyTargetFrames;
+    }
+
 protected:
 
     aaudio_result_t getAudioDataDescription(AudioEndpointParcelable &parcelable) override;
@@ -111,6 +120,7 @@ private:
 
     std::atomic<int64_t>     mTimestampPositionOffset;
     std::atomic<int32_t>     mXRunCount;
+    int32_t                  mLatencyTargetFrames = AAUDIO_UNSPECIFIED;
 
 };
 
@@ -52,6 +52,7 @@ LOCAL_SHARED_LIBRARIES :=  \
     libaudioclient \
     libbinder \
     libcutils \
+    libmediametrics \
     libmediautils \
     libutils \
     liblog
@@ -43,7 +43,7 @@ aaudio_result_t SharedRingBuffer::allocate(fifo_frames_t   bytesPerFrame,
 
     // Create shared memory large enough to hold the data and the read and write counters.
     mDataMemorySizeInBytes = bytesPerFrame * capacityInFrames;
-    mSharedMemorySizeInBytes = mDataMemorySizeInBytes + (2 * (sizeof(fifo_counter_t)));
+    mSharedMemorySizeInBytes = mDataMemorySizeInBytes + SHARED_RINGBUFFER_DATA_OFFSET;
     mFileDescriptor.reset(ashmem_create_region("AAudioSharedRingBuffer", mSharedMemorySizeInBytes));
     if (mFileDescriptor.get() == -1) {
         ALOGE("allocate() ashmem_create_region() failed %d", errno);
@@ -93,4 +93,5 @@ void SharedRingBuffer::fillParcelable(AudioEndpointParcelable &endpointParcelabl
     ringBufferParcelable.setBytesPerFrame(mFifoBuffer->getBytesPerFrame());
     ringBufferParcelable.setFramesPerBurst(1);
     ringBufferParcelable.setCapacityInFrames(mCapacityInFrames);
+    ringBufferParcelable.setFlags(RingbufferFlags::COUNTERS_PADDED);
 }
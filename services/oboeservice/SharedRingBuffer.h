@@ -29,9 +29,12 @@
 namespace aaudio {
 
 // Determine the placement of the counters and data in shared memory.
+// The read counter is written by one process and the write counter by the other,
+// so each gets its own cache line, see RingbufferFlags::COUNTERS_PADDED.
 #define SHARED_RINGBUFFER_READ_OFFSET   0
-#define SHARED_RINGBUFFER_WRITE_OFFSET  sizeof(fifo_counter_t)
-#define SHARED_RINGBUFFER_DATA_OFFSET   (SHARED_RINGBUFFER_WRITE_OFFSET + sizeof(fifo_counter_t))
+#define SHARED_RINGBUFFER_WRITE_OFFSET  android::kFifoCacheLineSize
+#define SHARED_RINGBUFFER_DATA_OFFSET   (SHARED_RINGBUFFER_WRITE_OFFSET \
+                                         + android::kFifoCacheLineSize)
 
 /**
  * Atomic FIFO that uses shared memory.
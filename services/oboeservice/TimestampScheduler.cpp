@@ -17,6 +17,8 @@
 // for random()
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include "TimestampScheduler.h"
 
 using namespace aaudio;
@@ -24,17 +26,59 @@ using namespace aaudio;
 void TimestampScheduler::start(int64_t startTime) {
     mStartTime = startTime;
     mLastTime = startTime;
+    mHasPrevious = false;
+    restartSchedule();
+}
+
+void TimestampScheduler::restartSchedule() {
+    mPeriodsToDelay = 1;
+    mStartupPeriodsLeft = kStartupPeriods;
+}
+
+void TimestampScheduler::onDisturbance() {
+    mHasPrevious = false;
+    restartSchedule();
+}
+
+void TimestampScheduler::onTimestamp(int64_t position, int64_t timeNanos) {
+    if (mFramesPerBurst <= 0 || mSampleRate <= 0) {
+        return;
+    }
+    if (mHasPrevious && timeNanos > mPreviousTime) {
+        int64_t expectedFrames = (timeNanos - mPreviousTime) * mSampleRate
+                / AAUDIO_NANOS_PER_SECOND;
+        int64_t error = std::abs((position - mPreviousPosition) - expectedFrames);
+        // Positions usually advance one burst at a time so allow for that quantization.
+        if (error > mFramesPerBurst + (mFramesPerBurst / 2)) {
+            restartSchedule();
+        } else if (mStartupPeriodsLeft == 0) {
+            int64_t maxPeriods = std::max(kMaxPeriodsToDelay, kMaxDelayNanos / mBurstPeriod);
+            mPeriodsToDelay = std::min(mPeriodsToDelay * 2, maxPeriods);
+        }
+    }
+    mHasPrevious = true;
+    mPreviousPosition = position;
+    mPreviousTime = timeNanos;
 }
 
 int64_t TimestampScheduler::nextAbsoluteTime() {
-    int64_t periodsElapsed = (mLastTime - mStartTime) / mBurstPeriod;
-    // This is an arbitrary schedule that could probably be improved.
-    // It starts out sending a timestamp on every period because we want to
-    // get an accurate picture when the stream starts. Then it slows down
-    // to the occasional timestamps needed to detect a slow drift.
-    int64_t minPeriodsToDelay = (periodsElapsed < 10) ? 1 :
-        (periodsElapsed < 100) ? 3 :
-        (periodsElapsed < 1000) ? 10 : 50;
+    int64_t minPeriodsToDelay;
+    if (mFramesPerBurst > 0) {
+        // Adaptive, see onTimestamp().
+        if (mStartupPeriodsLeft > 0) {
+            mStartupPeriodsLeft--;
+        }
+        minPeriodsToDelay = mPeriodsToDelay;
+    } else {
+        int64_t periodsElapsed = (mLastTime - mStartTime) / mBurstPeriod;
+        // This is an arbitrary schedule that could probably be improved.
+        // It starts out sending a timestamp on every period because we want to
+        // get an accurate picture when the stream starts. Then it slows down
+        // to the occasional timestamps needed to detect a slow drift.
+        minPeriodsToDelay = (periodsElapsed < 10) ? 1 :
+            (periodsElapsed < 100) ? 3 :
+            (periodsElapsed < 1000) ? 10 : 50;
+    }
     int64_t sleepTime = minPeriodsToDelay * mBurstPeriod;
     // Generate a random rectangular distribution one burst wide so that we get
     // an uncorrelated sampling of the MMAP pointer.
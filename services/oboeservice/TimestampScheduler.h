@@ -26,6 +26,12 @@ namespace aaudio {
  * Schedule wakeup time for monitoring the position
  * of an MMAP/NOIRQ buffer.
  *
+ * The schedule is adaptive. After a timestamp on every burst at startup, the interval
+ * doubles each time a measured position agrees with the previous one and the nominal rate,
+ * up to kMaxPeriodsToDelay or kMaxDelayNanos. A position that disagrees, or a call to
+ * onDisturbance(), goes back to one timestamp per burst so that the client clock model
+ * can resynchronize quickly.
+ *
  * Note that this object is not thread safe. Only call it from a single thread.
  */
 class TimestampScheduler
@@ -44,24 +50,61 @@ public:
      */
     int64_t nextAbsoluteTime();
 
+    /**
+     * Report a position measured at the scheduled time.
+     * This is used to decide whether the schedule can back off.
+     * It is ignored unless the burst was set in frames.
+     */
+    void onTimestamp(int64_t position, int64_t timeNanos);
+
+    /**
+     * Something disturbed the timing, for example an XRun.
+     * Send timestamps on every burst again until the position is stable.
+     */
+    void onDisturbance();
+
     void setBurstPeriod(int64_t burstPeriod) {
         mBurstPeriod = burstPeriod;
+        mFramesPerBurst = 0;
     }
 
     void setBurstPeriod(int32_t framesPerBurst,
                         int32_t sampleRate) {
         mBurstPeriod = AAUDIO_NANOS_PER_SECOND * framesPerBurst / sampleRate;
+        mFramesPerBurst = framesPerBurst;
+        mSampleRate = sampleRate;
     }
 
     int64_t getBurstPeriod() {
         return mBurstPeriod;
     }
 
+    int64_t getPeriodsToDelay() const {
+        return mPeriodsToDelay;
+    }
+
+    // Number of timestamps sent on every burst after start() or a disturbance.
+    static constexpr int32_t kStartupPeriods = 10;
+    // Longest delay between timestamps once the position is stable, whichever is longer.
+    // The limit in time backs off further for streams with short bursts.
+    static constexpr int64_t kMaxPeriodsToDelay = 50;
+    static constexpr int64_t kMaxDelayNanos = 200 * AAUDIO_NANOS_PER_MILLISECOND;
+
 private:
+    void restartSchedule();
+
     // Start with an arbitrary default so we do not divide by zero.
     int64_t mBurstPeriod = AAUDIO_NANOS_PER_MILLISECOND;
+    int32_t mFramesPerBurst = 0; // zero if the schedule is not adaptive.
+    int32_t mSampleRate = 0;
     int64_t mStartTime = 0;
     int64_t mLastTime = 0;
+
+    int64_t mPeriodsToDelay = 1;
+    int32_t mStartupPeriodsLeft = kStartupPeriods;
+    bool    mHasPrevious = false;
+    int64_t mPreviousPosition = 0;
+    int64_t mPreviousTime = 0;
 };
 
 } /* namespace aaudio */